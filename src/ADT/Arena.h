@@ -0,0 +1,290 @@
+#ifndef _DG_ADT_ARENA_H_
+#define _DG_ADT_ARENA_H_
+
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ADT/TaggedAllocator.h"
+
+namespace dg {
+namespace ADT {
+
+// Allocator of objects of one type. The objects are allocated
+// in big chunks of memory one after another and they are all
+// destroyed at once when the arena is destroyed (or cleared),
+// there is no way to free a single object.
+// The memory is counted to TAG (see AllocationStats).
+template <typename T, AllocTag TAG = AllocTag::OTHER>
+class Arena
+{
+    using StorageT = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    static const size_t FIRST_CHUNK_SIZE = 256;
+    static const size_t MAX_CHUNK_SIZE = 1 << 16;
+
+    struct Chunk {
+        StorageT *mem;
+        // the number of objects in the chunk
+        size_t objects;
+        size_t capacity;
+
+        Chunk(StorageT *m, size_t c) : mem(m), objects(0), capacity(c) {}
+    };
+
+    std::vector<Chunk> chunks;
+    // capacity of the last chunk
+    size_t capacity = 0;
+    size_t objects = 0;
+
+    void *allocate()
+    {
+        if (chunks.empty() || chunks.back().objects == capacity) {
+            if (capacity == 0)
+                capacity = FIRST_CHUNK_SIZE;
+            else if (capacity < MAX_CHUNK_SIZE)
+                capacity *= 2;
+
+            chunks.emplace_back(static_cast<StorageT *>(
+                                    taggedAllocate(TAG, capacity * sizeof(StorageT))),
+                                capacity);
+        }
+
+        return &chunks.back().mem[chunks.back().objects];
+    }
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() { clear(); }
+
+    template <typename... Args>
+    T *create(Args&&... args)
+    {
+        void *mem = allocate();
+        T *obj = new (mem) T(std::forward<Args>(args)...);
+        // count the object only when it was successfully constructed
+        ++chunks.back().objects;
+        ++objects;
+
+        return obj;
+    }
+
+    // destroy all the objects and free the memory
+    void clear()
+    {
+        // destroy the objects in the reverse order of creation
+        for (auto I = chunks.rbegin(), E = chunks.rend(); I != E; ++I) {
+            T *objs = reinterpret_cast<T *>(I->mem);
+            for (size_t i = I->objects; i > 0; --i)
+                objs[i - 1].~T();
+
+            taggedDeallocate(TAG, I->mem, I->capacity * sizeof(StorageT));
+        }
+
+        chunks.clear();
+        capacity = objects = 0;
+    }
+
+    // call @f on every allocated object
+    template <typename F>
+    void forEach(F f)
+    {
+        for (auto& chunk : chunks) {
+            T *objs = reinterpret_cast<T *>(chunk.mem);
+            for (size_t i = 0; i < chunk.objects; ++i)
+                f(&objs[i]);
+        }
+    }
+
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (const auto& chunk : chunks) {
+            const T *objs = reinterpret_cast<const T *>(chunk.mem);
+            for (size_t i = 0; i < chunk.objects; ++i)
+                f(&objs[i]);
+        }
+    }
+
+    size_t size() const { return objects; }
+};
+
+// Allocator of memory for objects of one type that can be freed
+// one by one. The freed memory is kept in a free list and reused
+// by the next allocations. When all the allocated objects are freed,
+// all the chunks are released at once. This is meant to be used
+// in the class-specific operator new/delete.
+// The memory is counted to TAG (see AllocationStats).
+template <typename T, AllocTag TAG = AllocTag::OTHER>
+class Pool
+{
+    union Slot {
+        Slot *next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static const size_t FIRST_CHUNK_SIZE = 256;
+    static const size_t MAX_CHUNK_SIZE = 1 << 16;
+
+    // chunks of memory and their capacities
+    std::vector<std::pair<Slot *, size_t>> chunks;
+    // capacity of the last chunk and the number of used slots in it
+    size_t capacity = 0;
+    size_t used = 0;
+    Slot *freelist = nullptr;
+    // the number of allocated objects that were not freed yet
+    size_t live = 0;
+
+    // when the pool is used from more threads at once,
+    // the access to it must be synchronized
+    bool concurrent = false;
+    std::mutex mtx;
+
+    void *_allocate()
+    {
+        ++live;
+        if (freelist) {
+            Slot *slot = freelist;
+            freelist = slot->next;
+            return slot;
+        }
+
+        if (chunks.empty() || used == capacity) {
+            if (capacity == 0)
+                capacity = FIRST_CHUNK_SIZE;
+            else if (capacity < MAX_CHUNK_SIZE)
+                capacity *= 2;
+
+            chunks.emplace_back(static_cast<Slot *>(
+                                    taggedAllocate(TAG, capacity * sizeof(Slot))),
+                                capacity);
+            used = 0;
+        }
+
+        return &chunks.back().first[used++];
+    }
+
+    void _deallocate(void *mem)
+    {
+        assert(live > 0 && "Freeing more objects than allocated");
+        Slot *slot = static_cast<Slot *>(mem);
+        slot->next = freelist;
+        freelist = slot;
+
+        if (--live == 0)
+            release();
+    }
+
+public:
+    Pool() = default;
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool() { release(); }
+
+    void *allocate()
+    {
+        if (!concurrent)
+            return _allocate();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return _allocate();
+    }
+
+    void deallocate(void *mem)
+    {
+        if (!concurrent) {
+            _deallocate(mem);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        _deallocate(mem);
+    }
+
+    // must not be called while the pool is used by other threads
+    void setConcurrent(bool c) { concurrent = c; }
+
+    // free all the memory, there must be no objects left
+    void release()
+    {
+        for (const auto& chunk : chunks)
+            taggedDeallocate(TAG, chunk.first, chunk.second * sizeof(Slot));
+
+        chunks.clear();
+        capacity = used = 0;
+        freelist = nullptr;
+    }
+
+    size_t size() const { return live; }
+    size_t chunksNum() const { return chunks.size(); }
+};
+
+// Bump allocator of arrays of trivially destructible elements.
+// The arrays cannot be freed one by one, the memory is freed
+// all at once with clear() or when the arena is destroyed.
+template <typename T>
+class ArrayArena
+{
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "ArrayArena does not call destructors");
+
+    static const size_t CHUNK_SIZE = 4096;
+
+    std::vector<T *> chunks;
+    // used space and the capacity of the last chunk
+    size_t used = 0;
+    size_t capacity = 0;
+
+public:
+    ArrayArena() = default;
+    ArrayArena(const ArrayArena&) = delete;
+    ArrayArena& operator=(const ArrayArena&) = delete;
+
+    ~ArrayArena() { clear(); }
+
+    // get a (value-initialized) array of @n elements
+    T *allocate(size_t n)
+    {
+        if (n > CHUNK_SIZE) {
+            // too big array gets its own chunk, put it before the last
+            // chunk so that we can keep allocating from the last one
+            T *mem = new T[n]();
+            chunks.insert(chunks.empty() ? chunks.end() : chunks.end() - 1, mem);
+            return mem;
+        }
+
+        if (chunks.empty() || capacity - used < n) {
+            chunks.push_back(new T[CHUNK_SIZE]());
+            capacity = CHUNK_SIZE;
+            used = 0;
+        }
+
+        T *mem = chunks.back() + used;
+        used += n;
+        return mem;
+    }
+
+    void clear()
+    {
+        for (T *chunk : chunks)
+            delete[] chunk;
+
+        chunks.clear();
+        used = capacity = 0;
+    }
+
+    size_t chunksNum() const { return chunks.size(); }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_ARENA_H_
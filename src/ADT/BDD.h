@@ -0,0 +1,411 @@
+#ifndef _DG_ADT_BDD_H_
+#define _DG_ADT_BDD_H_
+
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ADT/TaggedAllocator.h"
+
+namespace dg {
+namespace ADT {
+
+///
+// Reduced ordered binary decision diagrams representing sets
+// of VARS-bit unsigned numbers (the variable 0 is the most significant
+// bit). All the sets of one manager share the nodes, so the sets that
+// have a lot of elements in common (or elements with common prefixes)
+// take little memory, and equal sets have the same root, so they are
+// compared in constant time.
+//
+// The roots of the sets that are kept must be referenced by ref()
+// (and released by deref()). The nodes that are not reachable from
+// a referenced root are collected from time to time at the beginning
+// of the operations, so all the operands of an operation must be
+// referenced. The memory of the nodes is counted to AllocTag::PTA_SETS.
+class BDDManager
+{
+public:
+    using Ref = uint32_t;
+
+    static const unsigned VARS = 32;
+    static const Ref ZERO = 0;
+    static const Ref ONE = 1;
+
+private:
+    struct Node {
+        uint32_t var;
+        Ref lo, hi;
+
+        bool operator==(const Node& oth) const
+        {
+            return var == oth.var && lo == oth.lo && hi == oth.hi;
+        }
+    };
+
+    struct NodeHash {
+        size_t operator()(const Node& n) const
+        {
+            return (n.var * 12582917UL) ^ (n.lo * 4256249UL) ^ (n.hi * 741457UL);
+        }
+    };
+
+    template <typename T>
+    using VectorT = std::vector<T, TaggedAllocator<T, AllocTag::PTA_SETS>>;
+
+    VectorT<Node> nodes;
+    // the number of references of the roots
+    VectorT<uint32_t> refs;
+    // the number of elements of the set of every node (over the variables
+    // from the variable of the node on), 0 when not computed yet
+    VectorT<uint64_t> counts;
+    std::vector<Ref> freelist;
+    std::unordered_map<Node, Ref, NodeHash> unique;
+
+    // the results of the operations, cleared by the collection
+    std::unordered_map<uint64_t, Ref> unionCache;
+    std::unordered_map<uint64_t, Ref> diffCache;
+    static const size_t MAX_CACHE_SIZE = 1 << 20;
+
+    // collect the garbage when there is this many nodes
+    size_t collectAt = 1 << 16;
+    size_t referenced = 0;
+
+    bool concurrent = false;
+    std::mutex mtx;
+
+    static uint64_t pairKey(Ref a, Ref b)
+    {
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    uint32_t var(Ref r) const { return nodes[r].var; }
+
+    Ref mk(uint32_t v, Ref lo, Ref hi)
+    {
+        if (lo == hi)
+            return lo;
+
+        Node n{v, lo, hi};
+        auto it = unique.find(n);
+        if (it != unique.end())
+            return it->second;
+
+        Ref r;
+        if (freelist.empty()) {
+            r = nodes.size();
+            nodes.push_back(n);
+            refs.push_back(0);
+            counts.push_back(0);
+        } else {
+            r = freelist.back();
+            freelist.pop_back();
+            nodes[r] = n;
+            refs[r] = 0;
+            counts[r] = 0;
+        }
+
+        unique.emplace(n, r);
+        return r;
+    }
+
+    // the cofactors of @r with respect to the variable @v
+    std::pair<Ref, Ref> cofactors(Ref r, uint32_t v) const
+    {
+        if (var(r) != v)
+            return {r, r};
+        return {nodes[r].lo, nodes[r].hi};
+    }
+
+    Ref _unite(Ref a, Ref b)
+    {
+        if (a == b || b == ZERO)
+            return a;
+        if (a == ZERO)
+            return b;
+        if (a == ONE || b == ONE)
+            return ONE;
+
+        if (a > b)
+            std::swap(a, b);
+
+        uint64_t key = pairKey(a, b);
+        auto it = unionCache.find(key);
+        if (it != unionCache.end())
+            return it->second;
+
+        uint32_t v = std::min(var(a), var(b));
+        auto ca = cofactors(a, v);
+        auto cb = cofactors(b, v);
+        Ref lo = _unite(ca.first, cb.first);
+        Ref hi = _unite(ca.second, cb.second);
+        Ref r = mk(v, lo, hi);
+
+        if (unionCache.size() >= MAX_CACHE_SIZE)
+            unionCache.clear();
+        unionCache.emplace(key, r);
+        return r;
+    }
+
+    Ref _diff(Ref a, Ref b)
+    {
+        if (a == ZERO || a == b || b == ONE)
+            return ZERO;
+        if (b == ZERO)
+            return a;
+
+        uint64_t key = pairKey(a, b);
+        auto it = diffCache.find(key);
+        if (it != diffCache.end())
+            return it->second;
+
+        uint32_t v = std::min(var(a), var(b));
+        auto ca = cofactors(a, v);
+        auto cb = cofactors(b, v);
+        Ref lo = _diff(ca.first, cb.first);
+        Ref hi = _diff(ca.second, cb.second);
+        Ref r = mk(v, lo, hi);
+
+        if (diffCache.size() >= MAX_CACHE_SIZE)
+            diffCache.clear();
+        diffCache.emplace(key, r);
+        return r;
+    }
+
+    Ref singleton(uint32_t x)
+    {
+        Ref r = ONE;
+        for (unsigned v = VARS; v > 0; --v) {
+            if ((x >> (VARS - v)) & 1)
+                r = mk(v - 1, ZERO, r);
+            else
+                r = mk(v - 1, r, ZERO);
+        }
+
+        return r;
+    }
+
+    // the number of elements over the variables from var(r) on
+    uint64_t count(Ref r)
+    {
+        if (r == ZERO)
+            return 0;
+        if (r == ONE)
+            return 1;
+        if (counts[r] != 0)
+            return counts[r];
+
+        const Node& n = nodes[r];
+        Ref lo = n.lo, hi = n.hi;
+        uint64_t c = (count(lo) << (var(lo) - n.var - 1))
+                     + (count(hi) << (var(hi) - n.var - 1));
+        counts[r] = c;
+        return c;
+    }
+
+    // the smallest element of @r (over the variables from @v on)
+    // that is not smaller than @from
+    bool findFrom(Ref r, uint32_t v, uint64_t from, uint64_t& out) const
+    {
+        if (r == ZERO)
+            return false;
+        if (v == VARS) {
+            out = 0;
+            return true;
+        }
+
+        unsigned shift = VARS - v - 1;
+        uint64_t bit = static_cast<uint64_t>(1) << shift;
+        auto c = cofactors(r, v);
+        uint64_t rest;
+        if (!(from & bit)) {
+            if (findFrom(c.first, v + 1, from & (bit - 1), rest)) {
+                out = rest;
+                return true;
+            }
+            from = 0;
+        } else {
+            from &= bit - 1;
+        }
+
+        if (findFrom(c.second, v + 1, from, rest)) {
+            out = bit | rest;
+            return true;
+        }
+
+        return false;
+    }
+
+    void mark(Ref r, std::vector<bool>& marked) const
+    {
+        if (r <= ONE || marked[r])
+            return;
+
+        marked[r] = true;
+        mark(nodes[r].lo, marked);
+        mark(nodes[r].hi, marked);
+    }
+
+    // free the nodes that are not reachable from any referenced root
+    void collect()
+    {
+        std::vector<bool> marked(nodes.size(), false);
+        for (Ref r = 2; r < nodes.size(); ++r) {
+            if (refs[r] > 0)
+                mark(r, marked);
+        }
+
+        freelist.clear();
+        for (Ref r = 2; r < nodes.size(); ++r) {
+            if (!marked[r]) {
+                if (nodes[r].var != VARS)
+                    unique.erase(nodes[r]);
+                // mark as free
+                nodes[r] = Node{VARS, ZERO, ZERO};
+                freelist.push_back(r);
+            }
+        }
+
+        unionCache.clear();
+        diffCache.clear();
+
+        size_t live = nodes.size() - freelist.size();
+        collectAt = std::max(collectAt, 2 * live);
+    }
+
+    void maybeCollect()
+    {
+        if (freelist.empty() && nodes.size() >= collectAt)
+            collect();
+    }
+
+    template <typename FuncT>
+    auto locked(FuncT f) -> decltype(f())
+    {
+        if (!concurrent)
+            return f();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return f();
+    }
+
+public:
+    BDDManager()
+    {
+        // the terminals, they are never collected
+        nodes.push_back(Node{VARS, ZERO, ZERO});
+        nodes.push_back(Node{VARS, ONE, ONE});
+        refs.resize(2, 1);
+        counts.resize(2, 0);
+    }
+
+    BDDManager(const BDDManager&) = delete;
+    BDDManager& operator=(const BDDManager&) = delete;
+
+    void ref(Ref r)
+    {
+        if (r <= ONE)
+            return;
+
+        locked([&]() { ++refs[r]; ++referenced; });
+    }
+
+    void deref(Ref r)
+    {
+        if (r <= ONE)
+            return;
+
+        locked([&]() {
+            assert(refs[r] > 0 && "Dereferencing unreferenced node");
+            --refs[r];
+            --referenced;
+        });
+    }
+
+    // the set @a with the element @x added
+    Ref insert(Ref a, uint32_t x)
+    {
+        return locked([&]() {
+            maybeCollect();
+            return _unite(a, singleton(x));
+        });
+    }
+
+    // the set @a without the element @x
+    Ref erase(Ref a, uint32_t x)
+    {
+        return locked([&]() {
+            maybeCollect();
+            return _diff(a, singleton(x));
+        });
+    }
+
+    // the union of @a and @b
+    Ref unite(Ref a, Ref b)
+    {
+        return locked([&]() {
+            maybeCollect();
+            return _unite(a, b);
+        });
+    }
+
+    bool contains(Ref a, uint32_t x)
+    {
+        return locked([&]() {
+            Ref r = a;
+            while (var(r) < VARS) {
+                const Node& n = nodes[r];
+                r = ((x >> (VARS - n.var - 1)) & 1) ? n.hi : n.lo;
+            }
+
+            return r == ONE;
+        });
+    }
+
+    uint64_t size(Ref a)
+    {
+        return locked([&]() { return count(a) << var(a); });
+    }
+
+    // the smallest element of @a not smaller than @from
+    bool next(Ref a, uint64_t from, uint32_t& out)
+    {
+        if (from >> VARS)
+            return false;
+
+        return locked([&]() {
+            uint64_t ret;
+            if (!findFrom(a, 0, from, ret))
+                return false;
+
+            out = static_cast<uint32_t>(ret);
+            return true;
+        });
+    }
+
+    // the nodes and the tables of the manager
+    size_t getAllocatedBytes()
+    {
+        return locked([&]() {
+            return nodes.capacity() * (sizeof(Node) + sizeof(uint32_t) + sizeof(uint64_t))
+                   + unique.size() * (sizeof(Node) + sizeof(Ref) + 2 * sizeof(void *))
+                   + (unionCache.size() + diffCache.size())
+                     * (sizeof(uint64_t) + sizeof(Ref) + 2 * sizeof(void *));
+        });
+    }
+
+    // the number of the references of the roots
+    size_t getReferencesNum() const { return referenced; }
+    size_t getNodesNum() const { return nodes.size() - freelist.size(); }
+
+    // must not be called while the manager is used by other threads
+    void setConcurrent(bool c) { concurrent = c; }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_BDD_H_
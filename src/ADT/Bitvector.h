@@ -0,0 +1,166 @@
+#ifndef _DG_ADT_BITVECTOR_H_
+#define _DG_ADT_BITVECTOR_H_
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "ADT/BitvectorOps.h"
+
+namespace dg {
+namespace ADT {
+
+// Dense bit vector of a fixed size. The set operations go over
+// whole 64-bit words with the kernels from BitvectorOps.h.
+// The bits past the size in the last word are always zero,
+// so the words can be compared and counted directly.
+class Bitvector
+{
+    static const size_t WORD_BITS = 64;
+
+    std::vector<uint64_t> words;
+    size_t bits;
+
+    void clearTail()
+    {
+        if (bits % WORD_BITS != 0)
+            words.back() &= (static_cast<uint64_t>(1) << (bits % WORD_BITS)) - 1;
+    }
+
+public:
+    explicit Bitvector(size_t n = 0, bool value = false)
+        : words((n + WORD_BITS - 1) / WORD_BITS, value ? ~static_cast<uint64_t>(0) : 0),
+          bits(n)
+    {
+        clearTail();
+    }
+
+    size_t size() const { return bits; }
+
+    // change the size, the new bits are not set
+    void resize(size_t n)
+    {
+        words.resize((n + WORD_BITS - 1) / WORD_BITS, 0);
+        bits = n;
+        clearTail();
+    }
+
+    bool get(size_t i) const
+    {
+        assert(i < bits && "Bit out of range");
+        return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    void set(size_t i)
+    {
+        assert(i < bits && "Bit out of range");
+        words[i / WORD_BITS] |= static_cast<uint64_t>(1) << (i % WORD_BITS);
+    }
+
+    void reset(size_t i)
+    {
+        assert(i < bits && "Bit out of range");
+        words[i / WORD_BITS] &= ~(static_cast<uint64_t>(1) << (i % WORD_BITS));
+    }
+
+    void setAll()
+    {
+        for (uint64_t& w : words)
+            w = ~static_cast<uint64_t>(0);
+        clearTail();
+    }
+
+    void resetAll()
+    {
+        for (uint64_t& w : words)
+            w = 0;
+    }
+
+    bool any() const
+    {
+        for (uint64_t w : words) {
+            if (w != 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    size_t count() const
+    {
+        size_t n = 0;
+        for (uint64_t w : words)
+            n += __builtin_popcountll(w);
+        return n;
+    }
+
+    // this |= rhs, returns true if this changed
+    bool unionWith(const Bitvector& rhs)
+    {
+        assert(bits == rhs.bits && "Different sizes of bit vectors");
+        return bitops::unionWords(words.data(), rhs.words.data(), words.size());
+    }
+
+    // this &= rhs, returns true if this changed
+    bool intersectWith(const Bitvector& rhs)
+    {
+        assert(bits == rhs.bits && "Different sizes of bit vectors");
+        return bitops::intersectWords(words.data(), rhs.words.data(), words.size());
+    }
+
+    // this &= ~rhs, returns true if this changed
+    bool differenceWith(const Bitvector& rhs)
+    {
+        assert(bits == rhs.bits && "Different sizes of bit vectors");
+        return bitops::differenceWords(words.data(), rhs.words.data(), words.size());
+    }
+
+    // is every bit of this set in @rhs?
+    bool isSubsetOf(const Bitvector& rhs) const
+    {
+        assert(bits == rhs.bits && "Different sizes of bit vectors");
+        return bitops::isSubsetWords(words.data(), rhs.words.data(), words.size());
+    }
+
+    // this = gen | (in & ~kill) (the transfer function of the gen/kill
+    // problems), returns true if this changed
+    bool assignTransfer(const Bitvector& gen, const Bitvector& in,
+                        const Bitvector& kill)
+    {
+        assert(bits == gen.bits && bits == in.bits && bits == kill.bits
+               && "Different sizes of bit vectors");
+        uint64_t changed = 0;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t w = gen.words[i] | (in.words[i] & ~kill.words[i]);
+            changed |= w ^ words[i];
+            words[i] = w;
+        }
+
+        return changed != 0;
+    }
+
+    // call @f on the indices of the set bits in ascending order
+    template <typename FuncT>
+    void forEach(FuncT f) const
+    {
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t w = words[i];
+            while (w != 0) {
+                f(i * WORD_BITS + __builtin_ctzll(w));
+                w &= w - 1;
+            }
+        }
+    }
+
+    bool operator==(const Bitvector& rhs) const
+    {
+        return bits == rhs.bits && words == rhs.words;
+    }
+
+    bool operator!=(const Bitvector& rhs) const { return !(*this == rhs); }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_BITVECTOR_H_
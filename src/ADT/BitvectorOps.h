@@ -0,0 +1,166 @@
+#ifndef _DG_ADT_BITVECTOR_OPS_H_
+#define _DG_ADT_BITVECTOR_OPS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace dg {
+namespace ADT {
+
+///
+// The set operations over arrays of 64-bit words of bit vectors
+// (the dense bit vectors and the chunks of the sparse ones).
+// The words are processed by the vector instructions that the compiler
+// targets (AVX2, SSE2 or NEON, chosen at compile time), the rest
+// of the words and the other targets use the scalar code.
+// The operations that change the words return whether any word changed.
+namespace bitops {
+
+namespace detail {
+
+#if defined(__AVX2__)
+struct Vec {
+    using T = __m256i;
+    static const size_t WORDS = 4;
+
+    static T load(const uint64_t *p) { return _mm256_loadu_si256(reinterpret_cast<const T *>(p)); }
+    static void store(uint64_t *p, T v) { _mm256_storeu_si256(reinterpret_cast<T *>(p), v); }
+    static T zero() { return _mm256_setzero_si256(); }
+    static T Or(T a, T b) { return _mm256_or_si256(a, b); }
+    static T And(T a, T b) { return _mm256_and_si256(a, b); }
+    static T Xor(T a, T b) { return _mm256_xor_si256(a, b); }
+    // a & ~b
+    static T AndNot(T a, T b) { return _mm256_andnot_si256(b, a); }
+    static bool isZero(T a) { return _mm256_testz_si256(a, a); }
+};
+#elif defined(__SSE2__)
+struct Vec {
+    using T = __m128i;
+    static const size_t WORDS = 2;
+
+    static T load(const uint64_t *p) { return _mm_loadu_si128(reinterpret_cast<const T *>(p)); }
+    static void store(uint64_t *p, T v) { _mm_storeu_si128(reinterpret_cast<T *>(p), v); }
+    static T zero() { return _mm_setzero_si128(); }
+    static T Or(T a, T b) { return _mm_or_si128(a, b); }
+    static T And(T a, T b) { return _mm_and_si128(a, b); }
+    static T Xor(T a, T b) { return _mm_xor_si128(a, b); }
+    static T AndNot(T a, T b) { return _mm_andnot_si128(b, a); }
+    static bool isZero(T a)
+    {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) == 0xffff;
+    }
+};
+#elif defined(__ARM_NEON)
+struct Vec {
+    using T = uint64x2_t;
+    static const size_t WORDS = 2;
+
+    static T load(const uint64_t *p) { return vld1q_u64(p); }
+    static void store(uint64_t *p, T v) { vst1q_u64(p, v); }
+    static T zero() { return vdupq_n_u64(0); }
+    static T Or(T a, T b) { return vorrq_u64(a, b); }
+    static T And(T a, T b) { return vandq_u64(a, b); }
+    static T Xor(T a, T b) { return veorq_u64(a, b); }
+    static T AndNot(T a, T b) { return vbicq_u64(a, b); }
+    static bool isZero(T a) { return (vgetq_lane_u64(a, 0) | vgetq_lane_u64(a, 1)) == 0; }
+};
+#else
+struct Vec {
+    using T = uint64_t;
+    static const size_t WORDS = 1;
+
+    static T load(const uint64_t *p) { return *p; }
+    static void store(uint64_t *p, T v) { *p = v; }
+    static T zero() { return 0; }
+    static T Or(T a, T b) { return a | b; }
+    static T And(T a, T b) { return a & b; }
+    static T Xor(T a, T b) { return a ^ b; }
+    static T AndNot(T a, T b) { return a & ~b; }
+    static bool isZero(T a) { return a == 0; }
+};
+#endif
+
+// dst[i] = Op(dst[i], src[i]), returns true if any word changed
+template <typename VecOpT, typename WordOpT>
+inline bool apply(uint64_t *dst, const uint64_t *src, size_t n,
+                  VecOpT vop, WordOpT wop)
+{
+    size_t i = 0;
+    typename Vec::T changed = Vec::zero();
+    for (; i + Vec::WORDS <= n; i += Vec::WORDS) {
+        typename Vec::T d = Vec::load(dst + i);
+        typename Vec::T r = vop(d, Vec::load(src + i));
+        changed = Vec::Or(changed, Vec::Xor(r, d));
+        Vec::store(dst + i, r);
+    }
+
+    uint64_t rest = 0;
+    for (; i < n; ++i) {
+        uint64_t r = wop(dst[i], src[i]);
+        rest |= r ^ dst[i];
+        dst[i] = r;
+    }
+
+    return rest != 0 || !Vec::isZero(changed);
+}
+
+} // namespace detail
+
+// dst |= src
+inline bool unionWords(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    using detail::Vec;
+    return detail::apply(dst, src, n,
+                         [](Vec::T a, Vec::T b) { return Vec::Or(a, b); },
+                         [](uint64_t a, uint64_t b) { return a | b; });
+}
+
+// dst &= src
+inline bool intersectWords(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    using detail::Vec;
+    return detail::apply(dst, src, n,
+                         [](Vec::T a, Vec::T b) { return Vec::And(a, b); },
+                         [](uint64_t a, uint64_t b) { return a & b; });
+}
+
+// dst &= ~src
+inline bool differenceWords(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    using detail::Vec;
+    return detail::apply(dst, src, n,
+                         [](Vec::T a, Vec::T b) { return Vec::AndNot(a, b); },
+                         [](uint64_t a, uint64_t b) { return a & ~b; });
+}
+
+// is every bit of @a set in @b?
+inline bool isSubsetWords(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    using detail::Vec;
+    size_t i = 0;
+    for (; i + Vec::WORDS <= n; i += Vec::WORDS) {
+        if (!Vec::isZero(Vec::AndNot(Vec::load(a + i), Vec::load(b + i))))
+            return false;
+    }
+
+    for (; i < n; ++i) {
+        if (a[i] & ~b[i])
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace bitops
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_BITVECTOR_OPS_H_
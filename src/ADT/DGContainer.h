@@ -1,110 +1,344 @@
 #ifndef _DG_CONTAINER_H_
 #define _DG_CONTAINER_H_
 
-#include <set>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
 #include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "ADT/TaggedAllocator.h"
 
 namespace dg {
 
+// Orders the pointers to nodes by the ids of the nodes (getID()).
+// The ids are given in the order in which the nodes are created,
+// so the containers ordered this way are iterated in the same order
+// in every run, unlike the containers ordered by the addresses
+// of the nodes
+struct NodeIDLess
+{
+    template <typename T>
+    bool operator()(const T *a, const T *b) const
+    {
+        return a->getID() < b->getID();
+    }
+};
+
 /// ------------------------------------------------------------------
 // - DGContainer
 //
 //   This is basically just a wrapper for real container, so that
 //   we have the container defined on one place for all edges.
 //   It may have more implementations depending on available features
+//
+//   The elements are kept in an array sorted by CompareT, so the container
+//   is iterated in the same order as std::set. Up to EXPECTED_ELEMENTS_NUM
+//   elements are stored inline, only bigger containers allocate memory.
+//   Most of the nodes have just a few edges, so this saves
+//   the allocation of a tree node for every edge.
+//
+//   The memory is counted to ADT::AllocTag::DG_EDGES (see AllocationStats).
+//
+//   NOTE: unlike with std::set, inserting or erasing an element
+//   invalidates the iterators to the container
 /// ------------------------------------------------------------------
-template <typename ValueT, unsigned int EXPECTED_ELEMENTS_NUM = 8>
+template <typename ValueT, unsigned int EXPECTED_ELEMENTS_NUM = 8,
+          typename CompareT = std::less<ValueT>>
 class DGContainer
 {
+    static_assert(EXPECTED_ELEMENTS_NUM > 0, "Need space for an element");
+    // we move the elements with memmove
+    static_assert(std::is_trivially_copyable<ValueT>::value,
+                  "DGContainer can store only trivially copyable values");
+
+    static const uint32_t SMALL_SIZE = EXPECTED_ELEMENTS_NUM;
+
+    union {
+        // the elements when capacity > SMALL_SIZE
+        ValueT *heap;
+        alignas(ValueT) char small[SMALL_SIZE * sizeof(ValueT)];
+    };
+
+    uint32_t num;
+    uint32_t capacity;
+
+    bool isSmall() const { return capacity == SMALL_SIZE; }
+
+    ValueT *data()
+    {
+        return isSmall() ? reinterpret_cast<ValueT *>(small) : heap;
+    }
+
+    const ValueT *data() const
+    {
+        return isSmall() ? reinterpret_cast<const ValueT *>(small) : heap;
+    }
+
+    void reserve(uint32_t n)
+    {
+        if (n <= capacity)
+            return;
+
+        uint32_t newcap = std::max(n, 2 * capacity);
+        ValueT *mem = static_cast<ValueT *>(
+            ADT::taggedAllocate(ADT::AllocTag::DG_EDGES, newcap * sizeof(ValueT)));
+        std::memcpy(mem, data(), num * sizeof(ValueT));
+
+        release();
+        heap = mem;
+        capacity = newcap;
+    }
+
+    // free the memory, the elements are lost
+    void release()
+    {
+        if (!isSmall())
+            ADT::taggedDeallocate(ADT::AllocTag::DG_EDGES, heap,
+                                  capacity * sizeof(ValueT));
+
+        capacity = SMALL_SIZE;
+    }
+
+    void assign(const DGContainer& oth)
+    {
+        num = 0;
+        reserve(oth.num);
+        std::memcpy(data(), oth.data(), oth.num * sizeof(ValueT));
+        num = oth.num;
+    }
+
+    // take the elements from @oth, this container must be small
+    void steal(DGContainer& oth)
+    {
+        assert(isSmall());
+        if (oth.isSmall()) {
+            std::memcpy(small, oth.small, oth.num * sizeof(ValueT));
+        } else {
+            heap = oth.heap;
+            capacity = oth.capacity;
+            oth.capacity = SMALL_SIZE;
+        }
+
+        num = oth.num;
+        oth.num = 0;
+    }
+
 public:
-    // XXX use llvm ADTs when available, or BDDs?
-    using ContainerT = typename std::set<ValueT>;
-    using iterator = typename ContainerT::iterator;
-    using const_iterator = typename ContainerT::const_iterator;
-    using size_type = typename ContainerT::size_type;
+    // the elements must not be changed, that would break the order
+    using iterator = const ValueT *;
+    using const_iterator = const ValueT *;
+    using size_type = size_t;
+
+    DGContainer() : num(0), capacity(SMALL_SIZE) {}
+
+    DGContainer(const DGContainer& oth)
+    : num(0), capacity(SMALL_SIZE)
+    {
+        assign(oth);
+    }
+
+    DGContainer(DGContainer&& oth)
+    : num(0), capacity(SMALL_SIZE)
+    {
+        steal(oth);
+    }
+
+    DGContainer&
+    operator=(const DGContainer& oth)
+    {
+        if (this != &oth)
+            assign(oth);
+
+        return *this;
+    }
+
+    DGContainer&
+    operator=(DGContainer&& oth)
+    {
+        if (this != &oth) {
+            release();
+            steal(oth);
+        }
 
-    iterator begin() { return container.begin(); }
-    const_iterator begin() const { return container.begin(); }
-    iterator end() { return container.end(); }
-    const_iterator end() const { return container.end(); }
+        return *this;
+    }
+
+    ~DGContainer() { release(); }
+
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + num; }
 
     size_type size() const
     {
-        return container.size();
+        return num;
     }
 
     bool insert(ValueT n)
     {
-        return container.insert(n).second;
+        const ValueT *B = data();
+        const ValueT *I = std::lower_bound(B, B + num, n, CompareT());
+        if (I != B + num && !CompareT()(n, *I))
+            return false;
+
+        uint32_t pos = I - B;
+        reserve(num + 1);
+
+        ValueT *D = data();
+        std::memmove(D + pos + 1, D + pos, (num - pos) * sizeof(ValueT));
+        new (D + pos) ValueT(n);
+        ++num;
+
+        return true;
+    }
+
+    // insert the sorted range of unique elements [@first, @last)
+    // in one pass, returns the number of inserted elements
+    template <typename IterT>
+    size_t insert(IterT first, IterT last)
+    {
+        assert(std::is_sorted(first, last, CompareT()));
+
+        // count the new elements, so that we move
+        // every element of the container only once
+        uint32_t added = 0;
+        const ValueT *B = data(), *E = B + num;
+        const ValueT *I = B;
+        CompareT less;
+        for (IterT it = first; it != last; ++it) {
+            I = std::lower_bound(I, E, *it, less);
+            if (I == E || less(*it, *I))
+                ++added;
+        }
+
+        if (added == 0)
+            return 0;
+
+        reserve(num + added);
+
+        // merge from the back, the elements are moved
+        // to the space after the old elements
+        ValueT *D = data();
+        ValueT *out = D + num + added;
+        ValueT *cur = D + num;
+        IterT it = last;
+        while (it != first) {
+            IterT prev = it;
+            --prev;
+            if (cur != D && less(*prev, *(cur - 1))) {
+                *--out = *--cur;
+            } else {
+                if (cur == D || less(*(cur - 1), *prev))
+                    *--out = *prev;
+                it = prev;
+            }
+        }
+
+        num += added;
+        return added;
     }
 
     bool contains(ValueT n) const
     {
-        return container.count(n) != 0;
+        return std::binary_search(begin(), end(), n, CompareT());
     }
 
     size_t erase(ValueT n)
     {
-        return container.erase(n);
+        ValueT *D = data();
+        ValueT *I = std::lower_bound(D, D + num, n, CompareT());
+        if (I == D + num || CompareT()(n, *I))
+            return 0;
+
+        std::memmove(I, I + 1, (D + num - I - 1) * sizeof(ValueT));
+        --num;
+
+        return 1;
+    }
+
+    // erase all the elements for which @pred returns true
+    // in one pass, returns the number of erased elements
+    template <typename PredT>
+    size_t eraseIf(PredT pred)
+    {
+        ValueT *D = data();
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < num; ++i) {
+            if (!pred(D[i]))
+                D[kept++] = D[i];
+        }
+
+        size_t erased = num - kept;
+        num = kept;
+        return erased;
     }
 
     void clear()
     {
-        container.clear();
+        release();
+        num = 0;
+    }
+
+    bool empty() const
+    {
+        return num == 0;
     }
 
-    bool empty()
+    // the memory allocated for the elements that are not inline
+    size_t getAllocatedBytes() const
     {
-        return container.empty();
+        return isSmall() ? 0 : capacity * sizeof(ValueT);
     }
 
-    void swap(DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth)
+    void swap(DGContainer& oth)
     {
-        container.swap(oth.container);
+        DGContainer tmp(std::move(oth));
+        oth = std::move(*this);
+        *this = std::move(tmp);
     }
 
-    void intersect(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth)
+    void intersect(const DGContainer& oth)
     {
-        DGContainer<ValueT, EXPECTED_ELEMENTS_NUM> tmp;
+        // both arrays are sorted, so we can filter
+        // the elements in place
+        ValueT *D = data();
+        const ValueT *O = oth.begin(), *OE = oth.end();
+        uint32_t kept = 0;
 
-        std::set_intersection(container.begin(), container.end(),
-                              oth.container.begin(),
-                              oth.container.end(),
-                              std::inserter(tmp.container,
-                                            tmp.container.begin()));
+        CompareT less;
+        for (uint32_t i = 0; i < num && O != OE; ++i) {
+            while (O != OE && less(*O, D[i]))
+                ++O;
 
-        // swap containers
-        container.swap(tmp.container);
+            if (O != OE && !less(D[i], *O))
+                D[kept++] = D[i];
+        }
+
+        num = kept;
     }
 
-    bool operator==(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth) const
+    bool operator==(const DGContainer& oth) const
     {
-        if (container.size() != oth.size())
+        if (size() != oth.size())
             return false;
 
-        // the sets are ordered, so this will work
-        iterator snd = oth.container.begin();
-        for (iterator fst = container.begin(), efst = container.end();
-             fst != efst; ++fst, ++snd)
-            if (*fst != *snd)
-                return false;
-
-        return true;
+        // the arrays are ordered, so this will work
+        return std::equal(begin(), end(), oth.begin());
     }
 
-    bool operator!=(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth) const
+    bool operator!=(const DGContainer& oth) const
     {
         return !operator==(oth);
     }
-
-private:
-    ContainerT container;
 };
 
 // Edges are pointers to other nodes
-template <typename NodeT, unsigned int EXPECTED_EDGES_NUM = 4>
-class EdgesContainer : public DGContainer<NodeT *, EXPECTED_EDGES_NUM>
+template <typename NodeT, unsigned int EXPECTED_EDGES_NUM = 4,
+          typename CompareT = std::less<NodeT *>>
+class EdgesContainer : public DGContainer<NodeT *, EXPECTED_EDGES_NUM, CompareT>
 {
 };
 
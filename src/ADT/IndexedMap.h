@@ -0,0 +1,175 @@
+#ifndef _DG_ADT_INDEXED_MAP_H_
+#define _DG_ADT_INDEXED_MAP_H_
+
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dg {
+namespace ADT {
+
+// Map with the interface of std::map (the part that we use) that keeps
+// the elements in a vector in the order of insertion and finds them
+// using a hash table of indices. So the look-ups are O(1) and the
+// iteration goes over contiguous memory.
+//
+// Erasing an element only marks its slot as erased (the slots are
+// never moved), so erasing elements while iterating over the map
+// is fine, which is what the slicer does. An iterator does not go
+// past the elements that were in the map when it was created,
+// so the elements inserted during iteration are not visited.
+template <typename KeyT, typename ValueT>
+class IndexedMap
+{
+public:
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = std::pair<const KeyT, ValueT>;
+    using size_type = size_t;
+
+private:
+    std::vector<value_type> entries;
+    // is the slot in entries[] erased?
+    std::vector<bool> erased;
+    std::unordered_map<KeyT, size_t> index;
+
+    template <typename MapT, typename ValT>
+    class iterator_base
+    {
+        MapT *map;
+        size_t pos;
+        // the number of slots when the iterator was created
+        size_t limit;
+
+        void skipErased()
+        {
+            while (pos < limit && map->erased[pos])
+                ++pos;
+        }
+
+        friend class IndexedMap;
+
+    public:
+        iterator_base(MapT *m = nullptr, size_t p = 0)
+        : map(m), pos(p), limit(m ? m->entries.size() : 0)
+        {
+            if (map)
+                skipErased();
+        }
+
+        // iterator to const_iterator
+        template <typename OthMapT, typename OthValT>
+        iterator_base(const iterator_base<OthMapT, OthValT>& oth)
+        : map(oth.map), pos(oth.pos), limit(oth.limit) {}
+
+        ValT& operator*() const { return map->entries[pos]; }
+        ValT *operator->() const { return &map->entries[pos]; }
+
+        iterator_base& operator++()
+        {
+            ++pos;
+            skipErased();
+            return *this;
+        }
+
+        iterator_base operator++(int)
+        {
+            iterator_base tmp = *this;
+            operator++();
+            return tmp;
+        }
+
+        bool operator==(const iterator_base& oth) const
+        {
+            return pos == oth.pos;
+        }
+
+        bool operator!=(const iterator_base& oth) const
+        {
+            return !operator==(oth);
+        }
+
+        template <typename, typename> friend class iterator_base;
+    };
+
+public:
+    using iterator = iterator_base<IndexedMap, value_type>;
+    using const_iterator = iterator_base<const IndexedMap, const value_type>;
+
+    iterator begin() { return iterator(this, 0); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    iterator end() { return iterator(this, entries.size()); }
+    const_iterator end() const { return const_iterator(this, entries.size()); }
+
+    size_type size() const { return index.size(); }
+    bool empty() const { return index.empty(); }
+
+    iterator find(const KeyT& k)
+    {
+        auto it = index.find(k);
+        return it == index.end() ? end() : iterator(this, it->second);
+    }
+
+    const_iterator find(const KeyT& k) const
+    {
+        auto it = index.find(k);
+        return it == index.end() ? end() : const_iterator(this, it->second);
+    }
+
+    size_type count(const KeyT& k) const
+    {
+        return index.count(k);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& val)
+    {
+        return emplace(val.first, val.second);
+    }
+
+    std::pair<iterator, bool> emplace(const KeyT& k, const ValueT& v)
+    {
+        auto ret = index.emplace(k, entries.size());
+        if (!ret.second)
+            return std::make_pair(iterator(this, ret.first->second), false);
+
+        entries.emplace_back(k, v);
+        erased.push_back(false);
+        return std::make_pair(iterator(this, entries.size() - 1), true);
+    }
+
+    ValueT& operator[](const KeyT& k)
+    {
+        return emplace(k, ValueT()).first->second;
+    }
+
+    size_type erase(const KeyT& k)
+    {
+        auto it = index.find(k);
+        if (it == index.end())
+            return 0;
+
+        erased[it->second] = true;
+        index.erase(it);
+        return 1;
+    }
+
+    iterator erase(iterator it)
+    {
+        assert(it.map == this && !erased[it.pos]);
+        erase(entries[it.pos].first);
+        return ++it;
+    }
+
+    void clear()
+    {
+        entries.clear();
+        erased.clear();
+        index.clear();
+    }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_INDEXED_MAP_H_
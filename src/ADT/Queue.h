@@ -1,9 +1,12 @@
 #ifndef _DG_ADT_QUEUE_H_
 #define _DG_ADT_QUEUE_H_
 
+#include <cassert>
+#include <cstdint>
 #include <stack>
 #include <queue>
 #include <set>
+#include <vector>
 
 namespace dg {
 namespace ADT {
@@ -121,6 +124,88 @@ private:
     std::set<ValueT, Comp> Container;
 };
 
+// the priority of an integer is the integer itself
+struct IdentityPriority {
+    template <typename T>
+    size_t operator()(T val) const { return static_cast<size_t>(val); }
+};
+
+///
+// Worklist of a fixpoint computation: the elements have dense unique
+// priorities (e.g. the positions of the nodes in reverse postorder),
+// pop() returns the element with the lowest priority and pushing
+// an element that is already queued does nothing.
+// The queued priorities are kept in a bitset and the elements in a vector
+// indexed by the priority, so push() is O(1) and pop() only skips
+// the empty words of the bitset from the lowest queued priority.
+// @PriorityF maps an element to its priority.
+template <typename ValueT, typename PriorityF = IdentityPriority>
+class PriorityWorklist
+{
+    static const size_t WORD_BITS = 64;
+
+    std::vector<uint64_t> bits;
+    std::vector<ValueT> elements;
+    // no bit is set in the words before this one
+    size_t first_word = 0;
+    size_t count = 0;
+    PriorityF priority;
+
+public:
+    // @n is the expected number of priorities (the worklist grows on demand)
+    PriorityWorklist(size_t n = 0, PriorityF prio = PriorityF())
+        : bits((n + WORD_BITS - 1) / WORD_BITS), elements(n), priority(prio) {}
+
+    // queue the element, returns false if it was queued already
+    bool push(const ValueT& what)
+    {
+        size_t prio = priority(what);
+        size_t word = prio / WORD_BITS;
+        uint64_t mask = static_cast<uint64_t>(1) << (prio % WORD_BITS);
+
+        if (word >= bits.size())
+            bits.resize(word + 1);
+        if (prio >= elements.size())
+            elements.resize(prio + 1);
+
+        if (bits[word] & mask)
+            return false;
+
+        bits[word] |= mask;
+        elements[prio] = what;
+        if (word < first_word)
+            first_word = word;
+        ++count;
+        return true;
+    }
+
+    // remove and return the element with the lowest priority
+    ValueT pop()
+    {
+        assert(!empty() && "Pop from an empty worklist");
+        while (bits[first_word] == 0)
+            ++first_word;
+
+        uint64_t& w = bits[first_word];
+        size_t prio = first_word * WORD_BITS + __builtin_ctzll(w);
+        // clear the lowest set bit
+        w &= w - 1;
+        --count;
+
+        return elements[prio];
+    }
+
+    bool contains(const ValueT& what) const
+    {
+        size_t prio = priority(what);
+        return prio / WORD_BITS < bits.size()
+                && (bits[prio / WORD_BITS] >> (prio % WORD_BITS)) & 1;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+};
+
 } // namespace ADT
 } // namespace dg
 
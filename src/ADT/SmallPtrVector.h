@@ -0,0 +1,211 @@
+#ifndef _DG_ADT_SMALL_PTR_VECTOR_H_
+#define _DG_ADT_SMALL_PTR_VECTOR_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace dg {
+namespace ADT {
+
+// A read-only view of a contiguous array of elements
+// (a part of std::vector or of SmallPtrVector)
+template <typename T>
+class ArrayView
+{
+    const T *b = nullptr, *e = nullptr;
+
+public:
+    ArrayView() = default;
+    ArrayView(const T *b, const T *e) : b(b), e(e) {}
+    ArrayView(const std::vector<T>& v) : b(v.data()), e(v.data() + v.size()) {}
+
+    const T *begin() const { return b; }
+    const T *end() const { return e; }
+    size_t size() const { return e - b; }
+    bool empty() const { return b == e; }
+
+    const T& operator[](size_t i) const
+    {
+        assert(i < size() && "Index out of range");
+        return b[i];
+    }
+};
+
+// A vector of pointers that keeps up to N elements inline (in place
+// of the pointer to the heap memory), so the short vectors need no
+// allocation. It has the same size as std::vector with N = 2.
+// The elements are moved by memcpy, so the vector is meant
+// for pointers and similar trivial types
+template <typename T, unsigned N = 2>
+class SmallPtrVector
+{
+    static_assert(std::is_pointer<T>::value || std::is_integral<T>::value,
+                  "SmallPtrVector keeps only trivial types");
+
+    uint32_t sz = 0;
+    uint32_t cap = N;
+    union {
+        T *heap;
+        T inl[N];
+    };
+
+    bool isSmall() const { return cap == N; }
+
+    void grow(size_t n)
+    {
+        size_t newcap = cap * 2;
+        if (newcap < n)
+            newcap = n;
+
+        T *mem = new T[newcap];
+        std::memcpy(mem, data(), sz * sizeof(T));
+        if (!isSmall())
+            delete[] heap;
+
+        heap = mem;
+        cap = static_cast<uint32_t>(newcap);
+    }
+
+    void release()
+    {
+        if (!isSmall())
+            delete[] heap;
+        sz = 0;
+        cap = N;
+    }
+
+    void copyFrom(const SmallPtrVector& oth)
+    {
+        reserve(oth.sz);
+        std::copy(oth.begin(), oth.end(), data());
+        sz = oth.sz;
+    }
+
+    // take the memory of @oth, @oth is empty then
+    void moveFrom(SmallPtrVector& oth)
+    {
+        if (oth.isSmall()) {
+            // the short vector has at most N elements, copy only those
+            assert(oth.sz <= N && "Too many elements in place");
+            std::copy(oth.inl, oth.inl + std::min<uint32_t>(oth.sz, N), inl);
+        } else {
+            heap = oth.heap;
+            cap = oth.cap;
+        }
+
+        sz = oth.sz;
+        oth.sz = 0;
+        oth.cap = N;
+    }
+
+public:
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    SmallPtrVector() {}
+    SmallPtrVector(const SmallPtrVector& oth) { copyFrom(oth); }
+    SmallPtrVector(SmallPtrVector&& oth) { moveFrom(oth); }
+    ~SmallPtrVector() { release(); }
+
+    SmallPtrVector& operator=(const SmallPtrVector& oth)
+    {
+        if (this != &oth) {
+            sz = 0;
+            copyFrom(oth);
+        }
+        return *this;
+    }
+
+    SmallPtrVector& operator=(SmallPtrVector&& oth)
+    {
+        if (this != &oth) {
+            release();
+            moveFrom(oth);
+        }
+        return *this;
+    }
+
+    T *data() { return isSmall() ? inl : heap; }
+    const T *data() const { return isSmall() ? inl : heap; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + sz; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + sz; }
+
+    size_t size() const { return sz; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return sz == 0; }
+
+    // the memory allocated on the heap (none for the short vectors)
+    size_t getAllocatedBytes() const { return isSmall() ? 0 : cap * sizeof(T); }
+
+    T& operator[](size_t i)
+    {
+        assert(i < sz && "Index out of range");
+        return data()[i];
+    }
+
+    const T& operator[](size_t i) const
+    {
+        assert(i < sz && "Index out of range");
+        return data()[i];
+    }
+
+    T& front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T& back() { return (*this)[sz - 1]; }
+    const T& back() const { return (*this)[sz - 1]; }
+
+    void reserve(size_t n)
+    {
+        if (n > cap)
+            grow(n);
+    }
+
+    void push_back(T val)
+    {
+        if (sz == cap)
+            grow(sz + 1);
+        data()[sz++] = val;
+    }
+
+    void pop_back()
+    {
+        assert(sz > 0 && "Popping from an empty vector");
+        --sz;
+    }
+
+    // keeps the memory
+    void clear() { sz = 0; }
+
+    iterator erase(iterator first, iterator last)
+    {
+        assert(begin() <= first && first <= last && last <= end());
+        std::memmove(first, last, (end() - last) * sizeof(T));
+        sz -= static_cast<uint32_t>(last - first);
+        return first;
+    }
+
+    iterator erase(iterator pos) { return erase(pos, pos + 1); }
+
+    void swap(SmallPtrVector& oth)
+    {
+        SmallPtrVector tmp(std::move(oth));
+        oth = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    operator ArrayView<T>() const { return ArrayView<T>(begin(), end()); }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_SMALL_PTR_VECTOR_H_
@@ -0,0 +1,196 @@
+#ifndef _DG_ADT_TAGGED_ALLOCATOR_H_
+#define _DG_ADT_TAGGED_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace dg {
+namespace ADT {
+
+///
+// The subsystems whose allocations are counted separately
+// (see AllocationStats), so that we know which structures
+// are worth making smaller
+enum class AllocTag : unsigned {
+    // the edges of the dependence graph and its blocks (DGContainer)
+    DG_EDGES,
+    BBLOCKS,
+    // the formal and actual parameters of the dependence graph
+    PARAMETERS,
+    // the points-to sets of the pointer analysis
+    PTA_SETS,
+    MEMORY_OBJECTS,
+    // the maps of reaching definitions
+    RD_MAPS,
+    // the other objects allocated in arenas
+    OTHER,
+    TAGS_NUM
+};
+
+///
+// The numbers of the allocations of the tagged allocators. The counting
+// is switched on at run time by enable() and it can be compiled out
+// completely with -DNO_ALLOCATION_STATS. The counters are global
+// and updated atomically, so the allocators can be used from more threads
+class AllocationStats
+{
+public:
+    struct Counters {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> frees{0};
+        // bytes allocated in total
+        std::atomic<uint64_t> bytes{0};
+        // bytes allocated and not freed yet and the peak of it
+        std::atomic<uint64_t> live{0};
+        std::atomic<uint64_t> peak{0};
+    };
+
+private:
+    struct State {
+        std::atomic<bool> enabled{false};
+        Counters counters[static_cast<unsigned>(AllocTag::TAGS_NUM)];
+    };
+
+    static State& state()
+    {
+        static State st;
+        return st;
+    }
+
+public:
+    static void enable(bool e = true)
+    {
+        state().enabled.store(e, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled()
+    {
+#ifdef NO_ALLOCATION_STATS
+        return false;
+#else
+        return state().enabled.load(std::memory_order_relaxed);
+#endif
+    }
+
+    static const Counters& get(AllocTag tag)
+    {
+        return state().counters[static_cast<unsigned>(tag)];
+    }
+
+    static void allocated(AllocTag tag, size_t bytes)
+    {
+        if (!isEnabled())
+            return;
+
+        Counters& c = state().counters[static_cast<unsigned>(tag)];
+        ++c.allocations;
+        c.bytes += bytes;
+        uint64_t live = (c.live += bytes);
+        uint64_t peak = c.peak.load(std::memory_order_relaxed);
+        while (live > peak && !c.peak.compare_exchange_weak(peak, live)) {}
+    }
+
+    // the memory that was allocated before the counting was
+    // switched on is counted as freed too, so the live bytes
+    // are only approximate then
+    static void freed(AllocTag tag, size_t bytes)
+    {
+        if (!isEnabled())
+            return;
+
+        Counters& c = state().counters[static_cast<unsigned>(tag)];
+        ++c.frees;
+        uint64_t live = c.live.load(std::memory_order_relaxed);
+        while (!c.live.compare_exchange_weak(live, live > bytes ? live - bytes : 0)) {}
+    }
+
+    static void reset()
+    {
+        for (Counters& c : state().counters) {
+            c.allocations = c.frees = c.bytes = c.live = c.peak = 0;
+        }
+    }
+
+    static const char *getName(AllocTag tag)
+    {
+        switch (tag) {
+            case AllocTag::DG_EDGES: return "dg edges";
+            case AllocTag::BBLOCKS: return "bblocks";
+            case AllocTag::PARAMETERS: return "parameters";
+            case AllocTag::PTA_SETS: return "points-to sets";
+            case AllocTag::MEMORY_OBJECTS: return "memory objects";
+            case AllocTag::RD_MAPS: return "rd maps";
+            case AllocTag::OTHER: return "other";
+            default: return "unknown";
+        }
+    }
+};
+
+// the raw memory of @bytes bytes counted to @tag
+inline void *taggedAllocate(AllocTag tag, size_t bytes)
+{
+    void *mem = ::operator new(bytes);
+    AllocationStats::allocated(tag, bytes);
+    return mem;
+}
+
+inline void taggedDeallocate(AllocTag tag, void *mem, size_t bytes)
+{
+    AllocationStats::freed(tag, bytes);
+    ::operator delete(mem);
+}
+
+///
+// The allocator of the standard containers that counts
+// the allocations of the container to @TAG
+template <typename T, AllocTag TAG>
+struct TaggedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = TaggedAllocator<U, TAG>; };
+
+    TaggedAllocator() = default;
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U, TAG>&) {}
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(taggedAllocate(TAG, n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        taggedDeallocate(TAG, p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const TaggedAllocator<U, TAG>&) const { return true; }
+    template <typename U>
+    bool operator!=(const TaggedAllocator<U, TAG>&) const { return false; }
+};
+
+///
+// A base of the classes whose objects are counted to @TAG
+// when they are allocated by new
+template <AllocTag TAG>
+struct TaggedObject
+{
+    static void *operator new(size_t bytes)
+    {
+        return taggedAllocate(TAG, bytes);
+    }
+
+    static void operator delete(void *mem, size_t bytes)
+    {
+        taggedDeallocate(TAG, mem, bytes);
+    }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_TAGGED_ALLOCATOR_H_
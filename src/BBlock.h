@@ -4,9 +4,14 @@
 #ifndef _BBLOCK_H_
 #define _BBLOCK_H_
 
+#include <algorithm>
 #include <cassert>
-#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "ADT/Arena.h"
 #include "ADT/DGContainer.h"
 #include "analysis/Analysis.h"
 
@@ -69,6 +74,24 @@ public:
         }
     }
 
+    // the blocks are allocated from a pool that releases
+    // all its memory when the last block is deleted
+    static void *operator new(size_t size)
+    {
+        assert(size == sizeof(BBlock<NodeT>));
+        (void) size;
+        return getPool().allocate();
+    }
+
+    static void operator delete(void *mem)
+    {
+        if (mem)
+            getPool().deallocate(mem);
+    }
+
+    // blocks are going to be created from more threads at once
+    static void setConcurrent(bool c) { getPool().setConcurrent(c); }
+
     using BBlockContainerT = EdgesContainer<BBlock<NodeT>>;
     // we don't need labels with predecessors
     using PredContainerT = EdgesContainer<BBlock<NodeT>>;
@@ -94,11 +117,23 @@ public:
     void setDG(DependenceGraphT *d) { dg = d; }
     DependenceGraphT *getDG() const { return dg; }
 
-    const std::list<NodeT *>& getNodes() const { return nodes; }
-    std::list<NodeT *>& getNodes() { return nodes; }
+    const std::vector<NodeT *>& getNodes() const { return nodes; }
+    std::vector<NodeT *>& getNodes() { return nodes; }
     bool empty() const { return nodes.empty(); }
     size_t size() const { return nodes.size(); }
 
+    // the memory allocated by the containers of the block
+    // (the nodes themselves are not counted)
+    size_t getAllocatedBytes() const
+    {
+        return nodes.capacity() * sizeof(NodeT *)
+               + nextBBs.getAllocatedBytes() + prevBBs.getAllocatedBytes()
+               + controlDeps.getAllocatedBytes()
+               + revControlDeps.getAllocatedBytes()
+               + postDomFrontiers.getAllocatedBytes()
+               + postDominators.getAllocatedBytes();
+    }
+
     void append(NodeT *n)
     {
         assert(n && "Cannot add null node to BBlock");
@@ -112,7 +147,7 @@ public:
         assert(n && "Cannot add null node to BBlock");
 
         n->setBasicBlock(this);
-        nodes.push_front(n);
+        nodes.insert(nodes.begin(), n);
     }
 
     bool hasControlDependence() const
@@ -153,9 +188,9 @@ public:
             // and create new edges to all successors. The new edges
             // will have the same label as the found one
             DGContainer<BBlockEdge> new_edges;
-            for (auto I = pred->nextBBs.begin(),E = pred->nextBBs.end(); I != E;) {
-                auto cur = I++;
-                if (cur->target == this) {
+            DGContainer<BBlockEdge> old_edges;
+            for (const BBlockEdge& edge : pred->nextBBs) {
+                if (edge.target == this) {
                     // create edges that will go from the predecessor
                     // to every successor of this node
                     for (const BBlockEdge& succ : nextBBs) {
@@ -163,14 +198,18 @@ public:
                         // that would be incorrect. It can occur when we're isolatin a bblock
                         // with self-loop
                         if (succ.target != this)
-                            new_edges.insert(BBlockEdge(succ.target, cur->label));
+                            new_edges.insert(BBlockEdge(succ.target, edge.label));
                     }
 
-                    // remove the edge from predecessor
-                    pred->nextBBs.erase(*cur);
+                    old_edges.insert(edge);
                 }
             }
 
+            // remove the edges from predecessor, erasing invalidates
+            // the iterators, so we do it after the loop
+            for (const BBlockEdge& edge : old_edges)
+                pred->nextBBs.erase(edge);
+
             // add newly created edges to predecessor
             for (const BBlockEdge& edge : new_edges) {
                 assert(edge.target != this
@@ -241,7 +280,147 @@ public:
         delete this;
     }
 
-    void removeNode(NodeT *n) { nodes.remove(n); }
+    // Remove all the @blocks with their nodes at once. The result is
+    // the same as of calling remove() on every block, but the edges of the
+    // remaining blocks and nodes are rebuilt just once: an edge to
+    // a removed block is replaced by the edges (with the same label)
+    // to all the remaining blocks that are reachable from it through
+    // the removed blocks, and the edges between the removed nodes
+    // are not unlinked one by one at all, the nodes are just deleted
+    static void removeBlocks(const std::vector<BBlock<NodeT> *>& blocks)
+    {
+        std::unordered_set<BBlock<NodeT> *> removed(blocks.begin(), blocks.end());
+        auto isRemoved = [&removed](BBlock<NodeT> *B) {
+            return removed.count(B) > 0;
+        };
+
+        // the remaining blocks that are reachable from a removed
+        // block through the removed blocks only
+        std::unordered_map<BBlock<NodeT> *, std::vector<BBlock<NodeT> *>> exits;
+        auto getExits = [&](BBlock<NodeT> *B) -> const std::vector<BBlock<NodeT> *>& {
+            auto it = exits.find(B);
+            if (it != exits.end())
+                return it->second;
+
+            std::vector<BBlock<NodeT> *>& ret = exits[B];
+            std::unordered_set<BBlock<NodeT> *> visited{B};
+            std::vector<BBlock<NodeT> *> stack{B};
+            while (!stack.empty()) {
+                BBlock<NodeT> *cur = stack.back();
+                stack.pop_back();
+                for (const BBlockEdge& edge : cur->nextBBs) {
+                    if (!visited.insert(edge.target).second)
+                        continue;
+
+                    if (isRemoved(edge.target))
+                        stack.push_back(edge.target);
+                    else
+                        ret.push_back(edge.target);
+                }
+            }
+
+            return ret;
+        };
+
+        // the remaining neighbours of the removed blocks
+        std::unordered_set<BBlock<NodeT> *> preds, succs, cds;
+        for (BBlock<NodeT> *B : blocks) {
+            for (BBlock<NodeT> *P : B->prevBBs) {
+                if (!isRemoved(P))
+                    preds.insert(P);
+            }
+            for (const BBlockEdge& edge : B->nextBBs) {
+                if (!isRemoved(edge.target))
+                    succs.insert(edge.target);
+            }
+            for (BBlock<NodeT> *C : B->controlDeps) {
+                if (!isRemoved(C))
+                    cds.insert(C);
+            }
+            for (BBlock<NodeT> *C : B->revControlDeps) {
+                if (!isRemoved(C))
+                    cds.insert(C);
+            }
+        }
+
+        for (BBlock<NodeT> *P : preds) {
+            SuccContainerT edges;
+            for (const BBlockEdge& edge : P->nextBBs) {
+                if (!isRemoved(edge.target)) {
+                    edges.insert(edge);
+                    continue;
+                }
+
+                for (BBlock<NodeT> *S : getExits(edge.target)) {
+                    edges.insert(BBlockEdge(S, edge.label));
+                    S->prevBBs.insert(P);
+                }
+            }
+
+            P->nextBBs.swap(edges);
+        }
+
+        for (BBlock<NodeT> *S : succs)
+            S->prevBBs.eraseIf(isRemoved);
+
+        for (BBlock<NodeT> *C : cds) {
+            C->controlDeps.eraseIf(isRemoved);
+            C->revControlDeps.eraseIf(isRemoved);
+        }
+
+        // the nodes of the removed blocks are removed too
+        auto nodeRemoved = [&isRemoved](NodeT *n) {
+            return n->getBBlock() && isRemoved(n->getBBlock());
+        };
+
+        std::unordered_set<NodeT *> neighbours;
+        // (all the edge containers have the same iterators)
+        auto addNeighbours = [&](NodeT *const *I, NodeT *const *E) {
+            for (; I != E; ++I) {
+                if (!nodeRemoved(*I))
+                    neighbours.insert(*I);
+            }
+        };
+
+        for (BBlock<NodeT> *B : blocks) {
+            for (NodeT *n : B->nodes) {
+                addNeighbours(n->control_begin(), n->control_end());
+                addNeighbours(n->rev_control_begin(), n->rev_control_end());
+                addNeighbours(n->data_begin(), n->data_end());
+                addNeighbours(n->rev_data_begin(), n->rev_data_end());
+            }
+        }
+
+        for (NodeT *m : neighbours)
+            m->removeEdgesIf(nodeRemoved);
+
+        for (BBlock<NodeT> *B : blocks) {
+            if (B->dg) {
+                bool ret = B->dg->removeBlock(B->key);
+                assert(ret && "BUG: block was not in DG");
+                (void) ret;
+                if (B->dg->getEntryBB() == B)
+                    B->dg->setEntryBB(nullptr);
+            }
+
+            for (NodeT *n : B->nodes) {
+                n->setBasicBlock(nullptr);
+                // the remaining edges go to the removed nodes only,
+                // drop them so that removing the node from the graph
+                // does not unlink them one by one
+                n->removeEdgesIf([](NodeT *) { return true; });
+                n->removeFromDG();
+                delete n;
+            }
+
+            delete B;
+        }
+    }
+
+    void removeNode(NodeT *n)
+    {
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), n), nodes.end());
+    }
 
     size_t successorsNum() const { return nextBBs.size(); }
     size_t predecessorsNum() const { return prevBBs.size(); }
@@ -410,14 +589,24 @@ public:
     }
 
 private:
+    // never destroyed, the blocks may be deleted
+    // during the destruction of static objects
+    static ADT::Pool<BBlock<NodeT>, ADT::AllocTag::BBLOCKS>& getPool()
+    {
+        static auto *pool = new ADT::Pool<BBlock<NodeT>, ADT::AllocTag::BBLOCKS>();
+        return *pool;
+    }
+
     // optional key
     KeyT key;
 
     // reference to dg if needed
     DependenceGraphT *dg;
 
-    // nodes contained in this bblock
-    std::list<NodeT *> nodes;
+    // nodes contained in this bblock. The blocks are mostly built by
+    // appending and the nodes are iterated much more often than removed,
+    // so keep them in a vector rather than in a list
+    std::vector<NodeT *> nodes;
 
     SuccContainerT nextBBs;
     PredContainerT prevBBs;
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <fstream>
 #include <set>
+#include <unordered_set>
+#include <vector>
 
 #include "DependenceGraph.h"
 #include "analysis/DFS.h"
@@ -39,17 +41,36 @@ std::ostream& operator <<(std::ostream& os, const Indent& ind)
     return os;
 }
 
+///
+// Dump the dependence graph to dot. The output is written to the file
+// while the graph is walked. For large graphs, the output can be
+// restricted to the neighborhood of some nodes (setNeighborhood())
+// and to a number of nodes (setNodesBudget()), the edges are printed
+// only between the printed nodes.
 template <typename NodeT>
 class DG2Dot
 {
     std::set<const typename DependenceGraph<NodeT>::ContainerType *> dumpedGlobals;
+
+    // the size of the buffer of the output file
+    static const size_t BUFFER_SIZE = 1 << 20;
+    std::vector<char> buffer;
+
+    // the restriction of the output
+    std::set<NodeT *> centers;
+    unsigned hops = 0;
+    size_t nodes_budget = 0;
+    // the nodes that are printed (if restricted)
+    bool restricted = false;
+    std::unordered_set<NodeT *> selected;
+
 public:
     using KeyT = typename NodeT::KeyType;
 
     DG2Dot<NodeT>(DependenceGraph<NodeT> *dg,
                   uint32_t opts = PRINT_CFG | PRINT_DD | PRINT_CD,
                   const char *file = NULL)
-        : options(opts), dg(dg), file(file)
+        : buffer(BUFFER_SIZE), options(opts), dg(dg), file(file)
     {
         // if a graph has no global nodes, this will forbid trying to print them
         dumpedGlobals.insert(nullptr);
@@ -66,6 +87,17 @@ public:
             reopen(new_file);
     }
 
+    // print only the nodes that are at most @k edges (dependencies
+    // and calls, in both directions) from some of the @nodes
+    void setNeighborhood(const std::set<NodeT *>& nodes, unsigned k)
+    {
+        centers = nodes;
+        hops = k;
+    }
+
+    // print at most @n nodes (0 means no limit)
+    void setNodesBudget(size_t n) { nodes_budget = n; }
+
     virtual std::ostream& printKey(std::ostream& os, KeyT key)
     {
         os << key;
@@ -107,6 +139,13 @@ public:
         if (!ensureFile(new_file))
             return false;
 
+        std::vector<DependenceGraph<NodeT> *> graphs{dg};
+        for (auto I = dg->begin(), E = dg->end(); I != E; ++I) {
+            for (auto sub : I->second->getSubgraphs())
+                graphs.push_back(sub);
+        }
+        selectNodes(graphs);
+
         start();
 
 #ifdef ENABLE_CFG
@@ -124,7 +163,8 @@ public:
         if (!subgraphs.empty())
             out << "\n\t/* ----------- SUBGRAPHS ---------- */\n\n";
         for (auto sub : subgraphs) {
-            dump_subgraph(sub);
+            if (hasSelected(sub))
+                dump_subgraph(sub);
         }
 
 
@@ -204,7 +244,8 @@ public:
 
     void dumpBBlock(BBlock<NodeT> *BB, int ind = 2)
     {
-        dumpBB(BB, ind);
+        if (hasSelected(BB))
+            dumpBB(BB, ind);
     }
 
     void dumpBBlockEdges(BBlock<NodeT> *BB, int ind = 1)
@@ -212,6 +253,93 @@ public:
         dumpBBedges(BB, ind);
     }
 
+protected:
+    // compute the nodes that are printed, @graphs are the graphs
+    // in the order in which they are dumped (the budget takes
+    // the first nodes in this order)
+    void selectNodes(const std::vector<DependenceGraph<NodeT> *>& graphs)
+    {
+        selected.clear();
+        restricted = !centers.empty() || nodes_budget != 0;
+        if (!restricted)
+            return;
+
+        size_t limit = nodes_budget != 0 ? nodes_budget : ~((size_t) 0);
+
+        if (centers.empty()) {
+            for (DependenceGraph<NodeT> *graph : graphs) {
+                for (auto I = graph->begin(), E = graph->end(); I != E; ++I) {
+                    if (selected.size() >= limit)
+                        return;
+                    selected.insert(I->second);
+                }
+            }
+
+            return;
+        }
+
+        // breadth-first search from the centers, one level per hop
+        std::vector<NodeT *> level;
+        for (NodeT *n : centers) {
+            if (selected.size() < limit && selected.insert(n).second)
+                level.push_back(n);
+        }
+
+        auto visit = [&](NodeT *n, std::vector<NodeT *>& next) {
+            if (selected.size() < limit && selected.insert(n).second)
+                next.push_back(n);
+        };
+
+        for (unsigned h = 0; h < hops && !level.empty(); ++h) {
+            std::vector<NodeT *> next;
+            for (NodeT *n : level) {
+                for (auto I = n->data_begin(), E = n->data_end(); I != E; ++I)
+                    visit(*I, next);
+                for (auto I = n->rev_data_begin(), E = n->rev_data_end(); I != E; ++I)
+                    visit(*I, next);
+                for (auto I = n->control_begin(), E = n->control_end(); I != E; ++I)
+                    visit(*I, next);
+                for (auto I = n->rev_control_begin(), E = n->rev_control_end(); I != E; ++I)
+                    visit(*I, next);
+                for (auto sub : n->getSubgraphs())
+                    visit(sub->getEntry(), next);
+            }
+
+            level.swap(next);
+        }
+    }
+
+    bool isSelected(NodeT *n) const
+    {
+        return !restricted || selected.count(n) > 0;
+    }
+
+    bool hasSelected(const BBlock<NodeT> *BB) const
+    {
+        if (!restricted)
+            return true;
+
+        for (NodeT *n : BB->getNodes()) {
+            if (selected.count(n) > 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    bool hasSelected(DependenceGraph<NodeT> *graph) const
+    {
+        if (!restricted)
+            return true;
+
+        for (auto I = graph->begin(), E = graph->end(); I != E; ++I) {
+            if (selected.count(I->second) > 0)
+                return true;
+        }
+
+        return false;
+    }
+
 private:
     // what all to print?
     uint32_t options;
@@ -224,6 +352,8 @@ private:
         if (out.is_open())
             out.close();
 
+        // write in large blocks, the dumps of big graphs are huge
+        out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
         out.open(new_file);
         file = new_file;
     }
@@ -254,8 +384,9 @@ private:
 
         for (NodeT *n : BB->getNodes()) {
             // print nodes in BB, edges will be printed later
-            out << Ind << "\tNODE" << n
-                << " [label=\"" << n->getKey() << "\"]\n";
+            if (isSelected(n))
+                out << Ind << "\tNODE" << n
+                    << " [label=\"" << n->getKey() << "\"]\n";
         }
 
         out << Ind << "} /* cluster_bb_" << BB << " */\n\n";
@@ -269,6 +400,8 @@ private:
             for (auto S : BB->successors()) {
                 NodeT *lastNode = BB->getLastNode();
                 NodeT *firstNode = S.target->getFirstNode();
+                if (!isSelected(lastNode) || !isSelected(firstNode))
+                    continue;
 
                 out << Ind
                     << "NODE" << lastNode << " -> "
@@ -283,6 +416,8 @@ private:
             for (auto S : BB->predecessors()) {
                 NodeT *lastNode = S->getLastNode();
                 NodeT *firstNode = BB->getFirstNode();
+                if (!isSelected(lastNode) || !isSelected(firstNode))
+                    continue;
 
                 out << Ind
                     << "NODE" << firstNode << " -> "
@@ -297,6 +432,8 @@ private:
             for (auto S : BB->controlDependence()) {
                 NodeT *lastNode = BB->getLastNode();
                 NodeT *firstNode = S->getFirstNode();
+                if (!isSelected(lastNode) || !isSelected(firstNode))
+                    continue;
 
                 out << Ind
                     << "NODE" << lastNode << " -> "
@@ -309,6 +446,8 @@ private:
             for (BBlock<NodeT> *S : BB->getPostDomFrontiers()) {
                 NodeT *start = BB->getFirstNode();
                 NodeT *end = S->getLastNode();
+                if (!isSelected(start) || !isSelected(end))
+                    continue;
 
                 out << Ind
                     << "/* post-dominance frontiers */\n"
@@ -322,7 +461,8 @@ private:
 
         if (options & PRINT_POSTDOM) {
             BBlock<NodeT> *ipd = BB->getIPostDom();
-            if (ipd) {
+            if (ipd && isSelected(BB->getFirstNode())
+                && isSelected(ipd->getLastNode())) {
                 NodeT *firstNode = BB->getFirstNode();
                 NodeT *lastNode = ipd->getLastNode();
 
@@ -447,6 +587,9 @@ private:
 
     void dump_node(NodeT *node, int ind = 1, const char *prefix = nullptr)
     {
+        if (!isSelected(node))
+            return;
+
         bool err = false;
         unsigned int dfsorder = node->getDFSOrder();
         unsigned int bfsorder = node->getDFSOrder();
@@ -492,6 +635,9 @@ private:
             // add call-site to callee edges
             for (auto I = node->getSubgraphs().begin(),
                       E = node->getSubgraphs().end(); I != E; ++I) {
+                if (!isSelected((*I)->getEntry()))
+                    continue;
+
                 out << Ind
                     << "NODE" << node
                     << " -> NODE" << (*I)->getEntry()
@@ -533,6 +679,9 @@ private:
 
     void dump_node_edges(NodeT *n, int ind = 1)
     {
+        if (!isSelected(n))
+            return;
+
         Indent Ind(ind);
 
         out << Ind << "/* -- node " << n->getKey() << "\n"
@@ -542,7 +691,8 @@ private:
             out << Ind << "/* DD edges */\n";
             for (auto II = n->data_begin(), EE = n->data_end();
                  II != EE; ++II)
-                out << Ind << "NODE" << n << " -> NODE" << *II
+                if (isSelected(*II))
+                    out << Ind << "NODE" << n << " -> NODE" << *II
                     << " [color=\"" << dd_color << "\" rank=max]\n";
         }
 
@@ -550,7 +700,8 @@ private:
             out << Ind << "/* reverse DD edges */\n";
             for (auto II = n->rev_data_begin(), EE = n->rev_data_end();
                  II != EE; ++II)
-                out << Ind << "NODE" << n << " -> NODE" << *II
+                if (isSelected(*II))
+                    out << Ind << "NODE" << n << " -> NODE" << *II
                     << " [color=\"" << dd_color << "\" style=\"dashed\"  constraint=false]\n";
         }
 
@@ -558,7 +709,8 @@ private:
             out << Ind << "/* CD edges */\n";
             for (auto II = n->control_begin(), EE = n->control_end();
                  II != EE; ++II)
-                out << Ind << "NODE" << n << " -> NODE" << *II
+                if (isSelected(*II))
+                    out << Ind << "NODE" << n << " -> NODE" << *II
                     << " [color=\"" << cd_color << "\"]\n";
         }
 
@@ -566,7 +718,8 @@ private:
             out << Ind << "/* reverse CD edges */\n";
             for (auto II = n->rev_control_begin(), EE = n->rev_control_end();
                  II != EE; ++II)
-                out << Ind << "NODE" << n << " -> NODE" << *II
+                if (isSelected(*II))
+                    out << Ind << "NODE" << n << " -> NODE" << *II
                     << " [color=\"" << cd_color << "\" style=\"dashed\" constraint=false]\n";
         }
     }
@@ -4,9 +4,11 @@
 #ifndef _DG_PARAMETERS_H_
 #define _DG_PARAMETERS_H_
 
-#include <map>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "ADT/TaggedAllocator.h"
 #include "BBlock.h"
 
 namespace dg {
@@ -49,13 +51,122 @@ struct DGParameter
 //  represented as a node in the dependence graph.
 //  Moreover, there are BBlocks for input and output parameters
 //  so that the parameters can be used in BBlock analysis
+//
+//  The parameters are kept in vectors in the order in which they
+//  were added. There are parameters for every global at every
+//  call-site, so there are a lot of these containers and most of them
+//  are small. The small ones are searched linearly, the bigger ones
+//  get a hash table mapping the keys to the positions in the vector.
 // --------------------------------------------------------
+template <typename KeyT, typename ValueT>
+class FlatParametersMap
+{
+public:
+    using value_type = std::pair<KeyT, ValueT>;
+    using ContainerType
+        = std::vector<value_type,
+                      ADT::TaggedAllocator<value_type, ADT::AllocTag::PARAMETERS>>;
+    using iterator = typename ContainerType::iterator;
+    using const_iterator = typename ContainerType::const_iterator;
+
+    // build the hash table when there is more elements than this
+    static const size_t INDEX_THRESHOLD = 16;
+
+    ValueT *find(KeyT k)
+    {
+        size_t pos = position(k);
+        return pos == npos ? nullptr : &elems[pos].second;
+    }
+
+    const ValueT *find(KeyT k) const
+    {
+        size_t pos = position(k);
+        return pos == npos ? nullptr : &elems[pos].second;
+    }
+
+    // returns false if there is an element with the key already
+    bool insert(KeyT k, const ValueT& v)
+    {
+        if (position(k) != npos)
+            return false;
+
+        elems.emplace_back(k, v);
+        if (!index.empty())
+            index.emplace(k, elems.size() - 1);
+        else if (elems.size() > INDEX_THRESHOLD)
+            buildIndex();
+
+        return true;
+    }
+
+    // move the last element to the place of the removed one
+    void erase(KeyT k)
+    {
+        size_t pos = position(k);
+        if (pos == npos)
+            return;
+
+        if (!index.empty()) {
+            index.erase(k);
+            if (pos != elems.size() - 1)
+                index[elems.back().first] = pos;
+        }
+
+        if (pos != elems.size() - 1)
+            elems[pos] = elems.back();
+        elems.pop_back();
+    }
+
+    size_t size() const { return elems.size(); }
+
+    size_t getAllocatedBytes() const
+    {
+        return elems.capacity() * sizeof(value_type)
+               + index.bucket_count() * sizeof(void *)
+               + index.size() * (sizeof(std::pair<KeyT, size_t>) + sizeof(void *));
+    }
+
+    iterator begin() { return elems.begin(); }
+    const_iterator begin() const { return elems.begin(); }
+    iterator end() { return elems.end(); }
+    const_iterator end() const { return elems.end(); }
+
+private:
+    static const size_t npos = ~static_cast<size_t>(0);
+
+    ContainerType elems;
+    // empty until there are more than INDEX_THRESHOLD elements
+    std::unordered_map<KeyT, size_t> index;
+
+    size_t position(KeyT k) const
+    {
+        if (!index.empty()) {
+            auto it = index.find(k);
+            return it == index.end() ? npos : it->second;
+        }
+
+        for (size_t i = 0; i < elems.size(); ++i) {
+            if (elems[i].first == k)
+                return i;
+        }
+
+        return npos;
+    }
+
+    void buildIndex()
+    {
+        index.reserve(elems.size());
+        for (size_t i = 0; i < elems.size(); ++i)
+            index.emplace(elems[i].first, i);
+    }
+};
+
 template <typename NodeT>
-class DGParameters
+class DGParameters : public ADT::TaggedObject<ADT::AllocTag::PARAMETERS>
 {
 public:
     using KeyT = typename NodeT::KeyType;
-    using ContainerType = std::map<KeyT, DGParameter<NodeT>>;
+    using ContainerType = FlatParametersMap<KeyT, DGParameter<NodeT>>;
     using iterator = typename ContainerType::iterator;
     using const_iterator = typename ContainerType::const_iterator;
 
@@ -89,6 +200,8 @@ public:
     DGParameter<NodeT> *operator[](KeyT k) { return find(k); }
     const DGParameter<NodeT> *operator[](KeyT k) const { return find(k); }
 
+    // NOTE: adding a parameter invalidates the pointers
+    // to the parameters of the same kind returned by find()
     bool add(KeyT k, NodeT *val_in, NodeT *val_out)
     {
         return add(k, val_in, val_out, &params);
@@ -99,15 +212,8 @@ public:
         return add(k, val_in, val_out, &globals);
     }
 
-    DGParameter<NodeT> *findGlobal(KeyT k)
-    {
-        return find(k, &globals);
-    }
-
-    DGParameter<NodeT> *findParameter(KeyT k)
-    {
-        return find(k, &params);
-    }
+    DGParameter<NodeT> *findGlobal(KeyT k) { return globals.find(k); }
+    DGParameter<NodeT> *findParameter(KeyT k) { return params.find(k); }
 
     DGParameter<NodeT> *find(KeyT k)
     {
@@ -118,13 +224,17 @@ public:
         return ret;
     }
 
-    const DGParameter<NodeT> *findParameter(KeyT k) const
+    const DGParameter<NodeT> *findParameter(KeyT k) const { return params.find(k); }
+    const DGParameter<NodeT> *findGlobal(KeyT k) const { return globals.find(k); }
+
+    const DGParameter<NodeT> *find(KeyT k) const
     {
-        return findParameter(k);
-    }
+        const DGParameter<NodeT> *ret = findParameter(k);
+        if (!ret)
+            return findGlobal(k);
 
-    const DGParameter<NodeT> *findGlobal(KeyT k) const { return findGlobal(k); }
-    const DGParameter<NodeT> *find(KeyT k) const { return find(k); }
+        return ret;
+    }
 
     void remove(KeyT k)
     {
@@ -161,6 +271,13 @@ public:
     size_t globalsNum() const { return globals.size(); }
     size_t size() const { return params.size() + globals.size(); }
 
+    // the memory taken by the containers of the parameters
+    // (not by the nodes and the blocks)
+    size_t getAllocatedBytes() const
+    {
+        return params.getAllocatedBytes() + globals.getAllocatedBytes();
+    }
+
     iterator begin(void) { return params.begin(); }
     const_iterator begin(void) const { return params.begin(); }
     iterator end(void) { return params.end(); }
@@ -205,19 +322,9 @@ private:
     BBlock<NodeT> *BBOut;
     NodeT *callSite;
 
-    DGParameter<NodeT> *find(KeyT k, ContainerType *C)
-    {
-        iterator it = C->find(k);
-        if (it == C->end())
-            return nullptr;
-
-        return &(it->second);
-    }
-
     bool add(KeyT k, NodeT *val_in, NodeT *val_out, ContainerType *C)
     {
-        auto v = std::make_pair(k, DGParameter<NodeT>(val_in, val_out));
-        if (!C->insert(v).second)
+        if (!C->insert(k, DGParameter<NodeT>(val_in, val_out)))
             // we already has param with this key
             return false;
 
@@ -9,6 +9,7 @@
 
 #include "BBlock.h"
 #include "ADT/DGContainer.h"
+#include "ADT/IndexedMap.h"
 #include "Node.h"
 
 #include "analysis/Analysis.h"
@@ -37,11 +38,12 @@ public:
     // type of this dependence graph - so that we can refer to it in the code
     using DependenceGraphT = typename NodeT::DependenceGraphType;
 
-    using ContainerType = std::map<KeyT, NodeT *>;
+    // the nodes are iterated in the order in which they were added
+    using ContainerType = ADT::IndexedMap<KeyT, NodeT *>;
     using iterator = typename ContainerType::iterator;
     using const_iterator = typename ContainerType::const_iterator;
 #ifdef ENABLE_CFG
-    using BBlocksMapT = std::map<KeyT, BBlock<NodeT> *>;
+    using BBlocksMapT = ADT::IndexedMap<KeyT, BBlock<NodeT> *>;
 #endif
 
 private:
@@ -59,7 +61,7 @@ private:
     DGParameters<NodeT> *formalParameters;
 
     // call-sites (nodes) that are calling this graph
-    DGContainer<NodeT *> callers;
+    DGContainer<NodeT *, 8, NodeIDLess> callers;
 
     // how many nodes keeps pointer to this graph?
     int refcount;
@@ -382,8 +384,8 @@ public:
         return n != nullptr;
     }
 
-    DGContainer<NodeT *>& getCallers() { return callers; }
-    const DGContainer<NodeT *>& getCallers() const { return callers; }
+    DGContainer<NodeT *, 8, NodeIDLess>& getCallers() { return callers; }
+    const DGContainer<NodeT *, 8, NodeIDLess>& getCallers() const { return callers; }
     bool addCaller(NodeT *sg) { return callers.insert(sg); }
 
     // set that this graph (if it is subgraph)
@@ -397,6 +399,12 @@ public:
 
     uint64_t getSlice() const { return slice_id; }
 
+    // the data dependencies of the nodes may be computed on demand,
+    // only for the graphs that some backward walk gets into. The walks
+    // call this before they use the incoming data dependencies
+    // of the nodes of this graph, the graph may compute them now
+    virtual void ensureDataDependencies() {}
+
 #ifdef ENABLE_CFG
     // get blocks contained in this graph
     BBlocksMapT& getBlocks() { return _blocks; }
@@ -411,6 +419,12 @@ public:
         return _blocks.erase(key) == 1;
     }
 
+    // the control dependencies of the blocks may be computed lazily,
+    // only for the graphs that some walk gets into. The walks call
+    // this before they use the control dependencies of the blocks
+    // of this graph, the graph may compute them now
+    virtual void ensureControlDependencies() {}
+
     BBlock<NodeT> *getPostDominatorTreeRoot() const { return PDTreeRoot; }
     void setPostDominatorTreeRoot(BBlock<NodeT> *r)
     {
@@ -4,6 +4,13 @@
 #ifndef _NODE_H_
 #define _NODE_H_
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
 #include "DGParameters.h"
 #include "ADT/DGContainer.h"
 #include "analysis/Analysis.h"
@@ -25,8 +32,10 @@ template <typename DependenceGraphT, typename KeyT, typename NodeT>
 class Node
 {
 public:
-    using ControlEdgesT = EdgesContainer<NodeT>;
-    using DependenceEdgesT = EdgesContainer<NodeT>;
+    // the edges are ordered by the ids of the nodes,
+    // so that they are iterated in the same order in every run
+    using ControlEdgesT = EdgesContainer<NodeT, 4, NodeIDLess>;
+    using DependenceEdgesT = EdgesContainer<NodeT, 4, NodeIDLess>;
 
     // to be able to reference the KeyT and DG
     using KeyType = KeyT;
@@ -39,7 +48,7 @@ public:
 
     Node<DependenceGraphT, KeyT, NodeT>(const KeyT& k,
                                         DependenceGraphT *dg = nullptr)
-        : key(k), dg(dg), parameters(nullptr), slice_id(0)
+        : key(k), dg(dg), id(++lastID), parameters(nullptr), slice_id(0)
 #if ENABLE_CFG
          , basicBlock(nullptr)
 #endif
@@ -48,6 +57,62 @@ public:
             dg->addNode(static_cast<NodeT *>(this));
     }
 
+    ~Node<DependenceGraphT, KeyT, NodeT>()
+    {
+        // the node is gone, do not build its reverse edges
+        if (deferred_idx) {
+            DeferredEdges& D = getDeferredEdges();
+            std::lock_guard<std::mutex> guard(D.lock);
+            D.nodes[deferred_idx - 1] = nullptr;
+        }
+    }
+
+    // Keep only the forward edges when adding control and data
+    // dependencies. The reverse edges of all the nodes are built at once
+    // when something needs them first (the reverse iterators, removing
+    // the edges or buildReverseEdges()). This saves the sorted insert
+    // of the reverse edge for every edge while the graph is built.
+    // The nodes are registered on their first edge, so adding edges
+    // from more threads is fine as long as every thread works
+    // with its own nodes (as without deferring).
+    static void deferReverseEdges(bool defer = true)
+    {
+        if (!defer)
+            buildReverseEdges();
+        getDeferredEdges().enabled = defer;
+    }
+
+    static bool reverseEdgesDeferred() { return getDeferredEdges().enabled; }
+
+    // add the reverse edges of the edges that were added
+    // while they were deferred
+    static void buildReverseEdges()
+    {
+        DeferredEdges& D = getDeferredEdges();
+        std::lock_guard<std::mutex> guard(D.lock);
+        if (!D.pending.load(std::memory_order_acquire))
+            return;
+
+        // (target, source) pairs
+        std::vector<std::pair<NodeT *, NodeT *>> cds, dds;
+        for (NodeT *n : D.nodes) {
+            if (!n)
+                continue;
+
+            n->deferred_idx = 0;
+            for (NodeT *succ : n->controlDepEdges)
+                cds.emplace_back(succ, n);
+            for (NodeT *succ : n->dataDepEdges)
+                dds.emplace_back(succ, n);
+        }
+
+        addReverseEdges(cds, &Node::revControlDepEdges);
+        addReverseEdges(dds, &Node::revDataDepEdges);
+
+        D.nodes.clear();
+        D.pending.store(false, std::memory_order_release);
+    }
+
     // remove this node from dg (from the container - the memory is still valid
     // and must be freed later)
     void removeFromDG()
@@ -68,10 +133,17 @@ public:
         return dg;
     }
 
+    // unique id of the node, the ids are given in the order
+    // in which the nodes are created (starting from 1)
+    unsigned int getID() const { return id; }
+
     // add control dependence edge 'this'-->'n',
     // thus making 'n' control dependend on this node
     bool addControlDependence(NodeT * n)
     {
+        if (reverseEdgesDeferred())
+            return addDeferred(controlDepEdges, n);
+
         bool ret1, ret2;
 
         ret1 = n->revControlDepEdges.insert(static_cast<NodeT *>(this));
@@ -87,6 +159,9 @@ public:
     // thus making 'n' data dependend on this node
     bool addDataDependence(NodeT * n)
     {
+        if (reverseEdgesDeferred())
+            return addDeferred(dataDepEdges, n);
+
         bool ret1, ret2;
 
         ret1 = n->revDataDepEdges.insert(static_cast<NodeT *>(this));
@@ -97,9 +172,26 @@ public:
         return ret2;
     }
 
+    // add data dependence edges from all the nodes in @defs
+    // to this node, the nodes must be unique and sorted by their ids
+    // (NodeIDLess)
+    void addIncomingDDs(const std::vector<NodeT *>& defs)
+    {
+        if (reverseEdgesDeferred()) {
+            for (NodeT *def : defs)
+                def->addDeferred(def->dataDepEdges, static_cast<NodeT *>(this));
+            return;
+        }
+
+        revDataDepEdges.insert(defs.begin(), defs.end());
+        for (NodeT *def : defs)
+            def->dataDepEdges.insert(static_cast<NodeT *>(this));
+    }
+
     // remove edge 'this'-->'n' from data dependencies
     bool removeDataDependence(NodeT * n)
     {
+        ensureReverseEdges();
         bool ret1, ret2;
 
         ret1 = n->revDataDepEdges.erase(static_cast<NodeT *>(this));
@@ -114,6 +206,7 @@ public:
     // remove edge 'this'-->'n' from control dependencies
     bool removeControlDependence(NodeT * n)
     {
+        ensureReverseEdges();
         bool ret1, ret2;
 
         ret1 = n->revControlDepEdges.erase(static_cast<NodeT *>(this));
@@ -133,6 +226,7 @@ public:
 
     void removeIncomingDDs()
     {
+        ensureReverseEdges();
         while (!revDataDepEdges.empty()) {
             NodeT *cd = *revDataDepEdges.begin();
             // this will remove the reverse control dependence from
@@ -157,6 +251,7 @@ public:
 
     void removeIncomingCDs()
     {
+        ensureReverseEdges();
         while (!revControlDepEdges.empty()) {
             NodeT *cd = *revControlDepEdges.begin();
             // this will remove the reverse control dependence from
@@ -171,6 +266,19 @@ public:
         removeIncomingCDs();
     }
 
+    // remove the edges from and to the nodes for which @removed returns
+    // true (e.g. the nodes that are going to be destroyed together)
+    // in one pass over every container of this node
+    template <typename PredT>
+    void removeEdgesIf(PredT removed)
+    {
+        ensureReverseEdges();
+        controlDepEdges.eraseIf(removed);
+        revControlDepEdges.eraseIf(removed);
+        dataDepEdges.eraseIf(removed);
+        revDataDepEdges.eraseIf(removed);
+    }
+
     // remove all edges from/to this node
     void isolate()
     {
@@ -209,10 +317,11 @@ public:
     const_control_iterator control_end(void) const { return controlDepEdges.end(); }
 
     // reverse control dependency edges iterators
-    control_iterator rev_control_begin(void) { return revControlDepEdges.begin(); }
-    const_control_iterator rev_control_begin(void) const { return revControlDepEdges.begin(); }
-    control_iterator rev_control_end(void) { return revControlDepEdges.end(); }
-    const_control_iterator rev_control_end(void) const { return revControlDepEdges.end(); }
+    // (they build the deferred reverse edges first)
+    control_iterator rev_control_begin(void) { ensureReverseEdges(); return revControlDepEdges.begin(); }
+    const_control_iterator rev_control_begin(void) const { ensureReverseEdges(); return revControlDepEdges.begin(); }
+    control_iterator rev_control_end(void) { ensureReverseEdges(); return revControlDepEdges.end(); }
+    const_control_iterator rev_control_end(void) const { ensureReverseEdges(); return revControlDepEdges.end(); }
 
     // data dependency edges iterators
     data_iterator data_begin(void) { return dataDepEdges.begin(); }
@@ -221,15 +330,24 @@ public:
     const_data_iterator data_end(void) const { return dataDepEdges.end(); }
 
     // reverse data dependency edges iterators
-    data_iterator rev_data_begin(void) { return revDataDepEdges.begin(); }
-    const_data_iterator rev_data_begin(void) const { return revDataDepEdges.begin(); }
-    data_iterator rev_data_end(void) { return revDataDepEdges.end(); }
-    const_data_iterator rev_data_end(void) const { return revDataDepEdges.end(); }
+    data_iterator rev_data_begin(void) { ensureReverseEdges(); return revDataDepEdges.begin(); }
+    const_data_iterator rev_data_begin(void) const { ensureReverseEdges(); return revDataDepEdges.begin(); }
+    data_iterator rev_data_end(void) { ensureReverseEdges(); return revDataDepEdges.end(); }
+    const_data_iterator rev_data_end(void) const { ensureReverseEdges(); return revDataDepEdges.end(); }
 
     unsigned int getControlDependenciesNum() const { return controlDepEdges.size(); }
-    unsigned int getRevControlDependenciesNum() const { return revControlDepEdges.size(); }
+    unsigned int getRevControlDependenciesNum() const { ensureReverseEdges(); return revControlDepEdges.size(); }
     unsigned int getDataDependenciesNum() const { return dataDepEdges.size(); }
-    unsigned int getRevDataDependenciesNum() const { return revDataDepEdges.size(); }
+    unsigned int getRevDataDependenciesNum() const { ensureReverseEdges(); return revDataDepEdges.size(); }
+
+    // the memory allocated by the edge containers of the node
+    size_t getEdgesAllocatedBytes() const
+    {
+        return controlDepEdges.getAllocatedBytes()
+               + revControlDepEdges.getAllocatedBytes()
+               + dataDepEdges.getAllocatedBytes()
+               + revDataDepEdges.getAllocatedBytes();
+    }
 
 #ifdef ENABLE_CFG
     BBlock<NodeT> *getBBlock() { return basicBlock; }
@@ -313,6 +431,9 @@ protected:
     // each node has a reference to the DependenceGraph
     DependenceGraphT *dg;
 
+    unsigned int id;
+    static std::atomic<unsigned int> lastID;
+
 private:
     ControlEdgesT controlDepEdges;
     DependenceEdgesT dataDepEdges;
@@ -321,6 +442,73 @@ private:
     ControlEdgesT revControlDepEdges;
     DependenceEdgesT revDataDepEdges;
 
+    // the nodes whose edges miss the reverse edges
+    // (see deferReverseEdges())
+    struct DeferredEdges {
+        bool enabled = false;
+        std::atomic<bool> pending{false};
+        std::mutex lock;
+        std::vector<NodeT *> nodes;
+    };
+
+    static DeferredEdges& getDeferredEdges()
+    {
+        static DeferredEdges deferred;
+        return deferred;
+    }
+
+    // the position of this node in DeferredEdges::nodes plus one,
+    // 0 if its edges have the reverse edges
+    uint32_t deferred_idx = 0;
+
+    // add the forward edge to @n, the reverse edge is built later
+    bool addDeferred(ControlEdgesT& edges, NodeT *n)
+    {
+        if (!edges.insert(n))
+            return false;
+
+        if (!deferred_idx) {
+            DeferredEdges& D = getDeferredEdges();
+            std::lock_guard<std::mutex> guard(D.lock);
+            D.nodes.push_back(static_cast<NodeT *>(this));
+            deferred_idx = D.nodes.size();
+            D.pending.store(true, std::memory_order_release);
+        }
+
+        return true;
+    }
+
+    static void ensureReverseEdges()
+    {
+        if (getDeferredEdges().pending.load(std::memory_order_acquire))
+            buildReverseEdges();
+    }
+
+    // add the (target, source) @edges to the reverse
+    // containers @rev of the targets, every target at once
+    static void addReverseEdges(std::vector<std::pair<NodeT *, NodeT *>>& edges,
+                                ControlEdgesT Node::*rev)
+    {
+        // group the edges by the targets, the sources sorted by the ids
+        std::sort(edges.begin(), edges.end(),
+                  [](const std::pair<NodeT *, NodeT *>& a,
+                     const std::pair<NodeT *, NodeT *>& b) {
+                      if (a.first != b.first)
+                          return a.first->getID() < b.first->getID();
+                      return a.second->getID() < b.second->getID();
+                  });
+
+        std::vector<NodeT *> sources;
+        for (size_t i = 0; i < edges.size();) {
+            NodeT *target = edges[i].first;
+            sources.clear();
+            for (; i < edges.size() && edges[i].first == target; ++i)
+                sources.push_back(edges[i].second);
+
+            (target->*rev).insert(sources.begin(), sources.end());
+        }
+    }
+
     // a node can have more subgraphs (i. e. function pointers)
     std::set<DependenceGraphT *> subgraphs;
 
@@ -341,6 +529,9 @@ private:
     friend class analysis::Analysis<NodeT>;
 };
 
+template <typename DependenceGraphT, typename KeyT, typename NodeT>
+std::atomic<unsigned int> Node<DependenceGraphT, KeyT, NodeT>::lastID{0};
+
 } // namespace dg
 
 #endif // _NODE_H_
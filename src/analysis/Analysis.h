@@ -1,6 +1,9 @@
 #ifndef _DG_ANALYSIS_H_
 #define _DG_ANALYSIS_H_
 
+#include <atomic>
+#include <cstdint>
+
 namespace dg {
 
 // forward declaration of BBlock
@@ -11,20 +14,31 @@ class BBlock;
 
 namespace analysis {
 
+// a new dense index for the visit marks of walks (see VisitMarks)
+inline unsigned int getNewWalkIndex()
+{
+    static std::atomic<unsigned int> counter{0};
+    return counter++;
+}
+
 // data for analyses, stored in nodes
 struct AnalysesAuxiliaryData
 {
     AnalysesAuxiliaryData()
-        : lastwalkid(0), dfsorder(0), bfsorder(0) {}
+        : walkidx(getNewWalkIndex()), dfsorder(0), bfsorder(0),
+          frozenid(0), maskid(0) {}
 
-    // last id of walk (DFS/BFS) that ran on this node
-    // ~~> marker if it has been processed
-    unsigned int lastwalkid;
+    // index of the node (or block) in the visit marks of walks
+    unsigned int walkidx;
 
     // DFS order number of the node
     unsigned int dfsorder;
     // BFS order number of the node
     unsigned int bfsorder;
+    // index of the node in FrozenGraph + 1, 0 if not frozen
+    unsigned int frozenid;
+    // index of the node in WalkAndMarkMulti + 1, 0 if not reached
+    unsigned int maskid;
 };
 
 // gather statistics about a run
@@ -0,0 +1,239 @@
+#ifndef _DG_BIT_VECTOR_DATA_FLOW_H_
+#define _DG_BIT_VECTOR_DATA_FLOW_H_
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "DataFlowAnalysis.h"
+#include "ADT/Bitvector.h"
+#include "ADT/Queue.h"
+
+#ifndef ENABLE_CFG
+#error "Need CFG enabled for data flow analysis"
+#endif
+
+namespace dg {
+namespace analysis {
+
+enum class DataFlowDirection {
+    FORWARD,
+    BACKWARD,
+};
+
+enum class DataFlowMeet {
+    // a fact holds if it holds on some path (may analyses)
+    UNION,
+    // a fact holds if it holds on all paths (must analyses)
+    INTERSECTION,
+};
+
+///
+// Gen/kill data-flow analysis over the basic blocks of one graph
+// (the CFG reachable from the entry block) with the facts numbered
+// 0 ... factsNum - 1 and kept in bit vectors.
+//
+// The client computes the gen and kill sets of every block
+// in getGenKill(), the framework then solves the equations
+//
+//   output(B) = gen(B) | (input(B) & ~kill(B))
+//   input(B)  = meet of output(P) for the predecessors P of B
+//
+// where for the backward analyses the input is at the end of the block,
+// the output at its beginning and the predecessors are the CFG
+// successors. The input of the blocks without predecessors (the entry
+// block, the blocks without successors for backward analyses)
+// is given by getBoundary().
+// The blocks are processed from a worklist in reverse postorder
+// (postorder for backward analyses) and a block is processed again
+// only when the output of some of its predecessors changed.
+template <typename NodeT>
+class BitVectorDataFlowAnalysis : public Analysis<NodeT>
+{
+public:
+    using Bitvector = ADT::Bitvector;
+
+    BitVectorDataFlowAnalysis(BBlock<NodeT> *entryBB, size_t factsNum,
+                              DataFlowDirection dir = DataFlowDirection::FORWARD,
+                              DataFlowMeet meet = DataFlowMeet::UNION)
+        : entryBB(entryBB), factsNum(factsNum), direction(dir), meet(meet) {}
+
+    virtual ~BitVectorDataFlowAnalysis() = default;
+
+    // set the facts generated and killed by the block,
+    // @gen and @kill are empty vectors of factsNum bits
+    virtual void getGenKill(BBlock<NodeT> *BB, Bitvector& gen, Bitvector& kill) = 0;
+
+    // set the input of the blocks without predecessors,
+    // @boundary is an empty vector of factsNum bits
+    virtual void getBoundary(Bitvector& boundary) { (void) boundary; }
+
+    void run()
+    {
+        assert(entryBB && "entry basic block is nullptr");
+
+        gatherBlocks();
+        const size_t N = blocks.size();
+
+        data.clear();
+        data.reserve(N);
+        for (size_t i = 0; i < N; ++i) {
+            data.emplace_back(factsNum);
+            getGenKill(blocks[i], data.back().gen, data.back().kill);
+        }
+
+        Bitvector boundary(factsNum);
+        getBoundary(boundary);
+
+        // the identity of the meet: the outputs start as the top
+        // of the lattice, so the first meet gives the right value
+        const bool top = meet == DataFlowMeet::INTERSECTION;
+        for (BlockData& D : data)
+            D.output = Bitvector(factsNum, top);
+
+        std::vector<unsigned> rpo = computeRPO(succs);
+        std::vector<unsigned> priority(N);
+        for (size_t i = 0; i < N; ++i)
+            priority[i] = direction == DataFlowDirection::FORWARD
+                            ? rpo[i] : N - 1 - rpo[i];
+
+        ADT::PriorityWorklist<unsigned, Priority> worklist(N, Priority{&priority});
+        for (unsigned i = 0; i < N; ++i)
+            worklist.push(i);
+
+        const auto& inputs = direction == DataFlowDirection::FORWARD ? preds : succs;
+        const auto& outputs = direction == DataFlowDirection::FORWARD ? succs : preds;
+        std::vector<unsigned> runs(N, 0);
+        Bitvector input(factsNum);
+
+        while (!worklist.empty()) {
+            unsigned cur = worklist.pop();
+            ++runs[cur];
+            ++statistics.processedBlocks;
+
+            if (inputs[cur].empty() || isBoundary(cur))
+                input = boundary;
+            else if (top)
+                input.setAll();
+            else
+                input.resetAll();
+
+            for (unsigned p : inputs[cur]) {
+                if (meet == DataFlowMeet::UNION)
+                    input.unionWith(data[p].output);
+                else
+                    input.intersectWith(data[p].output);
+            }
+
+            BlockData& D = data[cur];
+            D.input = input;
+            if (!D.output.assignTransfer(D.gen, D.input, D.kill))
+                continue;
+
+            for (unsigned s : outputs[cur])
+                worklist.push(s);
+        }
+
+        statistics.bblocksNum = N;
+        statistics.iterationsNum = runs.empty() ? 0
+                                   : *std::max_element(runs.begin(), runs.end());
+    }
+
+    // the facts that hold at the beginning of the block
+    const Bitvector& getIn(BBlock<NodeT> *BB) const
+    {
+        const BlockData& D = getData(BB);
+        return direction == DataFlowDirection::FORWARD ? D.input : D.output;
+    }
+
+    // the facts that hold at the end of the block
+    const Bitvector& getOut(BBlock<NodeT> *BB) const
+    {
+        const BlockData& D = getData(BB);
+        return direction == DataFlowDirection::FORWARD ? D.output : D.input;
+    }
+
+    // was the block reached from the entry block?
+    bool hasBlock(BBlock<NodeT> *BB) const { return index.count(BB) > 0; }
+
+    size_t getFactsNum() const { return factsNum; }
+
+    const DataFlowStatistics& getStatistics() const { return statistics; }
+
+private:
+    struct BlockData {
+        Bitvector gen, kill;
+        Bitvector input, output;
+
+        BlockData(size_t n) : gen(n), kill(n), input(n), output(n) {}
+    };
+
+    struct Priority {
+        const std::vector<unsigned> *prio;
+
+        size_t operator()(unsigned idx) const { return (*prio)[idx]; }
+    };
+
+    BBlock<NodeT> *entryBB;
+    size_t factsNum;
+    DataFlowDirection direction;
+    DataFlowMeet meet;
+
+    // the blocks reachable from the entry (the entry is the first)
+    std::vector<BBlock<NodeT> *> blocks;
+    std::unordered_map<BBlock<NodeT> *, unsigned> index;
+    std::vector<std::vector<unsigned>> succs, preds;
+    std::vector<BlockData> data;
+    DataFlowStatistics statistics;
+
+    const BlockData& getData(BBlock<NodeT> *BB) const
+    {
+        auto it = index.find(BB);
+        assert(it != index.end() && "The block was not reached by the analysis");
+        return data[it->second];
+    }
+
+    // the entry block gets the boundary in the forward analyses,
+    // the blocks without successors in the backward analyses
+    // (these are the blocks without inputs, see run())
+    bool isBoundary(unsigned idx) const
+    {
+        return direction == DataFlowDirection::FORWARD && idx == 0;
+    }
+
+    void gatherBlocks()
+    {
+        blocks.clear();
+        index.clear();
+        succs.clear();
+        preds.clear();
+
+        blocks.push_back(entryBB);
+        index.emplace(entryBB, 0);
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            for (auto& E : blocks[i]->successors()) {
+                if (index.emplace(E.target, blocks.size()).second)
+                    blocks.push_back(E.target);
+            }
+        }
+
+        succs.resize(blocks.size());
+        preds.resize(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            for (auto& E : blocks[i]->successors()) {
+                unsigned s = index[E.target];
+                // the edges can have different labels
+                if (std::find(succs[i].begin(), succs[i].end(), s) != succs[i].end())
+                    continue;
+
+                succs[i].push_back(s);
+                preds[s].push_back(i);
+            }
+        }
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_BIT_VECTOR_DATA_FLOW_H_
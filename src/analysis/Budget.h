@@ -0,0 +1,87 @@
+#ifndef _DG_ANALYSIS_BUDGET_H_
+#define _DG_ANALYSIS_BUDGET_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "MemoryUsage.h"
+
+namespace dg {
+namespace analysis {
+
+///
+// The time and memory limits of a run of an analysis. The analyses
+// call tick() in their fixpoint loops (it is cheap, it looks at the clock
+// and the memory only every CHECK_PERIOD calls) and once the budget
+// is exceeded, they stop or switch to a coarser (but sound) mode.
+// tick() may be called from more threads at once.
+class Budget
+{
+    // 0 means no limit
+    uint64_t timeout_ms = 0;
+    uint64_t max_memory = 0;
+
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<uint32_t> ticks{0};
+    std::atomic<bool> exceeded{false};
+
+public:
+    enum : uint32_t { CHECK_PERIOD = 1024 };
+
+    Budget() = default;
+    Budget(uint64_t timeout_ms, uint64_t max_memory)
+        : timeout_ms(timeout_ms), max_memory(max_memory) {}
+
+    // copy only the limits, not the state of a run
+    Budget(const Budget& oth)
+        : timeout_ms(oth.timeout_ms), max_memory(oth.max_memory) {}
+
+    Budget& operator=(const Budget& oth)
+    {
+        timeout_ms = oth.timeout_ms;
+        max_memory = oth.max_memory;
+        return *this;
+    }
+
+    void setTimeout(uint64_t ms) { timeout_ms = ms; }
+    // the limit of the resident set size of the whole process in bytes
+    void setMaxMemory(uint64_t bytes) { max_memory = bytes; }
+
+    uint64_t getTimeout() const { return timeout_ms; }
+    uint64_t getMaxMemory() const { return max_memory; }
+    bool isLimited() const { return timeout_ms > 0 || max_memory > 0; }
+
+    // start a new run, the time is measured from now
+    void start()
+    {
+        deadline = std::chrono::steady_clock::now()
+                    + std::chrono::milliseconds(timeout_ms);
+        ticks = 0;
+        exceeded = false;
+    }
+
+    bool isExceeded() const { return exceeded; }
+
+    // returns true if the budget is exceeded
+    bool tick()
+    {
+        if (!isLimited())
+            return false;
+        if (exceeded)
+            return true;
+        if (++ticks % CHECK_PERIOD != 0)
+            return false;
+
+        if ((timeout_ms > 0 && std::chrono::steady_clock::now() > deadline) ||
+            (max_memory > 0 && getCurrentRSS() > max_memory))
+            exceeded = true;
+
+        return exceeded;
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_BUDGET_H_
@@ -0,0 +1,228 @@
+#ifndef _DG_CONTROL_DEPENDENCE_H_
+#define _DG_CONTROL_DEPENDENCE_H_
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BBlock.h"
+
+namespace dg {
+namespace analysis {
+
+///
+// Compute post-dominators and control dependencies of blocks
+//
+// The blocks (of one procedure) are numbered densely and the
+// immediate post-dominators are computed with the iterative algorithm
+// of Cooper, Harvey and Kennedy over the reverse CFG with a virtual
+// exit node. The virtual exit has an edge to every block without
+// successors. The blocks that cannot reach any such block (infinite
+// loops) get an edge from the virtual exit too, so every block
+// has its immediate post-dominator.
+//
+// The control dependencies are derived directly from the post-dominator
+// tree (Ferrante et al.): for every edge A -> B, the blocks on the path
+// from B up to (but excluding) the immediate post-dominator of A are
+// control dependent on A. They are kept in a bitset for every block.
+//
+// K. D. Cooper, T. J. Harvey, and K. Kennedy. 2001.
+// A simple, fast dominance algorithm.
+// Software Practice & Experience 4, 1-10.
+//
+template <typename NodeT>
+class ControlDependence
+{
+    using BBlockT = BBlock<NodeT>;
+
+    // the index of the virtual exit is blocks.size()
+    std::vector<BBlockT *> blocks;
+    std::unordered_map<BBlockT *, unsigned> indices;
+    // the immediate post-dominators (indices)
+    std::vector<unsigned> ipdoms;
+    // the bits of the blocks that are control dependent
+    // on a block, words_num words for every block
+    std::vector<uint64_t> cds;
+    size_t words_num = 0;
+
+    unsigned getExitIdx() const { return blocks.size(); }
+
+    // the post-order of the reverse CFG from the virtual exit,
+    // @roots gets the blocks that have an edge from the exit
+    void computePostOrder(std::vector<unsigned>& order,
+                          std::vector<bool>& roots) const
+    {
+        std::vector<bool> visited(blocks.size(), false);
+        // the block and its next predecessor to search
+        std::vector<std::pair<unsigned, typename BBlockT::PredContainerT::const_iterator>> stack;
+
+        auto dfs = [&](unsigned root) {
+            roots[root] = true;
+            visited[root] = true;
+            stack.emplace_back(root, blocks[root]->predecessors().begin());
+            while (!stack.empty()) {
+                auto& top = stack.back();
+                if (top.second != blocks[top.first]->predecessors().end()) {
+                    unsigned idx = indices.find(*top.second)->second;
+                    ++top.second;
+                    if (!visited[idx]) {
+                        visited[idx] = true;
+                        stack.emplace_back(idx, blocks[idx]->predecessors().begin());
+                    }
+                } else {
+                    order.push_back(top.first);
+                    stack.pop_back();
+                }
+            }
+        };
+
+        for (unsigned i = 0; i < blocks.size(); ++i) {
+            if (blocks[i]->successorsNum() == 0)
+                dfs(i);
+        }
+
+        // the blocks that do not reach the exit, start from the last ones
+        // so that the whole loop is searched from its end if possible
+        for (unsigned i = blocks.size(); i > 0; --i) {
+            if (!visited[i - 1])
+                dfs(i - 1);
+        }
+
+        order.push_back(getExitIdx());
+    }
+
+    void computeIPostDoms()
+    {
+        std::vector<unsigned> order;
+        std::vector<bool> roots(blocks.size(), false);
+        computePostOrder(order, roots);
+
+        const unsigned UNDEF = ~0U;
+        std::vector<unsigned> po_num(blocks.size() + 1);
+        for (unsigned i = 0; i < order.size(); ++i)
+            po_num[order[i]] = i;
+
+        ipdoms.assign(blocks.size() + 1, UNDEF);
+        ipdoms[getExitIdx()] = getExitIdx();
+
+        auto intersect = [&](unsigned a, unsigned b) {
+            while (a != b) {
+                while (po_num[a] < po_num[b])
+                    a = ipdoms[a];
+                while (po_num[b] < po_num[a])
+                    b = ipdoms[b];
+            }
+            return a;
+        };
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            // reverse post-order without the exit
+            for (unsigned i = order.size() - 1; i > 0; --i) {
+                unsigned b = order[i - 1];
+                unsigned new_ipdom = roots[b] ? getExitIdx() : UNDEF;
+                for (const auto& succ : blocks[b]->successors()) {
+                    unsigned s = indices.find(succ.target)->second;
+                    if (ipdoms[s] == UNDEF)
+                        continue;
+
+                    new_ipdom = new_ipdom == UNDEF ? s : intersect(s, new_ipdom);
+                }
+
+                assert(new_ipdom != UNDEF);
+                if (ipdoms[b] != new_ipdom) {
+                    ipdoms[b] = new_ipdom;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    void computeControlDependencies()
+    {
+        words_num = (blocks.size() + 63) / 64;
+        cds.assign(blocks.size() * words_num, 0);
+
+        for (unsigned a = 0; a < blocks.size(); ++a) {
+            for (const auto& succ : blocks[a]->successors()) {
+                unsigned runner = indices.find(succ.target)->second;
+                while (runner != ipdoms[a]) {
+                    assert(runner != getExitIdx());
+                    cds[a * words_num + runner / 64] |= uint64_t(1) << (runner % 64);
+                    runner = ipdoms[runner];
+                }
+            }
+        }
+    }
+
+public:
+    // compute the post-dominators and control dependencies
+    // of the blocks, the blocks must be closed under successors
+    // and predecessors (i.e. the blocks of one procedure)
+    void compute(const std::vector<BBlockT *>& bblocks)
+    {
+        blocks = bblocks;
+        indices.clear();
+        indices.reserve(blocks.size());
+        for (unsigned i = 0; i < blocks.size(); ++i)
+            indices[blocks[i]] = i;
+
+        computeIPostDoms();
+        computeControlDependencies();
+    }
+
+    // the immediate post-dominator of the block,
+    // nullptr if it is the virtual exit
+    BBlockT *getIPostDom(BBlockT *BB) const
+    {
+        unsigned ipdom = ipdoms[indices.find(BB)->second];
+        return ipdom == getExitIdx() ? nullptr : blocks[ipdom];
+    }
+
+    // is @dep control dependent on @BB?
+    bool isControlDependent(BBlockT *dep, BBlockT *BB) const
+    {
+        unsigned a = indices.find(BB)->second;
+        unsigned b = indices.find(dep)->second;
+        return (cds[a * words_num + b / 64] >> (b % 64)) & 1;
+    }
+
+    // set the immediate post-dominators of the blocks (@root stands
+    // for the virtual exit), add the control dependencies and
+    // post-dominance frontiers to the blocks if @add_cd is true
+    void store(BBlockT *root, bool add_cd = true) const
+    {
+        for (unsigned i = 0; i < blocks.size(); ++i) {
+            if (ipdoms[i] != getExitIdx())
+                blocks[i]->setIPostDom(blocks[ipdoms[i]]);
+            else if (root)
+                blocks[i]->setIPostDom(root);
+        }
+
+        if (!add_cd)
+            return;
+
+        for (unsigned a = 0; a < blocks.size(); ++a) {
+            for (size_t w = 0; w < words_num; ++w) {
+                uint64_t word = cds[a * words_num + w];
+                while (word) {
+                    unsigned bit = __builtin_ctzll(word);
+                    word &= word - 1;
+
+                    BBlockT *dep = blocks[w * 64 + bit];
+                    blocks[a]->addControlDependence(dep);
+                    // pd-frontiers are the reverse control dependencies
+                    dep->addPostDomFrontier(blocks[a]);
+                }
+            }
+        }
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_CONTROL_DEPENDENCE_H_
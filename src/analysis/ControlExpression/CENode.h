@@ -1,8 +1,10 @@
 #ifndef _DG_CE_NODE_H_
 #define _DG_CE_NODE_H_
 
-#include <list>
 #include <set>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 //#include <iostream>
 #include <algorithm>
 #include <cassert>
@@ -18,10 +20,34 @@ enum CENodeType {
 };
 
 template <typename T> class CELabel;
+class CEContext;
 
+// A node of a control expression. The nodes are hash-consed
+// (see CEContext), so the expression is a DAG where every
+// subexpression is stored only once and the nodes are immutable.
 class CENode {
     // to avoid RTTI
     CENodeType type;
+    // the order of creation in the context, children
+    // have always lower ids than their parents
+    unsigned id;
+    // the index among the labels of the context (labels only)
+    unsigned label_idx;
+
+    std::vector<CENode *> children;
+
+    // the labels (indices) that are visited on every
+    // and only on some paths through this subexpression,
+    // sorted, computed once by CEContext::computeSets()
+    std::vector<unsigned> alwaysVisits;
+    std::vector<unsigned> sometimesVisits;
+    bool sets_computed;
+
+    friend class CEContext;
+
+protected:
+    CENode(CENodeType t)
+        : type(t), id(0), label_idx(0), sets_computed(false) {}
 
 public:
     // comparator for the Visits sets.
@@ -38,170 +64,11 @@ public:
 
     using VisitsSetT = std::set<CENode *, CECmp>;
 
-protected:
-    CENode *parent;
-    std::list<CENode *> children;
-
-    VisitsSetT alwaysVisits;
-    VisitsSetT sometimesVisits;
-
-    CENode(CENodeType t) : type(t), parent(nullptr) {}
-
-    void pruneSometimesVisits()
-    {
-        VisitsSetT diff;
-        // do intersection with another child
-        std::set_difference(sometimesVisits.begin(), sometimesVisits.end(),
-                            alwaysVisits.begin(), alwaysVisits.end(),
-                            std::inserter(diff, diff.end()), CECmp());
-
-        // swap the intersection for alwaysVisit, so that we can
-        // use it further
-        diff.swap(sometimesVisits);
-    }
-
-public:
-    class path_iterator {
-        CENode *node;
-
-        // iterator to the container that contains
-        // this node. The invariant is that *it == node
-        // or node == nullptr for end()
-        std::list<CENode *>::iterator it;
-
-        void iteratorReinit(CENode *nd)
-        {
-            if (nd && nd->parent) {
-                it = std::find(nd->parent->children.begin(),
-                               nd->parent->children.end(), nd);
-                node = nd;
-            } else
-                node = nullptr;
-        }
-
-        void moveUp()
-        {
-            assert(node->parent);
-
-            // shift the iterator to the parent node
-            iteratorReinit(node->parent);
-
-            // we're at the end of the expression
-            if (node == nullptr)
-                return;
-
-            if (node->isa(LOOP)) {
-                // when the node is loop, we want it in the path,
-                // since the loop is where the execution continues
-                node = *it;
-            } else if (node->parent && node->parent->isa(BRANCH)) {
-                // is the node's parent a BRANCH? In that case
-                // we must move up again
-                moveUp();
-            } else {
-                // try to shift the iterator one position
-                // to the right and check if we are not at
-                // the end
-                ++it;
-                if (node->parent->children.end() == it)
-                    // if we are again at the end, try it again
-                    moveUp();
-                else
-                    node = *it;
-            }
-        }
-
-    public:
-        path_iterator(CENode *nd)
-        {
-            iteratorReinit(nd);
-            // in the case that node was set to nullptr
-            // here, we reset it back to nd, so that
-            // we have valid begin() corresponding to 'this'
-            node = nd;
-        }
-
-        path_iterator()
-            : node(nullptr)
-        {
-        }
-
-        bool operator==(const path_iterator& oth) const
-        {
-            return node == oth.node;
-        }
-
-        bool operator!=(const path_iterator& oth) const
-        {
-            return node != oth.node;
-        }
-
-        path_iterator& operator++()
-        {
-            if (node->parent) {
-                // in SEQ and LOOPs we shift just to the right,
-                // but in BRANCH we shift _up_
-                if (node->parent->isa(BRANCH)) {
-                        moveUp();
-                } else {
-                    ++it;
-
-                    if (node->parent->children.end() == it)
-                        moveUp();
-                    else
-                        node = *it;
-                }
-            } else
-                node = nullptr;
-
-            return *this;
-        }
-
-        path_iterator operator++(int)
-        {
-            path_iterator tmp = *this;
-            operator++();
-            return tmp;
-        }
-
-        CENode *operator*()
-        {
-            return node;
-        }
-
-        CENode **operator->()
-        {
-            return &node;
-        }
-    };
-
-    path_iterator path_begin()
-    {
-        return path_iterator(this);
-    }
-
-    path_iterator path_end()
-    {
-        return path_iterator();
-    }
-
-    virtual ~CENode()
-    {
-        for (CENode *n : children)
-            delete n;
-    }
+    virtual ~CENode() = default;
 
-    void setParent(CENode *p)
-    {
-        parent = p;
-    }
+    unsigned getID() const { return id; }
 
-    CENode *getParent() const
-    {
-        return parent;
-    }
-
-    std::list<CENode *>& getChildren()
+    const std::vector<CENode *>& getChildren() const
     {
         return children;
     }
@@ -211,22 +78,18 @@ public:
         return !children.empty();
     }
 
-    VisitsSetT& getAlwaysVisits()
+    const std::vector<unsigned>& getAlwaysVisits() const
     {
+        assert(sets_computed && "Did you called computeSets?");
         return alwaysVisits;
     }
 
-    VisitsSetT& getSometimesVisits()
+    const std::vector<unsigned>& getSometimesVisits() const
     {
+        assert(sets_computed && "Did you called computeSets?");
         return sometimesVisits;
     }
 
-    void addChild(CENode *n)
-    {
-        children.push_back(n);
-        n->parent = this;
-    }
-
     // type identification and casting
     // to avoid RTTI. Later we could
     // add machinery like in LLVM
@@ -255,206 +118,6 @@ public:
     {
         return type > CENodeType::LABEL;
     }
-
-    // recursively clone children
-    // from 'this' to 'n'
-    void cloneChildrenTo(CENode *n) const
-    {
-        std::list<CENode *> chlds;
-        for (CENode *chld : children) {
-            CENode *nch = chld->clone();
-            nch->parent = n;
-            chlds.push_back(nch);
-        }
-
-        n->children.swap(chlds);
-    }
-
-    virtual CENode *clone() const
-    {
-        // (we don't need it right now,
-        // but it should be done)
-        CENode *n = new CENode(*this);
-        n->parent = nullptr;
-        cloneChildrenTo(n);
-        return n;
-    }
-
-    // compute alwaysVisits and sometimesVisits sets
-    virtual void computeSets()
-    {
-        // don't want to do this an abstract method,
-        // because we use this class also self-standingly
-        assert(false && "This method must be overriden");
-    }
-
-/*
-    virtual void print() const
-    {
-        std::cout << this;
-    }
-
-    void dump(int ind = 0) const
-    {
-        // not very effective
-        auto mkind = [&ind]{for (int i = 0; i < ind; ++i) { std::cout << " "; }};
-
-        // DEBUG: do a check
-        for (auto chld : children)
-            assert(chld->parent == this);
-
-        mkind();
-        //std::cout << "<" << this << ">";
-        switch(type) {
-            case BRANCH:
-                std::cout << "[+\n";
-                for (auto chld : children)
-                    chld->dump(ind + 3);
-
-                mkind();
-                std::cout << "]";
-                break;
-            case LOOP:
-                std::cout << "[*\n";
-                for (auto chld : children)
-                    chld->dump(ind + 3);
-
-                mkind();
-                std::cout << "]";
-                break;
-            case SEQ:
-                std::cout << "[seq\n";
-                for (auto chld : children)
-                    chld->dump(ind + 3);
-
-                mkind();
-                std::cout << "]";
-                break;
-            case EPS:
-                std::cout << "(e)\n";
-                break;
-            default:
-                print();
-        }
-
-        if (!alwaysVisits.empty()) {
-            std::cout << "   | ALWAYS: { ";
-            for (CENode *ch : alwaysVisits) {
-                ch->print();
-                std::cout << " ";
-            }
-            std::cout << "}";
-        }
-
-        if (!sometimesVisits.empty()) {
-            std::cout << " SMTM: { ";
-            for (CENode *ch : sometimesVisits) {
-                ch->print();
-                std::cout << " ";
-            }
-            std::cout << "}";
-        }
-
-        std::cout << "\n";
-
-    }
-*/
-
-    /*
-     * simplify the CENode and its children
-     * (recursively the whole subtree),
-     * for example, move subsequent sequences to this
-     * node, since it is the same (dot is the SEQ symbol):
-     *      .            .
-     *     / \         / | \
-     *    .   C  =    A  B  C
-     *   / \
-     *  A   B
-     */
-    void simplify()
-    {
-        // fist simplify the children
-        if (!children.empty())
-            for (CENode *chld : children)
-                chld->simplify();
-
-        // we'll create new container
-        // and then we swap the contents
-        std::list<CENode *> new_children;
-        for (auto I = children.begin(), E = children.end();
-             I != E; ++I) {
-            // if this node is a SEQ node
-            // and it has a child also SEQ,
-            // just merge the child SEQ into
-            // this node. Also, if this is a loop and
-            // it contains SEQ, we can make the SEQ
-            // just a children of the loop
-            if ((*I)->type == SEQ &&
-                (type == SEQ || type == LOOP)) {
-                    // we over-take the children,
-                    for (CENode *chld : (*I)->children) {
-                        new_children.push_back(chld);
-                        // set the new parent
-                        chld->parent = this;
-                    }
-                    // we over-took the children
-                    // so clear the container, so that we won't
-                    // delete the memory twice
-                    (*I)->children.clear();
-
-                    // now we can delete the memory
-                    delete *I;
-            } else if ((*I)->type == SEQ && (*I)->children.size() == 1) {
-                    // eliminate sequence when there is only one node in it
-
-                    CENode *chld = *((*I)->children.begin());
-                    new_children.push_back(chld);
-                    // set the new parent
-                    chld->parent = this;
-
-                    // we over-took the child
-                    // so clear the container, so that we won't
-                    // delete the memory twice
-                    (*I)->children.clear();
-
-                    // now we can delete the memory
-                    delete *I;
-            } else if (type == SEQ && (*I)->type == EPS) {
-                // skip epsilons in SEQuences
-                // (and since we drop the pointer,
-                // release the memory)
-                delete *I;
-                continue;
-            } else {
-                // no change? so just copy the child
-                assert((*I)->parent == this);
-                new_children.push_back(*I);
-            }
-        }
-
-        // put into children the newly computed children
-        children.swap(new_children);
-
-        // DEBUG, remove
-        for (CENode *nd : children)
-            assert(nd->parent == this);
-
-    }
-
-    // get the closest loop that is above this node
-    CENode *getParentLoop() const
-    {
-        return [](const CENode *nd) -> CENode * {
-            CENode *par = nd->getParent();
-            if (par) {
-                if (par->isa(LOOP))
-                    return par;
-                else
-                    return par->getParentLoop();
-            } else
-                return nullptr;
-        }(this);
-    }
 };
 
 template <typename T>
@@ -476,201 +139,242 @@ public:
         else
             return this < n;
     }
+};
 
-    virtual CENode *clone() const override
-    {
-        assert(!hasChildren() && "A label has children");
+/// ------------------------------------------------------------------
+// - CEContext
+//
+//   Owns the nodes of control expressions and hash-conses them:
+//   a symbol with the same type and children is created only once,
+//   so building the expressions (e.g. eliminating the nodes of CFA)
+//   shares the subexpressions instead of copying them. The symbols
+//   are simplified when created (nested sequences are flattened,
+//   epsilons are dropped from sequences, ...), so the expressions
+//   need no other simplification.
+/// ------------------------------------------------------------------
+class CEContext {
+    struct Key {
+        CENodeType type;
+        std::vector<CENode *> children;
+
+        bool operator==(const Key& oth) const
+        {
+            return type == oth.type && children == oth.children;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const
+        {
+            size_t h = k.type;
+            for (CENode *n : k.children)
+                h = h * 31 + n->getID();
+            return h;
+        }
+    };
+
+    std::vector<std::unique_ptr<CENode>> nodes;
+    std::vector<CENode *> labels;
+    std::unordered_map<Key, CENode *, KeyHash> symbols;
+    CENode *eps = nullptr;
 
-        // this node do not have children,
-        // so a shallow copy is OK
-        CENode *n = new CELabel(*this);
-        n->setParent(nullptr);
+    CENode *add(CENode *n)
+    {
+        n->id = nodes.size();
+        nodes.emplace_back(n);
         return n;
     }
 
-    virtual void computeSets() override
+    CENode *getSymbol(CENodeType type, std::vector<CENode *>&& children)
     {
-        assert(!hasChildren() && "A label has children, whata?");
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
-        // A label always just goes over itself.
-        // We may skip this, but this way the computation
-        // is easier.
-        alwaysVisits.insert(this);
+        Key key{type, std::move(children)};
+        auto it = symbols.find(key);
+        if (it != symbols.end())
+            return it->second;
+
+        CENode *n = add(new CENode(type));
+        n->children = key.children;
+        symbols.emplace(std::move(key), n);
+        return n;
     }
 
-    /*
-    virtual void print() const override
+    static void setUnion(const std::vector<unsigned>& a,
+                         const std::vector<unsigned>& b,
+                         std::vector<unsigned>& out)
     {
-        std::cout << label;
+        out.clear();
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                       std::back_inserter(out));
     }
-    */
 
-};
-
-class CESymbol: public CENode {
-protected:
-    CESymbol(CENodeType t)
-        :CENode(t) {}
-};
-
-class CESeq: public CESymbol {
 public:
-    CESeq(): CESymbol(CENodeType::SEQ) {}
-
-    virtual CENode *clone() const override
+    // take the label over, the labels are not hash-consed here
+    // (their type is not known), the user must create only
+    // one label for every value (see CFA::getLabel())
+    CENode *addLabel(CENode *label)
     {
-        CENode *n = new CESeq(*this);
-        n->setParent(nullptr);
-        cloneChildrenTo(n);
-        return n;
+        assert(label->isLabel());
+        label->label_idx = labels.size();
+        labels.push_back(label);
+        return add(label);
     }
 
-    virtual void computeSets() override
+    CENode *getLabel(unsigned idx) const
     {
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
-        assert(hasChildren() && "Sequence/loop has no children");
-
-        // first recurse into children
-        for (CENode *chld : children)
-            chld->computeSets();
-
-        // here we just make the union of children's
-        // always and sometimes sets
-        for (CENode *chld : children) {
-            for (CENode *ch : chld->getAlwaysVisits())
-                alwaysVisits.insert(ch);
-
-            for (CENode *ch : chld->getSometimesVisits())
-                if (alwaysVisits.count(ch) == 0)
-                    sometimesVisits.insert(ch);
-        }
-
-        // delete the elements from sometimesVisits
-        // that are in alwaysVisits. We tried to do it
-        // while inserting, but there was a bug in STL,
-        // so this is a workaround
-        pruneSometimesVisits();
+        assert(idx < labels.size());
+        return labels[idx];
     }
-};
 
-class CEBranch: public CESymbol {
-public:
-    CEBranch(): CESymbol(CENodeType::BRANCH) {}
+    size_t labelsNum() const { return labels.size(); }
 
-    virtual CENode *clone() const override
+    CENode *getEps()
     {
-        CENode *n = new CEBranch(*this);
-        n->setParent(nullptr);
-        cloneChildrenTo(n);
-        return n;
+        if (!eps)
+            eps = add(new CENode(EPS));
+        return eps;
     }
 
-    virtual void computeSets() override
+    // the sequence of the expressions
+    CENode *getSeq(const std::vector<CENode *>& elems)
     {
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
-        assert(hasChildren() && "Branch has no children");
-
-        // first recurse into children
-        for (CENode *chld : children)
-            chld->computeSets();
-
-        // get the labels that are in all branches
-        // - we go over them no matter we do
-
-        // initialize the alwaysVisits - copy the first child's
-        // alwaysVisits
-        auto I = children.begin();
-        alwaysVisits = (*I)->getAlwaysVisits();
-        ++I;
-        for (auto E = children.end(); I != E; ++I) {
-            VisitsSetT intersect;
-            // do intersection with another child
-            std::set_intersection(getAlwaysVisits().begin(), getAlwaysVisits().end(),
-                                  (*I)->getAlwaysVisits().begin(),
-                                  (*I)->getAlwaysVisits().end(),
-                                  std::inserter(intersect, intersect.end()), CECmp());
-
-            // swap the intersection for alwaysVisit, so that we can
-            // use it further
-            intersect.swap(alwaysVisits);
+        std::vector<CENode *> children;
+        for (CENode *n : elems) {
+            if (n->isa(SEQ))
+                children.insert(children.end(),
+                                n->children.begin(), n->children.end());
+            else if (!n->isa(EPS))
+                children.push_back(n);
         }
 
-        // compute the sometimesVisit
-        for (CENode *chld : children) {
-            for (CENode *ch : chld->getAlwaysVisits())
-                if (getAlwaysVisits().count(ch) == 0)
-                    getSometimesVisits().insert(ch);
+        if (children.empty())
+            return getEps();
+        if (children.size() == 1)
+            return children[0];
+
+        return getSymbol(SEQ, std::move(children));
+    }
 
-            for (CENode *ch : chld->getSometimesVisits())
-                if (getAlwaysVisits().count(ch) == 0)
-                    getSometimesVisits().insert(ch);
+    // the choice between the expressions
+    CENode *getBranch(const std::vector<CENode *>& elems)
+    {
+        std::vector<CENode *> children;
+        for (CENode *n : elems) {
+            if (n->isa(BRANCH))
+                children.insert(children.end(),
+                                n->children.begin(), n->children.end());
+            else
+                children.push_back(n);
         }
 
-        pruneSometimesVisits();
-    }
-};
+        // the order of the alternatives does not matter
+        std::sort(children.begin(), children.end(),
+                  [](const CENode *a, const CENode *b) {
+                      return a->getID() < b->getID();
+                  });
+        children.erase(std::unique(children.begin(), children.end()),
+                       children.end());
 
-class CELoop: public CESymbol {
-public:
-    CELoop(): CESymbol(CENodeType::LOOP) {}
+        assert(!children.empty());
+        if (children.size() == 1)
+            return children[0];
+
+        return getSymbol(BRANCH, std::move(children));
+    }
 
-    virtual CENode *clone() const override
+    // the iteration of the expression
+    CENode *getLoop(CENode *body)
     {
-        CENode *n = new CELoop(*this);
-        n->setParent(nullptr);
-        cloneChildrenTo(n);
-        return n;
+        if (body->isa(SEQ))
+            return getSymbol(LOOP, std::vector<CENode *>(body->children));
+
+        return getSymbol(LOOP, std::vector<CENode *>{body});
     }
 
-    virtual void computeSets() override
+    // compute the alwaysVisits and sometimesVisits sets
+    // of @root and all its subexpressions (that do not have them yet)
+    void computeSets(CENode *root)
     {
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
-        assert(hasChildren() && "Branch has no children");
-
-        // first recurse into children
-        for (CENode *chld : children)
-            chld->computeSets();
-
-        // while computing sets, we suppose the loop
-        // is always executed - the cases where it may
-        // not be executed are solved later when browsing
-        // the paths
-        for (CENode *chld : children) {
-            for (CENode *ch : chld->getAlwaysVisits())
-                alwaysVisits.insert(ch);
-
-            for (CENode *ch : chld->getSometimesVisits())
-                if (alwaysVisits.count(ch) == 0)
-                    sometimesVisits.insert(ch);
+        // the children have lower ids than their parents,
+        // so computing the sets in the order of ids
+        // computes the sets of children first
+        std::vector<bool> reach(root->getID() + 1, false);
+        reach[root->getID()] = true;
+        for (unsigned i = root->getID() + 1; i > 0; --i) {
+            CENode *n = nodes[i - 1].get();
+            if (!reach[i - 1] || n->sets_computed)
+                continue;
+            for (CENode *chld : n->children)
+                reach[chld->getID()] = true;
         }
 
-        pruneSometimesVisits();
-    }
-};
+        std::vector<unsigned> tmp;
+        for (unsigned i = 0; i <= root->getID(); ++i) {
+            CENode *n = nodes[i].get();
+            if (!reach[i] || n->sets_computed)
+                continue;
 
-class CEEps: public CESymbol {
-public:
-    CEEps(): CESymbol(CENodeType::EPS) {}
+            n->sets_computed = true;
+            auto& always = n->alwaysVisits;
+            auto& smtm = n->sometimesVisits;
 
-    virtual CENode *clone() const override
-    {
-        // we do not have children,
-        // make a shallow copy
-        CENode *n = new CEEps(*this);
-        n->setParent(nullptr);
-        return n;
+            switch (n->type) {
+            case LABEL:
+                // A label always just goes over itself.
+                always.push_back(n->label_idx);
+                break;
+            case EPS:
+                break;
+            case SEQ:
+            case LOOP:
+                // here we just make the union of children's
+                // always and sometimes sets. While computing sets,
+                // we suppose the loop is always executed - the cases
+                // where it may not be executed are solved later
+                // when computing the continuations
+                for (CENode *chld : n->children) {
+                    setUnion(always, chld->alwaysVisits, tmp);
+                    always.swap(tmp);
+                    setUnion(smtm, chld->sometimesVisits, tmp);
+                    smtm.swap(tmp);
+                }
+                break;
+            case BRANCH:
+                // get the labels that are in all branches
+                // - we go over them no matter we do
+                always = n->children[0]->alwaysVisits;
+                for (CENode *chld : n->children) {
+                    tmp.clear();
+                    std::set_intersection(always.begin(), always.end(),
+                                          chld->alwaysVisits.begin(),
+                                          chld->alwaysVisits.end(),
+                                          std::back_inserter(tmp));
+                    always.swap(tmp);
+
+                    setUnion(smtm, chld->alwaysVisits, tmp);
+                    smtm.swap(tmp);
+                    setUnion(smtm, chld->sometimesVisits, tmp);
+                    smtm.swap(tmp);
+                }
+                break;
+            }
+
+            // delete the elements from sometimesVisits
+            // that are in alwaysVisits
+            tmp.clear();
+            std::set_difference(smtm.begin(), smtm.end(),
+                                always.begin(), always.end(),
+                                std::back_inserter(tmp));
+            smtm.swap(tmp);
+        }
     }
 
-    /*
-    virtual void print() const override
+    CENode *getNode(unsigned id) const
     {
-        std::cout << "(e)";
+        assert(id < nodes.size());
+        return nodes[id].get();
     }
-    */
+
+    size_t size() const { return nodes.size(); }
 };
 
 } // namespace dg
@@ -1,9 +1,12 @@
 #ifndef _DG_CE_CFA_H_
 #define _DG_CE_CFA_H_
 
-#include <list>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <set>
 //#include <iostream>
 
 #include "CENode.h"
@@ -11,355 +14,329 @@
 
 namespace dg {
 
+/// ------------------------------------------------------------------
+// - CFA
+//
+//   Control flow automaton whose nodes are eliminated one by one
+//   (the state elimination) until only the edge from the root to the
+//   end remains, its label is the control expression. An edge that
+//   goes to a node is labelled by the label of that node.
+//
+//   The nodes are kept in a dense array and the edges in adjacency
+//   arrays with one hash index of (from, to) pairs, so adding, merging
+//   and removing an edge is constant time. The labels of edges are kept
+//   unbuilt while they are only extended: the sequence of expressions
+//   (or the alternatives of a branch) is extended and the expression
+//   is built only when the label is used by more edges. Two sequences
+//   are joined by moving the shorter one into the longer one, so
+//   eliminating a chain of nodes is near-linear in any order.
+//
+//   The nodes are eliminated in the order in which they were added.
+//   The shape of the expression depends on the order (e.g. whether
+//   a loop is unrolled once) and so do the control scopes computed
+//   from it, so the order is fixed.
+/// ------------------------------------------------------------------
 template <typename T>
-class CFANode {
-    T label;
-public:
-    using EdgeT = std::pair<CFANode<T> *, CENode *>;
+class CFA {
+    // the label of an edge: the sequence of the expressions
+    // or the branch of the alternatives (if there are any)
+    struct Label {
+        std::deque<CENode *> seq;
+        std::vector<CENode *> alts;
+    };
 
-    CFANode<T>(const T& l)
-        :label(l) {}
+    struct Edge {
+        unsigned target;
+        Label label;
 
-    // move constructor
-    CFANode<T>(CFANode<T>&& other)
-        : label(std::move(other.label)),
-          successors(std::move(other.successors)),
-          predecessors(std::move(other.predecessors))
-    {
-    }
+        Edge(unsigned t, Label&& l) : target(t), label(std::move(l)) {}
+    };
 
-    // move assign operator
-    CFANode<T>& operator=(CFANode<T>&& other)
-    {
-        other.successors.swap(successors);
-        other.predecessors.swap(predecessors);
-        label = std::move(other.label);
-        return *this;
-    }
+    struct Node {
+        std::vector<Edge> successors;
+        // may contain stale entries (the edges that were removed),
+        // the number of real predecessors is predecessorsNum
+        std::vector<unsigned> predecessors;
+        unsigned predecessorsNum = 0;
+        // the label of the self-loop (if hasSelfLoop)
+        Label selfLoop;
+        bool hasSelfLoop = false;
+        bool eliminated = false;
+    };
 
-    ~CFANode<T>()
+    // the nodes of the expressions
+    std::unique_ptr<CEContext> ctx;
+    std::vector<Node> nodes;
+    // the label of edges going to the node (by the index)
+    std::vector<CENode *> labels;
+    // (from, to) -> the position of the edge in successors of from
+    std::unordered_map<uint64_t, unsigned> edgesIndex;
+    // the entry set by setEntry()
+    unsigned entry;
+
+    // the indices of the artificial start and end nodes
+    static const unsigned ROOT = 0;
+    static const unsigned END = 1;
+
+    // the marks of the predecessors already processed
+    std::vector<unsigned> marks;
+    unsigned mark = 0;
+
+    static uint64_t key(unsigned from, unsigned to)
     {
-        for (EdgeT& edge : successors) {
-            // delete the labels, we allocate them
-            // using 'new'
-            delete edge.second;
-        }
+        return (static_cast<uint64_t>(from) << 32) | to;
     }
 
-    // add a new successors - merge two successors
-    // when they go to the same node
-    void addSuccessor(EdgeT succ)
+    // build the expression of the label
+    CENode *getExpr(Label& L)
     {
-        bool found = false;
-
-        for (auto I = successors.begin(), E = successors.end();
-             I != E; ++I) {
-            // we already have an edge to this successor?
-            if (I->first == succ.first) {
-                // if the label already is a branch, just
-                // add new branch to it (take over the ownership)
-                if (I->second->isa(BRANCH)) {
-                    I->second->addChild(succ.second);
-                } else {
-                    CEBranch *br = new CEBranch();
-                    br->addChild(I->second);
-                    br->addChild(succ.second);
-                    // set the new label
-                    I->second = br;
-                }
-
-                // we always have maximally one such successor
-                found = true;
-                break;
+        if (!L.alts.empty()) {
+            if (L.alts.size() > 1) {
+                CENode *br = ctx->getBranch(L.alts);
+                L.alts.assign(1, br);
             }
+
+            return L.alts[0];
         }
 
-        if (!found) {
-            successors.push_back(succ);
-            succ.first->predecessors.insert(this);
+        if (L.seq.size() != 1) {
+            CENode *seq = ctx->getSeq(std::vector<CENode *>(L.seq.begin(),
+                                                            L.seq.end()));
+            L.seq.assign(1, seq);
         }
+
+        return L.seq[0];
     }
 
-    // simple helper that adds successors to a node
-    // and sets the label for the node
-    void addSuccessor(CFANode<T> *n)
+    // append the sequence @b to the sequence @a
+    static void concat(std::deque<CENode *>& a, std::deque<CENode *>&& b)
     {
-        addSuccessor(EdgeT(n, new CELabel<T>(n->label)));
+        if (a.size() >= b.size()) {
+            a.insert(a.end(), b.begin(), b.end());
+        } else {
+            b.insert(b.begin(), a.begin(), a.end());
+            a.swap(b);
+        }
     }
 
-    const std::list<EdgeT>& getSuccessors() const
+    // merge the label @L into the label @to (a branch)
+    void mergeLabel(Label& to, Label&& L)
     {
-        return successors;
+        if (to.alts.empty()) {
+            to.alts.push_back(getExpr(to));
+            to.seq.clear();
+        }
+
+        to.alts.push_back(getExpr(L));
     }
 
-    void eliminate()
+    // add a new edge, merge the two edges
+    // when they go to the same node
+    void addEdge(unsigned from, unsigned to, Label&& L)
     {
-        // entry or exit node should not be removed
-        if (successors.empty() ||
-            predecessors.empty())
-                return;
-
-        // merge multiple self-loops into one self
-        // loop and get a flag if we have a self-loop.
-        // When we have a self-loop, we must insert it
-        // into the new labels
-        CENode *self_loop_label = getSelfLoopLabel();
-
-        // are we a node that has only self-loop, but no successor
-        // or predecessor?
-        if (successors.size() == 1 &&
-            successors.begin()->first == this)
-            return;
-
-        for (CFANode<T> *pred : predecessors) {
-            // skip self-loops, we must handle them
-            // differently
-            if (pred == this)
-                continue;
-
-            std::vector<EdgeT> new_edges;
-
-            for (auto I = pred->successors.begin(),
-                      E = pred->successors.end();
-                 I != E;) {
-
-                // is this the edge that points to this node?
-                if (I->first == this) {
-                    auto tmp = I++;
-
-                    for (EdgeT& edge : successors) {
-                        // do not add self-loops to this
-                        // node, we're eliminating
-                        if (edge.first == this)
-                            continue;
-
-                        // create a new label
-                        CESeq *seq = new CESeq();
-                        // add the label of the edge
-                        seq->addChild(tmp->second->clone());
-
-                        // if we have a self-loop, add it too
-                        if (self_loop_label) {
-                            CELoop *L = new CELoop();
-                            L->addChild(self_loop_label->clone());
-                            seq->addChild(L);
-                        }
-
-                        // and now add the label of the successor edge
-                        seq->addChild(edge.second->clone());
-
-                        // and add the new edge from the predecessor
-                        // to the successor (now to the container,
-                        // we add them later so that we won't corrupt
-                        // the end() iterator)
-                        new_edges.push_back(EdgeT(edge.first, seq));
-                    }
-
-                    // erase the old edge
-                    delete tmp->second;
-                    pred->successors.erase(tmp);
-                } else {
-                    // this is an edge that goes somewhere else
-                    // that to this node, so just continue iterating
-                    ++I;
-                }
+        Node& F = nodes[from];
+        if (from == to) {
+            if (F.hasSelfLoop) {
+                mergeLabel(F.selfLoop, std::move(L));
+            } else {
+                F.selfLoop = std::move(L);
+                F.hasSelfLoop = true;
             }
-
-            // add the new edges from predecessor to successors
-            for (EdgeT& e : new_edges)
-                pred->addSuccessor(e);
+            return;
         }
 
-        // erase this node from successors
-        for (EdgeT& edge : successors) {
-            delete edge.second; // delete the label
-            edge.first->predecessors.erase(this);
+        auto it = edgesIndex.find(key(from, to));
+        if (it != edgesIndex.end()) {
+            mergeLabel(F.successors[it->second].label, std::move(L));
+            return;
         }
 
-        // prevent double free of the labels
-        successors.clear();
-        predecessors.clear();
+        edgesIndex.emplace(key(from, to), F.successors.size());
+        F.successors.emplace_back(to, std::move(L));
+        nodes[to].predecessors.push_back(from);
+        ++nodes[to].predecessorsNum;
     }
 
-    /*
-    void dump() const
+    // remove the edge from @from at the position @pos
+    void removeEdge(unsigned from, unsigned pos)
     {
-        std::cout << " -- " << this << " --\n";
-        for (auto E : successors) {
-            std::cout << "   --> " << E.first << "\n";
-            E.second->dump(5);
+        auto& succs = nodes[from].successors;
+        unsigned to = succs[pos].target;
+        edgesIndex.erase(key(from, to));
+        --nodes[to].predecessorsNum;
+
+        if (pos != succs.size() - 1) {
+            succs[pos] = std::move(succs.back());
+            edgesIndex[key(from, succs[pos].target)] = pos;
         }
-    }
-    */
 
-    bool operator<(const CFANode<T>& oth) const
-    {
-        return label < oth.label;
+        succs.pop_back();
     }
 
-    bool hasSelfLoop() const
-    {
-        return predecessors.count(this) != 0;
-    }
-
-
-    bool hasSelfLoop()// const
+    void eliminate(unsigned idx)
     {
-        return predecessors.count(this) != 0;
-    }
+        Node& N = nodes[idx];
 
-    size_t successorsNum() const
-    {
-        return successors.size();
-    }
+        // entry or exit node should not be removed
+        // (neither a node that has only a self-loop)
+        if (N.eliminated || N.successors.empty() || N.predecessorsNum == 0)
+            return;
 
-    size_t predecessorsNum() const
-    {
-        return predecessors.size();
-    }
+        // if we have a self-loop, we must insert it into the new labels
+        CENode *loop = nullptr;
+        if (N.hasSelfLoop)
+            loop = ctx->getLoop(getExpr(N.selfLoop));
+
+        // the real predecessors
+        std::vector<unsigned> preds;
+        ++mark;
+        for (unsigned p : N.predecessors) {
+            if (marks[p] != mark && edgesIndex.count(key(p, idx)) > 0) {
+                marks[p] = mark;
+                preds.push_back(p);
+            }
+        }
+        assert(preds.size() == N.predecessorsNum);
 
-    void print() const
-    {
-        for (const auto& s : successors)
-            s.second->print();
-    }
+        // the labels used by more new edges are built, so that
+        // we copy only one expression and not the whole sequences
+        if (preds.size() > 1) {
+            for (Edge& E : N.successors)
+                getExpr(E.label);
+        }
 
-private:
-    CENode *getSelfLoopLabel() const
-    {
-        for (const EdgeT& edge : successors)
-            if (edge.first == this) {
-                return edge.second;
-            }
+        for (unsigned p : preds) {
+            unsigned pos = edgesIndex[key(p, idx)];
+            Label in = std::move(nodes[p].successors[pos].label);
+            removeEdge(p, pos);
 
-        return nullptr;
-    }
+            if (N.successors.size() > 1)
+                getExpr(in);
 
-    // we need both links, because
-    // when eliminating, we must know what
-    // edges go to this node. However,
-    // for predecessors, we need only
-    // the information that the predecessor
-    // has an edge to this node, so set
-    // of CENode * is OK
-    std::list<EdgeT> successors;
-    std::set<CFANode<T> *> predecessors;
-};
+            for (size_t i = 0; i < N.successors.size(); ++i) {
+                Label L;
+                // the last use of the incoming label can take it over
+                if (i == N.successors.size() - 1 && in.alts.empty())
+                    L.seq = std::move(in.seq);
+                else
+                    L.seq.push_back(getExpr(in));
 
+                if (loop)
+                    L.seq.push_back(loop);
 
-template <typename T>
-class CFA {
-    CFANode<T> root;
-    CFANode<T> end;
-
-    // the CFA will have relativelly small number of nodes
-    // in our case, so this kind of expensive comparsion should
-    // not bring big overhead. On the other hand, it could
-    // produce nicer control expressions
-    /*
-    struct NdsCmp {
-        bool operator()(CFANode<T> *a, CFANode<T> *b) const
-        {
-            if (a->hasSelfLoop()) {
-                if (b->hasSelfLoop()) {
-                    return ((a->successorsNum() * a->predecessorsNum()) <
-                            (b->successorsNum() * b->predecessorsNum()));
-                } else
-                    return false;
-            } else {
-                if (b->hasSelfLoop())
-                    return true;
+                // the outgoing label is not used anymore
+                // if this is its only predecessor
+                Label& out = N.successors[i].label;
+                if (out.alts.empty() && preds.size() == 1)
+                    concat(L.seq, std::move(out.seq));
                 else
-                    return ((a->successorsNum() * a->predecessorsNum()) <
-                            (b->successorsNum() * b->predecessorsNum()));
+                    L.seq.push_back(getExpr(out));
 
+                addEdge(p, N.successors[i].target, std::move(L));
             }
         }
-    };
-    */
 
-    std::set<CFANode<T> * /*, NdsCmp*/> nodes;
+        // erase this node from successors
+        while (!N.successors.empty())
+            removeEdge(idx, N.successors.size() - 1);
+
+        N.eliminated = true;
+        N.predecessors.clear();
+    }
 
 public:
     CFA<T>()
-        :root(T()), end(T()) {}
-
-    CFA<T>(CFA<T>&& oth)
-        :root(std::move(oth.root)),
-         end(std::move(oth.end)),
-         nodes(std::move(oth.nodes))
+        : ctx(new CEContext()), entry(~0U)
     {
+        // the root and end nodes
+        nodes.resize(2);
+        labels.push_back(nullptr);
+        labels.push_back(ctx->getEps());
     }
 
-    ~CFA<T>()
+    CFA<T>(CFA<T>&& oth) = default;
+    CFA<T>& operator=(CFA<T>&& oth) = default;
+
+    // add a node with the label @l into CFA, returns its index
+    unsigned addNode(const T& l)
     {
-        for (CFANode<T> *n : nodes)
-            // delete the nodes,
-            // we overtake the ownership
-            // FIXME: use std::unique_ptr?
-            delete n;
+        nodes.emplace_back();
+        labels.push_back(ctx->addLabel(new CELabel<T>(l)));
+        return nodes.size() - 1;
     }
 
-    // add a node into CFA. The memory must
-    // be allocated using 'new' operator and
-    // it is over-taken and deleted on CFA's
-    // destruction
-    void addNode(CFANode<T> *n)
+    // add the edge between the nodes with the given indices
+    void addEdge(unsigned from, unsigned to)
     {
-        // if this node has no predecessors,
-        // take it as a starting node
-        if (n->predecessorsNum() == 0)
-            root.addSuccessor(n);
-
-        // if this node has no successors,
-        // make it the exit node
-        if (n->successorsNum() == 0)
-            n->addSuccessor(typename CFANode<T>::EdgeT(&end, new CEEps()));
+        assert(from < nodes.size() && to < nodes.size());
+        Label L;
+        L.seq.push_back(labels[to]);
+        addEdge(from, to, std::move(L));
+    }
 
-        nodes.insert(n);
+    // the starting node. The nodes that have no predecessors
+    // are taken as starting nodes too
+    void setEntry(unsigned idx)
+    {
+        entry = idx;
     }
 
-    CFANode<T>& getRoot()
+    size_t size() const
     {
-        return root;
+        return nodes.size() - 2;
     }
 
+    // compute the control expression, the nodes of the expression
+    // are taken over, so the automaton cannot be used anymore
     ControlExpression compute()
     {
+        marks.assign(nodes.size(), 0);
+
+        for (unsigned i = END + 1; i < nodes.size(); ++i) {
+            // if this node has no predecessors,
+            // take it as a starting node
+            if (i == entry || nodes[i].predecessorsNum == 0)
+                addEdge(ROOT, i);
+
+            // if this node has no successors,
+            // make it the exit node (the nodes with only
+            // a self-loop are solved after the elimination)
+            if (nodes[i].successors.empty() && !nodes[i].hasSelfLoop)
+                addEdge(i, END);
+        }
+
         // no starting point? Then we just choose one...
-        if (root.successorsNum() == 0) {
+        if (nodes[ROOT].successors.empty()) {
             assert(false && "Not implemented yet");
             abort();// in the case of NDEBUG
         }
 
         // eliminate all the nodes
-        for (CFANode<T> *nd : nodes)
-            nd->eliminate();
-
-        // we may have end-up with two nodes,
-        // one of them having a self-loop above
-        // it (if there was no end node) and the
-        // other being the root.
-        // There's no way how to eliminate the former,
-        // so add a new end node that is going to be
-        // a successor of it -- then we can eliminate it.
+        for (unsigned i = END + 1; i < nodes.size(); ++i)
+            eliminate(i);
+
+        // we may have end-up with nodes having a self-loop above
+        // them (if there was no end node) and the root.
+        // There's no way how to eliminate them, so add a new end node
+        // that is going to be a successor of them -- then we can
+        // eliminate them.
         //
         //               __r__
         //       l      |     |
         // root ----> (node)<-/
         //
-        for (CFANode<T> *nd : nodes) {
-            if (nd->hasSelfLoop()) {
-                nd->addSuccessor(typename CFANode<T>::EdgeT(&end, new CEEps()));
-                nd->eliminate();
+        for (unsigned i = END + 1; i < nodes.size(); ++i) {
+            if (!nodes[i].eliminated && nodes[i].hasSelfLoop) {
+                addEdge(i, END);
+                eliminate(i);
             }
         }
 
-        assert(root.successorsNum() == 1);
-        CENode *expr = root.getSuccessors().begin()->second;
-        expr->simplify();
+        assert(nodes[ROOT].successors.size() == 1);
+        CENode *expr = getExpr(nodes[ROOT].successors[0].label);
 
-        return ControlExpression(expr);
+        // the expression takes over the nodes
+        return ControlExpression(expr, std::move(ctx));
     }
 };
 
@@ -1,7 +1,7 @@
 #ifndef _DG_CONTROL_EXPRESSION_H_
 #define _DG_CONTROL_EXPRESSION_H_
 
-#include <list>
+#include <memory>
 #include <vector>
 #include <set>
 //#include <iostream>
@@ -15,44 +15,151 @@ namespace dg {
 //template <typename T>
 class ControlExpression {
     CENode *root;
+    // the nodes of the expression
+    std::unique_ptr<CEContext> ctx;
+
+    // The continuations of the nodes: what follows a node in the
+    // paths through the expression (to the end of the expression).
+    // A node that is shared by more subexpressions has more
+    // continuations, we keep only what we need of them -- contAlways
+    // is the intersection of the labels that are always visited
+    // (up to the first loop, since every loop may not terminate)
+    // and contAll is the union of all labels that may be visited.
+    // Indexed by the ids of nodes.
+    std::vector<std::vector<unsigned>> contAlways;
+    std::vector<std::vector<unsigned>> contAll;
+    // the node has some continuation (it is reachable from root)
+    std::vector<bool> hasCont;
+    bool conts_computed = false;
+    bool conts_termination_sensitive = false;
+
+    static void setUnion(std::vector<unsigned>& a, const std::vector<unsigned>& b)
+    {
+        std::vector<unsigned> tmp;
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                       std::back_inserter(tmp));
+        a.swap(tmp);
+    }
 
-public:
-    using CEPath = std::vector<CENode *>;
-
-    ControlExpression(CENode *r)
-        : root(r) {}
-
-    ControlExpression()
-        :root(nullptr) {}
-
-    ControlExpression(ControlExpression&& oth)
-        :root(oth.root)
+    static void setIntersection(std::vector<unsigned>& a,
+                                const std::vector<unsigned>& b)
     {
-        oth.root = nullptr;
+        std::vector<unsigned> tmp;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                              std::back_inserter(tmp));
+        a.swap(tmp);
     }
 
-    ControlExpression& operator=(ControlExpression&& oth)
+    // add the continuation (@always, @all) to the node
+    void addContinuation(CENode *n, const std::vector<unsigned>& always,
+                         const std::vector<unsigned>& all)
     {
-        root = oth.root;
-        oth.root = nullptr;
-        return *this;
+        unsigned id = n->getID();
+        if (!hasCont[id]) {
+            hasCont[id] = true;
+            contAlways[id] = always;
+            contAll[id] = all;
+        } else {
+            setIntersection(contAlways[id], always);
+            setUnion(contAll[id], all);
+        }
     }
 
-    ControlExpression(const ControlExpression& oth) = delete;
-    /*
-        : root(oth.root->clone())
+    // Compute the continuations of all nodes, top-down (the parents
+    // have higher ids than the children). The path from a node goes
+    // to the right siblings in sequences and loops (and then to the
+    // loop itself), in branches it goes up right away.
+    //
+    // In the case we compute termination sensitive information,
+    // we assume that a loop may not terminate, therefore everything
+    // that follows a loop is only 'sometimes' (possibly) visited.
+    void computeContinuations(bool termination_sensitive)
     {
+        size_t num = root->getID() + 1;
+        contAlways.assign(num, std::vector<unsigned>());
+        contAll.assign(num, std::vector<unsigned>());
+        hasCont.assign(num, false);
+
+        // the root has an empty continuation
+        hasCont[root->getID()] = true;
+
+        for (size_t i = num; i > 0; --i) {
+            if (!hasCont[i - 1])
+                continue;
+
+            CENode *n = ctx->getNode(i - 1);
+            if (!n->hasChildren())
+                continue;
+
+            if (n->isa(BRANCH)) {
+                for (CENode *chld : n->getChildren())
+                    addContinuation(chld, contAlways[i - 1], contAll[i - 1]);
+                continue;
+            }
+
+            std::vector<unsigned> always = contAlways[i - 1];
+            std::vector<unsigned> all = contAll[i - 1];
+
+            // when the node is loop, we want it in the path,
+            // since the loop is where the execution continues
+            // (the root is not followed by anything)
+            if (n->isa(LOOP) && n != root) {
+                if (termination_sensitive)
+                    always.clear();
+                else
+                    always = n->getAlwaysVisits();
+                setUnion(all, n->getAlwaysVisits());
+                setUnion(all, n->getSometimesVisits());
+            }
+
+            const auto& children = n->getChildren();
+            for (size_t j = children.size(); j > 0; --j) {
+                addContinuation(children[j - 1], always, all);
+
+                // prepend the child to the path of the previous child,
+                // every loop may non-terminate, so every loop
+                // terminates the labels that are always visited
+                CENode *chld = children[j - 1];
+                if (chld->isa(LOOP)) {
+                    if (termination_sensitive)
+                        always.clear();
+                    else
+                        always = chld->getAlwaysVisits();
+                } else {
+                    setUnion(always, chld->getAlwaysVisits());
+                }
+
+                setUnion(all, chld->getAlwaysVisits());
+                setUnion(all, chld->getSometimesVisits());
+            }
+        }
+
+        conts_computed = true;
+        conts_termination_sensitive = termination_sensitive;
     }
-    */
+
+public:
+    ControlExpression(CENode *r, std::unique_ptr<CEContext>&& c)
+        : root(r), ctx(std::move(c)) {}
+
+    ControlExpression()
+        :root(nullptr) {}
+
+    ControlExpression(ControlExpression&& oth) = default;
+    ControlExpression& operator=(ControlExpression&& oth) = default;
+    ControlExpression(const ControlExpression& oth) = delete;
 
     CENode *getRoot()
     {
         return root;
     }
 
+    // compute the alwaysVisits and sometimesVisits sets
+    // of every subexpression (only once for a shared one)
     void computeSets()
     {
-        root->computeSets();
+        ctx->computeSets(root);
+        conts_computed = false;
     }
 
     /*
@@ -68,154 +175,45 @@ public:
     std::vector<CENode *> getLabels(const T& lab) const
     {
         std::vector<CENode *> tmp;
-        getLabels(root, lab, tmp);
-        return tmp;
-    }
-
-    template <typename T>
-    std::vector<CEPath> getPathsFrom(const T& l) const
-    {
-        std::vector<CEPath> paths;
-        std::vector<CENode *> labels = getLabels<T>(l);
-
-        for (CENode *lab : labels) {
-            CEPath P;
-            for (auto I = lab->path_begin(), E = lab->path_end();
-                 I != E; ++I) {
-                P.push_back(*I);
-
-                // XXX: Consider selective termination
-                // every loop may non-terminate, so every loop terminates a path
-                if ((*I)->isa(LOOP))
-                    // copy the path that is terminated with this loop
-                    paths.push_back(CEPath(P));
-
-                // continue building the path
-            }
-
-            // rely on move constructors
-            paths.push_back(P);
+        for (size_t i = 0; i < ctx->labelsNum(); ++i) {
+            CENode *nd = ctx->getLabel(i);
+            if (nd->getID() <= root->getID()
+                && static_cast<CELabel<T> *>(nd)->getLabel() == lab)
+                tmp.push_back(nd);
         }
 
-        // hopefully a move constructor again
-        return paths;
-    }
-
-    // FIXME: this should go out of this class
-    std::pair<CENode::VisitsSetT, CENode::VisitsSetT>
-    getSetsForPath(CEPath& path, bool termination_sensitive = false) const
-    {
-        CENode::VisitsSetT always, smtm;
-        bool found_loop = false;
-
-        for (CENode *nd : path) {
-            if (nd->isa(LOOP))
-                found_loop = true;
-
-            // in the case we compute termination sensitive
-            // information, we assume that a loop may
-            // not terminate, therefore everything that
-            // follows a loop is only 'sometimes' (possibly) visited
-            if (found_loop && termination_sensitive) {
-                smtm.insert(nd->getAlwaysVisits().begin(),
-                            nd->getAlwaysVisits().end());
-            } else {
-                always.insert(nd->getAlwaysVisits().begin(),
-                              nd->getAlwaysVisits().end());
-            }
-
-            smtm.insert(nd->getSometimesVisits().begin(),
-                        nd->getSometimesVisits().end());
-        }
-
-        CENode::VisitsSetT diff;
-        std::set_difference(smtm.begin(), smtm.end(),
-                            always.begin(), always.end(),
-                            std::inserter(diff, diff.end()), CENode::CECmp());
-
-        diff.swap(smtm);
-
-        return std::make_pair(always, smtm);
-    }
-
-    std::pair<CENode::VisitsSetT, CENode::VisitsSetT>
-    getSets(std::vector<CEPath>& paths, bool termination_sensitive = false) const
-    {
-        CENode::VisitsSetT always, smtm;
-
-        assert(paths.size() > 0);
-
-        if (paths.size() == 1)
-            return getSetsForPath(*(paths.begin()), termination_sensitive);
-
-        auto I = paths.begin();
-        auto S = getSetsForPath(*I, termination_sensitive);
-
-        // initialize the alwas set
-        always = std::move(S.first);
-
-        // initialize the somtimes set (we put there everything
-        // and then filter it at the end)
-        smtm = std::move(S.second);
-        smtm.insert(always.begin(), always.end());
-
-        ++I;
-        for (auto E = paths.end(); I != E; ++I) {
-            // make intersection of the always sets
-            CENode::VisitsSetT tmpa;
-
-            auto cur = getSetsForPath(*I, termination_sensitive);
-            std::set_intersection(always.begin(), always.end(),
-                                  cur.first.begin(), cur.first.end(),
-                                  std::inserter(tmpa, tmpa.end()),
-                                  CENode::CECmp());
-
-            always.swap(tmpa);
-
-            // we insert both sets into the insert and then
-            // we simply remove what is in always
-            smtm.insert(cur.first.begin(), cur.first.end());
-            smtm.insert(cur.second.begin(), cur.second.end());
-        }
-
-        CENode::VisitsSetT diff;
-        std::set_difference(smtm.begin(), smtm.end(),
-                            always.begin(), always.end(),
-                            std::inserter(diff, diff.end()), CENode::CECmp());
-
-        diff.swap(smtm);
-
-        return std::make_pair(always, smtm);
+        return tmp;
     }
 
+    // the labels that are visited only on some paths
+    // from the label @lab to the end of the expression
     template <typename T>
     CENode::VisitsSetT getControlScope(const T& lab,
-                                       bool termination_sensitive = false) const
-    {
-        assert((!root->getAlwaysVisits().empty() ||
-               !root->getSometimesVisits().empty()) && "Did you called computeSets?");
-
-        auto paths = getPathsFrom<T>(lab);
-        // return the 'sometimes' set
-        return getSets(paths, termination_sensitive).second;
-    }
-
-private:
-
-    template <typename T>
-    void getLabels(CENode *nd, const T& lab, std::vector<CENode *>& out) const
+                                       bool termination_sensitive = false)
     {
-        if (nd->isLabel()) {
-            CELabel<T> *l = static_cast<CELabel<T> *>(nd);
-            // std::cout << l->getLabel() << " == " << lab << "\n";
-            if (l->getLabel() == lab) {
-                out.push_back(nd);
-            }
+        if (!conts_computed || conts_termination_sensitive != termination_sensitive)
+            computeContinuations(termination_sensitive);
+
+        CENode::VisitsSetT scope;
+        for (CENode *nd : getLabels<T>(lab)) {
+            unsigned id = nd->getID();
+            if (!hasCont[id])
+                continue;
+
+            // the paths start with the label itself
+            std::vector<unsigned> always = contAlways[id];
+            setUnion(always, nd->getAlwaysVisits());
+
+            std::vector<unsigned> smtm;
+            std::set_difference(contAll[id].begin(), contAll[id].end(),
+                                always.begin(), always.end(),
+                                std::back_inserter(smtm));
+
+            for (unsigned idx : smtm)
+                scope.insert(ctx->getLabel(idx));
         }
 
-        // recursively call to children
-        for (CENode *chld : nd->getChildren())
-            getLabels(chld, lab, out);
+        return scope;
     }
 };
 
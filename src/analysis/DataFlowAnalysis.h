@@ -1,11 +1,16 @@
 #ifndef _DG_DATA_FLOW_ANALYSIS_H_
 #define _DG_DATA_FLOW_ANALYSIS_H_
 
+#include <algorithm>
+#include <unordered_map>
 #include <utility>
 #include <set>
+#include <vector>
 
 #include "Analysis.h"
 #include "DFS.h"
+#include "SCC.h"
+#include "ADT/Queue.h"
 
 #ifndef ENABLE_CFG
 #error "Need CFG enabled for data flow analysis"
@@ -28,8 +33,58 @@ struct DataFlowStatistics : public AnalysisStatistics {
 enum DataFlowAnalysisFlags {
     DATAFLOW_INTERPROCEDURAL    = 1 << 0,
     DATAFLOW_BB_NO_CALLSITES    = 1 << 1,
+    // process the blocks in reverse postorder and revisit only
+    // the blocks whose inputs changed (by default, all the blocks
+    // are processed again until nothing changes)
+    DATAFLOW_WORKLIST           = 1 << 2,
+    // like DATAFLOW_WORKLIST, but solve the strongly connected
+    // components of the blocks one by one in topological order
+    DATAFLOW_SCC                = 1 << 3,
 };
 
+// number the vertices of the graph (given by the successors
+// of the vertices, the vertex 0 is the entry) in reverse postorder.
+// The unreachable vertices get the highest numbers
+inline std::vector<unsigned>
+computeRPO(const std::vector<std::vector<unsigned>>& succs)
+{
+    std::vector<unsigned> rpo(succs.size());
+    std::vector<char> visited(succs.size(), false);
+    std::vector<unsigned> postorder;
+    std::vector<std::pair<unsigned, size_t>> stack;
+    unsigned num = 0;
+
+    for (unsigned root = 0; root < succs.size(); ++root) {
+        if (visited[root])
+            continue;
+
+        visited[root] = true;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            unsigned v = stack.back().first;
+            if (stack.back().second < succs[v].size()) {
+                unsigned s = succs[v][stack.back().second++];
+                if (!visited[s]) {
+                    visited[s] = true;
+                    stack.emplace_back(s, 0);
+                }
+                continue;
+            }
+
+            postorder.push_back(v);
+            stack.pop_back();
+        }
+
+        // number the vertices found from this root after
+        // the vertices found from the previous roots
+        for (auto it = postorder.rbegin(), et = postorder.rend(); it != et; ++it)
+            rpo[*it] = num++;
+        postorder.clear();
+    }
+
+    return rpo;
+}
+
 // ordering of nodes with respect to DFS order
 // works for both nodes and blocks
 template<typename T>
@@ -48,21 +103,23 @@ public:
     BBlockDataFlowAnalysis<NodeT>(BBlock<NodeT> *entryBB, uint32_t fl = 0)
         :entryBB(entryBB), flags(fl), changed(false) {}
 
+    // process the block, return true if its output changed.
+    // With DATAFLOW_WORKLIST or DATAFLOW_SCC, the output of a block may
+    // depend only on the outputs of its CFG predecessors and, with
+    // DATAFLOW_INTERPROCEDURAL, of the call-site blocks (for the entry
+    // blocks of the subgraphs) and the exit blocks of the called subgraphs
     virtual bool runOnBlock(BBlock<NodeT> *BB) = 0;
 
     void run()
     {
-        uint32_t flg = DFS_BB_CFG;
+        if (flags & (DATAFLOW_WORKLIST | DATAFLOW_SCC)) {
+            runWorklist();
+            return;
+        }
 
         assert(entryBB && "entry basic block is nullptr");
 
-        /* translate flags */
-        if (flags & DATAFLOW_INTERPROCEDURAL)
-            flg |= DFS_INTERPROCEDURAL;
-        if (flags & DATAFLOW_BB_NO_CALLSITES)
-            flg |= DFS_BB_NO_CALLSITES;
-
-        BBlockDFS<NodeT> DFS(flg);
+        BBlockDFS<NodeT> DFS(getDFSFlags());
         DFSDataT data(blocks, changed, this);
 
         // we will get all the nodes using DFS
@@ -110,6 +167,117 @@ public:
     }
 
 private:
+    uint32_t getDFSFlags() const
+    {
+        uint32_t flg = DFS_BB_CFG;
+        if (flags & DATAFLOW_INTERPROCEDURAL)
+            flg |= DFS_INTERPROCEDURAL;
+        if (flags & DATAFLOW_BB_NO_CALLSITES)
+            flg |= DFS_BB_NO_CALLSITES;
+        return flg;
+    }
+
+    static void dfs_collect_bb(BBlock<NodeT> *BB,
+                               std::vector<BBlock<NodeT> *> *order)
+    {
+        order->push_back(BB);
+    }
+
+    // the worklist orders the blocks by their reverse postorder numbers
+    struct RPOPriority {
+        const std::vector<unsigned> *rpo;
+
+        size_t operator()(unsigned idx) const { return (*rpo)[idx]; }
+    };
+
+    void runWorklist()
+    {
+        assert(entryBB && "entry basic block is nullptr");
+
+        // gather the blocks (the walk also gathers the call-sites
+        // of the blocks with DATAFLOW_BB_NO_CALLSITES)
+        std::vector<BBlock<NodeT> *> order;
+        BBlockDFS<NodeT> DFS(getDFSFlags());
+        DFS.run(entryBB, dfs_collect_bb, &order);
+
+        std::unordered_map<BBlock<NodeT> *, unsigned> index;
+        for (unsigned i = 0; i < order.size(); ++i) {
+            index[order[i]] = i;
+            blocks.insert(order[i]);
+        }
+
+        // the blocks whose inputs depend on the output of the block
+        std::vector<std::vector<unsigned>> deps(order.size());
+        auto addDep = [&](unsigned from, BBlock<NodeT> *to) {
+            auto it = to ? index.find(to) : index.end();
+            if (it != index.end())
+                deps[from].push_back(it->second);
+        };
+
+        for (unsigned i = 0; i < order.size(); ++i) {
+            BBlock<NodeT> *BB = order[i];
+            for (auto& E : BB->successors())
+                addDep(i, E.target);
+
+            if (!(flags & DATAFLOW_INTERPROCEDURAL))
+                continue;
+
+            for (NodeT *cs : BB->getCallSites()) {
+                for (auto subdg : cs->getSubgraphs()) {
+                    addDep(i, subdg->getEntryBB());
+                    auto it = subdg->getExitBB() ? index.find(subdg->getExitBB())
+                                                 : index.end();
+                    if (it != index.end())
+                        deps[it->second].push_back(i);
+                }
+            }
+        }
+
+        std::vector<unsigned> rpo = computeRPO(deps);
+        std::vector<unsigned> runs(order.size(), 0);
+        ADT::PriorityWorklist<unsigned, RPOPriority> worklist(order.size(),
+                                                            RPOPriority{&rpo});
+
+        // process the blocks of the worklist, enqueue only
+        // the dependent blocks of the component @comp
+        // (or all dependent blocks if @comp is nullptr)
+        auto solve = [&](const std::vector<unsigned> *comp_ids, unsigned comp) {
+            while (!worklist.empty()) {
+                unsigned cur = worklist.pop();
+                ++runs[cur];
+                ++statistics.processedBlocks;
+
+                if (!runOnBlock(order[cur]))
+                    continue;
+
+                for (unsigned d : deps[cur]) {
+                    if (!comp_ids || (*comp_ids)[d] == comp)
+                        worklist.push(d);
+                }
+            }
+        };
+
+        if (flags & DATAFLOW_SCC) {
+            std::vector<std::vector<unsigned>> components;
+            std::vector<unsigned> comp_ids = computeSCCs(deps, components);
+
+            // the components are in reverse topological order
+            for (unsigned c = components.size(); c > 0; --c) {
+                for (unsigned i : components[c - 1])
+                    worklist.push(i);
+                solve(&comp_ids, c - 1);
+            }
+        } else {
+            for (unsigned i = 0; i < order.size(); ++i)
+                worklist.push(i);
+            solve(nullptr, 0);
+        }
+
+        statistics.bblocksNum = order.size();
+        statistics.iterationsNum = runs.empty() ? 0
+                                   : *std::max_element(runs.begin(), runs.end());
+    }
+
     // define set of blocks to be ordered in dfs order
     // FIXME if we use dfs order, then addBB does not work,
     // because the BB's newly added does have dfsorder unset
@@ -0,0 +1,190 @@
+#ifndef _DG_FROZEN_GRAPH_H_
+#define _DG_FROZEN_GRAPH_H_
+
+#include <cassert>
+#include <set>
+#include <vector>
+
+#include "Analysis.h"
+
+#ifdef ENABLE_CFG
+#include "BBlock.h"
+#endif
+
+namespace dg {
+
+template <typename NodeT>
+class DependenceGraph;
+
+namespace analysis {
+
+/// ------------------------------------------------------------------
+// - FrozenGraph
+//
+//   Read-only copy of the dependence edges of a graph in compressed
+//   sparse row (CSR) arrays. The nodes get dense indices and the edges
+//   of every kind are packed into one array, so walking the edges is
+//   a linear scan instead of chasing the pointers of the edge
+//   containers in the nodes. Build it once the graph is complete
+//   (after computing all the edges) and pass it to NodesWalk.
+//
+//   The control dependencies of basic blocks are packed together
+//   with the control dependencies of nodes (as the first or the last
+//   node of the block), the same way NodesWalk follows them.
+//
+//   The frozen graph does not follow the changes of the graph,
+//   freeze it again after adding or removing edges.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class FrozenGraph : public Analysis<NodeT>
+{
+public:
+    enum EdgeKind {
+        CD = 0,
+        DD,
+        REV_CD,
+        REV_DD,
+        EDGE_KINDS_NUM
+    };
+
+    using EdgesRange = std::pair<const unsigned *, const unsigned *>;
+
+    // freeze the nodes of @dg and of the graphs called from it
+    // together with the nodes reachable over the edges from them
+    void freeze(DependenceGraph<NodeT> *dg)
+    {
+        std::vector<NodeT *> seeds;
+        std::set<DependenceGraph<NodeT> *> graphs;
+        std::vector<DependenceGraph<NodeT> *> stack;
+        stack.push_back(dg);
+        graphs.insert(dg);
+
+        while (!stack.empty()) {
+            DependenceGraph<NodeT> *cur = stack.back();
+            stack.pop_back();
+
+            if (cur->getEntry())
+                seeds.push_back(cur->getEntry());
+
+            for (auto& it : *cur) {
+                seeds.push_back(it.second);
+                for (DependenceGraph<NodeT> *sub : it.second->getSubgraphs()) {
+                    if (graphs.insert(sub).second)
+                        stack.push_back(sub);
+                }
+            }
+        }
+
+        if (auto glob = dg->getGlobalNodes()) {
+            for (auto& it : *glob)
+                seeds.push_back(it.second);
+        }
+
+        freeze(seeds);
+    }
+
+    // freeze the nodes reachable from @seeds
+    void freeze(const std::vector<NodeT *>& seeds)
+    {
+        clear();
+
+        for (NodeT *n : seeds)
+            getOrAdd(n);
+
+        // the targets of the edges are added to nodes[]
+        // while we iterate over it
+        for (unsigned i = 0; i < nodes.size(); ++i) {
+            NodeT *n = nodes[i];
+            for (unsigned k = 0; k < EDGE_KINDS_NUM; ++k)
+                offsets[k].push_back(targets[k].size());
+
+            for (auto I = n->control_begin(), E = n->control_end(); I != E; ++I)
+                targets[CD].push_back(getOrAdd(*I));
+            for (auto I = n->data_begin(), E = n->data_end(); I != E; ++I)
+                targets[DD].push_back(getOrAdd(*I));
+            for (auto I = n->rev_control_begin(), E = n->rev_control_end(); I != E; ++I)
+                targets[REV_CD].push_back(getOrAdd(*I));
+            for (auto I = n->rev_data_begin(), E = n->rev_data_end(); I != E; ++I)
+                targets[REV_DD].push_back(getOrAdd(*I));
+
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *BB = n->getBBlock()) {
+                // the lazily computed control dependencies are needed now
+                if (BB->getDG())
+                    BB->getDG()->ensureControlDependencies();
+                for (BBlock<NodeT> *B : BB->controlDependence())
+                    if (NodeT *first = B->getFirstNode())
+                        targets[CD].push_back(getOrAdd(first));
+                for (BBlock<NodeT> *B : BB->revControlDependence())
+                    if (NodeT *last = B->getLastNode())
+                        targets[REV_CD].push_back(getOrAdd(last));
+            }
+#endif // ENABLE_CFG
+        }
+
+        for (unsigned k = 0; k < EDGE_KINDS_NUM; ++k)
+            offsets[k].push_back(targets[k].size());
+    }
+
+    void clear()
+    {
+        for (NodeT *n : nodes)
+            this->getAnalysisData(n).frozenid = 0;
+
+        nodes.clear();
+        for (unsigned k = 0; k < EDGE_KINDS_NUM; ++k) {
+            offsets[k].clear();
+            targets[k].clear();
+        }
+    }
+
+    size_t size() const { return nodes.size(); }
+    NodeT *getNode(unsigned idx) const { return nodes[idx]; }
+
+    // the index of @n, or -1 if @n is not in the frozen graph
+    int getIndex(NodeT *n)
+    {
+        unsigned id = this->getAnalysisData(n).frozenid;
+        if (id == 0 || id > nodes.size() || nodes[id - 1] != n)
+            return -1;
+
+        return id - 1;
+    }
+
+    EdgesRange getEdges(EdgeKind kind, unsigned idx) const
+    {
+        assert(idx < nodes.size());
+        const unsigned *T = targets[kind].data();
+        return EdgesRange(T + offsets[kind][idx], T + offsets[kind][idx + 1]);
+    }
+
+    size_t getEdgesNum() const
+    {
+        size_t num = 0;
+        for (unsigned k = 0; k < EDGE_KINDS_NUM; ++k)
+            num += targets[k].size();
+        return num;
+    }
+
+private:
+    std::vector<NodeT *> nodes;
+    // the edges of node i are targets[k][offsets[k][i] .. offsets[k][i + 1]]
+    std::vector<unsigned> offsets[EDGE_KINDS_NUM];
+    std::vector<unsigned> targets[EDGE_KINDS_NUM];
+
+    unsigned getOrAdd(NodeT *n)
+    {
+        int idx = getIndex(n);
+        if (idx >= 0)
+            return idx;
+
+        nodes.push_back(n);
+        this->getAnalysisData(n).frozenid = nodes.size();
+        return nodes.size() - 1;
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_FROZEN_GRAPH_H_
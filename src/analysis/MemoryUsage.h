@@ -0,0 +1,99 @@
+#ifndef _DG_MEMORY_USAGE_H_
+#define _DG_MEMORY_USAGE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace dg {
+namespace analysis {
+
+// Approximate memory used by a structure (the dependence graph,
+// an analysis) broken down by the kinds of its elements. The numbers
+// are computed from the sizes of the objects and the capacities of
+// their containers, they do not include the overhead of the allocator.
+struct MemoryUsage
+{
+    struct Entry {
+        std::string name;
+        uint64_t count;
+        uint64_t bytes;
+    };
+
+    std::vector<Entry> entries;
+
+    // add @count elements of @bytes bytes (in total) to the entry @name
+    void add(const std::string& name, uint64_t count, uint64_t bytes)
+    {
+        for (Entry& e : entries) {
+            if (e.name == name) {
+                e.count += count;
+                e.bytes += bytes;
+                return;
+            }
+        }
+
+        entries.push_back(Entry{name, count, bytes});
+    }
+
+    uint64_t getBytes() const
+    {
+        uint64_t bytes = 0;
+        for (const Entry& e : entries)
+            bytes += e.bytes;
+
+        return bytes;
+    }
+};
+
+// the peak resident set size of the process in bytes,
+// 0 if we do not know how to get it on this system
+inline uint64_t getPeakRSS()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    // Linux reports kilobytes
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// the current resident set size of the process in bytes,
+// the peak one if we do not know how to get it on this system
+inline uint64_t getCurrentRSS()
+{
+#if defined(__linux__)
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return getPeakRSS();
+
+    unsigned long size, resident;
+    int ret = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    if (ret != 2)
+        return getPeakRSS();
+
+    return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+#else
+    return getPeakRSS();
+#endif
+}
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_MEMORY_USAGE_H_
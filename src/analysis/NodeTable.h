@@ -0,0 +1,56 @@
+#ifndef _DG_ANALYSIS_NODE_TABLE_H_
+#define _DG_ANALYSIS_NODE_TABLE_H_
+
+#include <vector>
+
+namespace dg {
+namespace analysis {
+
+///
+// The data of an analysis for the nodes of a subgraph, kept in a vector
+// indexed by the ids of the nodes (see SubgraphNode::getID()).
+// Every analysis owns its tables, so more analyses can run over
+// one graph at once (e.g. the flow-insensitive and the flow-sensitive
+// points-to analysis) and the data of a node are found in a dense
+// array instead of behind a pointer in the node.
+//
+// The nodes can be created during the analysis, so the table grows
+// on demand. It must not grow while more threads use it, reserve()
+// the table for all the nodes before that.
+template <typename NodeT, typename T>
+class NodeTable
+{
+    std::vector<T> data;
+
+public:
+    // the data of @n, T() if nothing was set
+    T get(const NodeT *n) const
+    {
+        return n->getID() < data.size() ? data[n->getID()] : T();
+    }
+
+    T& operator[](const NodeT *n)
+    {
+        if (n->getID() >= data.size())
+            reserve(NodeT::getLastID());
+        return data[n->getID()];
+    }
+
+    void set(const NodeT *n, const T& val) { (*this)[n] = val; }
+
+    // make room for the nodes with ids up to @lastID
+    void reserve(unsigned lastID)
+    {
+        if (lastID >= data.size())
+            data.resize(lastID + 1, T());
+    }
+
+    void clear() { data.clear(); }
+
+    size_t getAllocatedBytes() const { return data.capacity() * sizeof(T); }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_NODE_TABLE_H_
@@ -1,8 +1,14 @@
 #ifndef _DG_NODES_WALK_H_
 #define _DG_NODES_WALK_H_
 
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
 #include "Analysis.h"
 #include "DGParameters.h"
+#include "FrozenGraph.h"
+#include "VisitMarks.h"
 
 namespace dg {
 namespace analysis {
@@ -27,84 +33,144 @@ enum NodesWalkFlags {
     NODES_WALK_BB_POSTDOM_FRONTIERS     = 1 << 8,
 };
 
-// this is a base class for nodes walk, it contains
-// counter. If we would add counter (even static) into
-// NodesWalk itself, we'd have counter for every
-// NodeT+QueueT instantiation, which we don't want to,
-// because then BFS and DFS would collide
+// the options of NodesWalk are given to the constructor
+constexpr uint32_t NODES_WALK_RUNTIME_OPTIONS = ~static_cast<uint32_t>(0);
+
+///
+// How a walk reached its nodes: the nodes in the order in which
+// they were reached, the node that reached each of them (an index into
+// the nodes) and the kind of the edge that it followed. The walk fills it
+// in when it is set by NodesWalk::setParents(). The parents are indices
+// only with a FIFO queue, where the nodes are processed in the order
+// in which they were reached
 template <typename NodeT>
-class NodesWalkBase : public Analysis<NodeT>
+struct WalkParents
 {
-protected:
-    // this counter will increase each time we run
-    // NodesWalk, so it can be used as an indicator
-    // that we queued a node in a particular run or not
-    static unsigned int walk_run_counter;
-};
+    enum EdgeKind : uint8_t {
+        // the node was one of the entries of the walk
+        START,
+        CD,
+        DD,
+        // the entry of the graph of a node (see WalkAndMark)
+        ENTRY,
+        // the edges of the basic blocks
+        CFG,
+    };
+
+    static const uint32_t NONE = ~static_cast<uint32_t>(0);
+
+    std::vector<NodeT *> nodes;
+    std::vector<uint32_t> parents;
+    std::vector<uint8_t> kinds;
+
+    size_t size() const { return nodes.size(); }
+
+    void add(NodeT *n, uint32_t parent, EdgeKind kind)
+    {
+        nodes.push_back(n);
+        parents.push_back(parent);
+        kinds.push_back(kind);
+    }
 
-// counter definition
-template<typename NodeT>
-unsigned int NodesWalkBase<NodeT>::walk_run_counter = 0;
+    void clear()
+    {
+        nodes.clear();
+        parents.clear();
+        kinds.clear();
+    }
+};
 
-template <typename NodeT, typename QueueT>
-class NodesWalk : public NodesWalkBase<NodeT>
+///
+// Walk the nodes over the edges given by the NodesWalkFlags options.
+// The options are given either to the constructor, or as the template
+// parameter OPTIONS. Then the walk checks the flags at compile time
+// and the loop contains only the code for the edges that it walks
+// (together with a functor given to walk(), the loop of the slicer
+// is compiled with the marking inlined)
+template <typename NodeT, typename QueueT,
+          uint32_t OPTIONS = NODES_WALK_RUNTIME_OPTIONS>
+class NodesWalk : public Analysis<NodeT>
 {
 public:
-    NodesWalk<NodeT, QueueT>(uint32_t opts = 0)
-        : options(opts) {}
+    NodesWalk<NodeT, QueueT, OPTIONS>(uint32_t opts = 0)
+        : options(OPTIONS == NODES_WALK_RUNTIME_OPTIONS ? opts : OPTIONS),
+          frozen(nullptr), visits(nullptr), frozenVisits(nullptr),
+          parents(nullptr)
+    {
+        assert((OPTIONS == NODES_WALK_RUNTIME_OPTIONS
+                || opts == 0 || opts == OPTIONS)
+               && "The options are given by the template parameter");
+    }
+
+    // walk the edges packed in @graph instead of the edges in nodes.
+    // The nodes that are not in @graph are walked the usual way
+    void setFrozenGraph(FrozenGraph<NodeT> *graph)
+    {
+        frozen = graph;
+    }
+
+    // record how the walks reach the nodes into @p (nullptr to stop)
+    void setParents(WalkParents<NodeT> *p)
+    {
+        parents = p;
+    }
 
     template <typename FuncT, typename DataT>
     void walk(NodeT *entry, FuncT func, DataT data)
     {
-        run_id = ++NodesWalk<NodeT, QueueT>::walk_run_counter;
-
         assert(entry && "Need entry node for traversing nodes");
-        enqueue(entry);
+        walk(std::vector<NodeT *>{entry}, func, data);
+    }
+
+    // walk from more nodes at once
+    template <typename FuncT, typename DataT>
+    void walk(const std::vector<NodeT *>& entries, FuncT func, DataT data)
+    {
+        // the marks of this walk, they are returned
+        // to the pool when the walk finishes
+        VisitMarks::Guard guard(visits);
+        VisitMarks::Guard frozenGuard(frozenVisits);
+
+        using ParentsT = WalkParents<NodeT>;
+        parent = ParentsT::NONE;
+        kind = ParentsT::START;
+        // the index of the first node of this walk in the parents
+        uint32_t popped = parents ? parents->size() : 0;
+
+        for (NodeT *entry : entries)
+            enqueue(entry);
 
         while (!queue.empty()) {
             NodeT *n = queue.pop();
+            // the edges of the nodes that func() enqueues are not known,
+            // the analysis sets their kind by enqueue(n, kind)
+            parent = popped++;
+            kind = ParentsT::START;
 
             prepare(n);
             func(n, data);
 
             // do not try to process edges if we know
             // we should not
-            if (options == 0)
+            if (!walks(~static_cast<uint32_t>(0)))
                 continue;
 
-            // add unprocessed vertices
-            if (options & NODES_WALK_CD) {
-                processEdges(n->control_begin(), n->control_end());
-#ifdef ENABLE_CFG
-                // we can have control dependencies in BBlocks
-                processBBlockCDs(n);
-#endif // ENABLE_CFG
+            int idx = frozen ? frozen->getIndex(n) : -1;
+            if (idx >= 0) {
+                processFrozenEdges(idx);
+            } else {
+                processEdges(n);
             }
 
-            if (options & NODES_WALK_DD)
-                processEdges(n->data_begin(), n->data_end());
-
-            if (options & NODES_WALK_REV_CD) {
-                processEdges(n->rev_control_begin(), n->rev_control_end());
-
 #ifdef ENABLE_CFG
-                // we can have control dependencies in BBlocks
-                processBBlockRevCDs(n);
-#endif // ENABLE_CFG
-            }
-
-            if (options & NODES_WALK_REV_DD)
-                processEdges(n->rev_data_begin(), n->rev_data_end());
-
-#ifdef ENABLE_CFG
-            if (options & NODES_WALK_BB_CFG)
+            if (walks(NODES_WALK_BB_CFG))
                 processBBlockCFG(n);
 
-            if (options & NODES_WALK_BB_REV_CFG)
+            if (walks(NODES_WALK_BB_REV_CFG))
                 processBBlockRevCFG(n);
 #endif // ENABLE_CFG
 
-            if (options & NODES_WALK_BB_POSTDOM_FRONTIERS)
+            if (walks(NODES_WALK_BB_POSTDOM_FRONTIERS))
                 processBBlockPostDomFrontieres(n);
 
             // FIXME interprocedural
@@ -119,17 +185,39 @@ public:
     // on their own
     void enqueue(NodeT *n)
     {
-            AnalysesAuxiliaryData& aad = this->getAnalysisData(n);
+            assert(visits && "Enqueueing a node outside of a walk");
 
-            if (aad.lastwalkid == run_id)
+            int idx = frozen ? frozen->getIndex(n) : -1;
+            if (idx >= 0) {
+                enqueueFrozen(idx);
                 return;
+            }
 
             // mark node as visited
-            aad.lastwalkid = run_id;
-            queue.push(n);
+            if (visits->visit(this->getAnalysisData(n).walkidx)) {
+                if (parents)
+                    parents->add(n, parent, kind);
+                queue.push(n);
+            }
+    }
+
+    // enqueue a node that is reached over an edge of the @k kind
+    // (what kind of an edge it is matters only for the WalkParents)
+    void enqueue(NodeT *n, typename WalkParents<NodeT>::EdgeKind k)
+    {
+        kind = k;
+        enqueue(n);
     }
 
 protected:
+    // does the walk follow the edges given by @flags?
+    // (a constant if the options are the template parameter)
+    bool walks(uint32_t flags) const
+    {
+        return ((OPTIONS == NODES_WALK_RUNTIME_OPTIONS ? options : OPTIONS)
+                & flags) != 0;
+    }
+
     // function that will be called for all the nodes,
     // but is defined by the analysis framework, not
     // by the analysis itself. For example it may
@@ -140,6 +228,85 @@ protected:
     }
 
 private:
+    // add unprocessed vertices
+    void processEdges(NodeT *n)
+    {
+        using ParentsT = WalkParents<NodeT>;
+
+        if (walks(NODES_WALK_CD)) {
+            kind = ParentsT::CD;
+            processEdges(n->control_begin(), n->control_end());
+#ifdef ENABLE_CFG
+            // we can have control dependencies in BBlocks
+            processBBlockCDs(n);
+#endif // ENABLE_CFG
+        }
+
+        if (walks(NODES_WALK_DD)) {
+            kind = ParentsT::DD;
+            processEdges(n->data_begin(), n->data_end());
+        }
+
+        if (walks(NODES_WALK_REV_CD)) {
+            kind = ParentsT::CD;
+            processEdges(n->rev_control_begin(), n->rev_control_end());
+
+#ifdef ENABLE_CFG
+            // we can have control dependencies in BBlocks
+            processBBlockRevCDs(n);
+#endif // ENABLE_CFG
+        }
+
+        if (walks(NODES_WALK_REV_DD)) {
+            kind = ParentsT::DD;
+            if (n->getDG())
+                n->getDG()->ensureDataDependencies();
+
+            processEdges(n->rev_data_begin(), n->rev_data_end());
+        }
+    }
+
+    // the same as processEdges(NodeT *), but over the frozen graph.
+    // The frozen edges contain also the control dependencies of blocks
+    void processFrozenEdges(unsigned idx)
+    {
+        using FrozenT = FrozenGraph<NodeT>;
+        using ParentsT = WalkParents<NodeT>;
+
+        if (walks(NODES_WALK_CD)) {
+            kind = ParentsT::CD;
+            processFrozenEdges(frozen->getEdges(FrozenT::CD, idx));
+        }
+        if (walks(NODES_WALK_DD)) {
+            kind = ParentsT::DD;
+            processFrozenEdges(frozen->getEdges(FrozenT::DD, idx));
+        }
+        if (walks(NODES_WALK_REV_CD)) {
+            kind = ParentsT::CD;
+            processFrozenEdges(frozen->getEdges(FrozenT::REV_CD, idx));
+        }
+        if (walks(NODES_WALK_REV_DD)) {
+            kind = ParentsT::DD;
+            processFrozenEdges(frozen->getEdges(FrozenT::REV_DD, idx));
+        }
+    }
+
+    void processFrozenEdges(typename FrozenGraph<NodeT>::EdgesRange edges)
+    {
+        for (const unsigned *I = edges.first; I != edges.second; ++I)
+            enqueueFrozen(*I);
+    }
+
+    // the frozen nodes are marked by their dense index in the frozen graph
+    void enqueueFrozen(unsigned idx)
+    {
+        if (frozenVisits->visit(idx)) {
+            if (parents)
+                parents->add(frozen->getNode(idx), parent, kind);
+            queue.push(frozen->getNode(idx));
+        }
+    }
+
        template <typename IT>
     void processEdges(IT begin, IT end)
     {
@@ -158,6 +325,10 @@ private:
         if (!BB)
             return;
 
+        if (BB->getDG())
+            BB->getDG()->ensureControlDependencies();
+
+        kind = WalkParents<NodeT>::CD;
         for (BBlock<NodeT> *CD : BB->revControlDependence())
             enqueue(CD->getLastNode());
     }
@@ -168,6 +339,10 @@ private:
         if (!BB)
             return;
 
+        if (BB->getDG())
+            BB->getDG()->ensureControlDependencies();
+
+        kind = WalkParents<NodeT>::CD;
         for (BBlock<NodeT> *CD : BB->controlDependence())
             enqueue(CD->getFirstNode());
     }
@@ -179,6 +354,7 @@ private:
         if (!BB)
             return;
 
+        kind = WalkParents<NodeT>::CFG;
         for (auto& E : BB->successors())
             enqueue(E.target->getFirstNode());
     }
@@ -189,6 +365,7 @@ private:
         if (!BB)
             return;
 
+        kind = WalkParents<NodeT>::CFG;
         for (BBlock<NodeT> *S : BB->predecessors())
             enqueue(S->getLastNode());
     }
@@ -199,15 +376,24 @@ private:
         if (!BB)
             return;
 
+        kind = WalkParents<NodeT>::CFG;
         for (BBlock<NodeT> *S : BB->getPostDomFrontiers())
             enqueue(S->getLastNode());
     }
 #endif // ENABLE_CFG
 
     QueueT queue;
-    // id of particular nodes walk
-    unsigned int run_id;
     uint32_t options;
+    FrozenGraph<NodeT> *frozen;
+    // the marks of the visited nodes, valid only during a walk
+    VisitMarks *visits;
+    VisitMarks *frozenVisits;
+    // how the nodes were reached, if recorded
+    WalkParents<NodeT> *parents;
+    // the node whose edges are processed (its index in the parents)
+    // and the kind of the edges
+    uint32_t parent = 0;
+    typename WalkParents<NodeT>::EdgeKind kind = WalkParents<NodeT>::START;
 };
 
 enum BBlockWalkFlags {
@@ -225,44 +411,22 @@ enum BBlockWalkFlags {
     BBLOCK_NO_CALLSITES             = 1 << 4,
 };
 
-// this is a base class for bblock walk, it contains
-// counter. If we would add counter (even static) into
-// NodesWalk itself, we'd have counter for every
-// NodeT+QueueT instantiation, which we don't want to,
-// because then BFS and DFS would collide
-template <typename NodeT>
-class BBlockWalkBase : public BBlockAnalysis<NodeT>
-{
-protected:
-    // this counter will increase each time we run
-    // NodesWalk, so it can be used as an indicator
-    // that we queued a node in a particular run or not
-    static unsigned int walk_run_counter;
-};
-
-// counter definition
-template<typename NodeT>
-unsigned int BBlockWalkBase<NodeT>::walk_run_counter = 0;
-
 #ifdef ENABLE_CFG
 template <typename NodeT, typename QueueT>
-class BBlockWalk : public BBlockWalkBase<NodeT>
+class BBlockWalk : public BBlockAnalysis<NodeT>
 {
 public:
     using BBlockPtrT = dg::BBlock<NodeT> *;
 
     BBlockWalk<NodeT, QueueT>(uint32_t fl = BBLOCK_WALK_CFG)
-        : flags(fl) {}
+        : flags(fl), visits(nullptr) {}
 
     template <typename FuncT, typename DataT>
     void walk(BBlockPtrT entry, FuncT func, DataT data)
     {
-        queue.push(entry);
-
-        // set up the value of new walk and set it to entry node
-        runid = ++BBlockWalk<NodeT, QueueT>::walk_run_counter;
-        AnalysesAuxiliaryData& aad = this->getAnalysisData(entry);
-        aad.lastwalkid = runid;
+        // the marks of this walk, see NodesWalk::walk()
+        VisitMarks::Guard guard(visits);
+        enqueue(entry);
 
         while (!queue.empty()) {
             BBlockPtrT BB = queue.pop();
@@ -304,11 +468,9 @@ public:
 
     void enqueue(BBlockPtrT BB)
     {
-        AnalysesAuxiliaryData& sad = this->getAnalysisData(BB);
-        if (sad.lastwalkid != runid) {
-            sad.lastwalkid = runid;
+        assert(visits && "Enqueueing a block outside of a walk");
+        if (visits->visit(this->getAnalysisData(BB).walkidx))
             queue.push(BB);
-        }
     }
 
 protected:
@@ -358,7 +520,8 @@ private:
 
     QueueT queue;
     uint32_t flags;
-    unsigned int runid;
+    // the marks of the visited blocks, valid only during a walk
+    VisitMarks *visits;
 };
 
 #endif
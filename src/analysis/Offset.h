@@ -1,6 +1,8 @@
 #ifndef _DG_OFFSET_H_
 #define _DG_OFFSET_H_
 
+#include <cstdint>
+
 namespace dg {
 namespace analysis {
 
@@ -56,6 +58,71 @@ struct Offset
     uint64_t offset;
 };
 
+// Offset packed into 32 bits for the keys of the big tables
+// (the def-sites and the pointers). The offsets that do not fit
+// into 32 bits are taken as unknown, that is sound, but imprecise
+// for objects larger than 4 GB. The interface is that of Offset
+struct CompactOffset
+{
+    static const uint32_t UNKNOWN = ~((uint32_t) 0);
+
+    CompactOffset(uint64_t o = UNKNOWN_OFFSET)
+        : offset(o >= UNKNOWN ? UNKNOWN : static_cast<uint32_t>(o)) {}
+    CompactOffset(const Offset& o) : CompactOffset(*o) {}
+
+    operator Offset() const { return Offset(**this); }
+
+    CompactOffset& operator+=(const CompactOffset& o)
+    {
+        if (isUnknown() || o.isUnknown())
+            offset = UNKNOWN;
+        else
+            *this = CompactOffset(**this + *o);
+
+        return *this;
+    }
+
+    CompactOffset operator+(const CompactOffset& o) const
+    {
+        CompactOffset ret = *this;
+        return ret += o;
+    }
+
+    bool operator<(const CompactOffset& o) const
+    {
+        return offset < o.offset;
+    }
+
+    bool operator==(const CompactOffset& o) const
+    {
+        return offset == o.offset;
+    }
+
+    bool inRange(uint64_t from, uint64_t to) const
+    {
+        return (**this >= from && **this <= to);
+    }
+
+    bool isUnknown() const { return offset == UNKNOWN; }
+
+    uint64_t operator*() const
+    {
+        return isUnknown() ? UNKNOWN_OFFSET : offset;
+    }
+
+    uint32_t offset;
+};
+
+// the offsets in the keys of the big tables. Building with
+// COMPACT_KEYS packs them into 32 bits, so that DefSite and Pointer
+// take less memory (the inputs must not have objects larger than 4 GB
+// for the results to be as precise as without it)
+#ifdef COMPACT_KEYS
+using KeyOffset = CompactOffset;
+#else
+using KeyOffset = Offset;
+#endif
+
 } // namespace analysis
 } // namespace dg
 
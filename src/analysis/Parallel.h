@@ -0,0 +1,135 @@
+#ifndef _DG_ANALYSIS_PARALLEL_H_
+#define _DG_ANALYSIS_PARALLEL_H_
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dg {
+namespace analysis {
+
+///
+// The primitives that the parallel parts of the analyses share.
+// The calling thread always takes part in the work, so one thread
+// means running sequentially without starting any thread.
+//
+// The results do not depend on the number of threads as long as the
+// work of every index (task) writes only its own results and the caller
+// merges them in the order of the indices (or sorts them) afterwards,
+// which is what all the users do.
+
+// run @worker(t) for t in [0, threads) at once, the calling
+// thread runs @worker(0). Returns when all the workers finish
+template <typename FuncT>
+void runThreads(unsigned threads, FuncT worker)
+{
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(worker, t);
+
+    worker(0);
+
+    for (std::thread& t : pool)
+        t.join();
+}
+
+// run @body(i, t) for every i in [0, n) using @threads threads,
+// t is the index of the thread that runs it (see runThreads()), so that
+// the body can use the scratch data of the thread. Every thread takes
+// the next index that was not taken yet, so the uneven items
+// (e.g. functions of very different sizes) balance themselves
+template <typename FuncT>
+void parallelFor(size_t n, unsigned threads, FuncT body)
+{
+    if (threads <= 1 || n <= 1) {
+        for (size_t i = 0; i < n; ++i)
+            body(i, 0U);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    runThreads(threads, [&](unsigned t) {
+        for (size_t i = next++; i < n; i = next++)
+            body(i, t);
+    });
+}
+
+///
+// Tasks that must wait for other tasks (e.g. the strongly connected
+// components of a graph that wait for the components they depend on).
+// run() runs every task once all the tasks it depends on finished,
+// the tasks that do not depend on each other run at the same time.
+// The dependencies must not form a cycle
+class TaskGraph
+{
+    std::vector<std::vector<size_t>> successors;
+    std::vector<size_t> predecessors;
+
+public:
+    TaskGraph(size_t n = 0) : successors(n), predecessors(n, 0) {}
+
+    size_t size() const { return successors.size(); }
+
+    // the task @to must wait for the task @from
+    // (the same dependence must not be added twice)
+    void addDependence(size_t from, size_t to)
+    {
+        assert(from < size() && to < size() && "Invalid task");
+        successors[from].push_back(to);
+        ++predecessors[to];
+    }
+
+    // run @task(i) for all the tasks using @threads threads
+    template <typename FuncT>
+    void run(unsigned threads, FuncT task) const
+    {
+        size_t num = size();
+        std::vector<size_t> waiting(predecessors);
+        std::vector<size_t> ready;
+        for (size_t i = 0; i < num; ++i) {
+            if (waiting[i] == 0)
+                ready.push_back(i);
+        }
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        size_t finished = 0;
+
+        // every thread takes the tasks whose dependencies
+        // finished until all the tasks finish
+        runThreads(threads, [&](unsigned) {
+            std::unique_lock<std::mutex> lock(mtx);
+            while (true) {
+                cv.wait(lock, [&]() { return !ready.empty() || finished == num; });
+                if (ready.empty())
+                    return;
+
+                size_t i = ready.back();
+                ready.pop_back();
+
+                lock.unlock();
+                task(i);
+                lock.lock();
+
+                ++finished;
+                for (size_t s : successors[i]) {
+                    if (--waiting[s] == 0)
+                        ready.push_back(s);
+                }
+
+                cv.notify_all();
+            }
+        });
+
+        assert(finished == num && "Did not run all the tasks (a cycle?)");
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_PARALLEL_H_
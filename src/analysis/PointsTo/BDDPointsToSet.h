@@ -0,0 +1,256 @@
+#ifndef _DG_BDD_POINTS_TO_SET_H_
+#define _DG_BDD_POINTS_TO_SET_H_
+
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+
+#include "ADT/BDD.h"
+#include "analysis/PointsTo/PointsToSet.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Set of pointers kept as a BDD over the ids of the pointers
+// from PointerIdTable. All the sets share one BDDManager, so the sets
+// with many common pointers (e.g. the sets of the pointers to many heap
+// objects that flow to many places) share the most of the memory.
+// The interface is the same as the interface of PointsToSet,
+// the sets are always shared (there is just one representation
+// of every set), so they are compared in constant time.
+//
+// Used instead of PointsToSet when built with -DBDD_POINTS_TO_SETS=ON.
+// The inserting of a single pointer is slower than with the bitvectors,
+// so it pays off only for the programs with huge points-to sets.
+template <typename PointerT, typename HashT>
+class BDDPointsToSet {
+public:
+    // there is no small representation, the limit and isSmall()
+    // are kept for the same interface as PointsToSet has
+    static const size_t SMALL_LIMIT = 16;
+
+private:
+    using TableT = PointerIdTable<PointerT, HashT>;
+    using Ref = ADT::BDDManager::Ref;
+
+    Ref root = ADT::BDDManager::ZERO;
+    // the number of the elements (computing it from the BDD
+    // takes the time linear in the size of the BDD)
+    size_t elems = 0;
+    // the filter of the pointers in the set (see pointerFilterBit()),
+    // so that most of the negative queries do not walk the BDD
+    // (and do not lock the manager)
+    uint64_t filter = 0;
+
+    static TableT& table() { return TableT::instance(); }
+
+    // never destroyed, the sets may be destroyed
+    // during the destruction of static objects
+    static ADT::BDDManager& manager()
+    {
+        static auto *mgr = new ADT::BDDManager();
+        return *mgr;
+    }
+
+    void setRoot(Ref r)
+    {
+        if (r == root)
+            return;
+
+        manager().ref(r);
+        manager().deref(root);
+        root = r;
+    }
+
+public:
+    class const_iterator {
+        Ref root;
+        uint32_t id;
+        bool end;
+
+        void next(uint64_t from)
+        {
+            end = !manager().next(root, from, id);
+        }
+
+    public:
+        const_iterator(const BDDPointsToSet *s, bool e = false)
+        : root(s->root), id(0), end(true)
+        {
+            if (!e)
+                next(0);
+        }
+
+        const PointerT& operator*() const
+        {
+            assert(!end);
+            return table().get(id);
+        }
+
+        const PointerT *operator->() const { return &operator*(); }
+
+        const_iterator& operator++()
+        {
+            next(static_cast<uint64_t>(id) + 1);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp = *this;
+            operator++();
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& oth) const
+        {
+            return root == oth.root && end == oth.end && (end || id == oth.id);
+        }
+
+        bool operator!=(const const_iterator& oth) const
+        {
+            return !operator==(oth);
+        }
+    };
+
+    using iterator = const_iterator;
+
+    BDDPointsToSet() = default;
+    BDDPointsToSet(std::initializer_list<PointerT> lst)
+    {
+        for (const PointerT& p : lst)
+            insert(p);
+    }
+
+    BDDPointsToSet(const BDDPointsToSet& oth)
+    : root(oth.root), elems(oth.elems), filter(oth.filter)
+    {
+        manager().ref(root);
+    }
+
+    BDDPointsToSet(BDDPointsToSet&& oth)
+    : root(oth.root), elems(oth.elems), filter(oth.filter)
+    {
+        oth.root = ADT::BDDManager::ZERO;
+        oth.elems = 0;
+        oth.filter = 0;
+    }
+
+    BDDPointsToSet& operator=(const BDDPointsToSet& oth)
+    {
+        setRoot(oth.root);
+        elems = oth.elems;
+        filter = oth.filter;
+        return *this;
+    }
+
+    BDDPointsToSet& operator=(BDDPointsToSet&& oth)
+    {
+        std::swap(root, oth.root);
+        std::swap(elems, oth.elems);
+        std::swap(filter, oth.filter);
+        return *this;
+    }
+
+    ~BDDPointsToSet() { manager().deref(root); }
+
+    bool insert(const PointerT& p)
+    {
+        Ref r = manager().insert(root, table().getId(p));
+        if (r == root)
+            return false;
+
+        setRoot(r);
+        ++elems;
+        filter |= pointerFilterBit<PointerT, HashT>(p);
+        return true;
+    }
+
+    // merge @oth into this set
+    bool insert(const BDDPointsToSet& oth)
+    {
+        Ref r = manager().unite(root, oth.root);
+        if (r == root)
+            return false;
+
+        setRoot(r);
+        elems = manager().size(root);
+        filter |= oth.filter;
+        return true;
+    }
+
+    size_t erase(const PointerT& p)
+    {
+        unsigned id;
+        if (!table().findId(p, id))
+            return 0;
+
+        Ref r = manager().erase(root, id);
+        if (r == root)
+            return 0;
+
+        setRoot(r);
+        --elems;
+        return 1;
+    }
+
+    size_t count(const PointerT& p) const
+    {
+        if (!(filter & pointerFilterBit<PointerT, HashT>(p)))
+            return 0;
+
+        unsigned id;
+        if (!table().findId(p, id))
+            return 0;
+
+        return manager().contains(root, id);
+    }
+
+    void clear()
+    {
+        setRoot(ADT::BDDManager::ZERO);
+        elems = 0;
+        filter = 0;
+    }
+
+    // the sets are always shared
+    void share() {}
+    bool isShared() const { return true; }
+    bool isSmall() const { return elems <= SMALL_LIMIT; }
+
+    bool operator==(const BDDPointsToSet& oth) const { return root == oth.root; }
+    bool operator!=(const BDDPointsToSet& oth) const { return root != oth.root; }
+
+    size_t size() const { return elems; }
+    bool empty() const { return elems == 0; }
+
+    // the memory of the manager divided among the sets,
+    // so that the sum over all the sets gives the memory used by the BDDs
+    size_t getAllocatedBytes() const
+    {
+        size_t refs = manager().getReferencesNum();
+        return refs == 0 ? 0 : manager().getAllocatedBytes() / refs;
+    }
+
+    const_iterator begin() const { return const_iterator(this); }
+    const_iterator end() const { return const_iterator(this, true); }
+
+    // the sets are going to be used (or are no longer used)
+    // from more threads at once
+    static void setConcurrent(bool c)
+    {
+        table().setConcurrent(c);
+        manager().setConcurrent(c);
+    }
+
+    // the statistics of the shared BDDs
+    static size_t getNodesNum() { return manager().getNodesNum(); }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_BDD_POINTS_TO_SET_H_
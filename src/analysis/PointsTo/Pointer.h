@@ -4,8 +4,14 @@
 #include <map>
 #include <set>
 #include <cassert>
+#include <functional>
+#include <utility>
+#include <vector>
 
 #include "analysis/Offset.h"
+#include "PointsToSet.h"
+#include "BDDPointsToSet.h"
+#include "PointsToMap.h"
 
 namespace dg {
 namespace analysis {
@@ -22,6 +28,14 @@ extern const Pointer PointerNull;
 extern PSNode *NULLPTR;
 extern PSNode *UNKNOWN_MEMORY;
 
+// With COMPACT_KEYS, the pointer is packed into 12 bytes
+// (the target is not aligned to 8 bytes in arrays of pointers)
+#ifdef COMPACT_KEYS
+#define DG_KEY_PACKED __attribute__((packed, aligned(4)))
+#else
+#define DG_KEY_PACKED
+#endif
+
 struct Pointer
 {
     Pointer(PSNode *n, Offset off = 0) : target(n), offset(off)
@@ -30,14 +44,14 @@ struct Pointer
     }
 
     // PSNode that allocated the memory this pointer points-to
-    PSNode *target;
+    PSNode *target DG_KEY_PACKED;
     // offset into the memory it points to
-    Offset offset;
+    KeyOffset offset;
 
-    bool operator<(const Pointer& oth) const
-    {
-        return target == oth.target ? offset < oth.offset : target < oth.target;
-    }
+    // orders the pointers by the ids of the targets, so the sets
+    // of pointers are iterated in the same order in every run.
+    // Defined in PointerSubgraph.h, where PSNode is complete
+    inline bool operator<(const Pointer& oth) const;
 
     bool operator==(const Pointer& oth) const
     {
@@ -49,22 +63,72 @@ struct Pointer
     bool isValid() const { return !isNull() && !isUnknown(); }
 };
 
-using PointsToSetT = std::set<Pointer>;
-using PointsToMapT = std::map<Offset, PointsToSetT>;
+struct PointerHash {
+    size_t operator()(const Pointer& p) const
+    {
+        return std::hash<PSNode *>()(p.target) ^ (*p.offset * 2654435761UL);
+    }
+};
+
+#ifdef COMPACT_KEYS
+static_assert(sizeof(Pointer) == sizeof(PSNode *) + sizeof(uint32_t),
+              "Pointer is not packed");
+#endif
+
+#ifdef BDD_POINTS_TO_SETS
+using PointsToSetT = BDDPointsToSet<Pointer, PointerHash>;
+#else
+using PointsToSetT = PointsToSet<Pointer, PointerHash>;
+#endif
+using PointsToMapT = PointsToMap<PointsToSetT>;
+// the pointers stored at the offsets of a memory before
+// the analysis starts (e.g. in the initializer of a constant global)
+using InitialPointersT = std::vector<std::pair<Offset, Pointer>>;
 using ValuesSetT = std::set<PSNode *>;
 using ValuesMapT = std::map<Offset, ValuesSetT>;
 
 struct MemoryObject
 {
-    MemoryObject(/*uint64_t s = 0, bool isheap = false, */PSNode *n = nullptr)
-        : node(n) /*, is_heap(isheap), size(s)*/ {}
+    MemoryObject(/*uint64_t s = 0, bool isheap = false, */PSNode *n = nullptr,
+                 const FieldLayout *layout = nullptr)
+        : node(n), pointsTo(layout) /*, is_heap(isheap), size(s)*/ {}
 
     // where was this memory allocated? for debugging
     PSNode *node;
     // possible pointers stored in this memory object
+    // (in the slots of the fields if we know the layout)
     PointsToMapT pointsTo;
+    // the object does not distinguish the offsets anymore,
+    // everything is stored at UNKNOWN_OFFSET
+    bool collapsed = false;
+    // increased on every change of the pointers, so that
+    // the users can tell that they have seen all of them
+    unsigned version = 0;
+
+    PointsToSetT& getPointsTo(const Offset& off)
+    {
+        return pointsTo[collapsed ? Offset(UNKNOWN_OFFSET) : off];
+    }
 
-    PointsToSetT& getPointsTo(const Offset& off) { return pointsTo[off]; }
+    // move all the pointers to UNKNOWN_OFFSET and keep them there
+    // (used when the object has too many offsets)
+    void collapse()
+    {
+        PointsToSetT all;
+        for (auto& it : pointsTo)
+            all.insert(it.second);
+
+        pointsTo.clear();
+        pointsTo[UNKNOWN_OFFSET] = std::move(all);
+        collapsed = true;
+        ++version;
+    }
+
+    void addInitialPointers(const InitialPointersT& pointers)
+    {
+        for (const auto& it : pointers)
+            addPointsTo(it.first, it.second);
+    }
 
     bool addPointsTo(const Offset& off, const Pointer& ptr)
     {
@@ -76,7 +140,11 @@ struct MemoryObject
         assert(ptr.target != nullptr
                && "Cannot have NULL target, use unknown instead");
 
-        return pointsTo[off].insert(ptr).second;
+        if (!getPointsTo(off).insert(ptr))
+            return false;
+
+        ++version;
+        return true;
     }
 
     bool addPointsTo(const Offset& off, const PointsToSetT& pointers)
@@ -86,12 +154,11 @@ struct MemoryObject
             return false;
             */
 
-        bool changed = false;
-
-        for (const Pointer& ptr : pointers)
-            changed |= addPointsTo(off, ptr);
+        if (!getPointsTo(off).insert(pointers))
+            return false;
 
-        return changed;
+        ++version;
+        return true;
     }
 
 
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <chrono>
+
 #include "Pointer.h"
 #include "PointerSubgraph.h"
 #include "PointerAnalysis.h"
@@ -20,20 +23,39 @@ const Pointer PointerNull(NULLPTR, 0);
 // to that target, but UNKNOWN_OFFSET
 bool PSNode::addPointsToUnknownOffset(PSNode *target)
 {
-    bool changed = false;
-    for (auto I = pointsTo.begin(), E = pointsTo.end(); I != E;) {
-        auto cur = I++;
+    // the pointers with concrete offsets were erased (and are not
+    // added) once we have the unknown offset, nothing to do
+    if (pointsTo.count(Pointer(target, UNKNOWN_OFFSET)))
+        return false;
+
+    // the saturated set drops all the other pointers
+    // (see setSaturateUnknown())
+    if (saturateUnknown) {
+        if (pointsTo.count(Pointer(UNKNOWN_MEMORY, UNKNOWN_OFFSET)))
+            return false;
+
+        if (target == UNKNOWN_MEMORY) {
+            pointsTo.clear();
+            return insertPointsTo(Pointer(UNKNOWN_MEMORY, UNKNOWN_OFFSET));
+        }
+    }
 
+    bool changed = false;
+    std::vector<Pointer> to_erase;
+    for (const Pointer& ptr : pointsTo) {
         // erase pointers to the same memory but with concrete offset
-        if (cur->target == target && !cur->offset.isUnknown()) {
-            pointsTo.erase(cur);
-            changed = true;
-        }
+        if (ptr.target == target && !ptr.offset.isUnknown())
+            to_erase.push_back(ptr);
     }
 
+    for (const Pointer& ptr : to_erase)
+        pointsTo.erase(ptr);
+
+    changed = !to_erase.empty();
+
     // DONT use addPointsTo() method, it would recursively call
     // this method again, until stack overflow
-    changed |= pointsTo.insert(Pointer(target, UNKNOWN_OFFSET)).second;
+    changed |= insertPointsTo(Pointer(target, UNKNOWN_OFFSET));
 
     return changed;
 }
@@ -69,6 +91,8 @@ bool PointerAnalysis::processLoad(PSNode *node)
         }
 
         for (MemoryObject *o : objects) {
+            objectRead(node, o);
+
             // is the offset to the memory unknown?
             // In that case everything can be referenced,
             // so we need to copy the whole points-to
@@ -137,13 +161,15 @@ bool PointerAnalysis::processMemcpy(PSNode *node)
     std::vector<MemoryObject *> destObjects;
     PSNode *srcNode = node->getOperand(0);
     PSNode *destNode = node->getOperand(1);
+    bool zeroed_dest = false;
 
     /* if one is zero initialized and we copy it whole,
      * set the other zero initialized too */
     if ((!destNode->isZeroInitialized() && srcNode->isZeroInitialized())
-        && ((*node->offset == 0 && node->len.isUnknown())
-            || node->offset.isUnknown())) {
+        && ((*node->getOffset() == 0 && node->getLength().isUnknown())
+            || node->getOffset().isUnknown())) {
         destNode->setZeroInitialized();
+        zeroed_dest = true;
         changed = true;
     }
 
@@ -167,6 +193,15 @@ bool PointerAnalysis::processMemcpy(PSNode *node)
         getMemoryObjects(node, dptr, destObjects);
     }
 
+    // the readers of the destination may now read null pointers
+    if (zeroed_dest) {
+        for (MemoryObject *o : destObjects)
+            objectChanged(o);
+    }
+
+    for (MemoryObject *so : srcObjects)
+        objectRead(node, so);
+
     if (srcObjects.empty()){
         if (srcNode->isZeroInitialized()) {
             // if the memory is zero initialized,
@@ -180,29 +215,36 @@ bool PointerAnalysis::processMemcpy(PSNode *node)
     }
 
     for (MemoryObject *o : destObjects) {
+        bool obj_changed = false;
+
         // copy every pointer from srcObjects that is in
         // the range to these objects
         for (MemoryObject *so : srcObjects) {
-            for (auto& src : so->pointsTo) {
-                // src.first is offset, src.second is a PointToSet
-
-                // we need to copy ptrs at UNKNOWN_OFFSET always
-                if (src.first.isUnknown() || node->offset.isUnknown()) {
-                    changed |= o->addPointsTo(src.first, src.second);
-                    continue;
-                }
+            // copying the object to itself does not change anything
+            if (so == o || !startCopy(node, o, so))
+                continue;
 
-                if (node->len.isUnknown()) {
-                    if (*src.first < *node->offset)
-                        continue;
-                } else {
-                    if (!src.first.inRange(*node->offset,
-                                           *node->offset + *node->len - 1))
-                    continue;
-                }
+            auto copy = [&](const PointsToMapT::value_type& src) {
+                obj_changed |= o->addPointsTo(src.first, src.second);
+            };
 
-                changed |= o->addPointsTo(src.first, src.second);
+            if (node->getOffset().isUnknown()) {
+                for (auto& src : so->pointsTo)
+                    copy(src);
+                continue;
             }
+
+            uint64_t to = UNKNOWN_OFFSET - 1;
+            if (!node->getLength().isUnknown() && *node->getLength() > 0
+                && *node->getOffset() + *node->getLength() - 1 < to)
+                to = *node->getOffset() + *node->getLength() - 1;
+
+            so->pointsTo.forEachInRange(*node->getOffset(), to, copy);
+
+            // we need to copy ptrs at UNKNOWN_OFFSET always
+            auto unknown = so->pointsTo.find(UNKNOWN_OFFSET);
+            if (unknown != so->pointsTo.end())
+                copy(*unknown);
         }
 
         // we need to take care of the case when src is zero initialized,
@@ -219,16 +261,474 @@ bool PointerAnalysis::processMemcpy(PSNode *node)
         // nullptr at UNKNOWN_OFFSET (we may loose precision, but we'll
         // be sound)
         if (srcNode->isZeroInitialized()
-            && !((*node->offset == 0 && node->len.isUnknown())
-                 || node->offset.isUnknown()))
+            && !((*node->getOffset() == 0 && node->getLength().isUnknown())
+                 || node->getOffset().isUnknown()))
             // src is zeroed and we don't copy whole memory?
-            changed |= o->addPointsTo(UNKNOWN_OFFSET, NULLPTR);
+            obj_changed |= o->addPointsTo(UNKNOWN_OFFSET, NULLPTR);
+
+        if (obj_changed) {
+            checkOffsetsBudget(o);
+            objectChanged(o);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// The GEP @node with a stride can point to any offset of @target
+// that differs from @offset by a multiple of the stride. Add all
+// such offsets inside the memory, or UNKNOWN_OFFSET if there are
+// too many of them (or the size of the memory is unknown)
+bool PointerAnalysis::addStridedPointers(PSNode *node, PSNode *target,
+                                         uint64_t offset)
+{
+    uint64_t stride = node->getStride();
+    uint64_t size = target->getSize();
+    uint64_t first = offset % stride;
+
+    if (size == 0 || first >= size
+        || (size - first - 1) / stride >= MAX_STRIDED_OFFSETS)
+        return node->addPointsToUnknownOffset(target);
+
+    bool changed = false;
+    for (uint64_t off = first; off < size; off += stride) {
+        if (off >= max_offset || overOffsetsBudget(target, off))
+            return node->addPointsToUnknownOffset(target) || changed;
+
+        changed |= node->addPointsTo(target, off);
     }
 
     return changed;
 }
 
+// Can the pointer computed by the GEP @gep get back to its operand?
+// Follows the copies of the pointer (and gives up on the pointer
+// stored to memory or when there are too many copies)
+bool PointerAnalysis::mayFlowBack(PSNode *gep)
+{
+    std::set<PSNode *> visited;
+    std::vector<PSNode *> stack{gep};
+
+    while (!stack.empty()) {
+        PSNode *cur = stack.back();
+        stack.pop_back();
+
+        for (PSNode *user : cur->getUsers()) {
+            if (user == gep)
+                return true;
+
+            switch (user->getType()) {
+                case PSNodeType::STORE:
+                case PSNodeType::MEMCPY:
+                case PSNodeType::CALL_FUNCPTR:
+                    return true;
+                case PSNodeType::GEP:
+                case PSNodeType::CAST:
+                case PSNodeType::PHI:
+                case PSNodeType::RETURN:
+                case PSNodeType::CALL_RETURN:
+                    if (visited.insert(user).second)
+                        stack.push_back(user);
+                    break;
+                default:
+                    break;
+            }
+
+            if (visited.size() > MAX_FLOW_BACK_NODES)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// Widen the GEP @gep in a loop: the pointers can be moved
+// by any multiple of the offset, so make it the stride of the GEP
+// (see addStridedPointers()), or remember the stride for later
+// if the widening is delayed
+void PointerAnalysis::widenGEP(PSNode *gep)
+{
+    if (gep->getOffset().isUnknown() || *gep->getOffset() == 0
+        || !mayFlowBack(gep))
+        return;
+
+    uint64_t offset = *gep->getOffset();
+    uint64_t stride = gep->getStride();
+    if (stride > 0) {
+        // the GEP moves the pointers by combinations
+        // of the stride and the offset
+        while (offset != 0) {
+            uint64_t tmp = stride % offset;
+            stride = offset;
+            offset = tmp;
+        }
+    } else
+        stride = offset;
+
+    if (widening_delay > 0)
+        delayed_widening.emplace(gep, DelayedWidening(stride));
+    else
+        gep->setStride(stride);
+}
+
+void PointerAnalysis::delayedWidening(PSNode *gep, PSNode *target)
+{
+    auto it = delayed_widening.find(gep);
+    if (it == delayed_widening.end() || it->second.done)
+        return;
+
+    if (++it->second.moves[target] <= widening_delay)
+        return;
+
+    gep->setStride(it->second.stride);
+    it->second.done = true;
+    it->second.moves.clear();
+}
+
+void PointerAnalysis::preprocessGEPs()
+{
+    // if a GEP is in a loop and the pointer that it computes can get
+    // to its operand again, it moves the pointer by its offset in every
+    // iteration. Widen it right now (or after the delay), that saves
+    // iterations. Without the loops from the builder of the graph,
+    // the loops are the components with more nodes, but with calls
+    // the components of the whole graph are much bigger than the loops
+    delayed_widening.clear();
+    if (PS->hasLoopInfo()) {
+        for (PSNode *n : PS->getReachableNodes()) {
+            if (n->getType() == PSNodeType::GEP && n->isInLoop())
+                widenGEP(n);
+        }
+        return;
+    }
+
+    for (const auto& scc : SCCs) {
+        if (scc.size() <= 1)
+            continue;
+
+        for (PSNode *n : scc) {
+            if (n->getType() == PSNodeType::GEP)
+                widenGEP(n);
+        }
+    }
+}
+
+// Does the memcpy @node need to copy the pointers from @src to @dst?
+// The copied range of @src is the same every time, so once @dst got
+// the pointers of some version of @src, the copy is needed only when
+// @src changes
+bool PointerAnalysis::startCopy(PSNode *node, MemoryObject *dst, MemoryObject *src)
+{
+    std::lock_guard<std::mutex> lock(shared_state_mutex);
+    unsigned& seen = copied[std::make_tuple(node, dst, src)];
+    if (seen == src->version + 1)
+        return false;
+
+    seen = src->version + 1;
+    return true;
+}
+
+// enqueue the nodes that are reachable from @from and that
+// were not processed yet (e.g. subgraphs that were built
+// on calls via function pointers)
+void PointerAnalysis::enqueueNewNodes(PSNode *from)
+{
+    ADT::QueueFIFO<PSNode *> fifo;
+    std::set<PSNode *> visited;
+    fifo.push(from);
+
+    while (!fifo.empty()) {
+        PSNode *cur = fifo.pop();
+        for (PSNode *succ : cur->successors) {
+            if (getFlag(processed, succ) || !visited.insert(succ).second)
+                continue;
+
+            enqueue(succ);
+            fifo.push(succ);
+        }
+    }
+}
+
+void PointerAnalysis::runWorklist()
+{
+    assert(worklist.empty());
+    trackMemoryReaders(true);
+
+    // process every node at least once, in the BFS order
+    for (PSNode *n : PS->getReachableNodes())
+        enqueue(n);
+
+    do {
+        newProgressRound();
+        solveWorklist();
+
+        // add the subgraphs of the functions called via pointers
+        // (that were found until now) and continue with the new nodes
+        if (budget.isExceeded()) {
+            while (!worklist.empty())
+                getFlag(queued, worklist.pop()) = 0;
+            break;
+        }
+
+        for (PSNode *callsite : resolveFunctionPointerCalls()) {
+            enqueueNewNodes(callsite);
+
+            // the return site has a new operand (or a new pointer
+            // from a call of undefined function)
+            PSNode *ret = callsite->getPairedNode();
+            enqueue(ret);
+            for (PSNode *user : ret->getUsers())
+                enqueue(user);
+        }
+    } while (!worklist.empty());
+
+    assert(std::find(queued.begin(), queued.end(), 1) == queued.end());
+    queued.clear();
+    processed.clear();
+    trackMemoryReaders(false);
+}
+
+void PointerAnalysis::solveWorklist()
+{
+    while (!worklist.empty() && !budget.isExceeded()) {
+        PSNode *cur = worklist.pop();
+        getFlag(queued, cur) = 0;
+        char& done = getFlag(processed, cur);
+        bool first_time = !done;
+        done = 1;
+
+        bool mem_changed = beforeProcessed(cur);
+        bool changed = processNodeIfNeeded(cur);
+
+        // the memory that the node works with changed
+        // after processing it, so we must process it again
+        if (afterProcessed(cur)) {
+            mem_changed = true;
+            enqueue(cur);
+        }
+
+        // the successors that were processed before this node
+        // (e.g. loop headers) have not seen its state yet
+        if (first_time) {
+            for (PSNode *succ : cur->getSuccessors()) {
+                if (getFlag(processed, succ))
+                    enqueue(succ);
+            }
+        }
+
+        if (changed) {
+            for (PSNode *user : cur->getUsers())
+                enqueue(user);
+
+            PSNodeType type = cur->getType();
+            if (type == PSNodeType::STORE || type == PSNodeType::MEMCPY)
+                mem_changed = true;
+        }
+
+        if (mem_changed)
+            memoryChanged(cur);
+
+        reportProgress(worklist.size());
+    }
+}
+
+// (re)compute the strongly connected components of the whole graph.
+// The graph may have changed since the last computation (e.g. because
+// of calls via function pointers), otherwise the components are kept
+void PointerAnalysis::computeSCCs()
+{
+    unsigned long version = PSNode::getEdgesVersion();
+    if (!SCCs.empty() && SCCsRoot == PS->getRoot() && SCCsVersion == version)
+        return;
+
+    SCC<PSNode> scc_comp;
+    SCCs = std::move(scc_comp.compute(PS->getRoot()));
+    SCCsRoot = PS->getRoot();
+    SCCsVersion = version;
+
+    // SCCs are in reverse topological order
+    std::reverse(SCCs.begin(), SCCs.end());
+    // tarjan's algorithm pops the nodes from the stack,
+    // so the components are in reverse order of the DFS
+    for (auto& comp : SCCs)
+        std::reverse(comp.begin(), comp.end());
+}
+
+void PointerAnalysis::solveComponent(const std::vector<PSNode *>& comp)
+{
+    PSNode *first = comp.front();
+    bool cyclic = comp.size() > 1
+                  || std::find(first->successors.begin(),
+                               first->successors.end(),
+                               first) != first->successors.end();
+
+    bool again;
+    do {
+        again = false;
+        for (PSNode *cur : comp) {
+            bool enq = beforeProcessed(cur);
+            bool ch = processNodeIfNeeded(cur);
+
+            // the memory that the node works with changed
+            // after processing it, so we must process it again
+            if (afterProcessed(cur))
+                again = true;
+
+            // other nodes from the loop may use the new information
+            if (cyclic && (enq || ch))
+                again = true;
+        }
+    } while (again && !budget.isExceeded());
+}
+
+bool PointerAnalysis::runSCCPass()
+{
+    statistics.newRound();
+    newProgressRound();
+
+    computeSCCs();
+
+    if (threads > 1) {
+        runSCCPassParallel();
+        size_t nodes = 0;
+        for (const auto& comp : SCCs)
+            nodes += comp.size();
+        reportProgress(0, nodes);
+    } else {
+        for (size_t i = 0; i < SCCs.size(); ++i) {
+            if (budget.isExceeded())
+                break;
+            solveComponent(SCCs[i]);
+            // the waiting nodes are not counted, report the components
+            reportProgress(SCCs.size() - i - 1, SCCs[i].size());
+        }
+    }
+
+    if (budget.isExceeded())
+        return false;
+
+    // the new parts of the graph are not in any component yet,
+    // so we must do the pass again
+    return !resolveFunctionPointerCalls().empty();
+}
+
+void PointerAnalysis::runSCC()
+{
+    // if the graph changed, the components changed too,
+    // so we must compute them again and redo the pass
+    while (runSCCPass())
+        ;
+}
+
+void PointerAnalysis::writeProgress(uint64_t waiting)
+{
+    Progress::Report report;
+    report.round = progress_round;
+    report.worklist = waiting;
+    report.processed = progress_processed;
+    for (PSNode *n : PS->getReachableNodes())
+        report.sets += n->pointsTo.size();
+
+    progress.report(report);
+}
+
+std::vector<PSNode *> PointerAnalysis::resolveFunctionPointerCalls()
+{
+    std::vector<PSNode *> callsites;
+    std::set<PSNode *> seen;
+
+    std::vector<std::pair<PSNode *, PSNode *>> calls;
+    calls.swap(pending_calls);
+
+    for (auto& call : calls) {
+        if (functionPointerCall(call.first, call.second)
+            && seen.insert(call.first).second)
+            callsites.push_back(call.first);
+    }
+
+    return callsites;
+}
+
 bool PointerAnalysis::processNode(PSNode *node)
+{
+    if (saturate_unknown)
+        node->setSaturateUnknown();
+
+    budget.tick();
+
+    DG_TRACE2(pta_node_begin, node, static_cast<int>(node->getType()));
+
+    if (!statistics.enabled) {
+        bool changed = processNodeInternal(node);
+        DG_TRACE2(pta_node_end, node, changed);
+        return changed;
+    }
+
+    size_t size = node->pointsTo.size();
+    auto start = std::chrono::steady_clock::now();
+    bool changed = processNodeInternal(node);
+    auto time = std::chrono::steady_clock::now() - start;
+    size_t new_size = node->pointsTo.size();
+    DG_TRACE2(pta_node_end, node, changed);
+
+    std::lock_guard<std::mutex> lock(shared_state_mutex);
+    statistics.nodeProcessed(node, changed,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+        new_size > size ? new_size - size : 0);
+
+    return changed;
+}
+
+bool PointerAnalysis::processNodeIfNeeded(PSNode *node)
+{
+    if (!node->isTopLevel() || node->hasNewOperandPointsTo())
+        return processNode(node);
+
+    if (statistics.enabled) {
+        std::lock_guard<std::mutex> lock(shared_state_mutex);
+        ++statistics.topLevelSkipped;
+    }
+
+    return false;
+}
+
+bool PointerAnalysis::overOffsetsBudget(PSNode *target, uint64_t offset)
+{
+    if (offsets_budget == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(shared_state_mutex);
+    if (collapsed_targets.count(target))
+        return true;
+
+    std::set<uint64_t>& offsets = target_offsets[target];
+    offsets.insert(offset);
+    if (offsets.size() <= offsets_budget)
+        return false;
+
+    // from now on, all new pointers to the target
+    // will have UNKNOWN_OFFSET
+    target_offsets.erase(target);
+    collapsed_targets.insert(target);
+    ++statistics.collapsedTargetsNum;
+
+    return true;
+}
+
+void PointerAnalysis::checkOffsetsBudget(MemoryObject *o)
+{
+    if (offsets_budget == 0 || o->collapsed
+        || o->pointsTo.size() <= offsets_budget)
+        return;
+
+    o->collapse();
+
+    std::lock_guard<std::mutex> lock(shared_state_mutex);
+    ++statistics.collapsedObjectsNum;
+}
+
+bool PointerAnalysis::processNodeInternal(PSNode *node)
 {
     bool changed = false;
     std::vector<MemoryObject *> objects;
@@ -252,34 +752,51 @@ bool PointerAnalysis::processNode(PSNode *node)
                 objects.clear();
                 getMemoryObjects(node, ptr, objects);
                 for (MemoryObject *o : objects) {
+                    bool obj_changed = false;
                     for (const Pointer& to : node->getOperand(0)->pointsTo)
-                        changed |= o->addPointsTo(ptr.offset, to);
+                        obj_changed |= o->addPointsTo(ptr.offset, to);
+
+                    if (obj_changed) {
+                        checkOffsetsBudget(o);
+                        objectChanged(o);
+                        changed = true;
+                    }
                 }
             }
             break;
         case PSNodeType::GEP:
-            for (const Pointer& ptr : node->getOperand(0)->pointsTo) {
+            // the operands are processed only for the pointers
+            // that the node did not see yet
+            changed |= node->forNewPointsTo(0, [&](const Pointer& ptr) {
+                if (!delayed_widening.empty())
+                    delayedWidening(node, ptr.target);
+
                 uint64_t new_offset;
-                if (ptr.offset.isUnknown() || node->offset.isUnknown())
+                if (ptr.offset.isUnknown() || node->getOffset().isUnknown())
                     // set it like this to avoid overflow when adding
                     new_offset = UNKNOWN_OFFSET;
                 else
-                    new_offset = *ptr.offset + *node->offset;
+                    new_offset = *ptr.offset + *node->getOffset();
+
+                if (node->getStride() > 0 && new_offset != UNKNOWN_OFFSET)
+                    return addStridedPointers(node, ptr.target, new_offset);
 
                 // in the case PSNodeType::the memory has size 0, then every pointer
                 // will have unknown offset with the exception that it points
                 // to the begining of the memory - therefore make 0 exception
                 if ((new_offset == 0 || new_offset < ptr.target->getSize())
-                    && new_offset < max_offset)
-                    changed |= node->addPointsTo(ptr.target, new_offset);
+                    && new_offset < max_offset
+                    && !overOffsetsBudget(ptr.target, new_offset))
+                    return node->addPointsTo(ptr.target, new_offset);
                 else
-                    changed |= node->addPointsToUnknownOffset(ptr.target);
-            }
+                    return node->addPointsToUnknownOffset(ptr.target);
+            });
             break;
         case PSNodeType::CAST:
             // cast only copies the pointers
-            for (const Pointer& ptr : node->getOperand(0)->pointsTo)
-                changed |= node->addPointsTo(ptr);
+            changed |= node->forNewPointsTo(0, [node](const Pointer& ptr) {
+                return node->addPointsTo(ptr);
+            });
             break;
         case PSNodeType::CONSTANT:
             // maybe warn? It has no sense to insert the constants into the graph.
@@ -293,26 +810,30 @@ bool PointerAnalysis::processNode(PSNode *node)
             // gather pointers returned from subprocedure - the same way
             // as PHI works
         case PSNodeType::PHI:
-            for (PSNode *op : node->operands)
-                changed |= node->addPointsTo(op->pointsTo);
+            for (size_t i = 0; i < node->getOperandsNum(); ++i) {
+                changed |= node->forNewPointsTo(i, [node](const Pointer& ptr) {
+                    return node->addPointsTo(ptr);
+                });
+            }
             break;
         case PSNodeType::CALL_FUNCPTR:
             // call via function pointer:
             // first gather the pointers that can be used to the
             // call and if something changes, let backend take some action
-            // (for example build relevant subgraph)
-            for (const Pointer& ptr : node->getOperand(0)->pointsTo) {
-                if (node->addPointsTo(ptr)) {
-                    changed = true;
-
-                    if (ptr.isValid()) {
-                        functionPointerCall(node, ptr.target);
-                    } else {
-                        error(node, "Calling invalid pointer as a function!");
-                        continue;
-                    }
-                }
-            }
+            // (for example build relevant subgraph). The graph is changed
+            // later for all the new calls at once
+            changed |= node->forNewPointsTo(0, [&](const Pointer& ptr) {
+                if (!node->addPointsTo(ptr))
+                    return false;
+
+                if (ptr.isValid()) {
+                    std::lock_guard<std::mutex> lock(shared_state_mutex);
+                    pending_calls.emplace_back(node, ptr.target);
+                } else
+                    error(node, "Calling invalid pointer as a function!");
+
+                return true;
+            });
             break;
         case PSNodeType::MEMCPY:
             changed |= processMemcpy(node);
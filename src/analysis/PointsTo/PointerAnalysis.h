@@ -3,12 +3,23 @@
 
 #include <cassert>
 #include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 
 #include "Pointer.h"
 #include "PointerSubgraph.h"
+#include "PointerAnalysisStatistics.h"
 #include "ADT/Queue.h"
+#include "ADT/DGContainer.h"
 
 #include "analysis/SCC.h"
+#include "analysis/Budget.h"
+#include "analysis/Progress.h"
+#include "analysis/Tracepoints.h"
+#include "analysis/MemoryUsage.h"
 
 namespace dg {
 namespace analysis {
@@ -18,45 +29,196 @@ namespace pta {
 extern PSNode *NULLPTR;
 extern PSNode *UNKNOWN_MEMORY;
 
+// how the nodes are scheduled during the fixpoint computation
+enum class PTASchedule {
+    // in every round, process all nodes that are
+    // reachable from the nodes changed in the previous round
+    ROUNDS,
+    // process only the nodes whose inputs (operands
+    // or memory) changed
+    WORKLIST,
+    // process the strongly connected components of the
+    // PointerSubgraph in topological order and iterate
+    // only inside the components that contain a cycle
+    SCC,
+};
+
 class PointerAnalysis
 {
     // the pointer state subgraph
     PointerSubgraph *PS;
 
     // strongly connected components of the PointerSubgraph
+    // in topological order, computed for the root and the edges
+    // that the graph had when @SCCsVersion was the edges version
     std::vector<std::vector<PSNode *> > SCCs;
+    PSNode *SCCsRoot = nullptr;
+    unsigned long SCCsVersion = 0;
 
     // Maximal offset that we want to keep
     // within a pointer.
     // Default is unconstrained (UNKNOWN_OFFSET)
     uint64_t max_offset;
 
+    // Maximal number of different offsets in the pointers to one target
+    // (or in one memory object). Targets and objects with more offsets
+    // are collapsed to UNKNOWN_OFFSET. Default is unconstrained (0)
+    unsigned offsets_budget;
+    // the offsets of the pointers to the targets that are not collapsed
+    std::unordered_map<PSNode *, std::set<uint64_t>> target_offsets;
+    std::set<PSNode *> collapsed_targets;
+
+    // the GEPs in loops are widened (get a stride) once they moved
+    // the pointers to one target this many times (see preprocessGEPs())
+    unsigned widening_delay = 0;
+    // the strides of the GEPs whose widening is delayed and how many
+    // times the GEP moved the pointers to the targets. The entries
+    // are created before the run, so the nodes processed at once
+    // touch only their own entries
+    struct DelayedWidening {
+        uint64_t stride;
+        bool done = false;
+        std::unordered_map<PSNode *, unsigned> moves;
+
+        DelayedWidening(uint64_t s) : stride(s) {}
+    };
+    std::unordered_map<PSNode *, DelayedWidening> delayed_widening;
+
     // Flow sensitive flag (contol loop optimization execution)
     bool preprocess_geps;
 
+    // collapse the points-to sets of the nodes that point
+    // to unknown memory (see PSNode::setSaturateUnknown())
+    bool saturate_unknown = false;
+
+    PTASchedule schedule;
+
+    // number of threads used by the SCC schedule
+    unsigned threads;
+
+    // state of the WORKLIST schedule
+    ADT::QueueFIFO<PSNode *> worklist;
+    // flags of the nodes indexed by their ids
+    std::vector<char> queued;
+    std::vector<char> processed;
+    // get the flag of @n, the nodes can be created during the analysis
+    // (on calls via function pointers), so grow the vector on demand
+    static char& getFlag(std::vector<char>& flags, const PSNode *n)
+    {
+        if (n->getID() >= flags.size())
+            flags.resize(PSNode::getLastID() + 1, 0);
+        return flags[n->getID()];
+    }
+
+    // nodes that read given memory object
+    std::map<MemoryObject *, std::set<PSNode *, NodeIDLess>> readers;
+    bool track_readers;
+
+    // the versions of the source objects (plus one) that the memcpy
+    // nodes copied to the destination objects, see processMemcpy
+    std::map<std::tuple<PSNode *, MemoryObject *, MemoryObject *>, unsigned> copied;
+
+    // calls via function pointers (callsite, called function)
+    // that were not added into the graph yet
+    std::vector<std::pair<PSNode *, PSNode *>> pending_calls;
+
 protected:
     // a set of changed nodes that are going to be
     // processed by the analysis
     std::vector<PSNode *> to_process;
     std::vector<PSNode *> changed;
 
+    // keep track of the nodes that read memory objects. When a memory
+    // object changes, its readers are enqueued (used by solvers that
+    // do not process all the reachable nodes again)
+    void trackMemoryReaders(bool track)
+    {
+        track_readers = track;
+        if (!track)
+            readers.clear();
+    }
+
+    PointerAnalysisStatistics statistics;
+    // checked in processNode(), the solvers stop
+    // once it is exceeded (see setBudget())
+    Budget budget;
+    // periodic reports of the run (see setProgress())
+    Progress progress;
+    uint64_t progress_round = 0;
+    uint64_t progress_processed = 0;
+
+    void startProgress()
+    {
+        progress.start("points-to");
+        progress_round = progress_processed = 0;
+    }
+
+    void newProgressRound()
+    {
+        endProgressRound();
+        ++progress_round;
+        DG_TRACE1(pta_round_begin, progress_round);
+    }
+
+    void endProgressRound()
+    {
+        if (progress_round > 0)
+            DG_TRACE1(pta_round_end, progress_round);
+    }
+
+    // ends the last round of a run when the run returns
+    struct RoundsScope {
+        PointerAnalysis *analysis;
+        ~RoundsScope() { analysis->endProgressRound(); }
+    };
+
+    // @n more nodes were processed and @waiting nodes wait for processing.
+    // Called only from the sequential parts of the solvers
+    void reportProgress(uint64_t waiting, uint64_t n = 1)
+    {
+        progress_processed += n;
+        if (progress.tick())
+            writeProgress(waiting);
+    }
+
+    void writeProgress(uint64_t waiting);
+
+    // guards the state that is shared by the nodes in the parallel
+    // SCC schedule (statistics and creating memory objects)
+    std::mutex shared_state_mutex;
+
+    bool processNode(PSNode *);
+    // processNode() that skips the top-level nodes whose operands
+    // did not get new pointers (see PSNode::isTopLevel()), so that
+    // the rounds spend the work on the nodes that access memory
+    bool processNodeIfNeeded(PSNode *);
+
+    // add the subgraphs of functions called via pointers into the graph.
+    // The solvers call it once in a while instead of changing the graph
+    // on every new target of a call, so that they can update their state
+    // for all the new calls at once. Returns the callsites that changed
+    std::vector<PSNode *> resolveFunctionPointerCalls();
+
     // protected constructor for child classes
     PointerAnalysis() : PS(nullptr), max_offset(UNKNOWN_OFFSET),
-                         preprocess_geps(true) {}
+                         offsets_budget(0), preprocess_geps(true),
+                         schedule(PTASchedule::ROUNDS), threads(1),
+                         track_readers(false) {}
 
 public:
     PointerAnalysis(PointerSubgraph *ps,
                     uint64_t max_off = UNKNOWN_OFFSET,
                     bool prepro_geps = true)
-    : PS(ps), max_offset(max_off), preprocess_geps(prepro_geps)
+    : PS(ps), max_offset(max_off), offsets_budget(0),
+      preprocess_geps(prepro_geps),
+      schedule(PTASchedule::ROUNDS), threads(1), track_readers(false)
     {
         assert(PS && "Need valid PointerSubgraph object");
 
         // compute the strongly connected components
-        if (prepro_geps) {
-            SCC<PSNode> scc_comp;
-            SCCs = std::move(scc_comp.compute(PS->getRoot()));
-        }
+        // (the loops are known without them)
+        if (prepro_geps && !PS->hasLoopInfo())
+            computeSCCs();
     }
 
     virtual ~PointerAnalysis() {}
@@ -87,59 +249,208 @@ public:
         return false;
     }
 
+    // hook for the WORKLIST schedule - the memory state at the node
+    // may have changed, enqueue the nodes that depend on it.
+    // The readers of changed memory objects are enqueued by
+    // the analysis itself, so flow-insensitive analysis
+    // does not need to do anything here
+    virtual void memoryChanged(PSNode *) {}
+
     PointerSubgraph *getPS() const { return PS; }
 
-    void preprocessGEPs()
-    {
-        // if a node is in a loop (a scc that has more than one node),
-        // then every GEP that is also stored to the same memory afterwards
-        // in the loop will end up with UNKNOWN_OFFSET after some
-        // number of iterations, so we can do that right now
-        // and save iterations
-        for (const auto& scc : SCCs) {
-            if (scc.size() > 1) {
-                for (PSNode *n : scc) {
-                    if (n->getType() == PSNodeType::GEP)
-                        n->setOffset(UNKNOWN_OFFSET);
-                }
-            }
-        }
+    void setSchedule(PTASchedule s) { schedule = s; }
+    PTASchedule getSchedule() const { return schedule; }
+
+    // solve independent components of the SCC schedule in parallel
+    // using @n threads (and the nodes of big components, if the analysis
+    // allows it). The results are the same as with one thread
+    void setThreads(unsigned n) { threads = n ? n : 1; }
+    unsigned getThreads() const { return threads; }
+
+    // collapse the targets and memory objects
+    // with more than @b offsets (0 is unconstrained)
+    void setOffsetsBudget(unsigned b) { offsets_budget = b; }
+    unsigned getOffsetsBudget() const { return offsets_budget; }
+
+    // widen the GEPs in loops only after they moved the pointers
+    // to one target @d times (0 widens them before the run), so that
+    // the GEPs whose pointers do not really move in the loop (e.g. the
+    // pointer is loaded again in every iteration) keep the exact offsets
+    void setWideningDelay(unsigned d) { widening_delay = d; }
+    unsigned getWideningDelay() const { return widening_delay; }
+
+    // the points-to set of a node collapses to the unknown pointer
+    // once it contains the unknown pointer, the pointers added later
+    // are ignored. Bounds the sets, but the unknown pointer
+    // is not accompanied by the concrete pointers anymore
+    void setSaturateUnknown(bool s = true) { saturate_unknown = s; }
+    bool isSaturateUnknown() const { return saturate_unknown; }
+    bool isCollapsed(PSNode *target) const
+    {
+        return collapsed_targets.count(target) > 0;
     }
 
+    // the time and memory limits of run(). Once they are exceeded,
+    // the analysis stops and its results are incomplete (unsound),
+    // the user must fall back to a cheaper analysis (see isBudgetExceeded())
+    void setBudget(const Budget& b) { budget = b; }
+    const Budget& getBudget() const { return budget; }
+    bool isBudgetExceeded() const { return budget.isExceeded(); }
+
+    // report the round, the size of the worklist, the sizes of the points-to
+    // sets, the memory and the rates of processing periodically during run()
+    void setProgress(const Progress& p) { progress = p; }
+
+    void collectStatistics(bool enable = true) { statistics.enabled = enable; }
+    const PointerAnalysisStatistics& getStatistics() const { return statistics; }
+
+    // add the approximate memory used by the data of the analysis
+    // (memory objects, memory maps) to @mu. The nodes
+    // of the PointerSubgraph are not counted here
+    virtual void getMemoryUsage(MemoryUsage& mu) const { (void) mu; }
+
+    static void addMemoryUsage(MemoryUsage& mu, const MemoryObject *mo)
+    {
+        size_t bytes = sizeof(MemoryObject) + mo->pointsTo.getAllocatedBytes();
+        for (const auto& it : mo->pointsTo)
+            bytes += it.second.getAllocatedBytes();
+
+        mu.add("memory objects", 1, bytes);
+    }
+
+    // the nodes with ids up to @lastID exist. The analyses that keep
+    // the data of nodes in tables indexed by the ids (see NodeTable)
+    // make room for all of them here, so that the tables do not grow
+    // while more threads process the nodes
+    virtual void reserveNodes(unsigned lastID) { (void) lastID; }
+
+    // can the nodes of one component of the SCC schedule be processed
+    // at once (see setThreads())? Only if the nodes read only their
+    // operands and the memory objects, not a state that is passed along
+    // the edges of the graph (the memory maps of flow-sensitive analyses)
+    virtual bool canProcessNodesConcurrently() const { return false; }
+
+    // let the identical points-to sets use one copy of the data
+    // (after the analysis, the changed sets get their own copy again)
+    virtual void sharePointsToSets()
+    {
+        for (PSNode *n : PS->getReachableNodes())
+            n->pointsTo.share();
+    }
+
+    void preprocessGEPs();
+
     virtual void enqueue(PSNode *n)
     {
-        changed.push_back(n);
+        if (schedule == PTASchedule::WORKLIST) {
+            char& q = getFlag(queued, n);
+            if (!q) {
+                q = 1;
+                worklist.push(n);
+            }
+        } else
+            changed.push_back(n);
+    }
+
+    virtual void run() { runWith(this); }
+
+    // generic error
+    // @msg - message for the user
+    // XXX: maybe create some enum that will represent the error
+    virtual bool error(PSNode * /*at*/, const char * /*msg*/)
+    {
+        // let this on the user - in flow-insensitive analysis this is
+        // no error, but in flow sensitive it is ...
+        return false;
+    }
+
+    // handle specific situation (error) in the analysis
+    // @return whether the function changed the some points-to set
+    //  (e. g. added pointer to unknown memory)
+    virtual bool errorEmptyPointsTo(PSNode * /*from*/, PSNode * /*to*/)
+    {
+        // let this on the user - in flow-insensitive analysis this is
+        // no error, but in flow sensitive it is ...
+        return false;
+    }
+
+    // adjust the PointerSubgraph on function pointer call
+    // @ where is the callsite
+    // @ what is the function that is being called
+    virtual bool functionPointerCall(PSNode * /*where*/, PSNode * /*what*/)
+    {
+        return false;
     }
 
-    void run()
+protected:
+    // run() that calls the hooks (beforeProcessed, afterProcessed
+    // and enqueue) of the fixpoint loop through @analysis, which is
+    // this analysis. When AnalysisT is a final class, the calls are
+    // not virtual and the hooks are inlined into the loop
+    // (the hooks that the analysis does not override compile away)
+    template <typename AnalysisT>
+    void runWith(AnalysisT *analysis)
     {
+        assert(analysis == this);
+
         PSNode *root = PS->getRoot();
         assert(root && "Do not have root of PS");
 
+        budget.start();
+        startProgress();
+        RoundsScope rounds{this};
+
         // do some optimizations
         if (preprocess_geps)
             preprocessGEPs();
 
-        // rely on C++11 move semantics
-        to_process = PS->getNodes(root);
+        if (schedule == PTASchedule::WORKLIST) {
+            runWorklist();
+            return;
+        }
+
+        if (schedule == PTASchedule::SCC) {
+            runSCC();
+            return;
+        }
+
+        // the subgraph keeps the order, so this is only a copy
+        to_process = PS->getReachableNodes();
 
         // do fixpoint
         do {
             unsigned last_processed_num = to_process.size();
             changed.clear();
+            statistics.newRound();
+            newProgressRound();
 
-            for (PSNode *cur : to_process) {
+            for (size_t i = 0; i < to_process.size(); ++i) {
+                PSNode *cur = to_process[i];
                 bool enq = false;
-                enq |= beforeProcessed(cur);
-                enq |= processNode(cur);
-                enq |= afterProcessed(cur);
+                enq |= analysis->beforeProcessed(cur);
+                enq |= processNodeIfNeeded(cur);
+                enq |= analysis->afterProcessed(cur);
 
                 if (enq)
-                    enqueue(cur);
+                    analysis->enqueue(cur);
+
+                reportProgress(to_process.size() - i - 1);
+
+                if (budget.isExceeded())
+                    break;
             }
 
             to_process.clear();
 
+            if (budget.isExceeded()) {
+                changed.clear();
+                return;
+            }
+
+            // the callsites are in changed already, so the subgraphs
+            // of the new called functions will be processed
+            resolveFunctionPointerCalls();
+
             if (!changed.empty()) {
                 // DONT std::move - it prevents compiler from copy ellision
                 to_process = PS->getNodes(nullptr /* starting node */,
@@ -157,36 +468,61 @@ public:
         assert(changed.empty());
     }
 
-    // generic error
-    // @msg - message for the user
-    // XXX: maybe create some enum that will represent the error
-    virtual bool error(PSNode * /*at*/, const char * /*msg*/)
+private:
+    void runWorklist();
+    void solveWorklist();
+    void enqueueNewNodes(PSNode *from);
+
+    void computeSCCs();
+    // solve the whole graph (one pass over the components),
+    // return true if the graph changed during the pass
+    bool runSCCPass();
+    // solve the components of runSCCPass() with more threads
+    void runSCCPassParallel();
+    void runSCC();
+    // solve one component
+    void solveComponent(const std::vector<PSNode *>& comp);
+    // solve one component whose nodes are split into waves
+    // of nodes that are processed at once
+    void solveComponentInWaves(const std::vector<std::vector<PSNode *>>& waves);
+
+    void objectRead(PSNode *node, MemoryObject *o)
     {
-        // let this on the user - in flow-insensitive analysis this is
-        // no error, but in flow sensitive it is ...
-        return false;
+        if (track_readers)
+            readers[o].insert(node);
     }
 
-    // handle specific situation (error) in the analysis
-    // @return whether the function changed the some points-to set
-    //  (e. g. added pointer to unknown memory)
-    virtual bool errorEmptyPointsTo(PSNode * /*from*/, PSNode * /*to*/)
+    void objectChanged(MemoryObject *o)
     {
-        // let this on the user - in flow-insensitive analysis this is
-        // no error, but in flow sensitive it is ...
-        return false;
-    }
+        if (!track_readers)
+            return;
 
-    // adjust the PointerSubgraph on function pointer call
-    // @ where is the callsite
-    // @ what is the function that is being called
-    virtual bool functionPointerCall(PSNode * /*where*/, PSNode * /*what*/)
-    {
-        return false;
+        auto it = readers.find(o);
+        if (it != readers.end()) {
+            for (PSNode *r : it->second)
+                enqueue(r);
+        }
     }
 
-private:
-    bool processNode(PSNode *);
+    // does a new pointer to @target with @offset exceed the budget?
+    bool overOffsetsBudget(PSNode *target, uint64_t offset);
+    void checkOffsetsBudget(MemoryObject *o);
+    bool startCopy(PSNode *node, MemoryObject *dst, MemoryObject *src);
+
+    // a GEP with a stride adds pointers to at most this many offsets
+    // of a memory, it adds UNKNOWN_OFFSET for bigger memory
+    static const uint64_t MAX_STRIDED_OFFSETS = 32;
+    // mayFlowBack() gives up after following this many copies
+    static const size_t MAX_FLOW_BACK_NODES = 1000;
+
+    bool addStridedPointers(PSNode *node, PSNode *target, uint64_t offset);
+    bool mayFlowBack(PSNode *gep);
+    void widenGEP(PSNode *gep);
+    // the GEP @gep moves a pointer to @target, widen it if it did
+    // that more times than the widening delay
+    void delayedWidening(PSNode *gep, PSNode *target);
+
+    bool processNodeInternal(PSNode *node);
     bool processLoad(PSNode *node);
     bool processMemcpy(PSNode *node);
 };
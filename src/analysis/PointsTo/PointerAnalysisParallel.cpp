@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "PointerAnalysis.h"
+#include "PointsToSteensgaard.h"
+#include "analysis/Parallel.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+using MemoryClass = const PointsToSteensgaard::ECR *;
+
+// the components with at least this many nodes are split into waves
+// of nodes that are processed at once (see computeWaves())
+static const size_t PARALLEL_COMPONENT_SIZE = 64;
+
+// the classes of memory that the node @n reads and writes.
+// With the offsets budget, GEPs change the state of their targets
+// (the offsets and whether the target is collapsed)
+static void getAccessedMemory(PointsToSteensgaard& classes, PSNode *n,
+                              bool offsets_budget,
+                              std::set<MemoryClass>& reads,
+                              std::set<MemoryClass>& writes)
+{
+    switch (n->getType()) {
+        case PSNodeType::GEP:
+            if (offsets_budget)
+                writes.insert(classes.getMemoryClass(n->getOperand(0)));
+            break;
+        case PSNodeType::LOAD:
+            reads.insert(classes.getMemoryClass(n->getOperand(0)));
+            break;
+        case PSNodeType::MEMCPY:
+            reads.insert(classes.getMemoryClass(n->getOperand(0)));
+            // fall-through
+        case PSNodeType::STORE:
+            writes.insert(classes.getMemoryClass(n->getOperand(1)));
+            break;
+        default:
+            break;
+    }
+}
+
+static void getAccessedMemory(PointsToSteensgaard& classes,
+                              const std::vector<PSNode *>& comp,
+                              bool offsets_budget,
+                              std::set<MemoryClass>& reads,
+                              std::set<MemoryClass>& writes)
+{
+    for (PSNode *n : comp)
+        getAccessedMemory(classes, n, offsets_budget, reads, writes);
+}
+
+///
+// Compute which components must be solved before which. The components
+// are in topological order and the solver processes them in this order,
+// so the component @j must wait for the component @i < @j if:
+//
+//  - there is an edge from @i to @j in the condensation graph,
+//  - the nodes of @j use the nodes of @i as operands (or vice versa,
+//    then the component that is first must be solved first, because
+//    the other one changes the operand),
+//  - they access the same memory (according to Steensgaard pre-analysis)
+//    and at least one of them writes to it,
+//  - one of them contains a call via function pointer, the new calls
+//    are queued and added into the graph in the order they were found.
+//
+// The other pairs of components do not see each other at all,
+// so they can be solved in any order (and at the same time)
+// and the results are the same as when solved one by one.
+static void computeDependencies(PointsToSteensgaard& classes,
+                                const std::vector<std::vector<PSNode *>>& SCCs,
+                                bool offsets_budget,
+                                std::vector<std::set<size_t>>& preds)
+{
+    const size_t NONE = ~static_cast<size_t>(0);
+    size_t num = SCCs.size();
+    preds.resize(num);
+
+    std::unordered_map<PSNode *, size_t> component;
+    for (size_t i = 0; i < num; ++i) {
+        for (PSNode *n : SCCs[i])
+            component[n] = i;
+    }
+
+    auto addDependence = [&preds](size_t before, size_t after) {
+        if (before != after)
+            preds[after].insert(before);
+    };
+
+    std::unordered_map<MemoryClass, size_t> last_writer;
+    std::unordered_map<MemoryClass, std::vector<size_t>> readers;
+    size_t last_call = NONE;
+    std::vector<size_t> since_call;
+
+    for (size_t i = 0; i < num; ++i) {
+        bool has_call = false;
+
+        for (PSNode *n : SCCs[i]) {
+            if (n->getType() == PSNodeType::CALL_FUNCPTR)
+                has_call = true;
+
+            // the predecessors are always in the previous components
+            for (PSNode *pred : n->getPredecessors()) {
+                auto it = component.find(pred);
+                if (it != component.end())
+                    addDependence(it->second, i);
+            }
+
+            for (size_t o = 0; o < n->getOperandsNum(); ++o) {
+                auto it = component.find(n->getOperand(o));
+                if (it == component.end())
+                    continue;
+
+                if (it->second < i)
+                    addDependence(it->second, i);
+                else
+                    addDependence(i, it->second);
+            }
+        }
+
+        std::set<MemoryClass> reads, writes;
+        getAccessedMemory(classes, SCCs[i], offsets_budget, reads, writes);
+
+        for (MemoryClass cls : reads) {
+            auto it = last_writer.find(cls);
+            if (it != last_writer.end())
+                addDependence(it->second, i);
+
+            readers[cls].push_back(i);
+        }
+
+        for (MemoryClass cls : writes) {
+            auto it = last_writer.find(cls);
+            if (it != last_writer.end())
+                addDependence(it->second, i);
+
+            std::vector<size_t>& rd = readers[cls];
+            for (size_t r : rd)
+                addDependence(r, i);
+            rd.clear();
+
+            last_writer[cls] = i;
+        }
+
+        if (last_call != NONE)
+            addDependence(last_call, i);
+
+        if (has_call) {
+            for (size_t j : since_call)
+                addDependence(j, i);
+
+            since_call.clear();
+            last_call = i;
+        } else
+            since_call.push_back(i);
+    }
+}
+
+///
+// Split the nodes of the component @comp into waves, so that the nodes
+// of one wave can be processed at once. This is the same as
+// computeDependencies(), but for the nodes of one component: the node
+// gets a later wave than all the nodes before it in @comp that
+//
+//  - use it as an operand or that it uses as an operand,
+//  - access the same memory class and one of them writes to it,
+//  - are calls via function pointers (or it is such a call itself).
+//
+// The pairs of nodes that are in conflict are processed in the same order
+// as by solveComponent(), the other nodes do not see each other, so one
+// round over the waves gives the same results as the sequential round.
+// The edges of the graph are not conflicts, the analyses that process
+// the nodes of components at once do not pass any state along them
+// (see canProcessNodesConcurrently())
+static void computeWaves(PointsToSteensgaard& classes,
+                         const std::vector<PSNode *>& comp,
+                         bool offsets_budget,
+                         std::vector<std::vector<PSNode *>>& waves)
+{
+    std::unordered_map<PSNode *, size_t> position;
+    for (size_t i = 0; i < comp.size(); ++i)
+        position[comp[i]] = i;
+
+    // the first wave that the nodes accessing the memory class can use
+    std::unordered_map<MemoryClass, size_t> after_writers;
+    std::unordered_map<MemoryClass, size_t> after_readers;
+    std::vector<size_t> wave(comp.size());
+    size_t waves_num = 0;
+    // the first wave after the last call via function pointer
+    size_t after_call = 0;
+
+    for (size_t i = 0; i < comp.size(); ++i) {
+        PSNode *n = comp[i];
+        size_t w = after_call;
+
+        auto conflict = [&](PSNode *oth) {
+            auto it = position.find(oth);
+            if (it != position.end() && it->second < i)
+                w = std::max(w, wave[it->second] + 1);
+        };
+
+        for (size_t o = 0; o < n->getOperandsNum(); ++o)
+            conflict(n->getOperand(o));
+        for (PSNode *user : n->getUsers())
+            conflict(user);
+
+        std::set<MemoryClass> reads, writes;
+        getAccessedMemory(classes, n, offsets_budget, reads, writes);
+        for (MemoryClass cls : reads)
+            w = std::max(w, after_writers[cls]);
+        for (MemoryClass cls : writes)
+            w = std::max(w, std::max(after_writers[cls], after_readers[cls]));
+
+        if (n->getType() == PSNodeType::CALL_FUNCPTR) {
+            w = std::max(w, waves_num);
+            after_call = w + 1;
+        }
+
+        for (MemoryClass cls : reads)
+            after_readers[cls] = std::max(after_readers[cls], w + 1);
+        for (MemoryClass cls : writes)
+            after_writers[cls] = w + 1;
+
+        wave[i] = w;
+        waves_num = std::max(waves_num, w + 1);
+    }
+
+    waves.resize(waves_num);
+    for (size_t i = 0; i < comp.size(); ++i)
+        waves[wave[i]].push_back(comp[i]);
+}
+
+// solveComponent() for the component split into @waves
+void PointerAnalysis::solveComponentInWaves(
+                        const std::vector<std::vector<PSNode *>>& waves)
+{
+    // the flags of the threads, so that the threads
+    // do not write the same memory
+    std::vector<char> again(threads);
+    do {
+        std::fill(again.begin(), again.end(), 0);
+        for (const auto& wave : waves) {
+            parallelFor(wave.size(), threads, [&](size_t i, unsigned t) {
+                PSNode *cur = wave[i];
+                bool enq = beforeProcessed(cur);
+                bool ch = processNodeIfNeeded(cur);
+                // the component has more nodes, so it is cyclic
+                if (afterProcessed(cur) || enq || ch)
+                    again[t] = 1;
+            });
+        }
+    } while (std::find(again.begin(), again.end(), 1) != again.end()
+             && !budget.isExceeded());
+}
+
+void PointerAnalysis::runSCCPassParallel()
+{
+    // no nodes are created while the threads run
+    // (the calls via pointers are resolved after the pass)
+    reserveNodes(PSNode::getLastID());
+
+    // use a new pre-analysis in every pass, the graph may have changed
+    PointsToSteensgaard classes(PS);
+    classes.unifyGraph();
+
+    std::vector<std::set<size_t>> preds;
+    computeDependencies(classes, SCCs, offsets_budget > 0, preds);
+
+    TaskGraph tasks(SCCs.size());
+    for (size_t i = 0; i < SCCs.size(); ++i) {
+        for (size_t p : preds[i])
+            tasks.addDependence(p, i);
+    }
+
+    // the big components (e.g. a loop over the whole program)
+    // would keep the other threads waiting, so their nodes are
+    // processed at once too. Such a component takes more threads
+    // while other components may run, which is rare
+    std::vector<std::vector<std::vector<PSNode *>>> waves(SCCs.size());
+    if (canProcessNodesConcurrently()) {
+        for (size_t i = 0; i < SCCs.size(); ++i) {
+            if (SCCs[i].size() >= PARALLEL_COMPONENT_SIZE)
+                computeWaves(classes, SCCs[i], offsets_budget > 0, waves[i]);
+        }
+    }
+
+    PointsToSetT::setConcurrent(true);
+    tasks.run(threads, [&](size_t i) {
+        if (waves[i].empty())
+            solveComponent(SCCs[i]);
+        else
+            solveComponentInWaves(waves[i]);
+    });
+    PointsToSetT::setConcurrent(false);
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
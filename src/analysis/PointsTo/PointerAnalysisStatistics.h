@@ -0,0 +1,120 @@
+#ifndef _DG_POINTER_ANALYSIS_STATISTICS_H_
+#define _DG_POINTER_ANALYSIS_STATISTICS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "PointerSubgraph.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+// gather statistics about a run of pointer analysis
+struct PointerAnalysisStatistics
+{
+    struct TypeStatistics {
+        // how many times were nodes of this type processed
+        uint64_t processed = 0;
+        // how many times the processing changed something
+        uint64_t changed = 0;
+        // time spent in processing (in nanoseconds)
+        uint64_t time = 0;
+    };
+
+    struct NodeStatistics {
+        // how many times was the node processed
+        uint64_t processed = 0;
+        // time spent in processing the node (in nanoseconds)
+        uint64_t time = 0;
+        // how many pointers were added to the points-to set of the node
+        uint64_t growth = 0;
+    };
+
+    // the statistics are gathered only when enabled,
+    // measuring the time slows the analysis down
+    bool enabled = false;
+
+    // number of nodes processed in every round of the fixpoint
+    // computation. The analyses that use a worklist have one round
+    std::vector<uint64_t> processedInRound;
+    std::map<PSNodeType, TypeStatistics> types;
+    // the statistics of every processed node, so that the costs
+    // can be attributed to the functions of the nodes
+    std::unordered_map<PSNode *, NodeStatistics> nodes;
+    // number of memory objects created by the analysis
+    uint64_t memoryObjectsNum = 0;
+    // number of targets and memory objects collapsed
+    // to UNKNOWN_OFFSET due to the offsets budget
+    uint64_t collapsedTargetsNum = 0;
+    uint64_t collapsedObjectsNum = 0;
+    // how many times were the top-level nodes skipped,
+    // because their operands did not get new pointers
+    uint64_t topLevelSkipped = 0;
+
+    void newRound()
+    {
+        if (enabled)
+            processedInRound.push_back(0);
+    }
+
+    void nodeProcessed(PSNode *node, bool changed, uint64_t time,
+                       uint64_t growth)
+    {
+        if (processedInRound.empty())
+            processedInRound.push_back(0);
+
+        ++processedInRound.back();
+        NodeStatistics& ns = nodes[node];
+        ++ns.processed;
+        ns.time += time;
+        ns.growth += growth;
+
+        TypeStatistics& ts = types[node->getType()];
+        ++ts.processed;
+        ts.time += time;
+        if (changed)
+            ++ts.changed;
+    }
+
+    uint64_t getRoundsNum() const { return processedInRound.size(); }
+
+    uint64_t getProcessedNodes() const
+    {
+        uint64_t num = 0;
+        for (uint64_t n : processedInRound)
+            num += n;
+
+        return num;
+    }
+
+    // @num nodes that were processed most times
+    std::vector<std::pair<PSNode *, uint64_t>>
+    getMostProcessed(size_t num) const
+    {
+        std::vector<std::pair<PSNode *, uint64_t>> ret;
+        ret.reserve(nodes.size());
+        for (const auto& it : nodes)
+            ret.emplace_back(it.first, it.second.processed);
+
+        auto cmp = [](const std::pair<PSNode *, uint64_t>& a,
+                      const std::pair<PSNode *, uint64_t>& b) {
+            return a.second > b.second;
+        };
+
+        num = std::min(num, ret.size());
+        std::partial_sort(ret.begin(), ret.begin() + num, ret.end(), cmp);
+        ret.resize(num);
+
+        return ret;
+    }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_POINTER_ANALYSIS_STATISTICS_H_
@@ -5,16 +5,20 @@
 #include <vector>
 #include <cstdarg>
 #include <cstring> // for strdup
+#include <algorithm>
+#include <memory>
+#include <utility>
 
 #include "Pointer.h"
 #include "ADT/Queue.h"
+#include "ADT/Arena.h"
 #include "analysis/SubgraphNode.h"
 
 namespace dg {
 namespace analysis {
 namespace pta {
 
-enum class PSNodeType {
+enum class PSNodeType : uint8_t {
         // these are nodes that just represent memory allocation sites
         ALLOC = 1,
         DYN_ALLOC,
@@ -62,24 +66,102 @@ enum class PSNodeType {
 
 class PSNode : public SubgraphNode<PSNode>
 {
-    PSNodeType type;
-    Offset offset; // for the case this node is GEP or MEMCPY
-    Offset len; // for the case this node is MEMCPY
+    // the data that only some types of nodes have or that are used
+    // only when building the graph. Most of the nodes (casts, loads,
+    // stores, phis, ...) do not have it, so it is allocated on demand
+    // and the data that the solvers touch on every node stay together
+    struct Payload {
+        Offset offset{0}; // for the case this node is GEP or MEMCPY
+        Offset len{0}; // for the case this node is MEMCPY, the stride of GEP
+
+        // in some cases some nodes are kind of paired - like formal and
+        // actual parameters or call and return node. Here the analasis
+        // can store such a node - if it needs for generating
+        // the PointerSubgraph - it is not used anyhow by the base
+        // analysis itself (except for the calls via pointers)
+        PSNode *pairedNode = nullptr;
+
+        // the offsets of the fields of the allocated memory (if known),
+        // owned by the builder of the graph
+        const FieldLayout *fieldLayout = nullptr;
+        // the pointers that the allocated memory contains from
+        // the beginning, owned by the builder of the graph. The memory
+        // objects of the node are created with these pointers, so the
+        // graph does not need the stores of the initializer
+        const InitialPointersT *initialPointers = nullptr;
+    };
 
-    // in some cases some nodes are kind of paired - like formal and actual
-    // parameters or call and return node. Here the analasis can store
-    // such a node - if it needs for generating the PointerSubgraph
-    // - it is not used anyhow by the base analysis itself
-    // XXX: maybe we cold store this somewhere in a map instead of in every
-    // node (if the map is sparse, it would be much more memory efficient)
-    PSNode *pairedNode;
+    PSNodeType type;
 
     /// some additional information
     // was memory zeroed at initialization or right after allocating?
-    bool zeroInitialized;
+    bool zeroInitialized : 1;
     // is memory allocated on heap?
-    bool is_heap;
+    bool is_heap : 1;
+    // does the points-to set collapse to the unknown pointer
+    // once it contains it? (see addPointsTo())
+    bool saturateUnknown : 1;
+    // is the node in a loop of its function?
+    // (see PointerSubgraph::hasLoopInfo())
+    bool inLoop : 1;
     unsigned int dfsid;
+
+public:
+    // make this public, that's basically the only
+    // reason the PointerSubgraph node exists, so don't hide it
+    PointsToSetT pointsTo;
+
+private:
+    // pointers in the order as they were added to pointsTo
+    // (the pointers that were removed later are kept here).
+    // The users remember how far in the log of every operand
+    // they got, so that they can process only the new pointers
+    std::vector<Pointer> pointsToLog;
+    std::vector<size_t> operandsSeen;
+
+    // nodes that have this node as an operand (def-use edges)
+    std::vector<PSNode *> users;
+
+    std::unique_ptr<Payload> payload;
+
+    Payload& getPayload()
+    {
+        if (!payload)
+            payload.reset(new Payload());
+        return *payload;
+    }
+
+    static const Payload& emptyPayload()
+    {
+        static const Payload empty;
+        return empty;
+    }
+
+    const Payload& getPayload() const
+    {
+        return payload ? *payload : emptyPayload();
+    }
+
+    bool insertPointsTo(const Pointer& ptr)
+    {
+        if (!pointsTo.insert(ptr))
+            return false;
+
+        pointsToLog.push_back(ptr);
+        return true;
+    }
+
+    // remove one occurrence of this node from the users of @op
+    void removeFromUsers(PSNode *op)
+    {
+        if (op->isNull() || op->isUnknownMemory())
+            return;
+
+        auto it = std::find(op->users.begin(), op->users.end(), this);
+        if (it != op->users.end())
+            op->users.erase(it);
+    }
+
 public:
     ///
     // Construct a PSNode
@@ -127,8 +209,8 @@ public:
     //               works as a PHI node - it gathers pointers returned from
     //               the subprocedure
     PSNode(PSNodeType t, ...)
-    : SubgraphNode<PSNode>(), type(t), offset(0), pairedNode(nullptr),
-      zeroInitialized(false), is_heap(false), dfsid(0)
+    : SubgraphNode<PSNode>(), type(t), zeroInitialized(false),
+      is_heap(false), saturateUnknown(false), inLoop(false), dfsid(0)
     {
         // assing operands
         PSNode *op;
@@ -150,33 +232,34 @@ public:
             case PSNodeType::CAST:
             case PSNodeType::LOAD:
             case PSNodeType::CALL_FUNCPTR:
-                operands.push_back(va_arg(args, PSNode *));
+                addOperand(va_arg(args, PSNode *));
                 break;
             case PSNodeType::STORE:
-                operands.push_back(va_arg(args, PSNode *));
-                operands.push_back(va_arg(args, PSNode *));
+                addOperand(va_arg(args, PSNode *));
+                addOperand(va_arg(args, PSNode *));
                 break;
             case PSNodeType::MEMCPY:
-                operands.push_back(va_arg(args, PSNode *));
-                operands.push_back(va_arg(args, PSNode *));
-                offset = va_arg(args, uint64_t);
-                len = va_arg(args, uint64_t);
+                addOperand(va_arg(args, PSNode *));
+                addOperand(va_arg(args, PSNode *));
+                getPayload().offset = va_arg(args, uint64_t);
+                getPayload().len = va_arg(args, uint64_t);
                 break;
             case PSNodeType::GEP:
-                operands.push_back(va_arg(args, PSNode *));
-                offset = va_arg(args, uint64_t);
+                addOperand(va_arg(args, PSNode *));
+                getPayload().offset = va_arg(args, uint64_t);
+                // no stride
                 break;
             case PSNodeType::CONSTANT:
                 op = va_arg(args, PSNode *);
-                offset = va_arg(args, uint64_t);
-                pointsTo.insert(Pointer(op, offset));
+                getPayload().offset = va_arg(args, uint64_t);
+                insertPointsTo(Pointer(op, getPayload().offset));
                 break;
             case PSNodeType::NULL_ADDR:
-                pointsTo.insert(Pointer(this, 0));
+                insertPointsTo(Pointer(this, 0));
                 break;
             case PSNodeType::UNKNOWN_MEM:
                 // UNKNOWN_MEMLOC points to itself
-                pointsTo.insert(Pointer(this, UNKNOWN_OFFSET));
+                insertPointsTo(Pointer(this, UNKNOWN_OFFSET));
                 break;
             case PSNodeType::CALL_RETURN:
             case PSNodeType::PHI:
@@ -185,7 +268,7 @@ public:
                 op = va_arg(args, PSNode *);
                 // the operands are null terminated
                 while (op) {
-                    operands.push_back(op);
+                    addOperand(op);
                     op = va_arg(args, PSNode *);
                 }
                 break;
@@ -198,10 +281,64 @@ public:
 
     PSNodeType getType() const { return type; }
 
-    void setOffset(uint64_t o) { offset = o; }
+    // add operand and keep the def-use edges in sync.
+    // The special nodes (null and unknown memory) never change,
+    // so we do not track their users (they are shared between
+    // all the graphs)
+    size_t addOperand(PSNode *n)
+    {
+        if (!n->isNull() && !n->isUnknownMemory())
+            n->users.push_back(this);
+
+        return SubgraphNode<PSNode>::addOperand(n);
+    }
 
-    PSNode *getPairedNode() const { return pairedNode; }
-    void setPairedNode(PSNode *n) { pairedNode = n; }
+    const std::vector<PSNode *>& getUsers() const { return users; }
+
+    // replace the operand @idx by @n and keep the def-use edges in sync
+    // (used when simplifying the graph, before the analysis runs)
+    void replaceOperand(size_t idx, PSNode *n)
+    {
+        assert(idx < operands.size() && "Operand index out of range");
+        assert(n && "Passed nullptr as the operand");
+
+        removeFromUsers(operands[idx]);
+        if (!n->isNull() && !n->isUnknownMemory())
+            n->users.push_back(this);
+
+        operands[idx] = n;
+    }
+
+    // remove all the operands of the node (the node is
+    // not used anymore and should not be processed)
+    void removeOperands()
+    {
+        for (PSNode *op : operands)
+            removeFromUsers(op);
+
+        operands.clear();
+    }
+
+    void setOffset(uint64_t o) { getPayload().offset = o; }
+    const Offset& getOffset() const { return getPayload().offset; }
+    // the length of the memory copied by MEMCPY
+    const Offset& getLength() const { return getPayload().len; }
+
+    // the GEP adds also any multiple of the stride to the offset
+    // (it has an index that is not a constant), 0 if it does not
+    void setStride(uint64_t s)
+    {
+        assert(type == PSNodeType::GEP);
+        getPayload().len = s;
+    }
+
+    uint64_t getStride() const
+    {
+        return type == PSNodeType::GEP ? *getPayload().len : 0;
+    }
+
+    PSNode *getPairedNode() const { return getPayload().pairedNode; }
+    void setPairedNode(PSNode *n) { getPayload().pairedNode = n; }
 
     void setZeroInitialized() { zeroInitialized = true; }
     bool isZeroInitialized() const { return zeroInitialized; }
@@ -209,12 +346,65 @@ public:
     void setIsHeap() { is_heap = true; }
     bool isHeap() const { return is_heap; }
 
+    void setSaturateUnknown(bool s = true) { saturateUnknown = s; }
+    bool isSaturateUnknown() const { return saturateUnknown; }
+
+    void setInLoop(bool l = true) { inLoop = l; }
+    bool isInLoop() const { return inLoop; }
+
+    void setFieldLayout(const FieldLayout *l) { getPayload().fieldLayout = l; }
+    const FieldLayout *getFieldLayout() const { return getPayload().fieldLayout; }
+
+    void setInitialPointers(const InitialPointersT *p)
+    {
+        getPayload().initialPointers = p;
+    }
+
+    const InitialPointersT *getInitialPointers() const
+    {
+        return getPayload().initialPointers;
+    }
+
+    // the memory allocated for the data that only some nodes have
+    size_t getPayloadAllocatedBytes() const
+    {
+        return payload ? sizeof(Payload) : 0;
+    }
+
     bool isNull() const { return type == PSNodeType::NULL_ADDR; }
     bool isUnknownMemory() const { return type == PSNodeType::UNKNOWN_MEM; }
 
-    // make this public, that's basically the only
-    // reason the PointerSubgraph node exists, so don't hide it
-    PointsToSetT pointsTo;
+    // the node stands for a top-level (SSA) pointer: its points-to set
+    // is computed only from the points-to sets of its operands and it
+    // does not access memory. Such node needs to be processed again
+    // only when an operand got new pointers (see hasNewOperandPointsTo())
+    bool isTopLevel() const
+    {
+        switch (type) {
+            case PSNodeType::CAST:
+            case PSNodeType::GEP:
+            case PSNodeType::PHI:
+            case PSNodeType::CALL_RETURN:
+            case PSNodeType::RETURN:
+            case PSNodeType::CONSTANT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // were any pointers added to the points-to sets of the operands
+    // since forNewPointsTo() went through them the last time?
+    bool hasNewOperandPointsTo() const
+    {
+        for (size_t i = 0; i < getOperandsNum(); ++i) {
+            size_t seen = i < operandsSeen.size() ? operandsSeen[i] : 0;
+            if (getOperand(i)->pointsToLog.size() > seen)
+                return true;
+        }
+
+        return false;
+    }
 
     // convenient helper
     bool addPointsTo(PSNode *n, Offset o)
@@ -224,10 +414,16 @@ public:
         if (pointsTo.count(Pointer(n, UNKNOWN_OFFSET)))
             return false;
 
-        if (o.isUnknown())
+        // the unknown pointer stands for any pointer, so the saturated
+        // set does not take anything else
+        if (saturateUnknown
+            && pointsTo.count(Pointer(UNKNOWN_MEMORY, UNKNOWN_OFFSET)))
+            return false;
+
+        if (o.isUnknown() || (saturateUnknown && n == UNKNOWN_MEMORY))
             return addPointsToUnknownOffset(n);
         else
-            return pointsTo.insert(Pointer(n, o)).second;
+            return insertPointsTo(Pointer(n, o));
     }
 
     bool addPointsTo(const Pointer& ptr)
@@ -235,7 +431,16 @@ public:
         return addPointsTo(ptr.target, ptr.offset);
     }
 
-    bool addPointsTo(const std::set<Pointer>& ptrs)
+    // forget the points-to set and what the node has seen
+    // in its operands, so that an analysis can compute it again
+    void clearPointsTo()
+    {
+        pointsTo.clear();
+        pointsToLog.clear();
+        operandsSeen.clear();
+    }
+
+    bool addPointsTo(const PointsToSetT& ptrs)
     {
         bool changed = false;
         for (const Pointer& ptr: ptrs)
@@ -244,6 +449,29 @@ public:
         return changed;
     }
 
+    // call @fun on the pointers that were added to the points-to set
+    // of the operand @idx since the last call of this method
+    // for the operand. Returns true if any call of @fun returned true
+    template <typename FuncT>
+    bool forNewPointsTo(size_t idx, FuncT fun)
+    {
+        if (operandsSeen.size() < getOperandsNum())
+            operandsSeen.resize(getOperandsNum(), 0);
+
+        PSNode *op = getOperand(idx);
+        // @fun may add pointers to this node and this node may be
+        // its own operand, so do not keep references into the log
+        size_t end = op->pointsToLog.size();
+        bool changed = false;
+        for (size_t i = operandsSeen[idx]; i < end; ++i) {
+            Pointer ptr = op->pointsToLog[i];
+            changed |= fun(ptr);
+        }
+
+        operandsSeen[idx] = end;
+        return changed;
+    }
+
     bool doesPointsTo(const Pointer& p)
     {
         return pointsTo.count(p) == 1;
@@ -261,6 +489,12 @@ public:
     friend class PointerSubgraph;
 };
 
+bool Pointer::operator<(const Pointer& oth) const
+{
+    return target == oth.target ? offset < oth.offset
+                                : target->getID() < oth.target->getID();
+}
+
 class PointerSubgraph
 {
     unsigned int dfsnum;
@@ -268,6 +502,22 @@ class PointerSubgraph
     // root of the pointer state subgraph
     PSNode *root;
 
+    // the nodes created by create() are allocated here
+    // and freed at once when the subgraph is destroyed
+    ADT::Arena<PSNode> nodes_arena;
+    // the nodes created by create() in the order of creation,
+    // so that enumerating them does not need to search the graph
+    std::vector<PSNode *> nodes;
+
+    // the nodes reachable from the root in BFS order, valid while
+    // the root and the edges are the same as when it was computed
+    std::vector<PSNode *> reachable;
+    PSNode *reachable_root = nullptr;
+    unsigned long reachable_version = 0;
+
+    // the builder marked the nodes that are in loops (PSNode::isInLoop())
+    bool loop_info = false;
+
 public:
     PointerSubgraph() : dfsnum(0), root(nullptr) {}
     PointerSubgraph(PSNode *r) : dfsnum(0), root(r)
@@ -278,6 +528,99 @@ public:
     PSNode *getRoot() const { return root; }
     void setRoot(PSNode *r) { root = r; }
 
+    // the nodes in the loops of their functions are marked
+    // (by PSNode::setInLoop()), so the analysis widens only the GEPs
+    // in these loops and does not need the components of the whole graph
+    void setHasLoopInfo(bool l = true) { loop_info = l; }
+    bool hasLoopInfo() const { return loop_info; }
+
+    // create a node owned by the subgraph
+    template <typename... Args>
+    PSNode *create(Args&&... args)
+    {
+        PSNode *n = nodes_arena.create(std::forward<Args>(args)...);
+        nodes.push_back(n);
+        return n;
+    }
+
+    // all the nodes created by create() (in this order), also those
+    // that are not reachable from the root. The nodes that were not
+    // created by the subgraph are found only by getNodes()
+    const std::vector<PSNode *>& getAllNodes() const { return nodes; }
+    size_t size() const { return nodes.size(); }
+
+    // the nodes reachable from the root in BFS order (the same as
+    // getNodes(getRoot())). The order is computed again only when
+    // the root or any edge changed, so the solvers can go through
+    // the whole graph repeatedly without searching it every time
+    const std::vector<PSNode *>& getReachableNodes()
+    {
+        assert(root && "Do not have root");
+
+        unsigned long version = PSNode::getEdgesVersion();
+        if (reachable_root != root || reachable_version != version
+            || reachable.empty()) {
+            reachable = getNodes(root, nullptr, reachable.size());
+            reachable_root = root;
+            reachable_version = version;
+        }
+
+        return reachable;
+    }
+
+    // give the nodes reachable from the root their ids in the reverse
+    // postorder. The nodes exchange their ids, so the ids stay unique.
+    // The analyses keep their data of the nodes in tables indexed by
+    // the ids, so going through the graph from the root then walks
+    // the tables nearly sequentially. Must be called before any analysis
+    // runs, the containers ordered by the ids would not be sorted anymore
+    void renumberNodes()
+    {
+        if (!root)
+            return;
+
+        ++dfsnum;
+        std::vector<PSNode *> postorder;
+        // the node and the index of its next successor
+        std::vector<std::pair<PSNode *, size_t>> stack;
+        root->dfsid = dfsnum;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            PSNode *cur = stack.back().first;
+            if (stack.back().second < cur->successors.size()) {
+                PSNode *succ = cur->successors[stack.back().second++];
+                if (succ->dfsid != dfsnum) {
+                    succ->dfsid = dfsnum;
+                    stack.emplace_back(succ, 0);
+                }
+                continue;
+            }
+
+            postorder.push_back(cur);
+            stack.pop_back();
+        }
+
+        std::vector<unsigned int> ids;
+        ids.reserve(postorder.size());
+        for (PSNode *n : postorder)
+            ids.push_back(n->getID());
+        std::sort(ids.begin(), ids.end());
+
+        auto id = ids.begin();
+        for (auto I = postorder.rbegin(), E = postorder.rend(); I != E; ++I)
+            (*I)->setID(*id++);
+    }
+
+    // drop the nodes for which @pred is true from getAllNodes()
+    // (the nodes that were removed from the graph), the memory
+    // of the nodes is kept until the subgraph is destroyed
+    template <typename PredT>
+    void forgetNodes(PredT pred)
+    {
+        nodes.erase(std::remove_if(nodes.begin(), nodes.end(), pred),
+                    nodes.end());
+    }
+
     // FIXME: make this a static member, since we take
     // the starting node
     void getNodes(std::set<PSNode *>& cont,
@@ -0,0 +1,319 @@
+#include "PointsToAndersen.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+PSNode *PointsToAndersen::find(PSNode *n)
+{
+    NodeInfo& ni = getInfo(n);
+    if (ni.rep == n)
+        return n;
+
+    // path compression
+    ni.rep = find(ni.rep);
+    return ni.rep;
+}
+
+// add pointers to the representative and all nodes collapsed into it,
+// return true if something changed
+bool PointsToAndersen::addPointers(PSNode *rep, const PointsToSetT& ptrs)
+{
+    assert(&rep->pointsTo != &ptrs);
+    NodeInfo& ri = getInfo(rep);
+    if (isSaturateUnknown())
+        rep->setSaturateUnknown();
+
+    std::vector<Pointer> added;
+    for (const Pointer& ptr : ptrs) {
+        if (rep->addPointsTo(ptr)) {
+            added.push_back(ptr);
+            if (!ri.full)
+                ri.delta.insert(ptr);
+        }
+    }
+
+    if (added.empty())
+        return false;
+
+    // keep the points-to sets of the collapsed nodes the same,
+    // so that the rest of the analysis can use them directly
+    for (PSNode *m : ri.members) {
+        if (m == rep)
+            continue;
+
+        if (isSaturateUnknown())
+            m->setSaturateUnknown();
+        for (const Pointer& ptr : added)
+            m->addPointsTo(ptr);
+    }
+
+    return true;
+}
+
+// gather the pointers from the operands of a copy node
+void PointsToAndersen::pull(PSNode *n)
+{
+    assert(isCopy(n));
+    PSNode *rep = find(n);
+    getInfo(n).operands_num = n->getOperandsNum();
+
+    for (size_t i = 0; i < n->getOperandsNum(); ++i) {
+        PSNode *op = n->getOperand(i);
+        if (isCopy(op) && find(op) == rep)
+            continue;
+
+        addPointers(rep, op->pointsTo);
+    }
+
+    // the points-to set may have been
+    // non-empty before the analysis
+    getInfo(rep).full = true;
+}
+
+void PointsToAndersen::propagate(PSNode *rep)
+{
+    NodeInfo& ri = getInfo(rep);
+    PointsToSetT ptrs;
+    if (ri.full)
+        ptrs = rep->pointsTo;
+    else
+        ptrs = ri.delta;
+
+    ri.delta.clear();
+    ri.full = false;
+
+    if (ptrs.empty())
+        return;
+
+    // copy edges that may be a part of a cycle
+    std::vector<std::pair<PSNode *, PSNode *>> candidates;
+
+    for (PSNode *m : ri.members) {
+        for (PSNode *user : m->getUsers()) {
+            // complex constraint, evaluate it again
+            if (!isCopy(user)) {
+                enqueue(user);
+                continue;
+            }
+
+            PSNode *urep = find(user);
+            if (urep == rep)
+                continue;
+
+            if (addPointers(urep, ptrs))
+                enqueue(user);
+
+            // lazy cycle detection: the same points-to sets on
+            // both ends of an edge is a hint that there is a cycle
+            if (isCopy(rep)
+                && rep->pointsTo.size() == urep->pointsTo.size()
+                && checked.insert(std::make_pair(m, user)).second)
+                candidates.push_back(std::make_pair(m, user));
+        }
+    }
+
+    for (auto& edge : candidates) {
+        PSNode *from = find(edge.first);
+        PSNode *to = find(edge.second);
+        if (from != to && from->pointsTo == to->pointsTo)
+            findCycle(to, from);
+    }
+}
+
+// search for a path of copy edges from @from to @to
+// and collapse the nodes on the path into @to
+void PointsToAndersen::findCycle(PSNode *from, PSNode *to)
+{
+    struct Frame {
+        PSNode *node;
+        std::vector<PSNode *> succs;
+        size_t idx;
+    };
+
+    std::vector<Frame> stack;
+    std::set<PSNode *> visited;
+
+    auto push = [&](PSNode *n) {
+        visited.insert(n);
+        Frame frame{n, {}, 0};
+        for (PSNode *m : getInfo(n).members) {
+            for (PSNode *user : m->getUsers()) {
+                if (!isCopy(user))
+                    continue;
+
+                PSNode *urep = find(user);
+                if (urep != n)
+                    frame.succs.push_back(urep);
+            }
+        }
+
+        stack.push_back(std::move(frame));
+    };
+
+    push(from);
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.idx == frame.succs.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        PSNode *succ = frame.succs[frame.idx++];
+        if (succ == to) {
+            // every node on the stack lies on a cycle with @to
+            std::vector<PSNode *> cycle;
+            for (const Frame& f : stack)
+                cycle.push_back(f.node);
+
+            for (PSNode *n : cycle)
+                collapse(to, n);
+
+            return;
+        }
+
+        if (!visited.count(succ))
+            push(succ);
+    }
+}
+
+void PointsToAndersen::collapse(PSNode *rep, PSNode *other)
+{
+    assert(rep != other);
+    assert(find(rep) == rep && find(other) == other);
+
+    NodeInfo& ri = getInfo(rep);
+    NodeInfo& oi = getInfo(other);
+
+    addPointers(rep, other->pointsTo);
+    for (PSNode *m : oi.members) {
+        m->addPointsTo(rep->pointsTo);
+        getInfo(m).rep = rep;
+        ri.members.push_back(m);
+    }
+
+    oi.members.clear();
+    oi.delta.clear();
+    oi.full = false;
+
+    // the users of the other node have not seen
+    // all the pointers of the representative
+    ri.full = true;
+    ++collapsed_num;
+
+    enqueue(rep);
+}
+
+// the calls via function pointers may have added new nodes to the graph
+// or new operands to the existing nodes
+void PointsToAndersen::newNodes(const std::vector<PSNode *>& callsites)
+{
+    ADT::QueueFIFO<PSNode *> fifo;
+    std::set<PSNode *> visited;
+    for (PSNode *callsite : callsites)
+        fifo.push(callsite);
+
+    while (!fifo.empty()) {
+        PSNode *cur = fifo.pop();
+        for (PSNode *succ : cur->getSuccessors()) {
+            if (processed.count(succ) || queued.count(succ)
+                || !visited.insert(succ).second)
+                continue;
+
+            enqueue(succ);
+            fifo.push(succ);
+        }
+    }
+
+    std::vector<PSNode *> grown;
+    for (auto& it : info) {
+        PSNode *n = it.first;
+        if (isCopy(n) && processed.count(n)
+            && n->getOperandsNum() != it.second.operands_num)
+            grown.push_back(n);
+    }
+
+    for (PSNode *n : grown) {
+        pull(n);
+        enqueue(n);
+    }
+
+    // calls of undefined functions add the unknown pointer
+    // directly to the return site
+    for (PSNode *callsite : callsites) {
+        PSNode *ret = callsite->getPairedNode();
+        if (!processed.count(ret))
+            continue;
+
+        PSNode *rep = find(ret);
+        if (rep != ret)
+            addPointers(rep, ret->pointsTo);
+
+        getInfo(rep).full = true;
+        enqueue(rep);
+    }
+}
+
+void PointsToAndersen::solve()
+{
+    while (!worklist.empty() && !budget.isExceeded()) {
+        PSNode *cur = worklist.pop();
+        queued.erase(cur);
+
+        if (isCopy(cur)) {
+            if (processed.insert(cur).second)
+                pull(cur);
+            else if (find(cur) != cur)
+                // collapsed, the representative takes care of it
+                continue;
+
+            propagate(find(cur));
+            reportProgress(worklist.size());
+            continue;
+        }
+
+        bool first_time = processed.insert(cur).second;
+        bool changed = processNodeIfNeeded(cur);
+
+        if (changed || first_time) {
+            getInfo(cur).full = true;
+            propagate(cur);
+        }
+
+        reportProgress(worklist.size());
+    }
+}
+
+void PointsToAndersen::run()
+{
+    PSNode *root = getPS()->getRoot();
+    assert(root && "Do not have root of PS");
+
+    budget.start();
+    startProgress();
+    RoundsScope rounds{this};
+    preprocessGEPs();
+    trackMemoryReaders(true);
+
+    // the order does not matter for the solution,
+    // but the BFS order is a good start
+    for (PSNode *n : getPS()->getReachableNodes())
+        enqueue(n);
+
+    do {
+        newProgressRound();
+        solve();
+        // add the subgraphs of the functions called
+        // via pointers that were found until now
+        newNodes(resolveFunctionPointerCalls());
+    } while (!worklist.empty() && !budget.isExceeded());
+
+    trackMemoryReaders(false);
+    info.clear();
+    processed.clear();
+    checked.clear();
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,111 @@
+#ifndef _DG_ANALYSIS_POINTS_TO_ANDERSEN_H_
+#define _DG_ANALYSIS_POINTS_TO_ANDERSEN_H_
+
+#include <cassert>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+#include "PointerAnalysis.h"
+#include "PointsToFlowInsensitive.h"
+#include "ADT/Queue.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Inclusion-based (Andersen-style) flow-insensitive pointer analysis.
+//
+// The PointerSubgraph is taken as a constraint graph: the nodes that
+// only copy points-to sets of their operands (PHI, CAST, RETURN,
+// CALL_RETURN) form the copy edges, the other nodes (LOAD, STORE, GEP,
+// MEMCPY, CALL_FUNCPTR) are complex constraints that are evaluated
+// by the transfer functions of PointerAnalysis whenever their inputs
+// change. The order of the nodes in the graph does not matter.
+//
+// Along the copy edges only the difference since the last propagation
+// is sent. Cycles of copy edges are detected lazily (when the source and
+// the target of an edge end up with the same points-to set) and
+// collapsed into one representative node.
+class PointsToAndersen : public PointsToFlowInsensitive
+{
+    struct NodeInfo {
+        // representative of the collapsed cycle
+        PSNode *rep;
+        // pointers that were not propagated yet
+        PointsToSetT delta;
+        // propagate the whole points-to set instead of delta
+        bool full = false;
+        // nodes collapsed into this one (valid in representatives)
+        std::vector<PSNode *> members;
+        // number of operands that we have seen
+        size_t operands_num = 0;
+
+        NodeInfo(PSNode *n = nullptr) : rep(n) {}
+    };
+
+    std::unordered_map<PSNode *, NodeInfo> info;
+    ADT::QueueFIFO<PSNode *> worklist;
+    std::set<PSNode *> queued;
+    std::set<PSNode *> processed;
+    // copy edges that were already checked for a cycle
+    std::set<std::pair<PSNode *, PSNode *>> checked;
+
+    // statistics
+    unsigned collapsed_num = 0;
+
+    static bool isCopy(PSNode *n)
+    {
+        PSNodeType type = n->getType();
+        return type == PSNodeType::PHI || type == PSNodeType::CAST
+               || type == PSNodeType::RETURN
+               || type == PSNodeType::CALL_RETURN;
+    }
+
+    NodeInfo& getInfo(PSNode *n)
+    {
+        auto it = info.find(n);
+        if (it != info.end())
+            return it->second;
+
+        NodeInfo& ni = info[n];
+        ni.rep = n;
+        ni.members.push_back(n);
+        ni.operands_num = n->getOperandsNum();
+        return ni;
+    }
+
+    PSNode *find(PSNode *n);
+    bool addPointers(PSNode *rep, const PointsToSetT& ptrs);
+    void pull(PSNode *n);
+    void propagate(PSNode *rep);
+    void findCycle(PSNode *from, PSNode *to);
+    void collapse(PSNode *rep, PSNode *other);
+    void newNodes(const std::vector<PSNode *>& callsites);
+    void solve();
+
+public:
+    PointsToAndersen(PointerSubgraph *ps) : PointsToFlowInsensitive(ps) {}
+
+    void enqueue(PSNode *n) override
+    {
+        // until the node is processed for the first time,
+        // it has not pulled the pointers from its operands
+        if (isCopy(n) && processed.count(n))
+            n = find(n);
+
+        if (queued.insert(n).second)
+            worklist.push(n);
+    }
+
+    void run() override;
+
+    unsigned getCollapsedNum() const { return collapsed_num; }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_POINTS_TO_ANDERSEN_H_
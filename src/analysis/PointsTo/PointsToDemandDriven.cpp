@@ -0,0 +1,136 @@
+#include "PointsToDemandDriven.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+const std::vector<PSNode *>& PointsToDemandDriven::getWriters(PSNode *ptr)
+{
+    static const std::vector<PSNode *> no_writers;
+
+    auto it = writers.find(classes.getMemoryClass(ptr));
+    if (it == writers.end())
+        return no_writers;
+
+    return it->second;
+}
+
+void PointsToDemandDriven::computeWriters()
+{
+    // the graph may have new nodes, so extend the classes
+    classes.unifyGraph();
+    writers.clear();
+
+    for (PSNode *n : getPS()->getReachableNodes()) {
+        if (n->getType() == PSNodeType::STORE
+            || n->getType() == PSNodeType::MEMCPY)
+            writers[classes.getMemoryClass(n->getOperand(1))].push_back(n);
+    }
+}
+
+bool PointsToDemandDriven::getDependencies(const std::vector<PSNode *>& nodes,
+                                           std::vector<PSNode *>& deps)
+{
+    std::set<PSNode *> visited;
+    std::vector<PSNode *> stack(nodes.begin(), nodes.end());
+
+    while (!stack.empty()) {
+        PSNode *cur = stack.back();
+        stack.pop_back();
+
+        // the special nodes have nothing to compute
+        if (cur->isNull() || cur->isUnknownMemory())
+            continue;
+
+        if (solved.count(cur) || !visited.insert(cur).second)
+            continue;
+
+        deps.push_back(cur);
+        if (deps.size() > budget)
+            return false;
+
+        for (size_t i = 0; i < cur->getOperandsNum(); ++i)
+            stack.push_back(cur->getOperand(i));
+
+        // loads (and memcpy) read the memory, so they depend
+        // on everything that may have written to it
+        if (cur->getType() == PSNodeType::LOAD
+            || cur->getType() == PSNodeType::MEMCPY) {
+            for (PSNode *w : getWriters(cur->getOperand(0)))
+                stack.push_back(w);
+        }
+    }
+
+    return true;
+}
+
+bool PointsToDemandDriven::solve(const std::vector<PSNode *>& nodes)
+{
+    while (true) {
+        std::vector<PSNode *> deps;
+        if (!getDependencies(nodes, deps))
+            return false;
+
+        bool changed;
+        do {
+            changed = false;
+            // the dependencies are gathered from the queried nodes,
+            // so go from the other end to process operands first
+            for (auto I = deps.rbegin(), E = deps.rend(); I != E; ++I)
+                changed |= processNode(*I);
+        } while (changed);
+
+        if (resolveFunctionPointerCalls().empty()) {
+            solved.insert(deps.begin(), deps.end());
+            return true;
+        }
+
+        // the new parts of the graph may flow also to the nodes
+        // that we have solved before, so we must check them again
+        solved.clear();
+        computeWriters();
+    }
+}
+
+bool PointsToDemandDriven::prepare()
+{
+    preprocessGEPs();
+    computeWriters();
+
+    std::vector<PSNode *> calls;
+    size_t calls_num;
+    do {
+        calls_num = calls.size();
+        calls.clear();
+
+        for (PSNode *n : getPS()->getReachableNodes()) {
+            if (n->getType() == PSNodeType::CALL_FUNCPTR)
+                calls.push_back(n);
+        }
+
+        if (!solve(calls))
+            return false;
+
+        // the new subgraphs may contain new calls via pointers
+    } while (calls.size() != calls_num);
+
+    prepared = true;
+    return true;
+}
+
+bool PointsToDemandDriven::query(PSNode *n)
+{
+    if (exhaustive)
+        return true;
+
+    if ((!prepared && !prepare()) || !solve({n})) {
+        run();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
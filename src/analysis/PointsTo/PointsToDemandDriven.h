@@ -0,0 +1,87 @@
+#ifndef _DG_ANALYSIS_POINTS_TO_DEMAND_DRIVEN_H_
+#define _DG_ANALYSIS_POINTS_TO_DEMAND_DRIVEN_H_
+
+#include <cassert>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+#include "PointerAnalysis.h"
+#include "PointsToFlowInsensitive.h"
+#include "PointsToSteensgaard.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Demand-driven flow-insensitive pointer analysis.
+//
+// Instead of computing the points-to sets of all nodes (run()),
+// query() computes the points-to set of one node. It takes the nodes
+// that the node depends on (the operands and, for loads, the stores
+// that may write to the loaded memory according to Steensgaard
+// pre-analysis) and solves only these nodes. The results are the same
+// as the results of PointsToFlowInsensitive. The solved nodes are
+// remembered, so the next queries reuse them.
+//
+// If a query needs more nodes than the budget, the whole analysis
+// is run instead (and the next queries are for free).
+class PointsToDemandDriven : public PointsToFlowInsensitive
+{
+    using MemoryClass = const PointsToSteensgaard::ECR *;
+
+    PointsToSteensgaard classes;
+    // the stores and memcpys that write to the memory of the class
+    std::unordered_map<MemoryClass, std::vector<PSNode *>> writers;
+    // the nodes that have the final points-to sets already
+    std::set<PSNode *> solved;
+
+    size_t budget;
+    bool prepared = false;
+    bool exhaustive = false;
+
+    // the stores and memcpys that may write to the memory
+    // that @ptr points to
+    const std::vector<PSNode *>& getWriters(PSNode *ptr);
+    void computeWriters();
+
+    // gather the nodes that are needed to compute the points-to sets
+    // of @nodes, return false if there is more of them than the budget
+    bool getDependencies(const std::vector<PSNode *>& nodes,
+                         std::vector<PSNode *>& deps);
+    // compute the points-to sets of @nodes, return false
+    // if it is over the budget
+    bool solve(const std::vector<PSNode *>& nodes);
+    // calls via function pointers change the graph, so resolve
+    // them all before answering any query
+    bool prepare();
+
+public:
+    static const size_t DEFAULT_BUDGET = 10000;
+
+    PointsToDemandDriven(PointerSubgraph *ps)
+    : PointsToFlowInsensitive(ps), classes(ps), budget(DEFAULT_BUDGET) {}
+
+    void setBudget(size_t b) { budget = b; }
+    size_t getBudget() const { return budget; }
+
+    // did we run the whole analysis?
+    bool isExhaustive() const { return exhaustive; }
+
+    // compute the points-to set of @n. Returns false if the budget
+    // was exceeded and the whole analysis was run instead
+    bool query(PSNode *n);
+
+    void run() override
+    {
+        PointsToFlowInsensitive::run();
+        exhaustive = true;
+    }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_POINTS_TO_DEMAND_DRIVEN_H_
@@ -5,6 +5,8 @@
 #include <vector>
 
 #include "PointerAnalysis.h"
+#include "ADT/Arena.h"
+#include "analysis/NodeTable.h"
 
 namespace dg {
 namespace analysis {
@@ -12,21 +14,50 @@ namespace pta {
 
 class PointsToFlowInsensitive : public PointerAnalysis
 {
-    PointerSubgraph *ps;
+    // the memory objects are owned by the analysis
+    // and freed at once with it
+    ADT::Arena<MemoryObject, ADT::AllocTag::MEMORY_OBJECTS> memoryObjects;
+    // the memory objects of the allocation sites
+    NodeTable<PSNode, MemoryObject *> nodeObjects;
 
 protected:
     PointsToFlowInsensitive() = default;
 
 public:
     PointsToFlowInsensitive(PointerSubgraph *ps)
-    : PointerAnalysis(ps), ps(ps) {}
+    : PointerAnalysis(ps) {}
 
-    ~PointsToFlowInsensitive() {
-        std::vector<PSNode *> nodes = ps->getNodes();
-        for (PSNode *n : nodes) {
-            MemoryObject *mo = n->getData<MemoryObject>();
-            delete mo;
-        }
+    // the memory object of the allocation site @n,
+    // nullptr if it was not created (yet)
+    MemoryObject *getMemoryObject(const PSNode *n) const
+    {
+        return nodeObjects.get(n);
+    }
+
+    void reserveNodes(unsigned lastID) override
+    {
+        nodeObjects.reserve(lastID);
+    }
+
+    // the nodes work only with their operands and the memory objects
+    bool canProcessNodesConcurrently() const override { return true; }
+
+    void sharePointsToSets() override
+    {
+        PointerAnalysis::sharePointsToSets();
+        memoryObjects.forEach([](MemoryObject *mo) {
+            for (auto& it : mo->pointsTo)
+                it.second.share();
+        });
+    }
+
+    void getMemoryUsage(MemoryUsage& mu) const override
+    {
+        memoryObjects.forEach([&mu](const MemoryObject *mo) {
+            addMemoryUsage(mu, mo);
+        });
+
+        mu.add("memory objects of nodes", 1, nodeObjects.getAllocatedBytes());
     }
 
     void getMemoryObjects(PSNode *where, const Pointer& pointer,
@@ -51,10 +82,19 @@ public:
                || n->getType() == PSNodeType::DYN_ALLOC
                || n->getType() == PSNodeType::UNKNOWN_MEM);
 
-        MemoryObject *mo = n->getData<MemoryObject>();
+        MemoryObject *mo = nodeObjects.get(n);
         if (!mo) {
-            mo = new MemoryObject(n);
-            n->setData<MemoryObject>(mo);
+            std::lock_guard<std::mutex> lock(shared_state_mutex);
+            // other thread may have created it meanwhile
+            mo = nodeObjects.get(n);
+            if (!mo) {
+                mo = memoryObjects.create(n, n->getFieldLayout());
+                if (n->getInitialPointers())
+                    mo->addInitialPointers(*n->getInitialPointers());
+                ++statistics.memoryObjectsNum;
+                DG_TRACE1(pta_memory_object, n);
+                nodeObjects.set(n, mo);
+            }
         }
 
         objects.push_back(mo);
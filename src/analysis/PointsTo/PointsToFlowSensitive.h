@@ -2,9 +2,18 @@
 #define _DG_ANALYSIS_POINTS_TO_FLOW_SENSITIVE_H_
 
 #include <cassert>
+#include <map>
+#include <set>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
 
 #include "Pointer.h"
 #include "PointerSubgraph.h"
+#include "PointerAnalysis.h"
+#include "analysis/NodeTable.h"
+#include "ADT/Queue.h"
+#include "ADT/Arena.h"
 
 namespace dg {
 namespace analysis {
@@ -14,7 +23,72 @@ class PointsToFlowSensitive : public PointerAnalysis
 {
 public:
     using MemoryObjectsSetT = std::set<MemoryObject *>;
-    using MemoryMapT = std::map<const Pointer, MemoryObjectsSetT>;
+    // the sets of memory objects are shared between the memory maps
+    // and they are copied only when they are going to be changed
+    using MemoryObjectsSetPtrT = std::shared_ptr<MemoryObjectsSetT>;
+    // the stores and memcpys that wrote the memory last,
+    // shared between the maps the same way
+    using WritersSetT = std::set<PSNode *, NodeIDLess>;
+    using WritersSetPtrT = std::shared_ptr<WritersSetT>;
+
+    ///
+    // The memory map is indexed by the target of the pointer first
+    // and then by the offset, so all the objects of a target
+    // are found by one lookup (the accesses to memory do not
+    // care about the offsets) and the maps are merged target
+    // by target.
+    class MemoryMap
+    {
+    public:
+        using OffsetsMapT = std::map<Offset, MemoryObjectsSetPtrT>;
+        using TargetsMapT = std::unordered_map<PSNode *, OffsetsMapT>;
+        using WriterOffsetsMapT = std::map<Offset, WritersSetPtrT>;
+        using WritersMapT = std::unordered_map<PSNode *, WriterOffsetsMapT>;
+
+        // the set for the pointer, an empty entry is created if needed
+        MemoryObjectsSetPtrT& operator[](const Pointer& ptr)
+        {
+            OffsetsMapT& offsets = targets[ptr.target];
+            auto it = offsets.lower_bound(ptr.offset);
+            if (it == offsets.end() || !(it->first == ptr.offset)) {
+                it = offsets.emplace_hint(it, ptr.offset, nullptr);
+                ++entries;
+            }
+
+            return it->second;
+        }
+
+        // the offsets of @target, nullptr if there are none
+        const OffsetsMapT *find(PSNode *target) const
+        {
+            auto it = targets.find(target);
+            return it == targets.end() ? nullptr : &it->second;
+        }
+
+        // the last writers of @target by the offsets,
+        // nullptr if there are none (see setTrackWriters())
+        const WriterOffsetsMapT *findWriters(PSNode *target) const
+        {
+            auto it = writers.find(target);
+            return it == writers.end() ? nullptr : &it->second;
+        }
+
+        // the number of pointers in the map
+        size_t size() const { return entries; }
+        bool empty() const { return entries == 0; }
+
+        TargetsMapT::const_iterator begin() const { return targets.begin(); }
+        TargetsMapT::const_iterator end() const { return targets.end(); }
+
+    private:
+        TargetsMapT targets;
+        WritersMapT writers;
+        size_t entries = 0;
+
+        friend class PointsToFlowSensitive;
+    };
+
+    using MemoryMapT = MemoryMap;
 
     // this is an easy but not very efficient implementation,
     // works for testing
@@ -32,7 +106,7 @@ public:
 
     bool beforeProcessed(PSNode *n) override
     {
-        MemoryMapT *mm = n->getData<MemoryMapT>();
+        MemoryMapT *mm = getMemoryMap(n);
         if (mm)
             return false;
 
@@ -40,12 +114,11 @@ public:
 
         // on these nodes the memory map can change
         if (canChangeMM(n)) { // root node
-            // FIXME: we're leaking the memory maps
-            mm = new MemoryMapT();
+            mm = createMM();
         } else if (n->predecessorsNum() > 1) {
             // this is a join node, create a new map and
             // merge the predecessors to it
-            mm = new MemoryMapT();
+            mm = createMM();
 
             // merge information from predecessors into the new map
             // XXX: this is necessary also with the merge in afterProcess,
@@ -53,10 +126,12 @@ public:
             // predecessor, whereas afterProcessed copies the
             // information only for two or more predecessors
             for (PSNode *p : n->getPredecessors()) {
-                MemoryMapT *pm = p->getData<MemoryMapT>();
+                MemoryMapT *pm = getMemoryMap(p);
                 // merge pm to mm (if pm was already created)
                 if (pm) {
                     changed |= mergeMaps(mm, pm, nullptr);
+                    if (track_writers)
+                        changed |= mergeWriters(mm, pm, nullptr);
                 }
             }
         } else {
@@ -64,15 +139,15 @@ public:
             // so just add a pointer from the predecessor
             // to this map
             PSNode *pred = n->getSinglePredecessor();
-            mm = pred->getData<MemoryMapT>();
+            mm = getMemoryMap(pred);
             assert(mm && "No memory map in the predecessor");
         }
 
         assert(mm && "Did not create the MM");
 
-        // memory map initialized, set it as data,
+        // memory map initialized, remember it,
         // so that we won't initialize it again
-        n->setData<MemoryMapT>(mm);
+        setMemoryMap(n, mm);
 
         // ignore any changes here except when we merged some new information.
         // The other changes we'll detect later
@@ -84,7 +159,7 @@ public:
         bool changed = false;
         PointsToSetT *strong_update = nullptr;
 
-        MemoryMapT *mm = n->getData<MemoryMapT>();
+        MemoryMapT *mm = getMemoryMap(n);
         // we must have the memory map, we created it
         // in the beforeProcessed method
         assert(mm && "Do not have memory map");
@@ -98,44 +173,210 @@ public:
         // more of them (if there's just one predecessor
         // and this is not a store, the memory map couldn't
         // change, so we don't have to do that)
-        if (n->predecessorsNum() > 1 || strong_update
-            || n->getType() == PSNodeType::MEMCPY) {
+        const bool writes = strong_update || n->getType() == PSNodeType::MEMCPY;
+        // the writers are killed only by the writes of one pointer,
+        // the other stores may write to any of their pointers
+        Pointer killed = PointerUnknown;
+        const bool kills = track_writers && getKilledPointer(n, killed);
+
+        if (n->predecessorsNum() > 1 || writes) {
             for (PSNode *p : n->getPredecessors()) {
-                MemoryMapT *pm = p->getData<MemoryMapT>();
+                MemoryMapT *pm = getMemoryMap(p);
                 // merge pm to mm (but only if pm was already created)
                 if (pm) {
                     changed |= mergeMaps(mm, pm, strong_update);
+                    if (track_writers)
+                        changed |= mergeWriters(mm, pm, kills ? &killed : nullptr);
                 }
             }
         }
 
+        if (track_writers && writes)
+            changed |= addWriter(mm, n, kills);
+
         return changed;
     }
 
+    // the nodes that do not change the memory share the memory map
+    // with their predecessor, so the change of memory at @n
+    // is a change of memory at all of them.  Enqueue all these
+    // nodes and the first nodes that have their own memory map
+    // (these will merge the change into their maps)
+    void memoryChanged(PSNode *n) override
+    {
+        MemoryMapT *mm = getMemoryMap(n);
+        assert(mm && "Do not have memory map");
+
+        ADT::QueueFIFO<PSNode *> fifo;
+        std::set<PSNode *> visited;
+        fifo.push(n);
+
+        while (!fifo.empty()) {
+            PSNode *cur = fifo.pop();
+            for (PSNode *succ : cur->getSuccessors()) {
+                if (!visited.insert(succ).second)
+                    continue;
+
+                enqueue(succ);
+
+                // go further only through the nodes sharing our map
+                if (getMemoryMap(succ) == mm)
+                    fifo.push(succ);
+            }
+        }
+    }
+
+    // compute also the reaching definitions of the memory: for every
+    // slot of the memory maps, keep the stores and memcpys that may have
+    // written it last. The writers are joined in the same maps and in the
+    // same traversal as the pointers, so no separate reaching definitions
+    // analysis is needed. Must be set before run(), the subclasses with
+    // their own hooks do not track the writers
+    void setTrackWriters(bool track) { track_writers = track; }
+    bool tracksWriters() const { return track_writers; }
+
+    // the writers of the memory of @ptr in the memory map of @where
+    // (for the nodes that do not write the memory this is the memory
+    // before the node, for the writing nodes the memory after them).
+    // The writes to unknown memory or unknown offsets are included,
+    // @writers are ordered by the ids of the nodes
+    void getWriters(PSNode *where, const Pointer& ptr,
+                    std::vector<PSNode *>& writers) const
+    {
+        assert(track_writers && "The writers are not tracked");
+        const MemoryMapT *mm = getMemoryMap(where);
+        if (!mm)
+            return;
+
+        auto addSlots = [&writers, &ptr](const MemoryMapT::WriterOffsetsMapT *offsets,
+                                         bool all) {
+            if (!offsets)
+                return;
+            for (const auto& it : *offsets) {
+                if (all || ptr.offset.isUnknown() || it.first.isUnknown()
+                    || it.first == ptr.offset)
+                    writers.insert(writers.end(), it.second->begin(), it.second->end());
+            }
+        };
+
+        if (ptr.target == UNKNOWN_MEMORY) {
+            for (const auto& T : mm->writers)
+                addSlots(&T.second, true);
+        } else {
+            addSlots(mm->findWriters(ptr.target), false);
+            addSlots(mm->findWriters(UNKNOWN_MEMORY), true);
+        }
+
+        std::sort(writers.begin(), writers.end(), NodeIDLess());
+        writers.erase(std::unique(writers.begin(), writers.end()), writers.end());
+    }
+
+    // the memory map of @n, nullptr if it has none (yet)
+    MemoryMapT *getMemoryMap(const PSNode *n) const
+    {
+        return nodeMaps.get(n);
+    }
+
+    void reserveNodes(unsigned lastID) override
+    {
+        nodeMaps.reserve(lastID);
+    }
+
+    void sharePointsToSets() override
+    {
+        PointerAnalysis::sharePointsToSets();
+        memoryObjects.forEach([](MemoryObject *mo) {
+            for (auto& it : mo->pointsTo)
+                it.second.share();
+        });
+    }
+
+    void getMemoryUsage(MemoryUsage& mu) const override
+    {
+        memoryObjects.forEach([&mu](const MemoryObject *mo) {
+            addMemoryUsage(mu, mo);
+        });
+
+        // the sets of memory objects are shared between the maps
+        memoryMaps.forEach([&mu](const MemoryMapT *mm) {
+            size_t bytes = sizeof(MemoryMapT);
+            for (const auto& T : *mm) {
+                bytes += sizeof(T);
+                for (const auto& it : T.second) {
+                    bytes += sizeof(it);
+                    if (it.second)
+                        bytes += (sizeof(MemoryObjectsSetT)
+                                  + it.second->size() * sizeof(MemoryObject *))
+                                 / it.second.use_count();
+                }
+            }
+
+            for (const auto& T : mm->writers) {
+                bytes += sizeof(T);
+                for (const auto& it : T.second) {
+                    bytes += sizeof(it) + (sizeof(WritersSetT)
+                             + it.second->size() * sizeof(PSNode *))
+                             / it.second.use_count();
+                }
+            }
+
+            mu.add("memory maps", 1, bytes);
+        });
+
+        mu.add("memory maps of nodes", 1, nodeMaps.getAllocatedBytes());
+    }
+
     void getMemoryObjects(PSNode *where, const Pointer& pointer,
                           std::vector<MemoryObject *>& objects) override
     {
-        MemoryMapT *mm= where->getData<MemoryMapT>();
+        MemoryMapT *mm= getMemoryMap(where);
         assert(mm && "Node does not have memory map");
 
-        auto bounds = getObjectRange(mm, pointer);
-        for (MemoryMapT::iterator I = bounds.first; I != bounds.second; ++I) {
-            assert(I->first.target == pointer.target
-                    && "Bug in getObjectRange");
-
-            for (MemoryObject *mo : I->second)
-                objects.push_back(mo);
+        // the objects of the target at any offset
+        if (const auto *offsets = mm->find(pointer.target)) {
+            for (const auto& it : *offsets) {
+                for (MemoryObject *mo : *it.second)
+                    objects.push_back(mo);
+            }
         }
 
-        assert(bounds.second->first.target != pointer.target
-                && "Bug in getObjectRange");
-
         // if we haven't found any memory object, but this psnode
         // is a write to memory, create a new one, so that
         // the write has something to write to
         if (objects.empty() && canChangeMM(where)) {
-            MemoryObject *mo = new MemoryObject(pointer.target);
-            (*mm)[pointer].insert(mo);
+            MemoryObject *mo;
+            {
+                std::lock_guard<std::mutex> lock(shared_state_mutex);
+                mo = memoryObjects.create(pointer.target,
+                                          pointer.target->getFieldLayout());
+                if (pointer.target->getInitialPointers())
+                    mo->addInitialPointers(*pointer.target->getInitialPointers());
+                ++statistics.memoryObjectsNum;
+                DG_TRACE1(pta_memory_object, pointer.target);
+            }
+
+            // there's no entry for the pointer's target,
+            // so this set cannot be shared
+            MemoryObjectsSetPtrT& S = (*mm)[pointer];
+            assert(!S && "Found a set for the pointer");
+            S = std::make_shared<MemoryObjectsSetT>();
+            S->insert(mo);
+
+            objects.push_back(mo);
+        } else if (objects.empty() && pointer.target->getInitialPointers()) {
+            // nothing has written to the memory on the way here,
+            // so it contains only the initial pointers. These are
+            // kept in one object shared by all the nodes
+            std::lock_guard<std::mutex> lock(shared_state_mutex);
+            MemoryObject *& mo = initialObjects[pointer.target];
+            if (!mo) {
+                mo = memoryObjects.create(pointer.target,
+                                          pointer.target->getFieldLayout());
+                mo->addInitialPointers(*pointer.target->getInitialPointers());
+                ++statistics.memoryObjectsNum;
+                DG_TRACE1(pta_memory_object, pointer.target);
+            }
+
             objects.push_back(mo);
         }
     }
@@ -144,20 +385,15 @@ protected:
 
     PointsToFlowSensitive() = default;
 
-private:
-
-    static bool comp(const std::pair<const Pointer, MemoryObjectsSetT>& a,
-                     const std::pair<const Pointer, MemoryObjectsSetT>& b) {
-        return a.first.target < b.first.target;
+    void setMemoryMap(const PSNode *n, MemoryMapT *mm)
+    {
+        nodeMaps.set(n, mm);
     }
 
-    ///
-    // get interator range for elements that have information
-    // about the ptr.target node (ignoring the offsets)
-    std::pair<MemoryMapT::iterator, MemoryMapT::iterator>
-    getObjectRange(MemoryMapT *mm, const Pointer& ptr) {
-        std::pair<const Pointer, MemoryObjectsSetT> what(ptr, MemoryObjectsSetT());
-        return std::equal_range(mm->begin(), mm->end(), what, comp);
+    MemoryMapT *createMM()
+    {
+        std::lock_guard<std::mutex> lock(shared_state_mutex);
+        return memoryMaps.create();
     }
 
     ///
@@ -166,19 +402,160 @@ private:
     bool mergeMaps(MemoryMapT *mm, MemoryMapT *pm,
                    PointsToSetT *strong_update) {
         bool changed = false;
-        for (auto& it : *pm) {
-            const Pointer& ptr = it.first;
-            if (strong_update && strong_update->count(ptr))
+        for (auto& T : pm->targets) {
+            // use [] to create the entry of the target if needed
+            auto& offsets = mm->targets[T.first];
+
+            // we do not have anything about the target yet,
+            // so just share all its sets
+            if (offsets.empty() && !strong_update) {
+                offsets = T.second;
+                mm->entries += offsets.size();
+                changed |= !offsets.empty();
                 continue;
+            }
+
+            for (const auto& it : T.second) {
+                if (strong_update
+                    && strong_update->count(Pointer(T.first, it.first)))
+                    continue;
+
+                auto I = offsets.lower_bound(it.first);
+                if (I == offsets.end() || !(I->first == it.first)) {
+                    I = offsets.emplace_hint(I, it.first, it.second);
+                    ++mm->entries;
+                    changed = true;
+                    continue;
+                }
+
+                MemoryObjectsSetPtrT& S = I->second;
+                const MemoryObjectsSetPtrT& PS = it.second;
 
-            // use [] to create the object if needed
-            MemoryObjectsSetT& S = (*mm)[ptr];
-            for (auto& elem : it.second)
-                changed |= S.insert(elem).second;
+                if (S == PS || std::includes(S->begin(), S->end(),
+                                             PS->begin(), PS->end()))
+                    continue;
+
+                // copy on write
+                if (S.use_count() > 1)
+                    S = std::make_shared<MemoryObjectsSetT>(*S);
+
+                S->insert(PS->begin(), PS->end());
+                changed = true;
+            }
         }
 
         return changed;
     }
+
+    // the pointer whose last writers are replaced by the writes of @n
+    // (the only pointer that a store writes to), false if there is none
+    static bool getKilledPointer(PSNode *n, Pointer& killed)
+    {
+        if (n->getType() != PSNodeType::STORE)
+            return false;
+
+        const PointsToSetT& S = n->getOperand(1)->pointsTo;
+        if (S.size() != 1)
+            return false;
+
+        const Pointer& ptr = *S.begin();
+        if (!ptr.isValid() || ptr.offset.isUnknown())
+            return false;
+
+        killed = ptr;
+        return true;
+    }
+
+    // merge the writers of @pm to @mm except the writers of @killed,
+    // return true if any writer was added
+    bool mergeWriters(MemoryMapT *mm, const MemoryMapT *pm,
+                      const Pointer *killed)
+    {
+        bool changed = false;
+        for (const auto& T : pm->writers) {
+            auto& offsets = mm->writers[T.first];
+
+            // share all the sets of the target
+            if (offsets.empty() && (!killed || killed->target != T.first)) {
+                offsets = T.second;
+                changed |= !offsets.empty();
+                continue;
+            }
+
+            for (const auto& it : T.second) {
+                if (killed && killed->target == T.first
+                    && it.first == killed->offset)
+                    continue;
+
+                WritersSetPtrT& S = offsets[it.first];
+                const WritersSetPtrT& PS = it.second;
+                if (!S) {
+                    S = PS;
+                    changed = true;
+                    continue;
+                }
+
+                if (S == PS || std::includes(S->begin(), S->end(),
+                                             PS->begin(), PS->end(),
+                                             NodeIDLess()))
+                    continue;
+
+                // copy on write
+                if (S.use_count() > 1)
+                    S = std::make_shared<WritersSetT>(*S);
+
+                S->insert(PS->begin(), PS->end());
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    // record @n as a writer of the memory it writes to. If @strong,
+    // it is the only writer of its pointer, the memcpys write
+    // at unknown offsets of their destinations
+    bool addWriter(MemoryMapT *mm, PSNode *n, bool strong)
+    {
+        bool changed = false;
+        const bool memcpy = n->getType() == PSNodeType::MEMCPY;
+        for (const Pointer& ptr : n->getOperand(1)->pointsTo) {
+            if (ptr.isNull())
+                continue;
+
+            Offset off = memcpy ? Offset(UNKNOWN_OFFSET) : ptr.offset;
+            WritersSetPtrT& S = mm->writers[ptr.target][off];
+            if (strong) {
+                if (S && S->size() == 1 && *S->begin() == n)
+                    continue;
+                S = std::make_shared<WritersSetT>();
+            } else if (!S) {
+                S = std::make_shared<WritersSetT>();
+            } else if (S->count(n)) {
+                continue;
+            } else if (S.use_count() > 1) {
+                S = std::make_shared<WritersSetT>(*S);
+            }
+
+            S->insert(n);
+            changed = true;
+        }
+
+        return changed;
+    }
+
+private:
+    // the memory maps and objects are owned by the analysis
+    // (and freed with it), the nodes keep only pointers to them
+    ADT::Arena<MemoryMapT, ADT::AllocTag::MEMORY_OBJECTS> memoryMaps;
+    ADT::Arena<MemoryObject, ADT::AllocTag::MEMORY_OBJECTS> memoryObjects;
+    // the memory maps of the nodes (more nodes share one map)
+    NodeTable<PSNode, MemoryMapT *> nodeMaps;
+    // the objects with the initial pointers of the memory
+    // that was not written yet (see getMemoryObjects)
+    std::unordered_map<PSNode *, MemoryObject *> initialObjects;
+    // keep the last writers of the memory in the maps
+    bool track_writers = false;
 };
 
 } // namespace pta
@@ -0,0 +1,218 @@
+#include <set>
+
+#include "PointsToFlowSensitiveRegion.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+// do the nodes of this type compute their points-to sets?
+// (the others point to the fixed memory from their creation)
+static bool computesPointsTo(PSNode *n)
+{
+    switch (n->getType()) {
+        case PSNodeType::ALLOC:
+        case PSNodeType::DYN_ALLOC:
+        case PSNodeType::FUNCTION:
+        case PSNodeType::CONSTANT:
+        case PSNodeType::NULL_ADDR:
+        case PSNodeType::UNKNOWN_MEM:
+            return false;
+        default:
+            return true;
+    }
+}
+
+PointsToFlowSensitiveRegion::PointsToFlowSensitiveRegion(PointerSubgraph *ps,
+                                                         PointerAnalysis *pre,
+                                                         const std::vector<PSNode *>& reg)
+    : PointsToFlowSensitive(ps), region(reg.begin(), reg.end())
+{
+    computeBoundary();
+    computeOrder();
+
+    // the nodes that are not reachable from the boundary are not
+    // processed (they would never get any memory), they keep
+    // the points-to sets of the previous analysis
+    if (nodes.size() < region.size()) {
+        region = std::unordered_set<PSNode *>(nodes.begin(), nodes.end());
+        computeBoundary();
+    }
+
+    // the memory must be taken from @pre before we change
+    // the points-to sets of the nodes
+    seedMemory(pre);
+
+    for (PSNode *n : nodes) {
+        if (computesPointsTo(n))
+            n->clearPointsTo();
+    }
+}
+
+void PointsToFlowSensitiveRegion::computeBoundary()
+{
+    boundary.clear();
+    for (PSNode *n : region) {
+        if (n->predecessorsNum() == 0)
+            boundary.insert(n);
+
+        for (PSNode *p : n->getPredecessors()) {
+            if (!inRegion(p))
+                boundary.insert(n);
+        }
+    }
+}
+
+// the nodes of the region in BFS order from the boundary, so that
+// the nodes with a single predecessor get its memory map
+// (see PointsToFlowSensitive::beforeProcessed)
+void PointsToFlowSensitiveRegion::computeOrder()
+{
+    std::set<PSNode *> visited;
+    ADT::QueueFIFO<PSNode *> fifo;
+    for (PSNode *n : boundary) {
+        visited.insert(n);
+        fifo.push(n);
+    }
+
+    while (!fifo.empty()) {
+        PSNode *cur = fifo.pop();
+        nodes.push_back(cur);
+
+        for (PSNode *succ : cur->getSuccessors()) {
+            if (inRegion(succ) && visited.insert(succ).second)
+                fifo.push(succ);
+        }
+    }
+}
+
+// take the memory that the region accesses from the analysis @pre
+// and split it by the offsets
+void PointsToFlowSensitiveRegion::seedMemory(PointerAnalysis *pre)
+{
+    std::set<PSNode *> targets;
+    auto addTargets = [&targets](PSNode *op) {
+        for (const Pointer& ptr : op->pointsTo) {
+            if (ptr.isValid())
+                targets.insert(ptr.target);
+        }
+    };
+
+    for (PSNode *n : nodes) {
+        switch (n->getType()) {
+            case PSNodeType::LOAD:
+                addTargets(n->getOperand(0));
+                break;
+            case PSNodeType::STORE:
+                addTargets(n->getOperand(1));
+                break;
+            case PSNodeType::MEMCPY:
+                addTargets(n->getOperand(0));
+                addTargets(n->getOperand(1));
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::vector<MemoryObject *> objects;
+    for (PSNode *target : targets) {
+        if (target->getType() == PSNodeType::FUNCTION)
+            continue;
+
+        objects.clear();
+        pre->getMemoryObjects(nullptr, Pointer(target, 0), objects);
+        for (MemoryObject *mo : objects) {
+            for (const auto& it : mo->pointsTo) {
+                MemoryObject *part = boundaryObjects.create(target,
+                                                            target->getFieldLayout());
+                part->pointsTo[it.first] = it.second;
+
+                MemoryObjectsSetPtrT& S = boundaryMemory[Pointer(target, it.first)];
+                if (!S)
+                    S = std::make_shared<MemoryObjectsSetT>();
+                S->insert(part);
+            }
+        }
+    }
+}
+
+bool PointsToFlowSensitiveRegion::beforeProcessed(PSNode *n)
+{
+    MemoryMapT *mm = getMemoryMap(n);
+    if (mm)
+        return false;
+
+    bool changed = false;
+    if (canChangeMM(n)) {
+        // the stores get the memory in afterProcessed
+        mm = createMM();
+    } else if (isBoundary(n) || n->predecessorsNum() > 1) {
+        mm = createMM();
+        if (isBoundary(n)) {
+            *mm = boundaryMemory;
+            changed = true;
+        }
+
+        for (PSNode *p : n->getPredecessors()) {
+            MemoryMapT *pm = inRegion(p) ? getMemoryMap(p) : nullptr;
+            if (pm)
+                changed |= mergeMaps(mm, pm, nullptr);
+        }
+    } else {
+        // the single predecessor is in the region
+        mm = getMemoryMap(n->getSinglePredecessor());
+        assert(mm && "No memory map in the predecessor");
+    }
+
+    setMemoryMap(n, mm);
+    return changed;
+}
+
+bool PointsToFlowSensitiveRegion::afterProcessed(PSNode *n)
+{
+    bool changed = false;
+    PointsToSetT *strong_update = nullptr;
+
+    MemoryMapT *mm = getMemoryMap(n);
+    assert(mm && "Do not have memory map");
+
+    // every store is a strong update (as in PointsToFlowSensitive)
+    if (n->getType() == PSNodeType::STORE)
+        strong_update = &n->getOperand(1)->pointsTo;
+
+    if (n->predecessorsNum() > 1 || strong_update || isBoundary(n)
+        || n->getType() == PSNodeType::MEMCPY) {
+        for (PSNode *p : n->getPredecessors()) {
+            MemoryMapT *pm = inRegion(p) ? getMemoryMap(p) : nullptr;
+            if (pm)
+                changed |= mergeMaps(mm, pm, strong_update);
+        }
+
+        if (isBoundary(n))
+            changed |= mergeMaps(mm, &boundaryMemory, strong_update);
+    }
+
+    return changed;
+}
+
+void PointsToFlowSensitiveRegion::run()
+{
+    budget.start();
+
+    bool changed;
+    do {
+        changed = false;
+        statistics.newRound();
+
+        for (PSNode *n : nodes) {
+            changed |= beforeProcessed(n);
+            changed |= processNode(n);
+            changed |= afterProcessed(n);
+        }
+    } while (changed && !budget.isExceeded());
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,66 @@
+#ifndef _DG_ANALYSIS_POINTS_TO_FLOW_SENSITIVE_REGION_H_
+#define _DG_ANALYSIS_POINTS_TO_FLOW_SENSITIVE_REGION_H_
+
+#include <cassert>
+#include <vector>
+#include <unordered_set>
+
+#include "PointerAnalysis.h"
+#include "PointsToFlowSensitive.h"
+#include "ADT/Arena.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Flow-sensitive analysis of a region of the PointerSubgraph (e.g. the
+// nodes of some functions) on top of the results of an analysis that
+// was run on the whole graph already (the flow-insensitive one).
+//
+// Only the nodes in the region are computed again, the other nodes
+// keep their points-to sets. The memory that gets into the region
+// from the outside (at the boundary nodes - the nodes of the region with
+// a predecessor outside of it) is the memory of the previous analysis.
+// Its memory objects are split by the offsets, so the stores
+// in the region overwrite (strong update) the single offsets as usual.
+class PointsToFlowSensitiveRegion : public PointsToFlowSensitive
+{
+    std::unordered_set<PSNode *> region;
+    std::unordered_set<PSNode *> boundary;
+    // the nodes of the region in the order of processing
+    std::vector<PSNode *> nodes;
+
+    // the memory at the boundary
+    MemoryMapT boundaryMemory;
+    ADT::Arena<MemoryObject, ADT::AllocTag::MEMORY_OBJECTS> boundaryObjects;
+
+    bool inRegion(PSNode *n) const { return region.count(n) > 0; }
+    bool isBoundary(PSNode *n) const { return boundary.count(n) > 0; }
+
+    void computeBoundary();
+    void computeOrder();
+    void seedMemory(PointerAnalysis *pre);
+
+public:
+    // @pre is the analysis whose results are in the graph,
+    // @region are the nodes to compute flow-sensitively
+    PointsToFlowSensitiveRegion(PointerSubgraph *ps, PointerAnalysis *pre,
+                                const std::vector<PSNode *>& region);
+
+    bool beforeProcessed(PSNode *n) override;
+    bool afterProcessed(PSNode *n) override;
+
+    // the nodes are processed in rounds, every round
+    // goes over all the nodes of the region
+    void enqueue(PSNode *) override {}
+    void memoryChanged(PSNode *) override {}
+
+    void run() override;
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_POINTS_TO_FLOW_SENSITIVE_REGION_H_
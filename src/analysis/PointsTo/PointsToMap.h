@@ -0,0 +1,285 @@
+#ifndef _DG_POINTS_TO_MAP_H_
+#define _DG_POINTS_TO_MAP_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "analysis/Offset.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// The offsets of the fields of a type (given by the front-end,
+// e.g. from the layout of LLVM structures), sorted and unique.
+// The layout is shared by all the memory objects of the type.
+// The index of the slot of an offset inside the type is kept
+// in a table indexed by the offset, so finding a slot is an array
+// lookup.
+class FieldLayout
+{
+    std::vector<uint64_t> offsets;
+    // the slot of every offset less than the size, NONE if no field
+    // starts there
+    std::vector<uint32_t> slots;
+
+public:
+    // the slot of the offsets that are not fields
+    enum : uint32_t { NONE = ~0u };
+    // do not keep the table for bigger types, search the offsets
+    static const uint64_t MAX_TABLE_SIZE = 4096;
+
+    FieldLayout(std::vector<uint64_t> offs)
+        : offsets(std::move(offs))
+    {
+        std::sort(offsets.begin(), offsets.end());
+        offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+        if (!offsets.empty() && offsets.back() < MAX_TABLE_SIZE) {
+            slots.assign(offsets.back() + 1, NONE);
+            for (uint32_t i = 0; i < offsets.size(); ++i)
+                slots[offsets[i]] = i;
+        }
+    }
+
+    size_t size() const { return offsets.size(); }
+    uint64_t getOffset(uint32_t slot) const { return offsets[slot]; }
+
+    uint32_t getSlot(const Offset& off) const
+    {
+        if (off.isUnknown())
+            return NONE;
+
+        if (*off < slots.size())
+            return slots[*off];
+
+        if (!slots.empty())
+            return NONE;
+
+        auto it = std::lower_bound(offsets.begin(), offsets.end(), *off);
+        if (it == offsets.end() || *it != *off)
+            return NONE;
+
+        return static_cast<uint32_t>(it - offsets.begin());
+    }
+};
+
+///
+// Map from offsets to points-to sets used in the memory objects.
+// The offsets of the fields in the layout of the object have their
+// slots at the beginning of the vector of entries (the slots are
+// allocated at the first insertion), the other offsets (and
+// UNKNOWN_OFFSET) follow sorted. So the lookup of a field is
+// an indexing and iterating over all the offsets is a walk over
+// a vector. Without the layout, this is a sorted flat map.
+//
+// The iteration goes over the used slots in the order of the offsets
+// and then over the other offsets in the ascending order.
+template <typename SetT>
+class PointsToMap
+{
+public:
+    using value_type = std::pair<Offset, SetT>;
+
+private:
+    using EntriesT = std::vector<value_type>;
+
+    const FieldLayout *layout = nullptr;
+    // the slots of the layout followed by the other offsets
+    EntriesT entries;
+    // which slots are used
+    std::vector<bool> used;
+    // the number of used entries
+    size_t used_num = 0;
+
+    size_t slotsNum() const { return used.size(); }
+
+    void allocateSlots()
+    {
+        assert(layout && entries.empty());
+        entries.reserve(layout->size());
+        for (size_t i = 0; i < layout->size(); ++i)
+            entries.emplace_back(Offset(layout->getOffset(i)), SetT());
+        used.assign(layout->size(), false);
+    }
+
+    typename EntriesT::iterator findOther(const Offset& off)
+    {
+        auto B = entries.begin() + slotsNum();
+        return std::lower_bound(B, entries.end(), off,
+                                [](const value_type& e, const Offset& o) {
+                                    return e.first < o;
+                                });
+    }
+
+    typename EntriesT::const_iterator findOther(const Offset& off) const
+    {
+        auto B = entries.begin() + slotsNum();
+        return std::lower_bound(B, entries.end(), off,
+                                [](const value_type& e, const Offset& o) {
+                                    return e.first < o;
+                                });
+    }
+
+    template <typename EntryT, typename MapT>
+    class iterator_base
+    {
+        MapT *map;
+        size_t pos;
+
+        template <typename E, typename M> friend class iterator_base;
+
+        void skipUnused()
+        {
+            while (pos < map->slotsNum() && !map->used[pos])
+                ++pos;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PointsToMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = EntryT *;
+        using reference = EntryT&;
+
+        iterator_base(MapT *m, size_t p) : map(m), pos(p) { skipUnused(); }
+
+        // the const iterator can be created from the non-const one
+        template <typename E, typename M>
+        iterator_base(const iterator_base<E, M>& o) : map(o.map), pos(o.pos) {}
+
+        iterator_base& operator++()
+        {
+            ++pos;
+            skipUnused();
+            return *this;
+        }
+
+        iterator_base operator++(int)
+        {
+            auto tmp = *this;
+            operator++();
+            return tmp;
+        }
+
+        reference operator*() const { return map->entries[pos]; }
+        pointer operator->() const { return &map->entries[pos]; }
+
+        bool operator==(const iterator_base& rhs) const { return pos == rhs.pos; }
+        bool operator!=(const iterator_base& rhs) const { return pos != rhs.pos; }
+    };
+
+public:
+    using iterator = iterator_base<value_type, PointsToMap>;
+    using const_iterator = iterator_base<const value_type, const PointsToMap>;
+
+    PointsToMap() = default;
+    PointsToMap(const FieldLayout *l) : layout(l) {}
+
+    const FieldLayout *getLayout() const { return layout; }
+
+    SetT& operator[](const Offset& off)
+    {
+        if (layout) {
+            uint32_t slot = layout->getSlot(off);
+            if (slot != FieldLayout::NONE) {
+                if (entries.empty())
+                    allocateSlots();
+                if (!used[slot]) {
+                    used[slot] = true;
+                    ++used_num;
+                }
+                return entries[slot].second;
+            }
+        }
+
+        auto it = findOther(off);
+        if (it == entries.end() || !(it->first == off)) {
+            it = entries.emplace(it, off, SetT());
+            ++used_num;
+        }
+
+        return it->second;
+    }
+
+    size_t count(const Offset& off) const
+    {
+        if (layout) {
+            uint32_t slot = layout->getSlot(off);
+            if (slot != FieldLayout::NONE)
+                return slotsNum() > 0 && used[slot] ? 1 : 0;
+        }
+
+        auto it = findOther(off);
+        return it != entries.end() && it->first == off ? 1 : 0;
+    }
+
+    const_iterator find(const Offset& off) const
+    {
+        if (layout) {
+            uint32_t slot = layout->getSlot(off);
+            if (slot != FieldLayout::NONE)
+                return slotsNum() > 0 && used[slot] ? const_iterator(this, slot) : end();
+        }
+
+        auto it = findOther(off);
+        if (it == entries.end() || !(it->first == off))
+            return end();
+
+        return const_iterator(this, it - entries.begin());
+    }
+
+    // call @f on the entries with the offsets in [from, to],
+    // (@to must be less than UNKNOWN_OFFSET). Both the slots
+    // and the other offsets are sorted, so only the entries
+    // in the range are visited
+    template <typename F>
+    void forEachInRange(uint64_t from, uint64_t to, F&& f) const
+    {
+        assert(to < UNKNOWN_OFFSET);
+        auto less = [](const value_type& e, uint64_t o) { return *e.first < o; };
+
+        auto B = entries.begin(), S = entries.begin() + slotsNum();
+        for (auto I = std::lower_bound(B, S, from, less);
+             I != S && *I->first <= to; ++I) {
+            if (used[I - B])
+                f(*I);
+        }
+
+        for (auto I = std::lower_bound(S, entries.end(), from, less);
+             I != entries.end() && *I->first <= to; ++I)
+            f(*I);
+    }
+
+    size_t size() const { return used_num; }
+    bool empty() const { return used_num == 0; }
+
+    void clear()
+    {
+        entries.clear();
+        used.clear();
+        used_num = 0;
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, entries.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, entries.size()); }
+
+    // the memory taken by the entries (without the data of the sets)
+    size_t getAllocatedBytes() const
+    {
+        return entries.capacity() * sizeof(value_type) + used.capacity() / 8;
+    }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_POINTS_TO_MAP_H_
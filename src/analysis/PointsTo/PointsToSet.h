@@ -0,0 +1,676 @@
+#ifndef _DG_POINTS_TO_SET_H_
+#define _DG_POINTS_TO_SET_H_
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "ADT/TaggedAllocator.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+// Table of pointers that are stored in the bitvector representation
+// of points-to sets. Every pointer (target + offset) gets a number
+// and the points-to set is then a set of these numbers.
+// The table is shared by all points-to sets of the same type.
+template <typename PointerT, typename HashT>
+class PointerIdTable {
+    // deque, so that the references to the pointers remain valid
+    std::deque<PointerT> pointers;
+    std::unordered_map<PointerT, unsigned, HashT> ids;
+
+    // when the sets are used from more threads at once,
+    // the access to the table must be synchronized
+    bool concurrent = false;
+    mutable std::mutex mtx;
+
+    unsigned _getId(const PointerT& p)
+    {
+        auto it = ids.find(p);
+        if (it != ids.end())
+            return it->second;
+
+        unsigned id = pointers.size();
+        pointers.push_back(p);
+        ids.emplace(p, id);
+
+        return id;
+    }
+
+    bool _findId(const PointerT& p, unsigned& id) const
+    {
+        auto it = ids.find(p);
+        if (it == ids.end())
+            return false;
+
+        id = it->second;
+        return true;
+    }
+
+public:
+    unsigned getId(const PointerT& p)
+    {
+        if (!concurrent)
+            return _getId(p);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return _getId(p);
+    }
+
+    // like getId(), but does not create a new id
+    bool findId(const PointerT& p, unsigned& id) const
+    {
+        if (!concurrent)
+            return _findId(p, id);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return _findId(p, id);
+    }
+
+    const PointerT& get(unsigned id) const
+    {
+        if (!concurrent) {
+            assert(id < pointers.size());
+            return pointers[id];
+        }
+
+        // the reference stays valid after unlocking,
+        // deque does not move the elements
+        std::lock_guard<std::mutex> lock(mtx);
+        assert(id < pointers.size());
+        return pointers[id];
+    }
+
+    size_t size() const { return pointers.size(); }
+
+    // must not be called while the table is used by other threads
+    void setConcurrent(bool c) { concurrent = c; }
+
+    static PointerIdTable& instance()
+    {
+        static PointerIdTable table;
+        return table;
+    }
+};
+
+// the bit of a pointer in the 64-bit filter of the points-to sets
+// (a Bloom filter with one hash function). When the bit of a pointer
+// is not set in the filter of a set, the pointer is not in the set,
+// so most of the negative queries do not need to look into the set.
+template <typename PointerT, typename HashT>
+inline uint64_t pointerFilterBit(const PointerT& p)
+{
+    // take the top bits of the multiplicative hash,
+    // the low bits of HashT may be poorly distributed
+    uint64_t h = static_cast<uint64_t>(HashT()(p)) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<uint64_t>(1) << (h >> 58);
+}
+
+///
+// Set of pointers. Small sets are kept as a sorted vector of pointers,
+// once the set gets bigger than SMALL_SIZE elements, it is switched
+// to a sparse bitvector over the ids from PointerIdTable.
+// The interface is a subset of the interface of std::set<Pointer>,
+// except that insert() returns just a bool
+// (as in RDNodesSet in reaching definitions)
+//
+// The set can be shared (hash-consed) by share(): the sets with the same
+// elements then use one immutable copy of the data, they are compared
+// just by comparing pointers and their unions are remembered.
+// A shared set is copied on the first change.
+template <typename PointerT, typename HashT, size_t SMALL_SIZE = 16>
+class PointsToSet {
+public:
+    // the maximal size of the small representation
+    static const size_t SMALL_LIMIT = SMALL_SIZE;
+
+private:
+    using TableT = PointerIdTable<PointerT, HashT>;
+    using WordT = uint64_t;
+    // the memory of the sets is counted to AllocTag::PTA_SETS
+    using SmallT = std::vector<PointerT,
+                               ADT::TaggedAllocator<PointerT, ADT::AllocTag::PTA_SETS>>;
+    using BitsT = std::vector<std::pair<unsigned, WordT>,
+                              ADT::TaggedAllocator<std::pair<unsigned, WordT>,
+                                                   ADT::AllocTag::PTA_SETS>>;
+    static const unsigned WORD_BITS = 64;
+
+    struct Data {
+        // small representation
+        SmallT small;
+        // big representation: sorted pairs (index of word, word)
+        BitsT bits;
+        size_t elems = 0;
+        bool is_small = true;
+        // the filter of the pointers in the set (see pointerFilterBit()).
+        // Erasing does not clear the bits, so the filter may have more bits
+        // than the pointers in the set need. It is not a part of the value
+        // of the set and it is not compared nor hashed
+        WordT filter = 0;
+
+        bool operator==(const Data& oth) const
+        {
+            return elems == oth.elems && is_small == oth.is_small
+                   && small == oth.small && bits == oth.bits;
+        }
+
+        size_t hash() const
+        {
+            size_t h = elems;
+            for (const PointerT& p : small)
+                h = h * 31 + HashT()(p);
+            for (const auto& w : bits)
+                h = h * 31 + (w.first ^ std::hash<WordT>()(w.second));
+
+            return h;
+        }
+    };
+
+    using DataPtrT = std::shared_ptr<const Data>;
+
+    // the shared copies of the sets and the unions of them
+    class SharedTable {
+        std::mutex mtx;
+        std::unordered_multimap<size_t, std::weak_ptr<const Data>> sets;
+
+        struct Union {
+            std::weak_ptr<const Data> a, b, result;
+        };
+
+        std::map<std::pair<const Data *, const Data *>, Union> unions;
+        // do not let the table of unions grow without limits
+        static const size_t MAX_UNIONS = 1 << 16;
+
+    public:
+        DataPtrT get(Data&& d)
+        {
+            size_t h = d.hash();
+            std::lock_guard<std::mutex> lock(mtx);
+
+            auto range = sets.equal_range(h);
+            for (auto I = range.first; I != range.second;) {
+                DataPtrT cur = I->second.lock();
+                if (!cur) {
+                    // all the sets with this data were destroyed
+                    I = sets.erase(I);
+                    continue;
+                }
+
+                if (*cur == d)
+                    return cur;
+
+                ++I;
+            }
+
+            DataPtrT ret = std::make_shared<const Data>(std::move(d));
+            sets.emplace(h, ret);
+            return ret;
+        }
+
+        DataPtrT getUnion(const DataPtrT& a, const DataPtrT& b)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = unions.find(std::make_pair(a.get(), b.get()));
+            if (it == unions.end())
+                return nullptr;
+
+            // the addresses may be reused by other data
+            if (it->second.a.lock() != a || it->second.b.lock() != b) {
+                unions.erase(it);
+                return nullptr;
+            }
+
+            return it->second.result.lock();
+        }
+
+        void addUnion(const DataPtrT& a, const DataPtrT& b,
+                      const DataPtrT& result)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (unions.size() >= MAX_UNIONS)
+                unions.clear();
+
+            unions[std::make_pair(a.get(), b.get())] = Union{a, b, result};
+        }
+
+        static SharedTable& instance()
+        {
+            static SharedTable table;
+            return table;
+        }
+    };
+
+    Data own;
+    // the data of the set if it is shared (then own is empty)
+    DataPtrT shared;
+
+    static TableT& table() { return TableT::instance(); }
+    static SharedTable& sharedTable() { return SharedTable::instance(); }
+
+    const Data& data() const { return shared ? *shared : own; }
+
+    // get a private copy of the shared data before changing it
+    void unshare()
+    {
+        if (!shared)
+            return;
+
+        own = *shared;
+        shared.reset();
+    }
+
+    BitsT::iterator findWord(unsigned idx)
+    {
+        return std::lower_bound(own.bits.begin(), own.bits.end(),
+                                std::make_pair(idx, (WordT) 0),
+                                [](const std::pair<unsigned, WordT>& a,
+                                   const std::pair<unsigned, WordT>& b) {
+                                    return a.first < b.first;
+                                });
+    }
+
+    static typename BitsT::const_iterator findWord(const BitsT& bits,
+                                                   unsigned idx)
+    {
+        return std::lower_bound(bits.begin(), bits.end(),
+                                std::make_pair(idx, (WordT) 0),
+                                [](const std::pair<unsigned, WordT>& a,
+                                   const std::pair<unsigned, WordT>& b) {
+                                    return a.first < b.first;
+                                });
+    }
+
+    bool setBit(unsigned id)
+    {
+        unsigned idx = id / WORD_BITS;
+        WordT mask = ((WordT) 1) << (id % WORD_BITS);
+        auto it = findWord(idx);
+        if (it == own.bits.end() || it->first != idx) {
+            own.bits.emplace(it, idx, mask);
+            return true;
+        }
+
+        if (it->second & mask)
+            return false;
+
+        it->second |= mask;
+        return true;
+    }
+
+    void toBits()
+    {
+        assert(own.is_small);
+        own.is_small = false;
+        for (const PointerT& p : own.small)
+            setBit(table().getId(p));
+
+        own.small.clear();
+        own.small.shrink_to_fit();
+    }
+
+    // the bitvector got small again (by erasing elements),
+    // make the representation of the set unique before sharing it
+    void toSmall()
+    {
+        assert(!own.is_small);
+        SmallT ptrs;
+        ptrs.reserve(own.elems);
+        for (const PointerT& p : *this)
+            ptrs.push_back(p);
+
+        std::sort(ptrs.begin(), ptrs.end());
+
+        own.filter = 0;
+        for (const PointerT& p : ptrs)
+            own.filter |= pointerFilterBit<PointerT, HashT>(p);
+
+        own.small.swap(ptrs);
+        own.bits.clear();
+        own.bits.shrink_to_fit();
+        own.is_small = true;
+    }
+
+public:
+    class const_iterator {
+        const Data *data;
+        // position in the vector of small set or vector of words
+        size_t pos;
+        // bit in the word (for big sets)
+        unsigned bit;
+
+        void skipEmpty()
+        {
+            if (data->is_small)
+                return;
+
+            while (pos < data->bits.size()) {
+                WordT w = data->bits[pos].second >> bit;
+                if (w != 0) {
+                    while (!(w & 1)) {
+                        w >>= 1;
+                        ++bit;
+                    }
+                    return;
+                }
+
+                ++pos;
+                bit = 0;
+            }
+        }
+
+        void setEnd()
+        {
+            pos = data->is_small ? data->small.size() : data->bits.size();
+            bit = 0;
+        }
+
+    public:
+        const_iterator(const PointsToSet *s, bool end = false)
+        : data(&s->data()), pos(0), bit(0)
+        {
+            if (end)
+                setEnd();
+            else
+                skipEmpty();
+        }
+
+        const PointerT& operator*() const
+        {
+            if (data->is_small)
+                return data->small[pos];
+
+            return table().get(data->bits[pos].first * WORD_BITS + bit);
+        }
+
+        const PointerT *operator->() const { return &operator*(); }
+
+        const_iterator& operator++()
+        {
+            if (data->is_small)
+                ++pos;
+            else {
+                ++bit;
+                if (bit == WORD_BITS) {
+                    bit = 0;
+                    ++pos;
+                }
+                skipEmpty();
+            }
+
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator tmp = *this;
+            operator++();
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& oth) const
+        {
+            return data == oth.data && pos == oth.pos && bit == oth.bit;
+        }
+
+        bool operator!=(const const_iterator& oth) const
+        {
+            return !operator==(oth);
+        }
+    };
+
+    using iterator = const_iterator;
+
+    PointsToSet() = default;
+    PointsToSet(std::initializer_list<PointerT> lst)
+    {
+        for (const PointerT& p : lst)
+            insert(p);
+    }
+
+    bool insert(const PointerT& p)
+    {
+        if (shared) {
+            if (count(p))
+                return false;
+
+            unshare();
+        }
+
+        own.filter |= pointerFilterBit<PointerT, HashT>(p);
+        if (own.is_small) {
+            auto it = std::lower_bound(own.small.begin(), own.small.end(), p);
+            if (it != own.small.end() && *it == p)
+                return false;
+
+            if (own.small.size() < SMALL_SIZE) {
+                own.small.insert(it, p);
+                ++own.elems;
+                return true;
+            }
+
+            toBits();
+        }
+
+        if (setBit(table().getId(p))) {
+            ++own.elems;
+            return true;
+        }
+
+        return false;
+    }
+
+    // merge @oth into this set
+    bool insert(const PointsToSet& oth)
+    {
+        if (oth.empty())
+            return false;
+
+        if (shared && oth.shared) {
+            if (shared == oth.shared)
+                return false;
+
+            // we have done this union already
+            DataPtrT result = sharedTable().getUnion(shared, oth.shared);
+            if (result) {
+                bool changed = result != shared;
+                shared = result;
+                return changed;
+            }
+
+            DataPtrT old = shared;
+            unshare();
+            bool changed = merge(oth);
+            share();
+            sharedTable().addUnion(old, oth.shared, shared);
+
+            return changed;
+        }
+
+        unshare();
+        return merge(oth);
+    }
+
+    size_t erase(const PointerT& p)
+    {
+        if (shared) {
+            if (!count(p))
+                return 0;
+
+            unshare();
+        }
+
+        if (own.is_small) {
+            auto it = std::lower_bound(own.small.begin(), own.small.end(), p);
+            if (it == own.small.end() || !(*it == p))
+                return 0;
+
+            own.small.erase(it);
+            --own.elems;
+            return 1;
+        }
+
+        unsigned id;
+        if (!table().findId(p, id))
+            return 0;
+
+        auto it = findWord(id / WORD_BITS);
+        WordT mask = ((WordT) 1) << (id % WORD_BITS);
+        if (it == own.bits.end() || it->first != id / WORD_BITS
+            || !(it->second & mask))
+            return 0;
+
+        it->second &= ~mask;
+        if (it->second == 0)
+            own.bits.erase(it);
+
+        --own.elems;
+        return 1;
+    }
+
+    size_t count(const PointerT& p) const
+    {
+        const Data& d = data();
+        if (!(d.filter & pointerFilterBit<PointerT, HashT>(p)))
+            return 0;
+
+        if (d.is_small)
+            return std::binary_search(d.small.begin(), d.small.end(), p);
+
+        unsigned id;
+        if (!table().findId(p, id))
+            return 0;
+
+        auto it = findWord(d.bits, id / WORD_BITS);
+        if (it == d.bits.end() || it->first != id / WORD_BITS)
+            return 0;
+
+        return (it->second >> (id % WORD_BITS)) & 1;
+    }
+
+    void clear()
+    {
+        own = Data();
+        shared.reset();
+    }
+
+    // use the shared copy of the data (create it if there is none).
+    // The shared sets can be compared in constant time
+    void share()
+    {
+        if (shared)
+            return;
+
+        if (!own.is_small && own.elems <= SMALL_SIZE)
+            toSmall();
+
+        shared = sharedTable().get(std::move(own));
+        own = Data();
+    }
+
+    bool isShared() const { return shared != nullptr; }
+
+    bool operator==(const PointsToSet& oth) const
+    {
+        // the shared data are unique
+        if (shared && oth.shared)
+            return shared == oth.shared;
+
+        if (size() != oth.size())
+            return false;
+
+        for (const PointerT& p : *this) {
+            if (!oth.count(p))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool operator!=(const PointsToSet& oth) const
+    {
+        return !operator==(oth);
+    }
+
+    size_t size() const { return data().elems; }
+    bool empty() const { return data().elems == 0; }
+    bool isSmall() const { return data().is_small; }
+
+    // the memory allocated by the set. The shared data are divided
+    // among the sets that share them, so that the sum over all
+    // the sets gives the memory used by the data
+    size_t getAllocatedBytes() const
+    {
+        const Data& d = data();
+        size_t bytes = d.small.capacity() * sizeof(PointerT)
+                       + d.bits.capacity() * sizeof(typename BitsT::value_type);
+        if (!shared)
+            return bytes;
+
+        return (bytes + sizeof(Data)) / shared.use_count();
+    }
+
+    const_iterator begin() const { return const_iterator(this); }
+    const_iterator end() const { return const_iterator(this, true); }
+
+    // the sets are going to be used (or are no longer used)
+    // from more threads at once
+    static void setConcurrent(bool c) { table().setConcurrent(c); }
+
+private:
+    bool merge(const PointsToSet& oth)
+    {
+        assert(!shared);
+        const Data& od = oth.data();
+
+        if (own.is_small || od.is_small) {
+            bool changed = false;
+            for (const PointerT& p : oth)
+                changed |= insert(p);
+
+            return changed;
+        }
+
+        // both are bitvectors, merge them word by word
+        BitsT result;
+        result.reserve(std::max(own.bits.size(), od.bits.size()));
+        size_t newelems = 0;
+        auto I = own.bits.begin(), E = own.bits.end();
+        auto OI = od.bits.begin(), OE = od.bits.end();
+        while (I != E || OI != OE) {
+            if (OI == OE || (I != E && I->first < OI->first)) {
+                result.push_back(*I++);
+            } else if (I == E || OI->first < I->first) {
+                result.push_back(*OI++);
+            } else {
+                result.emplace_back(I->first, I->second | OI->second);
+                ++I;
+                ++OI;
+            }
+
+            newelems += __builtin_popcountll(result.back().second);
+        }
+
+        bool changed = newelems != own.elems;
+        own.bits.swap(result);
+        own.elems = newelems;
+        own.filter |= od.filter;
+
+        return changed;
+    }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_POINTS_TO_SET_H_
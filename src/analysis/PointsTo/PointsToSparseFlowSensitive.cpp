@@ -0,0 +1,240 @@
+#include <algorithm>
+
+#include "PointsToSparseFlowSensitive.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+// search backward from @n for the stores and memcpys
+// of the class @cls, these are the definitions of the memory
+// that @n may see. The definitions hide the definitions
+// before them, because they have merged them already
+void PointsToSparseFlowSensitive::addReachingDefs(PSNode *n, MemoryClass cls,
+                        const std::unordered_map<PSNode *, MemoryClass>& defs)
+{
+    std::vector<PSNode *>& rd = reaching_defs[n];
+    std::set<PSNode *> visited;
+    std::vector<PSNode *> stack(n->getPredecessors().begin(),
+                                n->getPredecessors().end());
+
+    while (!stack.empty()) {
+        PSNode *cur = stack.back();
+        stack.pop_back();
+
+        if (!visited.insert(cur).second)
+            continue;
+
+        auto it = defs.find(cur);
+        if (it != defs.end() && it->second == cls) {
+            // the node itself is in a loop, its own map
+            // is merged into it already
+            if (cur != n && std::find(rd.begin(), rd.end(), cur) == rd.end())
+                rd.push_back(cur);
+            continue;
+        }
+
+        for (PSNode *pred : cur->getPredecessors())
+            stack.push_back(pred);
+    }
+}
+
+void PointsToSparseFlowSensitive::buildDefUse()
+{
+    reaching_defs.clear();
+    mem_users.clear();
+
+    const std::vector<PSNode *>& nodes = getPS()->getReachableNodes();
+
+    // the classes of memory that the stores and memcpys write to
+    std::unordered_map<PSNode *, MemoryClass> defs;
+    for (PSNode *n : nodes) {
+        if (isMemoryDef(n))
+            defs[n] = classes.getMemoryClass(n->getOperand(1));
+    }
+
+    for (PSNode *n : nodes) {
+        switch (n->getType()) {
+            case PSNodeType::LOAD:
+                addReachingDefs(n, classes.getMemoryClass(n->getOperand(0)),
+                                defs);
+                break;
+            case PSNodeType::MEMCPY:
+                // memcpy reads the source and keeps the old
+                // content of the destination
+                addReachingDefs(n, classes.getMemoryClass(n->getOperand(0)),
+                                defs);
+                // fall-through
+            case PSNodeType::STORE:
+                addReachingDefs(n, defs[n], defs);
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (auto& it : reaching_defs) {
+        for (PSNode *def : it.second)
+            mem_users[def].push_back(it.first);
+    }
+}
+
+void PointsToSparseFlowSensitive::graphChanged()
+{
+    // the new parts of the graph may unify some classes
+    classes.unifyGraph();
+
+    auto old_defs = std::move(reaching_defs);
+    buildDefUse();
+
+    for (PSNode *n : getPS()->getReachableNodes()) {
+        if (!processed.count(n)) {
+            enqueue(n);
+            continue;
+        }
+
+        if (!accessesMemory(n))
+            continue;
+
+        auto it = old_defs.find(n);
+        if (it == old_defs.end() || it->second != reaching_defs[n])
+            enqueue(n);
+    }
+}
+
+bool PointsToSparseFlowSensitive::mergeReachingDefs(PSNode *n,
+                                                    PointsToSetT *strong_update)
+{
+    MemoryMapT *mm = getMemoryMap(n);
+    assert(mm && "Do not have memory map");
+
+    bool changed = false;
+    auto it = reaching_defs.find(n);
+    if (it == reaching_defs.end())
+        return false;
+
+    for (PSNode *def : it->second) {
+        MemoryMapT *pm = getMemoryMap(def);
+        // merge pm to mm (but only if pm was already created)
+        if (pm && pm != mm)
+            changed |= mergeMaps(mm, pm, strong_update);
+    }
+
+    return changed;
+}
+
+bool PointsToSparseFlowSensitive::beforeProcessed(PSNode *n)
+{
+    if (!accessesMemory(n))
+        return false;
+
+    if (!getMemoryMap(n))
+        setMemoryMap(n, createMM());
+
+    // stores and memcpys merge the maps after they wrote
+    // (the same as in PointsToFlowSensitive)
+    if (isMemoryDef(n))
+        return false;
+
+    return mergeReachingDefs(n, nullptr);
+}
+
+bool PointsToSparseFlowSensitive::afterProcessed(PSNode *n)
+{
+    if (!isMemoryDef(n))
+        return false;
+
+    // every store is a strong update
+    PointsToSetT *strong_update = nullptr;
+    if (n->getType() == PSNodeType::STORE)
+        strong_update = &n->getOperand(1)->pointsTo;
+
+    return mergeReachingDefs(n, strong_update);
+}
+
+void PointsToSparseFlowSensitive::memoryChanged(PSNode *n)
+{
+    auto it = mem_users.find(n);
+    if (it == mem_users.end())
+        return;
+
+    for (PSNode *user : it->second)
+        enqueue(user);
+}
+
+void PointsToSparseFlowSensitive::run()
+{
+    PSNode *root = getPS()->getRoot();
+    assert(root && "Do not have root of PS");
+
+    budget.start();
+    startProgress();
+    RoundsScope rounds{this};
+    trackMemoryReaders(true);
+    classes.unifyGraph();
+    buildDefUse();
+
+    for (PSNode *n : getPS()->getReachableNodes())
+        enqueue(n);
+
+    while (!budget.isExceeded()) {
+        newProgressRound();
+        while (!worklist.empty() && !budget.isExceeded()) {
+            PSNode *cur = worklist.pop();
+            queued.erase(cur);
+            processed.insert(cur);
+
+            bool mem_changed = beforeProcessed(cur);
+
+            MemoryMapT *mm = getMemoryMap(cur);
+            size_t mm_size = mm ? mm->size() : 0;
+
+            bool changed = processNodeIfNeeded(cur);
+
+            // the store got new objects from the definitions before it,
+            // process it again to write to them
+            if (afterProcessed(cur)) {
+                mem_changed = true;
+                enqueue(cur);
+            }
+
+            // a store created a new memory object
+            if (mm && mm->size() != mm_size)
+                mem_changed = true;
+
+            if (changed) {
+                for (PSNode *user : cur->getUsers())
+                    enqueue(user);
+
+                if (isMemoryDef(cur))
+                    mem_changed = true;
+            }
+
+            if (mem_changed)
+                memoryChanged(cur);
+
+            reportProgress(worklist.size());
+        }
+
+        // add the subgraphs of the functions called
+        // via pointers that were found until now
+        std::vector<PSNode *> calls = resolveFunctionPointerCalls();
+        if (calls.empty())
+            break;
+
+        graphChanged();
+        for (PSNode *callsite : calls) {
+            PSNode *ret = callsite->getPairedNode();
+            enqueue(ret);
+            for (PSNode *user : ret->getUsers())
+                enqueue(user);
+        }
+    }
+
+    processed.clear();
+    trackMemoryReaders(false);
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
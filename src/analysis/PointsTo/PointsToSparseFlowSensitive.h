@@ -0,0 +1,87 @@
+#ifndef _DG_ANALYSIS_POINTS_TO_SPARSE_FLOW_SENSITIVE_H_
+#define _DG_ANALYSIS_POINTS_TO_SPARSE_FLOW_SENSITIVE_H_
+
+#include <cassert>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+#include "PointerAnalysis.h"
+#include "PointsToFlowSensitive.h"
+#include "PointsToSteensgaard.h"
+#include "ADT/Queue.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Sparse flow-sensitive pointer analysis.
+//
+// PointsToFlowSensitive keeps a memory map on every node and pushes
+// it along every edge of the PointerSubgraph. Here only the nodes that
+// access memory (LOAD, STORE, MEMCPY) have memory maps. A cheap
+// pre-analysis (Steensgaard) splits the memory into classes and every
+// node that accesses a class gets the memory maps directly from the
+// stores (and memcpys) of the same class that reach it in the graph
+// (the memory def-use chains). The changes of memory are propagated
+// only along these chains. The results are the same as the results
+// of PointsToFlowSensitive.
+class PointsToSparseFlowSensitive : public PointsToFlowSensitive
+{
+    using MemoryClass = const PointsToSteensgaard::ECR *;
+
+    // the pre-analysis
+    PointsToSteensgaard classes;
+
+    // the stores and memcpys whose memory maps reach the node
+    std::unordered_map<PSNode *, std::vector<PSNode *>> reaching_defs;
+    // the inverse relation - the nodes that a store or memcpy reaches
+    std::unordered_map<PSNode *, std::vector<PSNode *>> mem_users;
+
+    ADT::QueueFIFO<PSNode *> worklist;
+    std::set<PSNode *> queued;
+    std::set<PSNode *> processed;
+
+    static bool isMemoryDef(PSNode *n)
+    {
+        return n->getType() == PSNodeType::STORE
+               || n->getType() == PSNodeType::MEMCPY;
+    }
+
+    static bool accessesMemory(PSNode *n)
+    {
+        return n->getType() == PSNodeType::LOAD || isMemoryDef(n);
+    }
+
+    void addReachingDefs(PSNode *n, MemoryClass cls,
+                         const std::unordered_map<PSNode *, MemoryClass>& defs);
+    // compute the memory def-use chains
+    void buildDefUse();
+    // the graph changed due to a call via function pointer
+    void graphChanged();
+
+    bool mergeReachingDefs(PSNode *n, PointsToSetT *strong_update);
+
+public:
+    PointsToSparseFlowSensitive(PointerSubgraph *ps)
+    : PointsToFlowSensitive(ps), classes(ps) {}
+
+    bool beforeProcessed(PSNode *n) override;
+    bool afterProcessed(PSNode *n) override;
+    void memoryChanged(PSNode *n) override;
+
+    void enqueue(PSNode *n) override
+    {
+        if (queued.insert(n).second)
+            worklist.push(n);
+    }
+
+    void run() override;
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_POINTS_TO_SPARSE_FLOW_SENSITIVE_H_
@@ -0,0 +1,238 @@
+#include "PointsToSteensgaard.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+PointsToSteensgaard::ECR *PointsToSteensgaard::find(ECR *e)
+{
+    ECR *root = e;
+    while (root->parent != root)
+        root = root->parent;
+
+    // path compression
+    while (e != root) {
+        ECR *next = e->parent;
+        e->parent = root;
+        e = next;
+    }
+
+    return root;
+}
+
+void PointsToSteensgaard::unify(ECR *a, ECR *b)
+{
+    // unifying two classes means unifying also the classes
+    // they point to, use a stack instead of recursion
+    std::vector<std::pair<ECR *, ECR *>> pending;
+    pending.emplace_back(a, b);
+
+    while (!pending.empty()) {
+        ECR *x = find(pending.back().first);
+        ECR *y = find(pending.back().second);
+        pending.pop_back();
+
+        if (x == y)
+            continue;
+
+        // union by rank
+        if (x->rank < y->rank)
+            std::swap(x, y);
+        if (x->rank == y->rank)
+            ++x->rank;
+
+        y->parent = x;
+        x->targets.insert(x->targets.end(),
+                          y->targets.begin(), y->targets.end());
+        y->targets.clear();
+        y->targets.shrink_to_fit();
+        x->null |= y->null;
+
+        if (!x->pointee)
+            x->pointee = y->pointee;
+        else if (y->pointee)
+            pending.emplace_back(x->pointee, y->pointee);
+    }
+}
+
+PointsToSteensgaard::ECR *PointsToSteensgaard::pointee(ECR *e)
+{
+    e = find(e);
+    if (!e->pointee)
+        e->pointee = ecrs.create();
+
+    return find(e->pointee);
+}
+
+PointsToSteensgaard::ECR *PointsToSteensgaard::value(PSNode *n)
+{
+    auto it = values.find(n);
+    if (it != values.end())
+        return it->second;
+
+    ECR *e = ecrs.create();
+    values.emplace(n, e);
+
+    // allocation sites point to themselves
+    switch (n->getType()) {
+        case PSNodeType::ALLOC:
+        case PSNodeType::DYN_ALLOC:
+        case PSNodeType::FUNCTION:
+        case PSNodeType::UNKNOWN_MEM:
+            pointee(e)->targets.push_back(n);
+            // loading from zeroed memory yields null
+            if (n->isZeroInitialized())
+                pointee(pointee(e))->null = true;
+            // the memory stores these pointers from the beginning
+            if (n->getInitialPointers()) {
+                for (const auto& it : *n->getInitialPointers()) {
+                    if (it.second.isNull())
+                        pointee(pointee(e))->null = true;
+                    else
+                        unify(pointee(pointee(e)),
+                              pointee(value(it.second.target)));
+                }
+            }
+            break;
+        default:
+            // the node may not be in the graph (e.g. constants),
+            // so take its initial pointers right now
+            for (const Pointer& ptr : n->pointsTo)
+                assign(n, ptr.target);
+            break;
+    }
+
+    return e;
+}
+
+void PointsToSteensgaard::assign(PSNode *to, PSNode *from)
+{
+    // do not unify everything that can be null together,
+    // just remember that the value can be null
+    if (from->isNull())
+        pointee(value(to))->null = true;
+    else
+        unify(pointee(value(to)), pointee(value(from)));
+}
+
+void PointsToSteensgaard::unifyNode(PSNode *node)
+{
+    // the pointers that the node has from the beginning
+    // (constants, calls of undefined functions, ...)
+    if (!isMemory(node)) {
+        for (const Pointer& ptr : node->pointsTo)
+            assign(node, ptr.target);
+    }
+
+    switch (node->getType()) {
+        case PSNodeType::LOAD:
+            if (!node->getOperand(0)->isNull())
+                unify(pointee(value(node)),
+                      pointee(pointee(value(node->getOperand(0)))));
+            break;
+        case PSNodeType::STORE:
+            // store operand(0) to memory pointed by operand(1)
+            if (node->getOperand(1)->isNull())
+                break;
+
+            if (node->getOperand(0)->isNull())
+                pointee(pointee(value(node->getOperand(1))))->null = true;
+            else
+                unify(pointee(pointee(value(node->getOperand(1)))),
+                      pointee(value(node->getOperand(0))));
+            break;
+        case PSNodeType::MEMCPY:
+            if (!node->getOperand(0)->isNull() && !node->getOperand(1)->isNull())
+                unify(pointee(pointee(value(node->getOperand(1)))),
+                      pointee(pointee(value(node->getOperand(0)))));
+            break;
+        case PSNodeType::GEP:
+        case PSNodeType::CAST:
+        case PSNodeType::CALL_FUNCPTR:
+        case PSNodeType::PHI:
+        case PSNodeType::RETURN:
+        case PSNodeType::CALL_RETURN:
+            for (size_t i = 0; i < node->getOperandsNum(); ++i)
+                assign(node, node->getOperand(i));
+            break;
+        case PSNodeType::ALLOC:
+        case PSNodeType::DYN_ALLOC:
+        case PSNodeType::FUNCTION:
+            // create the class of the allocation site
+            value(node);
+            break;
+        case PSNodeType::CONSTANT:
+        case PSNodeType::CALL:
+        case PSNodeType::ENTRY:
+        case PSNodeType::NOOP:
+            break;
+        default:
+            assert(0 && "Unknown type");
+    }
+}
+
+void PointsToSteensgaard::setPointsTo(PSNode *node)
+{
+    // these have their points-to set already
+    if (isMemory(node) || node->getType() == PSNodeType::CONSTANT)
+        return;
+
+    ECR *e = pointee(value(node));
+    for (PSNode *target : e->targets) {
+        // functions have no fields
+        if (target->getType() == PSNodeType::FUNCTION)
+            node->addPointsTo(target, 0);
+        else
+            node->addPointsTo(target, UNKNOWN_OFFSET);
+    }
+
+    if (e->null)
+        node->addPointsTo(NULLPTR, 0);
+}
+
+void PointsToSteensgaard::unifyGraph()
+{
+    PSNode *root = getPS()->getRoot();
+    assert(root && "Do not have root of PS");
+
+    bool graph_changed;
+
+    do {
+        graph_changed = false;
+        std::vector<PSNode *> nodes = getPS()->getReachableNodes();
+
+        // unification is idempotent, so it does not matter
+        // that we go over the nodes again in the next round
+        for (PSNode *n : nodes)
+            unifyNode(n);
+
+        // new calls via function pointers add new parts of the graph
+        for (PSNode *n : nodes) {
+            if (n->getType() != PSNodeType::CALL_FUNCPTR)
+                continue;
+
+            // copy the targets, the call may unify the classes
+            std::vector<PSNode *> targets = pointee(value(n))->targets;
+            for (PSNode *target : targets) {
+                if (target->getType() != PSNodeType::FUNCTION
+                    || !calls.insert(std::make_pair(n, target)).second)
+                    continue;
+
+                graph_changed |= functionPointerCall(n, target);
+            }
+        }
+    } while (graph_changed);
+}
+
+void PointsToSteensgaard::run()
+{
+    unifyGraph();
+
+    // the classes are kept for mayAlias() queries
+    for (PSNode *n : getPS()->getReachableNodes())
+        setPointsTo(n);
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,97 @@
+#ifndef _DG_ANALYSIS_POINTS_TO_STEENSGAARD_H_
+#define _DG_ANALYSIS_POINTS_TO_STEENSGAARD_H_
+
+#include <cassert>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+#include "PointerAnalysis.h"
+#include "ADT/Arena.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Unification-based (Steensgaard-style) pointer analysis.
+//
+// Every node has a class of values and every class points to at most
+// one class of memory objects. Assignments unify the pointed classes,
+// so the analysis runs in almost linear time in the size of the graph,
+// but it is flow-insensitive, field-insensitive and very coarse.
+// The pointers in the results have UNKNOWN_OFFSET
+// (with the exception of pointers to functions).
+class PointsToSteensgaard : public PointerAnalysis
+{
+public:
+    // equivalence class
+    struct ECR {
+        ECR *parent;
+        unsigned rank = 0;
+        // the class that the members of this class point to
+        ECR *pointee = nullptr;
+        // allocation sites (memory objects) in this class
+        std::vector<PSNode *> targets;
+        // can the members be null?
+        bool null = false;
+
+        ECR() : parent(this) {}
+    };
+
+private:
+    ADT::Arena<ECR> ecrs;
+    std::unordered_map<PSNode *, ECR *> values;
+    // calls via function pointers that we already resolved
+    std::set<std::pair<PSNode *, PSNode *>> calls;
+
+    static bool isMemory(PSNode *n)
+    {
+        return n->getType() == PSNodeType::ALLOC
+               || n->getType() == PSNodeType::DYN_ALLOC
+               || n->getType() == PSNodeType::FUNCTION;
+    }
+
+    ECR *find(ECR *e);
+    void unify(ECR *a, ECR *b);
+    ECR *pointee(ECR *e);
+    ECR *value(PSNode *n);
+
+    // the pointers of @from flow to @to
+    void assign(PSNode *to, PSNode *from);
+    void unifyNode(PSNode *node);
+    void setPointsTo(PSNode *node);
+
+public:
+    PointsToSteensgaard(PointerSubgraph *ps)
+    : PointerAnalysis(ps, UNKNOWN_OFFSET, false) {}
+
+    // we do not have any memory objects,
+    // the points-to sets are computed directly
+    void getMemoryObjects(PSNode *, const Pointer&,
+                          std::vector<MemoryObject *>&) override {}
+
+    void run() override;
+
+    // compute the classes, but do not set the points-to sets
+    // of the nodes (for using the analysis as a pre-analysis).
+    // It can be called again when the graph changes
+    void unifyGraph();
+
+    // the class of the memory that the pointers in @n may point to.
+    // Nodes that may access the same memory get the same class
+    // (until the classes are unified with new information)
+    const ECR *getMemoryClass(PSNode *n) { return pointee(value(n)); }
+
+    // may the pointers in the nodes point to the same memory?
+    bool mayAlias(PSNode *a, PSNode *b)
+    {
+        return pointee(value(a)) == pointee(value(b));
+    }
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_POINTS_TO_STEENSGAARD_H_
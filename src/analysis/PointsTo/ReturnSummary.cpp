@@ -0,0 +1,86 @@
+#include <set>
+
+#include "ReturnSummary.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+bool ReturnSummary::compute(const std::vector<PSNode *>& rets,
+                            const std::map<PSNode *, unsigned>& args,
+                            const std::set<PSNode *>& calls)
+{
+    terms.clear();
+    valid = false;
+
+    std::set<Term> found;
+    std::set<std::pair<PSNode *, uint64_t>> visited;
+    std::vector<std::pair<PSNode *, Offset>> stack;
+    for (PSNode *r : rets)
+        stack.emplace_back(r, 0);
+
+    // go from the returned values to where the pointers come from
+    // and sum up the offsets on the way
+    while (!stack.empty()) {
+        PSNode *cur = stack.back().first;
+        Offset off = stack.back().second;
+        stack.pop_back();
+
+        if (!visited.insert(std::make_pair(cur, *off)).second)
+            continue;
+
+        if (visited.size() > MAX_NODES)
+            return false;
+
+        auto it = args.find(cur);
+        if (it != args.end()) {
+            found.insert(Term{nullptr, it->second, off});
+            continue;
+        }
+
+        switch (cur->getType()) {
+            case PSNodeType::ALLOC:
+            case PSNodeType::DYN_ALLOC:
+            case PSNodeType::FUNCTION:
+            case PSNodeType::CONSTANT:
+            case PSNodeType::NULL_ADDR:
+            case PSNodeType::UNKNOWN_MEM:
+                // the points-to sets of these never change
+                found.insert(Term{cur, 0, off});
+                break;
+            case PSNodeType::GEP:
+                // the summary terms have one offset
+                if (cur->getStride() > 0)
+                    return false;
+                stack.emplace_back(cur->getOperand(0), off + cur->getOffset());
+                break;
+            case PSNodeType::CAST:
+            case PSNodeType::PHI:
+            case PSNodeType::RETURN:
+                for (PSNode *op : cur->getOperands())
+                    stack.emplace_back(op, off);
+                break;
+            case PSNodeType::CALL_RETURN:
+                // the call gets the pointers from the instantiated
+                // summary of the called function
+                if (calls.count(cur) == 0)
+                    return false;
+
+                for (PSNode *op : cur->getOperands())
+                    stack.emplace_back(op, off);
+                break;
+            default:
+                // the pointers come from memory or from other calls,
+                // these depend on more than the arguments
+                return false;
+        }
+    }
+
+    terms.assign(found.begin(), found.end());
+    valid = true;
+    return true;
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
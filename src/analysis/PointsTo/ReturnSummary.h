@@ -0,0 +1,170 @@
+#ifndef _DG_ANALYSIS_POINTS_TO_RETURN_SUMMARY_H_
+#define _DG_ANALYSIS_POINTS_TO_RETURN_SUMMARY_H_
+
+#include <cassert>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "PointerSubgraph.h"
+#include "ADT/Arena.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+///
+// Summary of the pointers returned from a function.
+//
+// When the returned value is computed only by copying (CAST, PHI, GEP)
+// the arguments of the function and allocation sites, the pointers
+// returned from a call are just the pointers of the actual arguments
+// of this call (moved by the offsets of the GEPs) and the pointers
+// to the allocation sites. The summary is the list of these
+// (argument or allocation site, offset) pairs. It is computed once
+// from the subgraph of the function and instantiated at every call,
+// so that the call gets only the pointers from its own arguments
+// and not from all the calls of the function.
+//
+// The returned value may also come from the calls whose summaries
+// were instantiated already (the summaries are composed), so
+// the summaries are computed bottom-up in the call graph.
+// When instantiating, the allocation sites can be replaced by new
+// nodes for every call (see LLVMPointerSubgraphBuilder::setHeapCloning).
+class ReturnSummary
+{
+public:
+    struct Term {
+        // where the pointers come from, nullptr for the argument @arg
+        PSNode *source;
+        unsigned arg;
+        Offset offset;
+
+        bool operator<(const Term& oth) const
+        {
+            if (source != oth.source)
+                return source < oth.source;
+            if (arg != oth.arg)
+                return arg < oth.arg;
+            return offset < oth.offset;
+        }
+    };
+
+    // do not go through too big subgraphs (or through loops
+    // that keep changing the offsets)
+    static const size_t MAX_NODES = 1000;
+
+    // compute the summary of the function that returns via the
+    // RETURN nodes @rets, @args maps the nodes of the arguments
+    // to their indices and @calls are the CALL_RETURN nodes
+    // of the calls whose summaries are instantiated (their operand
+    // is the instantiated value). Returns false if the returned
+    // value cannot be summarized
+    bool compute(const std::vector<PSNode *>& rets,
+                 const std::map<PSNode *, unsigned>& args,
+                 const std::set<PSNode *>& calls = {});
+
+    bool isValid() const { return valid; }
+
+    // the summary is worth instantiating only if the calls
+    // return something that comes from their arguments
+    bool hasArguments() const
+    {
+        for (const Term& t : terms) {
+            if (!t.source)
+                return true;
+        }
+
+        return false;
+    }
+
+    // do the calls return memory allocated on heap in the function
+    // (or in the functions it calls)?
+    bool hasHeapAllocations() const
+    {
+        for (const Term& t : terms) {
+            if (t.source && t.source->getType() == PSNodeType::DYN_ALLOC
+                && t.source->isHeap())
+                return true;
+        }
+
+        return false;
+    }
+
+    const std::vector<Term>& getTerms() const { return terms; }
+
+    // create the nodes (by @nodes.create(), e.g. in ADT::Arena
+    // or PointerSubgraph) that compute the returned pointers
+    // from the @actuals of a call. Returns the sequence of the new nodes (to be put into the graph
+    // before the subgraph of the function, it may be empty) and sets
+    // @value to the node with the returned pointers (nullptr if the
+    // call does not return anything). If @mapSource is given, the call
+    // gets the pointers to mapSource(source) instead of the sources
+    template <typename NodesT>
+    std::pair<PSNode *, PSNode *>
+    instantiate(const std::vector<PSNode *>& actuals, NodesT& nodes,
+                PSNode *& value,
+                const std::function<PSNode *(PSNode *)>& mapSource = nullptr) const
+    {
+        assert(valid && "Instantiating invalid summary");
+
+        std::pair<PSNode *, PSNode *> seq(nullptr, nullptr);
+        auto append = [&seq](PSNode *n) {
+            if (seq.second)
+                seq.second->addSuccessor(n);
+            else
+                seq.first = n;
+
+            seq.second = n;
+        };
+
+        std::vector<PSNode *> values;
+        for (const Term& t : terms) {
+            PSNode *src = t.source;
+            if (!src) {
+                // the call does not pass anything in this argument
+                if (t.arg >= actuals.size() || !actuals[t.arg])
+                    continue;
+
+                src = actuals[t.arg];
+            } else if (mapSource) {
+                src = mapSource(src);
+            }
+
+            if (t.offset == 0) {
+                values.push_back(src);
+                continue;
+            }
+
+            PSNode *gep = nodes.create(PSNodeType::GEP, src, *t.offset);
+            append(gep);
+            values.push_back(gep);
+        }
+
+        if (values.empty())
+            value = nullptr;
+        else if (values.size() == 1)
+            value = values[0];
+        else {
+            value = nodes.create(PSNodeType::PHI, nullptr);
+            for (PSNode *v : values)
+                value->addOperand(v);
+
+            append(value);
+        }
+
+        return seq;
+    }
+
+private:
+    std::vector<Term> terms;
+    bool valid = false;
+};
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_POINTS_TO_RETURN_SUMMARY_H_
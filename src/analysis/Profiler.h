@@ -0,0 +1,306 @@
+#ifndef _DG_PROFILER_H_
+#define _DG_PROFILER_H_
+
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "analysis/MemoryUsage.h"
+
+namespace dg {
+namespace analysis {
+
+///
+// Hierarchical profiler of the phases of the tools and the analyses.
+// A phase started while another phase runs is its child. For every
+// phase we keep the wall and CPU time, the growth of the peak RSS
+// and the counters pushed while it ran. The phases with the same name
+// and parent are summed in the report, the trace has every run.
+//
+// At most one profiler is active at a time. The analyses open their
+// phases with Profiler::Scope and push their counters with
+// Profiler::count(), both do nothing when no profiler is active.
+// The phases must be started and stopped from one thread,
+// the counters can be pushed from any thread.
+class Profiler
+{
+public:
+    using Counters = std::vector<std::pair<std::string, uint64_t>>;
+
+    struct Phase {
+        std::string name;
+        // the index of the parent phase (the root is its own parent)
+        unsigned parent;
+        std::vector<unsigned> children;
+        // how many times the phase ran
+        unsigned runs = 0;
+        // nanoseconds
+        uint64_t wall = 0;
+        uint64_t cpu = 0;
+        // bytes
+        uint64_t peakRSSDelta = 0;
+        Counters counters;
+
+        Phase(const std::string& n, unsigned p) : name(n), parent(p) {}
+    };
+
+private:
+    // one run of a phase (an event of the trace)
+    struct Run {
+        unsigned phase;
+        unsigned depth;
+        uint64_t wallStart = 0, wall = 0;
+        uint64_t cpuStart = 0, cpu = 0;
+        uint64_t peakRSSStart = 0, peakRSSDelta = 0;
+        Counters counters;
+
+        Run(unsigned p, unsigned d) : phase(p), depth(d) {}
+    };
+
+    std::vector<Phase> phases;
+    std::vector<Run> runs;
+    // the indices of the runs that were not stopped yet
+    std::vector<unsigned> stack;
+    std::mutex counters_mutex;
+
+    static Profiler *& current()
+    {
+        static Profiler *profiler = nullptr;
+        return profiler;
+    }
+
+    static uint64_t now(clockid_t clk)
+    {
+        struct timespec ts;
+        clock_gettime(clk, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static void addCounter(Counters& counters, const char *name, uint64_t n)
+    {
+        for (auto& c : counters) {
+            if (c.first == name) {
+                c.second += n;
+                return;
+            }
+        }
+
+        counters.emplace_back(name, n);
+    }
+
+    void push(unsigned phase)
+    {
+        runs.emplace_back(phase, stack.size());
+        Run& r = runs.back();
+        r.wallStart = now(CLOCK_MONOTONIC);
+        r.cpuStart = now(CLOCK_PROCESS_CPUTIME_ID);
+        r.peakRSSStart = getPeakRSS();
+        stack.push_back(runs.size() - 1);
+    }
+
+    void pop()
+    {
+        assert(!stack.empty() && "No phase is running");
+        Run& r = runs[stack.back()];
+        stack.pop_back();
+
+        r.wall = now(CLOCK_MONOTONIC) - r.wallStart;
+        r.cpu = now(CLOCK_PROCESS_CPUTIME_ID) - r.cpuStart;
+        r.peakRSSDelta = getPeakRSS() - r.peakRSSStart;
+
+        Phase& P = phases[r.phase];
+        ++P.runs;
+        P.wall += r.wall;
+        P.cpu += r.cpu;
+        P.peakRSSDelta += r.peakRSSDelta;
+
+        std::lock_guard<std::mutex> lock(counters_mutex);
+        for (const auto& c : r.counters)
+            addCounter(P.counters, c.first.c_str(), c.second);
+    }
+
+    void reportPhase(FILE *out, unsigned idx, unsigned depth) const
+    {
+        const Phase& P = phases[idx];
+        fprintf(out, "%*s%-*s %10.3f s %10.3f s %+10.2f MB",
+                2 * depth, "", 40 - 2 * depth, P.name.c_str(),
+                P.wall / 1e9, P.cpu / 1e9, P.peakRSSDelta / (1024.0 * 1024.0));
+        if (P.runs > 1)
+            fprintf(out, "  (%u runs)", P.runs);
+        fputc('\n', out);
+
+        for (const auto& c : P.counters)
+            fprintf(out, "%*s- %s: %" PRIu64 "\n",
+                    2 * depth + 2, "", c.first.c_str(), c.second);
+
+        for (unsigned child : P.children)
+            reportPhase(out, child, depth + 1);
+    }
+
+    static void writeJSONString(FILE *out, const std::string& str)
+    {
+        fputc('"', out);
+        for (char c : str) {
+            if (c == '"' || c == '\\')
+                fprintf(out, "\\%c", c);
+            else if (static_cast<unsigned char>(c) < 0x20)
+                fprintf(out, "\\u%04x", c);
+            else
+                fputc(c, out);
+        }
+        fputc('"', out);
+    }
+
+public:
+    // create the profiler and start the root phase @name.
+    // The profiler becomes the active one if there is none
+    Profiler(const char *name = "total")
+    {
+        phases.emplace_back(name, 0);
+        push(0);
+
+        if (!current())
+            current() = this;
+    }
+
+    ~Profiler()
+    {
+        if (current() == this)
+            current() = nullptr;
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // the active profiler (nullptr if there is none)
+    static Profiler *get() { return current(); }
+
+    // start the phase @name as a child of the running phase
+    void start(const char *name)
+    {
+        assert(!stack.empty() && "The profiler was finished");
+        unsigned parent = runs[stack.back()].phase;
+
+        unsigned phase = 0;
+        for (unsigned child : phases[parent].children) {
+            if (phases[child].name == name) {
+                phase = child;
+                break;
+            }
+        }
+
+        if (phase == 0) {
+            phases.emplace_back(name, parent);
+            phase = phases.size() - 1;
+            phases[parent].children.push_back(phase);
+        }
+
+        push(phase);
+    }
+
+    // stop the running phase
+    void stop()
+    {
+        assert(stack.size() > 1 && "Stopping the root phase, use finish()");
+        pop();
+    }
+
+    // stop all the running phases including the root
+    void finish()
+    {
+        while (!stack.empty())
+            pop();
+    }
+
+    // add @n to the counter @name of the running phase
+    void add(const char *name, uint64_t n = 1)
+    {
+        std::lock_guard<std::mutex> lock(counters_mutex);
+        if (!stack.empty())
+            addCounter(runs[stack.back()].counters, name, n);
+    }
+
+    // add @n to the counter @name of the active profiler (if any)
+    static void count(const char *name, uint64_t n = 1)
+    {
+        if (Profiler *p = current())
+            p->add(name, n);
+    }
+
+    const std::vector<Phase>& getPhases() const { return phases; }
+
+    // print the tree of the phases, the profiler must be finished
+    void report(FILE *out = stderr) const
+    {
+        assert(stack.empty() && "The profiler was not finished");
+        fprintf(out, "%-40s %12s %12s %13s\n",
+                "Time report:", "wall", "cpu", "peak RSS");
+        reportPhase(out, 0, 0);
+        fflush(out);
+    }
+
+    // write the runs of the phases in the Chrome trace event format
+    // (viewable in chrome://tracing), the profiler must be finished
+    bool writeTrace(const std::string& path) const
+    {
+        assert(stack.empty() && "The profiler was not finished");
+        FILE *out = fopen(path.c_str(), "w");
+        if (!out)
+            return false;
+
+        uint64_t start = runs.empty() ? 0 : runs[0].wallStart;
+
+        fprintf(out, "{\"traceEvents\":[");
+        for (size_t i = 0; i < runs.size(); ++i) {
+            const Run& r = runs[i];
+            fprintf(out, "%s\n{\"name\":", i == 0 ? "" : ",");
+            writeJSONString(out, phases[r.phase].name);
+            fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                         "\"ts\":%.3f,\"dur\":%.3f,\"args\":{"
+                         "\"cpu_ms\":%.3f,\"peak_rss_delta\":%" PRIu64,
+                    (r.wallStart - start) / 1e3, r.wall / 1e3,
+                    r.cpu / 1e6, r.peakRSSDelta);
+            for (const auto& c : r.counters) {
+                fputc(',', out);
+                writeJSONString(out, c.first);
+                fprintf(out, ":%" PRIu64, c.second);
+            }
+            fprintf(out, "}}");
+        }
+        fprintf(out, "\n]}\n");
+
+        return fclose(out) == 0;
+    }
+
+    // run a phase of the active profiler (if any) in the scope
+    class Scope {
+        Profiler *profiler;
+
+    public:
+        Scope(const char *name) : profiler(current())
+        {
+            if (profiler)
+                profiler->start(name);
+        }
+
+        ~Scope()
+        {
+            if (profiler)
+                profiler->stop();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_PROFILER_H_
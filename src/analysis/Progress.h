@@ -0,0 +1,139 @@
+#ifndef _DG_ANALYSIS_PROGRESS_H_
+#define _DG_ANALYSIS_PROGRESS_H_
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "MemoryUsage.h"
+
+namespace dg {
+namespace analysis {
+
+///
+// Periodic reports of a running fixpoint computation, so that a slow run
+// can be told from a run that does not converge. The analyses call tick()
+// in their fixpoint loops (it is cheap, it looks at the clock only every
+// CHECK_PERIOD calls) and when it returns true, they fill in a Report
+// and pass it to report(). Every report is one line written to stderr
+// or to the status file, which then contains only the last report.
+// Unlike Budget, tick() must not be called from more threads at once
+// (the analyses do not report from their parallel parts).
+class Progress
+{
+    // 0 means no reports
+    uint64_t period_ms = 0;
+    // empty means stderr
+    std::string file;
+
+    const char *name = "";
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point last;
+    uint32_t ticks = 0;
+    // the numbers of the last report, to compute the rates
+    uint64_t last_processed = 0;
+    uint64_t last_sets = 0;
+
+public:
+    // the nodes may take long to process, so look at the clock
+    // more often than Budget does
+    enum : uint32_t { CHECK_PERIOD = 64 };
+
+    struct Report {
+        // the round of the fixpoint computation
+        uint64_t round = 0;
+        // the number of nodes waiting for processing
+        uint64_t worklist = 0;
+        // the number of nodes processed so far
+        uint64_t processed = 0;
+        // the sum of the sizes of the sets computed by the analysis
+        uint64_t sets = 0;
+    };
+
+    Progress() = default;
+    Progress(uint64_t period_ms, const std::string& file = "")
+        : period_ms(period_ms), file(file) {}
+
+    // copy only the settings, not the state of a run
+    Progress(const Progress& oth)
+        : period_ms(oth.period_ms), file(oth.file) {}
+
+    Progress& operator=(const Progress& oth)
+    {
+        period_ms = oth.period_ms;
+        file = oth.file;
+        return *this;
+    }
+
+    void setPeriod(uint64_t ms) { period_ms = ms; }
+    void setFile(const std::string& f) { file = f; }
+
+    uint64_t getPeriod() const { return period_ms; }
+    bool isEnabled() const { return period_ms > 0; }
+
+    // start a new run of the analysis @analysis_name
+    // (must be a string literal or live as long as the run)
+    void start(const char *analysis_name)
+    {
+        name = analysis_name;
+        started = last = std::chrono::steady_clock::now();
+        ticks = 0;
+        last_processed = last_sets = 0;
+    }
+
+    // returns true if a report is due
+    bool tick()
+    {
+        if (!isEnabled() || ++ticks % CHECK_PERIOD != 0)
+            return false;
+
+        return std::chrono::steady_clock::now() - last
+                >= std::chrono::milliseconds(period_ms);
+    }
+
+    void report(const Report& r)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - started).count();
+        double since = std::chrono::duration<double>(now - last).count();
+        if (since <= 0)
+            since = 1e-9;
+
+        // the rates since the last report: the processed nodes per second
+        // and the growth of the sets per second (a converging analysis
+        // processes nodes, but its sets stop growing)
+        double node_rate = (r.processed - last_processed) / since;
+        double set_rate = (static_cast<double>(r.sets)
+                           - static_cast<double>(last_sets)) / since;
+
+        FILE *out = stderr;
+        if (!file.empty()) {
+            out = fopen(file.c_str(), "w");
+            if (!out)
+                out = stderr;
+        }
+
+        fprintf(out, "PROGRESS: %s time %.1fs round %" PRIu64
+                     " worklist %" PRIu64 " processed %" PRIu64
+                     " sets %" PRIu64 " rss %" PRIu64 "MB"
+                     " nodes/s %.0f sets/s %+.0f\n",
+                name, elapsed, r.round, r.worklist, r.processed, r.sets,
+                getCurrentRSS() / (1024 * 1024), node_rate, set_rate);
+
+        if (out != stderr)
+            fclose(out);
+        else
+            fflush(out);
+
+        last = now;
+        last_processed = r.processed;
+        last_sets = r.sets;
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_PROGRESS_H_
@@ -0,0 +1,339 @@
+#ifndef _DG_ANALYSIS_REACHABILITY_INDEX_H_
+#define _DG_ANALYSIS_REACHABILITY_INDEX_H_
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include "Analysis.h"
+#include "FrozenGraph.h"
+#include "DependenceGraph.h"
+
+namespace dg {
+namespace analysis {
+
+/// ------------------------------------------------------------------
+// - ReachabilityIndex
+//
+//   Answers the queries "is node A in the slice of node B?" without
+//   marking the slice of B. The index is built once over a frozen graph
+//   and does not depend on the slicing criteria, so any node can be
+//   asked about later. The nodes are reached over the same edges as
+//   WalkAndMark follows (the reverse control and data dependencies and
+//   the entry of the graph of every node).
+//
+//   The strongly connected components of the graph are collapsed
+//   and the components of the resulting DAG get intervals of a few
+//   depth-first traversals (as in GRAIL). If B reaches A, the intervals
+//   of A are inside the intervals of B, so most of the negative queries
+//   are answered by comparing the intervals. The positive queries are
+//   mostly answered by the spanning tree of the first traversal, the
+//   rest is answered by a search pruned by the intervals.
+//
+//   The queries are not thread-safe (the search uses marks),
+//   the graph must not change while the index is used.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class ReachabilityIndex : public Analysis<NodeT>
+{
+    using FrozenT = FrozenGraph<NodeT>;
+
+    enum : unsigned {
+        NONE = ~0u,
+        // the number of traversals giving the intervals
+        TRAVERSALS = 2
+    };
+
+    FrozenT *frozen = nullptr;
+    // the component of every frozen node. The components are numbered
+    // in the reverse topological order, so an edge goes always
+    // from a component to a component with a smaller number
+    std::vector<unsigned> comp;
+    // the edges between the components,
+    // succs[offsets[c] .. offsets[c + 1]] are the successors of c
+    std::vector<unsigned> offsets;
+    std::vector<unsigned> succs;
+    // the interval [low, post] of every component in every traversal
+    std::vector<unsigned> low[TRAVERSALS];
+    std::vector<unsigned> post[TRAVERSALS];
+    // the first post-order number in the subtree of the component
+    // in the spanning tree of the first traversal
+    std::vector<unsigned> treeLow;
+    // the marks of the components visited by the searches
+    std::vector<unsigned> visited;
+    unsigned epoch = 0;
+
+    // the edges of the frozen nodes that the slicing follows,
+    // adj[adjOffsets[i] .. adjOffsets[i + 1]] for the node i
+    void getEdges(std::vector<unsigned>& adjOffsets, std::vector<unsigned>& adj)
+    {
+        const unsigned N = frozen->size();
+        adjOffsets.reserve(N + 1);
+        for (unsigned idx = 0; idx < N; ++idx) {
+            adjOffsets.push_back(adj.size());
+
+            // keep the graph of the node (see WalkAndMark::markSlice)
+            DependenceGraph<NodeT> *dg = frozen->getNode(idx)->getDG();
+            NodeT *entry = dg ? dg->getEntry() : nullptr;
+            int eidx = entry ? frozen->getIndex(entry) : -1;
+            if (eidx >= 0)
+                adj.push_back(eidx);
+
+            for (auto kind : {FrozenT::REV_CD, FrozenT::REV_DD}) {
+                auto edges = frozen->getEdges(kind, idx);
+                adj.insert(adj.end(), edges.first, edges.second);
+            }
+        }
+
+        adjOffsets.push_back(adj.size());
+    }
+
+    // Tarjan's algorithm without recursion
+    unsigned computeComponents(const std::vector<unsigned>& adjOffsets,
+                               const std::vector<unsigned>& adj)
+    {
+        const unsigned N = adjOffsets.size() - 1;
+        std::vector<unsigned> index(N, NONE), lowlink(N);
+        std::vector<bool> onStack(N, false);
+        std::vector<unsigned> stack;
+        // the node and its next edge
+        std::vector<std::pair<unsigned, unsigned>> frames;
+        unsigned counter = 0, compsNum = 0;
+
+        comp.assign(N, NONE);
+        for (unsigned s = 0; s < N; ++s) {
+            if (index[s] != NONE)
+                continue;
+
+            index[s] = lowlink[s] = counter++;
+            stack.push_back(s);
+            onStack[s] = true;
+            frames.emplace_back(s, adjOffsets[s]);
+
+            while (!frames.empty()) {
+                unsigned v = frames.back().first;
+                if (frames.back().second < adjOffsets[v + 1]) {
+                    unsigned w = adj[frames.back().second++];
+                    if (index[w] == NONE) {
+                        index[w] = lowlink[w] = counter++;
+                        stack.push_back(w);
+                        onStack[w] = true;
+                        frames.emplace_back(w, adjOffsets[w]);
+                    } else if (onStack[w]) {
+                        lowlink[v] = std::min(lowlink[v], index[w]);
+                    }
+                    continue;
+                }
+
+                if (lowlink[v] == index[v]) {
+                    unsigned w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        onStack[w] = false;
+                        comp[w] = compsNum;
+                    } while (w != v);
+                    ++compsNum;
+                }
+
+                frames.pop_back();
+                if (!frames.empty()) {
+                    unsigned u = frames.back().first;
+                    lowlink[u] = std::min(lowlink[u], lowlink[v]);
+                }
+            }
+        }
+
+        return compsNum;
+    }
+
+    void buildComponentEdges(unsigned compsNum,
+                             const std::vector<unsigned>& adjOffsets,
+                             const std::vector<unsigned>& adj)
+    {
+        std::vector<std::pair<unsigned, unsigned>> edges;
+        for (unsigned v = 0; v + 1 < adjOffsets.size(); ++v) {
+            for (unsigned e = adjOffsets[v]; e < adjOffsets[v + 1]; ++e) {
+                if (comp[v] != comp[adj[e]])
+                    edges.emplace_back(comp[v], comp[adj[e]]);
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        offsets.assign(compsNum + 1, 0);
+        succs.clear();
+        succs.reserve(edges.size());
+        for (const auto& e : edges) {
+            ++offsets[e.first + 1];
+            succs.push_back(e.second);
+        }
+
+        for (unsigned c = 0; c < compsNum; ++c)
+            offsets[c + 1] += offsets[c];
+    }
+
+    // one depth-first traversal of the DAG of components,
+    // the odd traversals take the roots and the successors
+    // in the opposite order than the even ones
+    void label(unsigned t)
+    {
+        const unsigned C = offsets.size() - 1;
+        const bool reversed = (t % 2) == 1;
+        std::vector<unsigned>& L = low[t];
+        std::vector<unsigned>& P = post[t];
+        L.assign(C, NONE);
+        P.assign(C, NONE);
+        if (t == 0)
+            treeLow.assign(C, 0);
+
+        // the component and the number of its processed successors
+        std::vector<std::pair<unsigned, unsigned>> frames;
+        unsigned counter = 0;
+
+        // the sources have the biggest numbers, start from them
+        for (unsigned i = 0; i < C; ++i) {
+            unsigned root = reversed ? i : C - 1 - i;
+            if (L[root] != NONE)
+                continue;
+
+            L[root] = counter;
+            if (t == 0)
+                treeLow[root] = counter;
+            frames.emplace_back(root, 0);
+
+            while (!frames.empty()) {
+                unsigned c = frames.back().first;
+                unsigned num = offsets[c + 1] - offsets[c];
+                if (frames.back().second < num) {
+                    unsigned k = frames.back().second++;
+                    unsigned s = succs[reversed ? offsets[c + 1] - 1 - k
+                                                : offsets[c] + k];
+                    if (L[s] == NONE) {
+                        // the subtree of s gets the next numbers
+                        L[s] = counter;
+                        if (t == 0)
+                            treeLow[s] = counter;
+                        frames.emplace_back(s, 0);
+                    } else {
+                        // s was finished already (this is a DAG)
+                        L[c] = std::min(L[c], L[s]);
+                    }
+                    continue;
+                }
+
+                P[c] = counter++;
+                L[c] = std::min(L[c], P[c]);
+                frames.pop_back();
+                if (!frames.empty()) {
+                    unsigned p = frames.back().first;
+                    L[p] = std::min(L[p], L[c]);
+                }
+            }
+        }
+    }
+
+    // may the component @u reach the component @v? (false is certain)
+    bool mayReach(unsigned u, unsigned v) const
+    {
+        if (v > u)
+            return false;
+
+        for (unsigned t = 0; t < TRAVERSALS; ++t) {
+            if (low[t][v] < low[t][u] || post[t][v] > post[t][u])
+                return false;
+        }
+
+        return true;
+    }
+
+    // is @v in the subtree of @u in the first traversal? (true is certain)
+    bool inTree(unsigned u, unsigned v) const
+    {
+        return treeLow[u] <= post[0][v] && post[0][v] <= post[0][u];
+    }
+
+    bool reaches(unsigned u, unsigned v)
+    {
+        if (u == v)
+            return true;
+        if (!mayReach(u, v))
+            return false;
+        if (inTree(u, v))
+            return true;
+
+        if (++epoch == 0) {
+            std::fill(visited.begin(), visited.end(), 0);
+            epoch = 1;
+        }
+
+        std::vector<unsigned> stack;
+        stack.push_back(u);
+        visited[u] = epoch;
+        while (!stack.empty()) {
+            unsigned c = stack.back();
+            stack.pop_back();
+            ++this->statistics.processedNodes;
+
+            for (unsigned e = offsets[c]; e < offsets[c + 1]; ++e) {
+                unsigned s = succs[e];
+                if (s == v)
+                    return true;
+                if (visited[s] == epoch || !mayReach(s, v))
+                    continue;
+                if (inTree(s, v))
+                    return true;
+
+                visited[s] = epoch;
+                stack.push_back(s);
+            }
+        }
+
+        return false;
+    }
+
+public:
+    // build the index of the nodes of @graph. The graph must be frozen
+    // after all the edges were computed and must not change
+    // while the index is used
+    void build(FrozenT *graph)
+    {
+        frozen = graph;
+
+        std::vector<unsigned> adjOffsets, adj;
+        getEdges(adjOffsets, adj);
+
+        unsigned compsNum = computeComponents(adjOffsets, adj);
+        buildComponentEdges(compsNum, adjOffsets, adj);
+
+        for (unsigned t = 0; t < TRAVERSALS; ++t)
+            label(t);
+
+        visited.assign(compsNum, 0);
+        epoch = 0;
+    }
+
+    // would WalkAndMark from @crit mark @n? False
+    // if any of the nodes is not in the frozen graph
+    bool inSlice(NodeT *n, NodeT *crit)
+    {
+        assert(frozen && "The index is not built");
+
+        int nidx = frozen->getIndex(n);
+        int cidx = frozen->getIndex(crit);
+        if (nidx < 0 || cidx < 0)
+            return n == crit;
+
+        return reaches(comp[cidx], comp[nidx]);
+    }
+
+    // the number of the strongly connected components
+    size_t getComponentsNum() const { return visited.size(); }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_ANALYSIS_REACHABILITY_INDEX_H_
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <set>
+
+#include "ADT/Queue.h"
+#include "MemorySSA.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+const unsigned MemorySSATransformation::NONE;
+
+void MemorySSATransformation::computeReversePostorder()
+{
+    std::vector<RDNode *> postorder;
+    // the node and the index of the next successor to visit
+    std::vector<std::pair<RDNode *, size_t>> stack;
+    std::unordered_set<const RDNode *> visited;
+
+    stack.emplace_back(root, 0);
+    visited.insert(root);
+
+    while (!stack.empty()) {
+        RDNode *cur = stack.back().first;
+        size_t idx = stack.back().second;
+
+        const auto& succs = cur->getSuccessors();
+        if (idx < succs.size()) {
+            ++stack.back().second;
+            RDNode *succ = succs[idx];
+            if (visited.insert(succ).second)
+                stack.emplace_back(succ, 0);
+        } else {
+            postorder.push_back(cur);
+            stack.pop_back();
+        }
+    }
+
+    nodes.assign(postorder.rbegin(), postorder.rend());
+    index.assign(RDNode::getLastID() + 1, NONE);
+    for (unsigned i = 0; i < nodes.size(); ++i)
+        index[nodes[i]->getID()] = i;
+}
+
+// NONE for the nodes that are not reachable from the root
+unsigned MemorySSATransformation::getIndex(const RDNode *n) const
+{
+    return n->getID() < index.size() ? index[n->getID()] : NONE;
+}
+
+// the iterative algorithm due:
+//
+// K. D. Cooper, T. J. Harvey, and K. Kennedy. A simple, fast dominance
+// algorithm. Software Practice & Experience 4 (2001).
+//
+// The nodes are numbered in reverse postorder, so the dominators
+// have smaller numbers than the nodes they dominate
+void MemorySSATransformation::computeDominators()
+{
+    idom.assign(nodes.size(), NONE);
+    idom[0] = 0;
+
+    auto intersect = [this](unsigned a, unsigned b) {
+        while (a != b) {
+            while (a > b)
+                a = idom[a];
+            while (b > a)
+                b = idom[b];
+        }
+
+        return a;
+    };
+
+    bool changed;
+    do {
+        changed = false;
+        for (unsigned i = 1; i < nodes.size(); ++i) {
+            unsigned new_idom = NONE;
+            for (RDNode *pred : nodes[i]->getPredecessors()) {
+                unsigned p = getIndex(pred);
+                // unreachable predecessor
+                if (p == NONE)
+                    continue;
+
+                if (idom[p] == NONE)
+                    continue;
+
+                new_idom = new_idom == NONE ? p : intersect(p, new_idom);
+            }
+
+            if (new_idom != idom[i]) {
+                idom[i] = new_idom;
+                changed = true;
+            }
+        }
+    } while (changed);
+}
+
+// place the phis of every object to the iterated
+// dominance frontier of the nodes that modify it
+void MemorySSATransformation::placePhis(
+                        const std::vector<std::vector<unsigned>>& frontiers)
+{
+    for (auto& it : objects) {
+        Object& obj = it.second;
+        std::vector<unsigned> worklist(obj.modifiers);
+        obj.versions.insert(obj.modifiers.begin(), obj.modifiers.end());
+
+        while (!worklist.empty()) {
+            unsigned cur = worklist.back();
+            worklist.pop_back();
+
+            for (unsigned df : frontiers[cur]) {
+                if (obj.phis.insert(df).second) {
+                    obj.versions.insert(df);
+                    // the phi is a new version too
+                    worklist.push_back(df);
+                }
+            }
+        }
+    }
+}
+
+void MemorySSATransformation::run()
+{
+    computeReversePostorder();
+    computeDominators();
+
+    // the dominance frontiers (computed as in Cooper et al.)
+    std::vector<std::vector<unsigned>> frontiers(nodes.size());
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        std::vector<unsigned> preds;
+        for (RDNode *pred : nodes[i]->getPredecessors()) {
+            unsigned p = getIndex(pred);
+            if (p != NONE)
+                preds.push_back(p);
+        }
+
+        // the root is a join if it has any predecessor,
+        // the other path comes from the entry
+        if (preds.size() + (i == 0 ? 1 : 0) < 2)
+            continue;
+
+        for (unsigned runner : preds) {
+            while (runner != idom[i]) {
+                std::vector<unsigned>& df = frontiers[runner];
+                if (df.empty() || df.back() != i)
+                    df.push_back(i);
+
+                if (runner == 0)
+                    break;
+                runner = idom[runner];
+            }
+        }
+    }
+
+    // partition the memory by the targets of the def-sites
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        const RDNode *n = nodes[i];
+        std::set<const RDNode *> targets;
+        for (const auto& it : n->def_map.getDefs())
+            targets.insert(it.first.target);
+        for (const DefSite& ds : n->defs)
+            targets.insert(ds.target);
+        for (const DefSite& ds : n->overwrites)
+            targets.insert(ds.target);
+
+        for (const RDNode *target : targets)
+            objects[target].modifiers.push_back(i);
+    }
+
+    placePhis(frontiers);
+}
+
+unsigned MemorySSATransformation::getVersion(const Object& obj, unsigned n) const
+{
+    while (!obj.versions.count(n)) {
+        if (n == 0)
+            return NONE;
+
+        n = idom[n];
+    }
+
+    return n;
+}
+
+void MemorySSATransformation::getDefinitionsOf(const Object& obj, unsigned v,
+                                               std::vector<unsigned>& ret) const
+{
+    // with a phi, merge the versions from all the predecessors
+    if (obj.phis.count(v)) {
+        for (RDNode *pred : nodes[v]->getPredecessors()) {
+            unsigned p = getIndex(pred);
+            if (p == NONE)
+                continue;
+
+            unsigned ver = getVersion(obj, p);
+            if (ver != NONE)
+                ret.push_back(ver);
+        }
+
+        return;
+    }
+
+    // otherwise all the paths to the node have the same version,
+    // the one that is the closest in the dominator tree
+    if (v != 0) {
+        unsigned ver = getVersion(obj, idom[v]);
+        if (ver != NONE)
+            ret.push_back(ver);
+    }
+}
+
+const RDMap& MemorySSATransformation::getMap(const RDNode *target,
+                                             Object& obj, unsigned v)
+{
+    auto cached = obj.maps.find(v);
+    if (cached != obj.maps.end())
+        return cached->second;
+
+    // gather the versions that are not computed yet
+    // and that the version @v depends on
+    std::unordered_map<unsigned, std::vector<unsigned>> defs;
+    std::unordered_map<unsigned, std::vector<unsigned>> users;
+    std::vector<unsigned> todo{v};
+    while (!todo.empty()) {
+        unsigned cur = todo.back();
+        todo.pop_back();
+
+        if (defs.count(cur) || obj.maps.count(cur))
+            continue;
+
+        std::vector<unsigned>& cur_defs = defs[cur];
+        getDefinitionsOf(obj, cur, cur_defs);
+        for (unsigned d : cur_defs) {
+            users[d].push_back(cur);
+            todo.push_back(d);
+        }
+    }
+
+    // the initial maps are the definitions of the nodes themselves
+    for (const auto& it : defs) {
+        const RDMap& own = nodes[it.first]->def_map;
+        RDMap& map = obj.maps[it.first];
+        auto range = own.getObjectRange(const_cast<RDNode *>(target));
+        for (auto I = range.first; I != range.second; ++I) {
+            for (RDNode *n : I->second)
+                map.add(I->first, n);
+        }
+    }
+
+    // and merge the versions in the order of the nodes,
+    // as ReachingDefinitionsAnalysis does
+    ADT::PrioritySet<unsigned, std::less<unsigned>> worklist;
+    for (const auto& it : defs)
+        worklist.push(it.first);
+
+    while (!worklist.empty()) {
+        unsigned cur = worklist.pop();
+        RDNode *node = nodes[cur];
+        RDMap& map = obj.maps[cur];
+
+        bool changed = false;
+        const RDOverwrites *overwrites = node->getOverwritesIndex();
+        for (unsigned d : defs[cur])
+            changed |= map.merge(&obj.maps[d], overwrites,
+                                 strong_update_unknown, max_set_size,
+                                 false /* merge unknown */);
+
+        if (changed) {
+            for (unsigned u : users[cur])
+                worklist.push(u);
+        }
+    }
+
+    return obj.maps[v];
+}
+
+size_t MemorySSATransformation::getReachingDefinitions(RDNode *where,
+                                                       RDNode *target,
+                                                       const Offset& off,
+                                                       const Offset& len,
+                                                       std::set<RDNode *>& ret)
+{
+    unsigned v = getIndex(where);
+    auto oit = objects.find(target);
+    if (v == NONE || oit == objects.end())
+        return ret.size();
+
+    Object& obj = oit->second;
+    unsigned ver = getVersion(obj, v);
+    if (ver == NONE)
+        return ret.size();
+
+    return getMap(target, obj, ver).get(target, off, len, ret);
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,102 @@
+#ifndef _DG_REACHING_DEFINITIONS_MEMORY_SSA_H_
+#define _DG_REACHING_DEFINITIONS_MEMORY_SSA_H_
+
+#include <cassert>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ReachingDefinitions.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+///
+// Reaching definitions via memory SSA.
+//
+// Instead of computing the map of reaching definitions for every node
+// (ReachingDefinitionsAnalysis), run() builds memory SSA form over the
+// reaching definitions graph. The memory is partitioned by the targets
+// of the def-sites (the memory objects from the pointer analysis). Every
+// node that defines or overwrites an object is a new version of the object
+// and a phi of the object is placed to every node in the iterated dominance
+// frontier of these nodes (Cytron et al.).
+//
+// A query walks the dominator tree up to the version of the object that
+// reaches the node and follows the use-def chains of the versions (through
+// the phis) from there. The maps are computed only for the versions
+// of the queried object and are remembered for the next queries, so the
+// memory is proportional to the definitions, not to definitions
+// times program points. The results are the same as the results
+// of ReachingDefinitionsAnalysis.
+//
+// The initial maps of the nodes (their own definitions) are taken from
+// the nodes, so the analysis must not be run on a graph where
+// ReachingDefinitionsAnalysis already filled the maps.
+class MemorySSATransformation
+{
+    static const unsigned NONE = ~0U;
+
+    struct Object {
+        // the nodes that define or overwrite the object
+        std::vector<unsigned> modifiers;
+        // the nodes with a phi of the object
+        std::unordered_set<unsigned> phis;
+        // modifiers and phis, every one of them is a version of the object
+        std::unordered_set<unsigned> versions;
+        // the computed maps of the versions (only the object's def-sites)
+        std::unordered_map<unsigned, RDMap> maps;
+    };
+
+    RDNode *root;
+    bool strong_update_unknown;
+    uint32_t max_set_size;
+
+    // the nodes reachable from the root in reverse postorder,
+    // the nodes are referred to by the index to this vector
+    std::vector<RDNode *> nodes;
+    // the index of a node in @nodes, indexed by the id of the node
+    std::vector<unsigned> index;
+    // immediate dominators
+    std::vector<unsigned> idom;
+
+    std::unordered_map<const RDNode *, Object> objects;
+
+    void computeReversePostorder();
+    unsigned getIndex(const RDNode *n) const;
+    void computeDominators();
+    void placePhis(const std::vector<std::vector<unsigned>>& frontiers);
+
+    // the version of @obj that is valid after the node @n
+    unsigned getVersion(const Object& obj, unsigned n) const;
+    // the versions whose maps are merged into the version @v
+    void getDefinitionsOf(const Object& obj, unsigned v,
+                          std::vector<unsigned>& ret) const;
+    const RDMap& getMap(const RDNode *target, Object& obj, unsigned v);
+
+public:
+    MemorySSATransformation(RDNode *r,
+                            bool field_insens = false,
+                            uint32_t max_set_sz = ~((uint32_t)0))
+    : root(r), strong_update_unknown(field_insens), max_set_size(max_set_sz)
+    {
+        assert(r && "Root cannot be null");
+        assert(max_set_size > 0 && "The set size must be at least 1");
+    }
+
+    void run();
+
+    // gather reaching definitions of memory [target + off, target + off + len]
+    // after the node @where and store them to the @ret
+    size_t getReachingDefinitions(RDNode *where, RDNode *target,
+                                  const Offset& off, const Offset& len,
+                                  std::set<RDNode *>& ret);
+};
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
+
+#endif //  _DG_REACHING_DEFINITIONS_MEMORY_SSA_H_
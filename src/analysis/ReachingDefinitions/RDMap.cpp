@@ -3,6 +3,7 @@
 #include <cstdlib>
 
 #include "RDMap.h"
+#include "ReachingDefinitionsStatistics.h"
 #include "ReachingDefinitions.h"
 
 namespace dg {
@@ -11,14 +12,116 @@ namespace rd {
 
 class RDNode;
 
-RDMap::RDMap(const RDMap& o)
+static bool comp_entry(const std::pair<DefSite, RDNodesSet>& a,
+                       const DefSite& b)
 {
-    merge(&o);
+    return a.first < b;
 }
 
-static bool comp_ds(const DefSite& a, const DefSite& b)
+static bool sameDefSite(const DefSite& a, const DefSite& b)
 {
-    return a.target < b.target;
+    return !(a < b) && !(b < a);
+}
+
+RDOverwrites::RDOverwrites(const DefSiteSetT& overwrites)
+{
+    // the def-sites are sorted by the targets, so the def-sites
+    // of one target are next to each other
+    for (const DefSite& ds : overwrites) {
+        if (entries.empty() || entries.back().target != ds.target)
+            entries.emplace_back(ds.target);
+
+        Entry& E = entries.back();
+        if (ds.offset.isUnknown()) {
+            E.unknown = true;
+            continue;
+        }
+
+        // the def-site with unknown length overwrites
+        // everything from its offset
+        uint64_t start = *ds.offset;
+        uint64_t end = ds.len.isUnknown() || *ds.len >= UNKNOWN_OFFSET - start
+                        ? UNKNOWN_OFFSET : start + *ds.len;
+        E.intervals.emplace_back(start, end);
+    }
+
+    for (Entry& E : entries) {
+        auto& I = E.intervals;
+        std::sort(I.begin(), I.end());
+
+        // merge the overlapping and adjacent intervals
+        size_t last = 0;
+        for (size_t i = 1; i < I.size(); ++i) {
+            if (I[i].first <= I[last].second)
+                I[last].second = std::max(I[last].second, I[i].second);
+            else
+                I[++last] = I[i];
+        }
+
+        if (!I.empty())
+            I.resize(last + 1);
+    }
+}
+
+const RDOverwrites::Entry *RDOverwrites::find(RDNode *target) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), target,
+                               [](const Entry& E, RDNode *t) {
+                                   return E.target->getID() < t->getID();
+                               });
+    if (it == entries.end() || it->target != target)
+        return nullptr;
+
+    return &*it;
+}
+
+bool RDOverwrites::overwrites(const DefSite& ds, bool strong_update_unknown,
+                              bool& is_unknown) const
+{
+    const Entry *E = find(ds.target);
+    if (!E)
+        return false;
+
+    // should we update this def-site (strong update)?
+    // but only if the offset is concrete, because if
+    // it is not concrete, we want to do weak update
+    // Also, we don't want to do strong updates for
+    // heap allocated objects, since they are all represented
+    // by the call site
+
+    // if the memory is defined at unknown offset, we can
+    // still do a strong update provided this is the update
+    // of whole memory (so we need to know the size of the memory).
+    if (strong_update_unknown &&
+        is_unknown && ds.target->getSize() > 0) {
+        // the overwrites together cover the whole memory
+        return !E->intervals.empty() && E->intervals[0].first == 0
+                && E->intervals[0].second >= ds.target->getSize();
+    }
+
+    if (ds.target->getType() == DYN_ALLOC
+        || ds.offset.isUnknown() || ds.len.isUnknown())
+        return false;
+
+    // the interval that starts at the offset of @ds or before it
+    uint64_t start = *ds.offset;
+    auto it = std::upper_bound(E->intervals.begin(), E->intervals.end(),
+                               std::make_pair(start, UNKNOWN_OFFSET));
+    if (it != E->intervals.begin()) {
+        --it;
+        // check if the what we have in overwrites covers
+        // the values that are in the other map
+        if (start + *ds.len <= it->second)
+            return true;
+    }
+
+    // if the overwrites contain target with unknown
+    // pointer, we should always keep that value
+    // and the value being merged (just all possible definitions)
+    if (E->unknown)
+        is_unknown = true;
+
+    return false;
 }
 
 ///
@@ -54,152 +157,354 @@ static bool comp_ds(const DefSite& a, const DefSite& b)
 //                      -- reaching are all thre
 //
 // This is useful when we have a lot of concrete and unknown definitions
-// in the map
+// in the map.
+// The def-sites of the objects that are @collapsed are merged to the
+// def-site of the whole object (see collapseOffsets())
 bool RDMap::merge(const RDMap *oth,
-                  DefSiteSetT *no_update,
+                  const RDOverwrites *no_update,
                   bool strong_update_unknown,
                   uint32_t max_set_size,
-                  bool merge_unknown)
+                  bool merge_unknown,
+                  ReachingDefinitionsStatistics *stats,
+                  bool revisit,
+                  const CollapsedObjects *collapsed)
 {
-    if (this == oth)
+    // the maps share the definitions, there is nothing new
+    if (this == oth || shares(*oth))
         return false;
 
+    if (merge_unknown)
+        return mergeUnknown(oth, no_update, strong_update_unknown, max_set_size);
+
+    if (collapsed && oth->hasCollapsedDefSites(*collapsed))
+        return mergeCollapsed(oth, no_update, strong_update_unknown,
+                              max_set_size, *collapsed);
+
+    // select the variant of the merge once, so that the loops
+    // do not check the flags for every definition
+    bool limited = stats || max_set_size != ~((uint32_t) 0);
+    if (no_update) {
+        if (limited)
+            return mergeDefs<true, true>(oth, no_update, strong_update_unknown,
+                                         max_set_size, stats, revisit);
+        return mergeDefs<true, false>(oth, no_update, strong_update_unknown,
+                                      max_set_size, stats, revisit);
+    }
+
+    if (limited)
+        return mergeDefs<false, true>(oth, no_update, strong_update_unknown,
+                                      max_set_size, stats, revisit);
+
+    // plain union of the definitions. If we have nothing yet,
+    // just share the definitions of the other map
+    if (empty()) {
+        defs_ptr = oth->defs_ptr;
+        max_len = oth->max_len;
+        unknown_len = oth->unknown_len;
+        targets = oth->targets;
+        return !empty();
+    }
+
+    return mergeDefs<false, false>(oth, no_update, strong_update_unknown,
+                                   max_set_size, stats, revisit);
+}
+
+// the body of merge(), @Overwrites says whether there is the @no_update
+// set and @Limited whether the sets of definitions can be cropped
+// (by @max_set_size or the statistics)
+template <bool Overwrites, bool Limited>
+bool RDMap::mergeDefs(const RDMap *oth,
+                      const RDOverwrites *no_update,
+                      bool strong_update_unknown,
+                      uint32_t max_set_size,
+                      ReachingDefinitionsStatistics *stats,
+                      bool revisit)
+{
     bool changed = false;
-    for (const auto& it : oth->defs) {
+
+    // both maps are sorted, so walk them at once. First merge the
+    // def-sites that we have already (in place), the new ones are
+    // inserted at once afterwards
+    // The definitions may be shared with other maps, so take
+    // a private copy of them only once we really change something
+    std::vector<const std::pair<DefSite, RDNodesSet> *> missing;
+    const MapT *cur = &getDefs();
+    size_t i = 0;
+    for (const auto& it : oth->getDefs()) {
         const DefSite& ds = it.first;
         bool is_unknown = ds.offset.isUnknown();
+        if (Overwrites &&
+            no_update->overwrites(ds, strong_update_unknown, is_unknown))
+            continue;
 
-        // STRONG UPDATE
-        // --------------------
-        // should we update this def-site (strong update)?
-        // but only if the offset is concrete, because if
-        // it is not concrete, we want to do weak update
-        // Also, we don't want to do strong updates for
-        // heap allocated objects, since they are all represented
-        // by the call site
-        if (no_update) { // do we have anything for strong update at all?
-            // if the memory is defined at unknown offset, we can
-            // still do a strong update provided this is the update
-            // of whole memory (so we need to know the size of the memory).
-            if (strong_update_unknown &&
-                is_unknown && ds.target->getSize() > 0) {
-                // get the writes that should overwrite this definition
-                auto range = std::equal_range(no_update->begin(),
-                                              no_update->end(),
-                                              ds, comp_ds);
-                // XXX: we could check wether all the strong updates
-                // together overwrite the memory, but that could be
-                // to much work. Just check wether there's is just a one
-                // update that overwrites the whole memory
-                bool overwrites_whole_memory = false;
-                for (auto I = range.first; I!= range.second; ++I) {
-                    const DefSite& ds2 = *I;
-                    assert(ds.target == ds2.target);
-                    if (*ds2.offset == 0 && *ds2.len >= ds.target->getSize()) {
-                        overwrites_whole_memory = true;
-                        break;
-                    }
-                }
-
-                // do strong update - just continue the loop without
-                // merging this definition into our map
-                if (overwrites_whole_memory)
-                    continue;
-            } else if (ds.target->getType() != DYN_ALLOC) {
-                bool skip = false;
-                auto range = std::equal_range(no_update->begin(),
-                                              no_update->end(),
-                                              ds, comp_ds);
-                for (auto I = range.first; I!= range.second; ++I) {
-                    const DefSite& ds2 = *I;
-                    assert(ds.target == ds2.target);
-                    // if the 'no_update' set contains target with unknown
-                    // pointer, we should always keep that value
-                    // and the value being merged (just all possible definitions)
-                    if (ds2.offset.isUnknown()) {
-                        // break no_update skip = true, thus adding
-                        // the values for UNKOWN to our map
-                        is_unknown = true;
-                        break;
-                    }
-
-                    // targets are the same, check if the what we have
-                    // in 'no_update' set overwrites the values that are in
-                    // the other map
-                    if ((*ds.offset >= *ds2.offset)
-                        && (*ds.offset + *ds.len <= *ds2.offset + *ds2.len)) {
-                        skip = true;
-                        break;
-                    }
-                }
-
-                // if values in 'no_update' map overwrite the coresponding values
-                // in the other map, don't update our map
-                if (skip)
-                    continue;
+        while (i < cur->size() && (*cur)[i].first < ds)
+            ++i;
+
+        if (i == cur->size() || !sameDefSite((*cur)[i].first, ds)) {
+            missing.push_back(&it);
+            continue;
+        }
+
+        if ((*cur)[i].second.includes(it.second)) {
+            const RDNodesSet& vals = (*cur)[i].second;
+            // the def-site may have been truncated by a merge
+            // in another node, make it unknown here too
+            if (Limited && stats && !ds.target->isUnknown() &&
+                stats->merged(ds, vals.size(), false, revisit) &&
+                !vals.isUnknown()) {
+                writeDefs()[i].second.makeUnknown();
+                cur = defs_ptr.get();
+                changed = true;
             }
+
+            continue;
         }
 
-        // MERGE CONCRETE OFFSETS (if desired)
-        // ------------------------------------
-        RDNodesSet *our_vals = nullptr;
-        if (merge_unknown && is_unknown) {
-            // this loop finds all concrete offsets and merges them into one
-            // defsite with UNKNOWN_OFFSET. This defsite is set in 'our_vals'
-            // after the loop exit
-            our_vals = &defs[DefSite(ds.target, UNKNOWN_OFFSET, UNKNOWN_OFFSET)];
+        // copy values that have the map 'oth' for the defsite 'ds' to our map
+        RDNodesSet& our_vals = writeDefs()[i].second;
+        cur = defs_ptr.get();
+        changed |= our_vals.insert(it.second);
 
-            auto range = getObjectRange(ds);
-            for (auto I = range.first; I != range.second;) {
-                auto cur = I++;
+        // crop the set to UNKNOWN_MEMORY if it is too big or if it keeps
+        // growing in the iterations (see ReachingDefinitionsStatistics).
+        // But only in the case that the  DefSite is not also UNKNOWN,
+        // because then we would be 'unknown memory defined @ unknown place'
+        if (Limited && !ds.target->isUnknown() &&
+            ((stats && stats->merged(ds, our_vals.size(), true, revisit)) ||
+             our_vals.size() > max_set_size))
+            our_vals.makeUnknown();
+    }
 
-                // this must hold (getObjectRange)
-                assert(cur->first.target == ds.target);
+    if (missing.empty())
+        return changed;
+
+    // we can move the definitions only if nobody else uses them
+    bool own = defs_ptr && defs_ptr.use_count() == 1;
+    auto take = [own](std::pair<DefSite, RDNodesSet>& e, MapT& to) {
+        if (own)
+            to.push_back(std::move(e));
+        else
+            to.push_back(e);
+    };
+
+    MapT result;
+    result.reserve(cur->size() + missing.size());
+    i = 0;
+    for (const auto *it : missing) {
+        const DefSite& ds = it->first;
+        while (i < cur->size() && (*cur)[i].first < ds)
+            take((*defs_ptr)[i++], result);
+
+        result.emplace_back(ds, it->second);
+        addedDefSite(ds);
+        changed |= it->second.size() > 0;
+
+        RDNodesSet& our_vals = result.back().second;
+        if (Limited && !ds.target->isUnknown() &&
+            ((stats && stats->merged(ds, our_vals.size(), true, revisit)) ||
+             our_vals.size() > max_set_size))
+            our_vals.makeUnknown();
+    }
+
+    while (i < cur->size())
+        take((*defs_ptr)[i++], result);
 
-                // don't remove the one with UNKNOWN_OFFSET
-                if (&cur->second == our_vals)
-                    continue;
+    if (own)
+        defs_ptr->swap(result);
+    else
+        defs_ptr = std::make_shared<MapT>(std::move(result));
 
-                // merge values with concrete offset to
-                // this unknown offset
-                for (RDNode *defnode : cur->second)
-                    changed |= our_vals->insert(defnode);
+    return changed;
+}
 
-                // erase the def-site with concrete offset
-                defs.erase(cur);
+// merge() with the @merge_unknown flag
+bool RDMap::mergeUnknown(const RDMap *oth,
+                         const RDOverwrites *no_update,
+                         bool strong_update_unknown,
+                         uint32_t max_set_size)
+{
+    bool changed = false;
+    for (const auto& it : oth->getDefs()) {
+        const DefSite& ds = it.first;
+        bool is_unknown = ds.offset.isUnknown();
+        if (no_update &&
+            no_update->overwrites(ds, strong_update_unknown, is_unknown))
+            continue;
+
+        DefSite key = ds;
+        if (is_unknown) {
+            // find all concrete offsets and merge them into one
+            // defsite with UNKNOWN_OFFSET. The def-site with UNKNOWN_OFFSET
+            // and length is the last one of the object
+            key = DefSite(ds.target, UNKNOWN_OFFSET, UNKNOWN_OFFSET);
+            getOrCreate(key);
+
+            auto range = getObjectRange(ds);
+            assert(sameDefSite((range.second - 1)->first, key));
+
+            std::vector<RDNode *> merged;
+            for (auto J = range.first; J != range.second - 1; ++J) {
+                assert(J->first.target == ds.target);
+                merged.insert(merged.end(), J->second.begin(), J->second.end());
             }
 
-            // fall-through to add the new definitions from the other map
-        } else {
-            // our values that we have for this definition-site
-            our_vals = &defs[ds];
+            // erase the def-sites with concrete offset
+            writeDefs().erase(range.first, range.second - 1);
+
+            RDNodesSet& our_vals = getOrCreate(key);
+            for (RDNode *defnode : merged)
+                changed |= our_vals.insert(defnode);
         }
 
-        assert(our_vals && "BUG");
+        RDNodesSet& our_vals = getOrCreate(key);
+        changed |= our_vals.insert(it.second);
 
-        // copy values that have the map 'oth' for the defsite 'ds' to our map
-        for (RDNode *defnode : it.second)
-            changed |= our_vals->insert(defnode);
+        if (!ds.target->isUnknown() && our_vals.size() > max_set_size)
+            our_vals.makeUnknown();
+    }
 
-        // crop the set to UNKNOWN_MEMORY if it is too big.
-        // But only in the case that the  DefSite is not also UNKNOWN,
-        // because then we would be 'unknown memory defined @ unknown place'
-        if (!ds.target->isUnknown() && our_vals->size() > max_set_size)
-            our_vals->makeUnknown();
+    return changed;
+}
+
+// is @ds a def-site with concrete offset (or length)
+// of a collapsed object?
+static bool isCollapsedDefSite(const DefSite& ds,
+                               const CollapsedObjects& collapsed)
+{
+    return !(ds.offset.isUnknown() && ds.len.isUnknown())
+           && !ds.target->isUnknown()
+           && collapsed.isCollapsed(ds.target->getID());
+}
+
+bool RDMap::hasCollapsedDefSites(const CollapsedObjects& collapsed) const
+{
+    for (const auto& it : getDefs()) {
+        if (isCollapsedDefSite(it.first, collapsed))
+            return true;
+    }
+
+    return false;
+}
+
+// merge() when @oth has def-sites of collapsed objects, these are
+// merged to the def-sites of the whole objects
+bool RDMap::mergeCollapsed(const RDMap *oth,
+                           const RDOverwrites *no_update,
+                           bool strong_update_unknown,
+                           uint32_t max_set_size,
+                           const CollapsedObjects& collapsed)
+{
+    bool changed = false;
+    for (const auto& it : oth->getDefs()) {
+        const DefSite& ds = it.first;
+        bool is_unknown = ds.offset.isUnknown();
+        if (no_update &&
+            no_update->overwrites(ds, strong_update_unknown, is_unknown))
+            continue;
+
+        DefSite key = ds;
+        if (isCollapsedDefSite(ds, collapsed))
+            key = DefSite(ds.target, UNKNOWN_OFFSET, UNKNOWN_OFFSET);
+
+        RDNodesSet& our_vals = getOrCreate(key);
+        changed |= our_vals.insert(it.second);
+
+        if (!ds.target->isUnknown() && our_vals.size() > max_set_size)
+            our_vals.makeUnknown();
     }
 
     return changed;
 }
 
+bool RDMap::collapseOffsets(CollapsedObjects& collapsed, uint32_t max_offsets)
+{
+    // the def-sites of an object are next to each other
+    const MapT& defs = getDefs();
+    bool fold = false;
+    for (size_t i = 0; i < defs.size();) {
+        RDNode *target = defs[i].first.target;
+        uint32_t concrete = 0;
+        for (; i < defs.size() && defs[i].first.target == target; ++i) {
+            if (isCollapsedDefSite(defs[i].first, collapsed))
+                fold = true;
+            else if (!defs[i].first.offset.isUnknown())
+                ++concrete;
+        }
+
+        if (concrete > max_offsets && !target->isUnknown()) {
+            collapsed.collapse(target->getID());
+            fold = true;
+        }
+    }
+
+    if (!fold)
+        return false;
+
+    // the def-site of the whole object is the last one of the object
+    MapT result;
+    result.reserve(defs.size());
+    for (size_t i = 0; i < defs.size(); ++i) {
+        const DefSite& ds = defs[i].first;
+        if (!isCollapsedDefSite(ds, collapsed)) {
+            result.push_back(defs[i]);
+            continue;
+        }
+
+        DefSite whole(ds.target, UNKNOWN_OFFSET, UNKNOWN_OFFSET);
+        if (result.empty() || !sameDefSite(result.back().first, whole))
+            result.emplace_back(whole, RDNodesSet());
+        result.back().second.insert(defs[i].second);
+
+        // keep the def-site of the whole object last
+        if (i + 1 < defs.size() && defs[i + 1].first.target == ds.target
+            && sameDefSite(defs[i + 1].first, whole)) {
+            result.back().second.insert(defs[i + 1].second);
+            ++i;
+        }
+    }
+
+    defs_ptr = std::make_shared<MapT>(std::move(result));
+    return true;
+}
+
+uint64_t RDMap::targetBit(RDNode *n)
+{
+    return static_cast<uint64_t>(1) << (n->getID() % 64);
+}
+
+RDMap::const_iterator RDMap::find(const DefSite& ds) const
+{
+    const MapT& defs = getDefs();
+    if (!mayDefine(ds.target))
+        return defs.end();
+
+    auto it = std::lower_bound(defs.begin(), defs.end(), ds, comp_entry);
+    if (it != defs.end() && sameDefSite(it->first, ds))
+        return it;
+
+    return defs.end();
+}
+
+RDNodesSet& RDMap::getOrCreate(const DefSite& ds)
+{
+    MapT& defs = writeDefs();
+    auto it = std::lower_bound(defs.begin(), defs.end(), ds, comp_entry);
+    if (it != defs.end() && sameDefSite(it->first, ds))
+        return it->second;
+
+    addedDefSite(ds);
+    return defs.emplace(it, ds, RDNodesSet())->second;
+}
+
 bool RDMap::add(const DefSite& p, RDNode *n)
 {
-    return defs[p].insert(n);
+    return getOrCreate(p).insert(n);
 }
 
 bool RDMap::update(const DefSite& p, RDNode *n)
 {
     bool ret;
-    RDNodesSet& dfs = defs[p];
+    RDNodesSet& dfs = getOrCreate(p);
 
     ret = dfs.count(n) == 0 || dfs.size() > 1;
     dfs.clear();
@@ -208,63 +513,152 @@ bool RDMap::update(const DefSite& p, RDNode *n)
     return ret;
 }
 
-bool RDMap::definesWithAnyOffset(const DefSite& ds)
+bool RDMap::definesWithAnyOffset(const DefSite& ds) const
 {
     auto range = getObjectRange(ds);
     return range.first != range.second;
 }
 
 size_t RDMap::get(RDNode *n, const Offset& off,
-                  const Offset& len, std::set<RDNode *>& ret)
+                  const Offset& len, std::set<RDNode *>& ret) const
 {
     DefSite ds(n, off, len);
     return get(ds, ret);
 }
 
-size_t RDMap::get(DefSite& ds, std::set<RDNode *>& ret)
+template <typename F>
+void RDMap::forOverlapping(std::pair<const_iterator, const_iterator> range,
+                           const DefSite& ds, F f) const
 {
     if (ds.offset.isUnknown()) {
-        auto range = getObjectRange(ds);
         for (auto I = range.first; I != range.second; ++I) {
             assert(I->first.target == ds.target);
-            ret.insert(I->second.begin(), I->second.end());
+            f(I->second);
         }
-    } else {
-        auto range = getObjectRange(ds);
-        for (auto I = range.first; I != range.second; ++I) {
-            assert(I->first.target == ds.target);
-                // if we found a definition with UNKNOWN_OFFSET,
-                // it is possibly a definition that we need */
-                if (I->first.offset.isUnknown() ||
-                    // if the length is unknown, then just check
-                    // if the starts can overlap
-                    (ds.len.isUnknown() && *ds.offset <= *I->first.offset) ||
-                    // just check if the offsets + length have
-                    // some overlap
-                    intervalsOverlap(*I->first.offset,
-                                    // -1 because we're starting from 0
-                                    *I->first.offset + *I->first.len - 1,
-                                    *ds.offset, *ds.offset + *ds.len - 1)){
-                ret.insert(I->second.begin(), I->second.end());
-            }
+
+        return;
+    }
+
+    auto I = range.first;
+    // the def-sites that start more than max_len bytes
+    // before the offset cannot overlap it
+    if (!unknown_len && *ds.offset > max_len)
+        I = std::lower_bound(range.first, range.second,
+                             DefSite(ds.target, *ds.offset - max_len + 1, 0),
+                             comp_entry);
+
+    // with known length, the def-sites with concrete offsets
+    // that start after the end cannot overlap
+    bool bounded = !ds.len.isUnknown()
+                   && *ds.offset + *ds.len > *ds.offset;
+    uint64_t last = *ds.offset + *ds.len - 1;
+
+    for (; I != range.second; ++I) {
+        assert(I->first.target == ds.target);
+        if (bounded && !I->first.offset.isUnknown()
+            && *I->first.offset > last) {
+            // jump to the def-sites with UNKNOWN_OFFSET (they are the last)
+            I = std::lower_bound(I, range.second,
+                                 DefSite(ds.target, UNKNOWN_OFFSET, 0),
+                                 comp_entry);
+            if (I == range.second)
+                break;
+        }
+
+        // if we found a definition with UNKNOWN_OFFSET,
+        // it is possibly a definition that we need
+        if (I->first.offset.isUnknown() ||
+            // if the length is unknown, then just check
+            // if the starts can overlap
+            (ds.len.isUnknown() && *ds.offset <= *I->first.offset) ||
+            // just check if the offsets + length have
+            // some overlap
+            intervalsOverlap(*I->first.offset,
+                            // -1 because we're starting from 0
+                            *I->first.offset + *I->first.len - 1,
+                            *ds.offset, *ds.offset + *ds.len - 1)){
+            f(I->second);
         }
     }
+}
+
+size_t RDMap::get(DefSite& ds, std::set<RDNode *>& ret) const
+{
+    forOverlapping(getObjectRange(ds), ds, [&ret](const RDNodesSet& defs) {
+        ret.insert(defs.begin(), defs.end());
+    });
 
     return ret.size();
 }
 
+void RDMap::get(const std::vector<DefSite>& sites,
+                std::vector<std::vector<RDNode *>>& ret) const
+{
+    ret.resize(sites.size());
+
+    std::pair<const_iterator, const_iterator> range;
+    RDNode *object = nullptr;
+    for (size_t i = 0; i < sites.size(); ++i) {
+        const DefSite& ds = sites[i];
+        if (i == 0 || ds.target != object) {
+            range = getObjectRange(ds.target);
+            object = ds.target;
+        }
+
+        std::vector<RDNode *>& defs = ret[i];
+        defs.clear();
+        forOverlapping(range, ds, [&defs](const RDNodesSet& s) {
+            defs.insert(defs.end(), s.begin(), s.end());
+        });
+
+        // in the order of std::set<RDNode *>
+        std::sort(defs.begin(), defs.end());
+        defs.erase(std::unique(defs.begin(), defs.end()), defs.end());
+    }
+}
 
-static inline bool comp(const std::pair<const DefSite, RDNodesSet>& a,
-                        const std::pair<const DefSite, RDNodesSet>& b)
+template <typename IteratorT>
+static std::pair<IteratorT, IteratorT>
+objectRange(IteratorT B, IteratorT E, RDNode *n)
 {
-    return a.first.target < b.first.target;
+    auto lower = [](const std::pair<DefSite, RDNodesSet>& a, RDNode *t) {
+        return a.first.target->getID() < t->getID();
+    };
+    auto upper = [](RDNode *t, const std::pair<DefSite, RDNodesSet>& a) {
+        return t->getID() < a.first.target->getID();
+    };
+
+    return std::make_pair(std::lower_bound(B, E, n, lower),
+                          std::upper_bound(B, E, n, upper));
 }
 
 std::pair<RDMap::iterator, RDMap::iterator>
 RDMap::getObjectRange(const DefSite& ds)
 {
-    std::pair<const DefSite, RDNodesSet> what(ds, RDNodesSet());
-    return std::equal_range(defs.begin(), defs.end(), what, comp);
+    return getObjectRange(ds.target);
+}
+
+std::pair<RDMap::iterator, RDMap::iterator>
+RDMap::getObjectRange(RDNode *n)
+{
+    MapT& defs = writeDefs();
+    return objectRange(defs.begin(), defs.end(), n);
+}
+
+std::pair<RDMap::const_iterator, RDMap::const_iterator>
+RDMap::getObjectRange(const DefSite& ds) const
+{
+    return getObjectRange(ds.target);
+}
+
+std::pair<RDMap::const_iterator, RDMap::const_iterator>
+RDMap::getObjectRange(RDNode *n) const
+{
+    const MapT& defs = getDefs();
+    if (!mayDefine(n))
+        return std::make_pair(defs.end(), defs.end());
+
+    return objectRange(defs.begin(), defs.end(), n);
 }
 
 } // rd
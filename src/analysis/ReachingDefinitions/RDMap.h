@@ -1,10 +1,18 @@
 #ifndef _DG_DEF_MAP_H_
 #define _DG_DEF_MAP_H_
 
+#include <atomic>
 #include <set>
 #include <map>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
 #include <cassert>
 
+#include "ADT/TaggedAllocator.h"
 #include "analysis/Offset.h"
 
 namespace dg {
@@ -13,6 +21,7 @@ namespace rd {
 
 class RDNode;
 class ReachingDefinitionsAnalysis;
+struct ReachingDefinitionsStatistics;
 
 inline bool
 intervalsDisjunctive(uint64_t a1, uint64_t a2,
@@ -41,37 +50,56 @@ struct DefSite
                *o + *l > 0) && "Invalid offset and length given");
     }
 
-    bool operator<(const DefSite& oth) const
-    {
-        return target == oth.target ?
-                (offset == oth.offset ? len < oth.len : offset < oth.offset)
-                : target < oth.target;
-    }
+    // the def-sites are ordered by the ids of the targets, so that
+    // the order does not depend on the addresses of the nodes.
+    // Defined in ReachingDefinitions.h, it needs the complete RDNode
+    inline bool operator<(const DefSite& oth) const;
 
     // what memory this node defines
     RDNode *target;
     // on what offset
-    Offset offset;
+    KeyOffset offset;
     // how many bytes
-    Offset len;
+    KeyOffset len;
 };
 
+#ifdef COMPACT_KEYS
+static_assert(sizeof(DefSite) == sizeof(RDNode *) + 2 * sizeof(uint32_t),
+              "DefSite is not packed");
+#endif
+
 extern RDNode *UNKNOWN_MEMORY;
 
-// wrapper around std::set<> with few
-// improvements that will be handy in our set-up
+// Set of reaching definitions with the interface of std::set<>
+// (with few improvements that will be handy in our set-up).
+// Most of the sets have just one or two elements, so up to SMALL_SIZE
+// nodes are stored inline and only bigger sets allocate a vector.
+// The nodes are kept sorted in both cases, so the set is iterated
+// in the same order as std::set<RDNode *>
 class RDNodesSet {
-    std::set<RDNode *> nodes;
+    static const unsigned SMALL_SIZE = 2;
+    using BigT = std::vector<RDNode *,
+                             ADT::TaggedAllocator<RDNode *, ADT::AllocTag::RD_MAPS>>;
+
+    RDNode *small[SMALL_SIZE];
+    // the nodes of a big set, empty if the set is small
+    BigT big;
+    unsigned small_size;
     bool is_unknown;
 
+    bool isSmall() const { return big.empty(); }
+
 public:
-    RDNodesSet() : is_unknown(false) {}
+    using const_iterator = RDNode *const *;
+
+    RDNodesSet() : small_size(0), is_unknown(false) {}
 
     // the set contains unknown mem. location
     void makeUnknown()
     {
-        nodes.clear();
-        nodes.insert(UNKNOWN_MEMORY);
+        clear();
+        small[0] = UNKNOWN_MEMORY;
+        small_size = 1;
         is_unknown = true;
     }
 
@@ -83,23 +111,96 @@ public:
         if (n == UNKNOWN_MEMORY) {
             makeUnknown();
             return true;
-        } else
-            return nodes.insert(n).second;
+        }
+
+        if (isSmall()) {
+            RDNode **E = small + small_size;
+            RDNode **I = std::lower_bound(small, E, n);
+            if (I != E && *I == n)
+                return false;
+
+            if (small_size < SMALL_SIZE) {
+                std::move_backward(I, E, E + 1);
+                *I = n;
+                ++small_size;
+                return true;
+            }
+
+            // switch to the big representation
+            big.reserve(2 * SMALL_SIZE);
+            big.assign(small, E);
+            small_size = 0;
+        }
+
+        auto I = std::lower_bound(big.begin(), big.end(), n);
+        if (I != big.end() && *I == n)
+            return false;
+
+        big.insert(I, n);
+        return true;
+    }
+
+    // insert all the nodes from @oth,
+    // return true if the set changed
+    bool insert(const RDNodesSet& oth)
+    {
+        if (is_unknown)
+            return false;
+
+        if (oth.is_unknown) {
+            makeUnknown();
+            return true;
+        }
+
+        if (oth.size() <= SMALL_SIZE) {
+            bool changed = false;
+            for (RDNode *n : oth)
+                changed |= insert(n);
+
+            return changed;
+        }
+
+        // both sets are sorted, so just merge them
+        BigT merged;
+        merged.reserve(size() + oth.size());
+        std::set_union(begin(), end(), oth.begin(), oth.end(),
+                       std::back_inserter(merged));
+        if (merged.size() == size())
+            return false;
+
+        big.swap(merged);
+        small_size = 0;
+        return true;
+    }
+
+    // does the set contain all the nodes from @oth?
+    // (then inserting @oth does not change the set)
+    bool includes(const RDNodesSet& oth) const
+    {
+        if (is_unknown)
+            return true;
+        if (oth.is_unknown)
+            return false;
+
+        return std::includes(begin(), end(), oth.begin(), oth.end());
     }
 
     size_t count(RDNode *n) const
     {
-        return nodes.count(n);
+        return std::binary_search(begin(), end(), n) ? 1 : 0;
     }
 
     size_t size() const
     {
-        return nodes.size();
+        return isSmall() ? small_size : big.size();
     }
 
     void clear()
     {
-        nodes.clear();
+        // release the memory, big sets are rarely cleared
+        // just to be filled again
+        BigT().swap(big);
+        small_size = 0;
         is_unknown = false;
     }
 
@@ -108,38 +209,216 @@ public:
         return is_unknown;
     }
 
-    std::set<RDNode *>::iterator begin() { return nodes.begin(); }
-    std::set<RDNode *>::iterator end() { return nodes.end(); }
-    std::set<RDNode *>::const_iterator begin() const { return nodes.begin(); }
-    std::set<RDNode *>::const_iterator end() const { return nodes.end(); }
+    // the memory allocated for the nodes of a big set
+    size_t getAllocatedBytes() const
+    {
+        return big.capacity() * sizeof(RDNode *);
+    }
+
+    const_iterator begin() const { return isSmall() ? small : big.data(); }
+    const_iterator end() const { return begin() + size(); }
+};
+
+// The def-sites of a node kept as a sorted array of unique def-sites.
+// The def-sites are added when the graph is built and then only read.
+// Nearly all the nodes define one def-site, that one is kept inline,
+// only the nodes with more def-sites allocate the array
+class DefSiteSet {
+    // the def-site if the set has just one
+    DefSite single{nullptr};
+    // all the def-sites if the set has more of them
+    std::vector<DefSite> many;
+    unsigned num = 0;
+
+public:
+    using const_iterator = const DefSite *;
+
+    DefSiteSet() = default;
+    DefSiteSet(std::initializer_list<DefSite> sites)
+    {
+        insert(sites.begin(), sites.end());
+    }
+
+    bool insert(const DefSite& ds)
+    {
+        const DefSite *B = begin(), *E = end();
+        const DefSite *I = std::lower_bound(B, E, ds);
+        if (I != E && !(ds < *I))
+            return false;
+
+        if (num == 0) {
+            single = ds;
+        } else {
+            size_t pos = I - B;
+            if (num == 1)
+                many.push_back(single);
+            many.insert(many.begin() + pos, ds);
+        }
+
+        ++num;
+        return true;
+    }
+
+    template <typename IterT>
+    void insert(IterT first, IterT last)
+    {
+        for (; first != last; ++first)
+            insert(*first);
+    }
 
-    std::set<RDNode *>& getNodes()
+    size_t count(const DefSite& ds) const
     {
-        return nodes;
+        return std::binary_search(begin(), end(), ds) ? 1 : 0;
+    }
+
+    size_t size() const { return num; }
+    bool empty() const { return num == 0; }
+
+    void clear()
+    {
+        std::vector<DefSite>().swap(many);
+        num = 0;
+    }
+
+    // the memory allocated for the def-sites that are not inline
+    size_t getAllocatedBytes() const
+    {
+        return many.capacity() * sizeof(DefSite);
+    }
+
+    const_iterator begin() const { return num <= 1 ? &single : many.data(); }
+    const_iterator end() const { return begin() + num; }
+};
+
+using DefSiteSetT = DefSiteSet;
+
+///
+// The def-sites that a node overwrites (the strong updates) prepared
+// for the merges of maps: grouped by the targets (sorted by their ids)
+// with the overwritten bytes of every target kept as sorted disjoint
+// intervals. Checking whether a definition is overwritten
+// is then a binary search for the target and for the interval.
+class RDOverwrites
+{
+    struct Entry {
+        RDNode *target;
+        // some def-site of the target has unknown offset
+        bool unknown = false;
+        // the overwritten bytes [start, end), sorted and merged
+        std::vector<std::pair<uint64_t, uint64_t>> intervals;
+
+        Entry(RDNode *t) : target(t) {}
     };
 
+    std::vector<Entry> entries;
+
+    const Entry *find(RDNode *target) const;
+
+public:
+    RDOverwrites() = default;
+    RDOverwrites(const DefSiteSetT& overwrites);
+
+    bool empty() const { return entries.empty(); }
+
+    // does this overwrite the definition @ds from the other map,
+    // so that we should not merge it (strong update)? The definition
+    // may turn into a definition with unknown offset (@is_unknown)
+    bool overwrites(const DefSite& ds, bool strong_update_unknown,
+                    bool& is_unknown) const;
 };
 
-using DefSiteSetT = std::set<DefSite>;
+///
+// The objects whose def-sites with concrete offsets are folded into
+// one def-site with unknown offset (see RDMap::collapseOffsets()),
+// indexed by the ids of the objects. An object is never uncollapsed.
+// The flags can be read and set from more threads at once
+class CollapsedObjects
+{
+    std::vector<std::atomic<bool>> flags;
+
+public:
+    // make room for the ids up to @last_id, keep the collapsed objects
+    void resize(unsigned last_id)
+    {
+        if (last_id < flags.size())
+            return;
+
+        std::vector<std::atomic<bool>> tmp(last_id + 1);
+        for (size_t i = 0; i < tmp.size(); ++i)
+            tmp[i].store(i < flags.size() && flags[i].load());
+        flags.swap(tmp);
+    }
+
+    bool isCollapsed(unsigned id) const
+    {
+        return id < flags.size() && flags[id].load(std::memory_order_relaxed);
+    }
+
+    void collapse(unsigned id)
+    {
+        assert(id < flags.size());
+        flags[id].store(true, std::memory_order_relaxed);
+    }
+
+    size_t count() const
+    {
+        size_t num = 0;
+        for (const auto& f : flags)
+            num += f.load(std::memory_order_relaxed);
+        return num;
+    }
+};
 
 class RDMap
 {
 public:
-    using MapT = std::map<DefSite, RDNodesSet>;
+    // the definitions are kept in a vector sorted by the def-sites,
+    // so the def-sites of one object are next to each other (sorted
+    // by the offsets) and two maps can be merged in linear time
+    // (the memory is counted to AllocTag::RD_MAPS)
+    using MapT = std::vector<std::pair<DefSite, RDNodesSet>,
+                             ADT::TaggedAllocator<std::pair<DefSite, RDNodesSet>,
+                                                  ADT::AllocTag::RD_MAPS>>;
     using iterator = MapT::iterator;
     using const_iterator = MapT::const_iterator;
 
+    // the copies of the map share the definitions until
+    // one of them is modified (copy-on-write)
     RDMap() {}
-    RDMap(const RDMap& o);
+    RDMap(const RDMap& o) = default;
+    RDMap& operator=(const RDMap& o) = default;
 
     bool merge(const RDMap *o,
-               DefSiteSetT *without = nullptr,
+               const RDOverwrites *without = nullptr,
                bool strong_update_unknown = true,
                uint32_t max_set_size  = (~((uint32_t) 0)),
-               bool merge_unknown     = false);
+               bool merge_unknown     = false,
+               ReachingDefinitionsStatistics *stats = nullptr,
+               bool revisit           = false,
+               const CollapsedObjects *collapsed = nullptr);
     bool add(const DefSite&, RDNode *n);
     bool update(const DefSite&, RDNode *n);
-    bool empty() const { return defs.empty(); }
+    bool empty() const { return getDefs().empty(); }
+
+    // does this map share the definitions with @o?
+    bool shares(const RDMap& o) const
+    {
+        return defs_ptr && defs_ptr == o.defs_ptr;
+    }
+
+    // the memory allocated by the definitions. The shared definitions
+    // are divided among the maps that share them
+    size_t getAllocatedBytes() const
+    {
+        if (!defs_ptr)
+            return 0;
+
+        size_t bytes = sizeof(MapT) + defs_ptr->capacity() * sizeof(MapT::value_type);
+        for (const auto& it : *defs_ptr)
+            bytes += it.second.getAllocatedBytes();
+
+        return bytes / defs_ptr.use_count();
+    }
 
     // @return iterators for the range of pointers that has the same object
     // as the given def site
@@ -149,29 +428,112 @@ public:
     std::pair<RDMap::iterator, RDMap::iterator>
     getObjectRange(RDNode *);
 
-    bool defines(const DefSite& ds) { return defs.count(ds) != 0; }
-    bool definesWithAnyOffset(const DefSite& ds);
+    std::pair<RDMap::const_iterator, RDMap::const_iterator>
+    getObjectRange(const DefSite&) const;
+
+    std::pair<RDMap::const_iterator, RDMap::const_iterator>
+    getObjectRange(RDNode *) const;
+
+    bool defines(const DefSite& ds) const { return find(ds) != getDefs().end(); }
+    bool definesWithAnyOffset(const DefSite& ds) const;
 
-    iterator begin() { return defs.begin(); }
-    iterator end() { return defs.end(); }
-    const_iterator begin() const { return defs.begin(); }
-    const_iterator end() const { return defs.end(); }
+    // the non-const iterators may change the definitions,
+    // so they take a private copy of the shared definitions
+    iterator begin() { return writeDefs().begin(); }
+    iterator end() { return writeDefs().end(); }
+    const_iterator begin() const { return getDefs().begin(); }
+    const_iterator end() const { return getDefs().end(); }
+    size_t size() const { return getDefs().size(); }
 
-    RDNodesSet& get(const DefSite& ds){ return defs[ds]; }
-    //const RDNodesSetT& get(const DefSite& ds) const { return defs[ds]; }
-    RDNodesSet& operator[](const DefSite& ds) { return defs[ds]; }
+    RDNodesSet& get(const DefSite& ds) { return getOrCreate(ds); }
+    RDNodesSet& operator[](const DefSite& ds) { return getOrCreate(ds); }
 
     //RDNodesSet& get(RDNode *, const Offset&);
     // gather reaching definitions of memory [n + off, n + off + len]
     // and store them to the @ret
     size_t get(RDNode *n, const Offset& off,
-               const Offset& len, std::set<RDNode *>& ret);
-    size_t get(DefSite& ds, std::set<RDNode *>& ret);
+               const Offset& len, std::set<RDNode *>& ret) const;
+    size_t get(DefSite& ds, std::set<RDNode *>& ret) const;
+    // gather the reaching definitions of all the @sites at once, @ret[i]
+    // are the sorted definitions of @sites[i]. The def-sites of one object
+    // that follow each other share the lookup of the range of the object
+    void get(const std::vector<DefSite>& sites,
+             std::vector<std::vector<RDNode *>>& ret) const;
+
+    const MapT& getDefs() const
+    {
+        static const MapT empty_defs;
+        return defs_ptr ? *defs_ptr : empty_defs;
+    }
 
-    const MapT& getDefs() const { return defs; }
+    // collapse the objects that have more than @max_offsets def-sites
+    // with concrete offsets in this map and fold the def-sites of all
+    // the collapsed objects into the def-site of the whole object
+    // (with unknown offset and length). Returns true if the map changed
+    bool collapseOffsets(CollapsedObjects& collapsed, uint32_t max_offsets);
 
 private:
-     MapT defs;
+    // nullptr if the map is empty
+    std::shared_ptr<MapT> defs_ptr;
+
+    // index for the overlap queries: no def-site with concrete offset
+    // and length is longer than max_len, so the def-sites that start
+    // more than max_len bytes before the queried offset cannot overlap it.
+    // With a def-site of unknown length (and concrete offset),
+    // the index cannot be used
+    uint64_t max_len = 0;
+    bool unknown_len = false;
+    // the filter of the objects that have a def-site in the map (the bit
+    // ID % 64 of every target), so that the queries for the objects
+    // that are not defined in the map do not search the definitions.
+    // The bits are never cleared, the def-sites of an object
+    // are only folded together, never removed
+    uint64_t targets = 0;
+
+    static uint64_t targetBit(RDNode *n);
+    bool mayDefine(RDNode *n) const { return targets & targetBit(n); }
+
+    // get the definitions for writing, copy them
+    // if they are shared with some other map
+    MapT& writeDefs()
+    {
+        if (!defs_ptr)
+            defs_ptr = std::make_shared<MapT>();
+        else if (defs_ptr.use_count() > 1)
+            defs_ptr = std::make_shared<MapT>(*defs_ptr);
+
+        return *defs_ptr;
+    }
+
+    void addedDefSite(const DefSite& ds)
+    {
+        targets |= targetBit(ds.target);
+        if (ds.offset.isUnknown())
+            return;
+
+        if (ds.len.isUnknown())
+            unknown_len = true;
+        else if (*ds.len > max_len)
+            max_len = *ds.len;
+    }
+
+    const_iterator find(const DefSite& ds) const;
+    bool hasCollapsedDefSites(const CollapsedObjects& collapsed) const;
+    // call @f on the sets of definitions in @range (the range
+    // of the object of @ds) whose def-sites may overlap @ds
+    template <typename F>
+    void forOverlapping(std::pair<const_iterator, const_iterator> range,
+                        const DefSite& ds, F f) const;
+    RDNodesSet& getOrCreate(const DefSite& ds);
+    template <bool Overwrites, bool Limited>
+    bool mergeDefs(const RDMap *oth, const RDOverwrites *no_update,
+                   bool strong_update_unknown, uint32_t max_set_size,
+                   ReachingDefinitionsStatistics *stats, bool revisit);
+    bool mergeUnknown(const RDMap *oth, const RDOverwrites *no_update,
+                      bool strong_update_unknown, uint32_t max_set_size);
+    bool mergeCollapsed(const RDMap *oth, const RDOverwrites *no_update,
+                        bool strong_update_unknown, uint32_t max_set_size,
+                        const CollapsedObjects& collapsed);
 };
 
 } // rd
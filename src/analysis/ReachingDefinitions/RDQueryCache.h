@@ -0,0 +1,116 @@
+#ifndef _DG_RD_QUERY_CACHE_H_
+#define _DG_RD_QUERY_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "RDMap.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+///
+// The results of the queries of reaching definitions of def-sites
+// in the maps of nodes. The nodes that share a map (see RDMap)
+// share its results too, so the loads of one block that query
+// the same memory are answered from the cache. The maps must not change
+// while the cache is used (clear the cache after the analysis runs again).
+// The results are immutable and can be kept after the cache is cleared.
+// The cache is not thread-safe, every thread needs its own.
+class RDQueryCache
+{
+public:
+    using ResultT = std::shared_ptr<const std::vector<RDNode *>>;
+
+private:
+    struct Key {
+        // the definitions of the map (shared by the copies of the map)
+        const void *map;
+        RDNode *target;
+        uint64_t offset;
+        uint64_t len;
+
+        bool operator==(const Key& oth) const
+        {
+            return map == oth.map && target == oth.target
+                    && offset == oth.offset && len == oth.len;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const
+        {
+            size_t h = std::hash<const void *>()(k.map);
+            h = h * 31 + std::hash<const void *>()(k.target);
+            h = h * 31 + std::hash<uint64_t>()(k.offset);
+            return h * 31 + std::hash<uint64_t>()(k.len);
+        }
+    };
+
+    std::unordered_map<Key, ResultT, KeyHash> results;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // the scratch buffers of the queries that were not cached
+    std::vector<DefSite> missed_sites;
+    std::vector<size_t> missed_idx;
+    std::vector<std::vector<RDNode *>> missed_defs;
+
+public:
+    // get the reaching definitions of the @sites in @map, @ret[i] are
+    // the sorted definitions of @sites[i]. The sites that are not cached
+    // are queried in @map at once (see RDMap::get())
+    void get(const RDMap& map, const std::vector<DefSite>& sites,
+             std::vector<ResultT>& ret)
+    {
+        ret.resize(sites.size());
+        missed_sites.clear();
+        missed_idx.clear();
+
+        const void *id = &map.getDefs();
+        for (size_t i = 0; i < sites.size(); ++i) {
+            const DefSite& ds = sites[i];
+            auto it = results.find(Key{id, ds.target, *ds.offset, *ds.len});
+            if (it != results.end()) {
+                ++hits;
+                ret[i] = it->second;
+                continue;
+            }
+
+            ++misses;
+            missed_sites.push_back(ds);
+            missed_idx.push_back(i);
+        }
+
+        if (missed_sites.empty())
+            return;
+
+        map.get(missed_sites, missed_defs);
+        for (size_t i = 0; i < missed_sites.size(); ++i) {
+            const DefSite& ds = missed_sites[i];
+            ResultT res = std::make_shared<const std::vector<RDNode *>>(
+                                                std::move(missed_defs[i]));
+            results.emplace(Key{id, ds.target, *ds.offset, *ds.len}, res);
+            ret[missed_idx[i]] = std::move(res);
+        }
+    }
+
+    void clear()
+    {
+        results.clear();
+        hits = misses = 0;
+    }
+
+    size_t size() const { return results.size(); }
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+};
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_RD_QUERY_CACHE_H_
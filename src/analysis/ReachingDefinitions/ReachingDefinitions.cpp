@@ -1,7 +1,10 @@
+#include <algorithm>
+#include <chrono>
 #include <set>
 
 #include "RDMap.h"
 #include "ReachingDefinitions.h"
+#include "analysis/Tracepoints.h"
 
 namespace dg {
 namespace analysis {
@@ -12,48 +15,353 @@ RDNode *UNKNOWN_MEMORY = &UNKNOWN_MEMLOC;
 
 bool ReachingDefinitionsAnalysis::processNode(RDNode *node)
 {
+    if (!statistics.enabled)
+        return processNodeInternal(node);
+
+    size_t size = node->def_map.size();
+    auto start = std::chrono::steady_clock::now();
+    bool changed = processNodeInternal(node);
+    auto time = std::chrono::steady_clock::now() - start;
+    size_t new_size = node->def_map.size();
+
+    statistics.nodeProcessed(node,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+        new_size > size ? new_size - size : 0);
+
+    return changed;
+}
+
+bool ReachingDefinitionsAnalysis::processNodeInternal(RDNode *node)
+{
+    ++processed;
+    // out of the budget, keep at most one definition
+    // of a def-site, the others are unknown
+    uint32_t max_size = budget.tick() ? 1 : max_set_size;
+
+    // a node with one predecessor that defines nothing has the same
+    // map as the predecessor, so just share the predecessor's map
+    // (it gets copied only once one of the nodes writes to it)
+    if (node->predecessors.size() == 1 && !node->summary
+        && node->defs.empty() && node->overwrites.empty()) {
+        const RDMap& pred_map = node->predecessors[0]->getMapNode()->def_map;
+        if (pred_map.empty() || node->def_map.shares(pred_map))
+            return false;
+
+        node->def_map = pred_map;
+        return true;
+    }
+
     bool changed = false;
+    ReachingDefinitionsStatistics *stats = nullptr;
+    bool revisit = false;
+    if (statistics.enabled || statistics.maxGrowths > 0) {
+        stats = &statistics;
+        if (node->rpo < processed_nodes.size()) {
+            revisit = processed_nodes[node->rpo];
+            processed_nodes[node->rpo] = true;
+        }
+    }
 
     // merge maps from predecessors
-    for (RDNode *n : node->predecessors)
-        changed |= node->def_map.merge(&n->def_map,
-                                       &node->overwrites /* strong update */,
+    DG_TRACE1(rd_merge_begin, node);
+    const RDOverwrites *overwrites = node->getOverwritesIndex();
+    // the call-return nodes define nothing, they overwrite
+    // what the called procedure must define
+    const RDSummary *summary = node->summary;
+    RDMap local;
+    RDOverwrites must;
+    if (summary) {
+        DefSiteSetT must_sites;
+        getSummaryDefinitions(*summary, local, must_sites);
+        must = RDOverwrites(must_sites);
+        overwrites = must.empty() ? nullptr : &must;
+    }
+
+    for (RDNode *n : node->predecessors) {
+        // only the definitions of the procedure are taken from its return
+        if (summary && n == summary->ret)
+            continue;
+
+        changed |= node->def_map.merge(&n->getMapNode()->def_map,
+                                       overwrites /* strong update */,
                                        strong_update_unknown,
-                                       max_set_size /* max size of set of reaching definition
-                                                       of one definition site */,
-                                       false /* merge unknown */);
+                                       max_size /* max size of set of reaching definition
+                                                   of one definition site */,
+                                       false /* merge unknown */,
+                                       stats, revisit,
+                                       max_offsets > 0 ? &collapsed : nullptr);
+    }
 
+    if (summary)
+        changed |= node->def_map.merge(&local, nullptr, strong_update_unknown,
+                                       max_size, false /* merge unknown */,
+                                       stats, revisit,
+                                       max_offsets > 0 ? &collapsed : nullptr);
+
+    // fold the def-sites of the objects with too many offsets
+    if (max_offsets > 0)
+        changed |= node->def_map.collapseOffsets(collapsed, max_offsets);
+
+    DG_TRACE2(rd_merge_end, node, changed);
     return changed;
 }
 
+void ReachingDefinitionsAnalysis::getSummaryDefinitions(const RDSummary& summary,
+                                                        RDMap& local,
+                                                        DefSiteSetT& must) const
+{
+    const RDMap& ret = summary.ret->getMapNode()->def_map;
+    auto I = ret.begin(), E = ret.end();
+    while (I != E) {
+        // the def-sites of one object are next to each other
+        auto obj_end = I;
+        bool only_local = true;
+        while (obj_end != E && obj_end->first.target == I->first.target) {
+            const RDNodesSet& defs = obj_end->second;
+            if (defs.isUnknown()) {
+                only_local = false;
+            } else {
+                for (RDNode *n : defs)
+                    only_local &= summary.defines(n);
+            }
+            ++obj_end;
+        }
+
+        for (; I != obj_end; ++I) {
+            const DefSite& ds = I->first;
+            if (I->second.isUnknown()) {
+                local.get(ds).makeUnknown();
+                continue;
+            }
+
+            for (RDNode *n : I->second) {
+                if (summary.defines(n))
+                    local.add(ds, n);
+            }
+
+            // no definition of the object from the callers got
+            // through the procedure, so it overwrote them all
+            if (only_local && !ds.target->isUnknown()
+                && !ds.offset.isUnknown() && !ds.len.isUnknown())
+                must.insert(ds);
+        }
+    }
+}
+
+const std::vector<RDNode *>&
+ReachingDefinitionsAnalysis::getNodesInReversePostorder()
+{
+    unsigned long version = RDNode::getEdgesVersion();
+    if (rpo_root == root && rpo_version == version && rpo_dfsnum == dfsnum)
+        return rpo_order;
+
+    ++dfsnum;
+
+    std::vector<RDNode *>& nodes = rpo_order;
+    nodes.clear();
+    // the node and the index of the next successor to visit
+    std::vector<std::pair<RDNode *, size_t>> stack;
+    stack.emplace_back(root, 0);
+    root->dfsid = dfsnum;
+
+    while (!stack.empty()) {
+        RDNode *cur = stack.back().first;
+        size_t idx = stack.back().second;
+
+        if (idx < cur->successors.size()) {
+            ++stack.back().second;
+            RDNode *succ = cur->successors[idx];
+            if (succ->dfsid != dfsnum) {
+                succ->dfsid = dfsnum;
+                stack.emplace_back(succ, 0);
+            }
+        } else {
+            nodes.push_back(cur);
+            stack.pop_back();
+        }
+    }
+
+    std::reverse(nodes.begin(), nodes.end());
+    for (unsigned i = 0; i < nodes.size(); ++i)
+        nodes[i]->rpo = i;
+
+    rpo_root = root;
+    rpo_version = version;
+    rpo_dfsnum = dfsnum;
+    return nodes;
+}
+
+bool ReachingDefinitionsAnalysis::isPassThrough(const RDNode *n) const
+{
+    if (n == root || n->predecessors.size() != 1)
+        return false;
+
+    // keep the maps on the call boundaries, so that queries
+    // in the callee do not need to walk into the caller
+    RDNodeType type = n->getType();
+    if (type == CALL || type == CALL_RETURN || type == RETURN)
+        return false;
+
+    return n->defs.empty() && n->overwrites.empty() && n->def_map.empty();
+}
+
+void ReachingDefinitionsAnalysis::collapsePassThroughNodes(
+                                        const std::vector<RDNode *>& nodes)
+{
+    // collapse the chains of pass-through nodes. The only predecessor
+    // of a pass-through node precedes it in reverse postorder,
+    // so it has been already assigned its map node
+    std::vector<RDNode *> stored;
+    for (RDNode *n : nodes) {
+        if (isPassThrough(n)) {
+            n->map_node = n->predecessors[0]->getMapNode();
+        } else {
+            n->map_node = nullptr;
+            stored.push_back(n);
+        }
+    }
+
+    // the stored nodes that merge the map of the given stored node
+    // (indexed by the reverse postorder number of the given node)
+    users.assign(nodes.size(), std::vector<RDNode *>());
+    for (RDNode *n : stored) {
+        for (RDNode *pred : n->predecessors) {
+            // unreachable predecessors never change
+            if (pred->dfsid == dfsnum)
+                users[pred->getMapNode()->rpo].push_back(n);
+        }
+    }
+}
+
 void ReachingDefinitionsAnalysis::run()
 {
     assert(root && "Do not have root");
 
-    std::vector<RDNode *> to_process = getNodes(root);
-    std::vector<RDNode *> changed;
+    processed = 0;
+    statistics.reset();
+    budget.start();
+    progress.start("reaching definitions");
+    if (max_offsets > 0)
+        collapsed.resize(RDNode::getLastID());
+    const std::vector<RDNode *>& nodes = getNodesInReversePostorder();
+    processed_nodes.assign(nodes.size(), false);
+    if (sparse)
+        collapsePassThroughNodes(nodes);
+    else {
+        for (RDNode *n : nodes)
+            n->map_node = nullptr;
+    }
+
+    if (threads > 1)
+        runParallel();
+    else
+        solve(nodes);
+
+    std::vector<std::vector<RDNode *>>().swap(users);
+    std::vector<char>().swap(processed_nodes);
+}
+
+void ReachingDefinitionsAnalysis::solve(const std::vector<RDNode *>& todo)
+{
+    // process the nodes in reverse postorder, so that (apart from
+    // the loops) the predecessors are processed before the node.
+    // Then revisit only the nodes whose predecessors' maps changed
+    ADT::PriorityWorklist<RDNode *, RPOPriority> worklist(processed_nodes.size());
+    for (RDNode *n : todo) {
+        if (!n->map_node)
+            worklist.push(n);
+    }
+
+    while (!worklist.empty()) {
+        RDNode *cur = worklist.pop();
+        if (processNode(cur)) {
+            for (RDNode *user : getUsers(cur))
+                worklist.push(user);
+        }
+
+        if (progress.tick())
+            writeProgress(worklist.size());
+    }
+}
+
+void ReachingDefinitionsAnalysis::writeProgress(uint64_t waiting)
+{
+    Progress::Report report;
+    report.round = processed / std::max<size_t>(rpo_order.size(), 1) + 1;
+    report.worklist = waiting;
+    report.processed = processed;
+    for (RDNode *n : rpo_order) {
+        // count the shared maps once
+        if (n->getMapNode() != n)
+            continue;
+
+        const RDMap& map = n->def_map;
+        for (const auto& it : map)
+            report.sets += it.second.size();
+    }
 
-    // do fixpoint
-    do {
-        unsigned last_processed_num = to_process.size();
-        changed.clear();
+    progress.report(report);
+}
+
+std::vector<RDNode *>
+ReachingDefinitionsAnalysis::update(const std::vector<RDNode *>& changed)
+{
+    assert(root && "Do not have root");
 
-        for (RDNode *cur : to_process) {
-            if (processNode(cur))
-                changed.push_back(cur);
+    processed = 0;
+    statistics.reset();
+    budget.start();
+    progress.start("reaching definitions");
+    if (max_offsets > 0)
+        collapsed.resize(RDNode::getLastID());
+    const std::vector<RDNode *>& nodes = getNodesInReversePostorder();
+    processed_nodes.assign(nodes.size(), false);
+
+    // the nodes reachable from the changed nodes
+    // (the changed nodes may not be reachable from the root anymore)
+    std::vector<char> affected(nodes.size(), false);
+    std::vector<RDNode *> stack;
+    for (RDNode *n : changed) {
+        if (n->dfsid == dfsnum && !affected[n->rpo]) {
+            affected[n->rpo] = true;
+            stack.push_back(n);
         }
+    }
 
-        if (!changed.empty()) {
-            to_process.clear();
-            to_process = getNodes(nullptr /* starting node */,
-                                  &changed /* starting set */,
-                                  last_processed_num /* expected num */);
+    while (!stack.empty()) {
+        RDNode *cur = stack.back();
+        stack.pop_back();
 
-            // since changed was not empty,
-            // the to_process must not be empty too
-            assert(!to_process.empty());
+        for (RDNode *succ : cur->successors) {
+            if (!affected[succ->rpo]) {
+                affected[succ->rpo] = true;
+                stack.push_back(succ);
+            }
         }
-    } while (!changed.empty());
+    }
+
+    std::vector<RDNode *> todo;
+    for (RDNode *n : nodes) {
+        if (!affected[n->rpo])
+            continue;
+
+        n->def_map = RDMap();
+        for (const DefSite& ds : n->defs)
+            n->def_map.update(ds, n);
+
+        n->map_node = nullptr;
+        todo.push_back(n);
+    }
+
+    if (sparse)
+        collapsePassThroughNodes(nodes);
+
+    solve(todo);
+
+    std::vector<std::vector<RDNode *>>().swap(users);
+    std::vector<char>().swap(processed_nodes);
+
+    return todo;
 }
 
 
@@ -1,6 +1,8 @@
 #ifndef _DG_REACHING_DEFINITIONS_ANALYSIS_H_
 #define _DG_REACHING_DEFINITIONS_ANALYSIS_H_
 
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <set>
 #include <cassert>
@@ -8,17 +10,25 @@
 
 #include "analysis/SubgraphNode.h"
 #include "analysis/PointsTo/PointerSubgraph.h"
+#include "analysis/Budget.h"
+#include "analysis/Progress.h"
 #include "analysis/Offset.h"
 
 #include "ADT/Queue.h"
 #include "RDMap.h"
+#include "ReachingDefinitionsStatistics.h"
 
 namespace dg {
 namespace analysis {
+
+template <typename NodeT>
+class SCC;
+
 namespace rd {
 
 class RDNode;
 class ReachingDefinitionsAnalysis;
+struct RDSummary;
 
 // here the types are for type-checking (optional - user can do it
 // when building the graph) and for later optimizations
@@ -49,9 +59,29 @@ class RDNode : public SubgraphNode<RDNode> {
 
     // marks for DFS/BFS
     unsigned int dfsid;
+    // number of the node in reverse postorder
+    unsigned int rpo;
+    // in the sparse mode, the node that keeps the map
+    // for this node (nullptr if the node keeps its own map)
+    RDNode *map_node;
+
+    RDNode *getMapNode() { return map_node ? map_node : this; }
+    const RDNode *getMapNode() const { return map_node ? map_node : this; }
+
+    // the overwrites prepared for the merges (see getOverwritesIndex()),
+    // and the number of the overwrites that they were built from
+    RDOverwrites overwrites_index;
+    size_t overwrites_indexed = 0;
+
+    // the procedure that the node was built for (0 if none)
+    unsigned procedure = 0;
+    // the summary of the called procedure, see setSummary()
+    const RDSummary *summary = nullptr;
+
 public:
 
-    RDNode(RDNodeType t = NONE) : type(t), dfsid(0) {}
+    RDNode(RDNodeType t = NONE)
+    : type(t), dfsid(0), rpo(0), map_node(nullptr) {}
 
     // this is the gro of this node, so make it public
     DefSiteSetT defs;
@@ -64,6 +94,22 @@ public:
     RDNodeType getType() const { return type; }
     DefSiteSetT& getDefines() { return defs; }
     DefSiteSetT& getOverwrites() { return overwrites; }
+
+    // the overwrites for RDMap::merge(), nullptr if the node
+    // overwrites nothing. The overwrites are only added,
+    // so the index is built again only when their number changes
+    const RDOverwrites *getOverwritesIndex()
+    {
+        if (overwrites.empty())
+            return nullptr;
+
+        if (overwrites_indexed != overwrites.size()) {
+            overwrites_index = RDOverwrites(overwrites);
+            overwrites_indexed = overwrites.size();
+        }
+
+        return &overwrites_index;
+    }
     const DefSiteSetT& getDefines() const { return defs; }
 
     bool defines(RDNode *target, const Offset& off = UNKNOWN_OFFSET) const
@@ -117,12 +163,12 @@ public:
         overwrites.insert(ds);
     }
 
-    const RDMap& getReachingDefinitions() const { return def_map; }
-    RDMap& getReachingDefinitions() { return def_map; }
+    const RDMap& getReachingDefinitions() const { return getMapNode()->def_map; }
+    RDMap& getReachingDefinitions() { return getMapNode()->def_map; }
     size_t getReachingDefinitions(RDNode *n, const Offset& off,
                                   const Offset& len, std::set<RDNode *>& ret)
     {
-        return def_map.get(n, off, len, ret);
+        return getMapNode()->def_map.get(n, off, len, ret);
     }
 
     bool isUnknown() const
@@ -130,16 +176,135 @@ public:
         return this == UNKNOWN_MEMORY;
     }
 
+    // number the procedures from 1, so that the summaries
+    // know which definitions are made in which procedure
+    void setProcedure(unsigned p) { procedure = p; }
+    unsigned getProcedure() const { return procedure; }
+
+    // make this call-return node take only the definitions of the
+    // called procedure from the map of the procedure's return node
+    // (that must be its predecessor), see RDSummary
+    void setSummary(const RDSummary *s) { summary = s; }
+    const RDSummary *getSummary() const { return summary; }
 
     friend class ReachingDefinitionsAnalysis;
 };
 
+///
+// The definitions that a procedure makes (or the procedures it calls),
+// applied at the call-return nodes of the calls of the procedure.
+// The maps of all the callers are still merged at the entry of the
+// procedure, so the definitions in the procedure are sound, but
+// a call-return node with the summary takes from the return node
+// of the procedure only the definitions made by the nodes of
+// the @procedures. The definitions of its caller come from its other
+// predecessors (the call node), so the definitions of the other callers
+// do not flow back out of the procedure. The def-sites of an object
+// that has no other definitions at the return node than the definitions
+// of the procedure are strongly updated (the procedure must overwrite
+// the definitions of the callers, since they are merged to its entry)
+struct RDSummary {
+    // the unified return node of the procedure
+    RDNode *ret = nullptr;
+    // the procedure and the procedures it calls (transitively), sorted
+    std::vector<unsigned> procedures;
+
+    // is @n the node of the procedure or of the procedures it calls?
+    bool defines(const RDNode *n) const
+    {
+        return n->getProcedure() != 0
+               && std::binary_search(procedures.begin(), procedures.end(),
+                                     n->getProcedure());
+    }
+};
+
+bool DefSite::operator<(const DefSite& oth) const
+{
+    return target == oth.target ?
+            (offset == oth.offset ? len < oth.len : offset < oth.offset)
+            : target->getID() < oth.target->getID();
+}
+
 class ReachingDefinitionsAnalysis
 {
     RDNode *root;
     unsigned int dfsnum;
     bool strong_update_unknown;
     uint32_t max_set_size;
+    bool sparse = false;
+    unsigned threads = 1;
+    // how many times was processNode() called
+    std::atomic<uint64_t> processed{0};
+    ReachingDefinitionsStatistics statistics;
+    // checked in processNode() (see setBudget())
+    Budget budget;
+    // periodic reports of the run (see setProgress())
+    Progress progress;
+    // the nodes that were processed already (indexed by the reverse
+    // postorder number), the growth of their sets is an iteration
+    std::vector<char> processed_nodes;
+    // see setMaxOffsets()
+    uint32_t max_offsets = 0;
+    CollapsedObjects collapsed;
+
+    // in the sparse mode, the nodes that merge the map
+    // of the given node (indexed by the reverse postorder number)
+    std::vector<std::vector<RDNode *>> users;
+
+    // the priority of a node in the worklist is its reverse postorder
+    // number (minus @base, the lowest number of the worklisted nodes)
+    struct RPOPriority {
+        unsigned base;
+
+        RPOPriority(unsigned b = 0) : base(b) {}
+
+        size_t operator()(const RDNode *n) const
+        {
+            assert(n->rpo >= base);
+            return n->rpo - base;
+        }
+    };
+
+    // the nodes reachable from the root in reverse postorder. They are
+    // numbered and marked by @rpo_dfsnum again only when the root
+    // or the edges changed (or other search marked the nodes since)
+    std::vector<RDNode *> rpo_order;
+    RDNode *rpo_root = nullptr;
+    unsigned long rpo_version = 0;
+    unsigned int rpo_dfsnum = 0;
+
+    // number the nodes reachable from the root in reverse postorder
+    // and return them in this order
+    const std::vector<RDNode *>& getNodesInReversePostorder();
+
+    // the node does not define anything and has only one predecessor,
+    // so its map would be only a copy of the predecessor's map
+    bool isPassThrough(const RDNode *n) const;
+    void collapsePassThroughNodes(const std::vector<RDNode *>& nodes);
+
+    // the nodes that must be processed again when the map of @n changes
+    ADT::ArrayView<RDNode *> getUsers(RDNode *n) const
+    {
+        if (sparse)
+            return users[n->rpo];
+        return n->successors;
+    }
+
+    // process the nodes (and their users) until the maps do not change
+    void solve(const std::vector<RDNode *>& todo);
+    // write the report of the progress of solve()
+    void writeProgress(uint64_t waiting);
+    // processNode() without the statistics
+    bool processNodeInternal(RDNode *n);
+    // gather the definitions of the procedure of @summary at its return
+    // into @local and the def-sites that it must overwrite into @must
+    void getSummaryDefinitions(const RDSummary& summary, RDMap& local,
+                               DefSiteSetT& must) const;
+
+    // solve the strongly connected components
+    // of the graph with more threads
+    void solveComponent(const SCC<RDNode>& scc, unsigned id);
+    void runParallel();
 
 public:
     ReachingDefinitionsAnalysis(RDNode *r,
@@ -225,8 +390,65 @@ public:
     RDNode *getRoot() const { return root; }
     void setRoot(RDNode *r) { root = r; }
 
+    // keep the maps only at the nodes that define something, at joins
+    // and at call boundaries. The other nodes share the map of the nearest
+    // such node above them (getReachingDefinitions() returns that map)
+    void setSparse(bool s) { sparse = s; }
+
+    // solve the strongly connected components of the graph that
+    // do not depend on each other in parallel using @n threads.
+    // The results are the same as with one thread
+    void setThreads(unsigned n) { threads = n ? n : 1; }
+    unsigned getThreads() const { return threads; }
+
+    // number of nodes processed by the last run()
+    uint64_t getProcessedNodes() const { return processed; }
+
+    // gather the statistics of the def-sites and of the processing
+    // of the nodes (it is timed) in the next run()
+    void collectStatistics(bool enable = true) { statistics.enabled = enable; }
+    // make the def-sites whose sets of definitions grew in the iterations
+    // of loops more than @n times unknown (defined at unknown place).
+    // Unlike max_set_size, this cuts only the sets that keep growing,
+    // e.g., the sets of arrays written in loops. 0 turns it off
+    void setMaxGrowths(uint32_t n) { statistics.maxGrowths = n; }
+    const ReachingDefinitionsStatistics& getStatistics() const { return statistics; }
+
+    // once a map has more than @n def-sites with concrete offsets
+    // of one object, the object is collapsed: its def-sites in all
+    // the maps are folded into one def-site with unknown offset from then
+    // on (the strong updates of the object are lost). The big arrays then
+    // do not blow up the maps, while the small structures keep the fields.
+    // 0 turns it off. With more threads, the objects may be collapsed
+    // at different times, so the results may be less precise than with
+    // one thread (but they are sound)
+    void setMaxOffsets(uint32_t n) { max_offsets = n; }
+    // the number of the collapsed objects
+    size_t getCollapsedNum() const { return collapsed.count(); }
+
+    // the time and memory limits of run(). Once they are exceeded,
+    // the def-sites that get more than one definition are made unknown
+    // (defined at unknown place) from then on, so the analysis
+    // finishes quickly with sound (but imprecise) results
+    void setBudget(const Budget& b) { budget = b; }
+    bool isBudgetExceeded() const { return budget.isExceeded(); }
+
+    // report the progress of run() and update() periodically.
+    // The analysis has no rounds, the reported round is the number
+    // of the nodes processed so far divided by the number of nodes
+    // (plus one). The parallel run reports nothing
+    void setProgress(const Progress& p) { progress = p; }
+
     bool processNode(RDNode *n);
     void run();
+
+    // recompute the maps after the subgraph was changed. @changed are
+    // the new nodes and the nodes whose predecessors changed. The maps
+    // of the nodes that are not reachable from @changed stay as they are,
+    // the other nodes start again from their own definitions (the old maps
+    // may contain definitions that are not in the graph anymore).
+    // Returns the nodes whose maps were recomputed
+    std::vector<RDNode *> update(const std::vector<RDNode *>& changed);
 };
 
 } // namespace rd
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <vector>
+
+#include "ReachingDefinitions.h"
+#include "analysis/Parallel.h"
+#include "analysis/SCC.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+// the maps of the predecessors from the previous components
+// do not change anymore, so it is enough to iterate
+// over the nodes of the component @id
+void ReachingDefinitionsAnalysis::solveComponent(const SCC<RDNode>& scc, unsigned id)
+{
+    // the worklist is indexed from the first node of the component,
+    // so that the small components do not allocate for all the nodes
+    const auto& nodes = scc.getSCC()[id];
+    unsigned base = ~0U;
+    for (RDNode *n : nodes)
+        base = std::min(base, n->rpo);
+
+    ADT::PriorityWorklist<RDNode *, RPOPriority> worklist(0, RPOPriority(base));
+    for (RDNode *n : nodes) {
+        if (!n->map_node)
+            worklist.push(n);
+    }
+
+    while (!worklist.empty()) {
+        RDNode *cur = worklist.pop();
+        if (processNode(cur)) {
+            for (RDNode *user : getUsers(cur)) {
+                if (scc.getSCCId(user) == id)
+                    worklist.push(user);
+            }
+        }
+    }
+}
+
+///
+// The map of a node depends only on the maps of its predecessors,
+// so a component must wait only for the components that have an edge
+// to it in the condensation graph. The components that are not
+// connected by a path can be solved at the same time.
+//
+// The subgraph of a function is shared by all its call-sites, so a function
+// called from several places is in one component with the code between
+// the calls. The independent components are mostly the branches
+// of the program and the functions called from them.
+void ReachingDefinitionsAnalysis::runParallel()
+{
+    SCC<RDNode> scc_comp;
+    scc_comp.compute(root);
+    // the components wait for their predecessors in the condensation,
+    // the unreachable predecessors are not in any component
+    // (they never change)
+    SCCCondensation<RDNode> condensation(scc_comp);
+
+    TaskGraph tasks(condensation.size());
+    for (size_t i = 0; i < condensation.size(); ++i) {
+        for (unsigned s : condensation[i].getSuccessors())
+            tasks.addDependence(i, s);
+    }
+
+    tasks.run(threads, [&](size_t i) { solveComponent(scc_comp, i); });
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,148 @@
+#ifndef _DG_REACHING_DEFINITIONS_STATISTICS_H_
+#define _DG_REACHING_DEFINITIONS_STATISTICS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "RDMap.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+// statistics about the sets of definitions of the def-sites
+// gathered by RDMap::merge() and the adaptive limit of the sets.
+// The maps are merged from more threads with
+// ReachingDefinitionsAnalysis::setThreads(), so the methods are locked
+struct ReachingDefinitionsStatistics
+{
+    struct DefSiteStatistics {
+        // how many times was a set of the def-site merged to
+        uint64_t merges = 0;
+        // how many times the merge added new definitions
+        uint64_t growths = 0;
+        // growths in nodes that were processed already,
+        // i.e., the growths in the iterations of loops
+        uint64_t iterationGrowths = 0;
+        // the largest set of the def-site
+        size_t maxSize = 0;
+        // the def-site is defined at unknown place from now on
+        bool truncated = false;
+    };
+
+    struct NodeStatistics {
+        // how many times was the node processed
+        uint64_t processed = 0;
+        // time spent in processing the node (in nanoseconds)
+        uint64_t time = 0;
+        // how many def-sites were added to the map of the node
+        uint64_t growth = 0;
+    };
+
+    // gather the statistics of the def-sites
+    bool enabled = false;
+    // make the def-site unknown once its sets grew in the iterations
+    // of loops more than @maxGrowths times (0 means never)
+    uint32_t maxGrowths = 0;
+
+    std::map<DefSite, DefSiteStatistics> sites;
+    // the statistics of every processed node, so that the costs
+    // can be attributed to the functions of the nodes
+    std::unordered_map<RDNode *, NodeStatistics> nodes;
+    // number of def-sites truncated due to @maxGrowths
+    uint64_t truncatedNum = 0;
+
+    // a set of definitions of @ds was merged to and has @size elements now.
+    // @grew is true if the merge added something, @revisit is true
+    // if the node was processed before. Returns true if the set should
+    // be made unknown
+    bool merged(const DefSite& ds, size_t size, bool grew, bool revisit)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        DefSiteStatistics& st = sites[ds];
+        ++st.merges;
+        if (grew) {
+            ++st.growths;
+            if (revisit)
+                ++st.iterationGrowths;
+        }
+
+        st.maxSize = std::max(st.maxSize, size);
+
+        if (!st.truncated && maxGrowths > 0
+            && st.iterationGrowths > maxGrowths) {
+            st.truncated = true;
+            ++truncatedNum;
+        }
+
+        return st.truncated;
+    }
+
+    void nodeProcessed(RDNode *node, uint64_t time, uint64_t growth)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        NodeStatistics& ns = nodes[node];
+        ++ns.processed;
+        ns.time += time;
+        ns.growth += growth;
+    }
+
+    void reset()
+    {
+        sites.clear();
+        nodes.clear();
+        truncatedNum = 0;
+    }
+
+    // @num def-sites with the largest sets or merged most times
+    std::vector<std::pair<DefSite, DefSiteStatistics>>
+    getLargest(size_t num) const
+    {
+        return getTop(num, [](const DefSiteStatistics& a,
+                              const DefSiteStatistics& b) {
+            return a.maxSize > b.maxSize;
+        });
+    }
+
+    std::vector<std::pair<DefSite, DefSiteStatistics>>
+    getMostMerged(size_t num) const
+    {
+        return getTop(num, [](const DefSiteStatistics& a,
+                              const DefSiteStatistics& b) {
+            return a.merges > b.merges;
+        });
+    }
+
+private:
+    std::mutex lock;
+
+    template <typename Cmp>
+    std::vector<std::pair<DefSite, DefSiteStatistics>>
+    getTop(size_t num, Cmp cmp) const
+    {
+        std::vector<std::pair<DefSite, DefSiteStatistics>>
+            ret(sites.begin(), sites.end());
+
+        num = std::min(num, ret.size());
+        std::partial_sort(ret.begin(), ret.begin() + num, ret.end(),
+                          [cmp](const std::pair<DefSite, DefSiteStatistics>& a,
+                                const std::pair<DefSite, DefSiteStatistics>& b) {
+                              return cmp(a.second, b.second);
+                          });
+        ret.erase(ret.begin() + num, ret.end());
+
+        return ret;
+    }
+};
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_REACHING_DEFINITIONS_STATISTICS_H_
@@ -1,10 +1,10 @@
 #ifndef _DG_SCC_H_
 #define  _DG_SCC_H_
 
+#include <algorithm>
+#include <cassert>
+#include <utility>
 #include <vector>
-#include <set>
-
-#include "ADT/Queue.h"
 
 namespace dg {
 namespace analysis {
@@ -12,24 +12,97 @@ namespace analysis {
 // implementation of tarjan's algorithm for
 // computing strongly connected components
 // for a directed graph that has a starting vertex
-// from which are all other vertices reachable
+// from which are all other vertices reachable.
+//
+// The algorithm is iterative (it keeps its own stack of the nodes
+// whose successors are being searched), so it works also for very
+// long paths in the graph. The DFS numbers and low-points are kept
+// in temporary vectors indexed by the ids of nodes (getID()),
+// only the index of the component of every node is kept
+// after the computation (see getSCCId()).
 template <typename NodeT>
 class SCC {
 public:
     using SCC_component_t = std::vector<NodeT *>;
     using SCC_t = std::vector<SCC_component_t>;
 
-    SCC<NodeT>() : index(0) {}
+    // the component id of the nodes that were not reached
+    static const unsigned NONE = ~0U;
+
+    SCC<NodeT>() = default;
 
     // returns a vector of vectors - every inner vector
-    // contains the nodes that for a SCC
+    // contains the nodes that for a SCC. The components
+    // are in reverse topological order
     SCC_t& compute(NodeT *start)
     {
-        assert(start->dfs_id == 0);
+        scc.clear();
+        scc_ids.assign(NodeT::getLastID() + 1, NONE);
+
+        // 0 means not visited yet
+        std::vector<unsigned> dfs_id(scc_ids.size(), 0);
+        std::vector<unsigned> lowpt(scc_ids.size(), 0);
+        std::vector<bool> on_stack(scc_ids.size(), false);
+        std::vector<NodeT *> stack;
+        unsigned index = 0;
+
+        // the DFS stack: a node and the index
+        // of its successor that is searched next
+        std::vector<std::pair<NodeT *, size_t>> dfs;
+
+        auto visit = [&](NodeT *n) {
+            unsigned id = n->getID();
+            assert(dfs_id[id] == 0);
+            dfs_id[id] = lowpt[id] = ++index;
+            stack.push_back(n);
+            on_stack[id] = true;
+            dfs.emplace_back(n, 0);
+        };
+
+        visit(start);
+        while (!dfs.empty()) {
+            NodeT *n = dfs.back().first;
+            unsigned id = n->getID();
+            const auto& succs = n->getSuccessors();
+
+            if (dfs.back().second < succs.size()) {
+                NodeT *succ = succs[dfs.back().second++];
+                unsigned sid = succ->getID();
+                if (dfs_id[sid] == 0)
+                    visit(succ);
+                else if (on_stack[sid])
+                    lowpt[id] = std::min(lowpt[id], dfs_id[sid]);
+
+                continue;
+            }
 
-        _compute(start);
-        assert(stack.empty());
+            // all successors are searched
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                unsigned pid = dfs.back().first->getID();
+                lowpt[pid] = std::min(lowpt[pid], lowpt[id]);
+            }
+
+            if (lowpt[id] == dfs_id[id]) {
+                SCC_component_t component;
+                unsigned component_num = scc.size();
+
+                NodeT *w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w->getID()] = false;
+                    component.push_back(w);
+                    // the numbers scc_id give
+                    // a reverse topological order
+                    scc_ids[w->getID()] = component_num;
+                } while (w != n);
+
+                scc.push_back(std::move(component));
+            }
+        }
 
+        assert(stack.empty());
         return scc;
     }
 
@@ -44,81 +117,55 @@ public:
         return scc[idx];
     }
 
+    // the index of the component of the node in getSCC()
+    // from the last compute(), NONE if the node was not reached
+    unsigned getSCCId(const NodeT *n) const
+    {
+        unsigned id = n->getID();
+        return id < scc_ids.size() ? scc_ids[id] : NONE;
+    }
 
 private:
-    ADT::QueueLIFO<NodeT *> stack;
-    unsigned index;
-
     // container for the strongly connected components.
     SCC_t scc;
-
-    void _compute(NodeT *n)
-    {
-        // here we using the fact that we are a friend class
-        // of SubgraphNode. If we would need to make this
-        // algorithm more generinc, we add setters/getters.
-        n->dfs_id = n->lowpt = ++index;
-        stack.push(n);
-        n->on_stack = true;
-
-        for (NodeT *succ : n->getSuccessors()) {
-            if (succ->dfs_id == 0) {
-                assert(!succ->on_stack);
-                _compute(succ);
-                n->lowpt = std::min(n->lowpt, succ->lowpt);
-            } else if (succ->on_stack) {
-                n->lowpt = std::min(n->lowpt, succ->dfs_id);
-            }
-        }
-
-        if (n->lowpt == n->dfs_id) {
-            SCC_component_t component;
-            size_t component_num = scc.size();
-
-            NodeT *w;
-            while (stack.top()->dfs_id >= n->dfs_id) {
-                w = stack.pop();
-                w->on_stack = false;
-                component.push_back(w);
-                // the numbers scc_id give
-                // a reverse topological order
-                w->scc_id = component_num;
-
-                if (stack.empty())
-                    break;
-            }
-
-            scc.push_back(std::move(component));
-        }
-    }
+    // the component of every node (indexed by the id of the node)
+    std::vector<unsigned> scc_ids;
 };
 
+template <typename NodeT>
+const unsigned SCC<NodeT>::NONE;
+
+// The condensation of the graph: a DAG whose nodes are the strongly
+// connected components and that has an edge between two components
+// if there is an edge between their nodes. The nodes have the same
+// indices as the components in SCC::getSCC(), so the edges go
+// from the higher indices to the lower ones.
 template <typename NodeT>
 class SCCCondensation {
-    using SCC_t = typename SCC<NodeT>::SCC_t;
     using SCC_component_t = typename SCC<NodeT>::SCC_component_t;
 
     struct Node {
-        const SCC_component_t& component;
-        std::set<unsigned> successors;
-
-        Node(SCC_component_t& comp) : component(comp) {}
+        const SCC_component_t *component;
+        std::vector<unsigned> successors;
+        std::vector<unsigned> predecessors;
 
-        void addSuccessor(unsigned idx)
-        {
-            successors.insert(idx);
-        }
+        Node(const SCC_component_t *comp) : component(comp) {}
 
         const SCC_component_t& operator*() const
         {
-            return component;
+            return *component;
         }
 
         // XXX: create iterators instead
-        const std::set<unsigned>& getSuccessors() const
+        const std::vector<unsigned>& getSuccessors() const
         {
             return successors;
         }
+
+        const std::vector<unsigned>& getPredecessors() const
+        {
+            return predecessors;
+        }
     };
 
     std::vector<Node> nodes;
@@ -130,44 +177,114 @@ public:
         return nodes[idx];
     }
 
-    void compute(SCC_t& scc)
+    const Node& operator[](unsigned idx) const
+    {
+        assert(idx < nodes.size());
+        return nodes[idx];
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    void compute(const SCC<NodeT>& S)
     {
+        const auto& scc = S.getSCC();
+        nodes.clear();
         // we know the size before-hand
         nodes.reserve(scc.size());
 
         // create the nodes in our condensation graph
-        for (auto& comp : scc)
-            nodes.push_back(Node(comp));
-
-        assert(nodes.size() == scc.size());
+        for (const auto& comp : scc)
+            nodes.push_back(Node(&comp));
 
-        int idx = 0;
-        for (auto& comp : scc) {
-            for (NodeT *node : comp) {
+        for (unsigned idx = 0; idx < scc.size(); ++idx) {
+            auto& succs = nodes[idx].successors;
+            for (NodeT *node : scc[idx]) {
                 // we can get from this component
                 // to the component of succ
                 for (NodeT *succ : node->getSuccessors()) {
-                    unsigned succ_idx = succ->getSCCId();
-                    if ((int) succ_idx != idx)
-                        nodes[idx].addSuccessor(succ_idx);
+                    unsigned succ_idx = S.getSCCId(succ);
+                    if (succ_idx != idx && succ_idx != SCC<NodeT>::NONE)
+                        succs.push_back(succ_idx);
                 }
             }
 
-            ++idx;
+            std::sort(succs.begin(), succs.end());
+            succs.erase(std::unique(succs.begin(), succs.end()), succs.end());
+            for (unsigned s : succs)
+                nodes[s].predecessors.push_back(idx);
         }
     }
 
     SCCCondensation<NodeT>() = default;
-    SCCCondensation<NodeT>(SCC<NodeT>& S)
+    SCCCondensation<NodeT>(const SCC<NodeT>& S)
     {
-        compute(S.getSCC());
+        compute(S);
     }
+};
 
-    SCCCondensation<NodeT>(SCC_t& s)
-    {
-        compute(s);
+// Tarjan's algorithm for a graph given by the successors of its
+// vertices (indices) that need not have a starting vertex.
+// The components are stored in reverse topological order,
+// returns the index of the component of every vertex
+inline std::vector<unsigned>
+computeSCCs(const std::vector<std::vector<unsigned>>& succs,
+            std::vector<std::vector<unsigned>>& components)
+{
+    const unsigned NONE = ~0U;
+    std::vector<unsigned> comp_ids(succs.size(), NONE);
+    // 0 means not visited yet
+    std::vector<unsigned> dfs_id(succs.size(), 0);
+    std::vector<unsigned> lowpt(succs.size(), 0);
+    std::vector<char> on_stack(succs.size(), false);
+    std::vector<unsigned> stack;
+    std::vector<std::pair<unsigned, size_t>> dfs;
+    unsigned num = 0;
+
+    auto visit = [&](unsigned v) {
+        dfs_id[v] = lowpt[v] = ++num;
+        stack.push_back(v);
+        on_stack[v] = true;
+        dfs.emplace_back(v, 0);
+    };
+
+    for (unsigned root = 0; root < succs.size(); ++root) {
+        if (dfs_id[root] != 0)
+            continue;
+
+        visit(root);
+        while (!dfs.empty()) {
+            unsigned v = dfs.back().first;
+            if (dfs.back().second < succs[v].size()) {
+                unsigned s = succs[v][dfs.back().second++];
+                if (dfs_id[s] == 0)
+                    visit(s);
+                else if (on_stack[s])
+                    lowpt[v] = std::min(lowpt[v], dfs_id[s]);
+                continue;
+            }
+
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                unsigned parent = dfs.back().first;
+                lowpt[parent] = std::min(lowpt[parent], lowpt[v]);
+            }
+
+            if (lowpt[v] == dfs_id[v]) {
+                components.emplace_back();
+                unsigned w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    comp_ids[w] = components.size() - 1;
+                    components.back().push_back(w);
+                } while (w != v);
+            }
+        }
     }
-};
+
+    return comp_ids;
+}
 
 } // analysis
 } // dg
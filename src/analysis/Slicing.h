@@ -1,12 +1,21 @@
 #ifndef _DG_SLICING_H_
 #define _DG_SLICING_H_
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "NodesWalk.h"
+#include "Parallel.h"
 #include "BFS.h"
+#include "ADT/Bitvector.h"
 #include "ADT/Queue.h"
 #include "DependenceGraph.h"
+#include "SummaryEdges.h"
+#include "Tracepoints.h"
 
 #ifdef ENABLE_CFG
 #include "BBlock.h"
@@ -18,35 +27,62 @@ namespace dg {
 namespace analysis {
 
 // this class will go through the nodes
-// and will mark the ones that should be in the slice
-template <typename NodeT>
-class WalkAndMark : public NodesWalk<NodeT, QueueFIFO<NodeT *>>
+// and will mark the ones that should be in the slice.
+// It walks the edges backwards (the usual slice)
+// or FORWARD (the nodes affected by the start)
+template <typename NodeT, bool FORWARD = false>
+class WalkAndMark
+    : public NodesWalk<NodeT, QueueFIFO<NodeT *>,
+                       FORWARD ? (NODES_WALK_CD | NODES_WALK_DD)
+                               : (NODES_WALK_REV_CD | NODES_WALK_REV_DD)>
 {
 public:
-    WalkAndMark()
-        : NodesWalk<NodeT, QueueFIFO<NodeT *>>(NODES_WALK_REV_CD |
-                                               NODES_WALK_REV_DD) {}
-
     void mark(NodeT *start, uint32_t slice_id)
     {
         WalkData data(slice_id, this);
-        this->walk(start, markSlice, &data);
+        this->walk(start, MarkSlice(), &data);
+    }
+
+    void mark(const std::vector<NodeT *>& starts, uint32_t slice_id)
+    {
+        WalkData data(slice_id, this);
+        this->walk(starts, MarkSlice(), &data);
+    }
+
+    // mark the slice and put the marked nodes into @marked
+    void mark(NodeT *start, uint32_t slice_id, std::vector<NodeT *>& marked)
+    {
+        WalkData data(slice_id, this, &marked);
+        this->walk(start, MarkSlice(), &data);
     }
 
 private:
     struct WalkData
     {
-        WalkData(uint32_t si, WalkAndMark *wm)
-            : slice_id(si), analysis(wm) {}
+        WalkData(uint32_t si, WalkAndMark *wm,
+                 std::vector<NodeT *> *m = nullptr)
+            : slice_id(si), analysis(wm), marked(m) {}
 
         uint32_t slice_id;
         WalkAndMark *analysis;
+        std::vector<NodeT *> *marked;
+    };
+
+    // a functor, so that the walk calls it directly
+    struct MarkSlice {
+        void operator()(NodeT *n, WalkData *data) const
+        {
+            markSlice(n, data);
+        }
     };
 
     static void markSlice(NodeT *n, WalkData *data)
     {
         uint32_t slice_id = data->slice_id;
         n->setSlice(slice_id);
+        DG_TRACE2(slice_mark, n, slice_id);
+        if (data->marked)
+            data->marked->push_back(n);
 
 #ifdef ENABLE_CFG
         // when we marked a node, we need to mark even
@@ -67,7 +103,638 @@ private:
             // Now I need the correctness...
             NodeT *entry = dg->getEntry();
             assert(entry && "No entry node in dg");
-            data->analysis->enqueue(entry);
+            // everything in the graph depends on the entry,
+            // so the forward walk only keeps it
+            if (FORWARD)
+                entry->setSlice(slice_id);
+            else
+                data->analysis->enqueue(entry, WalkParents<NodeT>::ENTRY);
+        }
+    }
+};
+
+/// ------------------------------------------------------------------
+// - WalkAndMarkMulti
+//
+//   Marks the slices of more slicing criteria in one backward walk.
+//   Every node reached from the criteria gets a bitmask of the criteria
+//   in whose slices it is. The whole mask is propagated over the edges
+//   at once and a node is processed again only when its mask grew,
+//   so marking K slices is much cheaper than K runs of WalkAndMark.
+//   setSlice() then marks the nodes of one of the slices with a slice
+//   id (as WalkAndMark would), so that it can be sliced the usual way.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class WalkAndMarkMulti : public Analysis<NodeT>
+{
+    using WordT = uint64_t;
+    static const unsigned WORD_BITS = 64;
+
+    // the number of words of a mask
+    unsigned words = 0;
+    std::vector<NodeT *> nodes;
+    // the mask of nodes[i] is masks[i * words .. (i + 1) * words]
+    std::vector<WordT> masks;
+    // is nodes[i] in the queue?
+    std::vector<bool> queued;
+    QueueFIFO<unsigned> queue;
+    // the edges used by mark(), if set
+    FrozenGraph<NodeT> *frozen = nullptr;
+
+    int getIndex(NodeT *n)
+    {
+        unsigned id = this->getAnalysisData(n).maskid;
+        if (id == 0 || id > nodes.size() || nodes[id - 1] != n)
+            return -1;
+
+        return id - 1;
+    }
+
+    unsigned getOrAdd(NodeT *n)
+    {
+        int idx = getIndex(n);
+        if (idx >= 0)
+            return idx;
+
+        nodes.push_back(n);
+        masks.resize(masks.size() + words, 0);
+        queued.push_back(false);
+        this->getAnalysisData(n).maskid = nodes.size();
+        return nodes.size() - 1;
+    }
+
+    void enqueue(unsigned idx)
+    {
+        if (queued[idx])
+            return;
+
+        queued[idx] = true;
+        queue.push(idx);
+    }
+
+    // add the mask of @from to the mask of @n,
+    // queue @n if its mask grew
+    void propagate(unsigned from, NodeT *n)
+    {
+        if (!n)
+            return;
+
+        // getOrAdd() may reallocate the masks
+        unsigned to = getOrAdd(n);
+        const WordT *F = &masks[from * words];
+        WordT *T = &masks[to * words];
+
+        bool changed = false;
+        for (unsigned w = 0; w < words; ++w) {
+            if ((F[w] & ~T[w]) != 0) {
+                T[w] |= F[w];
+                changed = true;
+            }
+        }
+
+        if (changed)
+            enqueue(to);
+    }
+
+    // the same edges as WalkAndMark follows
+    void processEdges(unsigned idx)
+    {
+        NodeT *n = nodes[idx];
+
+        // keep the graph of the node, that is its entry
+        // and the call-sites (see WalkAndMark::markSlice)
+        if (DependenceGraph<NodeT> *dg = n->getDG())
+            propagate(idx, dg->getEntry());
+
+        int fidx = frozen ? frozen->getIndex(n) : -1;
+        if (fidx >= 0) {
+            using FrozenT = FrozenGraph<NodeT>;
+            for (auto kind : {FrozenT::REV_CD, FrozenT::REV_DD}) {
+                auto edges = frozen->getEdges(kind, fidx);
+                for (const unsigned *I = edges.first; I != edges.second; ++I)
+                    propagate(idx, frozen->getNode(*I));
+            }
+
+            return;
+        }
+
+        if (n->getDG())
+            n->getDG()->ensureDataDependencies();
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end(); I != E; ++I)
+            propagate(idx, *I);
+        for (auto I = n->rev_data_begin(), E = n->rev_data_end(); I != E; ++I)
+            propagate(idx, *I);
+
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *BB = n->getBBlock()) {
+            if (BB->getDG())
+                BB->getDG()->ensureControlDependencies();
+            for (BBlock<NodeT> *CD : BB->revControlDependence())
+                propagate(idx, CD->getLastNode());
+        }
+#endif
+    }
+
+    bool inSlice(unsigned idx, unsigned i) const
+    {
+        return (masks[idx * words + i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+public:
+    // walk the edges packed in @graph instead of the edges in nodes
+    void setFrozenGraph(FrozenGraph<NodeT> *graph) { frozen = graph; }
+
+    // mark the slices of the criteria, @criteria[i] are
+    // the nodes from which the slice i starts
+    void mark(const std::vector<std::vector<NodeT *>>& criteria)
+    {
+        clear();
+        words = (criteria.size() + WORD_BITS - 1) / WORD_BITS;
+
+        for (unsigned i = 0; i < criteria.size(); ++i) {
+            for (NodeT *n : criteria[i]) {
+                unsigned idx = getOrAdd(n);
+                masks[idx * words + i / WORD_BITS] |= ((WordT) 1) << (i % WORD_BITS);
+                enqueue(idx);
+            }
+        }
+
+        while (!queue.empty()) {
+            unsigned idx = queue.pop();
+            queued[idx] = false;
+            ++this->statistics.processedNodes;
+
+            processEdges(idx);
+        }
+    }
+
+    // is @n in the slice of the criterion @i?
+    bool inSlice(NodeT *n, unsigned i)
+    {
+        int idx = getIndex(n);
+        return idx >= 0 && inSlice(idx, i);
+    }
+
+    // set @slice_id to the nodes in the slice of the criterion @i
+    // and to their blocks and graphs. Returns the number of the nodes
+    size_t setSlice(unsigned i, uint32_t slice_id) const
+    {
+        size_t num = 0;
+        for (unsigned idx = 0; idx < nodes.size(); ++idx) {
+            if (!inSlice(idx, i))
+                continue;
+
+            NodeT *n = nodes[idx];
+            n->setSlice(slice_id);
+            DG_TRACE2(slice_mark, n, slice_id);
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *B = n->getBBlock())
+                B->setSlice(slice_id);
+#endif
+            if (DependenceGraph<NodeT> *dg = n->getDG())
+                dg->setSlice(slice_id);
+
+            ++num;
+        }
+
+        return num;
+    }
+
+    // the number of the nodes in some of the slices
+    size_t size() const { return nodes.size(); }
+
+    void clear()
+    {
+        for (NodeT *n : nodes)
+            this->getAnalysisData(n).maskid = 0;
+
+        nodes.clear();
+        masks.clear();
+        queued.clear();
+    }
+};
+
+/// ------------------------------------------------------------------
+// - SliceCache
+//
+//   The slices of single criteria kept as bit vectors over the ids
+//   of the nodes. The slice of more criteria is the union of the slices
+//   of the single criteria, so when the same graph is sliced again
+//   with some more criteria, only the new criteria must be walked.
+//   The cache is valid only while the graph does not change (slicing
+//   the graph removes the nodes, so clear the cache then).
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class SliceCache
+{
+    std::unordered_map<NodeT *, ADT::Bitvector> slices;
+    // the nodes of the cached slices indexed by their ids
+    std::vector<NodeT *> nodes;
+
+public:
+    bool contains(NodeT *crit) const { return slices.count(crit) > 0; }
+
+    // keep @marked as the slice of @crit
+    void add(NodeT *crit, const std::vector<NodeT *>& marked)
+    {
+        unsigned maxID = 0;
+        for (NodeT *n : marked)
+            maxID = std::max(maxID, n->getID());
+
+        if (nodes.size() <= maxID)
+            nodes.resize(maxID + 1, nullptr);
+
+        ADT::Bitvector& slice = slices[crit];
+        slice = ADT::Bitvector(maxID + 1);
+        for (NodeT *n : marked) {
+            nodes[n->getID()] = n;
+            slice.set(n->getID());
+        }
+    }
+
+    // the union of the slices of @criteria, they must be in the cache.
+    // The bits are the ids of the nodes (see getNode())
+    ADT::Bitvector getUnion(const std::vector<NodeT *>& criteria) const
+    {
+        ADT::Bitvector result(nodes.size());
+        for (NodeT *crit : criteria) {
+            auto it = slices.find(crit);
+            assert(it != slices.end() && "The slice is not cached");
+
+            if (it->second.size() == result.size()) {
+                result.unionWith(it->second);
+            } else {
+                ADT::Bitvector slice = it->second;
+                slice.resize(result.size());
+                result.unionWith(slice);
+            }
+        }
+
+        return result;
+    }
+
+    NodeT *getNode(size_t id) const { return nodes[id]; }
+
+    // the number of the cached slices
+    size_t size() const { return slices.size(); }
+
+    void clear()
+    {
+        slices.clear();
+        nodes.clear();
+    }
+};
+
+/// ------------------------------------------------------------------
+// - ParallelWalkAndMark
+//
+//   Marks the same slice as WalkAndMark, but walks the edges of
+//   a frozen graph level by level with more threads. The nodes of
+//   a level are split among the threads, every thread claims the
+//   unvisited neighbours with an atomic flag and collects them
+//   into its part of the next level. The nodes, their blocks and
+//   graphs get the slice id in one sweep after the walk, so the
+//   threads do not write into the graph at all.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class ParallelWalkAndMark : public Analysis<NodeT>
+{
+    using FrozenT = FrozenGraph<NodeT>;
+
+    FrozenT *frozen;
+    unsigned threads;
+    // the index of the entry node of the graph of every
+    // frozen node, -1 if it is not in the frozen graph
+    std::vector<int> entries;
+
+    // smaller levels are processed by one thread,
+    // starting the threads would take longer
+    static const size_t MIN_PARALLEL_LEVEL = 1024;
+
+    static bool claim(std::vector<std::atomic<bool>>& visited, unsigned idx)
+    {
+        // do not write the flags that are set already
+        if (visited[idx].load(std::memory_order_relaxed))
+            return false;
+
+        return !visited[idx].exchange(true, std::memory_order_relaxed);
+    }
+
+    // process nodes level[from .. to] and put
+    // their unvisited neighbours into @next
+    void processLevel(const std::vector<unsigned>& level,
+                        size_t from, size_t to,
+                        std::vector<std::atomic<bool>>& visited,
+                        std::vector<unsigned>& next) const
+    {
+        for (size_t i = from; i < to; ++i) {
+            unsigned idx = level[i];
+
+            // keep the graph of the node (see WalkAndMark::markSlice)
+            int entry = entries[idx];
+            if (entry >= 0 && claim(visited, entry))
+                next.push_back(entry);
+
+            for (auto kind : {FrozenT::REV_CD, FrozenT::REV_DD}) {
+                auto edges = frozen->getEdges(kind, idx);
+                for (const unsigned *I = edges.first; I != edges.second; ++I) {
+                    if (claim(visited, *I))
+                        next.push_back(*I);
+                }
+            }
+        }
+    }
+
+public:
+    // @graph must be frozen after all the edges were computed
+    // and must not change while it is used for marking
+    ParallelWalkAndMark(FrozenT *graph, unsigned thr)
+        : frozen(graph), threads(thr == 0 ? 1 : thr)
+    {
+        entries.resize(frozen->size());
+        for (unsigned idx = 0; idx < frozen->size(); ++idx) {
+            DependenceGraph<NodeT> *dg = frozen->getNode(idx)->getDG();
+            NodeT *entry = dg ? dg->getEntry() : nullptr;
+            entries[idx] = entry ? frozen->getIndex(entry) : -1;
+        }
+    }
+
+    // can the walk from @n be done with this class?
+    bool canMark(NodeT *n) { return frozen->getIndex(n) >= 0; }
+
+    void mark(NodeT *start, uint32_t slice_id)
+    {
+        int sidx = frozen->getIndex(start);
+        assert(sidx >= 0 && "The start node is not frozen");
+
+        std::vector<std::atomic<bool>> visited(frozen->size());
+        std::vector<unsigned> level;
+        visited[sidx] = true;
+        level.push_back(sidx);
+
+        std::vector<std::vector<unsigned>> next(threads);
+        while (!level.empty()) {
+            unsigned thr = threads;
+            if (level.size() < MIN_PARALLEL_LEVEL)
+                thr = 1;
+
+            size_t chunk = (level.size() + thr - 1) / thr;
+            runThreads(thr, [&](unsigned t) {
+                size_t from = std::min(level.size(), t * chunk);
+                size_t to = std::min(level.size(), from + chunk);
+                processLevel(level, from, to, visited, next[t]);
+            });
+
+            this->statistics.processedNodes += level.size();
+
+            level.clear();
+            for (unsigned t = 0; t < thr; ++t) {
+                level.insert(level.end(), next[t].begin(), next[t].end());
+                next[t].clear();
+            }
+        }
+
+        for (unsigned idx = 0; idx < frozen->size(); ++idx) {
+            if (!visited[idx])
+                continue;
+
+            NodeT *n = frozen->getNode(idx);
+            n->setSlice(slice_id);
+            DG_TRACE2(slice_mark, n, slice_id);
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *B = n->getBBlock())
+                B->setSlice(slice_id);
+#endif
+            if (DependenceGraph<NodeT> *dg = n->getDG())
+                dg->setSlice(slice_id);
+        }
+    }
+};
+
+/// ------------------------------------------------------------------
+// - WalkAndMarkCS
+//
+//   Context-sensitive marking of the slice in two phases (Horwitz,
+//   Reps and Binkley). The first phase does not descend into the
+//   called graphs, it goes up to the callers and over the summary
+//   edges of the call-sites. The second phase starts from all the
+//   nodes of the first phase and descends into the called graphs,
+//   but does not go up to the callers again. Unlike WalkAndMark,
+//   a function in the slice does not pull in all its call-sites,
+//   only the ones from which the criteria are reachable.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class WalkAndMarkCS : public Analysis<NodeT>
+{
+    using SummaryT = SummaryEdges<NodeT>;
+
+    const SummaryT& summaries;
+    // the last phase in which the node was queued
+    std::unordered_map<NodeT *, unsigned> phases;
+    QueueFIFO<NodeT *> queue;
+    unsigned phase = 1;
+
+    void enqueue(NodeT *n)
+    {
+        if (!n)
+            return;
+
+        unsigned& ph = phases[n];
+        if (ph >= phase)
+            return;
+
+        ph = phase;
+        queue.push(n);
+    }
+
+    void enqueueEdge(NodeT *pred, NodeT *n)
+    {
+        auto kind = summaries.getKind(pred, n);
+        if (phase == 1 && kind == SummaryT::RETURN)
+            return;
+        if (phase == 2 && kind == SummaryT::CALL)
+            return;
+
+        enqueue(pred);
+    }
+
+    void process(NodeT *n, uint32_t slice_id)
+    {
+        ++this->statistics.processedNodes;
+
+        n->setSlice(slice_id);
+        DG_TRACE2(slice_mark, n, slice_id);
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *B = n->getBBlock())
+            B->setSlice(slice_id);
+#endif
+        // keep the graph and its entry, the call-sites
+        // are kept only in the first phase (see enqueueEdge)
+        if (DependenceGraph<NodeT> *dg = n->getDG()) {
+            dg->setSlice(slice_id);
+            dg->ensureDataDependencies();
+            enqueue(dg->getEntry());
+        }
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end(); I != E; ++I)
+            enqueueEdge(*I, n);
+        for (auto I = n->rev_data_begin(), E = n->rev_data_end(); I != E; ++I)
+            enqueueEdge(*I, n);
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *BB = n->getBBlock()) {
+            if (BB->getDG())
+                BB->getDG()->ensureControlDependencies();
+            for (BBlock<NodeT> *CD : BB->revControlDependence())
+                if (NodeT *last = CD->getLastNode())
+                    enqueueEdge(last, n);
+        }
+#endif
+        if (auto ais = summaries.getSummaries(n)) {
+            for (NodeT *ai : *ais)
+                enqueue(ai);
+        }
+    }
+
+    void run(uint32_t slice_id)
+    {
+        while (!queue.empty())
+            process(queue.pop(), slice_id);
+    }
+
+public:
+    // @summaries must be computed for the graph of the criteria
+    WalkAndMarkCS(const SummaryT& se) : summaries(se) {}
+
+    void mark(const std::vector<NodeT *>& starts, uint32_t slice_id)
+    {
+        phases.clear();
+        phase = 1;
+        for (NodeT *n : starts)
+            enqueue(n);
+        run(slice_id);
+
+        phase = 2;
+        std::vector<NodeT *> marked;
+        marked.reserve(phases.size());
+        for (auto& it : phases)
+            marked.push_back(it.first);
+        for (NodeT *n : marked)
+            enqueue(n);
+        run(slice_id);
+    }
+};
+
+/// ------------------------------------------------------------------
+// - WalkAndMarkThin
+//
+//   Marks the thin slice (Sridharan, Fink and Bodik): the data
+//   dependencies that only compute the address of an accessed memory
+//   (the base pointer of a load or a store, given by the predicate
+//   isBasePointer(use, def)) are not followed. The control dependencies
+//   are followed as by WalkAndMark, so the slice stays executable.
+//   The base pointer dependencies that were not followed can be
+//   expanded on demand: every expansion continues the thin slice
+//   from the definitions of the base pointers met so far.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class WalkAndMarkThin : public NodesWalk<NodeT, QueueFIFO<NodeT *>>
+{
+public:
+    // the edges are enqueued by markSlice()
+    WalkAndMarkThin() : NodesWalk<NodeT, QueueFIFO<NodeT *>>(NODES_WALK_NONE_EDGES) {}
+
+    // mark the thin slice of @starts and expand
+    // the base pointer dependencies @expand times
+    template <typename PredT>
+    void mark(const std::vector<NodeT *>& starts, uint32_t slice_id,
+              PredT isBasePointer, unsigned expand = 0)
+    {
+        WalkData<PredT> data(slice_id, this, isBasePointer);
+        std::vector<NodeT *> level = starts;
+        for (unsigned i = 0; ; ++i) {
+            unexpanded.clear();
+            this->walk(level, markSlice<PredT>, &data);
+
+            level.clear();
+            for (NodeT *n : unexpanded) {
+                if (n->getSlice() != slice_id)
+                    level.push_back(n);
+            }
+
+            std::sort(level.begin(), level.end(), NodeIDLess());
+            level.erase(std::unique(level.begin(), level.end()), level.end());
+
+            unexpanded.swap(level);
+            if (i == expand || unexpanded.empty())
+                break;
+        }
+    }
+
+    // the definitions of the base pointers that are not
+    // in the slice, because they were not expanded
+    const std::vector<NodeT *>& getUnexpanded() const { return unexpanded; }
+
+private:
+    std::vector<NodeT *> unexpanded;
+
+    template <typename PredT>
+    struct WalkData
+    {
+        WalkData(uint32_t si, WalkAndMarkThin *wm, PredT& pred)
+            : slice_id(si), analysis(wm), isBasePointer(pred) {}
+
+        uint32_t slice_id;
+        WalkAndMarkThin *analysis;
+        PredT& isBasePointer;
+    };
+
+    template <typename PredT>
+    static void markSlice(NodeT *n, WalkData<PredT> *data)
+    {
+        uint32_t slice_id = data->slice_id;
+        WalkAndMarkThin *wm = data->analysis;
+        n->setSlice(slice_id);
+        DG_TRACE2(slice_mark, n, slice_id);
+
+        // the nodes marked by the previous expansions
+        // were processed already
+        auto enqueue = [wm, slice_id](NodeT *dep) {
+            if (dep->getSlice() != slice_id)
+                wm->enqueue(dep);
+        };
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end(); I != E; ++I)
+            enqueue(*I);
+
+        if (n->getDG())
+            n->getDG()->ensureDataDependencies();
+
+        for (auto I = n->rev_data_begin(), E = n->rev_data_end(); I != E; ++I) {
+            if (data->isBasePointer(n, *I))
+                wm->unexpanded.push_back(*I);
+            else
+                enqueue(*I);
+        }
+
+#ifdef ENABLE_CFG
+        // see WalkAndMark::markSlice() and NodesWalk::processBBlockRevCDs()
+        BBlock<NodeT> *B = n->getBBlock();
+        if (B) {
+            B->setSlice(slice_id);
+            if (B->getDG())
+                B->getDG()->ensureControlDependencies();
+            for (BBlock<NodeT> *CD : B->revControlDependence())
+                enqueue(CD->getLastNode());
+        }
+#endif
+
+        DependenceGraph<NodeT> *dg = n->getDG();
+        if (dg) {
+            dg->setSlice(slice_id);
+            NodeT *entry = dg->getEntry();
+            assert(entry && "No entry node in dg");
+            enqueue(entry);
         }
     }
 };
@@ -91,20 +758,50 @@ class Slicer : Analysis<NodeT>
 {
     uint32_t options;
     uint32_t slice_id;
+    // the edges used by mark(), if set
+    FrozenGraph<NodeT> *frozen = nullptr;
+    // the slices marked by markMulti()
+    WalkAndMarkMulti<NodeT> multi;
+    // the number of threads used by mark() with a frozen graph
+    unsigned mark_threads = 1;
+    // the slices of single criteria used by markCached()
+    SliceCache<NodeT> cache;
 
+    // slice the graph and all the graphs called from it. Every graph
+    // is sliced only once, no matter from how many call-sites
+    // it is called (or if it is called recursively)
     void sliceGraph(DependenceGraph<NodeT> *dg, uint32_t slice_id)
     {
-        for (auto& it : *dg) {
-            NodeT *n = it.second;
+        // gather the graphs first, slicing a graph
+        // removes the call-sites from which we find the subgraphs
+        std::set<DependenceGraph<NodeT> *> visited;
+        std::vector<DependenceGraph<NodeT> *> graphs;
+        visited.insert(dg);
+        graphs.push_back(dg);
 
-            // slice subgraphs if this node is a call-site
-            for (DependenceGraph<NodeT> *sub : n->getSubgraphs())
-                sliceGraph(sub, slice_id);
+        for (size_t i = 0; i < graphs.size(); ++i) {
+            for (auto& it : *graphs[i]) {
+                for (DependenceGraph<NodeT> *sub : it.second->getSubgraphs()) {
+                    if (visited.insert(sub).second)
+                        graphs.push_back(sub);
+                }
+            }
+        }
+
+        std::vector<NodeT *> toRemove;
+        for (DependenceGraph<NodeT> *graph : graphs) {
+            // deleting the nodes while iterating over
+            // the graph would invalidate the iterator
+            toRemove.clear();
+            for (auto& it : *graph) {
+                if (it.second->getSlice() != slice_id)
+                    toRemove.push_back(it.second);
+            }
 
-            if (n->getSlice() != slice_id) {
+            for (NodeT *n : toRemove) {
                 // do graph specific logic
                 if (removeNode(n))
-                    dg->deleteNode(n);
+                    graph->deleteNode(n);
             }
         }
 
@@ -123,17 +820,205 @@ public:
     SlicerStatistics& getStatistics() { return statistics; }
     const SlicerStatistics& getStatistics() const { return statistics; }
 
+    // mark the slices by walking the edges of @graph,
+    // it must be frozen after all the edges were computed
+    void setFrozenGraph(FrozenGraph<NodeT> *graph) { frozen = graph; }
+
+    // mark the slice using @n threads when the frozen graph is set
+    // (see ParallelWalkAndMark). Default is 1 (mark sequentially)
+    void setMarkThreads(unsigned n) { mark_threads = n; }
+
     uint32_t mark(NodeT *start, uint32_t sl_id = 0)
     {
         if (sl_id == 0)
             sl_id = ++slice_id;
 
+        if (frozen && mark_threads > 1) {
+            ParallelWalkAndMark<NodeT> pwm(frozen, mark_threads);
+            if (pwm.canMark(start)) {
+                pwm.mark(start, sl_id);
+                return sl_id;
+            }
+        }
+
         WalkAndMark<NodeT> wm;
+        wm.setFrozenGraph(frozen);
         wm.mark(start, sl_id);
 
         return sl_id;
     }
 
+    // mark the slice of @starts as mark() does and record into @parents
+    // how every node of the slice was reached (see WalkParents)
+    uint32_t markWithParents(const std::vector<NodeT *>& starts,
+                             WalkParents<NodeT>& parents, uint32_t sl_id = 0)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        WalkAndMark<NodeT> wm;
+        wm.setFrozenGraph(frozen);
+        wm.setParents(&parents);
+        wm.mark(starts, sl_id);
+
+        return sl_id;
+    }
+
+    // mark the forward slice of @starts: the nodes that
+    // depend on them (transitively)
+    uint32_t markForward(const std::vector<NodeT *>& starts, uint32_t sl_id = 0)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        WalkAndMark<NodeT, true /* forward */> wm;
+        wm.setFrozenGraph(frozen);
+        wm.mark(starts, sl_id);
+
+        return sl_id;
+    }
+
+    // mark the thin slice of @starts (see WalkAndMarkThin), the definitions
+    // of the base pointers that were not expanded are put into @unexpanded
+    template <typename PredT>
+    uint32_t markThin(const std::vector<NodeT *>& starts, PredT isBasePointer,
+                      unsigned expand = 0, uint32_t sl_id = 0,
+                      std::vector<NodeT *> *unexpanded = nullptr)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        WalkAndMarkThin<NodeT> wm;
+        wm.mark(starts, sl_id, isBasePointer, expand);
+        if (unexpanded)
+            *unexpanded = wm.getUnexpanded();
+
+        return sl_id;
+    }
+
+    // mark the chop of @sources and @sinks: the nodes that depend
+    // on some of the sources and some of the sinks depend on them.
+    // The forward walk from the sources marks the nodes with
+    // an auxiliary slice id, the backward walk from the sinks then
+    // takes the nodes with this id
+    uint32_t chop(const std::vector<NodeT *>& sources,
+                  const std::vector<NodeT *>& sinks, uint32_t sl_id = 0)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        struct ChopData {
+            uint32_t forward_id;
+            std::vector<NodeT *> nodes;
+        } data;
+        data.forward_id = ++slice_id;
+        assert(data.forward_id != sl_id);
+
+        NodesWalk<NodeT, QueueFIFO<NodeT *>,
+                  NODES_WALK_CD | NODES_WALK_DD> fw;
+        fw.setFrozenGraph(frozen);
+        fw.walk(sources, [](NodeT *n, ChopData *d) {
+                            n->setSlice(d->forward_id);
+                         }, &data);
+
+        NodesWalk<NodeT, QueueFIFO<NodeT *>,
+                  NODES_WALK_REV_CD | NODES_WALK_REV_DD> bw;
+        bw.setFrozenGraph(frozen);
+        bw.walk(sinks, [](NodeT *n, ChopData *d) {
+                          if (n->getSlice() == d->forward_id)
+                              d->nodes.push_back(n);
+                       }, &data);
+
+        for (NodeT *n : data.nodes) {
+            n->setSlice(sl_id);
+            DG_TRACE2(slice_mark, n, sl_id);
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *B = n->getBBlock())
+                B->setSlice(sl_id);
+#endif
+            if (DependenceGraph<NodeT> *dg = n->getDG()) {
+                dg->setSlice(sl_id);
+                if (NodeT *entry = dg->getEntry())
+                    entry->setSlice(sl_id);
+            }
+        }
+
+        return sl_id;
+    }
+
+    // mark the slice of @starts context-sensitively (see WalkAndMarkCS)
+    // using the summary edges computed for the graph
+    uint32_t markContextSensitive(const std::vector<NodeT *>& starts,
+                                  const SummaryEdges<NodeT>& summaries,
+                                  uint32_t sl_id = 0)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        WalkAndMarkCS<NodeT> wm(summaries);
+        wm.mark(starts, sl_id);
+
+        return sl_id;
+    }
+
+    // mark the slices of more criteria in one walk (see WalkAndMarkMulti),
+    // @criteria[i] are the nodes from which the slice i starts.
+    // The slice i is then selected by markCriterion(i)
+    void markMulti(const std::vector<std::vector<NodeT *>>& criteria)
+    {
+        multi.setFrozenGraph(frozen);
+        multi.mark(criteria);
+    }
+
+    // give the nodes in the slice of the criterion @i from the last
+    // markMulti() the slice id @sl_id (or a new one if it is 0)
+    uint32_t markCriterion(unsigned i, uint32_t sl_id = 0)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        multi.setSlice(i, sl_id);
+        return sl_id;
+    }
+
+    // mark the slice of all the @criteria as mark() would, but take
+    // the slices of the criteria that were marked by markCached()
+    // before from the cache and walk only from the new criteria.
+    // The graph must not change between the calls (see SliceCache)
+    uint32_t markCached(const std::vector<NodeT *>& criteria, uint32_t sl_id = 0)
+    {
+        if (sl_id == 0)
+            sl_id = ++slice_id;
+
+        for (NodeT *crit : criteria) {
+            if (cache.contains(crit))
+                continue;
+
+            std::vector<NodeT *> marked;
+            WalkAndMark<NodeT> wm;
+            wm.setFrozenGraph(frozen);
+            wm.mark(crit, sl_id, marked);
+            cache.add(crit, marked);
+        }
+
+        cache.getUnion(criteria).forEach([this, sl_id](size_t id) {
+            NodeT *n = cache.getNode(id);
+            n->setSlice(sl_id);
+            DG_TRACE2(slice_mark, n, sl_id);
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *B = n->getBBlock())
+                B->setSlice(sl_id);
+#endif
+            if (DependenceGraph<NodeT> *dg = n->getDG())
+                dg->setSlice(sl_id);
+        });
+
+        return sl_id;
+    }
+
+    // forget the slices cached by markCached()
+    void clearSliceCache() { cache.clear(); }
+
     uint32_t slice(NodeT *start, uint32_t sl_id = 0)
     {
         // for now it will does the same as mark,
@@ -182,6 +1067,13 @@ public:
         RemoveBlockData data = { sl_id, blocks };
         bfs.run(start, getBlocksToRemove, data);
 
+        removeBlocks(std::vector<BBlock<NodeT> *>(blocks.begin(), blocks.end()));
+    }
+
+    // remove the @blocks from their graphs. The handlers see the blocks
+    // with all their edges, then the blocks go away at once
+    void removeBlocks(const std::vector<BBlock<NodeT> *>& blocks)
+    {
         for (BBlock<NodeT> *blk : blocks) {
             // update statistics
             statistics.nodesRemoved += blk->size();
@@ -190,10 +1082,9 @@ public:
 
             // call specific handlers (overriden by child class)
             removeBlock(blk);
-
-            // remove block from the graph
-            blk->remove();
         }
+
+        BBlock<NodeT>::removeBlocks(blocks);
     }
 
     // remove BBlocks that contain no node that should be in
@@ -204,27 +1095,15 @@ public:
 #ifdef DEBUG_ENABLED
         uint32_t blocksNum = CB.size();
 #endif
-        // gather the blocks
-        // FIXME: we don't need two loops, just go carefully
-        // through the constructed blocks (keep temporary always-valid iterator)
-        std::set<BBlock<NodeT> *> blocks;
+        // gather the blocks (every block is in the map only once),
+        // removing them changes the map
+        std::vector<BBlock<NodeT> *> blocks;
         for (auto& it : CB) {
             if (it.second->getSlice() != sl_id)
-                blocks.insert(it.second);
+                blocks.push_back(it.second);
         }
 
-        for (BBlock<NodeT> *blk : blocks) {
-            // update statistics
-            statistics.nodesRemoved += blk->size();
-            statistics.nodesTotal += blk->size();
-            ++statistics.blocksRemoved;
-
-            // call specific handlers (overriden by child class)
-            removeBlock(blk);
-
-            // remove block from the graph
-            blk->remove();
-        }
+        removeBlocks(blocks);
 
 #ifdef DEBUG_ENABLED
         assert(CB.size() + blocks.size() == blocksNum &&
@@ -4,16 +4,19 @@
 // This file defines a basis for nodes from
 // PointerSubgraph and reaching definitions subgraph.
 
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
+#include "ADT/SmallPtrVector.h"
+
 namespace dg {
 namespace analysis {
 
 template <typename NodeT>
 class SubgraphNode {
-    // data that can an analysis store in node
-    // for its own needs
-    void *data;
+    // NOTE: the analyses keep their data of the nodes in their own
+    // tables indexed by the ids of the nodes (see NodeTable.h)
 
     // data that can user store in the node
     // NOTE: I considered if this way is better than
@@ -24,54 +27,60 @@ class SubgraphNode {
     // than one pointer, we can change this design.
     void *user_data;
 
+    // unique id of the node. The ids are given in the order in which
+    // the nodes are created (starting from 1), so they are dense
+    // and the same in every run. The analyses can use them to index
+    // vectors instead of keeping maps keyed by the pointers to nodes
+    unsigned int id;
+    static std::atomic<unsigned int> lastID;
+
+    // bumped whenever an edge between the nodes of this type changes,
+    // so that the graphs can tell whether the orders of the nodes
+    // they computed before are still valid
+    static std::atomic<unsigned long> edgesVersion;
+
+    static void edgesChanged()
+    {
+        edgesVersion.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    // most of the nodes have one or two successors, predecessors
+    // and operands, so keep them inline in the node
+    using EdgesT = ADT::SmallPtrVector<NodeT *, 2>;
+
 protected:
     // XXX: make those private?
-    std::vector<NodeT *> successors;
-    std::vector<NodeT *> predecessors;
-    // XXX: maybe we could use SmallPtrVector or something like that
-    std::vector<NodeT *> operands;
+    EdgesT successors;
+    EdgesT predecessors;
+    EdgesT operands;
 
     // size of the memory
     size_t size;
-public:
-    // FIXME: make this private, this is just for debugging
-    /// for computing SCC
-    //XXX: we could do this more generic
-    // the dfs order
-    unsigned int dfs_id;
-    unsigned int lowpt;
-
-    // id of scc component
-    unsigned int scc_id;
-    // true if the node is on stack
-    bool on_stack;
 
+    // the graphs may give their nodes other ids (a permutation
+    // of the ids of the nodes) before any analysis runs
+    void setID(unsigned int i) { id = i; }
+
+public:
     SubgraphNode<NodeT>()
-    : data(nullptr), user_data(nullptr), size(0),
-      dfs_id(0), lowpt(0), scc_id(0), on_stack(false)
+    : user_data(nullptr), id(++lastID), size(0)
     {}
 
-    void setSize(size_t s) { size = s; }
-    size_t getSize() const { return size; }
+    unsigned int getID() const { return id; }
+    // the largest id given to a node of this type so far,
+    // the side tables indexed by the ids need getLastID() + 1 elements
+    static unsigned int getLastID() { return lastID; }
 
-    unsigned getSCCId() const
+    // changes every time an edge between the nodes of this type
+    // is added or removed (in any graph)
+    static unsigned long getEdgesVersion()
     {
-        return scc_id;
+        return edgesVersion.load(std::memory_order_relaxed);
     }
 
-    // getters & setters for analysis's data in the node
-    template <typename T>
-    T* getData() { return static_cast<T *>(data); }
-    template <typename T>
-    const T* getData() const { return static_cast<T *>(data); }
-
-    template <typename T>
-    void *setData(T *newdata)
-    {
-        void *old = data;
-        data = static_cast<void *>(newdata);
-        return old;
-    }
+    void setSize(size_t s) { size = s; }
+    size_t getSize() const { return size; }
 
     // getters & setters for user's data in the node
     template <typename T>
@@ -100,6 +109,15 @@ public:
         return operands.size();
     }
 
+    // the memory allocated on the heap for the edges and operands
+    // of the node (the short lists are kept inline in the node)
+    size_t getEdgesAllocatedBytes() const
+    {
+        return successors.getAllocatedBytes()
+                + predecessors.getAllocatedBytes()
+                + operands.getAllocatedBytes();
+    }
+
     size_t addOperand(NodeT *n)
     {
         assert(n && "Passed nullptr as the operand");
@@ -112,21 +130,22 @@ public:
         assert(succ && "Passed nullptr as the successor");
         successors.push_back(succ);
         succ->predecessors.push_back(static_cast<NodeT *>(this));
+        edgesChanged();
     }
 
     // return const only, so that we cannot change them
     // other way then addSuccessor()
-    const std::vector<NodeT *>& getSuccessors() const
+    const EdgesT& getSuccessors() const
     {
         return successors;
     }
 
-    const std::vector<NodeT *>& getPredecessors() const
+    const EdgesT& getPredecessors() const
     {
         return predecessors;
     }
 
-    const std::vector<NodeT *>& getOperands() const
+    const EdgesT& getOperands() const
     {
         return operands;
     }
@@ -143,7 +162,7 @@ public:
 
         // we need to remove this node from
         // successor's predecessors
-        std::vector<NodeT *> tmp;
+        EdgesT tmp;
         tmp.reserve(old->predecessorsNum() - 1);
         for (NodeT *p : old->predecessors)
             tmp.push_back(p);
@@ -175,6 +194,7 @@ public:
 
         // take over successors
         successors.swap(n->successors);
+        edgesChanged();
 
         // make this node the successor of n
         n->addSuccessor(static_cast<NodeT *>(this));
@@ -198,6 +218,7 @@ public:
 
         // take over predecessors
         predecessors.swap(n->predecessors);
+        edgesChanged();
 
         // 'n' is a successors of this node
         addSuccessor(n);
@@ -223,6 +244,7 @@ public:
         // this also clears 'this->predecessors' since seq.first
         // has no predecessors
         predecessors.swap(seq.first->predecessors);
+        edgesChanged();
 
         // replace the reference to 'this' in predecessors
         for (NodeT *pred : seq.first->predecessors) {
@@ -236,6 +258,27 @@ public:
         seq.second->addSuccessor(this);
     }
 
+    // remove all the edges from and to this node
+    void isolate()
+    {
+        NodeT *self = static_cast<NodeT *>(this);
+        for (NodeT *succ : successors) {
+            auto& preds = succ->predecessors;
+            preds.erase(std::remove(preds.begin(), preds.end(), self),
+                        preds.end());
+        }
+
+        for (NodeT *pred : predecessors) {
+            auto& succs = pred->successors;
+            succs.erase(std::remove(succs.begin(), succs.end(), self),
+                        succs.end());
+        }
+
+        successors.clear();
+        predecessors.clear();
+        edgesChanged();
+    }
+
     size_t predecessorsNum() const
     {
         return predecessors.size();
@@ -247,6 +290,12 @@ public:
     }
 };
 
+template <typename NodeT>
+std::atomic<unsigned int> SubgraphNode<NodeT>::lastID{0};
+
+template <typename NodeT>
+std::atomic<unsigned long> SubgraphNode<NodeT>::edgesVersion{0};
+
 } // analysis
 } // dg
 #endif // _SUBGRAPH_NODE_H_
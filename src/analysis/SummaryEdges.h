@@ -0,0 +1,300 @@
+#ifndef _DG_SUMMARY_EDGES_H_
+#define _DG_SUMMARY_EDGES_H_
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ADT/Queue.h"
+#include "DependenceGraph.h"
+#include "DGParameters.h"
+
+#ifdef ENABLE_CFG
+#include "BBlock.h"
+#endif
+
+namespace dg {
+namespace analysis {
+
+/// ------------------------------------------------------------------
+// - SummaryEdges
+//
+//   The summary edges of call-sites (Horwitz, Reps and Binkley).
+//   An actual output parameter of a call-site (or the call-site
+//   itself for the returned value) depends on an actual input
+//   parameter if the formal output parameter (or the exit node)
+//   of the called graph depends on the formal input parameter
+//   through the nodes of the graph and the summary edges of the
+//   call-sites in it. The edges are computed with the worklist
+//   algorithm of Reps et al. and are kept aside from the graph,
+//   WalkAndMarkCS uses them to slice context-sensitively.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class SummaryEdges
+{
+public:
+    using DGT = DependenceGraph<NodeT>;
+
+    enum EdgeKind {
+        // an edge inside a graph (or between global nodes and a graph)
+        INTRA,
+        // from a call-site or an actual input parameter
+        // to the entry or a formal input parameter of the called graph
+        CALL,
+        // from the exit or a formal output parameter of the called graph
+        // to the call-site or an actual output parameter
+        RETURN
+    };
+
+    // compute the summary edges of the call-sites in @dg
+    // and in the graphs called from it
+    void compute(DGT *dg)
+    {
+        clear();
+
+        std::vector<DGT *> graphs;
+        std::set<DGT *> visited;
+        graphs.push_back(dg);
+        visited.insert(dg);
+        for (size_t i = 0; i < graphs.size(); ++i) {
+            DGT *graph = graphs[i];
+            addFormalParameters(graph);
+
+            for (auto& it : *graph) {
+                NodeT *n = it.second;
+                if (!n->hasSubgraphs())
+                    continue;
+
+                addActualParameters(n);
+                for (DGT *sub : n->getSubgraphs()) {
+                    if (visited.insert(sub).second)
+                        graphs.push_back(sub);
+                }
+            }
+        }
+
+        for (NodeT *fo : formalOuts)
+            propagate(fo, fo);
+
+        while (!queue.empty()) {
+            auto edge = queue.pop();
+            NodeT *n = edge.first;
+            NodeT *fo = edge.second;
+
+            if (formalIns.count(n) > 0)
+                addSummaryEdges(n, fo);
+
+            for (auto I = n->rev_control_begin(), E = n->rev_control_end(); I != E; ++I)
+                propagateIntra(*I, n, fo);
+            if (n->getDG())
+                n->getDG()->ensureDataDependencies();
+            for (auto I = n->rev_data_begin(), E = n->rev_data_end(); I != E; ++I)
+                propagateIntra(*I, n, fo);
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *BB = n->getBBlock()) {
+                if (BB->getDG())
+                    BB->getDG()->ensureControlDependencies();
+                for (BBlock<NodeT> *CD : BB->revControlDependence())
+                    if (NodeT *last = CD->getLastNode())
+                        propagateIntra(last, n, fo);
+            }
+#endif
+            auto it = summaries.find(n);
+            if (it != summaries.end()) {
+                for (NodeT *ai : it->second)
+                    propagate(ai, fo);
+            }
+        }
+
+        reaches.clear();
+    }
+
+    // the kind of the edge @from -> @to
+    EdgeKind getKind(NodeT *from, NodeT *to) const
+    {
+        if (from->getDG() == to->getDG())
+            return INTRA;
+
+        DGT *toDG = to->getDG();
+        if ((to == toDG->getEntry() || formalIns.count(to) > 0)
+            && (isCallOf(from, toDG) || isActualOf(from, toDG)))
+            return CALL;
+
+        DGT *fromDG = from->getDG();
+        if (formalOuts.count(from) > 0
+            && (isCallOf(to, fromDG) || isActualOf(to, fromDG)))
+            return RETURN;
+
+        return INTRA;
+    }
+
+    // the actual input parameters the node depends on
+    // through the summary edges, nullptr if there are none
+    const std::vector<NodeT *> *getSummaries(NodeT *n) const
+    {
+        auto it = summaries.find(n);
+        return it == summaries.end() ? nullptr : &it->second;
+    }
+
+    size_t size() const
+    {
+        size_t num = 0;
+        for (const auto& it : summaries)
+            num += it.second.size();
+        return num;
+    }
+
+    void clear()
+    {
+        formalIns.clear();
+        formalOuts.clear();
+        actualCall.clear();
+        summaries.clear();
+        reaches.clear();
+    }
+
+private:
+    // formal input parameters of the graphs
+    std::unordered_set<NodeT *> formalIns;
+    // formal output parameters and the exit nodes of the graphs
+    std::unordered_set<NodeT *> formalOuts;
+    // actual parameter -> its call-site
+    std::unordered_map<NodeT *, NodeT *> actualCall;
+    // actual output parameter (or call-site) -> actual input parameters
+    std::unordered_map<NodeT *, std::vector<NodeT *>> summaries;
+
+    // the formal outputs (or exits) that the node reaches in its graph
+    // (the path edges of the algorithm), used only by compute()
+    std::unordered_map<NodeT *, std::unordered_set<NodeT *>> reaches;
+    ADT::QueueFIFO<std::pair<NodeT *, NodeT *>> queue;
+
+    bool isCallOf(NodeT *n, DGT *graph) const
+    {
+        for (DGT *sub : n->getSubgraphs()) {
+            if (sub == graph)
+                return true;
+        }
+
+        return false;
+    }
+
+    bool isActualOf(NodeT *n, DGT *graph) const
+    {
+        auto it = actualCall.find(n);
+        return it != actualCall.end() && isCallOf(it->second, graph);
+    }
+
+    void addFormalParameters(DGT *graph)
+    {
+        if (NodeT *exit = graph->getExit())
+            formalOuts.insert(exit);
+
+        DGParameters<NodeT> *params = graph->getParameters();
+        if (!params)
+            return;
+
+        auto add = [this](DGParameter<NodeT>& p) {
+            if (p.in)
+                formalIns.insert(p.in);
+            if (p.out)
+                formalOuts.insert(p.out);
+        };
+
+        for (auto& it : *params)
+            add(it.second);
+        for (auto I = params->global_begin(), E = params->global_end(); I != E; ++I)
+            add(I->second);
+        if (DGParameter<NodeT> *vararg = params->getVarArg())
+            add(*vararg);
+    }
+
+    void addActualParameters(NodeT *callNode)
+    {
+        DGParameters<NodeT> *params = callNode->getParameters();
+        if (!params)
+            return;
+
+        auto add = [this, callNode](DGParameter<NodeT>& p) {
+            if (p.in)
+                actualCall[p.in] = callNode;
+            if (p.out)
+                actualCall[p.out] = callNode;
+        };
+
+        for (auto& it : *params)
+            add(it.second);
+        for (auto I = params->global_begin(), E = params->global_end(); I != E; ++I)
+            add(I->second);
+        if (DGParameter<NodeT> *vararg = params->getVarArg())
+            add(*vararg);
+    }
+
+    // @n reaches the formal output @fo
+    void propagate(NodeT *n, NodeT *fo)
+    {
+        if (reaches[n].insert(fo).second)
+            queue.push(std::make_pair(n, fo));
+    }
+
+    // the summary edges cover the edges between graphs
+    void propagateIntra(NodeT *pred, NodeT *n, NodeT *fo)
+    {
+        if (pred->getDG() == n->getDG())
+            propagate(pred, fo);
+    }
+
+    // the actual output of the formal output @fo at the call-site
+    NodeT *getActualOut(NodeT *callNode, NodeT *fo) const
+    {
+        if (fo == fo->getDG()->getExit())
+            return callNode;
+
+        for (auto I = fo->data_begin(), E = fo->data_end(); I != E; ++I) {
+            auto it = actualCall.find(*I);
+            if (it != actualCall.end() && it->second == callNode)
+                return *I;
+        }
+
+        return nullptr;
+    }
+
+    // the formal input @fi reaches the formal output @fo,
+    // add the summary edges to all the call-sites of the graph
+    void addSummaryEdges(NodeT *fi, NodeT *fo)
+    {
+        for (auto I = fi->rev_data_begin(), E = fi->rev_data_end(); I != E; ++I) {
+            NodeT *ai = *I;
+            auto it = actualCall.find(ai);
+            if (it == actualCall.end())
+                continue;
+
+            NodeT *ao = getActualOut(it->second, fo);
+            if (!ao)
+                continue;
+
+            auto& edges = summaries[ao];
+            if (std::find(edges.begin(), edges.end(), ai) != edges.end())
+                continue;
+
+            edges.push_back(ai);
+
+            // what the actual output reaches is reached
+            // by the actual input now too
+            auto rit = reaches.find(ao);
+            if (rit == reaches.end())
+                continue;
+
+            std::vector<NodeT *> outs(rit->second.begin(), rit->second.end());
+            for (NodeT *fo2 : outs)
+                propagate(ai, fo2);
+        }
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_SUMMARY_EDGES_H_
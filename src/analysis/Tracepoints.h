@@ -0,0 +1,41 @@
+#ifndef _DG_ANALYSIS_TRACEPOINTS_H_
+#define _DG_ANALYSIS_TRACEPOINTS_H_
+
+///
+// Static tracepoints (USDT probes of the provider "dg") in the hot loops
+// of the analyses, so that perf, bpftrace or SystemTap can attach to
+// a running llvm-slicer and measure the phases without recompiling, e.g.:
+//
+//   bpftrace -e 'usdt:./llvm-slicer:dg:pta_node_begin { @t[tid] = nsecs; }
+//                usdt:./llvm-slicer:dg:pta_node_end /@t[tid]/ {
+//                    @ns = hist(nsecs - @t[tid]); delete(@t[tid]); }'
+//
+// The probes are compiled in only with -DENABLE_TRACEPOINTS=ON (needs
+// sys/sdt.h), otherwise the macros expand to nothing, so the arguments
+// are not even evaluated. A compiled-in probe that is not attached is
+// a single nop. The probes and their arguments:
+//
+//   pta_round_begin(round), pta_round_end(round)
+//   pta_node_begin(PSNode *, type), pta_node_end(PSNode *, changed)
+//   pta_memory_object(PSNode *target)
+//   rd_merge_begin(RDNode *), rd_merge_end(RDNode *, changed)
+//   du_edge(LLVMNode *def, LLVMNode *use)
+//   slice_mark(node, slice id)
+
+#ifdef ENABLE_TRACEPOINTS
+
+#include <sys/sdt.h>
+
+#define DG_TRACE0(name) DTRACE_PROBE(dg, name)
+#define DG_TRACE1(name, a) DTRACE_PROBE1(dg, name, a)
+#define DG_TRACE2(name, a, b) DTRACE_PROBE2(dg, name, a, b)
+
+#else
+
+#define DG_TRACE0(name) do {} while (0)
+#define DG_TRACE1(name, a) do {} while (0)
+#define DG_TRACE2(name, a, b) do {} while (0)
+
+#endif // ENABLE_TRACEPOINTS
+
+#endif // _DG_ANALYSIS_TRACEPOINTS_H_
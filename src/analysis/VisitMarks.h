@@ -0,0 +1,95 @@
+#ifndef _DG_VISIT_MARKS_H_
+#define _DG_VISIT_MARKS_H_
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace dg {
+namespace analysis {
+
+/// ------------------------------------------------------------------
+// - VisitMarks
+//
+//   The marks of the nodes (or blocks) visited by a walk, stored in
+//   a dense array indexed by the walk index of the node (see
+//   AnalysesAuxiliaryData::walkidx). Every walk gets a new generation,
+//   so the marks never need to be cleared. The arrays are kept in
+//   a per-thread pool and reused by the following walks, a walk that
+//   starts while another one is running (e.g. from its callback)
+//   gets another array, so the walks do not interfere.
+/// ------------------------------------------------------------------
+class VisitMarks
+{
+    std::vector<unsigned int> marks;
+    unsigned int generation = 0;
+
+    static std::vector<std::unique_ptr<VisitMarks>>& getPool()
+    {
+        static thread_local std::vector<std::unique_ptr<VisitMarks>> pool;
+        return pool;
+    }
+
+public:
+    // take marks from the pool for a new walk
+    static VisitMarks *acquire()
+    {
+        auto& pool = getPool();
+        VisitMarks *vm;
+        if (pool.empty()) {
+            vm = new VisitMarks();
+        } else {
+            vm = pool.back().release();
+            pool.pop_back();
+        }
+
+        vm->newWalk();
+        return vm;
+    }
+
+    // return the marks into the pool after the walk
+    static void release(VisitMarks *vm)
+    {
+        assert(vm);
+        getPool().emplace_back(vm);
+    }
+
+    void newWalk()
+    {
+        // the generations wrapped around, we must clear the marks
+        if (++generation == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            generation = 1;
+        }
+    }
+
+    // mark the index as visited, return false
+    // if it was visited already in this walk
+    bool visit(unsigned int idx)
+    {
+        if (idx >= marks.size())
+            marks.resize(std::max<size_t>(idx + 1, 2 * marks.size()), 0);
+
+        if (marks[idx] == generation)
+            return false;
+
+        marks[idx] = generation;
+        return true;
+    }
+
+    // keeps the marks acquired for the time of a walk
+    class Guard
+    {
+        VisitMarks *&vm;
+
+    public:
+        Guard(VisitMarks *&v) : vm(v) { vm = acquire(); }
+        ~Guard() { release(vm); vm = nullptr; }
+    };
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_VISIT_MARKS_H_
@@ -0,0 +1,131 @@
+#ifndef _DG_LLVM_BITCODE_PREFETCHER_H_
+#define _DG_LLVM_BITCODE_PREFETCHER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace dg {
+
+///
+// Reads the mapped bitcode of the lazily loaded modules ahead
+// on a helper thread. The bitcode is mapped into memory, so without
+// this every first touch of a function body blocks the loading
+// on reading the pages from the storage (which is slow on network
+// file systems). The helper only touches the pages of the mapping
+// in the order of the file (the bodies of the functions follow
+// one another there), it never touches the LLVM objects -- the
+// bodies are decoded on the main thread, LLVMContext cannot be used
+// from more threads. At most @budget bytes are read in total,
+// so the resident memory of the mappings stays bounded.
+//
+// The mapped memory must stay valid until stop() returns (the module
+// owns it until it is materialized whole), stop() is called also
+// by the destructor.
+class BitcodePrefetcher
+{
+    size_t budget;
+    size_t read = 0;
+
+    std::deque<std::pair<const char *, size_t>> regions;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<bool> stopped{false};
+    std::thread worker;
+
+    static const size_t PAGE_SIZE = 4096;
+    // the pages are read in chunks, the stop flag is checked between them
+    static const size_t CHUNK_SIZE = 64 * PAGE_SIZE;
+
+    // touch every page of the chunk, the sum keeps the reads
+    // from being optimized out
+    static unsigned char touch(const char *data, size_t size)
+    {
+        unsigned char sum = 0;
+        for (size_t off = 0; off < size; off += PAGE_SIZE)
+            sum ^= static_cast<unsigned char>(
+                    *static_cast<const volatile char *>(data + off));
+
+        return sum;
+    }
+
+    void run()
+    {
+        volatile unsigned char sink = 0;
+        while (true) {
+            std::pair<const char *, size_t> region;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this]() { return stopped || !regions.empty(); });
+                if (stopped)
+                    return;
+
+                region = regions.front();
+                regions.pop_front();
+            }
+
+            for (size_t off = 0; off < region.second; off += CHUNK_SIZE) {
+                if (stopped || read >= budget)
+                    break;
+
+                size_t size = region.second - off;
+                if (size > CHUNK_SIZE)
+                    size = CHUNK_SIZE;
+                size = std::min(size, budget - read);
+                sink = sink ^ touch(region.first + off, size);
+                read += size;
+            }
+        }
+    }
+
+public:
+    BitcodePrefetcher(size_t budget) : budget(budget) {}
+    BitcodePrefetcher(const BitcodePrefetcher&) = delete;
+    BitcodePrefetcher& operator=(const BitcodePrefetcher&) = delete;
+
+    ~BitcodePrefetcher() { stop(); }
+
+    // read the @size bytes from @data ahead (after the regions
+    // added before), the helper thread is started with the first region
+    void add(const char *data, size_t size)
+    {
+        if (budget == 0 || stopped)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            regions.emplace_back(data, size);
+        }
+
+        if (!worker.joinable())
+            worker = std::thread(&BitcodePrefetcher::run, this);
+        cv.notify_one();
+    }
+
+    // stop reading and wait for the helper thread
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopped = true;
+            regions.clear();
+        }
+
+        cv.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // the number of bytes read ahead so far
+    // (exact only after stop())
+    size_t getReadBytes() const { return read; }
+};
+
+} // namespace dg
+
+#endif // _DG_LLVM_BITCODE_PREFETCHER_H_
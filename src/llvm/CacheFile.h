@@ -0,0 +1,141 @@
+#ifndef _DG_LLVM_CACHE_FILE_H_
+#define _DG_LLVM_CACHE_FILE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+// Helpers for storing the results of analyses into files, so that
+// later runs on the same module can load them instead of computing them.
+// All numbers are written in the native byte order, the files are meant
+// to be used only on the machine that created them.
+
+namespace dg {
+
+// Numbering of the values of a module that is the same in every run
+// on the same module. Values are numbered in the order of the module
+// (globals, and then functions with their arguments and instructions).
+struct ValuesNumbering {
+    std::vector<const llvm::Value *> values;
+    std::unordered_map<const llvm::Value *, uint32_t> ids;
+
+    void add(const llvm::Value *val)
+    {
+        ids.emplace(val, values.size());
+        values.push_back(val);
+    }
+
+    ValuesNumbering(const llvm::Module *M)
+    {
+        for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I)
+            add(&*I);
+
+        for (const llvm::Function& F : *M) {
+            add(&F);
+            for (auto A = F.arg_begin(), E = F.arg_end(); A != E; ++A)
+                add(&*A);
+
+            for (const llvm::BasicBlock& B : F) {
+                for (const llvm::Instruction& I : B)
+                    add(&I);
+            }
+        }
+    }
+
+    bool getId(const llvm::Value *val, uint32_t& id) const
+    {
+        auto it = ids.find(val);
+        if (it == ids.end())
+            return false;
+
+        id = it->second;
+        return true;
+    }
+};
+
+class CacheWriter {
+    std::ofstream out;
+
+public:
+    CacheWriter(const std::string& file)
+    : out(file, std::ios::binary | std::ios::trunc) {}
+
+    bool good() const { return out.good(); }
+
+    void write(const void *data, size_t len)
+    {
+        out.write(static_cast<const char *>(data), len);
+    }
+
+    void write32(uint32_t v) { write(&v, sizeof v); }
+    void write64(uint64_t v) { write(&v, sizeof v); }
+
+    // the length (u32) and the bytes of the string
+    void writeString(const std::string& s)
+    {
+        write32(s.size());
+        write(s.data(), s.size());
+    }
+};
+
+// reads the file from the memory buffer
+// (MemoryBuffer maps big files into memory instead of reading them)
+class CacheReader {
+    const char *pos;
+    const char *end;
+
+public:
+    CacheReader(const llvm::MemoryBuffer& buf)
+    : pos(buf.getBufferStart()), end(buf.getBufferEnd()) {}
+
+    bool read(void *data, size_t len)
+    {
+        if ((size_t) (end - pos) < len)
+            return false;
+
+        memcpy(data, pos, len);
+        pos += len;
+        return true;
+    }
+
+    bool read32(uint32_t& v) { return read(&v, sizeof v); }
+    bool read64(uint64_t& v) { return read(&v, sizeof v); }
+
+    bool readString(std::string& s)
+    {
+        uint32_t len;
+        if (!read32(len) || (size_t) (end - pos) < len)
+            return false;
+
+        s.assign(pos, len);
+        pos += len;
+        return true;
+    }
+    bool atEnd() const { return pos == end; }
+};
+
+} // namespace dg
+
+#endif // _DG_LLVM_CACHE_FILE_H_
@@ -0,0 +1,132 @@
+#include <cstring>
+
+#include "CacheFile.h"
+#include "ControlDependenceCache.h"
+
+///
+// Format of the file (see llvm/CacheFile.h):
+//
+//  magic (8 bytes), key (u64), number of entries (u32)
+//      entry: hash of the CFG (u64), number of blocks (u32),
+//             immediate post-dominator (u32) for every block,
+//             number of control dependencies (u32)
+//                 edge: block index (u32), block index (u32)
+
+namespace dg {
+
+namespace {
+const char MAGIC[8] = {'D', 'G', 'C', 'D', 'C', 'C', '1', '\0'};
+}
+
+bool ControlDependenceCache::load(const std::string& file, uint64_t key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    entries.clear();
+    changed = false;
+
+    auto buf = llvm::MemoryBuffer::getFile(file);
+    if (!buf)
+        return false;
+
+    CacheReader in(*buf.get());
+    char magic[sizeof MAGIC];
+    uint64_t file_key;
+    uint32_t entries_num;
+    if (!in.read(magic, sizeof magic) || memcmp(magic, MAGIC, sizeof MAGIC) != 0
+        || !in.read64(file_key) || file_key != key
+        || !in.read32(entries_num))
+        return false;
+
+    std::unordered_map<uint64_t, Entry> loaded;
+    for (uint32_t i = 0; i < entries_num; ++i) {
+        uint64_t hash;
+        uint32_t blocks_num, cds_num;
+        if (!in.read64(hash) || !in.read32(blocks_num))
+            return false;
+
+        Entry entry;
+        entry.ipdoms.resize(blocks_num);
+        for (uint32_t& ipdom : entry.ipdoms) {
+            if (!in.read32(ipdom) || (ipdom != ROOT && ipdom >= blocks_num))
+                return false;
+        }
+
+        if (!in.read32(cds_num))
+            return false;
+
+        entry.cds.resize(cds_num);
+        for (auto& edge : entry.cds) {
+            if (!in.read32(edge.first) || !in.read32(edge.second)
+                || edge.first >= blocks_num || edge.second >= blocks_num)
+                return false;
+        }
+
+        loaded.emplace(hash, std::move(entry));
+    }
+
+    if (!in.atEnd())
+        return false;
+
+    entries.swap(loaded);
+    return true;
+}
+
+bool ControlDependenceCache::save(const std::string& file, uint64_t key) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!changed)
+        return true;
+
+    CacheWriter out(file);
+    out.write(MAGIC, sizeof MAGIC);
+    out.write64(key);
+    out.write32(entries.size());
+    for (const auto& it : entries) {
+        const Entry& entry = it.second;
+        out.write64(it.first);
+        out.write32(entry.ipdoms.size());
+        for (uint32_t ipdom : entry.ipdoms)
+            out.write32(ipdom);
+
+        out.write32(entry.cds.size());
+        for (const auto& edge : entry.cds) {
+            out.write32(edge.first);
+            out.write32(edge.second);
+        }
+    }
+
+    return out.good();
+}
+
+bool ControlDependenceCache::get(uint64_t hash, Entry& entry)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = entries.find(hash);
+    if (it == entries.end())
+        return false;
+
+    entry = it->second;
+    ++hits;
+    return true;
+}
+
+void ControlDependenceCache::add(uint64_t hash, Entry&& entry)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (entries.emplace(hash, std::move(entry)).second)
+        changed = true;
+}
+
+size_t ControlDependenceCache::size() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return entries.size();
+}
+
+uint64_t ControlDependenceCache::getHits() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hits;
+}
+
+} // namespace dg
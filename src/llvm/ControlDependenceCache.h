@@ -0,0 +1,65 @@
+#ifndef _DG_LLVM_CONTROL_DEPENDENCE_CACHE_H_
+#define _DG_LLVM_CONTROL_DEPENDENCE_CACHE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dg {
+
+///
+// The post-dominators and control dependencies of the functions stored
+// by the structural hash of their CFG. The control dependencies of
+// a function depend only on its CFG, so the results are the same for
+// every function with the same CFG - in any module (e.g. the functions
+// of a static library linked into many programs). The cache is kept
+// in one file that is loaded at the start of a run and saved with
+// the new entries at the end, so it can be shared by the runs on
+// different modules.
+//
+// The blocks of a function are identified by their index in the order
+// of the function (the unified exit block is the last one).
+// The cache can be used from more threads at once.
+class ControlDependenceCache
+{
+public:
+    enum : uint32_t { ROOT = ~0U };
+
+    struct Entry {
+        // the immediate post-dominators of the blocks,
+        // ROOT for the root of the post-dominator tree
+        std::vector<uint32_t> ipdoms;
+        // (block, the block that is control dependent on it)
+        std::vector<std::pair<uint32_t, uint32_t>> cds;
+    };
+
+private:
+    std::unordered_map<uint64_t, Entry> entries;
+    mutable std::mutex lock;
+    // the entries were added since the cache was loaded
+    bool changed = false;
+    uint64_t hits = 0;
+
+public:
+    // load the entries from @file (created by save() with the same @key
+    // that identifies the options). Returns false if the file does not
+    // exist or cannot be used, the cache is empty then
+    bool load(const std::string& file, uint64_t key);
+    // save the entries into @file if there are new ones
+    bool save(const std::string& file, uint64_t key) const;
+
+    // copy the entry of the CFG with @hash to @entry
+    bool get(uint64_t hash, Entry& entry);
+    void add(uint64_t hash, Entry&& entry);
+
+    size_t size() const;
+    // the number of the successful get()s
+    uint64_t getHits() const;
+};
+
+} // namespace dg
+
+#endif // _DG_LLVM_CONTROL_DEPENDENCE_CACHE_H_
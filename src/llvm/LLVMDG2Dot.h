@@ -2,9 +2,11 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "DG2Dot.h"
 #include "llvm/LLVMNode.h"
+#include "llvm/LLVMDependenceGraph.h"
 
 using namespace dg;
 namespace dg {
@@ -29,8 +31,8 @@ static std::ostream& printLLVMVal(std::ostream& os, const llvm::Value *val)
         return os;
     }
 
-    std::ostringstream ostr;
-    llvm::raw_os_ostream ro(ostr);
+    std::string str;
+    llvm::raw_string_ostream ro(str);
 
     if (llvm::isa<llvm::Function>(val)) {
         ro << "FUNC " << val->getName().data();
@@ -43,7 +45,6 @@ static std::ostream& printLLVMVal(std::ostream& os, const llvm::Value *val)
     ro.flush();
 
     // break the string if it is too long
-    std::string str = ostr.str();
     if (str.length() > 100) {
         str.resize(40);
     }
@@ -61,6 +62,38 @@ static std::ostream& printLLVMVal(std::ostream& os, const llvm::Value *val)
     return os;
 }
 
+// should the function be dumped? @dump_func_only is
+// a comma-separated list of names (nullptr means all functions)
+static bool isDumpedFunction(const llvm::Value *F,
+                             const char *dump_func_only)
+{
+    if (!dump_func_only)
+        return true;
+
+    llvm::StringRef names(dump_func_only);
+    while (!names.empty()) {
+        auto parts = names.split(',');
+        if (F->getName().equals(parts.first))
+            return true;
+        names = parts.second;
+    }
+
+    return false;
+}
+
+// the graphs of the dumped functions
+static std::vector<DependenceGraph<LLVMNode> *>
+getDumpedGraphs(LLVMDependenceGraph *dg, const char *dump_func_only)
+{
+    std::vector<DependenceGraph<LLVMNode> *> graphs;
+    for (auto& F : dg->getConstructedFunctions()) {
+        if (isDumpedFunction(F.first, dump_func_only))
+            graphs.push_back(F.second);
+    }
+
+    return graphs;
+}
+
 class LLVMDG2Dot : public debug::DG2Dot<LLVMNode>
 {
 public:
@@ -69,7 +102,7 @@ public:
     LLVMDG2Dot(LLVMDependenceGraph *dg,
                uint32_t opts = debug::PRINT_CFG | debug::PRINT_DD | debug::PRINT_CD,
                const char *file = NULL)
-        : debug::DG2Dot<LLVMNode>(dg, opts, file) {}
+        : debug::DG2Dot<LLVMNode>(dg, opts, file), llvmdg(dg) {}
 
     /* virtual */
     std::ostream& printKey(std::ostream& os, llvm::Value *val)
@@ -127,13 +160,15 @@ public:
         if (!ensureFile(new_file))
             return false;
 
-        const std::map<llvm::Value *,
-                       LLVMDependenceGraph *>& CF = getConstructedFunctions();
+        const auto& CF = llvmdg->getConstructedFunctions();
+
+        selectNodes(getDumpedGraphs(llvmdg, dump_func_only));
 
         start();
 
         for (auto& F : CF) {
-            if (dump_func_only && !F.first->getName().equals(dump_func_only))
+            if (!isDumpedFunction(F.first, dump_func_only)
+                || !hasSelected(F.second))
                 continue;
 
             dumpSubgraph(F.second, F.first->getName().data());
@@ -145,6 +180,8 @@ public:
     }
 
 private:
+    // the graph of the module, it knows all the subgraphs
+    LLVMDependenceGraph *llvmdg;
 
     void dumpSubgraph(LLVMDependenceGraph *graph, const char *name)
     {
@@ -169,7 +206,7 @@ public:
     LLVMDGDumpBlocks(LLVMDependenceGraph *dg,
                   uint32_t opts = debug::PRINT_CFG | debug::PRINT_DD | debug::PRINT_CD,
                   const char *file = NULL)
-        : debug::DG2Dot<LLVMNode>(dg, opts, file) {}
+        : debug::DG2Dot<LLVMNode>(dg, opts, file), llvmdg(dg) {}
 
     /* virtual
     std::ostream& printKey(std::ostream& os, llvm::Value *val)
@@ -191,15 +228,15 @@ public:
         if (!ensureFile(new_file))
             return false;
 
-        const std::map<llvm::Value *,
-                       LLVMDependenceGraph *>& CF = getConstructedFunctions();
+        const auto& CF = llvmdg->getConstructedFunctions();
+
+        selectNodes(getDumpedGraphs(llvmdg, dump_func_only));
 
         start();
 
         for (auto& F : CF) {
-            // XXX: this is inefficient, we can get the dump_func_only function
-            // from the module (F.getParent()->getModule()->getFunction(...)
-            if (dump_func_only && !F.first->getName().equals(dump_func_only))
+            if (!isDumpedFunction(F.first, dump_func_only)
+                || !hasSelected(F.second))
                 continue;
 
             dumpSubgraph(F.second, F.first->getName().data());
@@ -211,17 +248,21 @@ public:
     }
 
 private:
+    // the graph of the module, it knows all the subgraphs
+    LLVMDependenceGraph *llvmdg;
 
     void dumpSubgraph(LLVMDependenceGraph *graph, const char *name)
     {
         dumpSubgraphStart(graph, name);
 
         for (auto& B : graph->getBlocks()) {
-            dumpBlock(B.second);
+            if (hasSelected(B.second))
+                dumpBlock(B.second);
         }
 
         for (auto& B : graph->getBlocks()) {
-            dumpBlockEdges(B.second);
+            if (hasSelected(B.second))
+                dumpBlockEdges(B.second);
         }
 
         dumpSubgraphEnd(graph, false);
@@ -231,12 +272,11 @@ private:
     {
         out << "NODE" << blk << " [label=\"";
 
-        std::ostringstream ostr;
-        llvm::raw_os_ostream ro(ostr);
+        std::string str;
+        llvm::raw_string_ostream ro(str);
 
         ro << *blk->getKey();
         ro.flush();
-        std::string str = ostr.str();
 
         unsigned int i = 0;
         unsigned int len = 0;
@@ -267,11 +307,17 @@ private:
     void dumpBlockEdges(LLVMBBlock *blk)
     {
         for (const LLVMBBlock::BBlockEdge& edge : blk->successors()) {
+            if (!hasSelected(edge.target))
+                continue;
+
             out << "NODE" << blk << " -> NODE" << edge.target
                 << " [penwidth=2 label=\""<< (int) edge.label << "\"] \n";
         }
 
         for (const LLVMBBlock *pdf : blk->controlDependence()) {
+            if (!hasSelected(pdf))
+                continue;
+
             out << "NODE" << blk << " -> NODE" << pdf
                 << " [color=blue constraint=false]\n";
         }
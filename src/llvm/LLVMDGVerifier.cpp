@@ -1,5 +1,7 @@
 #include <cstdio>
 #include <cstdarg>
+#include <string>
+#include <vector>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -23,11 +25,14 @@
 #include "LLVMDependenceGraph.h"
 #include "LLVMNode.h"
 #include "LLVMDGVerifier.h"
+#include "analysis/Parallel.h"
 
 namespace dg {
 
 void LLVMDGVerifier::fault(const char *fmt, ...)
 {
+    std::lock_guard<std::mutex> lock(output_mtx);
+
     va_list args;
     va_start(args, fmt);
     fprintf(stderr, "ERR dg-verify: ");
@@ -42,12 +47,38 @@ void LLVMDGVerifier::fault(const char *fmt, ...)
 
 bool LLVMDGVerifier::verify()
 {
+    faults = 0;
     checkMainProc();
 
-    extern std::map<llvm::Value *,
-                    LLVMDependenceGraph *> constructedFunctions;
-    for (auto& it : constructedFunctions)
-        checkGraph(llvm::cast<llvm::Function>(it.first), it.second);
+    auto getSizes = [](llvm::Function *F, LLVMDependenceGraph *g) {
+        return CheckedGraph{F, g->size(), g->getBlocks().size(), F->size()};
+    };
+
+    std::vector<std::pair<llvm::Function *, LLVMDependenceGraph *>> graphs;
+    for (auto& it : dg->getConstructedFunctions()) {
+        llvm::Function *F = llvm::cast<llvm::Function>(it.first);
+        if (incremental) {
+            auto cit = checked.find(it.second);
+            if (cit != checked.end() && cit->second == getSizes(F, it.second))
+                continue;
+        }
+
+        graphs.emplace_back(F, it.second);
+    }
+
+    std::vector<char> ok(graphs.size(), false);
+    analysis::parallelFor(graphs.size(), threads, [&](size_t i, unsigned) {
+        ok[i] = checkGraph(graphs[i].first, graphs[i].second);
+    });
+
+    // remember the graphs without faults, the faulty graphs
+    // are checked (and reported) again the next time
+    for (size_t i = 0; i < graphs.size(); ++i) {
+        if (ok[i])
+            checked[graphs[i].second] = getSizes(graphs[i].first, graphs[i].second);
+        else
+            checked.erase(graphs[i].second);
+    }
 
     fflush(stderr);
     return faults == 0;
@@ -59,73 +90,92 @@ void LLVMDGVerifier::checkMainProc()
         fault("has no module set");
 
     // all the subgraphs must have the same global nodes
-    extern std::map<llvm::Value *,
-                    LLVMDependenceGraph *> constructedFunctions;
-    for (auto& it : constructedFunctions) {
+    for (auto& it : dg->getConstructedFunctions()) {
         if (it.second->global_nodes != dg->global_nodes)
             fault("subgraph has different global nodes than main proc");
     }
 }
 
-void LLVMDGVerifier::checkNode(const llvm::Value *val, LLVMNode *node)
+bool LLVMDGVerifier::checkNode(const llvm::Value *val, LLVMNode *node)
 {
     if (!node->getBBlock()) {
-        fault("node has no value set");
-        llvm::errs() << "  -> " << *val << "\n";
+        std::string str;
+        llvm::raw_string_ostream os(str);
+        os << *val;
+        fault("node has no value set\n  -> %s", os.str().c_str());
+        return false;
     }
 
     // FIXME if this is a call-size, check that the parameters match
+    return true;
 }
 
-void LLVMDGVerifier::checkBBlock(const llvm::BasicBlock *llvmBB, LLVMBBlock *BB)
+bool LLVMDGVerifier::checkBBlock(const llvm::BasicBlock *llvmBB, LLVMBBlock *BB)
 {
     using namespace llvm;
     auto BBIT = BB->getNodes().begin();
+    bool ok = true;
 
     for (const Instruction& I : *llvmBB) {
+        if (LLVMDependenceGraph::isNonSemantic(I))
+            continue;
+
         LLVMNode *node = *BBIT;
 
         // check if we have the CFG edges set
-        if (node->getKey() != &I)
+        if (node->getKey() != &I) {
             fault("wrong node in BB");
+            ok = false;
+        }
 
-        checkNode(&I, node);
+        ok &= checkNode(&I, node);
         ++BBIT;
     }
 
     // FIXME: check successors and predecessors
+    return ok;
 }
 
-void LLVMDGVerifier::checkGraph(llvm::Function *F, LLVMDependenceGraph *g)
+bool LLVMDGVerifier::checkGraph(llvm::Function *F, LLVMDependenceGraph *g)
 {
     using namespace llvm;
 
     LLVMNode *entry = g->getEntry();
     if (!entry) {
         fault("has no entry for %s", F->getName().data());
-        return;
+        return false;
     }
 
     const llvm::Function *func = dyn_cast<Function>(entry->getKey());
     if (!func) {
         fault("key in entry node is not a llvm::Function");
-        return;
+        return false;
     }
 
+    bool ok = true;
     size_t a, b;
     a = g->getBlocks().size();
     b = func->size();
-    if (a != b)
-        fault("have constructed %lu BBlocks but function has %lu basic blocks", a, b);
+    if (a != b) {
+        fault("have constructed %zu BBlocks but function has %zu basic blocks", a, b);
+        ok = false;
+    }
 
+    // do not use operator[], the graphs are checked from more threads
+    const auto& blocks = g->getBlocks();
     for (BasicBlock& llvmBB : *F) {
-        LLVMBBlock *BB = g->getBlocks()[&llvmBB];
-        if (!BB) {
-            fault("missing BasicBlock");
-            errs() << llvmBB << "\n";
+        auto it = blocks.find(&llvmBB);
+        if (it == blocks.end() || !it->second) {
+            std::string str;
+            llvm::raw_string_ostream os(str);
+            os << llvmBB;
+            fault("missing BasicBlock\n%s", os.str().c_str());
+            ok = false;
         } else
-            checkBBlock(&llvmBB, BB);
+            ok &= checkBBlock(&llvmBB, it->second);
     }
+
+    return ok;
 }
 
 };
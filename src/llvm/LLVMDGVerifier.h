@@ -1,6 +1,10 @@
 #ifndef _LLVM_DG_VERIFIER_H_
 #define _LLVM_DG_VERIFIER_H_
 
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
 #include "LLVMDependenceGraph.h"
 
 namespace llvm {
@@ -13,17 +17,48 @@ namespace dg {
 // verify if the built dg is ok
 // this is friend class of LLVMDependenceGraph,
 // so we can do everything!
+//
+// The graphs of the functions are checked independently,
+// so they can be checked from more threads (setThreads()).
+// With setIncremental(), verify() checks only the graphs that are new
+// or changed since the last verify() of this verifier (the number
+// of nodes or blocks of the graph or the number of blocks of the function
+// differs), so the verifier can be kept and run after every change.
 class LLVMDGVerifier {
     const LLVMDependenceGraph *dg;
-    unsigned int faults;
+    std::atomic<unsigned> faults;
+    // serializes the messages of the faults
+    std::mutex output_mtx;
+
+    unsigned threads = 1;
+    bool incremental = false;
+
+    // the sizes of the graph when it was checked without faults
+    struct CheckedGraph {
+        const llvm::Function *func;
+        size_t nodes, blocks, llvmBlocks;
+
+        bool operator==(const CheckedGraph& rhs) const
+        {
+            return func == rhs.func && nodes == rhs.nodes
+                   && blocks == rhs.blocks && llvmBlocks == rhs.llvmBlocks;
+        }
+    };
+    std::unordered_map<const LLVMDependenceGraph *, CheckedGraph> checked;
 
     void fault(const char *fmt, ...);
     void checkMainProc();
-    void checkGraph(llvm::Function *, LLVMDependenceGraph *);
-    void checkBBlock(const llvm::BasicBlock *, LLVMBBlock *);
-    void checkNode(const llvm::Value *, LLVMNode *);
+    bool checkGraph(llvm::Function *, LLVMDependenceGraph *);
+    bool checkBBlock(const llvm::BasicBlock *, LLVMBBlock *);
+    bool checkNode(const llvm::Value *, LLVMNode *);
 public:
     LLVMDGVerifier(const LLVMDependenceGraph *g) : dg(g), faults(0) {}
+
+    // check the graphs using @n threads (default is 1)
+    void setThreads(unsigned n) { threads = n; }
+    // check only the graphs changed since the last verify()
+    void setIncremental(bool inc = true) { incremental = inc; }
+
     bool verify();
 };
 
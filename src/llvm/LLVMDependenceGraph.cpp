@@ -6,9 +6,13 @@
  #error "Need CFG enabled for building LLVM Dependence Graph"
 #endif
 
+#include <algorithm>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <unordered_map>
 #include <set>
+#include <vector>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -29,6 +33,7 @@
 
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/DataLayout.h>
@@ -46,7 +51,10 @@
 
 #include "llvm/analysis/PointsTo/PointsTo.h"
 #include "llvm/analysis/ControlExpression.h"
+#include "llvm/analysis/ModRef.h"
+#include "llvm/analysis/DefUse.h"
 #include "llvm-utils.h"
+#include "analysis/Parallel.h"
 
 using llvm::errs;
 using std::make_pair;
@@ -57,17 +65,128 @@ namespace dg {
 //  -- LLVMDependenceGraph
 /// ------------------------------------------------------------------
 
-// map of all constructed functions
-std::map<llvm::Value *, LLVMDependenceGraph *> constructedFunctions;
+///
+// The source location of a criterion or of an instruction
+struct SourceLine {
+    llvm::StringRef directory, file;
+    unsigned line = 0;
+    unsigned col = 0;
+};
 
-const std::map<llvm::Value *,
-               LLVMDependenceGraph *>& getConstructedFunctions()
+static bool getSourceLine(const llvm::Instruction *I, SourceLine& loc)
 {
-    return constructedFunctions;
+    const llvm::DebugLoc& Loc = I->getDebugLoc();
+#if ((LLVM_VERSION_MAJOR > 3)\
+      || ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR > 6)))
+    if (!Loc)
+        return false;
+
+    loc.directory = Loc->getDirectory();
+    loc.file = Loc->getFilename();
+#else
+    // the file is not easily available in these versions,
+    // the locations match any file then
+    if (Loc.getLine() == 0)
+        return false;
+#endif
+    loc.line = Loc.getLine();
+    loc.col = Loc.getCol();
+    return true;
 }
 
+// does the instruction at @loc match the criterion @crit?
+// The file of the criterion may be just a suffix of the path
+static bool matchSourceLine(const SourceLine& loc, const SourceLine& crit)
+{
+    if (loc.line != crit.line || (crit.col != 0 && loc.col != crit.col))
+        return false;
+
+    auto matchPath = [&crit](llvm::StringRef path) {
+        return path.endswith(crit.file) &&
+               (path.size() == crit.file.size() ||
+                path[path.size() - crit.file.size() - 1] == '/');
+    };
+
+    if (loc.file.empty() || matchPath(loc.file))
+        return true;
+
+    // the relative name of the file with its directory
+    return !loc.file.startswith("/") && !loc.directory.empty() &&
+           matchPath((loc.directory + "/" + loc.file).str());
+}
+
+bool LLVMDependenceGraph::parseLocation(const std::string& str, std::string& file,
+                                        unsigned& line, unsigned& col)
+{
+    auto isNumber = [](const std::string& s) {
+        return !s.empty() && s.size() <= 9 &&
+               std::all_of(s.begin(), s.end(),
+                           [](char c) { return c >= '0' && c <= '9'; });
+    };
+
+    size_t last = str.rfind(':');
+    if (last == std::string::npos || last == 0)
+        return false;
+
+    std::string num = str.substr(last + 1);
+    if (!isNumber(num))
+        return false;
+
+    size_t prev = str.rfind(':', last - 1);
+    if (prev != std::string::npos && prev > 0 &&
+        isNumber(str.substr(prev + 1, last - prev - 1))) {
+        file = str.substr(0, prev);
+        line = std::stoul(str.substr(prev + 1, last - prev - 1));
+        col = std::stoul(num);
+    } else {
+        file = str.substr(0, last);
+        line = std::stoul(num);
+        col = 0;
+    }
+
+    return line != 0;
+}
+
+// the source locations among the criteria
+static std::vector<std::pair<std::string, SourceLine>>
+getLocationCriteria(const std::vector<std::string>& criteria)
+{
+    std::vector<std::pair<std::string, SourceLine>> locs;
+    for (const std::string& c : criteria) {
+        std::string file;
+        SourceLine loc;
+        if (LLVMDependenceGraph::parseLocation(c, file, loc.line, loc.col))
+            locs.emplace_back(std::move(file), loc);
+    }
+
+    // the strings do not move any more
+    for (auto& it : locs)
+        it.second.file = it.first;
+
+    return locs;
+}
+
+struct LLVMDependenceGraph::OpaqueFunctions {
+    // the names of the called functions that we slice with respect to
+    std::vector<std::string> criteria;
+    // the source locations among the criteria
+    std::vector<std::pair<std::string, SourceLine>> locations;
+    // the functions whose graphs are built
+    std::set<const llvm::Function *> relevant;
+    // the call graph of the functions reachable from the entry
+    std::map<const llvm::Function *, std::vector<llvm::Function *>> callees;
+    // the calls of the opaque functions in the built graphs
+    std::vector<std::pair<LLVMNode *, llvm::Function *>> calls;
+    std::set<LLVMNode *> callNodes;
+    // the opaque function -> the call-sites it can be called from
+    std::map<const llvm::Function *, std::set<LLVMNode *>> callsites;
+};
+
 LLVMDependenceGraph::~LLVMDependenceGraph()
 {
+    // the thread uses the blocks
+    waitControlDependencies();
+
     // delete nodes
     for (auto I = begin(), E = end(); I != E; ++I) {
         LLVMNode *node = I->second;
@@ -122,9 +241,10 @@ static void addGlobals(llvm::Module *m, LLVMDependenceGraph *dg)
         dg->addGlobalNode(new LLVMNode(&*I));
 }
 
-bool LLVMDependenceGraph::verify() const
+bool LLVMDependenceGraph::verify(unsigned threads) const
 {
     LLVMDGVerifier verifier(this);
+    verifier.setThreads(threads);
     return verifier.verify();
 }
 
@@ -144,8 +264,22 @@ bool LLVMDependenceGraph::build(llvm::Module *m, llvm::Function *entry)
     // add global nodes. These will be shared across subgraphs
     addGlobals(m, this);
 
+    if (opaque)
+        computeRelevantFunctions(entry);
+
+    if (PTA && !modref) {
+        modref = std::make_shared<analysis::LLVMModRefAnalysis>(m, PTA);
+        modref->compute();
+    }
+
     // build recursively DG from entry point
-    build(entry);
+    if (build_threads > 1)
+        buildParallel(entry);
+    else
+        build(entry);
+
+    if (opaque)
+        computeOpaqueCallSites();
 
     return true;
 };
@@ -228,6 +362,25 @@ void LLVMDependenceGraph::addSubgraphGlobalParameters(LLVMDependenceGraph *subgr
     }
 }
 
+LLVMDependenceGraph *LLVMDependenceGraph::createSubgraph()
+{
+    LLVMDependenceGraph *subgraph = new LLVMDependenceGraph();
+    // set global nodes to this one, so that
+    // we'll share them
+    subgraph->setGlobalNodes(getGlobalNodes());
+    subgraph->constructedFunctions = constructedFunctions;
+    subgraph->opaque = opaque;
+    subgraph->loadedCalls = loadedCalls;
+    subgraph->modref = modref;
+    subgraph->module = module;
+    subgraph->PTA = PTA;
+    subgraph->buildOptions = buildOptions;
+    // make subgraphs gather the call-sites too
+    subgraph->gatherCallsites(gather_callsites, gatheredCallsites);
+
+    return subgraph;
+}
+
 LLVMDependenceGraph *
 LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
 {
@@ -237,20 +390,11 @@ LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
 
     // if we don't have this subgraph constructed, construct it
     // else just add call edge
-    LLVMDependenceGraph *&subgraph = constructedFunctions[callFunc];
+    LLVMDependenceGraph *subgraph = getGraph(callFunc);
     if (!subgraph) {
-        // since we have reference the the pointer in
-        // constructedFunctions, we can assing to it
-        subgraph = new LLVMDependenceGraph();
-        // set global nodes to this one, so that
-        // we'll share them
-        subgraph->setGlobalNodes(getGlobalNodes());
-        subgraph->module = module;
-        subgraph->PTA = PTA;
-        // make subgraphs gather the call-sites too
-        subgraph->gatherCallsites(gather_callsites, gatheredCallsites);
-
-        // make the real work
+        subgraph = createSubgraph();
+
+        // make the real work (this also registers the subgraph)
         bool ret = subgraph->build(callFunc);
 
         // at least for now use just assert, if we'll
@@ -263,6 +407,10 @@ LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
         // increases the refcount to 2, but we need this
         // subgraph to has refcount 1, so unref it
         subgraph->unref(false /* deleteOnZero */);
+    } else if (subgraph->defer_linking) {
+        // the blocks of the subgraph were built in parallel,
+        // link its call-sites now, when the sequential build would do it
+        subgraph->linkCallSites();
     }
 
     BB = node->getBBlock();
@@ -331,50 +479,76 @@ static bool isMemAllocationFunc(const llvm::Function *func)
     return false;
 }
 
-void LLVMDependenceGraph::handleInstruction(llvm::Value *val,
-                                            LLVMNode *node)
+// get the defined functions that can be called by the call-site,
+// the calls via function pointers are resolved using the points-to
+// information (if available)
+static void getCalledFunctions(LLVMPointerAnalysis *PTA,
+                               llvm::CallInst *CInst,
+                               std::vector<llvm::Function *>& funcs,
+                               bool warn = true)
 {
     using namespace llvm;
 
-    if (CallInst *CInst = dyn_cast<CallInst>(val)) {
-        Value *strippedValue = CInst->getCalledValue()->stripPointerCasts();
-        Function *func = dyn_cast<Function>(strippedValue);
-        // if func is nullptr, then this is indirect call
-        // via function pointer. If we have the points-to information,
-        // create the subgraph
-        if (!func && !CInst->isInlineAsm() && PTA) {
-            using namespace analysis::pta;
-            PSNode *op = PTA->getNode(strippedValue);
-            if (op) {
-                for (const Pointer& ptr : op->pointsTo) {
-                    if (!ptr.isValid())
-                        continue;
-
-                    // vararg may introduce imprecision here, so we
-                    // must check that it is really pointer to a function
-                    if (!isa<Function>(ptr.target->getUserData<Value>()))
-                        continue;
+    Value *strippedValue = CInst->getCalledValue()->stripPointerCasts();
+    Function *func = dyn_cast<Function>(strippedValue);
+    // if func is nullptr, then this is indirect call
+    // via function pointer. If we have the points-to information,
+    // create the subgraph
+    if (!func && !CInst->isInlineAsm() && PTA) {
+        if (warn && !PTA->getNode(strippedValue))
+            llvmutils::printerr("Had no PTA node", strippedValue);
+
+        // the call graph has only the functions with compatible prototypes
+        for (const Function *F : PTA->getCallGraph().getCallSite(CInst).targets) {
+            // the function is only declaration
+            if (F->size() != 0)
+                funcs.push_back(const_cast<Function *>(F));
+        }
+    }
 
-                    Function *F = ptr.target->getUserData<Function>();
-                    if (F->size() == 0 || !llvmutils::callIsCompatible(F, CInst))
-                        // incompatible prototypes or the function
-                        // is only declaration
-                        continue;
+    if (is_func_defined(func))
+        funcs.push_back(func);
+}
 
-                    LLVMDependenceGraph *subg = buildSubgraph(node, F);
-                    node->addSubgraph(subg);
-                }
-            } else
-                llvmutils::printerr("Had no PTA node", strippedValue);
+void LLVMDependenceGraph::getCallees(llvm::CallInst *CInst,
+                                     std::vector<llvm::Function *>& funcs,
+                                     bool warn) const
+{
+    if (loadedCalls) {
+        auto it = loadedCalls->find(CInst);
+        if (it != loadedCalls->end()) {
+            funcs.insert(funcs.end(), it->second.begin(), it->second.end());
+            return;
         }
+    }
 
+    getCalledFunctions(PTA, CInst, funcs, warn);
+}
+
+void LLVMDependenceGraph::handleInstruction(llvm::Value *val,
+                                            LLVMNode *node)
+{
+    using namespace llvm;
+
+    if (CallInst *CInst = dyn_cast<CallInst>(val)) {
+        Function *func = dyn_cast<Function>(CInst->getCalledValue()->stripPointerCasts());
         if (func && gather_callsites &&
             strcmp(func->getName().data(), gather_callsites) == 0) {
             gatheredCallsites->insert(node);
         }
 
-        if (is_func_defined(func)) {
-            LLVMDependenceGraph *subg = buildSubgraph(node, func);
+        std::vector<Function *> callees;
+        getCallees(CInst, callees);
+        for (Function *F : callees) {
+            if (isOpaque(F)) {
+                // do not build the graph, the def-use analysis
+                // summarizes the function at this call-site
+                opaque->calls.emplace_back(node, F);
+                opaque->callNodes.insert(node);
+                continue;
+            }
+
+            LLVMDependenceGraph *subg = buildSubgraph(node, F);
             node->addSubgraph(subg);
         }
 
@@ -389,6 +563,9 @@ void LLVMDependenceGraph::handleInstruction(llvm::Value *val,
         // no matter what is the function, this is a CallInst,
         // so create call-graph
         addCallNode(node);
+    } else if (modref_globals) {
+        // the formal globals were added by buildEntry()
+        return;
     } else if (Instruction *Inst = dyn_cast<Instruction>(val)) {
         if (isa<LoadInst>(val) || isa<GetElementPtrInst>(val)) {
             Value *op = Inst->getOperand(0)->stripInBoundsOffsets();
@@ -406,6 +583,14 @@ void LLVMDependenceGraph::handleInstruction(llvm::Value *val,
     }
 }
 
+// the blocks of functions may be built from more threads at once
+// (buildParallel()), creating new LLVM values must be synchronized
+static std::mutex& getValuesMutex()
+{
+    static std::mutex mtx;
+    return mtx;
+}
+
 LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
 {
     using namespace llvm;
@@ -417,6 +602,11 @@ LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
 
     // iterate over the instruction and create node for every single one of them
     for (Instruction& Inst : llvmBB) {
+        if (isNonSemantic(Inst)) {
+            nonSemantic.push_back(&Inst);
+            continue;
+        }
+
         Value *val = &Inst;
         node = new LLVMNode(val);
 
@@ -427,7 +617,8 @@ LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
         BB->append(node);
 
         // take instruction specific actions
-        handleInstruction(val, node);
+        if (!defer_linking)
+            handleInstruction(val, node);
     }
 
     // did we created at least one node?
@@ -447,6 +638,7 @@ LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
         // on dep. graph that is not for whole llvm
         LLVMNode *ext = getExit();
         if (!ext) {
+            std::lock_guard<std::mutex> lock(getValuesMutex());
             // we need new llvm value, so that the nodes won't collide
             ReturnInst *phonyRet
                 = ReturnInst::Create(termval->getContext());
@@ -484,8 +676,31 @@ LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
     return BB;
 }
 
+bool LLVMDependenceGraph::isNonSemantic(const llvm::Instruction& I)
+{
+    using namespace llvm;
+
+    // these return nothing, so no instruction uses them
+    if (isa<DbgInfoIntrinsic>(I))
+        return true;
+
+    if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(&I)) {
+        switch (II->getIntrinsicID()) {
+            case Intrinsic::lifetime_start:
+            case Intrinsic::lifetime_end:
+            case Intrinsic::var_annotation:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
 static LLVMBBlock *createSingleExitBB(LLVMDependenceGraph *graph)
 {
+    std::lock_guard<std::mutex> lock(getValuesMutex());
     llvm::UnreachableInst *ui
         = new llvm::UnreachableInst(graph->getModule()->getContext());
     LLVMNode *exit = new LLVMNode(ui, true);
@@ -554,15 +769,21 @@ addControlDepsToPHIs(LLVMDependenceGraph *graph)
 
 bool LLVMDependenceGraph::build(llvm::Function *func)
 {
-    using namespace llvm;
-
     assert(func && "Passed no func");
 
     // do we have anything to process?
     if (func->size() == 0)
         return false;
 
-    constructedFunctions.insert(make_pair(func, this));
+    buildEntry(func);
+    buildBlocks(func);
+
+    return true;
+}
+
+void LLVMDependenceGraph::buildEntry(llvm::Function *func)
+{
+    constructedFunctions->emplace(func, this);
 
     // create entry node
     LLVMNode *entry = new LLVMNode(func);
@@ -574,6 +795,23 @@ bool LLVMDependenceGraph::build(llvm::Function *func)
     // add formal parameters to this graph
     addFormalParameters();
 
+    // add the globals the function may touch, if we do not know them,
+    // the globals used by the instructions are added in handleInstruction()
+    if (modref) {
+        if (const auto *globals = modref->getGlobals(func)) {
+            modref_globals = true;
+            for (llvm::GlobalVariable *GV : *globals)
+                addFormalGlobal(GV);
+        }
+    }
+}
+
+void LLVMDependenceGraph::buildBlocks(llvm::Function *func)
+{
+    using namespace llvm;
+
+    LLVMNode *entry = getEntry();
+
     // iterate over basic blocks
     BBlocksMapT& blocks = getBlocks();
     for (llvm::BasicBlock& llvmBB : *func) {
@@ -630,8 +868,91 @@ bool LLVMDependenceGraph::build(llvm::Function *func)
 
     // add CFG edge from entry point to the first instruction
     entry->addControlDependence(getEntryBB()->getFirstNode());
+}
 
-    return true;
+void LLVMDependenceGraph::linkCallSites()
+{
+    defer_linking = false;
+
+    // handle the instructions in the same order as build() does
+    llvm::Function *func = llvm::cast<llvm::Function>(getEntry()->getValue());
+    BBlocksMapT& blocks = getBlocks();
+    for (llvm::BasicBlock& llvmBB : *func) {
+        for (LLVMNode *node : blocks[&llvmBB]->getNodes())
+            handleInstruction(node->getValue(), node);
+    }
+}
+
+///
+// Building the nodes and blocks of a function needs nothing from
+// other functions, so we build them in parallel. First we find
+// the functions reachable from the entry and create their graphs
+// with the entry nodes and formal parameters (these are added
+// to the shared global nodes, so this is done sequentially).
+// Then the blocks of the functions are built in parallel and finally
+// the call-sites are linked to the subgraphs sequentially, in the same
+// order in which the sequential build does it, so the result is the same.
+void LLVMDependenceGraph::buildParallel(llvm::Function *entry)
+{
+    using namespace llvm;
+
+    // do we have anything to process?
+    if (entry->size() == 0)
+        return;
+
+    std::vector<LLVMDependenceGraph *> graphs;
+    std::vector<Function *> callees;
+
+    buildEntry(entry);
+    graphs.push_back(this);
+
+    for (size_t i = 0; i < graphs.size(); ++i) {
+        Function *func = cast<Function>(graphs[i]->getEntry()->getValue());
+        for (BasicBlock& B : *func) {
+            for (Instruction& I : B) {
+                CallInst *CInst = dyn_cast<CallInst>(&I);
+                if (!CInst)
+                    continue;
+
+                callees.clear();
+                getCallees(CInst, callees, false /* warn */);
+                for (Function *F : callees) {
+                    if (isOpaque(F) || getGraph(F))
+                        continue;
+
+                    LLVMDependenceGraph *subgraph = createSubgraph();
+                    subgraph->buildEntry(F);
+                    // see buildSubgraph()
+                    subgraph->unref(false /* deleteOnZero */);
+                    graphs.push_back(subgraph);
+                }
+            }
+        }
+    }
+
+    for (LLVMDependenceGraph *graph : graphs)
+        graph->defer_linking = true;
+
+    LLVMNode::setConcurrent(true);
+    LLVMBBlock::setConcurrent(true);
+
+    analysis::parallelFor(graphs.size(), build_threads, [&](size_t i, unsigned) {
+        LLVMDependenceGraph *graph = graphs[i];
+        graph->buildBlocks(cast<Function>(graph->getEntry()->getValue()));
+    });
+
+    LLVMNode::setConcurrent(false);
+    LLVMBBlock::setConcurrent(false);
+
+    // this links the subgraphs recursively as they are called
+    linkCallSites();
+
+    // every graph is reached from the entry, but make sure
+    // that we do not leave any call-site unlinked
+    for (LLVMDependenceGraph *graph : graphs) {
+        if (graph->defer_linking)
+            graph->linkCallSites();
+    }
 }
 
 bool LLVMDependenceGraph::build(llvm::Module *m,
@@ -691,88 +1012,185 @@ void LLVMDependenceGraph::addFormalParameters()
     }
 }
 
-static bool array_match(llvm::StringRef name, const char *names[])
+static bool array_match(llvm::StringRef name, const std::vector<std::string>& names)
 {
-    unsigned idx = 0;
-    while(names[idx]) {
-        if (name.equals(names[idx]))
+    for (const auto& nm : names) {
+        if (name == nm)
             return true;
-        ++idx;
     }
 
     return false;
 }
 
-static bool array_match(llvm::StringRef name, const std::vector<std::string>& names)
+void LLVMDependenceGraph::buildOnlyRelevant(const std::vector<std::string>& names)
 {
-    for (const auto& nm : names) {
-        if (name == nm)
-            return true;
-    }
+    opaque = std::make_shared<OpaqueFunctions>();
+    opaque->criteria = names;
+    opaque->locations = getLocationCriteria(names);
+}
 
-    return false;
+bool LLVMDependenceGraph::isOpaque(const llvm::Function *func) const
+{
+    return opaque && func->size() != 0 && opaque->relevant.count(func) == 0;
 }
 
-static bool match_callsite_name(LLVMNode *callNode, const char *names[])
+bool LLVMDependenceGraph::callsOpaque(LLVMNode *callNode) const
 {
-    using namespace llvm;
+    return opaque && opaque->callNodes.count(callNode) > 0;
+}
 
-    // if the function is undefined, it has no subgraphs,
-    // but is not called via function pointer
-    if (!callNode->hasSubgraphs()) {
-        const CallInst *callInst = cast<CallInst>(callNode->getValue());
-        const Value *calledValue = callInst->getCalledValue();
-        const Function *func = dyn_cast<Function>(calledValue->stripPointerCasts());
-        // in the case we haven't run points-to analysis
-        if (!func)
-            return false;
-
-        return array_match(func->getName(), names);
-    } else {
-        // simply iterate over the subgraphs, get the entry node
-        // and check it
-        for (LLVMDependenceGraph *dg : callNode->getSubgraphs()) {
-            LLVMNode *entry = dg->getEntry();
-            assert(entry && "No entry node in graph");
-
-            const Function *func
-                = cast<Function>(entry->getValue()->stripPointerCasts());
-            return array_match(func->getName(), names);
-        }
+const std::set<LLVMNode *> *
+LLVMDependenceGraph::getOpaqueCallSites(const llvm::Function *func) const
+{
+    if (!opaque)
+        return nullptr;
+
+    auto it = opaque->callsites.find(func);
+    return it == opaque->callsites.end() ? nullptr : &it->second;
+}
+
+struct LLVMDependenceGraph::MemoryHubs {
+    std::unordered_map<const llvm::Value *, LLVMNode *> hubs;
+    // the hubs in the order of creation
+    std::vector<std::pair<const llvm::Value *, LLVMNode *>> created;
+
+    ~MemoryHubs()
+    {
+        for (auto& it : created)
+            delete it.second;
     }
+};
 
-    return false;
+LLVMNode *LLVMDependenceGraph::getMemoryHub(const llvm::Value *mem, bool *created)
+{
+    std::lock_guard<std::mutex> lock(getValuesMutex());
+    if (!memoryHubs)
+        memoryHubs = std::make_shared<MemoryHubs>();
+
+    LLVMNode *& hub = memoryHubs->hubs[mem];
+    if (created)
+        *created = !hub;
+
+    if (!hub) {
+        // the hub needs its own value, so that the nodes won't collide
+        llvm::UnreachableInst *ui
+            = new llvm::UnreachableInst(module->getContext());
+        hub = new LLVMNode(ui, true /* node owns the value */);
+        memoryHubs->created.emplace_back(mem, hub);
+    }
+
+    return hub;
+}
+
+std::vector<std::pair<const llvm::Value *, LLVMNode *>>
+LLVMDependenceGraph::getMemoryHubs() const
+{
+    std::lock_guard<std::mutex> lock(getValuesMutex());
+    if (!memoryHubs)
+        return {};
+
+    return memoryHubs->created;
 }
 
-static bool match_callsite_name(LLVMNode *callNode, const std::vector<std::string>& names)
+///
+// The relevant functions are the functions that call a function
+// from the criteria and (transitively) their callers, that is, the
+// functions on the call paths from the entry to the criteria. The other
+// functions can influence the criteria only via memory, which is
+// summarized at their call-sites by the def-use analysis.
+void LLVMDependenceGraph::computeRelevantFunctions(llvm::Function *entry)
 {
     using namespace llvm;
 
-    // if the function is undefined, it has no subgraphs,
-    // but is not called via function pointer
-    if (!callNode->hasSubgraphs()) {
-        const CallInst *callInst = cast<CallInst>(callNode->getValue());
-        const Value *calledValue = callInst->getCalledValue();
-        const Function *func = dyn_cast<Function>(calledValue->stripPointerCasts());
-        // in the case we haven't run points-to analysis
-        if (!func)
-            return false;
-
-        return array_match(func->getName(), names);
-    } else {
-        // simply iterate over the subgraphs, get the entry node
-        // and check it
-        for (LLVMDependenceGraph *dg : callNode->getSubgraphs()) {
-            LLVMNode *entry = dg->getEntry();
-            assert(entry && "No entry node in graph");
-
-            const Function *func
-                = cast<Function>(entry->getValue()->stripPointerCasts());
-            return array_match(func->getName(), names);
+    std::map<const Function *, std::vector<const Function *>> callers;
+    std::vector<const Function *> relevant;
+    std::vector<Function *> stack;
+
+    opaque->callees[entry];
+    stack.push_back(entry);
+    while (!stack.empty()) {
+        Function *func = stack.back();
+        stack.pop_back();
+
+        bool calls_criterion = false;
+        auto& callees = opaque->callees[func];
+        for (BasicBlock& B : *func) {
+            for (Instruction& I : B) {
+                SourceLine loc;
+                if (!opaque->locations.empty() && getSourceLine(&I, loc)) {
+                    for (const auto& crit : opaque->locations) {
+                        if (matchSourceLine(loc, crit.second))
+                            calls_criterion = true;
+                    }
+                }
+
+                CallInst *CInst = dyn_cast<CallInst>(&I);
+                if (!CInst)
+                    continue;
+
+                Function *called
+                    = dyn_cast<Function>(CInst->getCalledValue()->stripPointerCasts());
+                if (called && array_match(called->getName(), opaque->criteria))
+                    calls_criterion = true;
+
+                size_t old_size = callees.size();
+                getCallees(CInst, callees, false /* warn */);
+                for (size_t i = old_size; i < callees.size(); ++i) {
+                    Function *callee = callees[i];
+                    if (array_match(callee->getName(), opaque->criteria))
+                        calls_criterion = true;
+
+                    callers[callee].push_back(func);
+                    if (opaque->callees.count(callee) == 0) {
+                        opaque->callees[callee];
+                        stack.push_back(callee);
+                    }
+                }
+            }
         }
+
+        if (calls_criterion)
+            relevant.push_back(func);
     }
 
-    return false;
+    while (!relevant.empty()) {
+        const Function *func = relevant.back();
+        relevant.pop_back();
+
+        if (!opaque->relevant.insert(func).second)
+            continue;
+
+        for (const Function *caller : callers[func])
+            relevant.push_back(caller);
+    }
+
+    // we always build the entry
+    opaque->relevant.insert(entry);
+}
+
+void LLVMDependenceGraph::computeOpaqueCallSites()
+{
+    for (auto& call : opaque->calls) {
+        // the opaque function can call only other opaque functions,
+        // otherwise it would be on a call path to the criteria
+        std::set<const llvm::Function *> visited;
+        std::vector<const llvm::Function *> stack;
+        stack.push_back(call.second);
+
+        while (!stack.empty()) {
+            const llvm::Function *func = stack.back();
+            stack.pop_back();
+
+            if (!visited.insert(func).second)
+                continue;
+
+            opaque->callsites[func].insert(call.first);
+            for (llvm::Function *callee : opaque->callees[func]) {
+                if (isOpaque(callee))
+                    stack.push_back(callee);
+            }
+        }
+    }
 }
 
 bool LLVMDependenceGraph::getCallSites(const char *name, std::set<LLVMNode *> *callsites)
@@ -781,74 +1199,185 @@ bool LLVMDependenceGraph::getCallSites(const char *name, std::set<LLVMNode *> *c
     return getCallSites(names, callsites);
 }
 
-bool LLVMDependenceGraph::getCallSites(const char *names[],
-                                       std::set<LLVMNode *> *callsites)
+///
+// The index is built by one pass over the nodes of all the graphs.
+// The graphs may be built also after a query (the points-to analysis
+// can discover new callees), so it is rebuilt when the number
+// of the constructed functions changes
+struct LLVMDependenceGraph::CriteriaIndex {
+    size_t functions = 0;
+    bool built = false;
+    // the name of the called function -> the call-sites
+    std::unordered_map<std::string, std::vector<LLVMNode *>> callsites;
+    // the line -> the nodes at the line
+    std::unordered_map<unsigned, std::vector<std::pair<SourceLine, LLVMNode *>>> lines;
+};
+
+// the name of the function called by the call-site
+// (the first of the called graphs if there are more)
+static llvm::StringRef getCalledName(LLVMNode *callNode)
+{
+    using namespace llvm;
+
+    if (callNode->hasSubgraphs()) {
+        LLVMNode *entry = (*callNode->getSubgraphs().begin())->getEntry();
+        assert(entry && "No entry node in graph");
+        return cast<Function>(entry->getValue()->stripPointerCasts())->getName();
+    }
+
+    const CallInst *callInst = cast<CallInst>(callNode->getValue());
+    const Function *func
+        = dyn_cast<Function>(callInst->getCalledValue()->stripPointerCasts());
+    return func ? func->getName() : StringRef();
+}
+
+LLVMDependenceGraph::CriteriaIndex& LLVMDependenceGraph::getCriteriaIndex()
 {
-    for (auto& F : constructedFunctions) {
-        for (auto& I : F.second->getBlocks()) {
-            LLVMBBlock *BB = I.second;
-            for (LLVMNode *n : BB->getNodes()) {
-                if (llvm::isa<llvm::CallInst>(n->getValue())) {
-                    if (match_callsite_name(n, names))
-                        callsites->insert(n);
+    if (!criteriaIndex)
+        criteriaIndex = std::make_shared<CriteriaIndex>();
+
+    CriteriaIndex& index = *criteriaIndex;
+    if (index.built && index.functions == constructedFunctions->size())
+        return index;
+
+    index.callsites.clear();
+    index.lines.clear();
+    for (const auto& F : *constructedFunctions) {
+        for (const auto& I : F.second->getBlocks()) {
+            for (LLVMNode *n : I.second->getNodes()) {
+                const llvm::Instruction *Inst
+                    = llvm::dyn_cast<llvm::Instruction>(n->getValue());
+                if (!Inst)
+                    continue;
+
+                if (llvm::isa<llvm::CallInst>(Inst)) {
+                    llvm::StringRef name = getCalledName(n);
+                    if (!name.empty())
+                        index.callsites[name.str()].push_back(n);
                 }
+
+                SourceLine loc;
+                if (getSourceLine(Inst, loc))
+                    index.lines[loc.line].emplace_back(loc, n);
             }
         }
     }
 
-    return callsites->size() != 0;
+    index.functions = constructedFunctions->size();
+    index.built = true;
+    return index;
+}
+
+bool LLVMDependenceGraph::getCallSites(const char *names[],
+                                       std::set<LLVMNode *> *callsites)
+{
+    std::vector<std::string> vnames;
+    for (unsigned idx = 0; names[idx]; ++idx)
+        vnames.push_back(names[idx]);
+
+    return getCallSites(vnames, callsites);
 }
 
 bool LLVMDependenceGraph::getCallSites(const std::vector<std::string>& names,
                                        std::set<LLVMNode *> *callsites)
 {
-    for (const auto& F : constructedFunctions) {
-        for (const auto& I : F.second->getBlocks()) {
-            LLVMBBlock *BB = I.second;
-            for (LLVMNode *n : BB->getNodes()) {
-                if (llvm::isa<llvm::CallInst>(n->getValue())) {
-                    if (match_callsite_name(n, names))
-                        callsites->insert(n);
-                }
+    CriteriaIndex& index = getCriteriaIndex();
+    for (const std::string& name : names) {
+        auto it = index.callsites.find(name);
+        if (it != index.callsites.end())
+            callsites->insert(it->second.begin(), it->second.end());
+    }
+
+    return callsites->size() != 0;
+}
+
+bool LLVMDependenceGraph::getLocationNodes(const std::vector<std::string>& locations,
+                                           std::set<LLVMNode *> *nodes)
+{
+    CriteriaIndex& index = getCriteriaIndex();
+    bool found = false;
+    for (const auto& crit : getLocationCriteria(locations)) {
+        auto it = index.lines.find(crit.second.line);
+        if (it == index.lines.end())
+            continue;
+
+        for (const auto& loc : it->second) {
+            if (matchSourceLine(loc.first, crit.second)) {
+                nodes->insert(loc.second);
+                found = true;
             }
         }
     }
 
-    return callsites->size() != 0;
+    return found;
 }
 
 void LLVMDependenceGraph::computeControlExpression(bool addCDs)
 {
-    LLVMCFABuilder builder;
+    for (auto& F : getConstructedFunctions())
+        F.second->computeFunctionControlExpression(addCDs);
+}
 
-    for (auto& F : getConstructedFunctions()) {
-        llvm::Function *func = llvm::cast<llvm::Function>(F.first);
-        LLVMCFA cfa = builder.build(*func);
-
-        CE = cfa.compute();
-
-        if (addCDs) {
-            // compute the control scope
-            CE.computeSets();
-            auto& our_blocks = F.second->getBlocks();
-
-            for (llvm::BasicBlock& B : *func) {
-                LLVMBBlock *B1 = our_blocks[&B];
-
-                // if this block is a predicate block,
-                // we compute the control deps for it
-                // XXX: for now we compute the control
-                // scope, which is enough for slicing,
-                // but may add some extra (transitive)
-                // edges
-                if (B.getTerminator()->getNumSuccessors() > 1) {
-                    auto CS = CE.getControlScope(&B);
-                    for (auto cs : CS) {
-                        assert(cs->isa(LABEL));
-                        auto lab = static_cast<CELabel<llvm::BasicBlock *> *>(cs);
-                        LLVMBBlock *B2 = our_blocks[lab->getLabel()];
-                        B1->addControlDependence(B2);
-                    }
+void LLVMDependenceGraph::computeControlDependenciesAsync(enum CD_ALG alg_type,
+                                                          bool lazy)
+{
+    assert(!cd_thread.joinable() && "Already computing control dependencies");
+
+    // there is nothing to compute now
+    if (lazy || !buildOptions.controlDependencies) {
+        computeControlDependencies(alg_type, lazy);
+        return;
+    }
+
+    cd_thread = std::thread([this, alg_type]() {
+        computeControlDependencies(alg_type);
+    });
+}
+
+void LLVMDependenceGraph::waitControlDependencies()
+{
+    if (cd_thread.joinable())
+        cd_thread.join();
+}
+
+void LLVMDependenceGraph::ensureDataDependencies()
+{
+    if (!dd_pending)
+        return;
+
+    dd_pending = false;
+    dd_analysis->addEdges(this);
+}
+
+void LLVMDependenceGraph::computeFunctionControlExpression(bool addCDs)
+{
+    LLVMCFABuilder builder;
+    llvm::Function *func = llvm::cast<llvm::Function>(getEntry()->getValue());
+    LLVMCFA cfa = builder.build(*func);
+
+    CE = cfa.compute();
+
+    if (addCDs) {
+        // compute the control scope
+        CE.computeSets();
+        auto& our_blocks = getBlocks();
+
+        for (llvm::BasicBlock& B : *func) {
+            LLVMBBlock *B1 = our_blocks[&B];
+
+            // if this block is a predicate block,
+            // we compute the control deps for it
+            // XXX: for now we compute the control
+            // scope, which is enough for slicing,
+            // but may add some extra (transitive)
+            // edges
+            if (B.getTerminator()->getNumSuccessors() > 1) {
+                auto CS = CE.getControlScope(&B);
+                for (auto cs : CS) {
+                    assert(cs->isa(LABEL));
+                    auto lab = static_cast<CELabel<llvm::BasicBlock *> *>(cs);
+                    LLVMBBlock *B2 = our_blocks[lab->getLabel()];
+                    B1->addControlDependence(B2);
                 }
             }
         }
@@ -878,4 +1407,79 @@ void LLVMDependenceGraph::makeSelfLoopsControlDependent()
     }
 }
 
+static void addNodeMemoryUsage(analysis::MemoryUsage& mu, const LLVMNode *n)
+{
+    if (!n)
+        return;
+
+    mu.add("nodes", 1, sizeof(LLVMNode));
+    mu.add("edges", n->getControlDependenciesNum() + n->getDataDependenciesNum(),
+           n->getEdgesAllocatedBytes());
+    mu.add("operands", n->getOperandsAllocatedBytes() / sizeof(LLVMNode *),
+           n->getOperandsAllocatedBytes());
+}
+
+static void addParametersMemoryUsage(analysis::MemoryUsage& mu,
+                                     const LLVMDGParameters *params)
+{
+    if (!params)
+        return;
+
+    mu.add("parameters", 0, sizeof(LLVMDGParameters)
+                            + params->getAllocatedBytes());
+    mu.add("blocks", 2, 2 * sizeof(LLVMBBlock)
+                        + params->getBBIn()->getAllocatedBytes()
+                        + params->getBBOut()->getAllocatedBytes());
+
+    auto addParameter = [&mu](const LLVMDGParameter& p) {
+        mu.add("parameters", 1, 0);
+        addNodeMemoryUsage(mu, p.in);
+        addNodeMemoryUsage(mu, p.out);
+    };
+
+    for (const auto& it : *params)
+        addParameter(it.second);
+    for (auto I = params->global_begin(), E = params->global_end(); I != E; ++I)
+        addParameter(I->second);
+    if (const LLVMDGParameter *vararg = params->getVarArg())
+        addParameter(*vararg);
+}
+
+void LLVMDependenceGraph::getMemoryUsage(analysis::MemoryUsage& mu) const
+{
+    if (const auto& globals = getGlobalNodes()) {
+        for (const auto& it : *globals)
+            addNodeMemoryUsage(mu, it.second);
+    }
+
+    for (const auto& F : getConstructedFunctions()) {
+        const LLVMDependenceGraph *graph = F.second;
+        mu.add("graphs", 1, sizeof(LLVMDependenceGraph));
+
+        for (const auto& it : *graph) {
+            addNodeMemoryUsage(mu, it.second);
+            addParametersMemoryUsage(mu, it.second->getParameters());
+        }
+
+        // the entry node (and the artificial exit node)
+        // are not in the map of nodes
+        addNodeMemoryUsage(mu, graph->getEntry());
+        LLVMNode *exit = graph->getExit();
+        if (exit) {
+            auto it = graph->getNodes()->find(exit->getKey());
+            if (it == graph->getNodes()->end() || it->second != exit)
+                addNodeMemoryUsage(mu, exit);
+        }
+
+        addParametersMemoryUsage(mu, graph->getParameters());
+
+        for (const auto& it : graph->getBlocks())
+            mu.add("blocks", 1, sizeof(LLVMBBlock) + it.second->getAllocatedBytes());
+        if (const LLVMBBlock *exitBB = graph->getExitBB()) {
+            if (graph->getBlocks().count(exitBB->getKey()) == 0)
+                mu.add("blocks", 1, sizeof(LLVMBBlock) + exitBB->getAllocatedBytes());
+        }
+    }
+}
+
 } // namespace dg
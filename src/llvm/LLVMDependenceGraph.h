@@ -13,19 +13,26 @@
 #endif
 
 #include <map>
+#include <memory>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 // forward declaration of llvm classes
 namespace llvm {
     class Module;
     class Value;
     class Function;
+    class CallInst;
 } // namespace llvm
 
 #include "LLVMNode.h"
 #include "DependenceGraph.h"
+#include "ADT/IndexedMap.h"
 
 #include "analysis/ControlExpression/ControlExpression.h"
+#include "analysis/MemoryUsage.h"
 
 namespace dg {
 
@@ -36,8 +43,26 @@ enum CD_ALG {
     CONTROL_EXPRESSION,
 };
 
+///
+// The kinds of the dependencies that are computed for the graph.
+// The modes that never walk some kind of them (e.g. the data-only
+// slices or the dumps without the control dependencies) do not compute
+// it at all, which saves the analyses and the edges. The edges that
+// are built with the graph (the parameters, the call-sites and the
+// entries of their subgraphs) are there always
+struct LLVMDGBuildOptions {
+    // the post-dominators (or control expressions)
+    // and the control dependencies of the blocks
+    bool controlDependencies = true;
+    // the reaching definitions and the def-use edges
+    bool dataDependencies = true;
+};
+
 // forward declaration
 class LLVMPointerAnalysis;
+class ControlDependenceCache;
+class LLVMDefUseAnalysis;
+namespace analysis { class LLVMModRefAnalysis; }
 
 using LLVMBBlock = dg::BBlock<LLVMNode>;
 
@@ -46,11 +71,61 @@ using LLVMBBlock = dg::BBlock<LLVMNode>;
 /// ------------------------------------------------------------------
 class LLVMDependenceGraph : public DependenceGraph<LLVMNode>
 {
+public:
+    // functions and their graphs
+    using ConstructedFunctionsT = ADT::IndexedMap<llvm::Value *, LLVMDependenceGraph *>;
+
+private:
     // our artificial unified exit block
     std::unique_ptr<LLVMBBlock> unifiedExitBB;
+
+    // the graphs of all the functions that were constructed,
+    // the registry is shared by the graph and all its subgraphs
+    std::shared_ptr<ConstructedFunctionsT> constructedFunctions;
+
+    // the functions that are not built (see buildOnlyRelevant()),
+    // shared by the graph and all its subgraphs
+    struct OpaqueFunctions;
+    std::shared_ptr<OpaqueFunctions> opaque;
+
+    // the functions called via pointers loaded by loadGraph(),
+    // used instead of the points-to information
+    using CalledFunctionsT = std::map<const llvm::Value *, std::vector<llvm::Function *>>;
+    std::shared_ptr<CalledFunctionsT> loadedCalls;
+
+    // the globals that the functions may touch, only these
+    // globals are the formal parameters (shared by all the graphs).
+    // Computed from the points-to information or loaded by loadGraph()
+    std::shared_ptr<analysis::LLVMModRefAnalysis> modref;
+
+    // the post-dominators and control dependencies of the functions
+    // computed earlier (also in other modules), shared by all the graphs
+    std::shared_ptr<ControlDependenceCache> cd_cache;
+    // adds the def-use edges of the functions on demand
+    // (see setLazyDataDependencies()), shared by all the graphs
+    std::shared_ptr<LLVMDefUseAnalysis> dd_analysis;
+
+    // the call-sites by the name of the called function and the nodes
+    // by their source lines, shared by the graph and its subgraphs
+    // (see getCallSites() and getLocationNodes())
+    struct CriteriaIndex;
+    std::shared_ptr<CriteriaIndex> criteriaIndex;
+
+    // the artificial nodes that stand for all the stores
+    // to a memory (see getMemoryHub())
+    struct MemoryHubs;
+    std::shared_ptr<MemoryHubs> memoryHubs;
+
+    // the instructions of this function that have no node
+    // (see isNonSemantic())
+    std::vector<llvm::Instruction *> nonSemantic;
+
 public:
     LLVMDependenceGraph()
-        : gather_callsites(nullptr), module(nullptr), PTA(nullptr) {}
+        : constructedFunctions(std::make_shared<ConstructedFunctionsT>()),
+          gather_callsites(nullptr), module(nullptr), PTA(nullptr),
+          build_threads(1), defer_linking(false), modref_globals(false),
+          cd_pending(false), cd_alg(CLASSIC), dd_pending(false) {}
 
     // free all allocated memory and unref subgraphs
     ~LLVMDependenceGraph();
@@ -66,11 +141,34 @@ public:
     // build subgraphs of called functions
     bool build(llvm::Function *func);
 
+    // build the blocks of the functions (and compute their post-dominators)
+    // using @n threads when building the graph from a module.
+    // Default is 1 (build sequentially)
+    void setBuildThreads(unsigned n) { build_threads = n; }
+
+    // select the dependencies that are computed for the graph,
+    // must be called before build()
+    void setBuildOptions(const LLVMDGBuildOptions& opts) { buildOptions = opts; }
+    const LLVMDGBuildOptions& getBuildOptions() const { return buildOptions; }
+
     bool addFormalParameter(llvm::Value *val);
     bool addFormalGlobal(llvm::Value *val);
 
     llvm::Module *getModule() const { return module; }
 
+    // the graphs of the functions of the module, including this one
+    const ConstructedFunctionsT& getConstructedFunctions() const
+    {
+        return *constructedFunctions;
+    }
+
+    // the graph of a function or nullptr if it was not constructed
+    LLVMDependenceGraph *getGraph(llvm::Value *func) const
+    {
+        auto it = constructedFunctions->find(func);
+        return it == constructedFunctions->end() ? nullptr : it->second;
+    }
+
     // if we want to slice according some call-site(s),
     // we can gather the relevant call-sites while building
     // graph and do not need to recursively find in the graph
@@ -83,14 +181,50 @@ public:
         gatheredCallsites = callSites;
     }
 
-    // go through the graph and find all (possible) call-sites
-    // for a function
-    // FIXME: can implement via getCallNodes
+    // find all (possible) call-sites for a function. The call-sites
+    // are looked up in an index built at the first query
     bool getCallSites(const char *name, std::set<LLVMNode *> *callsites);
     // this method takes NULL-terminated array of names
     bool getCallSites(const char *names[], std::set<LLVMNode *> *callsites);
     bool getCallSites(const std::vector<std::string>& names, std::set<LLVMNode *> *callsites);
 
+    // find the nodes of the instructions at the source locations
+    // 'file:line[:col]' (see parseLocation()), the file matches also
+    // the paths that end with it. Uses the same index as getCallSites()
+    bool getLocationNodes(const std::vector<std::string>& locations,
+                          std::set<LLVMNode *> *nodes);
+
+    // is @str a source location 'file:line[:col]'? Then set its parts,
+    // @col is 0 if it is not given
+    static bool parseLocation(const std::string& str, std::string& file,
+                              unsigned& line, unsigned& col);
+
+    // build the graphs only for the functions from which a call
+    // of a function from @names (or an instruction at a source location
+    // from @names) can be reached in the call graph (the slicing criteria). The other functions are opaque, their
+    // call-sites have no subgraphs and the def-use analysis summarizes
+    // them at the call-sites. Must be called before build()
+    void buildOnlyRelevant(const std::vector<std::string>& names);
+
+    // the function is defined, but its graph is not built
+    bool isOpaque(const llvm::Function *func) const;
+    // may the call-site call an opaque function?
+    bool callsOpaque(LLVMNode *callNode) const;
+    // the call-sites in the built graphs from which the opaque function
+    // can be called (directly or via other opaque functions)
+    const std::set<LLVMNode *> *getOpaqueCallSites(const llvm::Function *func) const;
+
+    // the artificial node (a hub) that stands for all the stores to the
+    // memory allocated by @mem. The loads that may read any of the stores
+    // depend on the hub and the hub depends on the stores, so the graph
+    // has an edge for every load and every store instead of for every
+    // pair of them. The hub belongs to no graph and it is freed with
+    // this graph. @created is set when the hub is created by this call,
+    // the caller adds the edges from the stores then. Thread-safe
+    LLVMNode *getMemoryHub(const llvm::Value *mem, bool *created = nullptr);
+    // the memory and its hub for all the created hubs
+    std::vector<std::pair<const llvm::Value *, LLVMNode *>> getMemoryHubs() const;
+
     // FIXME we need remove the callsite from here if we slice away
     // the callsite
     const std::set<LLVMNode *>& getCallNodes() const { return callNodes; }
@@ -104,8 +238,25 @@ public:
 
     void makeSelfLoopsControlDependent();
 
-    void computeControlDependencies(enum CD_ALG alg_type)
+    // compute the control dependencies of all the functions. With @lazy,
+    // the control dependencies of a function are computed only when
+    // a walk of the graph gets into the function (see
+    // ensureControlDependencies()), so the functions that are not
+    // in any slice are skipped
+    void computeControlDependencies(enum CD_ALG alg_type, bool lazy = false)
     {
+        if (!buildOptions.controlDependencies)
+            return;
+
+        for (auto& F : getConstructedFunctions()) {
+            F.second->cd_pending = lazy;
+            F.second->cd_alg = alg_type;
+            F.second->cd_cache = cd_cache;
+        }
+
+        if (lazy)
+            return;
+
         if (alg_type == CLASSIC) {
             computePostDominators(true);
             //makeSelfLoopsControlDependent();
@@ -115,7 +266,77 @@ public:
             abort();
     }
 
-    bool verify() const;
+    // start computeControlDependencies() in a new thread, so that
+    // the control dependencies are computed while the analyses
+    // of memory (reaching definitions, def-use) run. They use only
+    // the blocks of the graphs, but nothing else may use the blocks
+    // until waitControlDependencies() returns
+    void computeControlDependenciesAsync(enum CD_ALG alg_type, bool lazy = false);
+    // wait until the control dependencies started by
+    // computeControlDependenciesAsync() are computed
+    void waitControlDependencies();
+
+    // take the post-dominators and control dependencies (-cd-alg classic)
+    // of the functions whose CFG is in @cache from it and add the new
+    // ones there, must be set before computeControlDependencies()
+    void setControlDependenceCache(std::shared_ptr<ControlDependenceCache> cache)
+    {
+        cd_cache = std::move(cache);
+    }
+
+    /* virtual */
+    void ensureControlDependencies()
+    {
+        if (!cd_pending)
+            return;
+
+        cd_pending = false;
+        if (cd_alg == CLASSIC)
+            computeFunctionPostDominators(true);
+        else
+            computeFunctionControlExpression(true);
+    }
+
+    // add the def-use edges of a function by @DUA only when a backward walk
+    // gets into the function (see ensureDataDependencies()) instead of
+    // running @DUA over all the functions, so the functions that are not
+    // in any slice get no edges. The forward walks would miss the edges
+    // of the functions that were not walked backwards yet, so only
+    // the backward walks can be used then. The analyses used by @DUA
+    // must be kept until the walks are done
+    void setLazyDataDependencies(std::shared_ptr<LLVMDefUseAnalysis> DUA)
+    {
+        for (auto& F : getConstructedFunctions()) {
+            F.second->dd_analysis = DUA;
+            F.second->dd_pending = true;
+        }
+    }
+
+    /* virtual */
+    void ensureDataDependencies();
+
+    // check the graphs of the functions (using @threads threads)
+    bool verify(unsigned threads = 1) const;
+
+    // add the approximate memory used by the graphs of all the functions
+    // (nodes, edge containers, blocks and parameters) to @mu
+    void getMemoryUsage(analysis::MemoryUsage& mu) const;
+
+    // save the dependence edges (control dependencies of nodes and blocks
+    // and data dependencies) and the functions called via pointers into
+    // @file, so that the later runs on the same module can load the graph
+    // with loadGraph() instead of running the analyses. @key should
+    // identify the module and the options of the analyses,
+    // it is checked when loading the file. Call it on the graph of module
+    // after all the edges were computed, the points-to information
+    // must be still available
+    bool saveGraph(const std::string& file, uint64_t key) const;
+
+    // build the graph of module (like build()) with the edges from @file
+    // created by saveGraph(). Returns false if the file cannot be used,
+    // the graph is not built in that case
+    bool loadGraph(llvm::Module *m, const std::string& file, uint64_t key,
+                   llvm::Function *entry = nullptr);
 
     /* virtual */
     void setSlice(uint64_t sid)
@@ -131,9 +352,33 @@ public:
 
     LLVMPointerAnalysis *getPTA() const { return PTA; }
 
+    // the instructions that can not affect any slice (the debug
+    // intrinsics, the lifetime markers and the annotations) get no node,
+    // they are only remembered so that the slicer removes them
+    static bool isNonSemantic(const llvm::Instruction& I);
+
+    const std::vector<llvm::Instruction *>& getNonSemanticInstructions() const
+    {
+        return nonSemantic;
+    }
+
+    void clearNonSemanticInstructions() { nonSemantic.clear(); }
+
+    // forget the points-to analysis in all the graphs when it is freed,
+    // the graphs must not be built or saved (saveGraph) after that
+    void releasePTA()
+    {
+        PTA = nullptr;
+        for (auto& it : getConstructedFunctions())
+            it.second->PTA = nullptr;
+    }
+
 private:
     void computePostDominators(bool addPostDomFrontiers = false);
     void computeControlExpression(bool addCDs = false);
+    // the same for the function of this graph only
+    void computeFunctionPostDominators(bool addPostDomFrontiers);
+    void computeFunctionControlExpression(bool addCDs);
 
     // add formal parameters of the function to the graph
     // (graph is a graph of one procedure)
@@ -150,6 +395,33 @@ private:
     // setting first and last instructions
     LLVMBBlock *build(llvm::BasicBlock& BB);
 
+    // the parts of build(llvm::Function *): create the entry node
+    // and the formal parameters, build the blocks of the function
+    // and (if it was deferred) handle the instructions of the blocks
+    void buildEntry(llvm::Function *func);
+    void buildBlocks(llvm::Function *func);
+    void linkCallSites();
+
+    // build the graphs of all functions reachable from the entry,
+    // the blocks of the functions are built in parallel
+    void buildParallel(llvm::Function *entry);
+
+    // create graph for a called function that shares
+    // the global nodes and the settings with this graph
+    LLVMDependenceGraph *createSubgraph();
+
+    // get the defined functions that can be called by the call-site
+    void getCallees(llvm::CallInst *CInst, std::vector<llvm::Function *>& funcs,
+                    bool warn = true) const;
+
+    // find the functions that are built with buildOnlyRelevant()
+    // and the call-sites of the opaque functions after building
+    void computeRelevantFunctions(llvm::Function *entry);
+
+    // the index of the criteria, (re)built when there are new graphs
+    CriteriaIndex& getCriteriaIndex();
+    void computeOpaqueCallSites();
+
     // gather call-sites of functions with given name
     // when building the graph
     std::set<LLVMNode *> *gatheredCallsites;
@@ -169,13 +441,30 @@ private:
     // control expression for this graph
     ControlExpression CE;
 
+    // number of threads used to build the graph from module
+    unsigned build_threads;
+    // the dependencies computed for the graph (shared by the subgraphs)
+    LLVMDGBuildOptions buildOptions;
+    // the blocks were built without handling the instructions,
+    // the call-sites are not linked to the subgraphs yet
+    bool defer_linking;
+    // the formal globals of this function are given by the mod/ref
+    // information, not by the instructions that use the globals
+    bool modref_globals;
+    // the control dependencies of this function are computed lazily
+    // and they were not computed yet (see computeControlDependencies())
+    bool cd_pending;
+    enum CD_ALG cd_alg;
+    // the def-use edges of this function are added on demand and they
+    // were not added yet (see setLazyDataDependencies())
+    bool dd_pending;
+    // computes the control dependencies (computeControlDependenciesAsync())
+    std::thread cd_thread;
+
     // verifier needs access to private elements
     friend class LLVMDGVerifier;
 };
 
-const std::map<llvm::Value *,
-               LLVMDependenceGraph *>& getConstructedFunctions();
-
 } // namespace dg
 
 #endif // _DEPENDENCE_GRAPH_H_
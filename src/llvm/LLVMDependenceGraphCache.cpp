@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "LLVMDependenceGraph.h"
+#include "CacheFile.h"
+#include "llvm/analysis/ModRef.h"
+
+///
+// Format of the file (see llvm/CacheFile.h):
+//
+//  magic (8 bytes), key (u64), number of llvm values in the module (u32)
+//  number of calls via function pointers (u32)
+//      call: callsite value id (u32), number of functions (u32),
+//            function value id (u32) for every function
+//  number of functions with mod/ref information (u32)
+//      function: function value id (u32), number of globals (u32),
+//                global value id (u32) for every global it may touch
+//  number of nodes (u32), number of blocks (u32)
+//  number of control dependencies of nodes (u32)
+//      edge: node index (u32), node index (u32)
+//  number of data dependencies (u32)
+//      edge: node index (u32), node index (u32)
+//  number of control dependencies of blocks (u32)
+//      edge: block index (u32), block index (u32)
+//
+// Values are identified by their number in ValuesNumbering, the nodes
+// and blocks by their index in GraphNumbering. The structure of the graph
+// (the nodes, blocks, subgraphs and parameters) is built again
+// when loading, only the edges computed by the analyses are stored.
+
+namespace dg {
+
+namespace {
+
+const char MAGIC[8] = {'D', 'G', 'G', 'R', 'P', 'H', '3', '\0'};
+
+enum EdgeKind {
+    NODE_CD = 0,
+    NODE_DD,
+    BLOCK_CD,
+    EDGE_KINDS_NUM
+};
+
+using EdgesT = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Numbering of the nodes and blocks of a graph that is the same
+// every time the graph is built from the same module. The graphs
+// are taken in the order of the functions in the module,
+// the nodes of a graph in the order of the instructions
+// and the parameters in the order of their values.
+struct GraphNumbering {
+    std::vector<LLVMNode *> nodes;
+    std::vector<LLVMBBlock *> blocks;
+    std::unordered_map<const LLVMNode *, uint32_t> nodeIds;
+    std::unordered_map<const LLVMBBlock *, uint32_t> blockIds;
+    // all the parameters have the values numbered
+    bool valid = true;
+
+    void addNode(LLVMNode *n)
+    {
+        if (n && nodeIds.emplace(n, nodes.size()).second)
+            nodes.push_back(n);
+    }
+
+    void addBlock(LLVMBBlock *B)
+    {
+        if (B && blockIds.emplace(B, blocks.size()).second)
+            blocks.push_back(B);
+    }
+
+    void addParameters(LLVMDGParameters *params, const ValuesNumbering& values)
+    {
+        if (!params)
+            return;
+
+        // the parameters are in maps ordered by the pointers,
+        // order them by the numbers of the values
+        std::vector<std::pair<std::pair<bool, uint32_t>, LLVMDGParameter *>> sorted;
+        for (auto& it : *params) {
+            uint32_t id;
+            valid &= values.getId(it.first, id);
+            sorted.emplace_back(std::make_pair(false, id), &it.second);
+        }
+
+        for (auto I = params->global_begin(), E = params->global_end(); I != E; ++I) {
+            uint32_t id;
+            valid &= values.getId(I->first, id);
+            sorted.emplace_back(std::make_pair(true, id), &I->second);
+        }
+
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const decltype(sorted)::value_type& a,
+                     const decltype(sorted)::value_type& b) {
+                      return a.first < b.first;
+                  });
+
+        for (auto& it : sorted) {
+            addNode(it.second->in);
+            addNode(it.second->out);
+        }
+
+        if (LLVMDGParameter *vararg = params->getVarArg()) {
+            addNode(vararg->in);
+            addNode(vararg->out);
+        }
+    }
+
+    GraphNumbering(const LLVMDependenceGraph *dg, const ValuesNumbering& values)
+    {
+        const llvm::Module *M = dg->getModule();
+        const auto& globals = dg->getGlobalNodes();
+        if (globals) {
+            for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
+                auto it = globals->find(const_cast<llvm::GlobalVariable *>(&*I));
+                if (it != globals->end())
+                    addNode(it->second);
+            }
+        }
+
+        for (const llvm::Function& F : *M) {
+            LLVMDependenceGraph *graph
+                = dg->getGraph(const_cast<llvm::Function *>(&F));
+            if (!graph)
+                continue;
+
+            addNode(graph->getEntry());
+            addParameters(graph->getParameters(), values);
+
+            const auto& graphBlocks = graph->getBlocks();
+            for (const llvm::BasicBlock& B : F) {
+                auto it = graphBlocks.find(const_cast<llvm::BasicBlock *>(&B));
+                if (it == graphBlocks.end())
+                    continue;
+
+                addBlock(it->second);
+                for (LLVMNode *n : it->second->getNodes()) {
+                    addNode(n);
+                    addParameters(n->getParameters(), values);
+                }
+            }
+
+            addNode(graph->getExit());
+            addBlock(graph->getExitBB());
+        }
+    }
+};
+
+} // anonymous namespace
+
+bool LLVMDependenceGraph::saveGraph(const std::string& file, uint64_t key) const
+{
+    ValuesNumbering values(module);
+    GraphNumbering numbering(this, values);
+    if (!numbering.valid)
+        return false;
+
+    // the functions called via pointers, in the order
+    // in which build() gets them
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> calls;
+    std::vector<llvm::Function *> callees;
+    for (const auto& it : getConstructedFunctions()) {
+        for (llvm::BasicBlock& B : *llvm::cast<llvm::Function>(it.first)) {
+            for (llvm::Instruction& I : B) {
+                auto *CInst = llvm::dyn_cast<llvm::CallInst>(&I);
+                if (!CInst || llvm::isa<llvm::Function>(
+                                CInst->getCalledValue()->stripPointerCasts()))
+                    continue;
+
+                callees.clear();
+                getCallees(CInst, callees, false /* warn */);
+                if (callees.empty())
+                    continue;
+
+                uint32_t cid;
+                if (!values.getId(CInst, cid))
+                    return false;
+
+                calls.emplace_back(cid, std::vector<uint32_t>());
+                for (llvm::Function *F : callees) {
+                    uint32_t fid;
+                    if (!values.getId(F, fid))
+                        return false;
+                    calls.back().second.push_back(fid);
+                }
+            }
+        }
+    }
+
+    // the globals of the functions, the loaded graph
+    // must have the same formal parameters
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> modrefs;
+    if (modref) {
+        for (const llvm::Function& F : *module) {
+            const auto *globals = modref->getGlobals(&F);
+            if (!globals)
+                continue;
+
+            uint32_t fid;
+            if (!values.getId(&F, fid))
+                return false;
+
+            modrefs.emplace_back(fid, std::vector<uint32_t>());
+            for (llvm::GlobalVariable *GV : *globals) {
+                uint32_t gid;
+                if (!values.getId(GV, gid))
+                    return false;
+                modrefs.back().second.push_back(gid);
+            }
+        }
+    }
+
+    // all the edges must go between the numbered nodes and blocks,
+    // otherwise we could not load them
+    EdgesT edges[EDGE_KINDS_NUM];
+    for (uint32_t i = 0; i < numbering.nodes.size(); ++i) {
+        LLVMNode *n = numbering.nodes[i];
+        for (auto I = n->control_begin(), E = n->control_end(); I != E; ++I) {
+            auto it = numbering.nodeIds.find(*I);
+            if (it == numbering.nodeIds.end())
+                return false;
+            edges[NODE_CD].emplace_back(i, it->second);
+        }
+
+        for (auto I = n->data_begin(), E = n->data_end(); I != E; ++I) {
+            auto it = numbering.nodeIds.find(*I);
+            if (it == numbering.nodeIds.end())
+                return false;
+            edges[NODE_DD].emplace_back(i, it->second);
+        }
+    }
+
+    for (uint32_t i = 0; i < numbering.blocks.size(); ++i) {
+        for (LLVMBBlock *B : numbering.blocks[i]->controlDependence()) {
+            auto it = numbering.blockIds.find(B);
+            if (it == numbering.blockIds.end())
+                return false;
+            edges[BLOCK_CD].emplace_back(i, it->second);
+        }
+    }
+
+    CacheWriter out(file);
+    out.write(MAGIC, sizeof MAGIC);
+    out.write64(key);
+    out.write32(values.values.size());
+
+    out.write32(calls.size());
+    for (const auto& call : calls) {
+        out.write32(call.first);
+        out.write32(call.second.size());
+        for (uint32_t fid : call.second)
+            out.write32(fid);
+    }
+
+    out.write32(modrefs.size());
+    for (const auto& mr : modrefs) {
+        out.write32(mr.first);
+        out.write32(mr.second.size());
+        for (uint32_t gid : mr.second)
+            out.write32(gid);
+    }
+
+    out.write32(numbering.nodes.size());
+    out.write32(numbering.blocks.size());
+    for (unsigned k = 0; k < EDGE_KINDS_NUM; ++k) {
+        out.write32(edges[k].size());
+        for (const auto& edge : edges[k]) {
+            out.write32(edge.first);
+            out.write32(edge.second);
+        }
+    }
+
+    return out.good();
+}
+
+bool LLVMDependenceGraph::loadGraph(llvm::Module *m, const std::string& file,
+                                    uint64_t key, llvm::Function *entry)
+{
+    auto buf = llvm::MemoryBuffer::getFile(file);
+    if (!buf)
+        return false;
+
+    CacheReader in(*buf.get());
+    ValuesNumbering values(m);
+    uint32_t values_num = values.values.size();
+
+    // read and check the whole file before we build anything
+    char magic[sizeof MAGIC];
+    uint64_t file_key;
+    uint32_t num;
+    if (!in.read(magic, sizeof magic) || memcmp(magic, MAGIC, sizeof MAGIC) != 0
+        || !in.read64(file_key) || file_key != key
+        || !in.read32(num) || num != values_num)
+        return false;
+
+    uint32_t calls_num;
+    if (!in.read32(calls_num))
+        return false;
+
+    auto calls = std::make_shared<CalledFunctionsT>();
+    for (uint32_t i = 0; i < calls_num; ++i) {
+        uint32_t cid, funcs_num;
+        if (!in.read32(cid) || cid >= values_num
+            || !llvm::isa<llvm::CallInst>(values.values[cid])
+            || !in.read32(funcs_num))
+            return false;
+
+        auto& funcs = (*calls)[values.values[cid]];
+        for (uint32_t j = 0; j < funcs_num; ++j) {
+            uint32_t fid;
+            if (!in.read32(fid) || fid >= values_num
+                || !llvm::isa<llvm::Function>(values.values[fid]))
+                return false;
+
+            funcs.push_back(const_cast<llvm::Function *>(
+                                llvm::cast<llvm::Function>(values.values[fid])));
+        }
+    }
+
+    uint32_t modrefs_num;
+    if (!in.read32(modrefs_num))
+        return false;
+
+    std::shared_ptr<analysis::LLVMModRefAnalysis> loadedModRef;
+    if (modrefs_num > 0)
+        loadedModRef = std::make_shared<analysis::LLVMModRefAnalysis>(m);
+    for (uint32_t i = 0; i < modrefs_num; ++i) {
+        uint32_t fid, globals_num;
+        if (!in.read32(fid) || fid >= values_num
+            || !llvm::isa<llvm::Function>(values.values[fid])
+            || !in.read32(globals_num))
+            return false;
+
+        analysis::LLVMModRefAnalysis::GlobalsT globals;
+        for (uint32_t j = 0; j < globals_num; ++j) {
+            uint32_t gid;
+            if (!in.read32(gid) || gid >= values_num
+                || !llvm::isa<llvm::GlobalVariable>(values.values[gid]))
+                return false;
+
+            globals.push_back(const_cast<llvm::GlobalVariable *>(
+                                llvm::cast<llvm::GlobalVariable>(values.values[gid])));
+        }
+
+        loadedModRef->setGlobals(llvm::cast<llvm::Function>(values.values[fid]),
+                                 std::move(globals));
+    }
+
+    uint32_t nodes_num, blocks_num;
+    if (!in.read32(nodes_num) || !in.read32(blocks_num))
+        return false;
+
+    EdgesT edges[EDGE_KINDS_NUM];
+    for (unsigned k = 0; k < EDGE_KINDS_NUM; ++k) {
+        uint32_t edges_num;
+        if (!in.read32(edges_num))
+            return false;
+
+        uint32_t limit = k == BLOCK_CD ? blocks_num : nodes_num;
+        edges[k].resize(edges_num);
+        for (auto& edge : edges[k]) {
+            if (!in.read32(edge.first) || !in.read32(edge.second)
+                || edge.first >= limit || edge.second >= limit)
+                return false;
+        }
+    }
+
+    if (!in.atEnd())
+        return false;
+
+    // build the graph, the calls via pointers
+    // are taken from the file
+    loadedCalls = calls;
+    modref = loadedModRef;
+    if (!build(m, entry))
+        return false;
+
+    GraphNumbering numbering(this, values);
+    // the file is for the same module and options,
+    // so we must have built the same graph
+    assert(numbering.valid && numbering.nodes.size() == nodes_num
+           && numbering.blocks.size() == blocks_num
+           && "The file does not match the module");
+    if (!numbering.valid || numbering.nodes.size() != nodes_num
+        || numbering.blocks.size() != blocks_num) {
+        llvm::errs() << "ERROR: the graph in " << file
+                     << " does not match the module\n";
+        return false;
+    }
+
+    for (const auto& edge : edges[NODE_CD])
+        numbering.nodes[edge.first]->addControlDependence(numbering.nodes[edge.second]);
+    for (const auto& edge : edges[NODE_DD])
+        numbering.nodes[edge.first]->addDataDependence(numbering.nodes[edge.second]);
+    for (const auto& edge : edges[BLOCK_CD])
+        numbering.blocks[edge.first]->addControlDependence(numbering.blocks[edge.second]);
+
+    return true;
+}
+
+} // namespace dg
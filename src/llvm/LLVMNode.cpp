@@ -31,14 +31,53 @@
 
 #include "LLVMNode.h"
 #include "LLVMDependenceGraph.h"
+#include "ADT/Arena.h"
 
 using llvm::errs;
 
 namespace dg {
 
+// The pool and the arena are never destroyed, so that nodes
+// deleted during the destruction of static objects are fine.
+// They release their memory when the last node is deleted anyway.
+static ADT::Pool<LLVMNode>& getNodesPool()
+{
+    static auto *pool = new ADT::Pool<LLVMNode>();
+    return *pool;
+}
+
+static ADT::ArrayArena<LLVMNode *>& getOperandsArena()
+{
+    static auto *arena = new ADT::ArrayArena<LLVMNode *>();
+    return *arena;
+}
+
+void *LLVMNode::operator new(size_t size)
+{
+    assert(size == sizeof(LLVMNode));
+    (void) size;
+    return getNodesPool().allocate();
+}
+
+void LLVMNode::operator delete(void *mem)
+{
+    if (!mem)
+        return;
+
+    ADT::Pool<LLVMNode>& pool = getNodesPool();
+    pool.deallocate(mem);
+    // no node is left, so no one uses the operand arrays
+    if (pool.size() == 0)
+        getOperandsArena().clear();
+}
+
+void LLVMNode::setConcurrent(bool c)
+{
+    getNodesPool().setConcurrent(c);
+}
+
 LLVMNode::~LLVMNode()
 {
-    delete[] operands;
 }
 
 void LLVMNode::dump() const {
@@ -56,11 +95,11 @@ LLVMNode **LLVMNode::findOperands()
 
     // we have Function nodes stored in globals
     if (isa<AllocaInst>(val)) {
-        operands = new LLVMNode *[1];
+        operands = getOperandsArena().allocate(1);
         operands[0] = dg->getNode(val);
         operands_num = 1;
     } else if (StoreInst *Inst = dyn_cast<StoreInst>(val)) {
-        operands = new LLVMNode *[2];
+        operands = getOperandsArena().allocate(2);
         operands[0] = dg->getNode(Inst->getPointerOperand());
         operands[1] = dg->getNode(Inst->getValueOperand());
 #ifdef DEBUG_ENABLED
@@ -71,7 +110,7 @@ LLVMNode **LLVMNode::findOperands()
 #endif
         operands_num = 2;
     } else if (LoadInst *Inst = dyn_cast<LoadInst>(val)) {
-        operands = new LLVMNode *[1];
+        operands = getOperandsArena().allocate(1);
         Value *op = Inst->getPointerOperand();
         operands[0] = dg->getNode(op);
 #ifdef DEBUG_ENABLED
@@ -80,36 +119,36 @@ LLVMNode **LLVMNode::findOperands()
 #endif
         operands_num = 1;
     } else if (GetElementPtrInst *Inst = dyn_cast<GetElementPtrInst>(val)) {
-        operands = new LLVMNode *[1];
+        operands = getOperandsArena().allocate(1);
         operands[0] = dg->getNode(Inst->getPointerOperand());
         operands_num = 1;
     } else if (CallInst *Inst = dyn_cast<CallInst>(val)) {
         // we store the called function as a first operand
         // and all the arguments as the other operands
         operands_num = Inst->getNumArgOperands() + 1;
-        operands = new LLVMNode *[operands_num];
+        operands = getOperandsArena().allocate(operands_num);
         operands[0] = dg->getNode(Inst->getCalledValue());
         for (unsigned i = 0; i < operands_num - 1; ++i)
             operands[i + 1] = dg->getNode(Inst->getArgOperand(i));
     } else if (ReturnInst *Inst = dyn_cast<ReturnInst>(val)) {
-        operands = new LLVMNode *[1];
+        operands = getOperandsArena().allocate(1);
         operands[0] = dg->getNode(Inst->getReturnValue());
         operands_num = 1;
     } else if (CastInst *Inst = dyn_cast<CastInst>(val)) {
-        operands = new LLVMNode *[1];
+        operands = getOperandsArena().allocate(1);
         operands[0] = dg->getNode(Inst->stripPointerCasts());
         if (!operands[0])
             errs() << "WARN: CastInst with unstrippable pointer cast" << *Inst << "\n";
         operands_num = 1;
     } else if (PHINode *Inst = dyn_cast<PHINode>(val)) {
         operands_num = Inst->getNumIncomingValues();
-        operands = new LLVMNode *[operands_num];
+        operands = getOperandsArena().allocate(operands_num);
         for (unsigned n = 0; n < operands_num; ++n) {
             operands[n] = dg->getNode(Inst->getIncomingValue(n));
         }
     } else if (SelectInst *Inst = dyn_cast<SelectInst>(val)) {
         operands_num = 2;
-        operands = new LLVMNode *[operands_num];
+        operands = getOperandsArena().allocate(operands_num);
         for (unsigned n = 0; n < operands_num; ++n) {
             operands[n] = dg->getNode(Inst->getOperand(n + 1));
         }
@@ -58,6 +58,14 @@ public:
 
     ~LLVMNode();
 
+    // the nodes are allocated from a pool and their operand arrays
+    // from an arena, the memory is released all at once when
+    // the last node is deleted
+    static void *operator new(size_t size);
+    static void operator delete(void *mem);
+    // nodes are going to be created from more threads at once
+    static void setConcurrent(bool c);
+
     llvm::Value *getValue() const { return getKey(); }
 
     // create new subgraph with actual parameters that are given
@@ -70,6 +78,11 @@ public:
 
     LLVMNode **getOperands();
     size_t getOperandsNum();
+    // the memory of the operands array (0 if we have not found them yet)
+    size_t getOperandsAllocatedBytes() const
+    {
+        return operands_num * sizeof(LLVMNode *);
+    }
     LLVMNode *getOperand(unsigned int idx);
     LLVMNode *setOperand(LLVMNode *op, unsigned int idx);
 
@@ -88,7 +101,8 @@ public:
 private:
     LLVMNode **findOperands();
     // here we can store operands of instructions so that
-    // finding them will be asymptotically constant
+    // finding them will be asymptotically constant.
+    // The array is allocated in the arena, so we do not free it
     LLVMNode **operands;
     size_t operands_num;
 
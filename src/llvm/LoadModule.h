@@ -0,0 +1,238 @@
+#ifndef _DG_LLVM_LOAD_MODULE_H_
+#define _DG_LLVM_LOAD_MODULE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+
+#if LLVM_VERSION_MAJOR >= 4
+#include <llvm/Linker/Linker.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#endif
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/BitcodePrefetcher.h"
+
+#if ((LLVM_VERSION_MAJOR > 3) || (LLVM_VERSION_MINOR > 5))
+
+namespace dg {
+
+namespace detail {
+
+inline llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+openModuleFile(const std::string& file, bool nullTerminated)
+{
+#if LLVM_VERSION_MAJOR >= 13
+    return llvm::MemoryBuffer::getFileOrSTDIN(file, nullTerminated /* text */,
+                                              nullTerminated);
+#else
+    return llvm::MemoryBuffer::getFileOrSTDIN(file, -1, nullTerminated);
+#endif
+}
+
+// raw bitcode or bitcode in the wrapper
+inline bool isBitcode(const llvm::MemoryBuffer& buf)
+{
+    const unsigned char *p
+        = reinterpret_cast<const unsigned char *>(buf.getBufferStart());
+    if (buf.getBufferSize() < 4)
+        return false;
+
+    return (p[0] == 'B' && p[1] == 'C' && p[2] == 0xc0 && p[3] == 0xde)
+           || (p[0] == 0xde && p[1] == 0xc0 && p[2] == 0x17 && p[3] == 0x0b);
+}
+
+} // namespace detail
+
+// Load the module from @file (bitcode or textual IR, "-" is the standard
+// input) like llvm::parseIRFile() or llvm::getLazyIRFileModule() with @lazy.
+// The bitcode does not need the terminating null, so the file is always
+// mapped into memory instead of being read into a buffer on the heap.
+// The eagerly loaded module does not keep the mapping, the lazily loaded
+// one keeps it to materialize the functions from it later.
+// The textual IR is read as by llvm::parseIRFile().
+// The mapped bitcode of the lazily loaded module is read ahead
+// by @prefetcher if it is given (see BitcodePrefetcher)
+inline std::unique_ptr<llvm::Module> loadModule(const std::string& file,
+                                                llvm::SMDiagnostic& SMD,
+                                                llvm::LLVMContext& context,
+                                                bool lazy = false,
+                                                BitcodePrefetcher *prefetcher = nullptr)
+{
+    auto buf = detail::openModuleFile(file, file == "-");
+    if (buf && file != "-" && !detail::isBitcode(*buf.get()))
+        buf = detail::openModuleFile(file, true);
+
+    if (!buf) {
+        SMD = llvm::SMDiagnostic(file, llvm::SourceMgr::DK_Error,
+                                 "Could not open input file: "
+                                 + buf.getError().message());
+        return nullptr;
+    }
+
+    if (lazy) {
+        // the buffer is owned by the module from now on
+        const llvm::MemoryBuffer& mem = *buf.get();
+        auto M = llvm::getLazyIRModule(std::move(buf.get()), SMD, context);
+        if (M && prefetcher && file != "-" && detail::isBitcode(mem))
+            prefetcher->add(mem.getBufferStart(), mem.getBufferSize());
+        return M;
+    }
+
+    return llvm::parseIR(buf.get()->getMemBufferRef(), SMD, context);
+}
+
+#if LLVM_VERSION_MAJOR >= 4
+
+namespace detail {
+
+// the metadata with the index of the input file of a definition
+inline const char *inputIndexMD() { return "dg.input"; }
+
+inline void setInputIndex(llvm::GlobalObject& GO, unsigned idx)
+{
+    llvm::LLVMContext& ctx = GO.getContext();
+    auto *C = llvm::ConstantInt::get(llvm::Type::getInt32Ty(ctx), idx);
+    GO.setMetadata(inputIndexMD(),
+                   llvm::MDNode::get(ctx, llvm::ConstantAsMetadata::get(C)));
+}
+
+inline void setInputIndex(llvm::Module& M, unsigned idx)
+{
+    // the lazily loaded functions are not declarations either
+    for (llvm::Function& F : M) {
+        if (!F.isDeclaration())
+            setInputIndex(F, idx);
+    }
+
+    for (llvm::GlobalVariable& G : M.globals()) {
+        if (!G.isDeclaration())
+            setInputIndex(G, idx);
+    }
+}
+
+} // namespace detail
+
+// The index of the input file (see loadModules()) that the definition
+// @GV comes from. The values without the index (the declarations and
+// the values created after linking) belong to the first file
+inline unsigned getInputIndex(const llvm::GlobalValue *GV)
+{
+    if (auto *GA = llvm::dyn_cast<llvm::GlobalAlias>(GV))
+        GV = llvm::dyn_cast<llvm::GlobalValue>(
+                GA->getAliasee()->stripPointerCasts());
+
+    auto *GO = llvm::dyn_cast_or_null<llvm::GlobalObject>(GV);
+    llvm::MDNode *MD = GO ? GO->getMetadata(detail::inputIndexMD()) : nullptr;
+    if (!MD)
+        return 0;
+
+    return llvm::mdconst::extract<llvm::ConstantInt>(MD->getOperand(0))
+            ->getZExtValue();
+}
+
+// Load the modules from @files (as loadModule()) and link them into
+// the first one as llvm-link would do, just in memory, so that the
+// program can be analyzed without linking it on the disk first.
+// The calls and globals are resolved between the modules by the names
+// of the symbols. Every definition remembers the index of the file that
+// it comes from (see getInputIndex()), so that the module can be split
+// into the parts of the files again (see extractInput()).
+// The modules are parsed one by one, they share @context.
+// Only the first module is read ahead by @prefetcher, the others
+// are materialized whole by the linker right away
+inline std::unique_ptr<llvm::Module>
+loadModules(const std::vector<std::string>& files,
+            llvm::SMDiagnostic& SMD,
+            llvm::LLVMContext& context,
+            bool lazy = false,
+            BitcodePrefetcher *prefetcher = nullptr)
+{
+    std::unique_ptr<llvm::Module> M;
+    for (unsigned idx = 0; idx < files.size(); ++idx) {
+        auto part = loadModule(files[idx], SMD, context, lazy,
+                               idx == 0 ? prefetcher : nullptr);
+        if (!part) {
+            if (prefetcher)
+                prefetcher->stop();
+            return nullptr;
+        }
+
+        detail::setInputIndex(*part, idx);
+        if (!M) {
+            M = std::move(part);
+            continue;
+        }
+
+        // the definitions of the lazily loaded module are
+        // materialized by the linker when they are linked in
+        if (llvm::Linker::linkModules(*M, std::move(part))) {
+            SMD = llvm::SMDiagnostic(files[idx], llvm::SourceMgr::DK_Error,
+                                     "Linking the module failed");
+            if (prefetcher)
+                prefetcher->stop();
+            return nullptr;
+        }
+    }
+
+    return M;
+}
+
+// Copy the definitions that come from the input file @idx
+// (see loadModules()) into a new module. The other definitions
+// are only declared in the new module, except for the linkonce
+// ones that are copied into every module that may use them.
+inline std::unique_ptr<llvm::Module> extractInput(const llvm::Module& M,
+                                                  unsigned idx)
+{
+    auto keep = [idx](const llvm::GlobalValue *GV) {
+        return getInputIndex(GV) == idx || GV->hasLinkOnceLinkage()
+               || GV->hasAvailableExternallyLinkage();
+    };
+
+    llvm::ValueToValueMapTy VMap;
+#if LLVM_VERSION_MAJOR >= 7
+    auto part = llvm::CloneModule(M, VMap, keep);
+#else
+    auto part = llvm::CloneModule(&M, VMap, keep);
+#endif
+
+    for (llvm::Function& F : *part)
+        F.setMetadata(detail::inputIndexMD(), nullptr);
+    for (llvm::GlobalVariable& G : part->globals())
+        G.setMetadata(detail::inputIndexMD(), nullptr);
+
+    return part;
+}
+
+#endif // LLVM >= 4
+
+} // namespace dg
+
+#endif // LLVM > 3.5
+
+#endif // _DG_LLVM_LOAD_MODULE_H_
@@ -0,0 +1,219 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/Module.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "SliceMask.h"
+
+namespace dg {
+
+static const char *SLICE_MASK_MAGIC = "dg-slice-mask";
+static const unsigned SLICE_MASK_VERSION = 1;
+
+uint64_t SliceMask::hashModule(const llvm::Module& M)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t val) {
+        for (unsigned i = 0; i < sizeof val; ++i) {
+            hash ^= (val >> (8 * i)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    for (const llvm::Function& F : M) {
+        for (char c : F.getName())
+            mix(static_cast<unsigned char>(c));
+
+        uint64_t instructions = 0;
+        for (const llvm::BasicBlock& B : F) {
+            for (const llvm::Instruction& I : B) {
+                mix(I.getOpcode());
+                mix(I.getNumOperands());
+                ++instructions;
+            }
+        }
+
+        mix(instructions);
+    }
+
+    return hash;
+}
+
+static void writeHex(std::ostream& out, uint64_t val)
+{
+    char buf[17];
+    snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(val));
+    out << buf;
+}
+
+// write the indices of the set bits of @bits as the sorted intervals
+static void writeRanges(std::ostream& out, const SliceMask::Bits& bits)
+{
+    uint64_t idx = 0;
+    while (idx < bits.size()) {
+        if (!bits.test(idx)) {
+            ++idx;
+            continue;
+        }
+
+        uint64_t start = idx;
+        while (idx < bits.size() && bits.test(idx))
+            ++idx;
+
+        out << " " << start;
+        if (idx - 1 > start)
+            out << "-" << idx - 1;
+    }
+}
+
+void SliceMask::write(std::ostream& out, Format format) const
+{
+    out << SLICE_MASK_MAGIC << " " << SLICE_MASK_VERSION << "\n";
+    out << "module ";
+    writeHex(out, moduleHash);
+    out << "\n";
+
+    if (emptyMain) {
+        out << "empty-main\n";
+        return;
+    }
+
+    for (const auto& it : functions) {
+        out << "function " << it.first << " " << it.second.size();
+        if (format == Format::BITMAP) {
+            out << " bitmap";
+            for (uint64_t word : it.second.getWords()) {
+                out << " ";
+                writeHex(out, word);
+            }
+        } else {
+            out << " ranges";
+            writeRanges(out, it.second);
+        }
+        out << "\n";
+    }
+}
+
+bool SliceMask::save(const std::string& path, Format format) const
+{
+    std::ofstream ofs(path);
+    write(ofs, format);
+    return static_cast<bool>(ofs);
+}
+
+bool SliceMask::parse(std::istream& in, std::string& error,
+                      const std::string& name)
+{
+    std::string line;
+    unsigned lineno = 0;
+    auto fail = [&](const std::string& msg) {
+        error = name + ":" + std::to_string(lineno) + ": " + msg;
+        return false;
+    };
+
+    ++lineno;
+    std::string magic;
+    unsigned version = 0;
+    if (!std::getline(in, line) || !(std::istringstream(line) >> magic >> version)
+        || magic != SLICE_MASK_MAGIC)
+        return fail("not a slice mask");
+    if (version != SLICE_MASK_VERSION)
+        return fail("unsupported version " + std::to_string(version));
+
+    ++lineno;
+    std::string kw;
+    if (!std::getline(in, line)
+        || !(std::istringstream(line) >> kw >> std::hex >> moduleHash)
+        || kw != "module")
+        return fail("expected the hash of the module");
+
+    while (std::getline(in, line)) {
+        ++lineno;
+
+        std::istringstream ss(line);
+        if (!(ss >> kw))
+            continue;
+
+        if (kw == "empty-main") {
+            emptyMain = true;
+            continue;
+        }
+
+        uint64_t idx, num;
+        std::string format;
+        if (kw != "function" || !(ss >> idx >> num >> format))
+            return fail("expected 'function INDEX INSTRUCTIONS FORMAT ...'");
+
+        Bits& bits = addFunction(idx, num);
+        if (format == "bitmap") {
+            uint64_t word;
+            size_t w = 0;
+            while (ss >> std::hex >> word) {
+                if (w >= bits.getWords().size())
+                    return fail("too many words of the bitmap");
+                for (unsigned i = 0; i < 64; ++i) {
+                    if ((word >> i) & 1) {
+                        if (64 * w + i >= num)
+                            return fail("instruction out of the function");
+                        bits.set(64 * w + i);
+                    }
+                }
+                ++w;
+            }
+        } else if (format == "ranges") {
+            std::string range;
+            while (ss >> range) {
+                uint64_t from, to;
+                char dash;
+                std::istringstream rs(range);
+                if (!(rs >> from))
+                    return fail("invalid range '" + range + "'");
+                to = from;
+                if (rs >> dash && (dash != '-' || !(rs >> to)))
+                    return fail("invalid range '" + range + "'");
+                if (to < from || to >= num)
+                    return fail("invalid range '" + range + "'");
+                for (uint64_t i = from; i <= to; ++i)
+                    bits.set(i);
+            }
+        } else {
+            return fail("unknown format '" + format + "'");
+        }
+
+        if (!ss.eof())
+            return fail("invalid function line");
+    }
+
+    return true;
+}
+
+bool SliceMask::load(const std::string& path, std::string& error)
+{
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        error = "Cannot open the file " + path;
+        return false;
+    }
+
+    return parse(ifs, error, path);
+}
+
+} // namespace dg
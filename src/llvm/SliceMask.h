@@ -0,0 +1,114 @@
+#ifndef _DG_LLVM_SLICE_MASK_H_
+#define _DG_LLVM_SLICE_MASK_H_
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// forward declaration of llvm classes
+namespace llvm {
+    class Module;
+} // namespace llvm
+
+namespace dg {
+
+///
+// The slice stored as the instructions that are in the slice,
+// so that the slice can be computed once and the sliced module
+// created from it later (or never, when only the slice is of interest),
+// without writing the bitcode of every slice. The file looks like:
+//
+//   dg-slice-mask 1
+//   module 9d2b3f10c4e5a677
+//   function 3 42 bitmap 00000000ffff00ff 0000000000000003
+//   function 7 10 ranges 0-3 5 7-9
+//
+// The functions are identified by their index in the module and
+// the instructions by their index in the function (in the order of
+// the function). A function with a line has its graph in the slice
+// (even if none of its instructions is), the other functions are
+// sliced away whole. The bitmap is the list of 64-bit words,
+// the bit i of the word w is the instruction 64*w + i, the ranges
+// are the sorted intervals of the indices. The line 'empty-main'
+// instead of the functions is the slice without the slicing criterion.
+// The structural hash of the module (see hashModule()) is checked
+// before the mask is applied, the indices are valid only for the same
+// module (loaded and preprocessed by the slicer the same way).
+class SliceMask
+{
+public:
+    enum class Format { BITMAP, RANGES };
+
+    // the instructions of a function that are in the slice
+    class Bits {
+        uint64_t num = 0;
+        std::vector<uint64_t> words;
+
+    public:
+        Bits(uint64_t n = 0) : num(n), words((n + 63) / 64, 0) {}
+
+        void set(uint64_t idx)
+        {
+            words[idx / 64] |= static_cast<uint64_t>(1) << (idx % 64);
+        }
+
+        bool test(uint64_t idx) const
+        {
+            return idx < num && (words[idx / 64] >> (idx % 64)) & 1;
+        }
+
+        // the number of the instructions of the function
+        uint64_t size() const { return num; }
+        const std::vector<uint64_t>& getWords() const { return words; }
+    };
+
+private:
+    uint64_t moduleHash = 0;
+    bool emptyMain = false;
+    std::map<uint64_t, Bits> functions;
+
+public:
+    // FNV-1a hash of the functions of @M, the number of their instructions
+    // and the opcodes and operands count of the instructions
+    static uint64_t hashModule(const llvm::Module& M);
+
+    void setModuleHash(uint64_t h) { moduleHash = h; }
+    uint64_t getModuleHash() const { return moduleHash; }
+
+    void setEmptyMain() { emptyMain = true; }
+    bool isEmptyMain() const { return emptyMain; }
+
+    // add the function with the index @idx and @instructions instructions
+    // (and none of them in the slice yet)
+    Bits& addFunction(uint64_t idx, uint64_t instructions)
+    {
+        return functions[idx] = Bits(instructions);
+    }
+
+    // nullptr if the function with the index @idx is not in the slice
+    const Bits *getFunction(uint64_t idx) const
+    {
+        auto it = functions.find(idx);
+        return it == functions.end() ? nullptr : &it->second;
+    }
+
+    size_t size() const { return functions.size(); }
+
+    void write(std::ostream& out, Format format = Format::BITMAP) const;
+    bool save(const std::string& path, Format format = Format::BITMAP) const;
+
+    // parse the mask from @in, on an error return false
+    // and describe it in @error (@name is the name of the input
+    // used in the message)
+    bool parse(std::istream& in, std::string& error,
+               const std::string& name = "<input>");
+    // load the mask from the file @path
+    bool load(const std::string& path, std::string& error);
+};
+
+} // namespace dg
+
+#endif // _DG_LLVM_SLICE_MASK_H_
@@ -1,6 +1,9 @@
 #ifndef _LLVM_DG_SLICER_H_
 #define _LLVM_DG_SLICER_H_
 
+#include <set>
+#include <vector>
+
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
 #pragma clang diagnostic push
@@ -70,17 +73,19 @@ public:
         using namespace llvm;
 
         Value *val = node->getKey();
-        // if there are any other uses of this value,
-        // just replace them with undef
-        val->replaceAllUsesWith(UndefValue::get(val->getType()));
-
+        // the instructions are erased all at once
+        // at the end of slicing the function, see eraseRemoved()
         Instruction *Inst = dyn_cast<Instruction>(val);
         if (Inst) {
-            Inst->eraseFromParent();
+            removed_insts.push_back(Inst);
         } else {
             GlobalVariable *GV = dyn_cast<GlobalVariable>(val);
-            if (GV)
+            if (GV) {
+                // if there are any other uses of this value,
+                // just replace them with undef
+                GV->replaceAllUsesWith(UndefValue::get(GV->getType()));
                 GV->eraseFromParent();
+            }
         }
 
         return true;
@@ -110,19 +115,9 @@ public:
                 adjustPhiNodes(llvm::cast<llvm::BasicBlock>(sval), blk);
         }
 
-        // We need to drop the reference to this block in all
-        // braching instructions that jump to this block.
-        // See #99
-        dropAllUses(blk);
-
-        // we also must drop refrences to instructions that are in
-        // this block (or we would need to delete the blocks in
-        // post-dominator order), see #101
-        for (llvm::Instruction& Inst : *blk)
-            dropAllUses(&Inst);
-
-        // finally, erase the block per se
-        blk->eraseFromParent();
+        // the block is erased with the removed instructions,
+        // see eraseRemoved()
+        removed_blocks.push_back(blk);
     }
 
     // override slice method
@@ -135,7 +130,7 @@ public:
         return 0;
     }
 
-    uint32_t slice(LLVMDependenceGraph *,
+    uint32_t slice(LLVMDependenceGraph *dg,
                    LLVMNode *start, uint32_t sl_id = 0)
     {
         // mark nodes for slicing
@@ -145,19 +140,52 @@ public:
 
         // take every subgraph and slice it intraprocedurally
         // this includes the main graph
-        extern std::map<const llvm::Value *,
-                        LLVMDependenceGraph *> constructedFunctions;
-        for (auto& it : constructedFunctions) {
+        for (auto& it : dg->getConstructedFunctions()) {
             if (dontTouch(it.first->getName()))
                 continue;
 
             LLVMDependenceGraph *subdg = it.second;
-            sliceGraph(subdg, sl_id);
+            // the marking sets the slice id also to the graphs
+            // that have some node in the slice
+            if (subdg->getSlice() != sl_id)
+                elideGraph(subdg, sl_id);
+            else
+                sliceGraph(subdg, sl_id);
         }
 
         return sl_id;
     }
 
+    // does @use depend on @def only because @def computes
+    // the address of the memory that @use accesses?
+    static bool isBasePointerDependence(LLVMNode *use, LLVMNode *def)
+    {
+        using namespace llvm;
+
+        const Value *val = use->getKey();
+        const Value *ptr = nullptr;
+        if (const LoadInst *LI = dyn_cast<LoadInst>(val)) {
+            ptr = LI->getPointerOperand();
+        } else if (const StoreInst *SI = dyn_cast<StoreInst>(val)) {
+            // the pointer may be stored into its own memory
+            if (SI->getValueOperand() == def->getKey())
+                return false;
+            ptr = SI->getPointerOperand();
+        }
+
+        return ptr && ptr == def->getKey();
+    }
+
+    // mark the thin slice of @starts, see analysis::WalkAndMarkThin
+    uint32_t markThin(const std::vector<LLVMNode *>& starts, unsigned expand = 0,
+                      uint32_t sl_id = 0,
+                      std::vector<LLVMNode *> *unexpanded = nullptr)
+    {
+        return analysis::Slicer<LLVMNode>::markThin(starts,
+                                                    isBasePointerDependence,
+                                                    expand, sl_id, unexpanded);
+    }
+
 private:
         /*
     void sliceCallNode(LLVMNode *callNode,
@@ -469,6 +497,14 @@ private:
             }
         }
 
+        // the instructions without nodes are never in the slice
+        for (llvm::Instruction *Inst : graph->getNonSemanticInstructions())
+            removed_insts.push_back(Inst);
+        graph->clearNonSemanticInstructions();
+
+        // erase the removed blocks and instructions from the function
+        eraseRemoved(graph);
+
         // create new CFG edges between blocks after slicing
         reconnectLLLVMBasicBlocks(graph);
 
@@ -478,6 +514,100 @@ private:
         ensureEntryBlock(graph);
     }
 
+    // Erase the blocks and instructions gathered by removeBlock()
+    // and removeNode() in one sweep. Erasing them one by one would
+    // replace the uses of every instruction with undef, even the uses
+    // by other removed instructions. Instead, all the removed
+    // instructions drop their operands first, so only the uses
+    // by the instructions that stay are replaced (and the references
+    // to the removed blocks are dropped, see #99 and #101).
+    // If the whole body goes away, it is deleted at once
+    // and the function becomes a declaration.
+    void eraseRemoved(LLVMDependenceGraph *graph)
+    {
+        using namespace llvm;
+
+        Function *F = cast<Function>(graph->getEntry()->getKey());
+        if (!removed_blocks.empty() && removed_blocks.size() == F->size()) {
+            F->deleteBody();
+            removed_blocks.clear();
+            removed_insts.clear();
+            return;
+        }
+
+        for (BasicBlock *blk : removed_blocks) {
+            for (Instruction& Inst : *blk)
+                Inst.dropAllReferences();
+        }
+
+        for (Instruction *Inst : removed_insts)
+            Inst->dropAllReferences();
+
+        // now only the instructions that stay use the removed values
+        for (BasicBlock *blk : removed_blocks) {
+            // the branches to this block are reconnected later
+            dropAllUses(blk);
+
+            for (Instruction& Inst : *blk) {
+                if (!Inst.use_empty())
+                    Inst.replaceAllUsesWith(UndefValue::get(Inst.getType()));
+            }
+        }
+
+        for (Instruction *Inst : removed_insts) {
+            if (!Inst->use_empty())
+                Inst->replaceAllUsesWith(UndefValue::get(Inst->getType()));
+        }
+
+        for (auto I = removed_insts.rbegin(), E = removed_insts.rend(); I != E; ++I)
+            (*I)->eraseFromParent();
+
+        for (BasicBlock *blk : removed_blocks)
+            blk->eraseFromParent();
+
+        removed_insts.clear();
+        removed_blocks.clear();
+    }
+
+    // Remove the function that has no node in the slice.
+    // Its body is deleted at once instead of slicing it node by node,
+    // the function stays as a declaration (it may still be referenced,
+    // llvm-slicer removes the unused declarations afterwards).
+    // The blocks and the nodes are removed from the graph only.
+    void elideGraph(LLVMDependenceGraph *graph, uint32_t slice_id)
+    {
+        llvm::Function *F = llvm::cast<llvm::Function>(graph->getEntry()->getKey());
+
+        std::vector<LLVMBBlock *> blocks;
+        for (auto& it : graph->getBlocks()) {
+            if (it.second->getSlice() != slice_id)
+                blocks.push_back(it.second);
+        }
+
+        for (LLVMBBlock *blk : blocks) {
+            statistics.nodesRemoved += blk->size();
+            statistics.nodesTotal += blk->size();
+            ++statistics.blocksRemoved;
+
+            blk->remove();
+        }
+
+        // the nodes that were not in any block
+        for (auto I = graph->begin(), E = graph->end(); I != E;) {
+            LLVMNode *n = I->second;
+            ++I;
+
+            if (n == graph->getExit())
+                continue;
+
+            ++statistics.nodesTotal;
+            ++statistics.nodesRemoved;
+            graph->deleteNode(n);
+        }
+
+        F->deleteBody();
+    }
+
     bool dontTouch(const llvm::StringRef& r)
     {
         for (const char *n : dont_touch)
@@ -605,6 +735,11 @@ private:
 
     // do not slice these functions at all
     std::set<const char *> dont_touch;
+
+    // the blocks and instructions of the sliced function
+    // that are going to be erased by eraseRemoved()
+    std::vector<llvm::BasicBlock *> removed_blocks;
+    std::vector<llvm::Instruction *> removed_insts;
 };
 } // namespace dg
 
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "analysis/SCC.h"
+#include "llvm/llvm-utils.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "CallGraph.h"
+
+namespace dg {
+namespace analysis {
+
+static llvmutils::CallCompatibility
+getCallCompatibility(const LLVMPointerAnalysis *PTA)
+{
+    return PTA ? PTA->getCallCompatibility()
+               : llvmutils::CallCompatibility::LOOSE;
+}
+
+LLVMCallGraph::CallSite LLVMCallGraph::resolve(const llvm::CallInst *CI)
+{
+    using namespace llvm;
+
+    CallSite cs;
+    const Value *calledVal = CI->getCalledValue()->stripPointerCasts();
+    if (const Function *F = dyn_cast<Function>(calledVal)) {
+        cs.targets.push_back(F);
+        return cs;
+    }
+
+    if (isa<InlineAsm>(calledVal))
+        return cs;
+
+    pta::PSNode *op = PTA ? PTA->getPointsTo(calledVal) : nullptr;
+    if (!op || op->pointsTo.empty()) {
+        cs.unresolved = true;
+        return cs;
+    }
+
+    for (const pta::Pointer& ptr : op->pointsTo) {
+        if (ptr.isUnknown()) {
+            cs.unresolved = true;
+        } else if (ptr.isValid()) {
+            // vararg may introduce imprecision here, so we
+            // must check that it is really pointer to a function
+            const Function *F
+                = dyn_cast_or_null<Function>(ptr.target->getUserData<Value>());
+            if (F && llvmutils::callIsCompatible(F, CI, getCallCompatibility(PTA)))
+                cs.targets.push_back(F);
+        }
+    }
+
+    return cs;
+}
+
+void LLVMCallGraph::build()
+{
+    using namespace llvm;
+
+    for (const Function& F : *M) {
+        if (F.isDeclaration())
+            continue;
+
+        ids.emplace(&F, funcs.size());
+        funcs.push_back(&F);
+    }
+
+    // the functions that an unresolved call via a pointer may call
+    std::vector<unsigned> address_taken;
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+        if (funcs[i]->hasAddressTaken())
+            address_taken.push_back(i);
+    }
+
+    callees.assign(funcs.size(), std::vector<unsigned>());
+    callers.assign(funcs.size(), std::vector<unsigned>());
+    call_sites.assign(funcs.size(), std::vector<const CallInst *>());
+
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+        for (const BasicBlock& B : *funcs[i]) {
+            for (const Instruction& Inst : B) {
+                const CallInst *CI = dyn_cast<CallInst>(&Inst);
+                if (!CI)
+                    continue;
+
+                const CallSite& cs = calls.emplace(CI, resolve(CI)).first->second;
+                for (const Function *F : cs.targets) {
+                    unsigned id = getId(F);
+                    if (id == NONE)
+                        continue;
+
+                    callees[i].push_back(id);
+                    call_sites[id].push_back(CI);
+                }
+
+                if (!cs.unresolved)
+                    continue;
+
+                // in the strict mode, the prototypes must
+                // match also when the pointer is unknown
+                auto level = getCallCompatibility(PTA);
+                for (unsigned id : address_taken) {
+                    if (level == llvmutils::CallCompatibility::LOOSE
+                        || llvmutils::callIsCompatible(funcs[id], CI, level))
+                        callees[i].push_back(id);
+                }
+            }
+        }
+
+        std::sort(callees[i].begin(), callees[i].end());
+        callees[i].erase(std::unique(callees[i].begin(), callees[i].end()),
+                         callees[i].end());
+        for (unsigned c : callees[i])
+            callers[c].push_back(i);
+    }
+
+    comp_ids = computeSCCs(callees, components);
+}
+
+const std::vector<const llvm::CallInst *>&
+LLVMCallGraph::getCallSites(const llvm::Function *F) const
+{
+    static const std::vector<const llvm::CallInst *> none;
+    unsigned id = getId(F);
+    return id == NONE ? none : call_sites[id];
+}
+
+const LLVMCallGraph::CallSite& LLVMCallGraph::getCallSite(const llvm::CallInst *CI)
+{
+    auto it = calls.find(CI);
+    if (it == calls.end())
+        it = calls.emplace(CI, resolve(CI)).first;
+
+    return it->second;
+}
+
+bool LLVMCallGraph::isRecursive(unsigned id) const
+{
+    return components[comp_ids[id]].size() > 1
+           || std::binary_search(callees[id].begin(), callees[id].end(), id);
+}
+
+std::vector<std::vector<unsigned>> LLVMCallGraph::getBottomUpLevels() const
+{
+    // the components are in reverse topological order,
+    // so the levels of the callees are known already
+    std::vector<unsigned> level(components.size(), 0);
+    std::vector<std::vector<unsigned>> levels;
+    for (unsigned c = 0; c < components.size(); ++c) {
+        for (unsigned i : components[c]) {
+            for (unsigned callee : callees[i]) {
+                unsigned cc = comp_ids[callee];
+                if (cc == c)
+                    continue;
+
+                assert(cc < c && "The callee is not below the caller");
+                level[c] = std::max(level[c], level[cc] + 1);
+            }
+        }
+
+        if (levels.size() <= level[c])
+            levels.resize(level[c] + 1);
+        levels[level[c]].push_back(c);
+    }
+
+    return levels;
+}
+
+std::vector<LLVMCallGraph::Shard> LLVMCallGraph::partition(uint64_t max_weight) const
+{
+    std::vector<Shard> shards;
+    std::vector<unsigned> shard_of(funcs.size());
+
+    // the components are in reverse topological order, so packing
+    // consecutive components keeps the shards in bottom-up order
+    for (const std::vector<unsigned>& comp : components) {
+        uint64_t weight = 0;
+        for (unsigned i : comp) {
+            for (const llvm::BasicBlock& B : *funcs[i])
+                weight += B.size();
+        }
+
+        if (shards.empty() || shards.back().weight + weight > max_weight)
+            shards.emplace_back();
+
+        Shard& shard = shards.back();
+        shard.weight += weight;
+        for (unsigned i : comp) {
+            shard.functions.push_back(i);
+            shard_of[i] = shards.size() - 1;
+        }
+    }
+
+    for (unsigned s = 0; s < shards.size(); ++s) {
+        Shard& shard = shards[s];
+        for (unsigned i : shard.functions) {
+            for (unsigned callee : callees[i]) {
+                if (shard_of[callee] != s)
+                    shard.callees.push_back(shard_of[callee]);
+            }
+        }
+
+        std::sort(shard.callees.begin(), shard.callees.end());
+        shard.callees.erase(std::unique(shard.callees.begin(), shard.callees.end()),
+                            shard.callees.end());
+        assert((shard.callees.empty() || shard.callees.back() < s)
+               && "The shards are not in bottom-up order");
+    }
+
+    return shards;
+}
+
+} // namespace analysis
+
+analysis::LLVMCallGraph& LLVMPointerAnalysis::getCallGraph()
+{
+    if (!callgraph) {
+        callgraph.reset(new analysis::LLVMCallGraph(M, this));
+        callgraph->build();
+    }
+
+    return *callgraph;
+}
+
+} // namespace dg
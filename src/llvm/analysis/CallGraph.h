@@ -0,0 +1,125 @@
+#ifndef _LLVM_DG_CALL_GRAPH_H_
+#define _LLVM_DG_CALL_GRAPH_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// forward declaration of llvm classes
+namespace llvm {
+    class Module;
+    class Function;
+    class CallInst;
+} // namespace llvm
+
+namespace dg {
+
+class LLVMPointerAnalysis;
+
+namespace analysis {
+
+///
+// The call graph of the defined functions of the module. The calls via
+// function pointers are resolved with the points-to information
+// (only the functions with a compatible prototype are taken),
+// a call via a pointer that points to unknown memory (or nowhere)
+// may call any function whose address is taken (with a compatible
+// prototype in the strict mode, see
+// LLVMPointerAnalysis::setCallCompatibility()).
+//
+// The graph is built once after the pointer analysis (see
+// LLVMPointerAnalysis::getCallGraph()) and shared by the builders
+// and the analyses that work over functions. The strongly connected
+// components are in the bottom-up order, so the summaries of the callees
+// can be computed before their callers.
+class LLVMCallGraph
+{
+public:
+    enum : unsigned { NONE = ~0U };
+
+    struct CallSite {
+        // the functions (also the undefined ones) that the call may call,
+        // for a call via a pointer in the order of its points-to set
+        std::vector<const llvm::Function *> targets;
+        // a call via a pointer that may call an unknown function
+        bool unresolved = false;
+    };
+
+    LLVMCallGraph(const llvm::Module *m, LLVMPointerAnalysis *pta = nullptr)
+        : M(m), PTA(pta) {}
+
+    void build();
+
+    // the defined functions in the order of the module
+    const std::vector<const llvm::Function *>& getFunctions() const { return funcs; }
+
+    // the index of the defined function @F, NONE for other functions
+    unsigned getId(const llvm::Function *F) const
+    {
+        auto it = ids.find(F);
+        return it == ids.end() ? NONE : it->second;
+    }
+
+    // the defined functions that the function @id may call
+    // and that may call it (sorted, unique)
+    const std::vector<unsigned>& getCallees(unsigned id) const { return callees[id]; }
+    const std::vector<unsigned>& getCallers(unsigned id) const { return callers[id]; }
+
+    // the calls that may call @F (directly or via a resolved pointer)
+    const std::vector<const llvm::CallInst *>& getCallSites(const llvm::Function *F) const;
+
+    // the targets of the call @CI. The calls that were not in the module
+    // when the graph was built are resolved now (but they do not get
+    // into the edges of the graph)
+    const CallSite& getCallSite(const llvm::CallInst *CI);
+
+    // the components in reverse topological order (callees first)
+    const std::vector<std::vector<unsigned>>& getComponents() const { return components; }
+    unsigned getComponentId(unsigned id) const { return comp_ids[id]; }
+
+    // does the function @id call itself (maybe via other functions)?
+    bool isRecursive(unsigned id) const;
+
+    // the components split into levels, the components of a level
+    // call only the components of the lower levels, so they can
+    // be processed in parallel bottom-up
+    std::vector<std::vector<unsigned>> getBottomUpLevels() const;
+
+    struct Shard {
+        // the defined functions of the shard
+        std::vector<unsigned> functions;
+        // the number of instructions of the functions
+        uint64_t weight = 0;
+        // the shards whose functions the functions of this shard
+        // call (sorted), their summaries are needed by this shard
+        std::vector<unsigned> callees;
+    };
+
+    // split the functions into shards of at most @max_weight instructions
+    // that can be analyzed separately (e.g. on different machines) given
+    // the summaries of the calls out of the shard. A component is never
+    // split, so a larger component gets a shard on its own. The shards
+    // are in bottom-up order (a shard calls only the shards before it)
+    std::vector<Shard> partition(uint64_t max_weight) const;
+
+private:
+    const llvm::Module *M;
+    LLVMPointerAnalysis *PTA;
+
+    std::vector<const llvm::Function *> funcs;
+    std::unordered_map<const llvm::Function *, unsigned> ids;
+    std::vector<std::vector<unsigned>> callees;
+    std::vector<std::vector<unsigned>> callers;
+    std::vector<std::vector<const llvm::CallInst *>> call_sites;
+    std::unordered_map<const llvm::CallInst *, CallSite> calls;
+
+    std::vector<std::vector<unsigned>> components;
+    std::vector<unsigned> comp_ids;
+
+    CallSite resolve(const llvm::CallInst *CI);
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _LLVM_DG_CALL_GRAPH_H_
@@ -17,41 +17,37 @@
 namespace dg {
 
 using LLVMCFA = CFA<llvm::BasicBlock *>;
-using LLVMCFANode = CFANode<llvm::BasicBlock *>;
 
 class LLVMCFABuilder {
 
 public:
     LLVMCFA build(llvm::Function& F)
     {
-        std::map<llvm::BasicBlock *, LLVMCFANode *> mapping;
+        std::map<llvm::BasicBlock *, unsigned> mapping;
         LLVMCFA cfa;
 
         // create nodes for all basic blocks
         for (llvm::BasicBlock& B : F) {
-            mapping[&B] = new LLVMCFANode(&B);
+            mapping[&B] = cfa.addNode(&B);
         }
 
         // add successors for all basic blocks
         for (llvm::BasicBlock& B : F) {
-            LLVMCFANode *node = mapping[&B];
-            assert(node);
+            unsigned node = mapping[&B];
 
             // iterate over all successors of the basic block
             for (llvm::succ_iterator
                  S = succ_begin(&B), E = succ_end(&B); S != E; ++S) {
-                LLVMCFANode *succ = mapping[*S];
+                assert(mapping.count(*S) > 0);
 
                 // add the successor
-                node->addSuccessor(succ);
+                cfa.addEdge(node, mapping[*S]);
             }
-
-            // add the node into CFA -- we
-            // must do it now, after the node is fully
-            // initialized (when it has successors)
-            cfa.addNode(node);
         }
 
+        // the entry block may have predecessors (a loop)
+        cfa.setEntry(mapping[&F.getEntryBlock()]);
+
         return cfa;
     }
 
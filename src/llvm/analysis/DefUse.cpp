@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <memory>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -35,6 +38,8 @@
 
 #include "analysis/PointsTo/PointerSubgraph.h"
 #include "analysis/DFS.h"
+#include "analysis/Parallel.h"
+#include "analysis/Tracepoints.h"
 
 using dg::analysis::rd::LLVMReachingDefinitions;
 using dg::analysis::rd::RDNode;
@@ -46,24 +51,26 @@ using namespace llvm;
 /// --------------------------------------------------
 namespace dg {
 
-static void handleInstruction(const Instruction *Inst, LLVMNode *node)
+void LLVMDefUseAnalysis::handleInstruction(const Instruction *Inst,
+                                           LLVMNode *node)
 {
     LLVMDependenceGraph *dg = node->getDG();
 
     for (auto I = Inst->op_begin(), E = Inst->op_end(); I != E; ++I) {
         LLVMNode *op = dg->getNode(*I);
         if (op)
-            op->addDataDependence(node);
+            addDefUseEdge(op, node);
     }
 }
 
-static void addReturnEdge(LLVMNode *callNode, LLVMDependenceGraph *subgraph)
+void LLVMDefUseAnalysis::addReturnEdge(LLVMNode *callNode,
+                                       LLVMDependenceGraph *subgraph)
 {
     // FIXME we may loose some accuracy here and
     // this edges causes that we'll go into subprocedure
     // even with summary edges
     if (!callNode->isVoidTy())
-        subgraph->getExit()->addDataDependence(callNode);
+        addDefUseEdge(subgraph->getExit(), callNode);
 }
 
 LLVMDefUseAnalysis::LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
@@ -79,6 +86,192 @@ LLVMDefUseAnalysis::LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
     assert(RD && "Need reaching definitions");
 }
 
+LLVMDefUseAnalysis::LLVMDefUseAnalysis(LLVMDefUseAnalysis *par)
+    : analysis::DataFlowAnalysis<LLVMNode>(par->dg->getEntryBB(),
+                                           analysis::DATAFLOW_INTERPROCEDURAL),
+      dg(par->dg), RD(par->RD), PTA(par->PTA),
+      DL(new DataLayout(par->dg->getModule())),
+      assume_pure_functions(par->assume_pure_functions), parent(par),
+      hub_threshold(par->hub_threshold)
+{
+}
+
+PSNode *LLVMDefUseAnalysis::getPointsTo(const llvm::Value *val)
+{
+    LLVMDefUseAnalysis *root = parent ? parent : this;
+    if (!root->lock_queries)
+        return PTA->getPointsTo(val);
+
+    std::lock_guard<std::mutex> guard(root->queries_lock);
+    return PTA->getPointsTo(val);
+}
+
+// gather the reaching definitions of @rd_sites at @where to @rd_results
+void LLVMDefUseAnalysis::getReachingDefinitions(RDNode *where)
+{
+    // the workers must not share the cache
+    analysis::rd::RDQueryCache *cache = parent ? &rd_cache : nullptr;
+
+    LLVMDefUseAnalysis *root = parent ? parent : this;
+    if (!root->lock_queries) {
+        RD->getReachingDefinitions(where, rd_sites, rd_results, cache);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(root->queries_lock);
+    RD->getReachingDefinitions(where, rd_sites, rd_results, cache);
+}
+
+void LLVMDefUseAnalysis::addDefUseEdge(LLVMNode *def, LLVMNode *use)
+{
+    DG_TRACE2(du_edge, def, use);
+
+    // the workers do not touch the graphs
+    if (parent)
+        deferred_edges.emplace_back(def, use);
+    else
+        def->addDataDependence(use);
+}
+
+// add the edges (def, use) to the graphs, the edges of every
+// node are added at once
+void LLVMDefUseAnalysis::addDeferredEdges(std::vector<std::pair<LLVMNode *, LLVMNode *>>& edges)
+{
+    using EdgeT = std::pair<LLVMNode *, LLVMNode *>;
+    std::sort(edges.begin(), edges.end(),
+              [](const EdgeT& a, const EdgeT& b) {
+                  return a.second->getID() < b.second->getID()
+                         || (a.second == b.second
+                             && a.first->getID() < b.first->getID());
+              });
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    for (size_t i = 0; i < edges.size();) {
+        LLVMNode *use = edges[i].second;
+        def_nodes.clear();
+        for (; i < edges.size() && edges[i].second == use; ++i)
+            def_nodes.push_back(edges[i].first);
+
+        use->addIncomingDDs(def_nodes);
+    }
+}
+
+void LLVMDefUseAnalysis::run()
+{
+    if (!dg->getBuildOptions().dataDependencies)
+        return;
+
+    if (release_definitions) {
+        runBottomUp();
+        return;
+    }
+
+    if (threads <= 1) {
+        analysis::DataFlowAnalysis<LLVMNode>::run();
+        return;
+    }
+
+    std::vector<LLVMDependenceGraph *> graphs;
+    for (auto& F : dg->getConstructedFunctions())
+        graphs.push_back(F.second);
+
+    runOnGraphs(graphs);
+}
+
+// add the def-use edges of the nodes of @graphs
+void LLVMDefUseAnalysis::runOnGraphs(const std::vector<LLVMDependenceGraph *>& graphs)
+{
+    if (graphs.empty())
+        return;
+
+    if (threads <= 1) {
+        for (LLVMDependenceGraph *graph : graphs)
+            addEdges(graph);
+
+        return;
+    }
+
+    lock_queries = PTA->isDemandDriven() || RD->usesMemorySSA();
+
+    std::vector<std::unique_ptr<LLVMDefUseAnalysis>> workers;
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back(new LLVMDefUseAnalysis(this));
+
+    // the functions are independent, every worker
+    // takes the next function that was not processed yet
+    analysis::parallelFor(graphs.size(), threads, [&](size_t i, unsigned t) {
+        workers[t]->addEdges(graphs[i]);
+    });
+
+    std::vector<std::pair<LLVMNode *, LLVMNode *>> edges;
+    for (auto& worker : workers) {
+        edges.insert(edges.end(), worker->deferred_edges.begin(),
+                     worker->deferred_edges.end());
+        worker.reset();
+    }
+
+    addDeferredEdges(edges);
+}
+
+void LLVMDefUseAnalysis::addEdges(LLVMDependenceGraph *graph)
+{
+    for (auto& it : graph->getBlocks()) {
+        for (LLVMNode *node : it.second->getNodes())
+            runOnNode(node, nullptr);
+    }
+}
+
+void LLVMDefUseAnalysis::runBottomUp()
+{
+    analysis::LLVMCallGraph& CG = PTA->getCallGraph();
+    const auto& functions = CG.getFunctions();
+    const auto& components = CG.getComponents();
+
+    // the components of a level call only the lower levels,
+    // so the workers can take them at once
+    std::vector<std::vector<unsigned>> batches;
+    if (threads > 1)
+        batches = CG.getBottomUpLevels();
+    else {
+        for (unsigned c = 0; c < components.size(); ++c)
+            batches.push_back({c});
+    }
+
+    std::set<const LLVMDependenceGraph *> done;
+    std::vector<LLVMDependenceGraph *> graphs;
+    std::vector<const Function *> released;
+    for (const std::vector<unsigned>& batch : batches) {
+        graphs.clear();
+        released.clear();
+        for (unsigned c : batch) {
+            for (unsigned i : components[c]) {
+                const Function *F = functions[i];
+                LLVMDependenceGraph *graph
+                    = dg->getGraph(const_cast<Function *>(F));
+                if (!graph)
+                    continue;
+
+                graphs.push_back(graph);
+                released.push_back(F);
+                done.insert(graph);
+            }
+        }
+
+        runOnGraphs(graphs);
+        for (const Function *F : released)
+            RD->releaseFunction(*F);
+    }
+
+    // the graphs that are not in the call graph (if any)
+    graphs.clear();
+    for (auto& F : dg->getConstructedFunctions()) {
+        if (!done.count(F.second))
+            graphs.push_back(F.second);
+    }
+
+    runOnGraphs(graphs);
+}
+
 void LLVMDefUseAnalysis::handleInlineAsm(LLVMNode *callNode)
 {
     CallInst *CI = cast<CallInst>(callNode->getValue());
@@ -93,21 +286,22 @@ void LLVMDefUseAnalysis::handleInlineAsm(LLVMNode *callNode)
         LLVMNode *opNode = dg->getNode(opVal->stripInBoundsOffsets());
         if (!opNode) {
             // FIXME: ConstantExpr
-            llvmutils::printerr("WARN: unhandled inline asm operand: ", opVal);
+            getDiagnostics().report([opVal]() {
+                llvmutils::printerr("WARN: unhandled inline asm operand: ", opVal);
+            });
             continue;
         }
 
         assert(opNode && "Do not have an operand for inline asm");
 
         // if nothing else, this call at least uses the operands
-        opNode->addDataDependence(callNode);
+        addDefUseEdge(opNode, callNode);
     }
 }
 
 void LLVMDefUseAnalysis::handleIntrinsicCall(LLVMNode *callNode,
                                              CallInst *CI)
 {
-    static std::set<Instruction *> warnings;
     IntrinsicInst *I = cast<IntrinsicInst>(CI);
     Value *dest, *src = nullptr;
 
@@ -136,8 +330,9 @@ void LLVMDefUseAnalysis::handleIntrinsicCall(LLVMNode *callNode,
             return;
         case Intrinsic::stacksave:
         case Intrinsic::stackrestore:
-            if (warnings.insert(CI).second)
+            getDiagnostics().reportOnce(Diagnostics::STACK_SAVE, CI, [CI]() {
                 llvmutils::printerr("WARN: stack save/restore not implemented", CI);
+            });
             return;
         default:
             I->dump();
@@ -161,11 +356,19 @@ void LLVMDefUseAnalysis::handleUndefinedCall(LLVMNode *callNode, CallInst *CI)
     if (assume_pure_functions)
         return;
 
+    // the summary of the function says what memory it may use
+    const Function *func
+        = dyn_cast<Function>(CI->getCalledValue()->stripPointerCasts());
+    const FunctionSummary *summary = PTA->getModuleInfo()->getSummary(func);
+
     // the function is undefined - add the top-level dependencies and
     // also assume that this function use all the memory that is passed
     // via the pointers
     for (int e = CI->getNumArgOperands(), i = 0; i < e; ++i) {
-        if (auto pts = PTA->getPointsTo(CI->getArgOperand(i))) {
+        if (summary && !summary->ref.contains(i))
+            continue;
+
+        if (auto pts = getPointsTo(CI->getArgOperand(i))) {
             // the passed memory may be used in the undefined
             // function on the unknown offset
             addDataDependence(callNode, CI, pts, UNKNOWN_OFFSET);
@@ -211,18 +414,30 @@ void LLVMDefUseAnalysis::handleCallInst(LLVMNode *node)
         }
     }
 
+    // the graph of the called function was not built,
+    // summarize it the same way as an undefined function
+    if (dg->callsOpaque(node))
+        handleUndefinedCall(node, CI);
+
     // add edges from the return nodes of subprocedure
     // to the call (if the call returns something)
     for (LLVMDependenceGraph *subgraph : node->getSubgraphs())
         addReturnEdge(node, subgraph);
 }
 
-// Add data dependence edges from all memory location that may write
-// to memory pointed by 'pts' to 'node'
-void LLVMDefUseAnalysis::addUnknownDataDependence(LLVMNode *node, PSNode *pts)
+// the stores of RD indexed by the memory that they define,
+// built once over all nodes of RD and shared by the workers
+const LLVMDefUseAnalysis::StoresIndexT& LLVMDefUseAnalysis::getStoresIndex()
 {
-    // iterate over all nodes from ReachingDefinitions Subgraph. It is faster than
-    // going over all llvm nodes and querying the pointer to analysis
+    LLVMDefUseAnalysis *root = parent ? parent : this;
+    if (root->stores_indexed.load(std::memory_order_acquire))
+        return root->stores_index;
+
+    std::lock_guard<std::mutex> guard(root->stores_lock);
+    if (root->stores_indexed.load(std::memory_order_relaxed))
+        return root->stores_index;
+
+    StoresIndexT& index = root->stores_index;
     for (auto& it : RD->getNodesMap()) {
         RDNode *rdnode = it.second;
 
@@ -230,28 +445,73 @@ void LLVMDefUseAnalysis::addUnknownDataDependence(LLVMNode *node, PSNode *pts)
         if (rdnode->getType() != analysis::rd::STORE)
             continue;
 
-        llvm::Value *rdVal = rdnode->getUserData<llvm::Value>();
         // artificial node?
-        if (!rdVal)
+        if (!rdnode->getUserData<llvm::Value>())
             continue;
 
-        // does this store define some value that is in pts?
         for (const analysis::rd::DefSite& ds : rdnode->getDefines()) {
-            llvm::Value *llvmVal = ds.target->getUserData<llvm::Value>();
+            const llvm::Value *llvmVal = ds.target->getUserData<llvm::Value>();
             // is this an artificial node?
             if (!llvmVal)
                 continue;
 
-            // if these two sets have an over-lap, we must add the data dependence
-            for (const auto& ptr : pts->pointsTo)
-                if (ptr.target->getUserData<llvm::Value>() == llvmVal) {
-                    addDataDependence(node, rdVal);
-            }
+            // the def-sites of one store are ordered by the target,
+            // so the store is added to the target only once
+            std::vector<RDNode *>& stores = index[llvmVal];
+            if (stores.empty() || stores.back() != rdnode)
+                stores.push_back(rdnode);
+        }
+    }
+
+    root->stores_indexed.store(true, std::memory_order_release);
+    return index;
+}
+
+// Gather the definitions from all memory location that may write
+// to memory pointed by 'pts'
+void LLVMDefUseAnalysis::addUnknownDataDependence(PSNode *pts)
+{
+    // look up the stores to the memory in the index instead of going
+    // over all the stores and comparing their def-sites with pts
+    const StoresIndexT& index = getStoresIndex();
+    for (const auto& ptr : pts->pointsTo) {
+        const llvm::Value *llvmVal = ptr.target->getUserData<llvm::Value>();
+        if (!llvmVal)
+            continue;
+
+        auto it = index.find(llvmVal);
+        if (it == index.end())
+            continue;
+
+        if (hub_threshold > 0 && it->second.size() >= hub_threshold) {
+            bool created;
+            LLVMNode *hub = dg->getMemoryHub(llvmVal, &created);
+            if (created)
+                connectMemoryHub(hub, it->second);
+            hub_defs.push_back(hub);
+            continue;
         }
+
+        for (RDNode *rdnode : it->second)
+            addDefinition(rdnode);
     }
 }
 
-void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, llvm::Value *rdval)
+// add the data dependencies of @hub on the nodes of @stores
+void LLVMDefUseAnalysis::connectMemoryHub(LLVMNode *hub,
+                                          const std::vector<RDNode *>& stores)
+{
+    // the definitions of the current node are still
+    // in rd_defs, so we can use def_nodes here
+    def_nodes.clear();
+    for (RDNode *rd : stores)
+        addDefNodes(rd->getUserData<llvm::Value>());
+
+    addIncomingDefs(hub);
+}
+
+// add the node (or nodes) of the definition @rdval to @def_nodes
+void LLVMDefUseAnalysis::addDefNodes(llvm::Value *rdval)
 {
     LLVMNode *rdnode = dg->getNode(rdval);
     if (!rdnode) {
@@ -259,6 +519,15 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, llvm::Value *rdval)
         // We need to add interprocedural edge
         llvm::Function *F
             = llvm::cast<llvm::Instruction>(rdval)->getParent()->getParent();
+
+        // the definition is in a function that we did not build,
+        // so it happens in the calls of the function
+        if (const auto *callsites = dg->getOpaqueCallSites(F)) {
+            def_nodes.insert(def_nodes.end(),
+                             callsites->begin(), callsites->end());
+            return;
+        }
+
         LLVMNode *entryNode = dg->getGlobalNode(F);
         assert(entryNode && "Don't have built function");
 
@@ -267,21 +536,94 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, llvm::Value *rdval)
         assert(graph != dg && "Cannot find a node");
         rdnode = graph->getNode(rdval);
         if (!rdnode) {
-            llvmutils::printerr("ERROR: DG has not val: ", rdval);
+            getDiagnostics().report([rdval]() {
+                llvmutils::printerr("ERROR: DG has not val: ", rdval);
+            });
             return;
         }
     }
 
     assert(rdnode);
-    rdnode->addDataDependence(node);
+    def_nodes.push_back(rdnode);
 }
 
+// add the definition to the definitions of the current node,
+// every definition is added only once
+void LLVMDefUseAnalysis::addDefinition(RDNode *rd)
+{
+    unsigned id = rd->getID();
+    if (id >= rd_seen.size())
+        rd_seen.resize(RDNode::getLastID() + 1, false);
 
-void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, RDNode *rd)
+    if (rd_seen[id])
+        return;
+
+    rd_seen[id] = true;
+    rd_defs.push_back(rd);
+}
+
+// add the data dependence edges from def_nodes
+// to @node at once (or defer them in a worker)
+void LLVMDefUseAnalysis::addIncomingDefs(LLVMNode *node)
 {
-    llvm::Value *rdval = rd->getUserData<llvm::Value>();
-    assert(rdval && "RDNode has not set the coresponding value");
-    addDataDependence(node, rdval);
+#ifdef ENABLE_TRACEPOINTS
+    for (LLVMNode *def : def_nodes)
+        DG_TRACE2(du_edge, def, node);
+#endif
+
+    if (parent) {
+        for (LLVMNode *def : def_nodes)
+            deferred_edges.emplace_back(def, node);
+        return;
+    }
+
+    std::sort(def_nodes.begin(), def_nodes.end(), NodeIDLess());
+    def_nodes.erase(std::unique(def_nodes.begin(), def_nodes.end()),
+                    def_nodes.end());
+    node->addIncomingDDs(def_nodes);
+}
+
+// add the data dependence edges from the gathered definitions
+// to @node and reset the scratch buffers
+void LLVMDefUseAnalysis::flushDataDependences(LLVMNode *node)
+{
+    // the definitions saved by LLVMReachingDefinitions::saveResults()
+    bool record = RD->isRecordingResults();
+    std::vector<const llvm::Value *> recorded;
+
+    def_nodes.clear();
+    for (RDNode *rd : rd_defs) {
+        rd_seen[rd->getID()] = false;
+
+        llvm::Value *rdval = rd->getUserData<llvm::Value>();
+        assert(rdval && "RDNode has not set the coresponding value");
+        addDefNodes(rdval);
+        if (record)
+            recorded.push_back(rdval);
+    }
+
+    rd_defs.clear();
+    if (record)
+        RD->addResults(node->getKey(), recorded);
+
+    def_nodes.insert(def_nodes.end(), hub_defs.begin(), hub_defs.end());
+    hub_defs.clear();
+
+    addIncomingDefs(node);
+}
+
+// add the data dependence edges from the definitions of @node loaded
+// by LLVMReachingDefinitions::loadResults() (all the memory that
+// the node uses at once, there is no graph of reaching definitions)
+void LLVMDefUseAnalysis::addLoadedDefinitions(LLVMNode *node)
+{
+    def_nodes.clear();
+    if (const auto *defs = RD->getLoadedResults(node->getKey())) {
+        for (const llvm::Value *def : *defs)
+            addDefNodes(const_cast<llvm::Value *>(def));
+    }
+
+    addIncomingDefs(node);
 }
 
 // \param mem   current reaching definitions point
@@ -289,7 +631,15 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
                                            RDNode *mem, uint64_t size)
 {
     using namespace dg::analysis;
-    static std::set<const llvm::Value *> reported_mappings;
+
+    bool unknown_defs = false;
+
+    // Get even reaching definitions for UNKNOWN_MEMORY.
+    // Since those can be ours definitions, we must add them always.
+    // They are the same for all pointers, so query them only once
+    rd_sites.clear();
+    rd_pointers.clear();
+    rd_sites.emplace_back(rd::UNKNOWN_MEMORY, UNKNOWN_OFFSET, UNKNOWN_OFFSET);
 
     for (const pta::Pointer& ptr : pts->pointsTo) {
         if (!ptr.isValid())
@@ -300,36 +650,47 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
 
         RDNode *val = RD->getNode(llvmVal);
         if(!val) {
-            if (reported_mappings.insert(llvmVal).second)
+            getDiagnostics().reportOnce(Diagnostics::NO_INFORMATION, llvmVal,
+                                        [llvmVal]() {
                 llvmutils::printerr("DEF-USE: no information for: ", llvmVal);
+            });
 
             // XXX: shouldn't we set val to unknown location now?
             continue;
         }
 
-        std::set<RDNode *> defs;
-        // Get even reaching definitions for UNKNOWN_MEMORY.
-        // Since those can be ours definitions, we must add them always
-        mem->getReachingDefinitions(rd::UNKNOWN_MEMORY, UNKNOWN_OFFSET, UNKNOWN_OFFSET, defs);
-        if (!defs.empty()) {
-            for (RDNode *rd : defs) {
-                assert(!rd->isUnknown() && "Unknown memory defined at unknown location?");
-                addDataDependence(node, rd);
-            }
+        rd_sites.emplace_back(val, ptr.offset, size);
+        rd_pointers.emplace_back(llvmVal, ptr.offset);
+    }
 
-            defs.clear();
-        }
+    // no memory that we know of
+    if (rd_pointers.empty()) {
+        flushDataDependences(node);
+        return;
+    }
+
+    // all the pointers at once, the pointers to one object
+    // follow each other in the points-to set
+    getReachingDefinitions(mem);
 
-        mem->getReachingDefinitions(val, ptr.offset, size, defs);
+    for (RDNode *rd : *rd_results[0]) {
+        assert(!rd->isUnknown() && "Unknown memory defined at unknown location?");
+        addDefinition(rd);
+    }
+
+    for (size_t i = 0; i < rd_pointers.size(); ++i) {
+        const std::vector<RDNode *>& defs = *rd_results[i + 1];
         if (defs.empty()) {
-            llvm::GlobalVariable *GV
+            const llvm::Value *llvmVal = rd_pointers[i].first;
+            analysis::Offset off = rd_pointers[i].second;
+            const llvm::GlobalVariable *GV
                 = llvm::dyn_cast<llvm::GlobalVariable>(llvmVal);
             if (!GV || !GV->hasInitializer()) {
-                static std::set<const llvm::Value *> reported;
-                if (reported.insert(llvmVal).second) {
+                getDiagnostics().reportOnce(Diagnostics::NO_DEFINITION, llvmVal,
+                                            [llvmVal, off]() {
                     llvm::errs() << "No reaching definition for: " << *llvmVal
-                                 << " off: " << *ptr.offset << "\n";
-                }
+                                 << " off: " << *off << "\n";
+                });
             }
 
             continue;
@@ -340,16 +701,19 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
             if (rd->isUnknown()) {
                 // we don't know what definitions reach this node,
                 // se we must add data dependence to all possible
-                // write to this memory
-                addUnknownDataDependence(node, pts);
-
-                // we can bail out, since we have added all
+                // write to this memory (only once for all pointers)
+                unknown_defs = true;
                 break;
             }
 
-            addDataDependence(node, rd);
+            addDefinition(rd);
         }
     }
+
+    if (unknown_defs)
+        addUnknownDataDependence(pts);
+
+    flushDataDependences(node);
 }
 
 void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node,
@@ -358,10 +722,12 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node,
                                            uint64_t size)
 {
     // get points-to information for the operand
-    PSNode *pts = PTA->getPointsTo(ptrOp);
+    PSNode *pts = getPointsTo(ptrOp);
     //assert(pts && "Don't have points-to information for LoadInst");
     if (!pts) {
-        llvmutils::printerr("ERROR: No points-to: ", ptrOp);
+        getDiagnostics().report([ptrOp]() {
+            llvmutils::printerr("ERROR: No points-to: ", ptrOp);
+        });
         return;
     }
 
@@ -375,11 +741,18 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node,
 {
     using namespace dg::analysis;
 
+    if (RD->hasLoadedResults()) {
+        addLoadedDefinitions(node);
+        return;
+    }
+
     // get the node from reaching definition where we have
     // all the reaching definitions
     RDNode *mem = RD->getMapping(where);
     if(!mem) {
-        llvmutils::printerr("ERROR: Don't have mapping: ", where);
+        getDiagnostics().report([where]() {
+            llvmutils::printerr("ERROR: Don't have mapping: ", where);
+        });
         return;
     }
 
@@ -401,10 +774,82 @@ void LLVMDefUseAnalysis::handleLoadInst(llvm::LoadInst *Inst, LLVMNode *node)
 {
     using namespace dg::analysis;
 
+    if (RD->hasLoadedResults()) {
+        addLoadedDefinitions(node);
+        return;
+    }
+
+    // the definitions of the loads of the promoted allocas
+    // are computed already (see LLVMRDBuilder::setPromoteLocals())
+    if (const auto *defs = RD->getLocalDefinitions(Inst)) {
+        if (defs->empty()) {
+            const llvm::Value *llvmVal = Inst->getPointerOperand();
+            getDiagnostics().reportOnce(Diagnostics::NO_DEFINITION, llvmVal,
+                                        [llvmVal]() {
+                llvm::errs() << "No reaching definition for: " << *llvmVal
+                             << " off: 0\n";
+            });
+        }
+
+        for (RDNode *rd : *defs)
+            addDefinition(rd);
+
+        flushDataDependences(node);
+        return;
+    }
+
     uint64_t size = getAllocatedSize(Inst->getType(), DL);
     addDataDependence(node, Inst, Inst->getPointerOperand(), size);
 }
 
+// find the node of @val in any graph
+LLVMNode *LLVMDefUseAnalysis::getNode(const llvm::Value *val)
+{
+    llvm::Value *key = const_cast<llvm::Value *>(val);
+    if (LLVMNode *node = dg->getNode(key))
+        return node;
+
+    const Instruction *Inst = dyn_cast<Instruction>(val);
+    if (!Inst)
+        return nullptr;
+
+    const Function *F = Inst->getParent()->getParent();
+    LLVMNode *entryNode = dg->getGlobalNode(const_cast<Function *>(F));
+    if (!entryNode)
+        return nullptr;
+
+    return entryNode->getDG()->getNode(key);
+}
+
+void LLVMDefUseAnalysis::update(const std::vector<const llvm::Value *>& changed)
+{
+    // the graph of RD was rebuilt, build the index of stores again
+    // and connect the hubs to the new stores
+    stores_index.clear();
+    stores_indexed = false;
+
+    for (const auto& it : dg->getMemoryHubs()) {
+        LLVMNode *hub = it.second;
+        hub->removeIncomingDDs();
+
+        const StoresIndexT& index = getStoresIndex();
+        auto sit = index.find(it.first);
+        if (sit != index.end())
+            connectMemoryHub(hub, sit->second);
+    }
+
+    for (const llvm::Value *val : changed) {
+        LLVMNode *node = getNode(val);
+        if (!node)
+            continue;
+
+        // all the incoming data dependencies of the node
+        // are added by runOnNode(), so just add them again
+        node->removeIncomingDDs();
+        runOnNode(node, nullptr);
+    }
+}
+
 bool LLVMDefUseAnalysis::runOnNode(LLVMNode *node, LLVMNode *prev)
 {
     Value *val = node->getKey();
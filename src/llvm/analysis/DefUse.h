@@ -1,6 +1,13 @@
 #ifndef _LLVM_DEF_USE_ANALYSIS_H_
 #define _LLVM_DEF_USE_ANALYSIS_H_
 
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/DataLayout.h>
@@ -22,11 +29,84 @@ class LLVMNode;
 
 class LLVMDefUseAnalysis : public analysis::DataFlowAnalysis<LLVMNode>
 {
+    // the warnings of the analysis, every warning is printed
+    // only once for a value. The workers of the parallel run
+    // print into the sink of the analysis that started them
+    class Diagnostics {
+        std::mutex lock;
+        std::set<std::pair<unsigned, const llvm::Value *>> reported;
+
+    public:
+        enum Kind { STACK_SAVE, NO_INFORMATION, NO_DEFINITION };
+
+        template <typename PrintT>
+        void report(PrintT print)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            print();
+        }
+
+        template <typename PrintT>
+        void reportOnce(Kind kind, const llvm::Value *val, PrintT print)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (reported.emplace(kind, val).second)
+                print();
+        }
+    };
+
     LLVMDependenceGraph *dg;
     LLVMReachingDefinitions *RD;
     LLVMPointerAnalysis *PTA;
     const llvm::DataLayout *DL;
     bool assume_pure_functions;
+
+    unsigned threads = 1;
+    // free the reaching definitions of the functions
+    // as soon as their edges are added (see setReleaseDefinitions())
+    bool release_definitions = false;
+    // the analysis that started this worker (nullptr if this
+    // is not a worker), the workers share its diagnostics
+    // and its lock of queries
+    LLVMDefUseAnalysis *parent = nullptr;
+    Diagnostics diagnostics;
+    // the demand-driven PTA and memory SSA compute the results
+    // of queries, so the workers must not query them at once
+    std::mutex queries_lock;
+    bool lock_queries = false;
+    // the edges (def, use) found by the worker, the workers do not
+    // touch the graphs, the edges are added after they finish
+    std::vector<std::pair<LLVMNode *, LLVMNode *>> deferred_edges;
+
+    // the STORE nodes of RD indexed by the values of the memory
+    // that they define (see addUnknownDataDependence). Built at the
+    // first use and shared by the workers
+    using StoresIndexT = std::unordered_map<const llvm::Value *,
+                                            std::vector<analysis::rd::RDNode *>>;
+    StoresIndexT stores_index;
+    std::atomic<bool> stores_indexed{false};
+    std::mutex stores_lock;
+    // the memory with at least this many stores gets a hub
+    // (see setMemoryHubs()), 0 means no hubs
+    unsigned hub_threshold = 0;
+
+    // the scratch buffers reused by the queries of all nodes:
+    // the def-sites that the current node reads (the unknown memory
+    // first), the pointers to them (for the diagnostics), the results
+    // of the queries of the def-sites, the definitions gathered
+    // for the current node (deduplicated by the ids of RDNodes)
+    // and the nodes of the definitions
+    std::vector<analysis::rd::DefSite> rd_sites;
+    std::vector<std::pair<const llvm::Value *, analysis::Offset>> rd_pointers;
+    std::vector<analysis::rd::RDQueryCache::ResultT> rd_results;
+    // the cache of the queries of a worker of the parallel run
+    // (the sequential run uses the cache of RD)
+    analysis::rd::RDQueryCache rd_cache;
+    std::vector<analysis::rd::RDNode *> rd_defs;
+    std::vector<bool> rd_seen;
+    std::vector<LLVMNode *> def_nodes;
+    // the hubs that the current node depends on
+    std::vector<LLVMNode *> hub_defs;
 public:
     LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
                        LLVMReachingDefinitions *rd,
@@ -34,9 +114,66 @@ public:
                        bool assume_pure_functions = false);
     ~LLVMDefUseAnalysis() { delete DL; }
 
+    // add the def-use edges to all the graphs. With more threads,
+    // the graphs of the functions are processed by a pool of workers
+    // and the edges are added to the graphs afterwards. Does nothing
+    // if the graph is built without the data dependencies
+    // (see LLVMDGBuildOptions)
+    void run();
+
+    // Default is 1 (run sequentially)
+    void setThreads(unsigned n) { threads = n; }
+
+    // process the functions bottom-up by the components of the call graph
+    // and free the reaching definitions of every component once its edges
+    // are added (see LLVMReachingDefinitions::releaseFunction()), so that
+    // the maps of all the functions are not kept together with the edges.
+    // With more threads, the components of one level of the call graph
+    // are processed in parallel. RD cannot be queried after run() then
+    // (also update() cannot be used). Default is false
+    void setReleaseDefinitions(bool r) { release_definitions = r; }
+
+    // the loads with unknown reaching definitions depend on a hub of the
+    // memory (see LLVMDependenceGraph::getMemoryHub()) instead of on all
+    // the stores to the memory when there are at least @threshold stores.
+    // The slices stay the same. Default is 0 (no hubs)
+    void setMemoryHubs(unsigned threshold) { hub_threshold = threshold; }
+
+    // add the def-use edges of the nodes of @graph only (the incoming
+    // data dependencies of the nodes), sequentially
+    // (see LLVMDependenceGraph::setLazyDataDependencies())
+    void addEdges(LLVMDependenceGraph *graph);
+
     /* virtual */
     bool runOnNode(LLVMNode *node, LLVMNode *prev);
+
+    // recompute the def-use edges of the instructions @changed (the result
+    // of LLVMReachingDefinitions::update()). The edges of the other
+    // instructions stay. The graphs must contain the changed instructions
+    void update(const std::vector<const llvm::Value *>& changed);
 private:
+    // create a worker of the parallel run
+    LLVMDefUseAnalysis(LLVMDefUseAnalysis *parent);
+
+    Diagnostics& getDiagnostics()
+    {
+        return parent ? parent->diagnostics : diagnostics;
+    }
+
+    PSNode *getPointsTo(const llvm::Value *val);
+    void getReachingDefinitions(analysis::rd::RDNode *where);
+
+    void runOnGraphs(const std::vector<LLVMDependenceGraph *>& graphs);
+    void runBottomUp();
+
+    void addDefUseEdge(LLVMNode *def, LLVMNode *use);
+    void addDeferredEdges(std::vector<std::pair<LLVMNode *, LLVMNode *>>& edges);
+
+    LLVMNode *getNode(const llvm::Value *val);
+
+    void handleInstruction(const llvm::Instruction *Inst, LLVMNode *node);
+    void addReturnEdge(LLVMNode *callNode, LLVMDependenceGraph *subgraph);
+
     void addDataDependence(LLVMNode *node,
                            analysis::pta::PSNode *pts,
                            analysis::rd::RDNode *mem,
@@ -52,10 +189,16 @@ private:
                            PSNode *pts, /* what memory */
                            uint64_t size);
 
-    void addDataDependence(LLVMNode *node, analysis::rd::RDNode *rd);
-    void addDataDependence(LLVMNode *node, llvm::Value *val);
+    void addDefinition(analysis::rd::RDNode *rd);
+    void addDefNodes(llvm::Value *val);
+    void addIncomingDefs(LLVMNode *node);
+    void flushDataDependences(LLVMNode *node);
+    void addLoadedDefinitions(LLVMNode *node);
 
-    void addUnknownDataDependence(LLVMNode *node, PSNode *pts);
+    const StoresIndexT& getStoresIndex();
+    void connectMemoryHub(LLVMNode *hub,
+                          const std::vector<analysis::rd::RDNode *>& stores);
+    void addUnknownDataDependence(PSNode *pts);
 
     void handleLoadInst(llvm::LoadInst *, LLVMNode *);
     void handleCallInst(LLVMNode *);
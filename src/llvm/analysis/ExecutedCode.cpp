@@ -0,0 +1,168 @@
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/Config/llvm-config.h>
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+ #include <llvm/Support/CFG.h>
+#else
+ #include <llvm/IR/CFG.h>
+#endif
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "ExecutedCode.h"
+
+namespace dg {
+
+bool ExecutedCode::parse(std::istream& in, std::string& error,
+                         const std::string& name)
+{
+    std::string line;
+    unsigned lineno = 0;
+
+    while (std::getline(in, line)) {
+        ++lineno;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream ss(line);
+        std::string item, rest;
+        if (!(ss >> item))
+            continue;
+
+        if (ss >> rest) {
+            error = name + ":" + std::to_string(lineno)
+                    + ": expected one function or block on a line";
+            return false;
+        }
+
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            functions[item].all = true;
+        } else if (colon == 0 || colon + 1 == item.size()) {
+            error = name + ":" + std::to_string(lineno)
+                    + ": invalid block '" + item + "'";
+            return false;
+        } else {
+            functions[item.substr(0, colon)].listed.insert(item.substr(colon + 1));
+        }
+    }
+
+    return true;
+}
+
+bool ExecutedCode::load(const std::string& path, std::string& error)
+{
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        error = "Cannot open the file " + path;
+        return false;
+    }
+
+    return parse(ifs, error, path);
+}
+
+bool ExecutedCode::isExecuted(const llvm::Function& F) const
+{
+    return functions.count(F.getName().str()) > 0;
+}
+
+bool ExecutedCode::isExecuted(const llvm::BasicBlock& B, unsigned idx) const
+{
+    auto it = functions.find(B.getParent()->getName().str());
+    if (it == functions.end())
+        return false;
+
+    const Blocks& blocks = it->second;
+    return blocks.all || idx == 0 || blocks.listed.count(std::to_string(idx)) > 0 ||
+           (B.hasName() && blocks.listed.count(B.getName().str()) > 0);
+}
+
+// replace the instructions of the block by 'unreachable'
+static void makeUnreachable(llvm::BasicBlock& B)
+{
+    using namespace llvm;
+
+    // the successors are not reached from this block any more
+    for (auto I = succ_begin(&B), E = succ_end(&B); I != E; ++I) {
+        if (*I != &B)
+            (*I)->removePredecessor(&B);
+    }
+
+    while (!B.empty()) {
+        Instruction& I = B.back();
+        if (!I.use_empty())
+            I.replaceAllUsesWith(UndefValue::get(I.getType()));
+        I.eraseFromParent();
+    }
+
+    new UnreachableInst(B.getContext(), &B);
+}
+
+ExecutedCode::Statistics
+ExecutedCode::restrictModule(llvm::Module& M, const std::string& entry) const
+{
+    Statistics stats;
+
+    for (llvm::Function& F : M) {
+        if (F.isDeclaration())
+            continue;
+
+        if (!isExecuted(F) && F.getName() != entry) {
+            // keep only the entry block with 'unreachable'
+            std::vector<llvm::BasicBlock *> blocks;
+            for (llvm::BasicBlock& B : F) {
+                makeUnreachable(B);
+                blocks.push_back(&B);
+            }
+
+            for (size_t i = 1; i < blocks.size(); ++i)
+                blocks[i]->eraseFromParent();
+
+            ++stats.functions;
+            continue;
+        }
+
+        unsigned idx = 0;
+        std::vector<llvm::BasicBlock *> blocks;
+        for (llvm::BasicBlock& B : F) {
+            if (!isExecuted(B, idx++))
+                blocks.push_back(&B);
+        }
+
+        // the indices are taken before any block is changed
+        for (llvm::BasicBlock *B : blocks)
+            makeUnreachable(*B);
+
+        stats.blocks += blocks.size();
+    }
+
+    if (stats.functions > 0 || stats.blocks > 0)
+        M.getOrInsertNamedMetadata("dg.executed-code");
+
+    return stats;
+}
+
+} // namespace dg
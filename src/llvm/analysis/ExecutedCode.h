@@ -0,0 +1,81 @@
+#ifndef _LLVM_DG_EXECUTED_CODE_H_
+#define _LLVM_DG_EXECUTED_CODE_H_
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// forward declaration of llvm classes
+namespace llvm {
+    class Module;
+    class Function;
+    class BasicBlock;
+} // namespace llvm
+
+namespace dg {
+
+///
+// The functions and basic blocks that were executed in some runs
+// of the program (taken from the coverage or the profiling data).
+// The lists are loaded from text files with one item per line:
+//
+//   # executed functions
+//   main
+//   parse_args
+//   # the executed blocks of a function by their name or index
+//   handle_request:entry
+//   handle_request:3
+//
+// A function that is listed by its name alone has all its blocks
+// executed, otherwise only the listed blocks (and the entry block)
+// of the function were executed. The blocks are numbered from 0
+// in the order of the function. Loading more files merges them.
+//
+// restrictModule() makes the code that was not executed unreachable,
+// so that the pointer subgraph, the reaching definitions and the
+// dependence graph are built only for the executed code. The results
+// are then valid only for the runs that execute the same code.
+class ExecutedCode
+{
+    struct Blocks {
+        // the function was listed by its name alone
+        bool all = false;
+        // the names or the indices of the listed blocks
+        std::unordered_set<std::string> listed;
+    };
+
+    std::unordered_map<std::string, Blocks> functions;
+
+public:
+    struct Statistics {
+        unsigned functions = 0;
+        unsigned blocks = 0;
+    };
+
+    // parse the list from @in, on an error return false
+    // and describe it in @error (@name is the name of the input
+    // used in the message)
+    bool parse(std::istream& in, std::string& error,
+               const std::string& name = "<input>");
+    // load the list from the file @path
+    bool load(const std::string& path, std::string& error);
+
+    bool isExecuted(const llvm::Function& F) const;
+    // @idx is the index of the block in the function
+    bool isExecuted(const llvm::BasicBlock& B, unsigned idx) const;
+
+    // replace the bodies of the functions (other than @entry) and the
+    // blocks that were not executed by 'unreachable' and mark the module
+    // by the named metadata 'dg.executed-code', so that the results
+    // are known to be unsound. Returns the number of the changed
+    // functions and blocks
+    Statistics restrictModule(llvm::Module& M, const std::string& entry = "main") const;
+
+    size_t size() const { return functions.size(); }
+};
+
+} // namespace dg
+
+#endif // _LLVM_DG_EXECUTED_CODE_H_
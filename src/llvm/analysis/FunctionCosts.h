@@ -0,0 +1,117 @@
+#ifndef _LLVM_DG_FUNCTION_COSTS_H_
+#define _LLVM_DG_FUNCTION_COSTS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+namespace dg {
+
+///
+// The costs of the fixpoint computation of an analysis summed
+// over the nodes that were built for the code of a function, so that
+// the functions that make the analysis slow can be summarized or left out
+struct FunctionCosts {
+    // how many nodes of the function were processed
+    uint64_t nodes = 0;
+    // how many times they were processed
+    uint64_t processed = 0;
+    // time spent in processing them (in nanoseconds)
+    uint64_t time = 0;
+    // the growth of their sets (what it is depends on the analysis)
+    uint64_t growth = 0;
+};
+
+// the function whose code is @val, nullptr for the globals
+inline const llvm::Function *getFunctionOf(const llvm::Value *val)
+{
+    if (!val)
+        return nullptr;
+    if (auto I = llvm::dyn_cast<llvm::Instruction>(val))
+        return I->getParent() ? I->getParent()->getParent() : nullptr;
+    if (auto A = llvm::dyn_cast<llvm::Argument>(val))
+        return A->getParent();
+
+    return nullptr;
+}
+
+// sum the statistics of the processed nodes @stats (a map of the nodes
+// to the statistics with the processed, time and growth members) over
+// the functions of the nodes given by @functions and print the @num
+// functions whose nodes took the most time. The nodes that are not
+// in @functions (and the nodes of the globals) are summed together
+template <typename NodeT, typename StatsT>
+void printFunctionCosts(llvm::raw_ostream& os,
+                        const std::unordered_map<NodeT *, StatsT>& stats,
+                        const std::unordered_map<const NodeT *,
+                                                 const llvm::Function *>& functions,
+                        size_t num)
+{
+    std::unordered_map<const llvm::Function *, FunctionCosts> costs;
+    uint64_t total = 0;
+    for (const auto& it : stats) {
+        auto fit = functions.find(it.first);
+        FunctionCosts& fc = costs[fit == functions.end() ? nullptr : fit->second];
+        ++fc.nodes;
+        fc.processed += it.second.processed;
+        fc.time += it.second.time;
+        fc.growth += it.second.growth;
+        total += it.second.time;
+    }
+
+    if (costs.empty())
+        return;
+
+    std::vector<std::pair<const llvm::Function *, FunctionCosts>>
+        sorted(costs.begin(), costs.end());
+    num = std::min(num, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + num, sorted.end(),
+                      [](const std::pair<const llvm::Function *, FunctionCosts>& a,
+                         const std::pair<const llvm::Function *, FunctionCosts>& b) {
+                          return a.second.time > b.second.time;
+                      });
+    sorted.resize(num);
+
+    os << "  the functions that took the most time:\n";
+    os << "       nodes   processed   time (ms)       %      growth  function\n";
+    for (const auto& it : sorted) {
+        const FunctionCosts& fc = it.second;
+        os << llvm::format("%12lu", fc.nodes)
+           << llvm::format("%12lu", fc.processed)
+           << llvm::format("%12.3f", fc.time / 1000000.0)
+           << llvm::format("%8.1f", total ? 100.0 * fc.time / total : 0.0)
+           << llvm::format("%12lu", fc.growth) << "  ";
+        if (it.first)
+            os << it.first->getName();
+        else
+            os << "<globals and other>";
+        os << "\n";
+    }
+}
+
+} // namespace dg
+
+#endif // _LLVM_DG_FUNCTION_COSTS_H_
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "FunctionSummaries.h"
+
+namespace dg {
+
+// parse the number of an argument, 'N...' sets @rest
+static bool parseArgument(const std::string& tok, unsigned& num, bool& rest)
+{
+    size_t len = tok.size();
+    rest = len > 3 && tok.compare(len - 3, 3, "...") == 0;
+    if (rest)
+        len -= 3;
+
+    if (len == 0 || len > 4)
+        return false;
+
+    for (size_t i = 0; i < len; ++i) {
+        if (tok[i] < '0' || tok[i] > '9')
+            return false;
+    }
+
+    num = static_cast<unsigned>(std::strtoul(tok.substr(0, len).c_str(), nullptr, 10));
+    return true;
+}
+
+static bool isArgument(const std::string& tok)
+{
+    unsigned num;
+    bool rest;
+    return parseArgument(tok, num, rest);
+}
+
+bool FunctionSummaries::parse(std::istream& in, std::string& error,
+                              const std::string& name)
+{
+    std::string line;
+    unsigned lineno = 0;
+    std::vector<std::string> toks;
+
+    auto fail = [&](const std::string& msg) {
+        error = name + ":" + std::to_string(lineno) + ": " + msg;
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        ++lineno;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        toks.clear();
+        std::istringstream ss(line);
+        std::string tok;
+        while (ss >> tok)
+            toks.push_back(tok);
+
+        if (toks.empty())
+            continue;
+
+        FunctionSummary S;
+        for (size_t i = 1; i < toks.size(); ++i) {
+            const std::string& effect = toks[i];
+            if (effect == "mod" || effect == "ref") {
+                FunctionSummary::Arguments& args = effect == "mod" ? S.mod : S.ref;
+                if (i + 1 == toks.size() || !isArgument(toks[i + 1]))
+                    return fail("'" + effect + "' needs the numbers of arguments");
+
+                while (i + 1 < toks.size() && isArgument(toks[i + 1])) {
+                    unsigned num;
+                    bool rest;
+                    parseArgument(toks[++i], num, rest);
+                    if (rest) {
+                        if (num < args.from)
+                            args.from = num;
+                    } else if (num < 64) {
+                        args.bits |= uint64_t(1) << num;
+                    } else {
+                        return fail("only the arguments 0 - 63 can be "
+                                    "given one by one, use '" +
+                                    toks[i] + "...'");
+                    }
+                }
+            } else if (effect == "ret") {
+                if (i + 1 == toks.size())
+                    return fail("'ret' needs an argument or 'alloc'");
+
+                const std::string& what = toks[++i];
+                unsigned num;
+                bool rest;
+                if (what == "alloc") {
+                    S.ret = FunctionSummary::Return::ALLOCATION;
+                } else if (parseArgument(what, num, rest) && !rest) {
+                    S.ret = FunctionSummary::Return::ARGUMENT;
+                    S.ret_arg = num;
+                } else {
+                    return fail("invalid returned value '" + what + "'");
+                }
+            } else {
+                return fail("unknown effect '" + effect + "'");
+            }
+        }
+
+        summaries[toks[0]] = S;
+    }
+
+    return true;
+}
+
+bool FunctionSummaries::load(const std::string& path, std::string& error)
+{
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        error = "Cannot open the file " + path;
+        return false;
+    }
+
+    return parse(ifs, error, path);
+}
+
+static void writeArguments(std::ostream& out, const char *effect,
+                           const FunctionSummary::Arguments& args)
+{
+    if (args.empty())
+        return;
+
+    out << " " << effect;
+    for (unsigned i = 0; i < 64 && i < args.from; ++i) {
+        if ((args.bits >> i) & 1)
+            out << " " << i;
+    }
+
+    if (args.from != FunctionSummary::NO_ARG)
+        out << " " << args.from << "...";
+}
+
+void FunctionSummaries::write(std::ostream& out) const
+{
+    std::vector<std::pair<std::string, const FunctionSummary *>> sorted;
+    sorted.reserve(summaries.size());
+    for (const auto& it : summaries)
+        sorted.emplace_back(it.first, &it.second);
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const auto& it : sorted) {
+        const FunctionSummary& S = *it.second;
+        out << it.first;
+        writeArguments(out, "mod", S.mod);
+        writeArguments(out, "ref", S.ref);
+
+        if (S.ret == FunctionSummary::Return::ARGUMENT)
+            out << " ret " << S.ret_arg;
+        else if (S.ret == FunctionSummary::Return::ALLOCATION)
+            out << " ret alloc";
+        out << "\n";
+    }
+}
+
+// FNV-1a
+static uint64_t hashBytes(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+uint64_t FunctionSummaries::getHash() const
+{
+    // the order of the map is not fixed, so combine
+    // the hashes of the summaries by a sum
+    uint64_t hash = summaries.size();
+    for (const auto& it : summaries) {
+        const FunctionSummary& S = it.second;
+        uint64_t h = hashBytes(14695981039346656037ULL,
+                               it.first.data(), it.first.size());
+        uint64_t fields[] = {S.mod.bits, S.mod.from, S.ref.bits, S.ref.from,
+                             static_cast<uint64_t>(S.ret), S.ret_arg};
+        hash += hashBytes(h, fields, sizeof fields);
+    }
+
+    return hash;
+}
+
+} // namespace dg
@@ -0,0 +1,113 @@
+#ifndef _LLVM_DG_FUNCTION_SUMMARIES_H_
+#define _LLVM_DG_FUNCTION_SUMMARIES_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace dg {
+
+///
+// The effects of an undefined (external) function on the memory
+// that is passed to it and the pointer that it returns. The analyses
+// use the summary instead of assuming that the function defines
+// and uses all the memory reachable from its arguments
+struct FunctionSummary {
+    enum : unsigned { NO_ARG = ~0U };
+
+    // a set of the arguments of a call
+    struct Arguments {
+        // the arguments 0 - 63
+        uint64_t bits = 0;
+        // this and all the following arguments (e.g. the variadic ones)
+        unsigned from = NO_ARG;
+
+        bool contains(unsigned i) const
+        {
+            return i >= from || (i < 64 && ((bits >> i) & 1));
+        }
+
+        bool empty() const { return bits == 0 && from == NO_ARG; }
+    };
+
+    enum class Return {
+        // the returned pointer points to unknown memory
+        UNKNOWN,
+        // the returned pointer points into the memory of an argument
+        ARGUMENT,
+        // the function returns newly allocated memory (like malloc)
+        ALLOCATION
+    };
+
+    // the arguments whose memory the function may write (mod)
+    // and read (ref), on any offset
+    Arguments mod;
+    Arguments ref;
+
+    Return ret = Return::UNKNOWN;
+    // the argument for Return::ARGUMENT
+    unsigned ret_arg = 0;
+};
+
+///
+// A database of the summaries of undefined functions. The summaries
+// are loaded from text files with one function per line:
+//
+//   # name   effects
+//   strlen   ref 0
+//   memchr   ref 0  ret 0
+//   strcpy   mod 0  ref 1  ret 0
+//   strdup   ref 0  ret alloc
+//   sprintf  mod 0  ref 1...
+//   abs
+//
+// 'mod' and 'ref' are followed by the numbers of the arguments
+// whose memory the function writes and reads, 'N...' means
+// the argument N and all the following. 'ret N' says that the function
+// returns a pointer into the memory of the argument N and 'ret alloc'
+// that it returns new memory. A function with no effects does not
+// touch any memory passed to it. The functions that are not in the
+// database keep the conservative treatment. Loading more files
+// merges them, the later summary of a function replaces the former.
+class FunctionSummaries
+{
+    std::unordered_map<std::string, FunctionSummary> summaries;
+
+public:
+    // parse the summaries from @in, on an error return false
+    // and describe it in @error (@name is the name of the input
+    // used in the message)
+    bool parse(std::istream& in, std::string& error,
+               const std::string& name = "<input>");
+    bool load(const std::string& path, std::string& error);
+
+    // the summary of the function @name, nullptr if there is none
+    const FunctionSummary *get(const std::string& name) const
+    {
+        auto it = summaries.find(name);
+        return it == summaries.end() ? nullptr : &it->second;
+    }
+
+    // add the summary of the function @name
+    // (replaces the former summary of the function)
+    void set(const std::string& name, const FunctionSummary& S)
+    {
+        summaries[name] = S;
+    }
+
+    size_t size() const { return summaries.size(); }
+
+    // write the summaries in the format of the files that parse()
+    // reads, sorted by the names of the functions
+    void write(std::ostream& out) const;
+
+    // a hash of the summaries (e.g. for the keys of cached results
+    // that depend on them), the same for the same summaries
+    uint64_t getHash() const;
+};
+
+} // namespace dg
+
+#endif // _LLVM_DG_FUNCTION_SUMMARIES_H_
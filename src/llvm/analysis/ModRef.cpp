@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/analysis/CallGraph.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "ModRef.h"
+
+namespace dg {
+namespace analysis {
+
+void LLVMModRefAnalysis::compute()
+{
+    using namespace llvm;
+
+    assert(PTA && "Need the points-to information");
+
+    std::vector<GlobalVariable *> gvs;
+    std::unordered_map<const Value *, unsigned> gids;
+    for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
+        gids.emplace(&*I, gvs.size());
+        gvs.push_back(const_cast<GlobalVariable *>(&*I));
+    }
+
+    const LLVMCallGraph& CG = PTA->getCallGraph();
+    const std::vector<const Function *>& funcs = CG.getFunctions();
+    const LLVMModuleInfo *info = PTA->getModuleInfo().get();
+
+    // the ids of the globals that the functions touch themselves
+    // (sorted later) and the functions that may touch an unknown memory
+    std::vector<std::vector<unsigned>> touched(funcs.size());
+    std::vector<char> unknown(funcs.size(), false);
+
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+        auto addPointer = [&](const Value *ptr) {
+            auto git = gids.find(ptr->stripPointerCasts());
+            if (git != gids.end()) {
+                touched[i].push_back(git->second);
+                return;
+            }
+
+            pta::PSNode *op = PTA->getPointsTo(ptr);
+            if (!op) {
+                // null, undef and similar constants
+                if (!isa<Constant>(ptr))
+                    unknown[i] = true;
+                return;
+            }
+
+            for (const pta::Pointer& p : op->pointsTo) {
+                if (p.isUnknown()) {
+                    unknown[i] = true;
+                } else if (p.isValid()) {
+                    git = gids.find(p.target->getUserData<Value>());
+                    if (git != gids.end())
+                        touched[i].push_back(git->second);
+                }
+            }
+        };
+
+        for (const BasicBlock& B : *funcs[i]) {
+            for (const Instruction& Inst : B) {
+                if (const LoadInst *LI = dyn_cast<LoadInst>(&Inst)) {
+                    addPointer(LI->getPointerOperand());
+                } else if (const StoreInst *SI = dyn_cast<StoreInst>(&Inst)) {
+                    addPointer(SI->getPointerOperand());
+                } else if (const AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&Inst)) {
+                    addPointer(RMW->getPointerOperand());
+                } else if (const AtomicCmpXchgInst *CX
+                            = dyn_cast<AtomicCmpXchgInst>(&Inst)) {
+                    addPointer(CX->getPointerOperand());
+                } else if (const CallInst *CI = dyn_cast<CallInst>(&Inst)) {
+                    // the callees are in the call graph
+                    const Value *calledVal = CI->getCalledValue()->stripPointerCasts();
+                    const Function *F = dyn_cast<Function>(calledVal);
+                    if ((F && F->isDeclaration()) || isa<InlineAsm>(calledVal)) {
+                        // undefined function (memcpy, ...) touches
+                        // the memory passed to it (only the memory
+                        // in its summary if it has one)
+                        const FunctionSummary *S = info->getSummary(F);
+                        for (unsigned a = 0; a < CI->getNumArgOperands(); ++a) {
+                            if (S && !S->mod.contains(a) && !S->ref.contains(a))
+                                continue;
+
+                            const Value *arg = CI->getArgOperand(a);
+                            if (arg->getType()->isPointerTy())
+                                addPointer(arg);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::sort(touched[i].begin(), touched[i].end());
+        touched[i].erase(std::unique(touched[i].begin(), touched[i].end()),
+                         touched[i].end());
+    }
+
+    // the components are in reverse topological order,
+    // so the callees are summarized before their callers
+    const auto& components = CG.getComponents();
+    std::vector<std::vector<unsigned>> summary(components.size());
+    std::vector<char> comp_unknown(components.size(), false);
+
+    std::vector<unsigned> merged;
+    for (unsigned c = 0; c < components.size(); ++c) {
+        std::vector<unsigned>& S = summary[c];
+        for (unsigned i : components[c]) {
+            comp_unknown[c] |= unknown[i];
+
+            merged.clear();
+            std::set_union(S.begin(), S.end(), touched[i].begin(), touched[i].end(),
+                           std::back_inserter(merged));
+            S.swap(merged);
+
+            for (unsigned callee : CG.getCallees(i)) {
+                unsigned cc = CG.getComponentId(callee);
+                if (cc == c)
+                    continue;
+
+                assert(cc < c && "The callee was not summarized yet");
+                comp_unknown[c] |= comp_unknown[cc];
+                merged.clear();
+                std::set_union(S.begin(), S.end(),
+                               summary[cc].begin(), summary[cc].end(),
+                               std::back_inserter(merged));
+                S.swap(merged);
+            }
+        }
+
+        if (comp_unknown[c])
+            continue;
+
+        for (unsigned i : components[c]) {
+            GlobalsT& G = globals[funcs[i]];
+            G.reserve(S.size());
+            for (unsigned g : S)
+                G.push_back(gvs[g]);
+        }
+    }
+}
+
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,74 @@
+#ifndef _LLVM_DG_MOD_REF_H_
+#define _LLVM_DG_MOD_REF_H_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// forward declaration of llvm classes
+namespace llvm {
+    class Module;
+    class Function;
+    class GlobalVariable;
+} // namespace llvm
+
+namespace dg {
+
+class LLVMPointerAnalysis;
+
+namespace analysis {
+
+///
+// The global variables that a function (or some function called
+// from it) may read or write. The memory accessed by the loads,
+// stores and the calls of undefined functions (via their pointer
+// arguments) is taken from the points-to information, the sets
+// of the callees are added bottom-up over the call graph (the calls
+// via function pointers are resolved with the points-to information,
+// too). A function that may access an unknown memory (or calls such
+// a function) may touch any global and has no set.
+//
+// The dependence graph adds the formal parameters only for
+// the globals in these sets.
+class LLVMModRefAnalysis
+{
+public:
+    using GlobalsT = std::vector<llvm::GlobalVariable *>;
+
+    LLVMModRefAnalysis(const llvm::Module *m, LLVMPointerAnalysis *pta = nullptr)
+        : M(m), PTA(pta) {}
+
+    // compute the sets of all the defined functions,
+    // needs the points-to information
+    void compute();
+
+    // the globals that @F may touch in the order of the module,
+    // nullptr if the function may touch any global
+    const GlobalsT *getGlobals(const llvm::Function *F) const
+    {
+        auto it = globals.find(F);
+        return it == globals.end() ? nullptr : &it->second;
+    }
+
+    // set the globals of @F (when the sets are loaded from a file)
+    void setGlobals(const llvm::Function *F, GlobalsT&& G)
+    {
+        globals[F] = std::move(G);
+    }
+
+    const std::unordered_map<const llvm::Function *, GlobalsT>& getAllGlobals() const
+    {
+        return globals;
+    }
+
+private:
+    const llvm::Module *M;
+    LLVMPointerAnalysis *PTA;
+
+    std::unordered_map<const llvm::Function *, GlobalsT> globals;
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _LLVM_DG_MOD_REF_H_
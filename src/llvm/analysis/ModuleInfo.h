@@ -0,0 +1,290 @@
+#ifndef _LLVM_DG_MODULE_INFO_H_
+#define _LLVM_DG_MODULE_INFO_H_
+
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/TypeFinder.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "analysis/PointsTo/PointsToMap.h"
+#include "llvm/analysis/FunctionSummaries.h"
+
+namespace dg {
+
+enum MemAllocationFuncs {
+    NONEMEM = 0,
+    MALLOC,
+    CALLOC,
+    ALLOCA,
+    REALLOC,
+};
+
+///
+// The information about the module that both the builder of the pointer
+// subgraph and the builder of the reaching definitions graph need.
+// The builder of the pointer subgraph creates it and the builder
+// of RD takes it from the points-to analysis, so the functions and
+// types are classified only once.
+// The struct types of the module are classified up front, the rest
+// is computed lazily and cached. It is not thread-safe (the builders
+// are not used from more threads at once).
+class LLVMModuleInfo
+{
+    struct FunctionInfo {
+        MemAllocationFuncs allocation;
+        // the function has a body
+        bool defined;
+    };
+
+    struct TypeInfo {
+        // the size of the memory allocated for the type
+        // (0 if the type has no size)
+        uint64_t size;
+        // the type is a pointer or has a pointer as a subtype
+        bool containsPointer;
+        // a pointer can be stored in the type
+        // (a pointer or an integer large enough)
+        bool canBePointer;
+    };
+
+    const llvm::DataLayout *DL;
+    std::unordered_map<const llvm::Function *, FunctionInfo> functions;
+    std::unordered_map<llvm::Type *, TypeInfo> types;
+    // the layouts of the memory objects of the types
+    // (nullptr if the type has no layout), see getFieldLayout
+    std::unordered_map<llvm::Type *,
+                       std::unique_ptr<analysis::pta::FieldLayout>> layouts;
+    // the summaries of the undefined functions
+    std::shared_ptr<const FunctionSummaries> summaries;
+
+    const FunctionInfo& getFunctionInfo(const llvm::Function *func)
+    {
+        auto it = functions.find(func);
+        if (it != functions.end())
+            return it->second;
+
+        FunctionInfo info;
+        info.allocation = NONEMEM;
+        // func->size() may walk the list of blocks
+        info.defined = !func->empty();
+
+        if (func->hasName()) {
+            const char *name = func->getName().data();
+            if (strcmp(name, "malloc") == 0)
+                info.allocation = MALLOC;
+            else if (strcmp(name, "calloc") == 0)
+                info.allocation = CALLOC;
+            else if (strcmp(name, "alloca") == 0)
+                info.allocation = ALLOCA;
+            else if (strcmp(name, "realloc") == 0)
+                info.allocation = REALLOC;
+        }
+
+        return functions.emplace(func, info).first->second;
+    }
+
+    const TypeInfo& getTypeInfo(llvm::Type *Ty)
+    {
+        auto it = types.find(Ty);
+        if (it != types.end())
+            return it->second;
+
+        TypeInfo info;
+        // Type can be i8 *null or similar
+        info.size = Ty->isSized() ? DL->getTypeAllocSize(Ty) : 0;
+        info.canBePointer = Ty->isPointerTy();
+        if (Ty->isIntegerTy() && Ty->isSized())
+            info.canBePointer = DL->getTypeSizeInBits(Ty)
+                                    >= DL->getPointerSizeInBits();
+
+        if (Ty->isAggregateType()) {
+            // a type cannot contain itself (only a pointer to itself),
+            // so the recursion terminates. The subtypes are classified
+            // (and cached) before this type is inserted
+            info.containsPointer = false;
+            for (auto I = Ty->subtype_begin(), E = Ty->subtype_end();
+                 I != E; ++I) {
+                if (getTypeInfo(*I).containsPointer) {
+                    info.containsPointer = true;
+                    break;
+                }
+            }
+        } else
+            info.containsPointer = Ty->isPointerTy();
+
+        return types.emplace(Ty, info).first->second;
+    }
+
+    // gather the offsets of the scalar fields of @Ty that can
+    // hold a pointer. The arrays are represented by their first
+    // element, the other elements are not fields in the layout
+    bool addFields(llvm::Type *Ty, uint64_t off, std::vector<uint64_t>& offsets)
+    {
+        if (offsets.size() > MAX_LAYOUT_FIELDS)
+            return false;
+
+        if (llvm::StructType *STy = llvm::dyn_cast<llvm::StructType>(Ty)) {
+            if (STy->isOpaque())
+                return false;
+
+            const llvm::StructLayout *SL = DL->getStructLayout(STy);
+            for (unsigned i = 0; i < STy->getNumElements(); ++i) {
+                if (!addFields(STy->getElementType(i),
+                               off + SL->getElementOffset(i), offsets))
+                    return false;
+            }
+        } else if (llvm::ArrayType *ATy = llvm::dyn_cast<llvm::ArrayType>(Ty)) {
+            if (ATy->getNumElements() > 0)
+                return addFields(ATy->getElementType(), off, offsets);
+        } else if (canBePointer(Ty))
+            offsets.push_back(off);
+
+        return true;
+    }
+
+public:
+    LLVMModuleInfo(const llvm::Module *M)
+        : DL(new llvm::DataLayout(M))
+    {
+        // classify the struct types (and their subtypes) now,
+        // so that the builders only look them up. Walking
+        // large struct types is the expensive part.
+        // This is done sequentially, computing the layout
+        // of a struct in DataLayout is not thread-safe.
+        llvm::TypeFinder structs;
+        structs.run(*M, /* onlyNamed = */ false);
+        for (llvm::StructType *STy : structs)
+            getTypeInfo(STy);
+    }
+
+    ~LLVMModuleInfo() { delete DL; }
+
+    LLVMModuleInfo(const LLVMModuleInfo&) = delete;
+    LLVMModuleInfo& operator=(const LLVMModuleInfo&) = delete;
+
+    // is the function one of the memory allocation functions?
+    MemAllocationFuncs getMemAllocationFunc(const llvm::Function *func)
+    {
+        if (!func)
+            return NONEMEM;
+
+        return getFunctionInfo(func).allocation;
+    }
+
+    // does the function have a body?
+    bool isDefined(const llvm::Function *func)
+    {
+        return getFunctionInfo(func).defined;
+    }
+
+    // use the summaries of the undefined functions (see FunctionSummaries),
+    // must be set before the builders run
+    void setFunctionSummaries(std::shared_ptr<const FunctionSummaries> s)
+    {
+        summaries = std::move(s);
+    }
+
+    // the summary of the undefined function @func, nullptr if the function
+    // has a body or there is no summary for it. The summaries are not
+    // modified, so this may be called from more threads at once
+    const FunctionSummary *getSummary(const llvm::Function *func) const
+    {
+        if (!summaries || !func || !func->empty() || !func->hasName())
+            return nullptr;
+
+        return summaries->get(func->getName().str());
+    }
+
+    // the size of the memory allocated for the type,
+    // 0 if the type has no size
+    uint64_t getAllocatedSize(llvm::Type *Ty)
+    {
+        return getTypeInfo(Ty).size;
+    }
+
+    // is the type a pointer or does it contain
+    // a pointer as a subtype (recursively)?
+    bool containsPointer(llvm::Type *Ty)
+    {
+        return getTypeInfo(Ty).containsPointer;
+    }
+
+    // can a value of the type carry a pointer?
+    // (it is a pointer or an integer as large as a pointer)
+    bool canBePointer(llvm::Type *Ty)
+    {
+        return getTypeInfo(Ty).canBePointer;
+    }
+
+    // do not keep the layouts of the types with more fields,
+    // their memory objects keep all the offsets in a flat map
+    static const size_t MAX_LAYOUT_FIELDS = 256;
+
+    // the offsets of the fields of @Ty that can hold a pointer
+    // taken from the DataLayout, nullptr if the type has no
+    // such fields or too many of them. The layouts are owned
+    // by this object
+    const analysis::pta::FieldLayout *getFieldLayout(llvm::Type *Ty)
+    {
+        auto it = layouts.find(Ty);
+        if (it != layouts.end())
+            return it->second.get();
+
+        std::unique_ptr<analysis::pta::FieldLayout> layout;
+        std::vector<uint64_t> offsets;
+        if (Ty->isSized() && addFields(Ty, 0, offsets)
+            && !offsets.empty() && offsets.size() <= MAX_LAYOUT_FIELDS)
+            layout.reset(new analysis::pta::FieldLayout(std::move(offsets)));
+
+        return layouts.emplace(Ty, std::move(layout)).first->second.get();
+    }
+
+    uint64_t getAllocatedSize(const llvm::AllocaInst *AI)
+    {
+        uint64_t size = getAllocatedSize(AI->getAllocatedType());
+        if (AI->isArrayAllocation())
+            return getConstantValue(AI->getArraySize()) * size;
+
+        return size;
+    }
+
+    // the value of the constant integer, 0 (unknown) if the
+    // value is not a constant or does not fit into uint64_t
+    static uint64_t getConstantValue(const llvm::Value *op)
+    {
+        uint64_t size = 0;
+        if (const llvm::ConstantInt *C = llvm::dyn_cast<llvm::ConstantInt>(op)) {
+            size = C->getLimitedValue();
+            if (size == ~((uint64_t) 0))
+                size = 0;
+        }
+
+        return size;
+    }
+};
+
+} // namespace dg
+
+#endif // _LLVM_DG_MODULE_INFO_H_
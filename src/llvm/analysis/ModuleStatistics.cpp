@@ -0,0 +1,124 @@
+#include <algorithm>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/analysis/ModuleInfo.h"
+#include "ModuleStatistics.h"
+
+namespace dg {
+
+static bool usesPointer(const llvm::Instruction& I)
+{
+    if (I.getType()->isPointerTy())
+        return true;
+
+    for (const llvm::Use& op : I.operands()) {
+        if (op->getType()->isPointerTy())
+            return true;
+    }
+
+    return false;
+}
+
+// the deepest nesting of the loops of @F
+static unsigned getLoopDepth(const llvm::Function& F)
+{
+    using namespace llvm;
+
+    Function& Fn = const_cast<Function&>(F);
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 7))
+    DominatorTreeBase<BasicBlock> DT(false);
+    DT.recalculate(Fn);
+    LoopInfoBase<BasicBlock, Loop> LI;
+    LI.Analyze(DT);
+#else
+    DominatorTree DT(Fn);
+    LoopInfo LI(DT);
+#endif
+
+    unsigned depth = 0;
+    for (const BasicBlock& B : F)
+        depth = std::max(depth, LI.getLoopDepth(&B));
+
+    return depth;
+}
+
+ModuleStatistics ModuleStatistics::compute(const llvm::Module& M)
+{
+    using namespace llvm;
+
+    ModuleStatistics st;
+    LLVMModuleInfo info(&M);
+
+    st.globals = M.global_size();
+    st.allocations = st.globals;
+    st.pointerNodes = st.globals;
+
+    for (const Function& F : M) {
+        // the address of the function
+        ++st.pointerNodes;
+        if (F.isDeclaration())
+            continue;
+
+        ++st.functions;
+        bool branches = false;
+        for (const BasicBlock& B : F) {
+            branches |= B.getTerminator()->getNumSuccessors() > 0;
+            for (const Instruction& I : B) {
+                ++st.instructions;
+                if (usesPointer(I))
+                    ++st.pointerNodes;
+
+                if (isa<AllocaInst>(I)) {
+                    ++st.allocations;
+                } else if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+                    const Value *callee = CI->getCalledValue()->stripPointerCasts();
+                    const Function *func = dyn_cast<Function>(callee);
+                    if (!func)
+                        ++st.indirectCalls;
+                    else if (info.getMemAllocationFunc(func) != NONEMEM)
+                        ++st.allocations;
+                }
+            }
+        }
+
+        // only the functions with branches can have loops
+        if (branches)
+            st.loopDepth = std::max(st.loopDepth, getLoopDepth(F));
+    }
+
+    return st;
+}
+
+void ModuleStatistics::print(llvm::raw_ostream& os) const
+{
+    os << "Functions/Globals/Instr.: " << functions << " " << globals
+       << " " << instructions << "\n";
+    os << "Allocation sites: " << allocations << "\n";
+    os << "Indirect calls: " << indirectCalls << "\n";
+    os << "Estimated pointer subgraph nodes: " << pointerNodes << "\n";
+    os << "Loop depth: " << loopDepth << "\n";
+}
+
+} // namespace dg
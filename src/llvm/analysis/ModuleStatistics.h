@@ -0,0 +1,43 @@
+#ifndef _LLVM_DG_MODULE_STATISTICS_H_
+#define _LLVM_DG_MODULE_STATISTICS_H_
+
+#include <cstdint>
+
+// forward declaration of llvm classes
+namespace llvm {
+    class Module;
+    class raw_ostream;
+} // namespace llvm
+
+namespace dg {
+
+///
+// The statistics of a module that are gathered in one pass over its
+// instructions before any analysis runs, so that the configuration
+// of the analyses can be chosen by the size and the shape of the code
+// (see -auto of llvm-slicer). The number of the nodes of the pointer
+// subgraph is only estimated (the builder creates more nodes for some
+// instructions and none for the others)
+struct ModuleStatistics {
+    // the defined functions
+    uint64_t functions = 0;
+    uint64_t globals = 0;
+    uint64_t instructions = 0;
+    // the allocas, the globals and the calls of the allocation functions
+    uint64_t allocations = 0;
+    // the calls via pointers
+    uint64_t indirectCalls = 0;
+    // the instructions that produce or use a pointer and the globals
+    // and the functions (their addresses)
+    uint64_t pointerNodes = 0;
+    // the deepest nesting of the loops in one function
+    unsigned loopDepth = 0;
+
+    static ModuleStatistics compute(const llvm::Module& M);
+
+    void print(llvm::raw_ostream& os) const;
+};
+
+} // namespace dg
+
+#endif // _LLVM_DG_MODULE_STATISTICS_H_
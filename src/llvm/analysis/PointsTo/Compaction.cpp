@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Value.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "analysis/PointsTo/PointerSubgraph.h"
+#include "PointerSubgraph.h"
+
+namespace dg {
+namespace analysis {
+namespace pta {
+
+// can the node be removed from the CFG? Not if it has too many edges
+// (we would add predecessors * successors edges) or a self-loop
+static bool canBypass(const PSNode *node)
+{
+    const auto& preds = node->getPredecessors();
+    const auto& succs = node->getSuccessors();
+    if (preds.size() > 1 && succs.size() > 1)
+        return false;
+
+    return std::find(succs.begin(), succs.end(), node) == succs.end();
+}
+
+// remove the node from the CFG, its predecessors get its successors
+static void bypassNode(PSNode *node)
+{
+    assert(canBypass(node));
+
+    const auto& preds = node->getPredecessors();
+    const auto& succs = node->getSuccessors();
+    for (PSNode *pred : preds) {
+        for (PSNode *succ : succs) {
+            const auto& pred_succs = pred->getSuccessors();
+            if (std::find(pred_succs.begin(), pred_succs.end(), succ)
+                == pred_succs.end())
+                pred->addSuccessor(succ);
+        }
+    }
+
+    node->isolate();
+}
+
+// the pointer that the GEP @gep computes from the constant pointer @ptr,
+// the same as PointerAnalysis computes it
+static Pointer foldGEP(PSNode *gep, const Pointer& ptr)
+{
+    const Offset& off = gep->getOffset();
+    if (ptr.offset.isUnknown() || off.isUnknown())
+        return Pointer(ptr.target, UNKNOWN_OFFSET);
+
+    uint64_t new_offset = *ptr.offset + *off;
+    if (new_offset == 0 || new_offset < ptr.target->getSize())
+        return Pointer(ptr.target, new_offset);
+
+    return Pointer(ptr.target, UNKNOWN_OFFSET);
+}
+
+// make the users of @node use @with instead and remove @node from the graph
+void LLVMPointerSubgraphBuilder::replaceNode(PSNode *node, PSNode *with,
+                                             std::unordered_map<PSNode *, PSNode *>& replaced)
+{
+    assert(node != with);
+
+    std::vector<PSNode *> users = node->getUsers();
+    std::sort(users.begin(), users.end());
+    users.erase(std::unique(users.begin(), users.end()), users.end());
+
+    for (PSNode *user : users) {
+        for (size_t i = 0; i < user->getOperandsNum(); ++i) {
+            if (user->getOperand(i) == node)
+                user->replaceOperand(i, with);
+        }
+    }
+
+    node->removeOperands();
+    replaced[node] = with;
+}
+
+///
+// Simplify the graph before running the analysis. The nodes that
+// only copy the pointers of another node without touching the memory
+// are removed and their users use the other node directly:
+//
+//  - CAST nodes (the chains of casts are collapsed to the source),
+//  - GEP nodes of constant pointers (folded into a CONSTANT node),
+//  - GEP nodes with the same operand and offset as an earlier GEP,
+//
+// and the NOOP nodes that only join or split the CFG are removed.
+// The LLVM values of the removed nodes are mapped to the nodes that
+// replaced them, so the queries get the same points-to sets.
+// The entry and return nodes of subgraphs and the calls are kept,
+// the graph can still grow on calls via function pointers.
+size_t LLVMPointerSubgraphBuilder::compactGraph(PSNode *root)
+{
+    // the nodes of the CFG (we do not use PointerSubgraph::getNodes(),
+    // that would change the marks of the nodes that it uses later)
+    std::vector<PSNode *> nodes;
+    std::unordered_set<PSNode *> visited;
+    nodes.push_back(root);
+    visited.insert(root);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (PSNode *succ : nodes[i]->getSuccessors()) {
+            if (visited.insert(succ).second)
+                nodes.push_back(succ);
+        }
+    }
+
+    // the nodes that the builder still needs
+    std::unordered_set<PSNode *> keep;
+    keep.insert(root);
+    for (auto& it : subgraphs_map) {
+        keep.insert(it.second.root);
+        keep.insert(it.second.ret);
+        if (it.second.vararg)
+            keep.insert(it.second.vararg);
+    }
+
+    std::unordered_map<PSNode *, PSNode *> replaced;
+    std::unordered_set<PSNode *> removed;
+
+    auto remove = [&](PSNode *node, PSNode *with) {
+        replaceNode(node, with, replaced);
+        bypassNode(node);
+        removed.insert(node);
+    };
+
+    // collapse the casts, the source of the cast chain
+    // is the first operand that is not a cast
+    for (PSNode *node : nodes) {
+        if (node->getType() != PSNodeType::CAST || keep.count(node) > 0
+            || !canBypass(node))
+            continue;
+
+        PSNode *src = node->getOperand(0);
+        if (src == node)
+            continue;
+
+        remove(node, src);
+    }
+
+    // fold and merge the GEPs. When a GEP is replaced,
+    // the GEPs that use it must be checked again
+    std::map<std::pair<PSNode *, uint64_t>, PSNode *> geps;
+    std::vector<PSNode *> worklist;
+    for (PSNode *node : nodes) {
+        if (node->getType() == PSNodeType::GEP && node->getStride() == 0
+            && keep.count(node) == 0 && canBypass(node))
+            worklist.push_back(node);
+    }
+
+    while (!worklist.empty()) {
+        PSNode *node = worklist.back();
+        worklist.pop_back();
+
+        if (replaced.count(node) > 0)
+            continue;
+
+        PSNode *op = node->getOperand(0);
+        PSNode *with = nullptr;
+
+        if (op->getType() == PSNodeType::CONSTANT) {
+            assert(op->pointsTo.size() == 1);
+            Pointer ptr = foldGEP(node, *op->pointsTo.begin());
+
+            with = getConstantNode(ptr.target, ptr.offset);
+        } else {
+            auto key = std::make_pair(op, *node->getOffset());
+            auto it = geps.find(key);
+            if (it == geps.end() || replaced.count(it->second) > 0)
+                geps[key] = node;
+            else if (it->second != node)
+                with = it->second;
+        }
+
+        if (!with)
+            continue;
+
+        // the merged GEP is in a loop if any of them is
+        if (node->isInLoop())
+            with->setInLoop();
+
+        for (PSNode *user : node->getUsers()) {
+            if (user->getType() == PSNodeType::GEP && user->getStride() == 0
+                && keep.count(user) == 0 && visited.count(user) > 0
+                && canBypass(user))
+                worklist.push_back(user);
+        }
+
+        remove(node, with);
+    }
+
+    // remove the NOOP nodes that only join or split the CFG
+    for (PSNode *node : nodes) {
+        if (node->getType() != PSNodeType::NOOP || keep.count(node) > 0
+            || !canBypass(node))
+            continue;
+
+        bypassNode(node);
+        removed.insert(node);
+    }
+
+    // map the values to the nodes that replaced their nodes
+    auto resolve = [&replaced](PSNode *node) {
+        auto it = replaced.find(node);
+        while (it != replaced.end()) {
+            node = it->second;
+            it = replaced.find(node);
+        }
+
+        return node;
+    };
+
+    if (!replaced.empty()) {
+        for (auto& it : nodes_map) {
+            it.second.first = resolve(it.second.first);
+            it.second.second = resolve(it.second.second);
+        }
+    }
+
+    if (!removed.empty())
+        PS->forgetNodes([&removed](PSNode *n) { return removed.count(n) > 0; });
+
+    return removed.size();
+}
+
+} // namespace pta
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,30 @@
+#include <vector>
+
+#include "PointsTo.h"
+
+namespace dg {
+
+using analysis::pta::PSNodeType;
+
+void LLVMPointerAnalysis::degradeToUnknown(const std::vector<PSNode *> *nodes)
+{
+    if (!nodes)
+        nodes = &PS->getAllNodes();
+
+    for (PSNode *n : *nodes) {
+        switch (n->getType()) {
+            // these point to the fixed memory
+            case PSNodeType::ALLOC:
+            case PSNodeType::DYN_ALLOC:
+            case PSNodeType::FUNCTION:
+            case PSNodeType::CONSTANT:
+            case PSNodeType::NULL_ADDR:
+            case PSNodeType::UNKNOWN_MEM:
+                break;
+            default:
+                n->addPointsTo(analysis::pta::UNKNOWN_MEMORY, UNKNOWN_OFFSET);
+        }
+    }
+}
+
+} // namespace dg
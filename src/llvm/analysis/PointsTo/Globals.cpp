@@ -54,24 +54,24 @@ LLVMPointerSubgraphBuilder::handleGlobalVariableInitializer(const llvm::Constant
     // if the global is zero initialized, just set the zeroInitialized flag
     if (C->isNullValue()) {
         node->setZeroInitialized();
+    } else if (!info->containsPointer(C->getType())) {
+        // there are no pointers to store
+        return last;
     } else if (C->getType()->isAggregateType()) {
-        uint64_t off = 0;
-        for (auto I = C->op_begin(), E = C->op_end(); I != E; ++I) {
-            const Constant *op = cast<Constant>(*I);
-            Type *Ty = op->getType();
+        for (unsigned i = 0; i < C->getNumOperands(); ++i) {
+            const Constant *op = cast<Constant>(C->getOperand(i));
             // recursively dive into the aggregate type
-            last = handleGlobalVariableInitializer(op, node, last, offset + off);
-            off += DL->getTypeAllocSize(Ty);
+            last = handleGlobalVariableInitializer(op, node, last,
+                                                   offset + getElementOffset(C->getType(), i));
         }
     } else if (C->getType()->isPointerTy()) {
         PSNode *op = getOperand(C);
-        PSNode *target = new PSNode(PSNodeType::CONSTANT, node, offset);
-        // FIXME: we're leaking the target
+        PSNode *target = getConstantNode(node, offset);
         // NOTE: mabe we could do something like
         // CONSTANT_STORE that would take Pointer instead of node??
         // PSNode(CONSTANT_STORE, op, Pointer(node, off)) or
         // PSNode(COPY, op, Pointer(node, off))??
-        PSNode *store = new PSNode(PSNodeType::STORE, op, target);
+        PSNode *store = newNode(PSNodeType::STORE, op, target);
         store->insertAfter(last);
         last = store;
     } else if (isa<ConstantExpr>(C)
@@ -81,7 +81,7 @@ LLVMPointerSubgraphBuilder::handleGlobalVariableInitializer(const llvm::Constant
            PSNode *value = getOperand(C);
            assert(value->pointsTo.size() == 1 && "BUG: We should have constant");
            // FIXME: we're leaking the target
-           PSNode *store = new PSNode(PSNodeType::STORE, value, node);
+           PSNode *store = newNode(PSNodeType::STORE, value, node);
            store->insertAfter(last);
            last = store;
        }
@@ -94,14 +94,55 @@ LLVMPointerSubgraphBuilder::handleGlobalVariableInitializer(const llvm::Constant
     return last;
 }
 
-static uint64_t getAllocatedSize(const llvm::GlobalVariable *GV,
-                                 const llvm::DataLayout *DL)
+uint64_t LLVMPointerSubgraphBuilder::getElementOffset(llvm::Type *Ty, unsigned idx)
 {
-    llvm::Type *Ty = GV->getType()->getContainedType(0);
-    if (!Ty->isSized())
-            return 0;
+    // the fields of structures can be padded
+    if (llvm::StructType *STy = llvm::dyn_cast<llvm::StructType>(Ty))
+        return DL->getStructLayout(STy)->getElementOffset(idx);
 
-    return DL->getTypeAllocSize(Ty);
+    assert(Ty->isArrayTy() && "Unhandled aggregate type");
+    return idx * DL->getTypeAllocSize(Ty->getArrayElementType());
+}
+
+// Gather the pointers stored in the initializer @C at @offset
+// of the memory @node. All the pointers are known before the analysis
+// (the operands of the constants have their points-to sets from
+// the beginning), so these can be put into the memory objects right
+// away. Return false if the initializer contains something that we
+// need to handle with the stores.
+bool
+LLVMPointerSubgraphBuilder::getInitialPointers(const llvm::Constant *C,
+                                               PSNode *node,
+                                               InitialPointersT& pointers,
+                                               uint64_t offset)
+{
+    using namespace llvm;
+
+    if (C->isNullValue()) {
+        node->setZeroInitialized();
+        return true;
+    }
+
+    if (!info->containsPointer(C->getType()))
+        return true;
+
+    if (C->getType()->isAggregateType()) {
+        for (unsigned i = 0; i < C->getNumOperands(); ++i) {
+            if (!getInitialPointers(cast<Constant>(C->getOperand(i)), node, pointers,
+                                    offset + getElementOffset(C->getType(), i)))
+                return false;
+        }
+
+        return true;
+    }
+
+    if (!C->getType()->isPointerTy())
+        return false;
+
+    for (const Pointer& ptr : getOperand(C)->pointsTo)
+        pointers.emplace_back(offset, ptr);
+
+    return true;
 }
 
 PSNodesSeq LLVMPointerSubgraphBuilder::buildGlobals()
@@ -112,7 +153,7 @@ PSNodesSeq LLVMPointerSubgraphBuilder::buildGlobals()
         prev = cur;
 
         // every global node is like memory allocation
-        cur = new PSNode(PSNodeType::ALLOC);
+        cur = newNode(PSNodeType::ALLOC);
         addNode(&*I, cur);
 
         if (prev)
@@ -131,16 +172,40 @@ PSNodesSeq LLVMPointerSubgraphBuilder::buildGlobals()
         const llvm::GlobalVariable *GV
                             = llvm::dyn_cast<llvm::GlobalVariable>(&*I);
         if (GV) {
-            node->setSize(getAllocatedSize(GV, DL));
+            llvm::Type *Ty = GV->getType()->getContainedType(0);
+            node->setSize(info->getAllocatedSize(Ty));
+            node->setFieldLayout(info->getFieldLayout(Ty));
 
             if (GV->hasInitializer() && !GV->isExternallyInitialized()) {
                 const llvm::Constant *C = GV->getInitializer();
+                cur = node;
+
+                // the memory without pointers needs no stores
+                if (!info->containsPointer(Ty)) {
+                    if (C->isNullValue())
+                        node->setZeroInitialized();
+                    continue;
+                }
+
+                // nothing can write to constant globals, so their
+                // pointers go right into the memory objects instead
+                // of being stored there by the nodes of the graph
+                if (GV->isConstant()) {
+                    InitialPointersT pointers;
+                    if (getInitialPointers(C, node, pointers)) {
+                        if (!pointers.empty())
+                            node->setInitialPointers(
+                                initial_pointers.create(std::move(pointers)));
+                        continue;
+                    }
+                }
+
                 cur = handleGlobalVariableInitializer(C, node);
             }
         } else {
             // without initializer we can not do anything else than
             // assume that it can point everywhere
-            cur = new PSNode(PSNodeType::STORE, UNKNOWN_MEMORY, node);
+            cur = newNode(PSNodeType::STORE, UNKNOWN_MEMORY, node);
             cur->insertAfter(node);
         }
     }
@@ -26,6 +26,8 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Constant.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Support/raw_os_ostream.h>
 
 #if (__clang__)
@@ -35,38 +37,16 @@
 #endif
 
 #include "analysis/PointsTo/PointerSubgraph.h"
+#include "analysis/Profiler.h"
+#include "analysis/SCC.h"
+#include "llvm/llvm-utils.h"
+#include "llvm/analysis/FunctionCosts.h"
 #include "PointerSubgraph.h"
 
 namespace dg {
 namespace analysis {
 namespace pta {
 
-enum MemAllocationFuncs {
-    NONEMEM = 0,
-    MALLOC,
-    CALLOC,
-    ALLOCA,
-    REALLOC,
-};
-
-static int getMemAllocationFunc(const llvm::Function *func)
-{
-    if (!func || !func->hasName())
-        return NONEMEM;
-
-    const char *name = func->getName().data();
-    if (strcmp(name, "malloc") == 0)
-        return MALLOC;
-    else if (strcmp(name, "calloc") == 0)
-        return CALLOC;
-    else if (strcmp(name, "alloca") == 0)
-        return ALLOCA;
-    else if (strcmp(name, "realloc") == 0)
-        return REALLOC;
-
-    return NONEMEM;
-}
-
 static inline unsigned getPointerBitwidth(const llvm::DataLayout *DL,
                                           const llvm::Value *ptr)
 
@@ -75,74 +55,15 @@ static inline unsigned getPointerBitwidth(const llvm::DataLayout *DL,
     return DL->getPointerSizeInBits(Ty->getPointerAddressSpace());
 }
 
-static uint64_t getConstantValue(const llvm::Value *op)
-{
-    using namespace llvm;
-
-    uint64_t size = 0;
-    if (const ConstantInt *C = dyn_cast<ConstantInt>(op)) {
-        size = C->getLimitedValue();
-        // if the size cannot be expressed as an uint64_t,
-        // just set it to 0 (that means unknown)
-        if (size == ~((uint64_t) 0))
-            size = 0;
-    }
-
-    return size;
-}
-
-static uint64_t getAllocatedSize(const llvm::AllocaInst *AI,
-                                 const llvm::DataLayout *DL)
-{
-    llvm::Type *Ty = AI->getAllocatedType();
-    if (!Ty->isSized())
-            return 0;
-
-    if (AI->isArrayAllocation())
-        return getConstantValue(AI->getArraySize()) * DL->getTypeAllocSize(Ty);
-    else
-        return DL->getTypeAllocSize(Ty);
-}
-
 bool LLVMPointerSubgraphBuilder::typeCanBePointer(llvm::Type *Ty) const
 {
-    if (Ty->isPointerTy())
-        return true;
-
-    if (Ty->isIntegerTy() && Ty->isSized())
-        return DL->getTypeSizeInBits(Ty)
-                >= DL->getPointerSizeInBits(/*Ty->getPointerAddressSpace()*/);
-
-    return false;
+    return info->canBePointer(Ty);
 }
 
 
 LLVMPointerSubgraphBuilder::~LLVMPointerSubgraphBuilder()
 {
-    // delete the created nodes
-    for (auto& it : nodes_map) {
-        PSNode *node = it.second.first;
-        while (node) {
-            PSNode *cur = node;
-
-            if (cur == it.second.second)
-                node = nullptr;
-            else
-                node = node->getSingleSuccessor();
-
-            delete cur;
-        }
-    }
-
-    // delete allocated memory in subgraph structures
-    for (auto& it : subgraphs_map) {
-        delete it.second.root;
-        delete it.second.ret;
-    }
-
-    for (PSNode *dummy : dummy_nodes)
-        delete dummy;
-
+    // the nodes are freed by the PointerSubgraph
     delete DL;
 }
 
@@ -203,7 +124,7 @@ Pointer LLVMPointerSubgraphBuilder::handleConstantAdd(const llvm::Instruction *I
 
     assert(op && "Don't have operand for add");
     if (val)
-        off = getConstantValue(val);
+        off = LLVMModuleInfo::getConstantValue(val);
 
     assert(op->pointsTo.size() == 1
            && "Constant add with not only one pointer");
@@ -341,12 +262,30 @@ Pointer LLVMPointerSubgraphBuilder::getConstantExprPointer(const llvm::ConstantE
     return pointer;
 }
 
+// the CONSTANT node that points to @target + @off. There is only one node
+// for every pointer, so the constant expressions that are used at many
+// places (or that differ only in the casts) do not multiply the nodes.
+// The nodes are not in the CFG and they never change
+PSNode *LLVMPointerSubgraphBuilder::getConstantNode(PSNode *target,
+                                                    const Offset& off)
+{
+    PSNode *& node = constant_nodes[std::make_pair(target, *off)];
+    if (!node)
+        node = newNode(PSNodeType::CONSTANT, target, off);
+
+    return node;
+}
+
 PSNode *LLVMPointerSubgraphBuilder::createConstantExpr(const llvm::ConstantExpr *CE)
 {
     Pointer ptr = getConstantExprPointer(CE);
-    PSNode *node = new PSNode(PSNodeType::CONSTANT, ptr.target, ptr.offset);
+    PSNode *node = getConstantNode(ptr.target, ptr.offset);
 
-    addNode(CE, node);
+    // the shared node keeps the value of the first expression
+    if (node->getUserData<llvm::Value>())
+        nodes_map.emplace(CE, std::make_pair(node, node));
+    else
+        addNode(CE, node);
 
     assert(node);
     return node;
@@ -373,7 +312,7 @@ PSNode *LLVMPointerSubgraphBuilder::getConstant(const llvm::Value *val)
                     = llvm::dyn_cast<llvm::ConstantExpr>(val)) {
         return createConstantExpr(CE);
     } else if (llvm::isa<llvm::Function>(val)) {
-        PSNode *ret = new PSNode(PSNodeType::FUNCTION);
+        PSNode *ret = newNode(PSNodeType::FUNCTION);
         addNode(val, ret);
         return ret;
     } else if (llvm::isa<llvm::Constant>(val)) {
@@ -503,13 +442,14 @@ PSNode *LLVMPointerSubgraphBuilder::getOperand(const llvm::Value *val)
         return op;
 }
 
-static PSNode *createDynamicAlloc(const llvm::CallInst *CInst, int type)
+PSNode *LLVMPointerSubgraphBuilder::createDynamicAlloc(const llvm::CallInst *CInst,
+                                                       int type)
 {
     using namespace llvm;
 
     const Value *op;
     uint64_t size = 0, size2 = 0;
-    PSNode *node = new PSNode(PSNodeType::DYN_ALLOC);
+    PSNode *node = newNode(PSNodeType::DYN_ALLOC);
 
     switch (type) {
         case MALLOC:
@@ -530,11 +470,11 @@ static PSNode *createDynamicAlloc(const llvm::CallInst *CInst, int type)
     };
 
     // infer allocated size
-    size = getConstantValue(op);
+    size = LLVMModuleInfo::getConstantValue(op);
     if (size != 0 && type == CALLOC) {
         // if this is call to calloc, the size is given
         // in the first argument too
-        size2 = getConstantValue(CInst->getOperand(0));
+        size2 = LLVMModuleInfo::getConstantValue(CInst->getOperand(0));
         if (size2 != 0)
             size *= size2;
     }
@@ -550,14 +490,14 @@ LLVMPointerSubgraphBuilder::createRealloc(const llvm::CallInst *CInst)
 
     // we create new allocation node and memcpy old pointers there
     PSNode *orig_mem = getOperand(CInst->getOperand(0)->stripInBoundsOffsets());
-    PSNode *reall = new PSNode(PSNodeType::DYN_ALLOC);
+    PSNode *reall = newNode(PSNodeType::DYN_ALLOC);
     // copy everything that is in orig_mem to reall
-    PSNode *mcp = new PSNode(PSNodeType::MEMCPY, orig_mem, reall, 0, UNKNOWN_OFFSET);
+    PSNode *mcp = newNode(PSNodeType::MEMCPY, orig_mem, reall, 0, UNKNOWN_OFFSET);
     // we need the pointer in the last node that we return
-    PSNode *ptr = new PSNode(PSNodeType::CONSTANT, reall, 0);
+    PSNode *ptr = newNode(PSNodeType::CONSTANT, reall, 0);
 
     reall->setIsHeap();
-    reall->setSize(getConstantValue(CInst->getOperand(1)));
+    reall->setSize(LLVMModuleInfo::getConstantValue(CInst->getOperand(1)));
     if (orig_mem->isZeroInitialized())
         reall->setZeroInitialized();
 
@@ -597,12 +537,8 @@ LLVMPointerSubgraphBuilder::createCallToFunction(const llvm::Function *F)
 
     // the operands to the return node (which works as a phi node)
     // are going to be added when the subgraph is built
-    callNode = new PSNode(PSNodeType::CALL, nullptr);
-    returnNode = new PSNode(PSNodeType::CALL_RETURN, nullptr);
-
-    // save the returnNode to dummy_nodes, to delete the
-    // memory at destruction.  The call nodes will be stored to nodes_map.
-    dummy_nodes.push_back(returnNode);
+    callNode = newNode(PSNodeType::CALL, nullptr);
+    returnNode = newNode(PSNodeType::CALL_RETURN, nullptr);
 
     returnNode->setPairedNode(callNode);
     callNode->setPairedNode(returnNode);
@@ -644,9 +580,54 @@ LLVMPointerSubgraphBuilder::createFuncptrCall(const llvm::CallInst *CInst,
     // will also add the program structure instead of only
     // building the nodes
     ad_hoc_building = true;
+    funcptr_calls.emplace_back(CInst, F);
     return createOrGetSubgraph(CInst, F);
 }
 
+bool LLVMPointerSubgraphBuilder::functionPointerCall(PSNode *callsite, PSNode *called)
+{
+    // with vararg it may happen that we get pointer that
+    // is not to function, so just bail out here in that case
+    if (!llvm::isa<llvm::Function>(called->getUserData<llvm::Value>()))
+        return false;
+
+    const llvm::Function *F = called->getUserData<llvm::Function>();
+    const llvm::CallInst *CI = callsite->getUserData<llvm::CallInst>();
+
+    // incompatible prototypes, skip it...
+    if (!llvmutils::callIsCompatible(F, CI, call_compatibility))
+        return false;
+
+    if (!info->isDefined(F)) {
+        // calling declaration that returns a pointer?
+        // That is unknown pointer
+        return callsite->getPairedNode()->addPointsTo(PointerUnknown);
+    }
+
+    // create new instructions
+    PSNodesSeq cf = createFuncptrCall(CI, F);
+    assert(cf.first && cf.second);
+
+    // we got the return site for the call stored as the paired node
+    PSNode *ret = callsite->getPairedNode();
+    // ret is a PHI node, so pass the values returned from the
+    // procedure call
+    ret->addOperand(cf.second);
+
+    // replace the edge from call->ret that we
+    // have due to connectivity of the graph until we
+    // insert the subgraph
+    if (callsite->successorsNum() == 1 &&
+        callsite->getSingleSuccessor() == ret) {
+        callsite->replaceSingleSuccessor(cf.first);
+    } else
+        callsite->addSuccessor(cf.first);
+
+    cf.second->addSuccessor(ret);
+
+    return true;
+}
+
 PSNodesSeq
 LLVMPointerSubgraphBuilder::createOrGetSubgraph(const llvm::CallInst *CInst,
                                                 const llvm::Function *F)
@@ -676,7 +657,7 @@ LLVMPointerSubgraphBuilder::createUnknownCall(const llvm::CallInst *CInst)
     // inside bitcast - it defaults to int, but is bitcased
     // to pointer
     //assert(CInst->getType()->isPointerTy());
-    PSNode *call = new PSNode(PSNodeType::CALL, nullptr);
+    PSNode *call = newNode(PSNodeType::CALL, nullptr);
 
     call->setPairedNode(call);
 
@@ -688,6 +669,30 @@ LLVMPointerSubgraphBuilder::createUnknownCall(const llvm::CallInst *CInst)
     return std::make_pair(call, call);
 }
 
+// the pointer returned by an undefined function with a summary
+PSNodesSeq
+LLVMPointerSubgraphBuilder::createSummarizedCall(const llvm::CallInst *CInst,
+                                                 const FunctionSummary& summary)
+{
+    PSNode *node;
+
+    if (summary.ret == FunctionSummary::Return::ALLOCATION) {
+        node = newNode(PSNodeType::DYN_ALLOC);
+        node->setIsHeap();
+    } else if (summary.ret == FunctionSummary::Return::ARGUMENT
+               && summary.ret_arg < CInst->getNumArgOperands()
+               && CInst->getArgOperand(summary.ret_arg)->getType()->isPointerTy()) {
+        // the pointer points somewhere into the memory of the argument
+        PSNode *op = getOperand(CInst->getArgOperand(summary.ret_arg));
+        node = newNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
+        node->setPairedNode(node);
+    } else
+        return createUnknownCall(CInst);
+
+    addNode(CInst, node);
+    return std::make_pair(node, node);
+}
+
 PSNode *LLVMPointerSubgraphBuilder::createMemTransfer(const llvm::IntrinsicInst *I)
 {
     using namespace llvm;
@@ -708,7 +713,7 @@ PSNode *LLVMPointerSubgraphBuilder::createMemTransfer(const llvm::IntrinsicInst
     PSNode *destNode = getOperand(dest);
     PSNode *srcNode = getOperand(src);
     /* FIXME: compute correct value instead of UNKNOWN_OFFSET */
-    PSNode *node = new PSNode(PSNodeType::MEMCPY,
+    PSNode *node = newNode(PSNodeType::MEMCPY,
                               srcNode, destNode,
                               UNKNOWN_OFFSET, UNKNOWN_OFFSET);
 
@@ -734,7 +739,7 @@ LLVMPointerSubgraphBuilder::createVarArg(const llvm::IntrinsicInst *Inst)
     // vastart will be node that will keep the memory
     // with pointers, its argument is the alloca, that
     // alloca will keep pointer to vastart
-    PSNode *vastart = new PSNode(PSNodeType::ALLOC);
+    PSNode *vastart = newNode(PSNodeType::ALLOC);
 
     // vastart has only one operand which is the struct
     // it uses for storing the va arguments. Strip it so that we'll
@@ -747,10 +752,10 @@ LLVMPointerSubgraphBuilder::createVarArg(const llvm::IntrinsicInst *Inst)
     // get node with the same pointer, but with UNKNOWN_OFFSET
     // FIXME: we're leaking it
     // make the memory in alloca point to our memory in vastart
-    PSNode *ptr = new PSNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
-    PSNode *S1 = new PSNode(PSNodeType::STORE, vastart, ptr);
+    PSNode *ptr = newNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
+    PSNode *S1 = newNode(PSNodeType::STORE, vastart, ptr);
     // and also make vastart point to the vararg args
-    PSNode *S2 = new PSNode(PSNodeType::STORE, arg, vastart);
+    PSNode *S2 = newNode(PSNodeType::STORE, arg, vastart);
 
     vastart->addSuccessor(ptr);
     ptr->addSuccessor(S1);
@@ -816,7 +821,7 @@ LLVMPointerSubgraphBuilder::createAsm(const llvm::Instruction *Inst)
         warned = true;
     }
 
-    PSNode *n = new PSNode(PSNodeType::CONSTANT, UNKNOWN_MEMORY, UNKNOWN_OFFSET);
+    PSNode *n = newNode(PSNodeType::CONSTANT, UNKNOWN_MEMORY, UNKNOWN_OFFSET);
     // it is call that returns pointer, so we'd like to have
     // a 'return' node that contains that pointer
     n->setPairedNode(n);
@@ -849,24 +854,29 @@ LLVMPointerSubgraphBuilder::createCall(const llvm::Instruction *Inst)
         // is undefined and after that if it is memory allocation,
         // because some programs may define function named
         // 'malloc' etc.
-        if (func->size() == 0) {
+        if (!info->isDefined(func)) {
             /// memory allocation (malloc, calloc, etc.)
-            if (int type = getMemAllocationFunc(func)) {
+            if (int type = info->getMemAllocationFunc(func)) {
                 return createDynamicMemAlloc(CInst, type);
             } else if (func->isIntrinsic()) {
                 return createIntrinsic(Inst);
+            } else if (const FunctionSummary *S = info->getSummary(func)) {
+                return createSummarizedCall(CInst, *S);
             } else
                 return createUnknownCall(CInst);
+        } else if (isPointerTransparent(func)) {
+            // we got here only because some relevant instruction
+            // uses the returned value, the function cannot
+            // compute a pointer, so it returns an unknown one
+            return createUnknownCall(CInst);
         } else {
             return createOrGetSubgraph(CInst, func);
         }
     } else {
         // function pointer call
         PSNode *op = getOperand(calledVal);
-        PSNode *call_funcptr = new PSNode(PSNodeType::CALL_FUNCPTR, op);
-        PSNode *ret_call = new PSNode(PSNodeType::RETURN, nullptr);
-
-        dummy_nodes.push_back(ret_call);
+        PSNode *call_funcptr = newNode(PSNodeType::CALL_FUNCPTR, op);
+        PSNode *ret_call = newNode(PSNodeType::RETURN, nullptr);
 
         ret_call->setPairedNode(call_funcptr);
         call_funcptr->setPairedNode(ret_call);
@@ -880,12 +890,16 @@ LLVMPointerSubgraphBuilder::createCall(const llvm::Instruction *Inst)
 
 PSNode *LLVMPointerSubgraphBuilder::createAlloc(const llvm::Instruction *Inst)
 {
-    PSNode *node = new PSNode(PSNodeType::ALLOC);
+    PSNode *node = newNode(PSNodeType::ALLOC);
     addNode(Inst, node);
 
     const llvm::AllocaInst *AI = llvm::dyn_cast<llvm::AllocaInst>(Inst);
-    if (AI)
-        node->setSize(getAllocatedSize(AI, DL));
+    if (AI) {
+        node->setSize(info->getAllocatedSize(AI));
+        // the heap objects have no type, their pointers
+        // are kept in a flat map in the memory object
+        node->setFieldLayout(info->getFieldLayout(AI->getAllocatedType()));
+    }
 
     return node;
 }
@@ -897,7 +911,7 @@ PSNode *LLVMPointerSubgraphBuilder::createStore(const llvm::Instruction *Inst)
     PSNode *op1 = getOperand(valOp);
     PSNode *op2 = getOperand(Inst->getOperand(1));
 
-    PSNode *node = new PSNode(PSNodeType::STORE, op1, op2);
+    PSNode *node = newNode(PSNodeType::STORE, op1, op2);
     addNode(Inst, node);
 
     assert(node);
@@ -909,7 +923,7 @@ PSNode *LLVMPointerSubgraphBuilder::createLoad(const llvm::Instruction *Inst)
     const llvm::Value *op = Inst->getOperand(0);
 
     PSNode *op1 = getOperand(op);
-    PSNode *node = new PSNode(PSNodeType::LOAD, op1);
+    PSNode *node = newNode(PSNodeType::LOAD, op1);
 
     addNode(Inst, node);
 
@@ -917,6 +931,66 @@ PSNode *LLVMPointerSubgraphBuilder::createLoad(const llvm::Instruction *Inst)
     return node;
 }
 
+// Split the offset of the GEP with one variable index (an index into
+// an array or the pointer) into the constant part and the stride
+// (the size of the indexed element). Returns false if the GEP has
+// more variable indices or the offset cannot be computed.
+// The constant part is normalized to be less than the stride.
+static bool getStridedOffset(const llvm::DataLayout *DL,
+                             const llvm::GetElementPtrInst *GEP,
+                             uint64_t& offset, uint64_t& stride)
+{
+    using namespace llvm;
+
+    Type *Ty = GEP->getPointerOperand()->getType();
+    if (!Ty->isPointerTy())
+        return false;
+
+    int64_t constant = 0;
+    stride = 0;
+    Ty = Ty->getContainedType(0);
+    bool first = true;
+
+    for (auto I = GEP->idx_begin(), E = GEP->idx_end(); I != E; ++I) {
+        const ConstantInt *C = dyn_cast<ConstantInt>(*I);
+        uint64_t size;
+
+        if (first) {
+            // the first index moves the pointer over the pointee type
+            size = DL->getTypeAllocSize(Ty);
+            first = false;
+        } else if (StructType *ST = dyn_cast<StructType>(Ty)) {
+            if (!C)
+                return false;
+
+            unsigned idx = C->getZExtValue();
+            constant += DL->getStructLayout(ST)->getElementOffset(idx);
+            Ty = ST->getElementType(idx);
+            continue;
+        } else if (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+            Ty = AT->getElementType();
+            size = DL->getTypeAllocSize(Ty);
+        } else
+            return false;
+
+        if (C) {
+            constant += C->getSExtValue() * static_cast<int64_t>(size);
+        } else {
+            // the second variable index or an index over zero-sized type
+            if (stride > 0 || size == 0)
+                return false;
+            stride = size;
+        }
+    }
+
+    if (stride == 0)
+        return false;
+
+    int64_t rem = constant % static_cast<int64_t>(stride);
+    offset = rem < 0 ? rem + stride : rem;
+    return true;
+}
+
 PSNode *LLVMPointerSubgraphBuilder::createGEP(const llvm::Instruction *Inst)
 {
     using namespace llvm;
@@ -936,17 +1010,28 @@ PSNode *LLVMPointerSubgraphBuilder::createGEP(const llvm::Instruction *Inst)
             // is 0 < offset < field_sensitivity ?
             uint64_t off = offset.getLimitedValue(field_sensitivity);
             if (off == 0 || off < field_sensitivity)
-                node = new PSNode(PSNodeType::GEP, op, offset.getZExtValue());
+                node = newNode(PSNodeType::GEP, op, offset.getZExtValue());
         } else
             errs() << "WARN: GEP offset greater than " << bitwidth << "-bit";
             // fall-through to UNKNOWN_OFFSET in this case
+    } else if (field_sensitivity > 0) {
+        // indexing an array with a variable, the pointer can be moved
+        // by any multiple of the size of the elements
+        uint64_t off, stride;
+        if (getStridedOffset(DL, GEP, off, stride) && off < field_sensitivity) {
+            node = newNode(PSNodeType::GEP, op, off);
+            node->setStride(stride);
+        }
     }
 
     // we didn't create the node with concrete offset,
     // in which case we are supposed to create a node
     // with UNKNOWN_OFFSET
     if (!node)
-        node = new PSNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
+        node = newNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
+
+    if (loop_widening)
+        node->setInLoop(isInLoop(Inst->getParent()));
 
     addNode(Inst, node);
 
@@ -954,6 +1039,34 @@ PSNode *LLVMPointerSubgraphBuilder::createGEP(const llvm::Instruction *Inst)
     return node;
 }
 
+bool LLVMPointerSubgraphBuilder::isInLoop(const llvm::BasicBlock *B)
+{
+    using namespace llvm;
+
+    const Function *F = B->getParent();
+    auto it = loop_blocks.find(F);
+    if (it == loop_blocks.end()) {
+        it = loop_blocks.emplace(F, std::set<const BasicBlock *>()).first;
+
+        Function& Fn = const_cast<Function&>(*F);
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 7))
+        DominatorTreeBase<BasicBlock> DT(false);
+        DT.recalculate(Fn);
+        LoopInfoBase<BasicBlock, Loop> LI;
+        LI.Analyze(DT);
+#else
+        DominatorTree DT(Fn);
+        LoopInfo LI(DT);
+#endif
+        for (const BasicBlock& block : *F) {
+            if (LI.getLoopFor(&block))
+                it->second.insert(&block);
+        }
+    }
+
+    return it->second.count(B) > 0;
+}
+
 PSNode *LLVMPointerSubgraphBuilder::createSelect(const llvm::Instruction *Inst)
 {
     // with ptrtoint/inttoptr it may not be a pointer
@@ -964,7 +1077,7 @@ PSNode *LLVMPointerSubgraphBuilder::createSelect(const llvm::Instruction *Inst)
     PSNode *op2 = getOperand(Inst->getOperand(2));
 
     // select works as a PHI in points-to analysis
-    PSNode *node = new PSNode(PSNodeType::PHI, op1, op2, nullptr);
+    PSNode *node = newNode(PSNodeType::PHI, op1, op2, nullptr);
     addNode(Inst, node);
 
     assert(node);
@@ -981,8 +1094,8 @@ LLVMPointerSubgraphBuilder::createExtract(const llvm::Instruction *Inst)
     // extract <agg> <idx> {<idx>, ...}
     PSNode *op1 = getOperand(EI->getAggregateOperand());
     // FIXME: get the correct offset
-    PSNode *G = new PSNode(PSNodeType::GEP, op1, UNKNOWN_OFFSET);
-    PSNode *L = new PSNode(PSNodeType::LOAD, G);
+    PSNode *G = newNode(PSNodeType::GEP, op1, UNKNOWN_OFFSET);
+    PSNode *L = newNode(PSNodeType::LOAD, G);
 
     G->addSuccessor(L);
 
@@ -994,7 +1107,7 @@ LLVMPointerSubgraphBuilder::createExtract(const llvm::Instruction *Inst)
 
 PSNode *LLVMPointerSubgraphBuilder::createPHI(const llvm::Instruction *Inst)
 {
-    PSNode *node = new PSNode(PSNodeType::PHI, nullptr);
+    PSNode *node = newNode(PSNodeType::PHI, nullptr);
     addNode(Inst, node);
 
     // NOTE: we didn't add operands to PHI node here, but after building
@@ -1031,7 +1144,7 @@ PSNode *LLVMPointerSubgraphBuilder::createCast(const llvm::Instruction *Inst)
 {
     const llvm::Value *op = Inst->getOperand(0);
     PSNode *op1 = getOperand(op);
-    PSNode *node = new PSNode(PSNodeType::CAST, op1);
+    PSNode *node = newNode(PSNodeType::CAST, op1);
 
     addNode(Inst, node);
 
@@ -1048,7 +1161,7 @@ PSNode *LLVMPointerSubgraphBuilder::createUnknown(const llvm::Value *val)
     // completely change the value of pointer...
 
     // FIXME: or there's enough unknown offset? Check it out!
-    PSNode *node = new PSNode(PSNodeType::CONSTANT, UNKNOWN_MEMORY, UNKNOWN_OFFSET);
+    PSNode *node = newNode(PSNodeType::CONSTANT, UNKNOWN_MEMORY, UNKNOWN_OFFSET);
 
     addNode(val, node);
 
@@ -1066,8 +1179,8 @@ PSNode *LLVMPointerSubgraphBuilder::createPtrToInt(const llvm::Instruction *Inst
     // just casting the value do gep with unknown offset -
     // this way we cover any shift of the pointer due to arithmetic
     // operations
-    // PSNode *node = new PSNode(PSNodeType::CAST, op1);
-    PSNode *node = new PSNode(PSNodeType::GEP, op1, 0);
+    // PSNode *node = newNode(PSNodeType::CAST, op1);
+    PSNode *node = newNode(PSNodeType::GEP, op1, 0);
     addNode(Inst, node);
 
     // here we lost the type information,
@@ -1094,7 +1207,7 @@ PSNode *LLVMPointerSubgraphBuilder::createIntToPtr(const llvm::Instruction *Inst
     } else
         op1 = getOperand(op);
 
-    PSNode *node = new PSNode(PSNodeType::CAST, op1);
+    PSNode *node = newNode(PSNodeType::CAST, op1);
     addNode(Inst, node);
 
     // here we lost the type information,
@@ -1137,9 +1250,9 @@ PSNode *LLVMPointerSubgraphBuilder::createAdd(const llvm::Instruction *Inst)
 
     assert(op && "Don't have operand for add");
     if (val)
-        off = getConstantValue(val);
+        off = LLVMModuleInfo::getConstantValue(val);
 
-    node = new PSNode(PSNodeType::GEP, op, off);
+    node = newNode(PSNodeType::GEP, op, off);
     addNode(Inst, node);
 
     assert(node);
@@ -1174,7 +1287,7 @@ PSNode *LLVMPointerSubgraphBuilder::createArithmetic(const llvm::Instruction *In
 
     // we don't know what the operation does,
     // so set unknown offset
-    node = new PSNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
+    node = newNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
     addNode(Inst, node);
 
     assert(node);
@@ -1207,7 +1320,7 @@ PSNode *LLVMPointerSubgraphBuilder::createReturn(const llvm::Instruction *Inst)
     assert((op1 || !retVal || !retVal->getType()->isPointerTy())
            && "Don't have operand for ReturnInst with pointer");
 
-    PSNode *node = new PSNode(PSNodeType::RETURN, op1, nullptr);
+    PSNode *node = newNode(PSNodeType::RETURN, op1, nullptr);
     addNode(Inst, node);
 
     return node;
@@ -1286,7 +1399,7 @@ void LLVMPointerSubgraphBuilder::transitivelyBuildUses(const llvm::Value *val)
     }
 }
 
-static bool isRelevantCall(const llvm::Instruction *Inst)
+static bool isRelevantCall(const llvm::Instruction *Inst, LLVMModuleInfo& info)
 {
     using namespace llvm;
 
@@ -1302,8 +1415,8 @@ static bool isRelevantCall(const llvm::Instruction *Inst)
         // function pointer call - we need that in PointerSubgraph
         return true;
 
-    if (func->size() == 0) {
-        if (getMemAllocationFunc(func))
+    if (!info.isDefined(func)) {
+        if (info.getMemAllocationFunc(func))
             // we need memory allocations
             return true;
 
@@ -1468,9 +1581,16 @@ bool LLVMPointerSubgraphBuilder::isRelevantInstruction(const llvm::Instruction&
             else
                 return false;
         case Instruction::Call:
-            if (isRelevantCall(&Inst))
+            if (isRelevantCall(&Inst, *info)) {
+                // the subgraph of the function would be empty
+                const Function *func = dyn_cast<Function>(
+                    cast<CallInst>(Inst).getCalledValue()->stripPointerCasts());
+                if (func && info->isDefined(func)
+                    && isPointerTransparent(func))
+                    return false;
+
                 return true;
-            else
+            } else
                 return false;
         case Instruction::Alloca:
         case Instruction::GetElementPtr:
@@ -1493,12 +1613,83 @@ bool LLVMPointerSubgraphBuilder::isRelevantInstruction(const llvm::Instruction&
     assert(0 && "Not to be reached");
 }
 
+// Does the function work with pointers? If it does not create, load, store
+// or return pointers and it calls only functions that do not work with
+// pointers either, the points-to analysis has nothing to do in it
+// (e.g. arithmetic kernels), so we do not build its subgraph at all.
+bool LLVMPointerSubgraphBuilder::isPointerTransparent(const llvm::Function *F)
+{
+    auto it = transparent_funcs.find(F);
+    if (it != transparent_funcs.end())
+        return it->second;
+
+    // recursive calls are taken as not transparent
+    // (we do not know the result yet)
+    transparent_funcs[F] = false;
+    bool ret = computePointerTransparent(F);
+    transparent_funcs[F] = ret;
+
+    return ret;
+}
+
+bool LLVMPointerSubgraphBuilder::computePointerTransparent(const llvm::Function *F)
+{
+    using namespace llvm;
+
+    if (F->isVarArg() || F->getName().equals("main"))
+        return false;
+
+    Type *retTy = F->getReturnType();
+    if (info->canBePointer(retTy) || info->containsPointer(retTy))
+        return false;
+
+    for (const BasicBlock& block : *F) {
+        for (const Instruction& Inst : block) {
+            if (info->containsPointer(Inst.getType()))
+                return false;
+
+            switch (Inst.getOpcode()) {
+                case Instruction::Alloca:
+                case Instruction::Load:
+                case Instruction::Store:
+                case Instruction::GetElementPtr:
+                case Instruction::PtrToInt:
+                case Instruction::IntToPtr:
+                case Instruction::AtomicRMW:
+                case Instruction::AtomicCmpXchg:
+                case Instruction::VAArg:
+                case Instruction::Invoke:
+                    return false;
+                case Instruction::Call:
+                    break;
+                default:
+                    continue;
+            }
+
+            const CallInst *CInst = cast<CallInst>(&Inst);
+            // memset is not relevant, but it zeroes memory
+            if (CInst->isInlineAsm() || isa<MemSetInst>(CInst))
+                return false;
+
+            if (!isRelevantCall(CInst, *info))
+                continue;
+
+            const Function *func
+                = dyn_cast<Function>(CInst->getCalledValue()->stripPointerCasts());
+            if (!func || !info->isDefined(func) || !isPointerTransparent(func))
+                return false;
+        }
+    }
+
+    return true;
+}
+
 // create a formal argument
 PSNode *LLVMPointerSubgraphBuilder::createArgument(const llvm::Argument *farg)
 {
     using namespace llvm;
 
-    PSNode *arg = new PSNode(PSNodeType::PHI, nullptr);
+    PSNode *arg = newNode(PSNodeType::PHI, nullptr);
     addNode(farg, arg);
 
     return arg;
@@ -1509,22 +1700,6 @@ static bool memsetIsZeroInitialization(const llvm::IntrinsicInst *I)
     return isConstantZero(I->getOperand(1));
 }
 
-// recursively find out if type contains a pointer type as a subtype
-// (or if it is a pointer type itself)
-static bool tyContainsPointer(const llvm::Type *Ty)
-{
-    if (Ty->isAggregateType()) {
-        for (auto I = Ty->subtype_begin(), E = Ty->subtype_end();
-             I != E; ++I) {
-            if (tyContainsPointer(*I))
-                return true;
-        }
-    } else
-        return Ty->isPointerTy();
-
-    return false;
-}
-
 PSNodesSeq
 LLVMPointerSubgraphBuilder::createMemSet(const llvm::Instruction *Inst)
 {
@@ -1538,8 +1713,8 @@ LLVMPointerSubgraphBuilder::createMemSet(const llvm::Instruction *Inst)
 
     PSNode *op = getOperand(Inst->getOperand(0)->stripInBoundsOffsets());
     // we need to make unknown offsets
-    PSNode *G = new PSNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
-    PSNode *S = new PSNode(PSNodeType::STORE, val, G);
+    PSNode *G = newNode(PSNodeType::GEP, op, UNKNOWN_OFFSET);
+    PSNode *S = newNode(PSNodeType::STORE, val, G);
     G->addSuccessor(S);
 
     PSNodesSeq ret = PSNodesSeq(G, S);
@@ -1569,7 +1744,7 @@ void LLVMPointerSubgraphBuilder::checkMemSet(const llvm::Instruction *Inst)
         // char mem[100];
         // void *ptr = (void *) mem;
         // void *p = *ptr;
-        if (tyContainsPointer(AI->getAllocatedType()))
+        if (info->containsPointer(AI->getAllocatedType()))
             op->setZeroInitialized();
     } else {
         // fallback: create a store that represents memset
@@ -1612,14 +1787,14 @@ PSNode *LLVMPointerSubgraphBuilder::buildFunction(const llvm::Function& F)
     // just for our convenience when building the graph, they can be
     // optimized away later since they are noops
     // XXX: do we need entry type?
-    PSNode *root = new PSNode(PSNodeType::ENTRY);
-    PSNode *ret = new PSNode(PSNodeType::NOOP);
+    PSNode *root = newNode(PSNodeType::ENTRY);
+    PSNode *ret = newNode(PSNodeType::NOOP);
 
     // if the function has variable arguments,
     // then create the node for it
     PSNode *vararg = nullptr;
     if (F.isVarArg())
-        vararg = new PSNode(PSNodeType::PHI, nullptr);
+        vararg = newNode(PSNodeType::PHI, nullptr);
 
     // add record to built graphs here, so that subsequent call of this function
     // from buildPointerSubgraphBlock won't get stuck in infinite recursive call when
@@ -1640,15 +1815,197 @@ PSNode *LLVMPointerSubgraphBuilder::buildFunction(const llvm::Function& F)
 void LLVMPointerSubgraphBuilder::addProgramStructure()
 {
     // form intraprocedural program structure (CFG edges)
+    for (auto& it : subgraphs_map)
+        addProgramStructure(it.first, it.second);
+
+    // we need the return nodes, so the structure must be there.
+    // The summaries must be known before adding the operands
+    // of the return nodes
+    if (call_summaries || heap_cloning > 0)
+        computeSummaries();
+
+    // add the missing operands (to arguments and return nodes)
+    for (auto& it : subgraphs_map)
+        addInterproceduralOperands(it.first, it.second);
+}
+
+// compute the summaries bottom-up in the call graph and instantiate
+// them right away, so that the summaries of the callers can go
+// through the calls (e.g. the wrappers of allocation wrappers)
+void LLVMPointerSubgraphBuilder::computeSummaries()
+{
+    using namespace llvm;
+
+    std::vector<const Function *> funcs;
+    std::unordered_map<const Function *, unsigned> ids;
     for (auto& it : subgraphs_map) {
-        const llvm::Function *F = it.first;
-        Subgraph& subg = it.second;
+        ids.emplace(it.first, funcs.size());
+        funcs.push_back(it.first);
+    }
 
-        // add the CFG edges
-        addProgramStructure(F, subg);
+    // the edges go from the callers to the callees
+    std::vector<std::vector<unsigned>> callees(funcs.size());
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+        const Function *F = funcs[i];
+        for (auto I = F->use_begin(), E = F->use_end(); I != E; ++I) {
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+            const Value *use = *I;
+#else
+            const Value *use = I->getUser();
+#endif
+            const CallInst *CI = dyn_cast<CallInst>(use);
+            if (!CI || CI->getCalledFunction() != F)
+                continue;
 
-        // add the missing operands (to arguments and return nodes)
-        addInterproceduralOperands(F, subg);
+            auto it = ids.find(CI->getParent()->getParent());
+            if (it != ids.end())
+                callees[it->second].push_back(i);
+        }
+    }
+
+    // the components are in reverse topological order,
+    // that is, the callees go first
+    std::vector<std::vector<unsigned>> components;
+    computeSCCs(callees, components);
+    for (const auto& component : components) {
+        for (unsigned i : component)
+            computeSummary(funcs[i], subgraphs_map[funcs[i]]);
+
+        for (unsigned i : component) {
+            if (isSummarized(funcs[i]))
+                instantiateSummary(funcs[i], summaries[funcs[i]]);
+        }
+    }
+
+    if (heap_cloning > 0)
+        Profiler::count("PTA heap clones", heap_clones.size());
+}
+
+void LLVMPointerSubgraphBuilder::computeSummary(const llvm::Function *F,
+                                                Subgraph& subg)
+{
+    // the variadic arguments and the arguments of calls via function
+    // pointers that are added later cannot be in the summary
+    if (F->isVarArg())
+        return;
+
+    std::map<PSNode *, unsigned> args;
+    unsigned idx = 0;
+    for (auto A = F->arg_begin(), E = F->arg_end(); A != E; ++A, ++idx) {
+        auto it = nodes_map.find(&*A);
+        if (it != nodes_map.end())
+            args[it->second.first] = idx;
+    }
+
+    std::vector<PSNode *> rets;
+    for (PSNode *r : subg.ret->getPredecessors()) {
+        if (r->getType() == PSNodeType::RETURN)
+            rets.push_back(r);
+    }
+
+    summaries[F].compute(rets, args, summarized_calls);
+}
+
+bool LLVMPointerSubgraphBuilder::isSummarized(const llvm::Function *F) const
+{
+    auto it = summaries.find(F);
+    if (it == summaries.end() || !it->second.isValid())
+        return false;
+
+    return (call_summaries && it->second.hasArguments())
+           || (heap_cloning > 0 && it->second.hasHeapAllocations());
+}
+
+// a new allocation node for the call of an allocation wrapper,
+// or @alloc itself if it is not a heap allocation or its call string
+// is long enough
+PSNode *LLVMPointerSubgraphBuilder::cloneHeapAllocation(PSNode *alloc)
+{
+    if (alloc->getType() != PSNodeType::DYN_ALLOC || !alloc->isHeap())
+        return alloc;
+
+    auto it = heap_clones.find(alloc);
+    unsigned length = it == heap_clones.end() ? 0 : it->second;
+    if (length >= heap_cloning)
+        return alloc;
+
+    PSNode *clone = newNode(PSNodeType::DYN_ALLOC);
+    clone->setIsHeap();
+    clone->setSize(alloc->getSize());
+    if (alloc->isZeroInitialized())
+        clone->setZeroInitialized();
+    // the clone stands for the same allocation in the program
+    clone->setUserData(alloc->getUserData<llvm::Value>());
+
+    heap_clones.emplace(clone, length + 1);
+    return clone;
+}
+
+void LLVMPointerSubgraphBuilder::instantiateSummary(const llvm::Function *F,
+                                                    const ReturnSummary& summary)
+{
+    using namespace llvm;
+
+    PSNode *root = subgraphs_map[F].root;
+    for (auto I = F->use_begin(), E = F->use_end(); I != E; ++I) {
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+        const Value *use = *I;
+#else
+        const Value *use = I->getUser();
+#endif
+        const CallInst *CI = dyn_cast<CallInst>(use);
+        if (!CI || CI->getCalledFunction() != F)
+            continue;
+
+        // the call is not reachable from main
+        PSNode *callNode = getNode(CI);
+        if (!callNode)
+            continue;
+
+        std::vector<PSNode *> actuals;
+        for (unsigned i = 0; i < F->arg_size(); ++i)
+            actuals.push_back(tryGetOperand(CI->getArgOperand(i)));
+
+        // the allocations cloned for this call
+        std::vector<std::pair<PSNode *, PSNode *>> clones;
+        auto clone = [this, &clones](PSNode *alloc) {
+            for (auto& c : clones) {
+                if (c.first == alloc)
+                    return c.second;
+            }
+
+            PSNode *cl = cloneHeapAllocation(alloc);
+            if (cl != alloc)
+                clones.emplace_back(alloc, cl);
+            return cl;
+        };
+
+        PSNode *value;
+        PSNodesSeq seq = heap_cloning > 0
+                            ? summary.instantiate(actuals, *PS, value, clone)
+                            : summary.instantiate(actuals, *PS, value);
+        PSNode *returnNode = callNode->getPairedNode();
+        if (value)
+            returnNode->addOperand(value);
+        summarized_calls.insert(returnNode);
+
+        // compute the returned pointers right after the call,
+        // so they are ready when the subprocedure returns
+        if (seq.first) {
+            callNode->replaceSingleSuccessor(seq.first);
+            seq.second->addSuccessor(root);
+        }
+
+        // the clones get what the function stored into
+        // the original memory after the call returns
+        PSNode *last = returnNode;
+        for (auto& c : clones) {
+            PSNode *mcp = newNode(PSNodeType::MEMCPY, c.first, c.second,
+                                  0, UNKNOWN_OFFSET);
+            c.second->insertAfter(last);
+            mcp->insertAfter(c.second);
+            last = mcp;
+        }
     }
 }
 
@@ -1733,6 +2090,10 @@ void LLVMPointerSubgraphBuilder::addReturnNodeOperands(const llvm::Function *F,
 {
     using namespace llvm;
 
+    // the direct calls get the values from the instantiated summary
+    if (!CI && isSummarized(F))
+        return;
+
     for (PSNode *r : ret->getPredecessors()) {
         // return node is like a PHI node,
         // we must add the operands too.
@@ -1832,9 +2193,51 @@ PSNode *LLVMPointerSubgraphBuilder::buildLLVMPointerSubgraph()
         root = glob.first;
     }
 
+    if (compact_graph)
+        compactGraph(root);
+
+    PS->setHasLoopInfo(loop_widening);
     return root;
 }
 
+std::unordered_map<const PSNode *, const llvm::Function *>
+LLVMPointerSubgraphBuilder::getNodesFunctions() const
+{
+    std::unordered_map<const PSNode *, const llvm::Function *> ret;
+    for (const auto& it : subgraphs_map) {
+        ret[it.second.root] = it.first;
+        ret[it.second.ret] = it.first;
+        if (it.second.vararg)
+            ret[it.second.vararg] = it.first;
+    }
+
+    for (const auto& it : nodes_map) {
+        const llvm::Function *F = getFunctionOf(it.first);
+        if (!F)
+            continue;
+
+        ret[it.second.first] = F;
+        ret[it.second.second] = F;
+    }
+
+    // the sequences of nodes of the values are chains, map also
+    // the nodes inside of them (up to the node of another value)
+    for (const auto& it : nodes_map) {
+        const llvm::Function *F = getFunctionOf(it.first);
+        if (!F)
+            continue;
+
+        PSNode *n = it.second.first;
+        while (n != it.second.second && n->successorsNum() == 1) {
+            n = n->getSingleSuccessor();
+            if (!ret.emplace(n, F).second)
+                break;
+        }
+    }
+
+    return ret;
+}
+
 } // namespace pta
 } // namespace analysis
 } // namespace dg
@@ -1,7 +1,10 @@
 #ifndef _LLVM_DG_POINTER_SUBGRAPH_H_
 #define _LLVM_DG_POINTER_SUBGRAPH_H_
 
+#include <memory>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/IR/Instructions.h>
@@ -10,6 +13,10 @@
 
 #include "analysis/PointsTo/PointerSubgraph.h"
 #include "analysis/PointsTo/Pointer.h"
+#include "analysis/PointsTo/ReturnSummary.h"
+#include "ADT/Arena.h"
+#include "llvm/analysis/ModuleInfo.h"
+#include "llvm/llvm-utils.h"
 
 namespace dg {
 namespace analysis {
@@ -21,12 +28,36 @@ class LLVMPointerSubgraphBuilder
 {
     const llvm::Module *M;
     const llvm::DataLayout *DL;
+    // the subgraph that owns the nodes that we create
+    PointerSubgraph *PS;
+    // the classification of functions and the sizes of types,
+    // shared with the builder of reaching definitions
+    std::shared_ptr<LLVMModuleInfo> info;
     uint64_t field_sensitivity;
     // flag that says whether we are building normally,
     // or the analysis is already running and we are building
     // some new parts of already built graph.
     // This is important with function pointer calls
     bool ad_hoc_building = false;
+    // instantiate summaries of the returned values at the calls
+    // instead of merging the values from all the calls
+    bool call_summaries = false;
+    // the length of the call strings of the cloned heap allocations
+    // (0 means that the heap allocations are not cloned)
+    unsigned heap_cloning = 0;
+    // simplify the graph after it is built (see compactGraph)
+    bool compact_graph = false;
+    // mark the GEPs in the loops of their functions, so that the analysis
+    // widens only these (instead of all the GEPs in the cycles of the whole
+    // graph, which are mostly made by the calls)
+    bool loop_widening = false;
+    // the blocks of the functions that are in some loop,
+    // computed once for every function (see isInLoop)
+    std::unordered_map<const llvm::Function *,
+                       std::set<const llvm::BasicBlock *>> loop_blocks;
+    // which functions may be called via a pointer
+    llvmutils::CallCompatibility call_compatibility
+        = llvmutils::CallCompatibility::LOOSE;
 
     // build pointer state subgraph for given graph
     // \return   root node of the graph
@@ -65,26 +96,57 @@ class LLVMPointerSubgraphBuilder
     std::unordered_map<const llvm::Value *, PSNodesSeq > nodes_map;
     // map of all built subgraphs - the value type is a pair (root, return)
     std::unordered_map<const llvm::Function *, Subgraph> subgraphs_map;
+    // calls via function pointers that we built subgraphs for
+    std::vector<std::pair<const llvm::CallInst *, const llvm::Function *>> funcptr_calls;
+    // summaries of the returned values, computed once for every function
+    std::unordered_map<const llvm::Function *, ReturnSummary> summaries;
+    // the CALL_RETURN nodes of the calls with instantiated summaries
+    std::set<PSNode *> summarized_calls;
+    // the length of the call string of the cloned heap allocations
+    std::unordered_map<PSNode *, unsigned> heap_clones;
+    // the functions that do not work with pointers at all
+    // (see isPointerTransparent), computed once for every function
+    std::unordered_map<const llvm::Function *, bool> transparent_funcs;
 
     // here we'll keep first and last nodes of every built block and
     // connected together according to successors
     std::map<const llvm::BasicBlock *, PSNodesSeq> built_blocks;
-    // helper nodes, here we store them to delete the memory later
-    std::vector<PSNode *> dummy_nodes;
+
+    // the initial pointers of the constant globals (see buildGlobals)
+    ADT::Arena<InitialPointersT> initial_pointers;
+
+    // the CONSTANT nodes of the pointers that do not change,
+    // shared by all the constant expressions that give the pointer
+    // (see getConstantNode())
+    std::map<std::pair<PSNode *, uint64_t>, PSNode *> constant_nodes;
+
+    template <typename... Args>
+    PSNode *newNode(Args&&... args)
+    {
+        return PS->create(std::forward<Args>(args)...);
+    }
 
 public:
     // \param field_sensitivity -- how much should be the PS field sensitive:
     //        UNKNOWN_OFFSET means full field sensitivity, 0 means field insensivity
     //        (every pointer with offset greater than 0 will have UNKNOWN_OFFSET)
-    LLVMPointerSubgraphBuilder(const llvm::Module *m,
+    // the nodes are created in @ps (and freed with it)
+    LLVMPointerSubgraphBuilder(const llvm::Module *m, PointerSubgraph *ps,
                                uint64_t field_sensitivity = UNKNOWN_OFFSET)
-        : M(m), DL(new llvm::DataLayout(m)), field_sensitivity(field_sensitivity)
+        : M(m), DL(new llvm::DataLayout(m)), PS(ps),
+          info(std::make_shared<LLVMModuleInfo>(m)),
+          field_sensitivity(field_sensitivity)
         {}
 
     ~LLVMPointerSubgraphBuilder();
 
     PSNode *buildLLVMPointerSubgraph();
 
+    const std::shared_ptr<LLVMModuleInfo>& getModuleInfo() const
+    {
+        return info;
+    }
+
     // create subgraph of function @F (the nodes)
     // and call+return nodes to/from it. This function
     // won't add the CFG edges if not @with_structure
@@ -95,12 +157,71 @@ public:
     createFuncptrCall(const llvm::CallInst *CInst,
                       const llvm::Function *F);
 
+    // build the subgraph for a call via function pointer
+    // @callsite to the function @called and connect it to the graph.
+    // Returns true if something changed
+    bool functionPointerCall(PSNode *callsite, PSNode *called);
+
+    // the direct calls of the functions that return only (something
+    // derived from) their arguments get only the pointers from their
+    // own arguments. Must be set before building the graph
+    void setCallSummaries(bool s = true) { call_summaries = s; }
+
+    // give every direct call of a function that returns memory
+    // allocated on heap (an allocation wrapper) its own copy of the
+    // allocation, up to the call strings of length @k (the wrappers
+    // of wrappers get the copies too). The pointers stored into
+    // the memory inside the wrappers are copied into the copy after
+    // the call returns. Must be set before building the graph
+    void setHeapCloning(unsigned k) { heap_cloning = k; }
+
+    // simplify the built graph before the analysis runs: remove casts,
+    // fold the GEPs of constant pointers, merge the equivalent GEPs
+    // and remove the NOOP nodes. Must be set before building the graph
+    void setCompactGraph(bool c = true) { compact_graph = c; }
+
+    // widen the GEPs in the loops of the functions (by llvm::LoopInfo)
+    // instead of the GEPs in the cycles of the whole graph
+    // (see PointerSubgraph::hasLoopInfo()). Must be set before
+    // building the graph
+    void setLoopWidening(bool l = true) { loop_widening = l; }
+
+    // how much the prototypes of the functions called via pointers
+    // must match the calls, the other functions are not connected
+    // to the calls (see llvmutils::callIsCompatible()).
+    // Must be set before the analysis runs
+    void setCallCompatibility(llvmutils::CallCompatibility c)
+    {
+        call_compatibility = c;
+    }
+
+    llvmutils::CallCompatibility getCallCompatibility() const
+    {
+        return call_compatibility;
+    }
+
+    // the calls via function pointers that were built (in this order)
+    const std::vector<std::pair<const llvm::CallInst *, const llvm::Function *>>&
+    getFuncptrCalls() const { return funcptr_calls; }
+
 
     // let the user get the nodes map, so that we can
     // map the points-to informatio back to LLVM nodes
     const std::unordered_map<const llvm::Value *, PSNodesSeq>&
                                 getNodesMap() const { return nodes_map; }
 
+    // the number of the nodes that the builder created
+    size_t getNodesNum() const { return PS->size(); }
+
+    // the functions whose code the nodes were built for, the nodes
+    // of the globals and the nodes that are not mapped are left out
+    std::unordered_map<const PSNode *, const llvm::Function *>
+    getNodesFunctions() const;
+
+    // the nodes of the subgraph of @F (without the nodes
+    // of the called functions), empty if @F was not built
+    std::vector<PSNode *> getFunctionNodes(const llvm::Function *F) const;
+
     PSNode *getNode(const llvm::Value *val)
     {
         auto it = nodes_map.find(val);
@@ -148,11 +269,14 @@ private:
 
     bool typeCanBePointer(llvm::Type *Ty) const;
     bool isRelevantInstruction(const llvm::Instruction& Inst);
+    bool isPointerTransparent(const llvm::Function *F);
+    bool computePointerTransparent(const llvm::Function *F);
 
     PSNode *createAlloc(const llvm::Instruction *Inst);
     PSNode *createStore(const llvm::Instruction *Inst);
     PSNode *createLoad(const llvm::Instruction *Inst);
     PSNode *createGEP(const llvm::Instruction *Inst);
+    bool isInLoop(const llvm::BasicBlock *B);
     PSNode *createSelect(const llvm::Instruction *Inst);
     PSNode *createPHI(const llvm::Instruction *Inst);
     PSNode *createCast(const llvm::Instruction *Inst);
@@ -174,6 +298,7 @@ private:
     PSNode *tryGetOperand(const llvm::Value *val);
     PSNode *getConstant(const llvm::Value *val);
     PSNode *createConstantExpr(const llvm::ConstantExpr *CE);
+    PSNode *getConstantNode(PSNode *target, const Offset& off);
     Pointer handleConstantGep(const llvm::GetElementPtrInst *GEP);
     Pointer handleConstantBitCast(const llvm::BitCastInst *BC);
     Pointer handleConstantPtrToInt(const llvm::PtrToIntInst *P2I);
@@ -204,6 +329,19 @@ private:
                                     Subgraph& subg,
                                     const llvm::CallInst *CI = nullptr);
 
+    // the simplifications of the built graph (see setCompactGraph),
+    // returns the number of the nodes removed from the graph
+    size_t compactGraph(PSNode *root);
+    void replaceNode(PSNode *node, PSNode *with,
+                     std::unordered_map<PSNode *, PSNode *>& replaced);
+
+    void computeSummary(const llvm::Function *F, Subgraph& subg);
+    // is the summary of @F instantiated at the direct calls?
+    bool isSummarized(const llvm::Function *F) const;
+    void computeSummaries();
+    void instantiateSummary(const llvm::Function *F, const ReturnSummary& summary);
+    PSNode *cloneHeapAllocation(PSNode *alloc);
+
     PSNodesSeq createExtract(const llvm::Instruction *Inst);
     PSNodesSeq createCall(const llvm::Instruction *Inst);
     PSNodesSeq createOrGetSubgraph(const llvm::CallInst *,
@@ -214,13 +352,19 @@ private:
                                             PSNode *node,
                                             PSNode *last = nullptr,
                                             uint64_t offset = 0);
+    bool getInitialPointers(const llvm::Constant *C, PSNode *node,
+                            InitialPointersT& pointers, uint64_t offset = 0);
+    uint64_t getElementOffset(llvm::Type *Ty, unsigned idx);
 
     PSNode *createMemTransfer(const llvm::IntrinsicInst *Inst);
 
     PSNodesSeq createMemSet(const llvm::Instruction *);
     PSNodesSeq createDynamicMemAlloc(const llvm::CallInst *CInst, int type);
     PSNodesSeq createRealloc(const llvm::CallInst *CInst);
+    PSNode *createDynamicAlloc(const llvm::CallInst *CInst, int type);
     PSNodesSeq createUnknownCall(const llvm::CallInst *CInst);
+    PSNodesSeq createSummarizedCall(const llvm::CallInst *CInst,
+                                    const FunctionSummary& summary);
     PSNodesSeq createIntrinsic(const llvm::Instruction *Inst);
     PSNodesSeq createVarArg(const llvm::IntrinsicInst *Inst);
 };
@@ -1,6 +1,12 @@
 #ifndef _LLVM_DG_POINTS_TO_ANALYSIS_H_
 #define _LLVM_DG_POINTS_TO_ANALYSIS_H_
 
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
 #pragma clang diagnostic push
@@ -22,7 +28,14 @@
 
 #include "analysis/PointsTo/PointerSubgraph.h"
 #include "analysis/PointsTo/PointerAnalysis.h"
+#include "analysis/PointsTo/PointsToDemandDriven.h"
+#include "analysis/PointsTo/PointsToFlowInsensitive.h"
+#include "analysis/Budget.h"
+#include "analysis/Progress.h"
+#include "analysis/MemoryUsage.h"
+#include "analysis/Profiler.h"
 #include "llvm/llvm-utils.h"
+#include "llvm/analysis/CallGraph.h"
 #include "llvm/analysis/PointsTo/PointerSubgraph.h"
 
 namespace dg {
@@ -33,57 +46,30 @@ using analysis::pta::LLVMPointerSubgraphBuilder;
 using analysis::pta::PSNodesSeq;
 
 template <typename PTType>
-class LLVMPointerAnalysisImpl : public PTType
+class LLVMPointerAnalysisImpl final : public PTType
 {
     LLVMPointerSubgraphBuilder *builder;
 
+    // the analyses that use the fixpoint loop of PointerAnalysis
+    // (they do not override run()) call the hooks of this final class,
+    // so the calls in the loop are bound statically
+    using UsesGenericRun
+        = std::is_same<decltype(&PTType::run),
+                       decltype(&analysis::pta::PointerAnalysis::run)>;
+
+    void runSolver(std::true_type) { this->runWith(this); }
+    void runSolver(std::false_type) { PTType::run(); }
+
 public:
     LLVMPointerAnalysisImpl(PointerSubgraph *PS, LLVMPointerSubgraphBuilder *b)
     : PTType(PS), builder(b) {}
 
+    void run() override { runSolver(UsesGenericRun()); }
+
     // build new subgraphs on calls via pointer
     virtual bool functionPointerCall(PSNode *callsite, PSNode *called)
     {
-        // with vararg it may happen that we get pointer that
-        // is not to function, so just bail out here in that case
-        if (!llvm::isa<llvm::Function>(called->getUserData<llvm::Value>()))
-            return false;
-
-        const llvm::Function *F = called->getUserData<llvm::Function>();
-        const llvm::CallInst *CI = callsite->getUserData<llvm::CallInst>();
-
-        // incompatible prototypes, skip it...
-        if (!llvmutils::callIsCompatible(F, CI))
-            return false;
-
-        if (F->size() == 0) {
-            // calling declaration that returns a pointer?
-            // That is unknown pointer
-            return callsite->getPairedNode()->addPointsTo(analysis::pta::PointerUnknown);
-        }
-
-        // create new instructions
-        std::pair<PSNode *, PSNode *> cf = builder->createFuncptrCall(CI, F);
-        assert(cf.first && cf.second);
-
-        // we got the return site for the call stored as the paired node
-        PSNode *ret = callsite->getPairedNode();
-        // ret is a PHI node, so pass the values returned from the
-        // procedure call
-        ret->addOperand(cf.second);
-
-        // replace the edge from call->ret that we
-        // have due to connectivity of the graph until we
-        // insert the subgraph
-        if (callsite->successorsNum() == 1 &&
-            callsite->getSingleSuccessor() == ret) {
-            callsite->replaceSingleSuccessor(cf.first);
-        } else
-            callsite->addSuccessor(cf.first);
-
-        cf.second->addSuccessor(ret);
-
-        return true;
+        return builder->functionPointerCall(callsite, called);
     }
 
     /*
@@ -118,33 +104,233 @@ public:
     */
 };
 
+///
+// Immutable copy of the points-to sets of the values of the module,
+// created by LLVMPointerAnalysis::finalize(). The pointers of all
+// the sets are kept in one array and every value has a range in it
+// (the values with the same node share the range). The snapshot
+// is never modified, so it can be queried from more threads at once.
+// The targets of the pointers are the nodes of the analysis,
+// so the analysis must outlive the snapshot.
+class LLVMPointsToSnapshot
+{
+public:
+    using Pointer = analysis::pta::Pointer;
+
+    class PointersRange
+    {
+        const Pointer *b = nullptr, *e = nullptr;
+
+    public:
+        PointersRange() = default;
+        PointersRange(const Pointer *b, const Pointer *e) : b(b), e(e) {}
+
+        const Pointer *begin() const { return b; }
+        const Pointer *end() const { return e; }
+        size_t size() const { return e - b; }
+        bool empty() const { return b == e; }
+    };
+
+    LLVMPointsToSnapshot() = default;
+    LLVMPointsToSnapshot(const LLVMPointsToSnapshot&) = delete;
+    LLVMPointsToSnapshot& operator=(const LLVMPointsToSnapshot&) = delete;
+
+    // the pointers of the value, empty if the value has no node
+    // in the pointer subgraph (see hasValue())
+    PointersRange getPointsTo(const llvm::Value *val) const
+    {
+        auto it = ranges.find(val);
+        if (it == ranges.end())
+            return PointersRange();
+
+        return PointersRange(pointers.data() + it->second.first,
+                             pointers.data() + it->second.second);
+    }
+
+    bool hasValue(const llvm::Value *val) const { return ranges.count(val) > 0; }
+
+    size_t getValuesNum() const { return ranges.size(); }
+    size_t getPointersNum() const { return pointers.size(); }
+
+private:
+    std::vector<Pointer> pointers;
+    std::unordered_map<const llvm::Value *, std::pair<uint32_t, uint32_t>> ranges;
+
+    friend class LLVMPointerAnalysis;
+};
+
 class LLVMPointerAnalysis
 {
-    //const llvm::Module *M;
+public:
+    // how the results were degraded because the analysis
+    // exceeded its budget (see setBudget())
+    enum class Degradation {
+        NONE,
+        // the flow-insensitive analysis was run instead
+        FLOW_INSENSITIVE,
+        // the pointers may point to unknown memory
+        UNKNOWN,
+    };
+
+private:
+    const llvm::Module *M;
     PointerSubgraph *PS;
     LLVMPointerSubgraphBuilder *builder;
+    analysis::pta::PTASchedule schedule;
+    // threads for the SCC schedule
+    unsigned threads;
+    unsigned offsets_budget;
+    // widen the GEPs in loops after this many moves of a pointer
+    unsigned widening_delay = 0;
+    // collapse the points-to sets with the unknown pointer
+    bool saturate_unknown = false;
+    // share the identical points-to sets after the analysis
+    bool share_sets;
+    analysis::Budget budget;
+    analysis::Progress progress;
+    Degradation degradation = Degradation::NONE;
+    analysis::pta::PointerAnalysisStatistics statistics;
+    // the memory used by the data of the last run() at its end
+    // (they are freed with the analysis), gathered with the statistics
+    analysis::MemoryUsage runMemoryUsage;
+    // the analysis that answers the queries in demand-driven mode
+    std::unique_ptr<LLVMPointerAnalysisImpl<analysis::pta::PointsToDemandDriven>>
+        demand;
+    // built lazily by getCallGraph()
+    std::unique_ptr<analysis::LLVMCallGraph> callgraph;
+
+    void query(PSNode *n)
+    {
+        if (n && demand)
+            demand->query(n);
+    }
+
+    // run the analysis on the built graph,
+    // returns false if it exceeded the budget
+    template <typename PTType>
+    bool solve()
+    {
+        LLVMPointerAnalysisImpl<PTType> PTA(PS, builder);
+        PTA.setSchedule(schedule);
+        PTA.setThreads(threads);
+        PTA.setOffsetsBudget(offsets_budget);
+        PTA.setWideningDelay(widening_delay);
+        PTA.setSaturateUnknown(saturate_unknown);
+        PTA.setBudget(budget);
+        PTA.setProgress(progress);
+        PTA.collectStatistics(statistics.enabled);
+        PTA.run();
+
+        if (share_sets)
+            PTA.sharePointsToSets();
+
+        // the analysis is gone, but keep its statistics
+        statistics = PTA.getStatistics();
+        if (statistics.enabled) {
+            analysis::Profiler::count("nodes processed",
+                                      statistics.getProcessedNodes());
+            analysis::Profiler::count("rounds", statistics.getRoundsNum());
+        }
+        runMemoryUsage = analysis::MemoryUsage();
+        if (statistics.enabled)
+            PTA.getMemoryUsage(runMemoryUsage);
+
+        return !PTA.isBudgetExceeded();
+    }
+
+    // let the pointers of @nodes point to unknown memory,
+    // all the nodes if @nodes is nullptr
+    void degradeToUnknown(const std::vector<PSNode *> *nodes = nullptr);
+
+    void buildGraph()
+    {
+        assert(PS && "Incorrectly constructed PTA, missing PS");
+        analysis::Profiler::Scope phase("Building the pointer subgraph");
+        PS->setRoot(builder->buildLLVMPointerSubgraph());
+        analysis::Profiler::count("pointer subgraph nodes",
+                                  builder->getNodesNum());
+        // the builder creates the nodes in the order of the values,
+        // the solvers go through the graph from the root
+        PS->renumberNodes();
+    }
+
+    // run the analysis on the built graph and degrade
+    // the results if it does not fit into the budget
+    template <typename PTType>
+    void solveOrDegrade()
+    {
+        assert(builder && "Incorrectly constructed PTA, missing builder");
+        analysis::Profiler::Scope phase("Solving points-to");
+        degradation = Degradation::NONE;
+        if (solve<PTType>())
+            return;
+
+        // the results are incomplete, fall back to the flow-insensitive
+        // analysis (it continues from the pointers found so far)
+        // and if it does not fit into the budget either, to unknown memory
+        using FlowInsensitiveT = analysis::pta::PointsToFlowInsensitive;
+        if (!std::is_same<PTType, FlowInsensitiveT>::value) {
+            if (solve<FlowInsensitiveT>()) {
+                degradation = Degradation::FLOW_INSENSITIVE;
+                return;
+            }
+        }
+
+        degradeToUnknown();
+        degradation = Degradation::UNKNOWN;
+    }
+
+    // fill the points-to sets of the built graph from the solution
+    // in @file (see saveSolution()), returns false if nothing was filled
+    bool seedFromSolution(const std::string& file, uint64_t key,
+                          double max_changed);
 
 public:
 
     LLVMPointerAnalysis(const llvm::Module *m,
-                        uint64_t field_sensitivity = UNKNOWN_OFFSET)
-        : /*M(m),*/ PS(new PointerSubgraph()),
-          builder(new LLVMPointerSubgraphBuilder(m, field_sensitivity)) {}
+                        uint64_t field_sensitivity = UNKNOWN_OFFSET,
+                        analysis::pta::PTASchedule sched
+                            = analysis::pta::PTASchedule::ROUNDS)
+        : M(m), PS(new PointerSubgraph()),
+          builder(new LLVMPointerSubgraphBuilder(m, PS, field_sensitivity)),
+          schedule(sched), threads(1), offsets_budget(0), share_sets(false) {}
 
     ~LLVMPointerAnalysis()
     {
-        delete PS;
+        callgraph.reset();
+        demand.reset();
+        // the builder refers to the nodes owned by PS
         delete builder;
+        delete PS;
     }
 
+    // the information about the module that the builder
+    // of the pointer subgraph computed (see LLVMModuleInfo)
+    const std::shared_ptr<LLVMModuleInfo>& getModuleInfo() const
+    {
+        return builder->getModuleInfo();
+    }
+
+    // the call graph of the module with the calls via pointers resolved
+    // by the points-to information, built at the first call (after run())
+    analysis::LLVMCallGraph& getCallGraph();
+
+    // are the points-to sets computed by the queries?
+    // (then the queries modify the analysis)
+    bool isDemandDriven() const { return demand != nullptr; }
+
     PSNode *getNode(const llvm::Value *val)
     {
-        return builder->getNode(val);
+        PSNode *n = builder->getNode(val);
+        query(n);
+        return n;
     }
 
     PSNode *getPointsTo(const llvm::Value *val)
     {
-        return builder->getPointsTo(val);
+        PSNode *n = builder->getPointsTo(val);
+        query(n);
+        return n;
     }
 
     const std::unordered_map<const llvm::Value *, PSNodesSeq>&
@@ -153,24 +339,202 @@ public:
         return builder->getNodesMap();
     }
 
-    void getNodes(std::set<PSNode *>& cont)
+    // copy the computed points-to sets of all the values into an immutable
+    // snapshot that can be shared by more threads (the queries above
+    // may modify the analysis, e.g., in the demand-driven mode,
+    // and they are not thread-safe). Call it after run()
+    std::shared_ptr<const LLVMPointsToSnapshot> finalize()
+    {
+        std::shared_ptr<LLVMPointsToSnapshot> snapshot(new LLVMPointsToSnapshot());
+        std::unordered_map<PSNode *, std::pair<uint32_t, uint32_t>> copied;
+
+        snapshot->ranges.reserve(getNodesMap().size());
+        for (const auto& it : getNodesMap()) {
+            // the same node as getPointsTo() would give
+            PSNode *n = getPointsTo(it.first);
+            if (!n)
+                continue;
+
+            auto cit = copied.find(n);
+            if (cit == copied.end()) {
+                uint32_t first = snapshot->pointers.size();
+                for (const analysis::pta::Pointer& ptr : n->pointsTo)
+                    snapshot->pointers.push_back(ptr);
+                cit = copied.emplace(n, std::make_pair(first,
+                                     static_cast<uint32_t>(snapshot->pointers.size()))).first;
+            }
+
+            snapshot->ranges.emplace(it.first, cit->second);
+        }
+
+        snapshot->pointers.shrink_to_fit();
+        return snapshot;
+    }
+
+    // all the nodes of the pointer subgraph (in the order of creation)
+    const std::vector<PSNode *>& getNodes() const
     {
-        PS->getNodes(cont);
+        return PS->getAllNodes();
     }
 
     template <typename PTType>
     void run()
     {
-        // build the subgraph
+        buildGraph();
+        solveOrDegrade<PTType>();
+    }
+
+    // like run(), but the analysis starts from the solution that
+    // saveSolution() stored for a previous revision of the module.
+    // The points-to sets of the values of the functions and globals
+    // that did not change are filled from the file and the analysis
+    // continues from them to a fixpoint. If the file cannot be used
+    // or more than @max_changed of the functions and globals changed,
+    // the analysis starts from scratch. Returns false in that case
+    template <typename PTType>
+    bool runIncremental(const std::string& file, uint64_t key,
+                        double max_changed = 0.25)
+    {
+        buildGraph();
+
+        bool seeded;
+        {
+            analysis::Profiler::Scope phase("Loading the previous solution");
+            seeded = seedFromSolution(file, key, max_changed);
+        }
+
+        solveOrDegrade<PTType>();
+        return seeded;
+    }
+
+    // build the PointerSubgraph, but compute the points-to sets
+    // (flow-insensitive) only when getNode() or getPointsTo() asks
+    // for them. When a query needs more than @budget nodes,
+    // the whole analysis is run instead
+    void runDemandDriven(size_t budget
+                            = analysis::pta::PointsToDemandDriven::DEFAULT_BUDGET)
+    {
         assert(PS && "Incorrectly constructed PTA, missing PS");
         PS->setRoot(builder->buildLLVMPointerSubgraph());
 
-        // run the analysis itself
-        assert(builder && "Incorrectly constructed PTA, missing builder");
-        LLVMPointerAnalysisImpl<PTType> PTA(PS, builder);
-        PTA.run();
+        using DemandDrivenT = analysis::pta::PointsToDemandDriven;
+        demand.reset(new LLVMPointerAnalysisImpl<DemandDrivenT>(PS, builder));
+        demand->setBudget(budget);
+        demand->setOffsetsBudget(offsets_budget);
+        demand->setWideningDelay(widening_delay);
+        demand->setSaturateUnknown(saturate_unknown);
+        demand->collectStatistics(statistics.enabled);
+    }
+
+    // run the flow-insensitive analysis and then compute flow-sensitively
+    // (seeded with the flow-insensitive results) only the functions where
+    // it can make a difference: those that load pointers from the memory
+    // they store to, with more than one possible value. Only the functions
+    // from @relevant are considered (all the functions if it is empty)
+    void runTiered(const std::vector<const llvm::Function *>& relevant = {});
+
+    // the time and memory limits of every run of the analysis. A flow-
+    // sensitive (or other) analysis that exceeds them is replaced
+    // by the flow-insensitive one, which gets the same budget. If even
+    // that one exceeds it, all the pointers may point to unknown memory
+    void setBudget(const analysis::Budget& b) { budget = b; }
+    // see PointerAnalysis::setProgress()
+    void setProgress(const analysis::Progress& p) { progress = p; }
+    // how the results of the last run were degraded
+    Degradation getDegradation() const { return degradation; }
+
+    // solve the independent parts of the graph in parallel
+    // (used only with the SCC schedule)
+    void setThreads(unsigned n) { threads = n; }
+
+    // collapse the memory objects that are accessed with more than
+    // @b different offsets to UNKNOWN_OFFSET (0 is unconstrained)
+    void setOffsetsBudget(unsigned b) { offsets_budget = b; }
+
+    // the points-to sets that contain the unknown pointer
+    // do not keep (and take) any other pointers
+    void setSaturateUnknown(bool s = true) { saturate_unknown = s; }
+
+    // instantiate the summaries of the values returned from functions
+    // at the direct calls (must be set before the graph is built)
+    void setCallSummaries(bool s = true) { builder->setCallSummaries(s); }
+
+    // clone the heap allocations in the allocation wrappers for every
+    // call, up to the call strings of length @k (0 turns it off).
+    // Must be set before the graph is built
+    void setHeapCloning(unsigned k) { builder->setHeapCloning(k); }
+
+    // simplify the PointerSubgraph before the analysis
+    // (must be set before the graph is built)
+    void setCompactGraph(bool c = true) { builder->setCompactGraph(c); }
+
+    // widen the GEPs in the loops of the functions instead of the GEPs
+    // in the cycles of the whole graph (must be set before the graph
+    // is built) and widen them only after they moved a pointer @delay
+    // times (see PointerAnalysis::setWideningDelay())
+    void setLoopWidening(bool l = true) { builder->setLoopWidening(l); }
+    void setWideningDelay(unsigned delay) { widening_delay = delay; }
+
+    // see LLVMPointerSubgraphBuilder::setCallCompatibility(), the call
+    // graph takes the same targets (must be set before the analysis runs)
+    void setCallCompatibility(llvmutils::CallCompatibility c)
+    {
+        builder->setCallCompatibility(c);
+    }
+
+    llvmutils::CallCompatibility getCallCompatibility() const
+    {
+        return builder->getCallCompatibility();
+    }
+
+    // after run(), let the nodes with the same points-to sets
+    // share one copy of the set (saves memory on big modules)
+    void setSharePointsToSets(bool share = true) { share_sets = share; }
+
+    // gather statistics in the next run()
+    void collectStatistics(bool enable = true) { statistics.enabled = enable; }
+    // statistics of the last run()
+    const analysis::pta::PointerAnalysisStatistics& getStatistics() const
+    {
+        if (demand)
+            return demand->getStatistics();
+        return statistics;
+    }
+
+    // print the statistics together with the largest points-to sets,
+    // @num is the number of the nodes in the lists of nodes
+    void printStatistics(llvm::raw_ostream& os,
+                         const analysis::pta::PointerAnalysisStatistics& st,
+                         size_t num = 10);
+    void printStatistics(llvm::raw_ostream& os, size_t num = 10)
+    {
+        printStatistics(os, getStatistics(), num);
     }
 
+    // add the approximate memory used by the PointerSubgraph and
+    // the points-to sets to @mu. The memory objects are freed after
+    // run(), their usage is reported only if the statistics were gathered
+    void getMemoryUsage(analysis::MemoryUsage& mu);
+
+    // save the final points-to sets of llvm values (and the calls via
+    // function pointers that were resolved) into @file, so that later
+    // runs on the same module can load them instead of running the
+    // analysis. @key should identify the module and the options
+    // of the analysis, it is checked when loading the file
+    bool saveResults(const std::string& file, uint64_t key);
+
+    // build the PointerSubgraph and fill in the points-to sets
+    // from @file (created by saveResults) instead of running the
+    // analysis. Returns false if the file cannot be used,
+    // the PointerSubgraph is not built in that case
+    bool loadResults(const std::string& file, uint64_t key);
+
+    // save the points-to sets of llvm values together with the fingerprints
+    // of the functions and global variables into @file, so that the runs
+    // on the next revisions of the module can use them (see runIncremental).
+    // @key should identify the options of the analysis (not the module)
+    bool saveSolution(const std::string& file, uint64_t key);
+
     // this method creates PointerAnalysis object and returns it.
     // It is alternative to run() method, but it does not delete all
     // the analysis data as the run() (like memory objects and so on).
@@ -183,7 +547,14 @@ public:
         PS->setRoot(builder->buildLLVMPointerSubgraph());
 
         assert(builder && "Incorrectly constructed PTA, missing builder");
-        return new LLVMPointerAnalysisImpl<PTType>(PS, builder);
+        auto PTA = new LLVMPointerAnalysisImpl<PTType>(PS, builder);
+        PTA->setSchedule(schedule);
+        PTA->setThreads(threads);
+        PTA->setOffsetsBudget(offsets_budget);
+        PTA->setWideningDelay(widening_delay);
+        PTA->setSaturateUnknown(saturate_unknown);
+        PTA->collectStatistics(statistics.enabled);
+        return PTA;
     }
 };
 
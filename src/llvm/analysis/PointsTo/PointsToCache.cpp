@@ -0,0 +1,733 @@
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "PointsTo.h"
+#include "llvm/CacheFile.h"
+
+///
+// Format of the file (see llvm/CacheFile.h):
+//
+//  magic (8 bytes), key (u64), number of llvm values in the module (u32)
+//  number of calls via function pointers (u32)
+//      call: callsite value id (u32), function value id (u32)
+//  number of records (u32)
+//      record: value id (u32), kind (u32; 0 - the node of the value,
+//              1 - the paired node of a call), number of pointers (u32)
+//          pointer: target value id (u32), offset (u64)
+//
+// Values are identified by their number in ValuesNumbering.
+//
+// Format of the file of saveSolution():
+//
+//  magic (8 bytes), key (u64), fingerprint of the module (u64)
+//  number of units (u32)
+//      unit: name (string), fingerprint (u64), number of values (u32)
+//  number of records (u32)
+//      record: unit (u32), value (u32), kind (u32), number of pointers (u32)
+//          pointer: target unit (u32), target value (u32), offset (u64)
+//
+// Units are the functions and global variables of the module, values
+// are identified by their unit and their number in the unit (see Units).
+
+namespace dg {
+
+using analysis::pta::Pointer;
+using analysis::pta::PointsToSetT;
+using analysis::pta::PSNodeType;
+
+namespace {
+
+const char MAGIC[8] = {'D', 'G', 'P', 'T', 'A', 'C', '1', '\0'};
+const uint32_t NULL_ID = ~((uint32_t) 0);
+const uint32_t UNKNOWN_ID = NULL_ID - 1;
+
+// the memory object that the pointers to @val point to
+PSNode *getTarget(LLVMPointerSubgraphBuilder *builder, const llvm::Value *val)
+{
+    PSNode *n = builder->getNode(val);
+    if (!n)
+        return nullptr;
+
+    switch (n->getType()) {
+        case PSNodeType::ALLOC:
+        case PSNodeType::DYN_ALLOC:
+        case PSNodeType::FUNCTION:
+            return n;
+        case PSNodeType::CONSTANT:
+            // e.g. realloc, the value is the pointer to the new memory
+            if (n->pointsTo.size() != 1)
+                return nullptr;
+            return n->pointsTo.begin()->target;
+        default:
+            return nullptr;
+    }
+}
+
+struct Record {
+    uint32_t value;
+    uint32_t kind;
+    std::vector<std::pair<uint32_t, uint64_t>> pointers;
+};
+
+} // anonymous namespace
+
+bool LLVMPointerAnalysis::saveResults(const std::string& file, uint64_t key)
+{
+    // we need the points-to sets of all nodes
+    if (demand && !demand->isExhaustive())
+        demand->run();
+
+    ValuesNumbering numbering(M);
+
+    auto targetId = [&](const Pointer& ptr) -> uint32_t {
+        if (ptr.isNull())
+            return NULL_ID;
+        if (ptr.isUnknown())
+            return UNKNOWN_ID;
+
+        // the target must be found again when loading the file,
+        // otherwise we must use the unknown memory (to stay sound)
+        uint32_t id;
+        const llvm::Value *val = ptr.target->getUserData<llvm::Value>();
+        if (!val || !numbering.getId(val, id)
+            || getTarget(builder, val) != ptr.target)
+            return UNKNOWN_ID;
+
+        return id;
+    };
+
+    std::vector<Record> records;
+    auto addRecord = [&](uint32_t id, uint32_t kind, PSNode *node) {
+        if (node->pointsTo.empty())
+            return;
+
+        Record rec{id, kind, {}};
+        for (const Pointer& ptr : node->pointsTo) {
+            uint32_t tid = targetId(ptr);
+            rec.pointers.emplace_back(tid, tid == UNKNOWN_ID ? UNKNOWN_OFFSET
+                                                             : *ptr.offset);
+        }
+
+        records.push_back(std::move(rec));
+    };
+
+    for (uint32_t id = 0; id < numbering.values.size(); ++id) {
+        PSNode *node = builder->getNode(numbering.values[id]);
+        if (!node)
+            continue;
+
+        addRecord(id, 0, node);
+        if ((node->getType() == PSNodeType::CALL
+             || node->getType() == PSNodeType::CALL_FUNCPTR)
+            && node->getPairedNode())
+            addRecord(id, 1, node->getPairedNode());
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> calls;
+    for (const auto& call : builder->getFuncptrCalls()) {
+        uint32_t cid, fid;
+        if (!numbering.getId(call.first, cid)
+            || !numbering.getId(call.second, fid))
+            return false;
+
+        calls.emplace_back(cid, fid);
+    }
+
+    CacheWriter out(file);
+    out.write(MAGIC, sizeof MAGIC);
+    out.write64(key);
+    out.write32(numbering.values.size());
+
+    out.write32(calls.size());
+    for (const auto& call : calls) {
+        out.write32(call.first);
+        out.write32(call.second);
+    }
+
+    out.write32(records.size());
+    for (const Record& rec : records) {
+        out.write32(rec.value);
+        out.write32(rec.kind);
+        out.write32(rec.pointers.size());
+        for (const auto& ptr : rec.pointers) {
+            out.write32(ptr.first);
+            out.write64(ptr.second);
+        }
+    }
+
+    return out.good();
+}
+
+bool LLVMPointerAnalysis::loadResults(const std::string& file, uint64_t key)
+{
+    // MemoryBuffer maps big files into memory instead of reading them
+    auto buf = llvm::MemoryBuffer::getFile(file);
+    if (!buf)
+        return false;
+
+    CacheReader in(*buf.get());
+    ValuesNumbering numbering(M);
+    uint32_t values_num = numbering.values.size();
+
+    // read and check the whole file before we touch the PointerSubgraph
+    char magic[sizeof MAGIC];
+    uint64_t file_key;
+    uint32_t num;
+    if (!in.read(magic, sizeof magic) || memcmp(magic, MAGIC, sizeof MAGIC) != 0
+        || !in.read64(file_key) || file_key != key
+        || !in.read32(num) || num != values_num)
+        return false;
+
+    uint32_t calls_num;
+    if (!in.read32(calls_num))
+        return false;
+
+    std::vector<std::pair<uint32_t, uint32_t>> calls(calls_num);
+    for (auto& call : calls) {
+        if (!in.read32(call.first) || !in.read32(call.second)
+            || call.first >= values_num || call.second >= values_num)
+            return false;
+    }
+
+    uint32_t records_num;
+    if (!in.read32(records_num))
+        return false;
+
+    std::vector<Record> records(records_num);
+    for (Record& rec : records) {
+        uint32_t ptrs_num;
+        if (!in.read32(rec.value) || !in.read32(rec.kind)
+            || !in.read32(ptrs_num) || rec.value >= values_num || rec.kind > 1)
+            return false;
+
+        rec.pointers.resize(ptrs_num);
+        for (auto& ptr : rec.pointers) {
+            if (!in.read32(ptr.first) || !in.read64(ptr.second)
+                || (ptr.first >= values_num
+                    && ptr.first != NULL_ID && ptr.first != UNKNOWN_ID))
+                return false;
+        }
+    }
+
+    if (!in.atEnd())
+        return false;
+
+    PS->setRoot(builder->buildLLVMPointerSubgraph());
+
+    // build the subgraphs for the calls via function pointers
+    // in the same order as the analysis did
+    for (const auto& call : calls) {
+        PSNode *callsite = builder->getNode(numbering.values[call.first]);
+        PSNode *called = builder->getNode(numbering.values[call.second]);
+        assert(callsite && called && "The file does not match the module");
+        if (callsite && called)
+            builder->functionPointerCall(callsite, called);
+    }
+
+    for (const Record& rec : records) {
+        PSNode *node = builder->getNode(numbering.values[rec.value]);
+        if (node && rec.kind == 1)
+            node = node->getPairedNode();
+
+        assert(node && "The file does not match the module");
+        if (!node)
+            continue;
+
+        for (const auto& ptr : rec.pointers) {
+            if (ptr.first == NULL_ID) {
+                node->addPointsTo(analysis::pta::PointerNull);
+                continue;
+            }
+
+            PSNode *target = nullptr;
+            if (ptr.first != UNKNOWN_ID)
+                target = getTarget(builder, numbering.values[ptr.first]);
+
+            if (target)
+                node->addPointsTo(target, ptr.second);
+            else
+                node->addPointsTo(analysis::pta::PointerUnknown);
+        }
+    }
+
+    return true;
+}
+
+namespace {
+
+const char SOLUTION_MAGIC[8] = {'D', 'G', 'P', 'T', 'A', 'S', '1', '\0'};
+
+// FNV-1a
+struct Hasher {
+    uint64_t hash = 14695981039346656037ULL;
+
+    void add(const void *data, size_t len)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    void add(uint64_t v) { add(&v, sizeof v); }
+    void add(llvm::StringRef s)
+    {
+        add(static_cast<uint64_t>(s.size()));
+        add(s.data(), s.size());
+    }
+};
+
+///
+// The functions and global variables of a module (units) with their
+// fingerprints. The values of a function are the function, its arguments
+// and its instructions (in this order), a global variable has only itself.
+// The fingerprint of a unit changes when the unit changes in a way
+// that may change the points-to sets of its values. If a change is missed,
+// the values get the pointers of other values, which makes the results
+// less precise, but not unsound (see seedFromSolution())
+class Units {
+    std::unordered_map<const llvm::Type *, uint64_t> types;
+    std::unordered_map<const llvm::Constant *, uint64_t> constants;
+
+    uint64_t hashType(llvm::Type *T)
+    {
+        auto it = types.find(T);
+        if (it != types.end())
+            return it->second;
+
+        Hasher h;
+        h.add(static_cast<uint64_t>(T->getTypeID()));
+        if (auto ST = llvm::dyn_cast<llvm::StructType>(T)) {
+            // the types of the elements are not behind pointers,
+            // so this does not recurse infinitely
+            if (ST->hasName())
+                h.add(ST->getName());
+            if (!ST->isOpaque()) {
+                for (llvm::Type *E : ST->elements())
+                    h.add(hashType(E));
+            }
+        } else if (T->isArrayTy()) {
+            h.add(T->getArrayNumElements());
+            h.add(hashType(T->getArrayElementType()));
+        } else {
+            std::string str;
+            llvm::raw_string_ostream os(str);
+            T->print(os);
+            h.add(os.str());
+        }
+
+        types.emplace(T, h.hash);
+        return h.hash;
+    }
+
+    uint64_t hashConstant(const llvm::Constant *C)
+    {
+        auto it = constants.find(C);
+        if (it != constants.end())
+            return it->second;
+
+        Hasher h;
+        h.add(static_cast<uint64_t>(C->getValueID()));
+        h.add(hashType(C->getType()));
+        if (auto GV = llvm::dyn_cast<llvm::GlobalValue>(C)) {
+            // the pointers to the same global are the same
+            // even if the global changed
+            h.add(GV->getName());
+        } else if (auto CI = llvm::dyn_cast<llvm::ConstantInt>(C)) {
+            h.add(CI->getValue().getLimitedValue());
+        } else if (auto CFP = llvm::dyn_cast<llvm::ConstantFP>(C)) {
+            h.add(CFP->getValueAPF().bitcastToAPInt().getLimitedValue());
+        } else if (auto CDS = llvm::dyn_cast<llvm::ConstantDataSequential>(C)) {
+            h.add(CDS->getRawDataValues());
+        } else {
+            if (auto CE = llvm::dyn_cast<llvm::ConstantExpr>(C))
+                h.add(CE->getOpcode());
+            if (auto GEP = llvm::dyn_cast<llvm::GEPOperator>(C))
+                h.add(hashType(GEP->getSourceElementType()));
+            for (const llvm::Use& op : C->operands())
+                h.add(hashConstant(llvm::cast<llvm::Constant>(op.get())));
+        }
+
+        constants.emplace(C, h.hash);
+        return h.hash;
+    }
+
+    uint64_t fingerprint(const llvm::GlobalVariable& G)
+    {
+        Hasher h;
+        h.add(hashType(G.getValueType()));
+        h.add(G.isConstant());
+        if (G.hasInitializer())
+            h.add(hashConstant(G.getInitializer()));
+        return h.hash;
+    }
+
+    uint64_t fingerprint(const llvm::Function& F)
+    {
+        // the local values are identified by their position
+        std::unordered_map<const llvm::Value *, uint64_t> locals;
+        for (auto A = F.arg_begin(), E = F.arg_end(); A != E; ++A)
+            locals.emplace(&*A, locals.size());
+        for (const llvm::BasicBlock& B : F) {
+            locals.emplace(&B, locals.size());
+            for (const llvm::Instruction& I : B)
+                locals.emplace(&I, locals.size());
+        }
+
+        Hasher h;
+        h.add(hashType(F.getFunctionType()));
+        h.add(F.isDeclaration());
+        for (const llvm::BasicBlock& B : F) {
+            h.add(B.size());
+            for (const llvm::Instruction& I : B) {
+                h.add(I.getOpcode());
+                h.add(hashType(I.getType()));
+                if (auto AI = llvm::dyn_cast<llvm::AllocaInst>(&I))
+                    h.add(hashType(AI->getAllocatedType()));
+                else if (auto GEP = llvm::dyn_cast<llvm::GEPOperator>(&I))
+                    h.add(hashType(GEP->getSourceElementType()));
+                else if (auto CI = llvm::dyn_cast<llvm::CmpInst>(&I))
+                    h.add(CI->getPredicate());
+
+                for (const llvm::Use& op : I.operands()) {
+                    const llvm::Value *val = op.get();
+                    auto it = locals.find(val);
+                    if (it != locals.end()) {
+                        h.add(1);
+                        h.add(it->second);
+                    } else if (auto C = llvm::dyn_cast<llvm::Constant>(val)) {
+                        h.add(2);
+                        h.add(hashConstant(C));
+                    } else if (!llvm::isa<llvm::MetadataAsValue>(val)) {
+                        // the debugging information does not matter
+                        h.add(3);
+                        h.add(static_cast<uint64_t>(val->getValueID()));
+                    }
+                }
+            }
+        }
+
+        return h.hash;
+    }
+
+    void addUnit(const llvm::Value *val, uint64_t fp)
+    {
+        // the unnamed globals are found by their content
+        std::string name = val->getName().str();
+        if (name.empty())
+            name = "\1" + std::to_string(fp);
+
+        uint32_t idx = units.size();
+        byName.emplace(name, idx);
+        units.push_back({std::move(name), fp, {}});
+        add(idx, val);
+    }
+
+    void add(uint32_t unit, const llvm::Value *val)
+    {
+        ids.emplace(val, std::make_pair(unit, units[unit].values.size()));
+        units[unit].values.push_back(val);
+    }
+
+public:
+    struct Unit {
+        std::string name;
+        uint64_t fingerprint;
+        std::vector<const llvm::Value *> values;
+    };
+
+    std::vector<Unit> units;
+    std::unordered_map<std::string, uint32_t> byName;
+    std::unordered_map<const llvm::Value *, std::pair<uint32_t, uint32_t>> ids;
+    // the data layout and the target, if they change, everything changes
+    uint64_t moduleFingerprint;
+
+    Units(const llvm::Module *M)
+    {
+        Hasher h;
+        h.add(M->getDataLayoutStr());
+        h.add(M->getTargetTriple());
+        moduleFingerprint = h.hash;
+
+        for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I)
+            addUnit(&*I, fingerprint(*I));
+
+        for (const llvm::Function& F : *M) {
+            addUnit(&F, fingerprint(F));
+            uint32_t idx = units.size() - 1;
+            for (auto A = F.arg_begin(), E = F.arg_end(); A != E; ++A)
+                add(idx, &*A);
+
+            for (const llvm::BasicBlock& B : F) {
+                for (const llvm::Instruction& I : B)
+                    add(idx, &I);
+            }
+        }
+    }
+
+    bool getId(const llvm::Value *val, std::pair<uint32_t, uint32_t>& id) const
+    {
+        auto it = ids.find(val);
+        if (it == ids.end())
+            return false;
+
+        id = it->second;
+        return true;
+    }
+};
+
+struct SolutionPointer {
+    uint32_t unit;
+    uint32_t value;
+    uint64_t offset;
+};
+
+struct SolutionRecord {
+    uint32_t unit;
+    uint32_t value;
+    uint32_t kind;
+    std::vector<SolutionPointer> pointers;
+};
+
+} // anonymous namespace
+
+bool LLVMPointerAnalysis::saveSolution(const std::string& file, uint64_t key)
+{
+    // we need the points-to sets of all nodes
+    if (demand && !demand->isExhaustive())
+        demand->run();
+
+    Units units(M);
+
+    std::vector<SolutionRecord> records;
+    auto addRecord = [&](const std::pair<uint32_t, uint32_t>& id,
+                         uint32_t kind, PSNode *node) {
+        if (node->pointsTo.empty())
+            return;
+
+        SolutionRecord rec{id.first, id.second, kind, {}};
+        for (const Pointer& ptr : node->pointsTo) {
+            if (ptr.isNull()) {
+                rec.pointers.push_back({NULL_ID, 0, 0});
+                continue;
+            }
+            if (ptr.isUnknown()) {
+                rec.pointers.push_back({UNKNOWN_ID, 0, UNKNOWN_OFFSET});
+                continue;
+            }
+
+            // the targets that are not found again (e.g. the copies
+            // of the heap allocations) are left out, the analysis
+            // finds the pointers to them again
+            std::pair<uint32_t, uint32_t> tid;
+            const llvm::Value *val = ptr.target->getUserData<llvm::Value>();
+            if (!val || !units.getId(val, tid)
+                || getTarget(builder, val) != ptr.target)
+                continue;
+
+            rec.pointers.push_back({tid.first, tid.second, *ptr.offset});
+        }
+
+        records.push_back(std::move(rec));
+    };
+
+    for (const Units::Unit& unit : units.units) {
+        for (const llvm::Value *val : unit.values) {
+            PSNode *node = builder->getNode(val);
+            if (!node)
+                continue;
+
+            const auto& id = units.ids[val];
+            addRecord(id, 0, node);
+            if ((node->getType() == PSNodeType::CALL
+                 || node->getType() == PSNodeType::CALL_FUNCPTR)
+                && node->getPairedNode())
+                addRecord(id, 1, node->getPairedNode());
+        }
+    }
+
+    CacheWriter out(file);
+    out.write(SOLUTION_MAGIC, sizeof SOLUTION_MAGIC);
+    out.write64(key);
+    out.write64(units.moduleFingerprint);
+
+    out.write32(units.units.size());
+    for (const Units::Unit& unit : units.units) {
+        out.writeString(unit.name);
+        out.write64(unit.fingerprint);
+        out.write32(unit.values.size());
+    }
+
+    out.write32(records.size());
+    for (const SolutionRecord& rec : records) {
+        out.write32(rec.unit);
+        out.write32(rec.value);
+        out.write32(rec.kind);
+        out.write32(rec.pointers.size());
+        for (const SolutionPointer& ptr : rec.pointers) {
+            out.write32(ptr.unit);
+            out.write32(ptr.value);
+            out.write64(ptr.offset);
+        }
+    }
+
+    return out.good();
+}
+
+bool LLVMPointerAnalysis::seedFromSolution(const std::string& file,
+                                           uint64_t key, double max_changed)
+{
+    auto buf = llvm::MemoryBuffer::getFile(file);
+    if (!buf)
+        return false;
+
+    CacheReader in(*buf.get());
+    Units units(M);
+
+    char magic[sizeof SOLUTION_MAGIC];
+    uint64_t file_key, module_fp;
+    if (!in.read(magic, sizeof magic)
+        || memcmp(magic, SOLUTION_MAGIC, sizeof SOLUTION_MAGIC) != 0
+        || !in.read64(file_key) || file_key != key
+        || !in.read64(module_fp) || module_fp != units.moduleFingerprint)
+        return false;
+
+    // the units of the file mapped to the units of the module
+    const uint32_t NONE = ~((uint32_t) 0);
+    uint32_t units_num;
+    if (!in.read32(units_num))
+        return false;
+
+    std::vector<uint32_t> mapping(units_num, NONE);
+    std::vector<uint32_t> values_nums(units_num);
+    std::vector<bool> unchanged(units_num, false);
+    size_t unchanged_num = 0;
+    for (uint32_t i = 0; i < units_num; ++i) {
+        std::string name;
+        uint64_t fp;
+        if (!in.readString(name) || !in.read64(fp) || !in.read32(values_nums[i]))
+            return false;
+
+        auto it = units.byName.find(name);
+        if (it == units.byName.end())
+            continue;
+
+        mapping[i] = it->second;
+        const Units::Unit& unit = units.units[it->second];
+        if (unit.fingerprint == fp && unit.values.size() == values_nums[i]) {
+            unchanged[i] = true;
+            ++unchanged_num;
+        }
+    }
+
+    // the changed, new and removed units
+    size_t changed_num = units.units.size() + units_num - 2 * unchanged_num;
+    if (changed_num > max_changed * units.units.size())
+        return false;
+
+    uint32_t records_num;
+    if (!in.read32(records_num))
+        return false;
+
+    std::vector<SolutionRecord> records(records_num);
+    for (SolutionRecord& rec : records) {
+        uint32_t ptrs_num;
+        if (!in.read32(rec.unit) || !in.read32(rec.value)
+            || !in.read32(rec.kind) || !in.read32(ptrs_num)
+            || rec.unit >= units_num || rec.value >= values_nums[rec.unit]
+            || rec.kind > 1)
+            return false;
+
+        rec.pointers.resize(ptrs_num);
+        for (SolutionPointer& ptr : rec.pointers) {
+            if (!in.read32(ptr.unit) || !in.read32(ptr.value)
+                || !in.read64(ptr.offset))
+                return false;
+
+            if (ptr.unit != NULL_ID && ptr.unit != UNKNOWN_ID
+                && (ptr.unit >= units_num || ptr.value >= values_nums[ptr.unit]))
+                return false;
+        }
+    }
+
+    if (!in.atEnd())
+        return false;
+
+    // The analysis continues from the filled points-to sets until it
+    // reaches a fixpoint, so the results are sound whatever pointers we
+    // fill in. We fill in only the pointers of the values that did not
+    // change, so that the results stay nearly as precise as the results
+    // of the analysis from scratch. The calls via function pointers are
+    // not filled in, the analysis would not build the called subgraphs
+    for (const SolutionRecord& rec : records) {
+        if (!unchanged[rec.unit])
+            continue;
+
+        const llvm::Value *val = units.units[mapping[rec.unit]].values[rec.value];
+        PSNode *node = builder->getNode(val);
+        if (!node)
+            continue;
+
+        if (rec.kind == 1)
+            node = node->getPairedNode();
+        else if (node->getType() == PSNodeType::CALL_FUNCPTR)
+            continue;
+
+        if (!node)
+            continue;
+
+        for (const SolutionPointer& ptr : rec.pointers) {
+            if (ptr.unit == NULL_ID) {
+                node->addPointsTo(analysis::pta::PointerNull);
+                continue;
+            }
+            if (ptr.unit == UNKNOWN_ID) {
+                node->addPointsTo(analysis::pta::PointerUnknown);
+                continue;
+            }
+
+            // the function or the global itself is found
+            // even if it changed, its other values are not
+            if (mapping[ptr.unit] == NONE
+                || (ptr.value != 0 && !unchanged[ptr.unit]))
+                continue;
+
+            const Units::Unit& unit = units.units[mapping[ptr.unit]];
+            PSNode *target = getTarget(builder, unit.values[ptr.value]);
+            if (target)
+                node->addPointsTo(target, ptr.offset);
+        }
+    }
+
+    return true;
+}
+
+} // namespace dg
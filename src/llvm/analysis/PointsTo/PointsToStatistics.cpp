@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Value.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "PointsTo.h"
+#include "llvm/analysis/FunctionCosts.h"
+
+namespace dg {
+
+using analysis::pta::PSNodeType;
+using analysis::pta::PointerAnalysisStatistics;
+
+static const char *typeName(PSNodeType type)
+{
+#define ELEM(t) case PSNodeType::t: return #t;
+    switch (type) {
+        ELEM(ALLOC)
+        ELEM(DYN_ALLOC)
+        ELEM(LOAD)
+        ELEM(STORE)
+        ELEM(GEP)
+        ELEM(PHI)
+        ELEM(CAST)
+        ELEM(FUNCTION)
+        ELEM(CALL)
+        ELEM(CALL_FUNCPTR)
+        ELEM(CALL_RETURN)
+        ELEM(ENTRY)
+        ELEM(RETURN)
+        ELEM(CONSTANT)
+        ELEM(NOOP)
+        ELEM(MEMCPY)
+        ELEM(NULL_ADDR)
+        ELEM(UNKNOWN_MEM)
+        default:
+            return "unknown";
+    }
+#undef ELEM
+}
+
+static void printNode(llvm::raw_ostream& os, PSNode *node)
+{
+    const llvm::Value *val = node->getUserData<llvm::Value>();
+    if (!val) {
+        os << typeName(node->getType()) << " " << static_cast<void *>(node);
+        return;
+    }
+
+    if (llvm::isa<llvm::Function>(val)) {
+        os << val->getName();
+        return;
+    }
+
+    std::string str;
+    llvm::raw_string_ostream ss(str);
+    ss << *val;
+    ss.flush();
+
+    // crop long names
+    if (str.size() > 70)
+        str = str.substr(0, 70) + " ...";
+
+    os << str;
+}
+
+void LLVMPointerAnalysis::printStatistics(llvm::raw_ostream& os,
+                                          const PointerAnalysisStatistics& st,
+                                          size_t num)
+{
+    os << "PTA statistics:\n";
+    os << "  rounds: " << st.getRoundsNum() << "\n";
+    os << "  processed nodes: " << st.getProcessedNodes() << "\n";
+    if (st.topLevelSkipped > 0)
+        os << "  skipped top-level nodes: " << st.topLevelSkipped << "\n";
+
+    if (st.getRoundsNum() > 1) {
+        os << "  processed nodes in rounds:";
+        for (uint64_t n : st.processedInRound)
+            os << " " << n;
+        os << "\n";
+    }
+
+    os << "  memory objects: " << st.memoryObjectsNum << "\n";
+    if (st.collapsedTargetsNum > 0 || st.collapsedObjectsNum > 0) {
+        os << "  collapsed targets: " << st.collapsedTargetsNum << "\n";
+        os << "  collapsed memory objects: " << st.collapsedObjectsNum << "\n";
+    }
+
+    if (!st.types.empty()) {
+        os << "  node type         processed     changed   time (ms)\n";
+        for (const auto& it : st.types) {
+            os << "    " << llvm::format("%-14s", typeName(it.first))
+               << llvm::format("%12lu", it.second.processed)
+               << llvm::format("%12lu", it.second.changed)
+               << llvm::format("%12.3f", it.second.time / 1000000.0) << "\n";
+        }
+    }
+
+    printFunctionCosts(os, st.nodes, builder->getNodesFunctions(), num);
+
+    auto most = st.getMostProcessed(num);
+    if (!most.empty()) {
+        os << "  the most processed nodes:\n";
+        for (const auto& it : most) {
+            os << llvm::format("%10lu", it.second) << "  ";
+            printNode(os, it.first);
+            os << "\n";
+        }
+    }
+
+    const std::vector<PSNode *>& nodes = getNodes();
+    std::vector<PSNode *> largest(nodes.begin(), nodes.end());
+    num = std::min(num, largest.size());
+    std::partial_sort(largest.begin(), largest.begin() + num, largest.end(),
+                      [](PSNode *a, PSNode *b) {
+                          return a->pointsTo.size() > b->pointsTo.size();
+                      });
+    largest.resize(num);
+
+    if (!largest.empty()) {
+        os << "  the largest points-to sets:\n";
+        for (PSNode *n : largest) {
+            os << llvm::format("%10lu", n->pointsTo.size()) << "  ";
+            printNode(os, n);
+            os << "\n";
+        }
+    }
+}
+
+void LLVMPointerAnalysis::getMemoryUsage(analysis::MemoryUsage& mu)
+{
+    for (PSNode *n : getNodes()) {
+        mu.add("nodes", 1, sizeof(PSNode) + n->getEdgesAllocatedBytes()
+                           + n->getPayloadAllocatedBytes());
+        mu.add("points-to sets", n->pointsTo.size(),
+               n->pointsTo.getAllocatedBytes());
+    }
+
+    if (demand) {
+        demand->getMemoryUsage(mu);
+        return;
+    }
+
+    for (const auto& e : runMemoryUsage.entries)
+        mu.add(e.name, e.count, e.bytes);
+}
+
+} // namespace dg
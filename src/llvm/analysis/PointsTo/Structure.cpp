@@ -252,6 +252,50 @@ void LLVMPointerSubgraphBuilder::addProgramStructure(const llvm::Function *F,
     subg.has_structure = true;
 }
 
+std::vector<PSNode *>
+LLVMPointerSubgraphBuilder::getFunctionNodes(const llvm::Function *F) const
+{
+    std::vector<PSNode *> nodes;
+    auto it = subgraphs_map.find(F);
+    if (it == subgraphs_map.end() || !it->second.root)
+        return nodes;
+
+    const Subgraph& subg = it->second;
+    std::set<PSNode *> visited;
+    std::vector<PSNode *> stack;
+    visited.insert(subg.root);
+    stack.push_back(subg.root);
+
+    auto push = [&visited, &stack](PSNode *n) {
+        if (visited.insert(n).second)
+            stack.push_back(n);
+    };
+
+    while (!stack.empty()) {
+        PSNode *cur = stack.back();
+        stack.pop_back();
+        nodes.push_back(cur);
+
+        // the unified return node is the last node of the function
+        if (cur == subg.ret)
+            continue;
+
+        // do not go into the called functions,
+        // continue from the return site
+        if ((cur->getType() == PSNodeType::CALL
+             || cur->getType() == PSNodeType::CALL_FUNCPTR)
+            && cur->getPairedNode()) {
+            push(cur->getPairedNode());
+            continue;
+        }
+
+        for (PSNode *succ : cur->getSuccessors())
+            push(succ);
+    }
+
+    return nodes;
+}
+
 } // namespace pta
 } // namespace analysis
 } // namespace dg
@@ -0,0 +1,143 @@
+#include <set>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "analysis/PointsTo/PointsToFlowInsensitive.h"
+#include "analysis/PointsTo/PointsToFlowSensitiveRegion.h"
+#include "PointsTo.h"
+
+namespace dg {
+
+using analysis::pta::PSNodeType;
+using analysis::pta::Pointer;
+
+// can the flow-sensitive analysis give better results for the nodes
+// of a function than the flow-insensitive one? Only if a load
+// of more pointers reads the memory that is written in the function
+// (a store may overwrite it). The memory written in other functions
+// comes into the region as it is in the flow-insensitive results
+static bool needsFlowSensitivity(const std::vector<PSNode *>& nodes)
+{
+    std::set<PSNode *> stored;
+    for (PSNode *n : nodes) {
+        if (n->getType() != PSNodeType::STORE)
+            continue;
+
+        for (const Pointer& ptr : n->getOperand(1)->pointsTo) {
+            if (ptr.isValid())
+                stored.insert(ptr.target);
+        }
+    }
+
+    if (stored.empty())
+        return false;
+
+    for (PSNode *n : nodes) {
+        if (n->getType() != PSNodeType::LOAD || n->pointsTo.size() < 2)
+            continue;
+
+        for (const Pointer& ptr : n->getOperand(0)->pointsTo) {
+            if (ptr.isValid() && stored.count(ptr.target) > 0)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+void LLVMPointerAnalysis::runTiered(const std::vector<const llvm::Function *>& relevant)
+{
+    using namespace analysis::pta;
+
+    assert(PS && "Incorrectly constructed PTA, missing PS");
+    {
+        analysis::Profiler::Scope phase("Building the pointer subgraph");
+        PS->setRoot(builder->buildLLVMPointerSubgraph());
+        analysis::Profiler::count("pointer subgraph nodes",
+                                  builder->getNodesNum());
+    }
+
+    analysis::Profiler::Scope phase("Solving points-to (tiered)");
+    degradation = Degradation::NONE;
+    LLVMPointerAnalysisImpl<PointsToFlowInsensitive> FI(PS, builder);
+    FI.setSchedule(schedule);
+    FI.setThreads(threads);
+    FI.setOffsetsBudget(offsets_budget);
+    FI.setWideningDelay(widening_delay);
+    FI.setSaturateUnknown(saturate_unknown);
+    FI.setBudget(budget);
+    FI.collectStatistics(statistics.enabled);
+    FI.run();
+
+    if (FI.isBudgetExceeded()) {
+        degradeToUnknown();
+        degradation = Degradation::UNKNOWN;
+        statistics = FI.getStatistics();
+        return;
+    }
+
+    std::vector<const llvm::Function *> funcs(relevant);
+    if (funcs.empty()) {
+        for (const llvm::Function& F : *M) {
+            if (!F.isDeclaration())
+                funcs.push_back(&F);
+        }
+    }
+
+    std::vector<PSNode *> region;
+    size_t selected = 0;
+    for (const llvm::Function *F : funcs) {
+        std::vector<PSNode *> nodes = builder->getFunctionNodes(F);
+        if (!needsFlowSensitivity(nodes))
+            continue;
+
+        region.insert(region.end(), nodes.begin(), nodes.end());
+        ++selected;
+    }
+
+    analysis::Profiler::count("flow-sensitive functions", selected);
+    analysis::Profiler::count("flow-sensitive nodes", region.size());
+
+    if (!region.empty()) {
+        PointsToFlowSensitiveRegion FS(PS, &FI, region);
+        FS.setOffsetsBudget(offsets_budget);
+        FS.setWideningDelay(widening_delay);
+        FS.setSaturateUnknown(saturate_unknown);
+        FS.setBudget(budget);
+        FS.run();
+
+        // the nodes outside of the region keep the sound
+        // flow-insensitive results
+        if (FS.isBudgetExceeded()) {
+            degradeToUnknown(&region);
+            degradation = Degradation::UNKNOWN;
+        }
+    }
+
+    if (share_sets)
+        FI.sharePointsToSets();
+
+    statistics = FI.getStatistics();
+    runMemoryUsage = analysis::MemoryUsage();
+    if (statistics.enabled)
+        FI.getMemoryUsage(runMemoryUsage);
+}
+
+} // namespace dg
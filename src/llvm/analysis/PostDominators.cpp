@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
 #pragma clang diagnostic push
@@ -8,7 +12,6 @@
 #endif
 
 #include <llvm/IR/Function.h>
-#include <llvm/Analysis/PostDominators.h>
 
 #if (__clang__)
 #pragma clang diagnostic pop // ignore -Wunused-parameter
@@ -16,97 +19,136 @@
 #pragma GCC diagnostic pop
 #endif
 
-#include "analysis/BFS.h"
-#include "analysis/PostDominanceFrontiers.h"
+#include "analysis/ControlDependence.h"
+#include "analysis/Parallel.h"
 
 #include "llvm/LLVMDependenceGraph.h"
+#include "llvm/ControlDependenceCache.h"
 
 namespace dg {
 
-void LLVMDependenceGraph::computePostDominators(bool addPostDomFrontiers)
+// FNV-1a of the shape of the CFG: the number of blocks
+// and the (sorted) successors of every block
+static uint64_t hashCFG(const std::vector<LLVMBBlock *>& blocks,
+                        const std::unordered_map<LLVMBBlock *, uint32_t>& ids)
 {
-    using namespace llvm;
-    // iterate over all functions
-    for (auto& F : getConstructedFunctions()) {
-        analysis::PostDominanceFrontiers<LLVMNode> pdfrontiers;
-
-        // root of post-dominator tree
-        LLVMBBlock *root = nullptr;
-        Value *val = const_cast<Value *>(F.first);
-        Function& f = *cast<Function>(val);
-        PostDominatorTree *pdtree;
-
-#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 9))
-        pdtree = new PostDominatorTree();
-        // compute post-dominator tree for this function
-        pdtree->runOnFunction(f);
-#else
-        PostDominatorTreeAnalysis PDT;
-        FunctionAnalysisManager DummyFAM;
-        pdtree = new PostDominatorTree(PDT.run(f, DummyFAM));
-#endif
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](uint32_t v) {
+        for (unsigned i = 0; i < 4; ++i) {
+            hash ^= (v >> (8 * i)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
 
-        // add immediate post-dominator edges
-        auto& our_blocks = F.second->getBlocks();
-        bool built = false;
-        for (auto& it : our_blocks) {
-            LLVMBBlock *BB = it.second;
-            BasicBlock *B = cast<BasicBlock>(const_cast<Value *>(it.first));
-            DomTreeNode *N = pdtree->getNode(B);
-            // when function contains infinite loop, we're screwed
-            // and we don't have anything
-            // FIXME: just check for the root,
-            // don't iterate over all blocks, stupid...
-            if (!N)
-                continue;
-
-            DomTreeNode *idom = N->getIDom();
-            BasicBlock *idomBB = idom ? idom->getBlock() : nullptr;
-            built = true;
-
-            if (idomBB) {
-                LLVMBBlock *pb = our_blocks[idomBB];
-                assert(pb && "Do not have constructed BB");
-                BB->setIPostDom(pb);
-                assert(cast<BasicBlock>(BB->getKey())->getParent()
-                        == cast<BasicBlock>(pb->getKey())->getParent()
-                        && "BBs are from diferent functions");
-            // if we do not have idomBB, then the idomBB is a root BB
-            } else {
-                // PostDominatorTree may has special root without BB set
-                // or it is the node without immediate post-dominator
-                if (!root) {
-                    root = new LLVMBBlock();
-                    root->setKey(nullptr);
-                    F.second->setPostDominatorTreeRoot(root);
-                }
+    add(blocks.size());
+    std::vector<uint32_t> succs;
+    for (LLVMBBlock *BB : blocks) {
+        succs.clear();
+        for (const auto& succ : BB->successors())
+            succs.push_back(ids.find(succ.target)->second);
+
+        std::sort(succs.begin(), succs.end());
+        succs.erase(std::unique(succs.begin(), succs.end()), succs.end());
+
+        add(succs.size());
+        for (uint32_t s : succs)
+            add(s);
+    }
+
+    return hash;
+}
+
+void LLVMDependenceGraph::computeFunctionPostDominators(bool addPostDomFrontiers)
+{
+    // the blocks in the order of the function, so that the results
+    // do not depend on the addresses of the blocks. The returns
+    // have an edge to the unified exit block, so it is there too
+    std::vector<LLVMBBlock *> blocks;
+    std::unordered_map<LLVMBBlock *, uint32_t> ids;
+    auto addBlock = [&](LLVMBBlock *BB) {
+        if (BB && ids.emplace(BB, blocks.size()).second)
+            blocks.push_back(BB);
+    };
+
+    const auto& our_blocks = getBlocks();
+    llvm::Function *func = llvm::cast<llvm::Function>(getEntry()->getValue());
+    for (llvm::BasicBlock& B : *func) {
+        auto it = our_blocks.find(&B);
+        if (it != our_blocks.end())
+            addBlock(it->second);
+    }
 
-                BB->setIPostDom(root);
+    if (blocks.empty())
+        return;
+
+    addBlock(getExitBB());
+
+    // root of post-dominator tree, it stands for the virtual
+    // exit node to which all the returns (and infinite loops) go
+    LLVMBBlock *root = new LLVMBBlock();
+    root->setKey(nullptr);
+    setPostDominatorTreeRoot(root);
+
+    uint64_t hash = 0;
+    ControlDependenceCache::Entry entry;
+    if (cd_cache) {
+        hash = hashCFG(blocks, ids);
+        if (cd_cache->get(hash, entry) && entry.ipdoms.size() == blocks.size()) {
+            for (uint32_t i = 0; i < blocks.size(); ++i) {
+                uint32_t ipdom = entry.ipdoms[i];
+                blocks[i]->setIPostDom(ipdom == ControlDependenceCache::ROOT
+                                       ? root : blocks[ipdom]);
             }
-        }
 
-        // well, if we haven't built the pdtree, this is probably infinite loop
-        // that has no pdtree. Until we have anything better, just add sound control
-        // edges that are not so precise - to predecessors.
-        if (!built && addPostDomFrontiers) {
-            for (auto& it : our_blocks) {
-                LLVMBBlock *BB = it.second;
-                for (const LLVMBBlock::BBlockEdge& succ : BB->successors()) {
-                    // in this case we add only the control dependencies,
-                    // since we have no pd frontiers
-                    BB->addControlDependence(succ.target);
+            if (addPostDomFrontiers) {
+                for (const auto& edge : entry.cds) {
+                    blocks[edge.first]->addControlDependence(blocks[edge.second]);
+                    blocks[edge.second]->addPostDomFrontier(blocks[edge.first]);
                 }
             }
-        }
 
-        if (addPostDomFrontiers) {
-            // assert(root && "BUG: must have root");
-            if (root)
-                pdfrontiers.compute(root, true /* store also control depend. */);
+            return;
         }
+    }
+
+    analysis::ControlDependence<LLVMNode> cd;
+    cd.compute(blocks);
+    cd.store(root, addPostDomFrontiers);
 
-        delete pdtree;
+    // without the control dependencies the entry would be incomplete
+    if (!cd_cache || !addPostDomFrontiers)
+        return;
+
+    entry.ipdoms.clear();
+    entry.cds.clear();
+    for (uint32_t i = 0; i < blocks.size(); ++i) {
+        LLVMBBlock *ipdom = blocks[i]->getIPostDom();
+        entry.ipdoms.push_back(ipdom == root ? ControlDependenceCache::ROOT
+                                             : ids.find(ipdom)->second);
+
+        for (LLVMBBlock *dep : blocks[i]->controlDependence())
+            entry.cds.emplace_back(i, ids.find(dep)->second);
     }
+
+    std::sort(entry.cds.begin(), entry.cds.end());
+    cd_cache->add(hash, std::move(entry));
+}
+
+void LLVMDependenceGraph::computePostDominators(bool addPostDomFrontiers)
+{
+    std::vector<LLVMDependenceGraph *> graphs;
+    for (auto& F : getConstructedFunctions())
+        graphs.push_back(F.second);
+
+    // the functions are independent, the only shared thing
+    // is the pool from which the roots are allocated
+    LLVMBBlock::setConcurrent(build_threads > 1);
+
+    analysis::parallelFor(graphs.size(), build_threads, [&](size_t i, unsigned) {
+        graphs[i]->computeFunctionPostDominators(addPostDomFrontiers);
+    });
+
+    LLVMBBlock::setConcurrent(false);
 }
 
 } // namespace dg
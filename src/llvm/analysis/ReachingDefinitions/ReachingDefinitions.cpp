@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <set>
 #include <cassert>
 
@@ -43,103 +44,21 @@ namespace dg {
 namespace analysis {
 namespace rd {
 
-static uint64_t getAllocatedSize(llvm::Type *Ty, const llvm::DataLayout *DL)
-{
-    // Type can be i8 *null or similar
-    if (!Ty->isSized())
-            return 0;
-
-    return DL->getTypeAllocSize(Ty);
-}
-
-// FIXME: don't duplicate the code (with PSS.cpp)
-static uint64_t getConstantValue(const llvm::Value *op)
-{
-    using namespace llvm;
-
-    uint64_t size = 0;
-    if (const ConstantInt *C = dyn_cast<ConstantInt>(op)) {
-        size = C->getLimitedValue();
-        // if the size cannot be expressed as an uint64_t,
-        // just set it to 0 (that means unknown)
-        if (size == ~((uint64_t) 0))
-            size = 0;
-    }
-
-    return size;
-}
-
-enum MemAllocationFuncs {
-    NONEMEM = 0,
-    MALLOC,
-    CALLOC,
-    ALLOCA,
-    REALLOC,
-};
-
-static int getMemAllocationFunc(const llvm::Function *func)
-{
-    if (!func || !func->hasName())
-        return NONEMEM;
-
-    const char *name = func->getName().data();
-    if (strcmp(name, "malloc") == 0)
-        return MALLOC;
-    else if (strcmp(name, "calloc") == 0)
-        return CALLOC;
-    else if (strcmp(name, "alloca") == 0)
-        return ALLOCA;
-    else if (strcmp(name, "realloc") == 0)
-        return REALLOC;
-
-    return NONEMEM;
-}
-
-
 LLVMRDBuilder::~LLVMRDBuilder() {
     // delete data layout
     delete DL;
 
-    // delete artificial nodes from subgraphs
-    for (auto& it : subgraphs_map) {
-        assert((it.second.root && it.second.ret) ||
-               (!it.second.root && !it.second.ret));
-        delete it.second.root;
-        delete it.second.ret;
-    }
-
-    // delete nodes
-    for (auto& it : nodes_map) {
-        assert(it.first && "Have a nullptr node mapping");
-        delete it.second;
-    }
-
-    // delete dummy nodes
-    for (RDNode *nd : dummy_nodes)
-        delete nd;
-}
-
-static uint64_t getAllocatedSize(const llvm::AllocaInst *AI,
-                                 const llvm::DataLayout *DL)
-{
-    llvm::Type *Ty = AI->getAllocatedType();
-    if (!Ty->isSized())
-            return 0;
-
-    if (AI->isArrayAllocation())
-        return getConstantValue(AI->getArraySize()) * DL->getTypeAllocSize(Ty);
-    else
-        return DL->getTypeAllocSize(Ty);
+    // the nodes are freed by the arena
 }
 
 RDNode *LLVMRDBuilder::createAlloc(const llvm::Instruction *Inst)
 {
-    RDNode *node = new RDNode(ALLOC);
+    RDNode *node = newNode(ALLOC);
     addNode(Inst, node);
 
     if (const llvm::AllocaInst *AI
             = llvm::dyn_cast<llvm::AllocaInst>(Inst))
-        node->setSize(getAllocatedSize(AI, DL));
+        node->setSize(info->getAllocatedSize(AI));
 
     return node;
 }
@@ -148,7 +67,7 @@ RDNode *LLVMRDBuilder::createDynAlloc(const llvm::Instruction *Inst, int type)
 {
     using namespace llvm;
 
-    RDNode *node = new RDNode(DYN_ALLOC);
+    RDNode *node = newNode(DYN_ALLOC);
     addNode(Inst, node);
 
     const CallInst *CInst = cast<CallInst>(Inst);
@@ -171,11 +90,11 @@ RDNode *LLVMRDBuilder::createDynAlloc(const llvm::Instruction *Inst, int type)
     };
 
     // infer allocated size
-    size = getConstantValue(op);
+    size = LLVMModuleInfo::getConstantValue(op);
     if (size != 0 && type == CALLOC) {
         // if this is call to calloc, the size is given
         // in the first argument too
-        size2 = getConstantValue(CInst->getOperand(0));
+        size2 = LLVMModuleInfo::getConstantValue(CInst->getOperand(0));
         if (size2 != 0)
             size *= size2;
     }
@@ -186,10 +105,10 @@ RDNode *LLVMRDBuilder::createDynAlloc(const llvm::Instruction *Inst, int type)
 
 RDNode *LLVMRDBuilder::createRealloc(const llvm::Instruction *Inst)
 {
-    RDNode *node = new RDNode(DYN_ALLOC);
+    RDNode *node = newNode(DYN_ALLOC);
     addNode(Inst, node);
 
-    uint64_t size = getConstantValue(Inst->getOperand(1));
+    uint64_t size = LLVMModuleInfo::getConstantValue(Inst->getOperand(1));
     if (size == 0)
         size = UNKNOWN_OFFSET;
     else
@@ -239,7 +158,7 @@ static void getLocalVariables(const llvm::Function *F,
 
 RDNode *LLVMRDBuilder::createReturn(const llvm::Instruction *Inst)
 {
-    RDNode *node = new RDNode(RETURN);
+    RDNode *node = newNode(RETURN);
     addNode(Inst, node);
 
     // FIXME: don't do that for every return instruction,
@@ -269,8 +188,15 @@ RDNode *LLVMRDBuilder::createReturn(const llvm::Instruction *Inst)
 RDNode *LLVMRDBuilder::getOperand(const llvm::Value *val)
 {
     RDNode *op = getNode(val);
-    if (!op)
-        return createNode(*llvm::cast<llvm::Instruction>(val));
+    if (!op) {
+        // the node belongs to the function of the instruction,
+        // not to the function that we are building now
+        const llvm::Instruction *Inst = llvm::cast<llvm::Instruction>(val);
+        const llvm::Function *prev = building;
+        building = Inst->getParent()->getParent();
+        op = createNode(*Inst);
+        building = prev;
+    }
 
     return op;
 }
@@ -298,7 +224,7 @@ RDNode *LLVMRDBuilder::createNode(const llvm::Instruction &Inst)
 
 RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
 {
-    RDNode *node = new RDNode(STORE);
+    RDNode *node = newNode(STORE);
     addNode(Inst, node);
 
     pta::PSNode *pts = PTA->getPointsTo(Inst->getOperand(1));
@@ -353,7 +279,7 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
         if (ptr.offset.isUnknown()) {
             size = UNKNOWN_OFFSET;
         } else {
-            size = getAllocatedSize(Inst->getOperand(0)->getType(), DL);
+            size = info->getAllocatedSize(Inst->getOperand(0)->getType());
             if (size == 0)
                 size = UNKNOWN_OFFSET;
         }
@@ -361,9 +287,11 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
         //llvm::errs() << *Inst << " DEFS >> " << ptr.target->getName() << " ["
         //             << *ptr.offset << " - " << *ptr.offset + size - 1 << "\n";
 
-        // strong update is possible only with must aliases. Also we can not
-        // be pointing to heap, because then we don't know which object it
-        // is in run-time, like:
+        // strong update is possible only with must aliases. Also the target
+        // must have a single instance: if the memory is allocated
+        // in a loop or in a function that runs more times (on heap,
+        // or on stack in a recursive function), we don't know which
+        // object it is in run-time, like:
         //  void *foo(int a)
         //  {
         //      void *mem = malloc(...)
@@ -377,7 +305,8 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
         //  If we would do strong update on line 2 (which we would, since
         //  there we have must alias for the malloc), we would loose the
         //  definitions for line 1 and we would get incorrect results
-        bool strong_update = pts->pointsTo.size() == 1 && !pts->isHeap();
+        bool strong_update = pts->pointsTo.size() == 1
+                             && instances.isSingleInstance(ptrVal);
         node->addDef(ptrNode, ptr.offset, size, strong_update);
     }
 
@@ -385,7 +314,191 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
     return node;
 }
 
-static bool isRelevantCall(const llvm::Instruction *Inst)
+// the store to a promoted alloca. The node is not in the graph,
+// it only says what the store defines (see computeLocalDefinitions())
+RDNode *LLVMRDBuilder::createLocalStore(const llvm::Instruction *Inst)
+{
+    RDNode *node = nodes_arena.create(STORE);
+    addNode(Inst, node);
+    if (building)
+        functions[building].locals.push_back(node);
+
+    RDNode *target = getOperand(Inst->getOperand(1));
+    uint64_t size = target->getSize();
+    node->addDef(target, 0, size == 0 ? UNKNOWN_OFFSET : size,
+                 true /* strong update */);
+
+    return node;
+}
+
+// the memory accessed by the load or the store @Inst
+static const llvm::Value *getAccessedMemory(const llvm::Instruction *Inst)
+{
+    if (const llvm::LoadInst *LI = llvm::dyn_cast<llvm::LoadInst>(Inst))
+        return LI->getPointerOperand();
+    if (const llvm::StoreInst *SI = llvm::dyn_cast<llvm::StoreInst>(Inst))
+        return SI->getPointerOperand();
+
+    return nullptr;
+}
+
+// is @Inst a load or a store of a promoted alloca?
+bool LLVMRDBuilder::isPromoted(const llvm::Instruction *Inst) const
+{
+    const llvm::Value *mem = getAccessedMemory(Inst);
+    return mem && promoted.count(mem) > 0;
+}
+
+// is the alloca used only by the loads and the stores of the whole
+// memory? Then its address is not taken, nothing else can touch it
+// and every store overwrites all of it
+static bool isPromotable(const llvm::AllocaInst *AI)
+{
+    using namespace llvm;
+
+    if (AI->isArrayAllocation())
+        return false;
+
+    const Type *Ty = AI->getAllocatedType();
+    for (auto I = AI->use_begin(), E = AI->use_end(); I != E; ++I) {
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+        const llvm::Value *use = *I;
+#else
+        const llvm::Value *use = I->getUser();
+#endif
+        if (const LoadInst *LI = dyn_cast<LoadInst>(use)) {
+            if (!LI->isSimple() || LI->getType() != Ty)
+                return false;
+
+            continue;
+        }
+
+        // the alloca must not be the stored value
+        const StoreInst *SI = dyn_cast<StoreInst>(use);
+        if (!SI || !SI->isSimple() || SI->getValueOperand() == AI
+            || SI->getValueOperand()->getType() != Ty)
+            return false;
+    }
+
+    return true;
+}
+
+void LLVMRDBuilder::findPromotable(const llvm::Function& F)
+{
+    if (!promote_locals)
+        return;
+
+    for (const llvm::BasicBlock& block : F) {
+        for (const llvm::Instruction& Inst : block) {
+            const llvm::AllocaInst *AI = llvm::dyn_cast<llvm::AllocaInst>(&Inst);
+            if (AI && isPromotable(AI))
+                promoted.insert(AI);
+        }
+    }
+}
+
+// Compute the definitions of the loads of the promoted allocas in @F.
+// Only the loads and stores in @F touch the allocas, so the definitions
+// do not leave @F and a store kills all the previous ones. A load gets
+// the last store before it in its block or the last stores of the blocks
+// from which the block is reachable without passing another store
+void LLVMRDBuilder::computeLocalDefinitions(const llvm::Function& F)
+{
+    using namespace llvm;
+
+    std::unordered_map<const BasicBlock *, unsigned> index;
+    std::vector<const BasicBlock *> blocks;
+    // the loads and stores of every promoted alloca in the order of blocks
+    std::map<const Value *, std::vector<const Instruction *>> accesses;
+    for (const BasicBlock& block : F) {
+        index.emplace(&block, blocks.size());
+        blocks.push_back(&block);
+        for (const Instruction& Inst : block) {
+            if (isPromoted(&Inst))
+                accesses[getAccessedMemory(&Inst)].push_back(&Inst);
+        }
+    }
+
+    auto idLess = [](const RDNode *a, const RDNode *b) {
+        return a->getID() < b->getID();
+    };
+
+    // the last store of every block and the stores that
+    // reach the beginning of every block
+    std::vector<RDNode *> last(blocks.size());
+    std::vector<std::vector<RDNode *>> in(blocks.size());
+    std::vector<const Instruction *> waiting;
+    std::vector<unsigned> worklist;
+    std::vector<bool> queued(blocks.size());
+    std::vector<RDNode *> defs;
+
+    for (const auto& it : accesses) {
+        std::fill(last.begin(), last.end(), nullptr);
+        waiting.clear();
+
+        for (const Instruction *Inst : it.second) {
+            unsigned b = index[Inst->getParent()];
+            if (isa<StoreInst>(Inst))
+                last[b] = getNode(Inst);
+            else if (last[b])
+                local_defs[Inst] = {last[b]};
+            else
+                // the definitions come from the predecessors
+                waiting.push_back(Inst);
+        }
+
+        if (waiting.empty())
+            continue;
+
+        for (auto& v : in)
+            v.clear();
+
+        worklist.clear();
+        for (unsigned b = blocks.size(); b > 0; --b)
+            worklist.push_back(b - 1);
+        std::fill(queued.begin(), queued.end(), true);
+
+        while (!worklist.empty()) {
+            unsigned b = worklist.back();
+            worklist.pop_back();
+            queued[b] = false;
+
+            defs.clear();
+            for (auto P = pred_begin(blocks[b]), PE = pred_end(blocks[b]);
+                 P != PE; ++P) {
+                unsigned p = index[*P];
+                if (last[p])
+                    defs.push_back(last[p]);
+                else
+                    defs.insert(defs.end(), in[p].begin(), in[p].end());
+            }
+
+            std::sort(defs.begin(), defs.end(), idLess);
+            defs.erase(std::unique(defs.begin(), defs.end()), defs.end());
+            if (defs == in[b])
+                continue;
+
+            in[b].swap(defs);
+            // the store at the end of the block hides the change
+            if (last[b])
+                continue;
+
+            for (auto S = succ_begin(blocks[b]), SE = succ_end(blocks[b]);
+                 S != SE; ++S) {
+                unsigned s = index[*S];
+                if (!queued[s]) {
+                    queued[s] = true;
+                    worklist.push_back(s);
+                }
+            }
+        }
+
+        for (const Instruction *Inst : waiting)
+            local_defs[Inst] = in[index[Inst->getParent()]];
+    }
+}
+
+static bool isRelevantCall(const llvm::Instruction *Inst, LLVMModuleInfo& info)
 {
     using namespace llvm;
 
@@ -401,8 +514,8 @@ static bool isRelevantCall(const llvm::Instruction *Inst)
         // function pointer call - we need that
         return true;
 
-    if (func->size() == 0) {
-        if (getMemAllocationFunc(func))
+    if (!info.isDefined(func)) {
+        if (info.getMemAllocationFunc(func))
             // we need memory allocations
             return true;
 
@@ -428,6 +541,27 @@ static bool isRelevantCall(const llvm::Instruction *Inst)
     assert(0 && "We should not reach this");
 }
 
+// Add the store @store to the end of the run of stores summarized
+// by @summary. The stores are not in the graph, @summary defines
+// (and overwrites) everything that the stores do and its map
+// is the map that we would get at the last store of the run.
+// The definitions in the map are still the single stores.
+void LLVMRDBuilder::addToSummary(RDNode *summary, RDNode *store)
+{
+    summary->defs.insert(store->defs.begin(), store->defs.end());
+    summary->overwrites.insert(store->overwrites.begin(),
+                               store->overwrites.end());
+
+    // the definitions from the store itself and the definitions from
+    // the previous stores that the store does not overwrite
+    RDMap map = store->def_map;
+    map.merge(&summary->def_map, store->getOverwritesIndex());
+    summary->def_map = map;
+
+    // nobody queries the map of the store
+    store->def_map = RDMap();
+}
+
 // return first and last nodes of the block
 std::pair<RDNode *, RDNode *>
 LLVMRDBuilder::buildBlock(const llvm::BasicBlock& block)
@@ -436,13 +570,55 @@ LLVMRDBuilder::buildBlock(const llvm::BasicBlock& block)
 
     // the first node is dummy and serves as a phi from previous
     // blocks so that we can have proper mapping
-    RDNode *node = new RDNode(PHI);
+    RDNode *node = newNode(PHI);
     RDNode *last_node = node;
 
-    addNode(node);
     std::pair<RDNode *, RDNode *> ret(node, nullptr);
 
+    // in the coarse mode, the node that summarizes
+    // the current run of stores (if any)
+    RDNode *summary = nullptr;
+
     for (const Instruction& Inst : block) {
+        // the stores to the promoted allocas are not in the graph
+        if (isa<StoreInst>(&Inst) && isPromoted(&Inst)) {
+            if (!getNode(&Inst))
+                createLocalStore(&Inst);
+
+            addMapping(&Inst, last_node);
+            continue;
+        }
+
+        if (coarse) {
+            if (isa<StoreInst>(&Inst)) {
+                if (!summary) {
+                    summary = newNode(STORE);
+                    last_node->addSuccessor(summary);
+                    last_node = summary;
+                }
+
+                addToSummary(summary, createStore(&Inst));
+                addMapping(&Inst, summary);
+                continue;
+            }
+
+            // allocas are needed only as the targets of def-sites,
+            // they do not need to be in the graph
+            if (isa<AllocaInst>(&Inst)) {
+                if (!getNode(&Inst))
+                    createAlloc(&Inst);
+
+                addMapping(&Inst, last_node);
+                continue;
+            }
+
+            // the instructions that read memory query the reaching
+            // definitions, so they must not see the stores after them
+            // (the loads of the promoted allocas do not query the graph)
+            if (Inst.mayReadFromMemory() && !isPromoted(&Inst))
+                summary = nullptr;
+        }
+
         node = getNode(&Inst);
         if (!node) {
            switch(Inst.getOpcode()) {
@@ -461,7 +637,7 @@ LLVMRDBuilder::buildBlock(const llvm::BasicBlock& block)
                     node = createReturn(&Inst);
                     break;
                 case Instruction::Call:
-                    if (!isRelevantCall(&Inst))
+                    if (!isRelevantCall(&Inst, *info))
                         break;
 
                     std::pair<RDNode *, RDNode *> subg = createCall(&Inst);
@@ -484,6 +660,9 @@ LLVMRDBuilder::buildBlock(const llvm::BasicBlock& block)
             last_node = node;
         }
 
+        if (last_node != summary)
+            summary = nullptr;
+
         // reaching definitions for this Inst are contained
         // in the last created node
         addMapping(&Inst, last_node);
@@ -528,12 +707,8 @@ LLVMRDBuilder::createCallToFunction(const llvm::Function *F)
     RDNode *callNode, *returnNode;
 
     // dummy nodes for easy generation
-    callNode = new RDNode(CALL);
-    returnNode = new RDNode(CALL_RETURN);
-
-    // do not leak the memory of returnNode (the callNode
-    // will be added to nodes_map)
-    addNode(returnNode);
+    callNode = newNode(CALL);
+    returnNode = newNode(CALL_RETURN);
 
     // FIXME: if this is an inline assembly call
     // we need to make conservative assumptions
@@ -561,24 +736,52 @@ LLVMRDBuilder::createCallToFunction(const llvm::Function *F)
     callNode->addSuccessor(root);
     ret->addSuccessor(returnNode);
 
+    if (summaries) {
+        // the definitions of the caller go around the function
+        // and only the definitions of the function come from ret
+        callNode->addSuccessor(returnNode);
+        RDSummary& summary = summaries_map[F];
+        summary.ret = ret;
+        returnNode->setSummary(&summary);
+    }
+
+    if (building)
+        callees[building].insert(F);
+
     return std::make_pair(callNode, returnNode);
 }
 
 std::pair<RDNode *, RDNode *>
 LLVMRDBuilder::buildFunction(const llvm::Function& F)
 {
-    // here we'll keep first and last nodes of every built block and
-    // connected together according to successors
-    std::map<const llvm::BasicBlock *, std::pair<RDNode *, RDNode *>> built_blocks;
-
     // create root and (unified) return nodes of this subgraph. These are
     // just for our convenience when building the graph, they can be
-    // optimized away later since they are noops
-    RDNode *root = new RDNode(NOOP);
-    RDNode *ret = new RDNode(NOOP);
+    // optimized away later since they are noops. They stay when
+    // the function is rebuilt, so they are not among the nodes of F
+    RDNode *root = createNode(NOOP);
+    RDNode *ret = createNode(NOOP);
 
     // emplace new subgraph to avoid looping with recursive functions
     subgraphs_map.emplace(&F, Subgraph(root, ret));
+    procedures.emplace(&F, procedures.size() + 1);
+
+    const llvm::Function *prev = building;
+    building = &F;
+    buildFunctionBody(F, root, ret);
+    building = prev;
+
+    return {root, ret};
+}
+
+void LLVMRDBuilder::buildFunctionBody(const llvm::Function& F,
+                                      RDNode *root, RDNode *ret)
+{
+    // the stores of the promoted allocas are left out of the blocks
+    findPromotable(F);
+
+    // here we'll keep first and last nodes of every built block and
+    // connected together according to successors
+    std::map<const llvm::BasicBlock *, std::pair<RDNode *, RDNode *>> built_blocks;
 
     RDNode *first = nullptr;
     for (const llvm::BasicBlock& block : F) {
@@ -618,14 +821,146 @@ LLVMRDBuilder::buildFunction(const llvm::Function& F)
     for (RDNode *r : rets)
         r->addSuccessor(ret);
 
-    return {root, ret};
+    computeLocalDefinitions(F);
+}
+
+std::vector<RDNode *> LLVMRDBuilder::rebuildFunction(const llvm::Function& F)
+{
+    assert(!coarse && "Rebuilding functions is not supported in coarse mode");
+    assert(!summaries && "Rebuilding functions is not supported with summaries");
+
+    auto sit = subgraphs_map.find(&F);
+    // the function is not called, there is nothing to rebuild
+    if (sit == subgraphs_map.end())
+        return {};
+
+    RDNode *root = sit->second.root;
+    RDNode *ret = sit->second.ret;
+
+    // the calls and loops may have changed
+    instances.clear();
+
+    FunctionNodes old;
+    old.nodes.swap(functions[&F].nodes);
+    old.mapped.swap(functions[&F].mapped);
+    old.locals.swap(functions[&F].locals);
+
+    std::set<const llvm::Value *> insts;
+    for (const llvm::BasicBlock& block : F) {
+        for (const llvm::Instruction& Inst : block)
+            insts.insert(&Inst);
+    }
+
+    std::set<RDNode *> old_nodes(old.nodes.begin(), old.nodes.end());
+    std::vector<RDNode *> changed{root, ret};
+
+    // the values of removed instructions are not valid anymore,
+    // so they are used only as the keys here
+    for (const llvm::Value *val : old.mapped) {
+        mapping.erase(val);
+        promoted.erase(val);
+        local_defs.erase(val);
+    }
+
+    // the stores to the promoted allocas are not in the graph
+    for (RDNode *n : old.locals) {
+        auto it = nodes_map.find(n->getUserData<llvm::Value>());
+        if (it != nodes_map.end() && it->second == n)
+            nodes_map.erase(it);
+    }
+
+    for (RDNode *n : old.nodes) {
+        // the nodes outside of F that lose a predecessor
+        // (the roots of the called functions)
+        for (RDNode *succ : n->getSuccessors()) {
+            if (!old_nodes.count(succ))
+                changed.push_back(succ);
+        }
+
+        n->isolate();
+
+        const llvm::Value *val = n->getUserData<llvm::Value>();
+        if (!val)
+            continue;
+
+        auto it = nodes_map.find(val);
+        if (it == nodes_map.end() || it->second != n)
+            continue;
+
+        // keep the memory objects, other nodes may refer to them
+        bool keep = false;
+        if (insts.count(val)) {
+            if (n->getType() == ALLOC)
+                keep = llvm::isa<llvm::AllocaInst>(val);
+            else if (n->getType() == DYN_ALLOC)
+                keep = llvm::isa<llvm::CallInst>(val);
+        }
+
+        if (keep)
+            functions[&F].nodes.push_back(n);
+        else
+            nodes_map.erase(it);
+    }
+
+    // the old nodes that are not kept are not in the graph anymore
+    for (RDNode *n : functions[&F].nodes)
+        old_nodes.erase(n);
+    all_nodes.erase(std::remove_if(all_nodes.begin(), all_nodes.end(),
+                                   [&old_nodes](RDNode *n) {
+                                       return old_nodes.count(n) > 0;
+                                   }),
+                    all_nodes.end());
+
+    const llvm::Function *prev = building;
+    building = &F;
+    buildFunctionBody(F, root, ret);
+    building = prev;
+
+    // the new nodes (and the kept ones)
+    const std::vector<RDNode *>& nodes = functions[&F].nodes;
+    changed.insert(changed.end(), nodes.begin(), nodes.end());
+
+    return changed;
+}
+
+void LLVMRDBuilder::releaseFunction(const llvm::Function& F)
+{
+    auto it = functions.find(&F);
+    if (it == functions.end())
+        return;
+
+    // the copies of a map share its definitions (see RDMap),
+    // so the nodes outside of F keep them
+    for (RDNode *n : it->second.nodes)
+        n->def_map = RDMap();
+
+    for (const llvm::BasicBlock& block : F) {
+        for (const llvm::Instruction& Inst : block) {
+            if (llvm::isa<llvm::LoadInst>(Inst))
+                local_defs.erase(&Inst);
+        }
+    }
+}
+
+std::unordered_map<const RDNode *, const llvm::Function *>
+LLVMRDBuilder::getNodesFunctions() const
+{
+    std::unordered_map<const RDNode *, const llvm::Function *> ret;
+    for (const auto& it : functions) {
+        for (RDNode *n : it.second.nodes)
+            ret.emplace(n, it.first);
+        for (RDNode *n : it.second.locals)
+            ret.emplace(n, it.first);
+    }
+
+    return ret;
 }
 
 RDNode *LLVMRDBuilder::createUndefinedCall(const llvm::CallInst *CInst)
 {
     using namespace llvm;
 
-    RDNode *node = new RDNode(CALL);
+    RDNode *node = newNode(CALL);
     addNode(CInst, node);
 
     // if we assume that undefined functions are pure
@@ -633,9 +968,21 @@ RDNode *LLVMRDBuilder::createUndefinedCall(const llvm::CallInst *CInst)
     if (assume_pure_functions)
         return node;
 
+    // the summary of the function says what memory it may define
+    const Function *func
+        = dyn_cast<Function>(CInst->getCalledValue()->stripPointerCasts());
+    const FunctionSummary *summary = info->getSummary(func);
+    if (summary && summary->ret == FunctionSummary::Return::ALLOCATION)
+        // the call works as an allocation in points-to and
+        // it initializes the memory it returns
+        node->addDef(node, 0, UNKNOWN_OFFSET);
+
     // every pointer we pass into the undefined call may be defined
     // in the function
     for (unsigned int i = 0; i < CInst->getNumArgOperands(); ++i) {
+        if (summary && !summary->mod.contains(i))
+            continue;
+
         const Value *llvmOp = CInst->getArgOperand(i);
 
         // constants cannot be redefined except for global variables
@@ -674,8 +1021,9 @@ RDNode *LLVMRDBuilder::createUndefinedCall(const llvm::CallInst *CInst)
     }
 
     // XXX: to be completely correct, we should assume also modification
-    // of all global variables, so we should perform a write to
-    // unknown memory instead of the loop above
+    // of all global variables (of the functions without a summary),
+    // so we should perform a write to unknown memory instead
+    // of the loop above
 
     return node;
 }
@@ -688,7 +1036,7 @@ RDNode *LLVMRDBuilder::createIntrinsicCall(const llvm::CallInst *CInst)
     const Value *dest;
     const Value *lenVal;
 
-    RDNode *ret = new RDNode(CALL);
+    RDNode *ret = newNode(CALL);
     addNode(CInst, ret);
 
     switch (I->getIntrinsicID())
@@ -770,11 +1118,11 @@ LLVMRDBuilder::createCall(const llvm::Instruction *Inst)
 
     const Function *func = dyn_cast<Function>(calledVal);
     if (func) {
-        if (func->size() == 0) {
+        if (!info->isDefined(func)) {
             RDNode *n;
             if (func->isIntrinsic()) {
                 n = createIntrinsicCall(CInst);
-            } else if (int type = getMemAllocationFunc(func)) {
+            } else if (int type = info->getMemAllocationFunc(func)) {
                 if (type == REALLOC)
                     n = createRealloc(CInst);
                 else
@@ -792,90 +1140,39 @@ LLVMRDBuilder::createCall(const llvm::Instruction *Inst)
         }
     } else {
         // function pointer call
-        pta::PSNode *op = PTA->getPointsTo(calledVal);
-        assert(op && "Don't have points-to information");
-        //assert(!op->pointsTo.empty() && "Don't have pointer to the func");
-        if (op->pointsTo.empty()) {
-            llvm::errs() << "WARNING: a call via a function pointer, but the points-to is empty\n"
-                         << *CInst << "\n";
+        const auto& targets = PTA->getCallGraph().getCallSite(CInst).targets;
+        if (targets.empty()) {
+            llvm::errs() << "WARNING: a call via a function pointer, but it points "
+                            "to no compatible function\n" << *CInst << "\n";
             RDNode *n = createUndefinedCall(CInst);
             return std::make_pair(n, n);
         }
 
-        RDNode *call_funcptr = nullptr, *ret_call = nullptr;
-
-        if (op->pointsTo.size() > 1) {
-            for (const pta::Pointer& ptr : op->pointsTo) {
-                if (!ptr.isValid())
-                    continue;
-
-                // check if it is a function (varargs may
-                // introduce some unprecision to func. pointers)
-                if (!isa<Function>(ptr.target->getUserData<Value>()))
-                    continue;
-
-                const Function *F = ptr.target->getUserData<Function>();
-                if (F->size() == 0) {
-                    // the function is a declaration only,
-                    // there's nothing better we can do
-                    RDNode *n = createUndefinedCall(CInst);
-                    return std::make_pair(n, n);
-                }
-
-                // FIXME: these checks are repeated here, in PSSBuilder
-                // and in LLVMDependenceGraph, we should factor them
-                // out into a function...
-                if (!llvmutils::callIsCompatible(F, CInst))
-                    continue;
-
-                std::pair<RDNode *, RDNode *> cf
-                    = createCallToFunction(F);
-                addNode(cf.first);
-
-                // connect the graphs
-                if (!call_funcptr) {
-                    assert(!ret_call);
-
-                    // create the new nodes lazily
-                    call_funcptr = new RDNode(CALL);
-                    ret_call = new RDNode(CALL_RETURN);
-                    addNode(CInst, call_funcptr);
-                    addNode(ret_call);
-                }
-
-                call_funcptr->addSuccessor(cf.first);
-                cf.second->addSuccessor(ret_call);
-            }
-        } else {
-            // don't add redundant nodes if not needed
-            const pta::Pointer& ptr = *(op->pointsTo.begin());
-            if (ptr.isValid()) {
-                const llvm::Value *valF = ptr.target->getUserData<llvm::Value>();
-                if (const llvm::Function *F = llvm::dyn_cast<llvm::Function>(valF)) {
-                    if (F->size() == 0) {
-                        RDNode *n = createUndefinedCall(CInst);
-                        return std::make_pair(n, n);
-                    } else if (llvmutils::callIsCompatible(F, CInst)) {
-                        std::pair<RDNode *, RDNode *> cf = createCallToFunction(F);
-                        addNode(cf.first);
-
-                        call_funcptr = cf.first;
-                        ret_call = cf.second;
-                    }
-                }
+        for (const Function *F : targets) {
+            if (!info->isDefined(F)) {
+                // the function is a declaration only,
+                // there's nothing better we can do
+                RDNode *n = createUndefinedCall(CInst);
+                return std::make_pair(n, n);
             }
         }
 
-        if (!ret_call) {
-            assert(!call_funcptr);
-            llvm::errs() << "Function pointer call with no compatible pointer: "
-                         << *CInst << "\n";
+        // don't add redundant nodes if not needed
+        if (targets.size() == 1)
+            return createCallToFunction(targets[0]);
 
-            RDNode *n = createUndefinedCall(CInst);
-            return std::make_pair(n, n);
+        RDNode *call_funcptr = newNode(CALL);
+        RDNode *ret_call = newNode(CALL_RETURN);
+        addNode(CInst, call_funcptr);
+
+        for (const Function *F : targets) {
+            std::pair<RDNode *, RDNode *> cf = createCallToFunction(F);
+
+            // connect the graphs
+            call_funcptr->addSuccessor(cf.first);
+            cf.second->addSuccessor(ret_call);
         }
 
-        assert(call_funcptr && ret_call);
         return std::make_pair(call_funcptr, ret_call);
     }
 }
@@ -890,7 +1187,7 @@ RDNode *LLVMRDBuilder::build()
     }
 
     // first we must build globals, because nodes can use them as operands
-    std::pair<RDNode *, RDNode *> glob = buildGlobals();
+    buildGlobals();
 
     // now we can build rest of the graph
     RDNode *root, *ret;
@@ -898,39 +1195,89 @@ RDNode *LLVMRDBuilder::build()
     assert(root && "Do not have a root node of a function");
     assert(ret && "Do not have a ret node of a function");
 
-    // do we have any globals at all? If so, insert them at the begining
-    // of the graph
-    if (glob.first) {
-        assert(glob.second && "Have the start but not the end");
+    if (summaries)
+        computeSummaries();
 
-        // this is a sequence of global nodes, make it the root of the graph
-        glob.second->addSuccessor(root);
+    return root;
+}
 
-        assert(root->successorsNum() > 0);
-        root = glob.first;
-    }
+void LLVMRDBuilder::computeSummaries()
+{
+    for (auto& it : summaries_map) {
+        // the function and the functions it calls (transitively)
+        std::set<const llvm::Function *> visited{it.first};
+        std::vector<const llvm::Function *> stack{it.first};
+        while (!stack.empty()) {
+            const llvm::Function *F = stack.back();
+            stack.pop_back();
+
+            auto cit = callees.find(F);
+            if (cit == callees.end())
+                continue;
 
-    return root;
+            for (const llvm::Function *callee : cit->second) {
+                if (visited.insert(callee).second)
+                    stack.push_back(callee);
+            }
+        }
+
+        std::vector<unsigned>& procs = it.second.procedures;
+        procs.clear();
+        for (const llvm::Function *F : visited)
+            procs.push_back(procedures[F]);
+        std::sort(procs.begin(), procs.end());
+    }
 }
 
-std::pair<RDNode *, RDNode *> LLVMRDBuilder::buildGlobals()
+std::vector<const llvm::Value *> LLVMReachingDefinitions::update()
 {
-    RDNode *cur = nullptr, *prev, *first = nullptr;
-    for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
-        prev = cur;
+    assert(root && "Need to run() first");
+    query_cache.clear();
 
-        // every global node is like memory allocation
-        cur = new RDNode(ALLOC);
-        addNode(&*I, cur);
+    std::vector<RDNode *> changed;
+    for (const llvm::Function *F : changed_functions) {
+        std::vector<RDNode *> nodes = builder->rebuildFunction(*F);
+        changed.insert(changed.end(), nodes.begin(), nodes.end());
+    }
 
-        if (prev)
-            prev->addSuccessor(cur);
-        else
-            first = cur;
+    changed_functions.clear();
+
+    std::vector<const llvm::Value *> ret;
+    if (SSA) {
+        // the memory SSA has no maps to reuse, build it again
+        SSA.reset(new MemorySSATransformation(root, strong_update_unknown,
+                                              max_set_size));
+        SSA->run();
+
+        for (const auto& it : builder->getMapping())
+            ret.push_back(it.first);
+
+        return ret;
     }
 
-    assert((!first && !cur) || (first && cur));
-    return std::pair<RDNode *, RDNode *>(first, cur);
+    std::vector<RDNode *> recomputed = RDA->update(changed);
+    std::set<RDNode *> affected(recomputed.begin(), recomputed.end());
+    for (const auto& it : builder->getMapping()) {
+        if (affected.count(it.second))
+            ret.push_back(it.first);
+    }
+
+    return ret;
+}
+
+// The nodes of the globals are only the targets of the definitions.
+// The initial values of the globals are not definitions in the maps,
+// a global that has no reaching definition has its initial value
+// (see LLVMDefUseAnalysis), so the maps keep only the definitions
+// of the globals written by the program. The nodes define nothing,
+// so they are not put into the graph, where every node would be
+// visited (and get a map) in every round of the analysis
+void LLVMRDBuilder::buildGlobals()
+{
+    for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
+        // every global node is like memory allocation
+        addNode(&*I, newNode(ALLOC));
+    }
 }
 
 } // namespace rd
@@ -3,13 +3,24 @@
 
 #include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Constants.h>
 
 #include "analysis/ReachingDefinitions/ReachingDefinitions.h"
+#include "analysis/ReachingDefinitions/MemorySSA.h"
+#include "analysis/ReachingDefinitions/RDQueryCache.h"
 #include "llvm/analysis/PointsTo/PointsTo.h"
+#include "SingleInstance.h"
+#include "ADT/Arena.h"
+#include "analysis/MemoryUsage.h"
+#include "analysis/Profiler.h"
 
 namespace dg {
 namespace analysis {
@@ -19,7 +30,12 @@ class LLVMRDBuilder
 {
     const llvm::Module *M;
     const llvm::DataLayout *DL;
+    // shared with the builder of the pointer subgraph
+    std::shared_ptr<LLVMModuleInfo> info;
     bool assume_pure_functions;
+    bool coarse = false;
+    bool promote_locals = true;
+    bool summaries = false;
 
     struct Subgraph {
         Subgraph(RDNode *r1, RDNode *r2)
@@ -33,6 +49,9 @@ class LLVMRDBuilder
     // points-to information
     dg::LLVMPointerAnalysis *PTA;
 
+    // which memory can be strongly updated
+    LLVMSingleInstanceAnalysis instances;
+
     // map of all nodes we created - use to look up operands
     std::unordered_map<const llvm::Value *, RDNode *> nodes_map;
 
@@ -44,19 +63,138 @@ class LLVMRDBuilder
 
     // map of all built subgraphs - the value type is a pair (root, return)
     std::unordered_map<const llvm::Value *, Subgraph> subgraphs_map;
-    // list of dummy nodes (used just to keep the track of memory,
-    // so that we can delete it later)
-    std::vector<RDNode *> dummy_nodes;
+
+    // the nodes created for the instructions of every function
+    // and the instructions mapped to them, so that we can rebuild
+    // the subgraph of the function (rebuildFunction())
+    struct FunctionNodes {
+        std::vector<RDNode *> nodes;
+        std::vector<const llvm::Value *> mapped;
+        // the stores to the promoted allocas (not in the graph)
+        std::vector<RDNode *> locals;
+    };
+
+    std::unordered_map<const llvm::Function *, FunctionNodes> functions;
+    // the function whose nodes we are creating now
+    const llvm::Function *building = nullptr;
+
+    // the numbers of the functions (RDNode::setProcedure()), the functions
+    // called from every function and the summaries of the called
+    // functions (see setSummaries())
+    std::unordered_map<const llvm::Function *, unsigned> procedures;
+    std::unordered_map<const llvm::Function *,
+                       std::set<const llvm::Function *>> callees;
+    std::unordered_map<const llvm::Function *, RDSummary> summaries_map;
+
+    // all the nodes that we create are allocated here
+    // and freed at once when the builder is destroyed
+    ADT::Arena<RDNode> nodes_arena;
+    // the nodes of the graph in the order of creation, so that
+    // enumerating them does not need to search the graph
+    // (the nodes left out by rebuildFunction() are dropped)
+    std::vector<RDNode *> all_nodes;
+
+    // the allocas whose loads are answered without the graph
+    // (see setPromoteLocals()) and the definitions of these loads
+    std::unordered_set<const llvm::Value *> promoted;
+    std::unordered_map<const llvm::Value *, std::vector<RDNode *>> local_defs;
+
+    template <typename... Args>
+    RDNode *createNode(Args&&... args)
+    {
+        RDNode *node = nodes_arena.create(std::forward<Args>(args)...);
+        all_nodes.push_back(node);
+        return node;
+    }
+
+    template <typename... Args>
+    RDNode *newNode(Args&&... args)
+    {
+        RDNode *node = createNode(std::forward<Args>(args)...);
+        if (building) {
+            functions[building].nodes.push_back(node);
+            node->setProcedure(procedures[building]);
+        }
+
+        return node;
+    }
+
 public:
     LLVMRDBuilder(const llvm::Module *m,
                   dg::LLVMPointerAnalysis *p,
                   bool pure_funs = false)
         : M(m), DL(new llvm::DataLayout(m)),
-          assume_pure_functions(pure_funs), PTA(p) {}
+          info(p ? p->getModuleInfo() : std::make_shared<LLVMModuleInfo>(m)),
+          assume_pure_functions(pure_funs), PTA(p),
+          instances(m, p, info.get()) {}
     ~LLVMRDBuilder();
 
     RDNode *build();
 
+    // the number of the nodes that the builder created
+    size_t getNodesNum() const { return nodes_arena.size(); }
+
+    // all the nodes of the graph (in the order of creation)
+    const std::vector<RDNode *>& getNodes() const { return all_nodes; }
+
+    // build the subgraph of @F again after @F was changed. The root and
+    // the return node of the subgraph stay, so the edges from the callers
+    // are kept. Also the nodes of the memory allocations that are still
+    // in @F are kept, since they may be the targets of def-sites in other
+    // functions (if the points-to information of other functions changed,
+    // these functions must be rebuilt too). The old nodes of @F are left
+    // in the arena without any edges. Returns the new nodes together
+    // with the nodes whose predecessors changed.
+    // Not supported in the coarse mode and with the summaries
+    std::vector<RDNode *> rebuildFunction(const llvm::Function& F);
+
+    // summarize every run of stores that is not interleaved
+    // with reading the memory into one node and leave allocas
+    // out of the graph. The queries of the instructions
+    // in the run are answered by the summary node
+    void setCoarse(bool c) { coarse = c; }
+
+    // the allocas that are only loaded and stored as a whole (their
+    // address is not taken, so no other instruction and no other function
+    // can touch them) are left out of the graph. Their stores are not
+    // in the graph and the definitions of their loads are computed
+    // in the function right away, like when the allocas are promoted
+    // to registers (see getLocalDefinitions()). Default is true,
+    // must be called before build()
+    void setPromoteLocals(bool p) { promote_locals = p; }
+
+    // apply the summaries of the called functions at the calls (see
+    // RDSummary) instead of letting the definitions of all the callers
+    // flow out of the function to every caller. The maps behind
+    // the commonly called functions are then much smaller. The memory
+    // SSA ignores the summaries. Must be called before build()
+    void setSummaries(bool s) { summaries = s; }
+
+    // the definitions of the load @val from a promoted alloca
+    // (empty if the alloca may be uninitialized there)
+    // or nullptr if @val is not such a load
+    const std::vector<RDNode *> *getLocalDefinitions(const llvm::Value *val) const
+    {
+        auto it = local_defs.find(val);
+        return it == local_defs.end() ? nullptr : &it->second;
+    }
+
+    // the number of the promoted allocas
+    size_t getPromotedNum() const { return promoted.size(); }
+
+    // free the maps of definitions of the nodes of @F and the definitions
+    // of its loads from the promoted allocas once they are not needed
+    // anymore (e.g. the def-use edges of @F were added). The queries
+    // of the instructions of @F give no definitions after that.
+    // In the sparse mode, also the first nodes of the callees of @F
+    // may use the maps of @F, so query the callees first
+    void releaseFunction(const llvm::Function& F);
+
+    // the functions whose code the nodes were built for,
+    // the nodes of the globals are left out
+    std::unordered_map<const RDNode *, const llvm::Function *>
+    getNodesFunctions() const;
+
     // let the user get the nodes map, so that we can
     // map the points-to informatio back to LLVM nodes
     const std::unordered_map<const llvm::Value *, RDNode *>&
@@ -95,31 +233,36 @@ private:
         node->setUserData(const_cast<llvm::Value *>(val));
     }
 
-    ///
-    // Add a dummy node for which there's no real LLVM node
-    void addNode(RDNode *node)
-    {
-        dummy_nodes.push_back(node);
-    }
-
     void addMapping(const llvm::Value *val, RDNode *node)
     {
         auto it = mapping.find(val);
         assert(it == mapping.end() && "Adding mapping that we already have");
 
         mapping.emplace_hint(it, val, node);
+        if (building)
+            functions[building].mapped.push_back(val);
     }
 
     RDNode *createStore(const llvm::Instruction *Inst);
+    RDNode *createLocalStore(const llvm::Instruction *Inst);
     RDNode *createAlloc(const llvm::Instruction *Inst);
     RDNode *createDynAlloc(const llvm::Instruction *Inst, int type);
     RDNode *createRealloc(const llvm::Instruction *Inst);
     RDNode *createReturn(const llvm::Instruction *Inst);
+    void addToSummary(RDNode *summary, RDNode *store);
 
     std::pair<RDNode *, RDNode *> buildBlock(const llvm::BasicBlock& block);
     std::pair<RDNode *, RDNode *> buildFunction(const llvm::Function& F);
+    void buildFunctionBody(const llvm::Function& F, RDNode *root, RDNode *ret);
+
+    bool isPromoted(const llvm::Instruction *Inst) const;
+    void findPromotable(const llvm::Function& F);
+    void computeLocalDefinitions(const llvm::Function& F);
 
-    std::pair<RDNode *, RDNode *> buildGlobals();
+    // create the nodes of the globals (not connected to the graph)
+    void buildGlobals();
+    // fill the procedures of the summaries once all the calls are built
+    void computeSummaries();
 
     std::pair<RDNode *, RDNode *>
     createCallToFunction(const llvm::Function *F);
@@ -131,13 +274,96 @@ private:
     RDNode *createUndefinedCall(const llvm::CallInst *CInst);
 };
 
+///
+// Immutable copy of the reaching definitions computed by
+// LLVMReachingDefinitions, created by finalize(). It keeps the maps
+// of definitions of all the nodes (the nodes with the same map share
+// one copy and the copies share the definitions with the maps
+// of the analysis until the analysis changes them, e.g. in update())
+// and the mapping of the values to the nodes. The snapshot is not
+// modified by the queries, so it can be queried from more threads
+// at once. With the memory SSA the definitions are computed
+// on the queries, so then the queries are serialized.
+// The nodes are owned by the analysis, so it must outlive the snapshot.
+class LLVMRDSnapshot
+{
+    std::unordered_map<const llvm::Value *, RDNode *> nodes_map;
+    std::unordered_map<const llvm::Value *, RDNode *> mapping;
+    // the index of the map of every node in maps
+    std::unordered_map<const RDNode *, uint32_t> node_maps;
+    std::vector<RDMap> maps;
+
+    MemorySSATransformation *SSA = nullptr;
+    mutable std::mutex ssa_mutex;
+
+    static RDNode *find(const std::unordered_map<const llvm::Value *, RDNode *>& M,
+                        const llvm::Value *val)
+    {
+        auto it = M.find(val);
+        return it == M.end() ? nullptr : it->second;
+    }
+
+public:
+    LLVMRDSnapshot() = default;
+    LLVMRDSnapshot(const LLVMRDSnapshot&) = delete;
+    LLVMRDSnapshot& operator=(const LLVMRDSnapshot&) = delete;
+
+    RDNode *getNode(const llvm::Value *val) const { return find(nodes_map, val); }
+    RDNode *getMapping(const llvm::Value *val) const { return find(mapping, val); }
+
+    // gather the reaching definitions of memory [target + off, target + off + len]
+    // at the node @where
+    size_t getReachingDefinitions(RDNode *where, RDNode *target,
+                                  const Offset& off, const Offset& len,
+                                  std::set<RDNode *>& ret) const
+    {
+        if (SSA) {
+            std::lock_guard<std::mutex> lock(ssa_mutex);
+            return SSA->getReachingDefinitions(where, target, off, len, ret);
+        }
+
+        auto it = node_maps.find(where);
+        if (it == node_maps.end())
+            return ret.size();
+
+        return maps[it->second].get(target, off, len, ret);
+    }
+
+    size_t getMapsNum() const { return maps.size(); }
+
+    friend class LLVMReachingDefinitions;
+};
+
 class LLVMReachingDefinitions
 {
+    const llvm::Module *M;
     std::unique_ptr<LLVMRDBuilder> builder;
     std::unique_ptr<ReachingDefinitionsAnalysis> RDA;
+    std::unique_ptr<MemorySSATransformation> SSA;
     RDNode *root;
     bool strong_update_unknown;
     uint32_t max_set_size;
+    bool sparse = false;
+    unsigned threads = 1;
+    bool memory_ssa = false;
+    bool statistics = false;
+    uint32_t max_growths = 0;
+    uint32_t max_offsets = 0;
+    analysis::Budget budget;
+    analysis::Progress progress;
+    // the results of the queries of the maps (see getReachingDefinitions()),
+    // valid until the next run() or update()
+    RDQueryCache query_cache;
+    // the functions changed since the last run() or update()
+    std::set<const llvm::Function *> changed_functions;
+
+    // the definitions of the loads and calls found by the def-use
+    // analysis (see recordResults() and loadResults())
+    std::unordered_map<const llvm::Value *,
+                       std::vector<const llvm::Value *>> results;
+    std::mutex results_mutex;
+    bool recording = false;
+    bool results_loaded = false;
 
 public:
     LLVMReachingDefinitions(const llvm::Module *m,
@@ -145,16 +371,168 @@ public:
                             bool strong_updt_unknown = false,
                             bool pure_funs = false,
                             uint32_t max_set_sz = ~((uint32_t) 0))
-        : builder(std::unique_ptr<LLVMRDBuilder>(new LLVMRDBuilder(m, pta, pure_funs))),
+        : M(m), builder(std::unique_ptr<LLVMRDBuilder>(new LLVMRDBuilder(m, pta, pure_funs))),
           strong_update_unknown(strong_updt_unknown), max_set_size(max_set_sz) {}
 
     void run()
     {
-        root = builder->build();
+        query_cache.clear();
+        {
+            analysis::Profiler::Scope phase("Building the RD graph");
+            root = builder->build();
+            analysis::Profiler::count("RD nodes", builder->getNodesNum());
+            analysis::Profiler::count("RD promoted allocas",
+                                      builder->getPromotedNum());
+        }
+
+        analysis::Profiler::Scope phase("Solving reaching definitions");
         RDA = std::unique_ptr<ReachingDefinitionsAnalysis>(
             new ReachingDefinitionsAnalysis(root, strong_update_unknown, max_set_size)
             );
-        RDA->run();
+        RDA->setSparse(sparse);
+        RDA->setThreads(threads);
+        RDA->setMaxGrowths(max_growths);
+        RDA->setMaxOffsets(max_offsets);
+        RDA->setBudget(budget);
+        RDA->setProgress(progress);
+        RDA->collectStatistics(statistics);
+
+        if (memory_ssa) {
+            SSA = std::unique_ptr<MemorySSATransformation>(
+                new MemorySSATransformation(root, strong_update_unknown, max_set_size)
+                );
+            SSA->run();
+        } else
+            RDA->run();
+    }
+
+    // the function or the instruction was changed (or added) in the module,
+    // the changes are taken into account by the next update()
+    void markChanged(const llvm::Function *F) { changed_functions.insert(F); }
+    void markChanged(const llvm::Instruction *I)
+    {
+        markChanged(I->getParent()->getParent());
+    }
+
+    // rebuild the subgraphs of the changed functions and recompute
+    // the reaching definitions of the nodes that the changes may affect,
+    // the other nodes keep their maps. Returns the instructions whose
+    // reaching definitions were recomputed, so that the def-use edges
+    // can be updated (see LLVMDefUseAnalysis::update()).
+    // The points-to information must be up to date
+    std::vector<const llvm::Value *> update();
+
+    // see ReachingDefinitionsAnalysis::setSparse(), setThreads(),
+    // setMaxGrowths() and setMaxOffsets()
+    void setSparse(bool s) { sparse = s; }
+    void setThreads(unsigned n) { threads = n; }
+    void setMaxGrowths(uint32_t n) { max_growths = n; }
+    void setMaxOffsets(uint32_t n) { max_offsets = n; }
+    // see ReachingDefinitionsAnalysis::setBudget() (not used
+    // with the memory SSA), must be called before run()
+    void setBudget(const analysis::Budget& b) { budget = b; }
+    bool isBudgetExceeded() const
+    {
+        return RDA && !SSA && RDA->isBudgetExceeded();
+    }
+
+    // see ReachingDefinitionsAnalysis::setProgress() (not used
+    // with the memory SSA), must be called before run()
+    void setProgress(const analysis::Progress& p) { progress = p; }
+
+    // gather statistics of the def-sites in the next run()
+    // (not with the memory SSA)
+    void collectStatistics(bool enable = true) { statistics = enable; }
+    // print the statistics together with the @num def-sites
+    // with the largest sets and the def-sites merged most times
+    void printStatistics(llvm::raw_ostream& os, size_t num = 10) const;
+
+    // add the approximate memory used by the nodes and their maps
+    // of definitions to @mu (nothing with the memory SSA)
+    void getMemoryUsage(analysis::MemoryUsage& mu) const;
+
+    // answer the queries using memory SSA instead of computing
+    // the maps of all the nodes. Then only the queries below
+    // give the reaching definitions, the maps of the nodes are empty
+    void setMemorySSA(bool m) { memory_ssa = m; }
+    // are the queries answered using memory SSA? (after run(),
+    // then the queries compute and cache the definitions)
+    bool usesMemorySSA() const { return SSA != nullptr; }
+
+    // let the def-use analysis record the definitions that it finds
+    // for the loads and calls (see addResults()), so that they can be
+    // saved by saveResults(). The def-use edges must be added all
+    // at once then (not on demand) and without the memory hubs
+    void recordResults(bool r = true) { recording = r; }
+    bool isRecordingResults() const { return recording; }
+
+    // add @defs to the recorded definitions of @use,
+    // may be called from more threads at once
+    void addResults(const llvm::Value *use,
+                    const std::vector<const llvm::Value *>& defs)
+    {
+        if (defs.empty())
+            return;
+
+        std::lock_guard<std::mutex> lock(results_mutex);
+        auto& vals = results[use];
+        vals.insert(vals.end(), defs.begin(), defs.end());
+    }
+
+    // save the recorded definitions into @file as the lists of the numbers
+    // of the values (see ValuesNumbering), @key identifies the module
+    // and the options of the analyses that the results depend on
+    bool saveResults(const std::string& file, uint64_t key);
+
+    // load the definitions saved by saveResults() instead of run(),
+    // the graph of reaching definitions is not built then and the def-use
+    // analysis adds the edges from the loaded definitions
+    // (see getLoadedResults()). Returns false if the file cannot be used
+    bool loadResults(const std::string& file, uint64_t key);
+    bool hasLoadedResults() const { return results_loaded; }
+
+    // the loaded definitions of the load or call @use
+    // (nullptr if it has none)
+    const std::vector<const llvm::Value *> *
+    getLoadedResults(const llvm::Value *use) const
+    {
+        auto it = results.find(use);
+        return it == results.end() ? nullptr : &it->second;
+    }
+
+    // see LLVMRDBuilder::setCoarse(), must be called before run()
+    void setCoarse(bool c) { builder->setCoarse(c); }
+    // see LLVMRDBuilder::setPromoteLocals(), must be called before run()
+    void setPromoteLocals(bool p) { builder->setPromoteLocals(p); }
+    // see LLVMRDBuilder::setSummaries(), must be called before run()
+    void setSummaries(bool s) { builder->setSummaries(s); }
+
+    // the definitions of the load @val from a promoted alloca
+    // or nullptr if the load must be answered by the other queries
+    // (see LLVMRDBuilder::setPromoteLocals())
+    const std::vector<RDNode *> *getLocalDefinitions(const llvm::Value *val) const
+    {
+        return builder->getLocalDefinitions(val);
+    }
+
+    // see LLVMRDBuilder::releaseFunction(). Nothing is released
+    // with the memory SSA (the maps of the nodes are empty then).
+    // The cached results of the queries are dropped, since the freed
+    // maps may be allocated again
+    void releaseFunction(const llvm::Function& F)
+    {
+        if (SSA)
+            return;
+
+        builder->releaseFunction(F);
+        query_cache.clear();
+    }
+
+    // the number of nodes processed by the fixpoint computation
+    // (the memory SSA computes the maps only on queries)
+    uint64_t getProcessedNodes() const
+    {
+        return (RDA && !SSA) ? RDA->getProcessedNodes() : 0;
     }
 
     RDNode *getNode(const llvm::Value *val)
@@ -177,12 +555,41 @@ public:
         return builder->getMapping(val);
     }
 
-    void getNodes(std::set<RDNode *>& cont)
+    // all the nodes of the graph (in the order of creation)
+    const std::vector<RDNode *>& getNodes() const
+    {
+        return builder->getNodes();
+    }
+
+    // copy the results into an immutable snapshot that can be shared
+    // by more threads (the queries of this object are not thread-safe).
+    // Call it after run() or update()
+    std::shared_ptr<const LLVMRDSnapshot> finalize()
     {
         assert(RDA);
-        // FIXME: this is insane, we should have this method defined here
-        // not in RDA
-        RDA->getNodes(cont);
+        std::shared_ptr<LLVMRDSnapshot> snapshot(new LLVMRDSnapshot());
+        snapshot->nodes_map = getNodesMap();
+        snapshot->mapping = getMapping();
+
+        if (SSA) {
+            snapshot->SSA = SSA.get();
+            return snapshot;
+        }
+
+        // the nodes of a run share the map of the first node
+        std::unordered_map<const RDMap *, uint32_t> copied;
+        for (RDNode *n : getNodes()) {
+            const RDMap& map = static_cast<const RDNode *>(n)->getReachingDefinitions();
+            auto it = copied.find(&map);
+            if (it == copied.end()) {
+                it = copied.emplace(&map, snapshot->maps.size()).first;
+                snapshot->maps.push_back(map);
+            }
+
+            snapshot->node_maps.emplace(n, it->second);
+        }
+
+        return snapshot;
     }
 
     const RDMap& getReachingDefinitions(RDNode *n) const { return n->getReachingDefinitions(); }
@@ -192,6 +599,46 @@ public:
     {
         return n->getReachingDefinitions(n, off, len, ret);
     }
+
+    // gather the reaching definitions of memory [target + off, target + off + len]
+    // at the node @where
+    size_t getReachingDefinitions(RDNode *where, RDNode *target,
+                                  const Offset& off, const Offset& len,
+                                  std::set<RDNode *>& ret)
+    {
+        if (SSA)
+            return SSA->getReachingDefinitions(where, target, off, len, ret);
+
+        return where->getReachingDefinitions(target, off, len, ret);
+    }
+
+    // gather the reaching definitions of all the @sites at the node @where,
+    // @ret[i] are the sorted definitions of @sites[i]. The results are
+    // cached in @cache (in the cache of this object if it is nullptr),
+    // the nodes that share the map share the results. With more threads,
+    // every thread must use its own cache
+    void getReachingDefinitions(RDNode *where,
+                                const std::vector<DefSite>& sites,
+                                std::vector<RDQueryCache::ResultT>& ret,
+                                RDQueryCache *cache = nullptr)
+    {
+        if (SSA) {
+            ret.clear();
+            for (const DefSite& ds : sites) {
+                std::set<RDNode *> defs;
+                SSA->getReachingDefinitions(where, ds.target, ds.offset,
+                                            ds.len, defs);
+                ret.push_back(std::make_shared<const std::vector<RDNode *>>(
+                                                    defs.begin(), defs.end()));
+            }
+
+            return;
+        }
+
+        const RDNode *node = where;
+        (cache ? cache : &query_cache)->get(node->getReachingDefinitions(),
+                                            sites, ret);
+    }
 };
 
 
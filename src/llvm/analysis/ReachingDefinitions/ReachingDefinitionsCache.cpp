@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "ReachingDefinitions.h"
+#include "llvm/CacheFile.h"
+
+///
+// Format of the file (see llvm/CacheFile.h):
+//
+//  magic (8 bytes), key (u64), number of llvm values in the module (u32)
+//  number of records (u32)
+//      record: value id of the load or call (u32), number of definitions (u32)
+//          definition: value id (u32)
+//
+// Values are identified by their number in ValuesNumbering.
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+namespace {
+
+const char MAGIC[8] = {'D', 'G', 'R', 'D', 'C', 'A', '1', '\0'};
+
+struct Record {
+    uint32_t use;
+    std::vector<uint32_t> defs;
+};
+
+} // anonymous namespace
+
+bool LLVMReachingDefinitions::saveResults(const std::string& file, uint64_t key)
+{
+    ValuesNumbering numbering(M);
+
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        records.reserve(results.size());
+        for (const auto& it : results) {
+            Record rec;
+            if (!numbering.getId(it.first, rec.use))
+                return false;
+
+            for (const llvm::Value *def : it.second) {
+                uint32_t id;
+                if (!numbering.getId(def, id))
+                    return false;
+                rec.defs.push_back(id);
+            }
+
+            // a use may get the same definition for more pointers
+            std::sort(rec.defs.begin(), rec.defs.end());
+            rec.defs.erase(std::unique(rec.defs.begin(), rec.defs.end()),
+                           rec.defs.end());
+            records.push_back(std::move(rec));
+        }
+    }
+
+    std::sort(records.begin(), records.end(),
+              [](const Record& a, const Record& b) { return a.use < b.use; });
+
+    CacheWriter out(file);
+    out.write(MAGIC, sizeof MAGIC);
+    out.write64(key);
+    out.write32(numbering.values.size());
+
+    out.write32(records.size());
+    for (const Record& rec : records) {
+        out.write32(rec.use);
+        out.write32(rec.defs.size());
+        for (uint32_t def : rec.defs)
+            out.write32(def);
+    }
+
+    return out.good();
+}
+
+bool LLVMReachingDefinitions::loadResults(const std::string& file, uint64_t key)
+{
+    // MemoryBuffer maps big files into memory instead of reading them
+    auto buf = llvm::MemoryBuffer::getFile(file);
+    if (!buf)
+        return false;
+
+    CacheReader in(*buf.get());
+    ValuesNumbering numbering(M);
+    uint32_t values_num = numbering.values.size();
+
+    // read and check the whole file before we fill in the results
+    char magic[sizeof MAGIC];
+    uint64_t file_key;
+    uint32_t num, records_num;
+    if (!in.read(magic, sizeof magic) || memcmp(magic, MAGIC, sizeof MAGIC) != 0
+        || !in.read64(file_key) || file_key != key
+        || !in.read32(num) || num != values_num
+        || !in.read32(records_num))
+        return false;
+
+    std::vector<Record> records(records_num);
+    for (Record& rec : records) {
+        uint32_t defs_num;
+        if (!in.read32(rec.use) || !in.read32(defs_num) || rec.use >= values_num)
+            return false;
+
+        rec.defs.resize(defs_num);
+        for (uint32_t& def : rec.defs) {
+            if (!in.read32(def) || def >= values_num)
+                return false;
+        }
+    }
+
+    if (!in.atEnd())
+        return false;
+
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results.clear();
+    for (const Record& rec : records) {
+        auto& defs = results[numbering.values[rec.use]];
+        for (uint32_t def : rec.defs)
+            defs.push_back(numbering.values[def]);
+    }
+
+    results_loaded = true;
+    return true;
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,128 @@
+#include <string>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Value.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "ReachingDefinitions.h"
+#include "llvm/analysis/FunctionCosts.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+static void printDefSite(llvm::raw_ostream& os, const DefSite& ds)
+{
+    const llvm::Value *val = ds.target->getUserData<llvm::Value>();
+    if (ds.target->isUnknown() || !val) {
+        os << "unknown";
+    } else if (llvm::isa<llvm::Function>(val)) {
+        os << val->getName();
+    } else {
+        std::string str;
+        llvm::raw_string_ostream ss(str);
+        ss << *val;
+        ss.flush();
+
+        // crop long names
+        if (str.size() > 60)
+            str = str.substr(0, 60) + " ...";
+
+        os << str;
+    }
+
+    os << " [";
+    if (ds.offset.isUnknown())
+        os << "?";
+    else
+        os << *ds.offset;
+    os << " - ";
+    if (ds.len.isUnknown())
+        os << "?";
+    else
+        os << *ds.len;
+    os << "]";
+}
+
+static void printDefSites(llvm::raw_ostream& os,
+                          const std::vector<std::pair<DefSite,
+                                 ReachingDefinitionsStatistics::DefSiteStatistics>>& sites)
+{
+    os << "      max size      merges     growths  in loops\n";
+    for (const auto& it : sites) {
+        os << llvm::format("%12lu", it.second.maxSize)
+           << llvm::format("%12lu", it.second.merges)
+           << llvm::format("%12lu", it.second.growths)
+           << llvm::format("%10lu", it.second.iterationGrowths)
+           << (it.second.truncated ? " * " : "   ");
+        printDefSite(os, it.first);
+        os << "\n";
+    }
+}
+
+void LLVMReachingDefinitions::printStatistics(llvm::raw_ostream& os,
+                                              size_t num) const
+{
+    os << "RD statistics:\n";
+    if (!RDA || SSA) {
+        os << "  not available\n";
+        return;
+    }
+
+    const ReachingDefinitionsStatistics& st = RDA->getStatistics();
+    os << "  processed nodes: " << RDA->getProcessedNodes() << "\n";
+    os << "  def-sites: " << st.sites.size() << "\n";
+    if (st.maxGrowths > 0)
+        os << "  truncated def-sites (*): " << st.truncatedNum << "\n";
+
+    printFunctionCosts(os, st.nodes, builder->getNodesFunctions(), num);
+
+    auto largest = st.getLargest(num);
+    if (!largest.empty()) {
+        os << "  the def-sites with the largest sets:\n";
+        printDefSites(os, largest);
+    }
+
+    auto merged = st.getMostMerged(num);
+    if (!merged.empty()) {
+        os << "  the def-sites merged most times:\n";
+        printDefSites(os, merged);
+    }
+}
+
+void LLVMReachingDefinitions::getMemoryUsage(MemoryUsage& mu) const
+{
+    if (!RDA || SSA)
+        return;
+
+    for (RDNode *n : getNodes()) {
+        mu.add("nodes", 1, sizeof(RDNode) + n->getEdgesAllocatedBytes());
+        mu.add("def-sites", n->defs.size() + n->overwrites.size(),
+               n->defs.getAllocatedBytes() + n->overwrites.getAllocatedBytes());
+
+        size_t defs = 0;
+        for (const auto& it : n->def_map.getDefs())
+            defs += it.second.size();
+        mu.add("maps", defs, n->def_map.getAllocatedBytes());
+    }
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
@@ -0,0 +1,154 @@
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/Config/llvm-config.h>
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+ #include <llvm/Support/CFG.h>
+#else
+ #include <llvm/IR/CFG.h>
+#endif
+
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instructions.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "analysis/SCC.h"
+#include "llvm/analysis/CallGraph.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "SingleInstance.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+void LLVMSingleInstanceAnalysis::addCyclicBlocks(const llvm::Function& F)
+{
+    std::vector<const llvm::BasicBlock *> blocks;
+    std::unordered_map<const llvm::BasicBlock *, unsigned> ids;
+    for (const llvm::BasicBlock& B : F) {
+        ids.emplace(&B, blocks.size());
+        blocks.push_back(&B);
+    }
+
+    std::vector<std::vector<unsigned>> succs(blocks.size());
+    std::vector<char> self_loop(blocks.size(), false);
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+        for (auto S = llvm::succ_begin(blocks[i]), E = llvm::succ_end(blocks[i]);
+             S != E; ++S) {
+            unsigned s = ids[*S];
+            succs[i].push_back(s);
+            if (s == i)
+                self_loop[i] = true;
+        }
+    }
+
+    std::vector<std::vector<unsigned>> components;
+    std::vector<unsigned> comp_ids = computeSCCs(succs, components);
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+        if (self_loop[i] || components[comp_ids[i]].size() > 1)
+            cyclic_blocks.insert(blocks[i]);
+    }
+}
+
+void LLVMSingleInstanceAnalysis::compute()
+{
+    const LLVMCallGraph& CG = PTA->getCallGraph();
+    const auto& funcs = CG.getFunctions();
+    for (unsigned i = 0; i < funcs.size(); ++i) {
+        addCyclicBlocks(*funcs[i]);
+        if (CG.isRecursive(i))
+            recursive.insert(funcs[i]);
+    }
+
+    computed = true;
+}
+
+bool LLVMSingleInstanceAnalysis::runsOnce(const llvm::Function *F)
+{
+    // follow the chain of the single call sites up to main
+    // (or to a function whose answer we know)
+    std::vector<const llvm::Function *> chain;
+    bool result;
+    while (true) {
+        auto it = runs_once.find(F);
+        if (it != runs_once.end()) {
+            result = it->second;
+            break;
+        }
+
+        chain.push_back(F);
+        if (recursive.count(F) > 0 || F->hasAddressTaken()) {
+            result = false;
+            break;
+        }
+
+        const auto& sites = PTA->getCallGraph().getCallSites(F);
+        if (sites.empty()) {
+            result = F->getName() == "main";
+            break;
+        }
+
+        if (sites.size() != 1 || cyclic_blocks.count(sites[0]->getParent()) > 0) {
+            result = false;
+            break;
+        }
+
+        F = sites[0]->getParent()->getParent();
+    }
+
+    for (const llvm::Function *C : chain)
+        runs_once[C] = result;
+
+    return result;
+}
+
+bool LLVMSingleInstanceAnalysis::isSingleInstance(const llvm::Value *alloc)
+{
+    using namespace llvm;
+
+    if (isa<GlobalVariable>(alloc))
+        return true;
+
+    const Instruction *I = dyn_cast<Instruction>(alloc);
+    if (!I)
+        return false;
+
+    if (!computed)
+        compute();
+
+    const Function *F = I->getParent()->getParent();
+    if (cyclic_blocks.count(I->getParent()) > 0 || recursive.count(F) > 0)
+        return false;
+
+    if (isa<AllocaInst>(I))
+        return true;
+
+    // the memory allocated on heap stays after the function returns
+    if (const CallInst *CI = dyn_cast<CallInst>(I)) {
+        const Function *callee
+            = dyn_cast<Function>(CI->getCalledValue()->stripPointerCasts());
+        if (info->getMemAllocationFunc(callee) != NONEMEM)
+            return runsOnce(F);
+    }
+
+    return false;
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
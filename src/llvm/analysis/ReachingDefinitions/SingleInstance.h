@@ -0,0 +1,93 @@
+#ifndef _LLVM_DG_RD_SINGLE_INSTANCE_H_
+#define _LLVM_DG_RD_SINGLE_INSTANCE_H_
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Value.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/analysis/ModuleInfo.h"
+
+namespace dg {
+
+class LLVMPointerAnalysis;
+
+namespace analysis {
+namespace rd {
+
+///
+// Which memory allocations have at most one instance whose contents
+// can be read at any time, so that a store to the only target of
+// a pointer overwrites the memory (a strong update).
+//
+// An allocation in a CFG cycle or in a recursive function
+// (see LLVMCallGraph) has more instances. A stack allocation dies
+// when its function returns, so otherwise it has one instance.
+// A heap allocation must also be in a function that runs at most
+// once: main or a function whose address is not taken and which has
+// a single call site, that runs at most once and is not in a cycle.
+// The globals have one instance.
+//
+// The information is computed for the whole module at the first
+// query, clear() drops it (when the module changes).
+class LLVMSingleInstanceAnalysis
+{
+    const llvm::Module *M;
+    LLVMPointerAnalysis *PTA;
+    LLVMModuleInfo *info;
+    bool computed = false;
+
+    // the blocks in a CFG cycle
+    std::unordered_set<const llvm::BasicBlock *> cyclic_blocks;
+    // the functions that can call themselves
+    std::unordered_set<const llvm::Function *> recursive;
+    // the defined functions that run at most once (true) or may run
+    // more times (false), filled lazily by runsOnce()
+    std::unordered_map<const llvm::Function *, bool> runs_once;
+
+    void addCyclicBlocks(const llvm::Function& F);
+    void compute();
+    bool runsOnce(const llvm::Function *F);
+
+public:
+    LLVMSingleInstanceAnalysis(const llvm::Module *m, LLVMPointerAnalysis *pta,
+                               LLVMModuleInfo *info)
+        : M(m), PTA(pta), info(info) {}
+
+    // does the memory allocated by @alloc (an alloca, a call
+    // of an allocation function or a global) have one instance?
+    bool isSingleInstance(const llvm::Value *alloc);
+
+    void clear()
+    {
+        computed = false;
+        cyclic_blocks.clear();
+        recursive.clear();
+        runs_once.clear();
+    }
+};
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
+
+#endif // _LLVM_DG_RD_SINGLE_INSTANCE_H_
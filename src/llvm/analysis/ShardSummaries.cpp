@@ -0,0 +1,303 @@
+#include <cassert>
+#include <set>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "ShardSummaries.h"
+
+namespace dg {
+namespace analysis {
+
+static void addArgument(FunctionSummary::Arguments& args, unsigned i)
+{
+    if (i < 64)
+        args.bits |= uint64_t(1) << i;
+    else if (i < args.from)
+        args.from = i;
+}
+
+static bool sameArguments(const FunctionSummary::Arguments& a,
+                          const FunctionSummary::Arguments& b)
+{
+    return a.bits == b.bits && a.from == b.from;
+}
+
+static bool sameSummaries(const FunctionSummary& a, const FunctionSummary& b)
+{
+    return sameArguments(a.mod, b.mod) && sameArguments(a.ref, b.ref)
+           && a.ret == b.ret && a.ret_arg == b.ret_arg;
+}
+
+void LLVMShardSummaries::addTargets(const llvm::Value *ptr, TargetsT& targets,
+                                    bool& unknown)
+{
+    pta::PSNode *op = PTA->getPointsTo(ptr);
+    if (!op) {
+        // null, undef and similar constants
+        if (!llvm::isa<llvm::Constant>(ptr))
+            unknown = true;
+        return;
+    }
+
+    for (const pta::Pointer& p : op->pointsTo) {
+        if (p.isUnknown())
+            unknown = true;
+        else if (p.isValid())
+            targets.insert(p.target);
+    }
+}
+
+const LLVMShardSummaries::Effects&
+LLVMShardSummaries::getEffects(const llvm::Function *F)
+{
+    using namespace llvm;
+
+    auto it = effects.find(F);
+    if (it != effects.end())
+        return it->second;
+
+    Effects& E = effects[F];
+    for (const Argument& A : F->args()) {
+        E.arguments.emplace_back();
+        if (A.getType()->isPointerTy()) {
+            bool unknown = false;
+            addTargets(&A, E.arguments.back(), unknown);
+        }
+    }
+
+    for (const BasicBlock& B : *F) {
+        for (const Instruction& Inst : B) {
+            if (const LoadInst *LI = dyn_cast<LoadInst>(&Inst)) {
+                addTargets(LI->getPointerOperand(), E.ref, E.unknown);
+            } else if (const StoreInst *SI = dyn_cast<StoreInst>(&Inst)) {
+                addTargets(SI->getPointerOperand(), E.mod, E.unknown);
+            } else if (const AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&Inst)) {
+                addTargets(RMW->getPointerOperand(), E.mod, E.unknown);
+                addTargets(RMW->getPointerOperand(), E.ref, E.unknown);
+            } else if (const AtomicCmpXchgInst *CX
+                        = dyn_cast<AtomicCmpXchgInst>(&Inst)) {
+                addTargets(CX->getPointerOperand(), E.mod, E.unknown);
+                addTargets(CX->getPointerOperand(), E.ref, E.unknown);
+            } else if (const CallInst *CI = dyn_cast<CallInst>(&Inst)) {
+                E.calls.push_back(CI);
+            } else if (const ReturnInst *RI = dyn_cast<ReturnInst>(&Inst)) {
+                const Value *val = RI->getReturnValue();
+                if (val && val->getType()->isPointerTy())
+                    addTargets(val, E.ret, E.ret_unknown);
+            }
+        }
+    }
+
+    return E;
+}
+
+const FunctionSummary *
+LLVMShardSummaries::getCalleeSummary(const llvm::Function *F) const
+{
+    if (functions.count(F) > 0) {
+        if (unsummarized.count(F) > 0)
+            return nullptr;
+
+        auto it = current.find(F);
+        assert(it != current.end() && "The callee was not summarized yet");
+        return &it->second;
+    }
+
+    // the function of other shard
+    if (!F->hasName())
+        return nullptr;
+    return boundary.get(F->getName().str());
+}
+
+bool LLVMShardSummaries::addCall(const llvm::CallInst *CI,
+                                 TargetsT& mod, TargetsT& ref)
+{
+    using namespace llvm;
+
+    bool unknown = false;
+    // add the memory of the arguments of the call,
+    // all the memory passed to the call if @S is nullptr
+    auto addArguments = [&](const FunctionSummary *S) {
+        for (unsigned a = 0; a < CI->getNumArgOperands(); ++a) {
+            const Value *arg = CI->getArgOperand(a);
+            if (!arg->getType()->isPointerTy())
+                continue;
+
+            if (!S || S->mod.contains(a))
+                addTargets(arg, mod, unknown);
+            if (!S || S->ref.contains(a))
+                addTargets(arg, ref, unknown);
+        }
+    };
+
+    const Value *calledVal = CI->getCalledValue()->stripPointerCasts();
+    if (isa<InlineAsm>(calledVal)) {
+        addArguments(nullptr);
+        return !unknown;
+    }
+
+    const LLVMCallGraph::CallSite& cs = PTA->getCallGraph().getCallSite(CI);
+    if (cs.unresolved)
+        return false;
+
+    for (const Function *F : cs.targets) {
+        if (F->isDeclaration()) {
+            // undefined function (memcpy, ...) touches the memory
+            // passed to it (only the memory in its summary if it has one)
+            addArguments(PTA->getModuleInfo()->getSummary(F));
+            continue;
+        }
+
+        const FunctionSummary *S = getCalleeSummary(F);
+        if (!S)
+            return false;
+        addArguments(S);
+    }
+
+    return !unknown;
+}
+
+bool LLVMShardSummaries::describe(const llvm::Function *F, const Effects& E,
+                                  const TargetsT& targets,
+                                  FunctionSummary::Arguments& args) const
+{
+    using namespace llvm;
+
+    LLVMCallGraph& CG = PTA->getCallGraph();
+    bool recursive = CG.isRecursive(CG.getId(F));
+
+    for (pta::PSNode *target : targets) {
+        const Value *val = target->getUserData<Value>();
+        // the globals may be touched directly, not only via the arguments
+        if (!val || isa<GlobalVariable>(val))
+            return false;
+
+        bool found = false;
+        for (unsigned i = 0; i < E.arguments.size(); ++i) {
+            if (E.arguments[i].count(target) > 0) {
+                addArgument(args, i);
+                found = true;
+            }
+        }
+
+        if (found)
+            continue;
+
+        // the local memory of the function is not visible to the callers,
+        // unless it may be the memory of other instance of the function
+        const AllocaInst *AI = dyn_cast<AllocaInst>(val);
+        if (!recursive && AI && AI->getParent()->getParent() == F)
+            continue;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool LLVMShardSummaries::summarize(const llvm::Function *F, FunctionSummary& S)
+{
+    const Effects& E = getEffects(F);
+    if (E.unknown)
+        return false;
+
+    TargetsT mod = E.mod, ref = E.ref;
+    for (const llvm::CallInst *CI : E.calls) {
+        if (!addCall(CI, mod, ref))
+            return false;
+    }
+
+    if (!describe(F, E, mod, S.mod) || !describe(F, E, ref, S.ref))
+        return false;
+
+    // the returned pointer points into the memory of an argument
+    if (!E.ret_unknown && !E.ret.empty()) {
+        for (unsigned i = 0; i < E.arguments.size(); ++i) {
+            const TargetsT& arg = E.arguments[i];
+            bool contains = true;
+            for (pta::PSNode *target : E.ret)
+                contains &= arg.count(target) > 0;
+
+            if (contains) {
+                S.ret = FunctionSummary::Return::ARGUMENT;
+                S.ret_arg = i;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void LLVMShardSummaries::compute(const LLVMCallGraph::Shard& shard)
+{
+    LLVMCallGraph& CG = PTA->getCallGraph();
+    const std::vector<const llvm::Function *>& funcs = CG.getFunctions();
+
+    for (unsigned i : shard.functions)
+        functions.insert(funcs[i]);
+
+    // the components of the shard are consecutive and in the bottom-up
+    // order, so the components that a component calls are summarized
+    // before it. The summaries of a component start empty and only grow,
+    // so iterating them until they do not change terminates
+    size_t begin = 0;
+    while (begin < shard.functions.size()) {
+        unsigned comp = CG.getComponentId(shard.functions[begin]);
+        size_t end = begin;
+        while (end < shard.functions.size()
+               && CG.getComponentId(shard.functions[end]) == comp)
+            current[funcs[shard.functions[end++]]] = FunctionSummary();
+
+        bool changed;
+        do {
+            changed = false;
+            for (size_t j = begin; j < end; ++j) {
+                const llvm::Function *F = funcs[shard.functions[j]];
+                if (unsummarized.count(F) > 0)
+                    continue;
+
+                FunctionSummary S;
+                if (!summarize(F, S)) {
+                    unsummarized.insert(F);
+                    changed = true;
+                } else if (!sameSummaries(S, current[F])) {
+                    current[F] = S;
+                    changed = true;
+                }
+            }
+        } while (changed);
+
+        begin = end;
+    }
+
+    for (unsigned i : shard.functions) {
+        const llvm::Function *F = funcs[i];
+        if (F->hasName() && unsummarized.count(F) == 0)
+            summaries.set(F->getName().str(), current[F]);
+    }
+}
+
+} // namespace analysis
+} // namespace dg
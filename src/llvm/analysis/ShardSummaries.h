@@ -0,0 +1,112 @@
+#ifndef _LLVM_DG_SHARD_SUMMARIES_H_
+#define _LLVM_DG_SHARD_SUMMARIES_H_
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "llvm/analysis/CallGraph.h"
+#include "llvm/analysis/FunctionSummaries.h"
+
+// forward declaration of llvm classes
+namespace llvm {
+    class Function;
+    class CallInst;
+    class Value;
+} // namespace llvm
+
+namespace dg {
+
+class LLVMPointerAnalysis;
+
+namespace analysis {
+
+namespace pta {
+class PSNode;
+}
+
+///
+// The summaries of the defined functions of one shard of the call graph
+// (see LLVMCallGraph::partition()) in the form of the summaries
+// of undefined functions (FunctionSummary): the arguments whose memory
+// the function (or the functions it calls) may write and read
+// and the argument that the returned pointer points into.
+//
+// The shard is summarized on its own: the calls of the functions
+// of the other shards are given by the @boundary summaries (written
+// for the shards below, possibly by other runs), the bodies of these
+// functions are not looked at. The functions of the shard are summarized
+// bottom-up over their components, the summaries of a recursive component
+// are iterated until they do not change. A shard never splits
+// a component, so summarizing the shards in the bottom-up order gives
+// the fixpoint of the whole module. The memory that the instructions
+// touch is taken from the points-to information of the whole module.
+//
+// A function gets no summary if it may touch a memory that the summary
+// cannot describe: a global, an unknown memory or a memory that is not
+// passed to it (e.g. the memory pointed to by the memory of an argument),
+// or if it calls a function that has no summary (a defined function
+// of other shard or a call via an unresolved pointer). The undefined
+// functions without a summary touch the memory passed to them,
+// as in the other analyses.
+class LLVMShardSummaries
+{
+public:
+    LLVMShardSummaries(LLVMPointerAnalysis *pta, const FunctionSummaries& boundary)
+        : PTA(pta), boundary(boundary) {}
+
+    // summarize the functions of @shard,
+    // the shards it calls must be in the boundary summaries
+    void compute(const LLVMCallGraph::Shard& shard);
+
+    // the summaries of the functions of the shard that have one
+    const FunctionSummaries& getSummaries() const { return summaries; }
+
+private:
+    using TargetsT = std::set<pta::PSNode *>;
+
+    // the memory touched by the instructions of a function
+    // and the calls in the function
+    struct Effects {
+        TargetsT mod, ref;
+        bool unknown = false;
+        std::vector<const llvm::CallInst *> calls;
+        // the memory of the arguments (the pointer arguments only)
+        std::vector<TargetsT> arguments;
+        // the targets of the returned pointers
+        TargetsT ret;
+        bool ret_unknown = false;
+    };
+
+    LLVMPointerAnalysis *PTA;
+    const FunctionSummaries& boundary;
+    FunctionSummaries summaries;
+
+    std::unordered_map<const llvm::Function *, Effects> effects;
+    // the summaries of the functions of the shard computed so far
+    // and the functions of the shard that cannot be summarized
+    std::unordered_map<const llvm::Function *, FunctionSummary> current;
+    std::unordered_set<const llvm::Function *> unsummarized;
+    // the functions of the shard
+    std::unordered_set<const llvm::Function *> functions;
+
+    void addTargets(const llvm::Value *ptr, TargetsT& targets, bool& unknown);
+    const Effects& getEffects(const llvm::Function *F);
+    // the summary of the function @F called from the shard,
+    // nullptr if the function has no summary
+    const FunctionSummary *getCalleeSummary(const llvm::Function *F) const;
+    // add the memory that the call @CI touches to @mod and @ref,
+    // returns false if the call cannot be summarized
+    bool addCall(const llvm::CallInst *CI, TargetsT& mod, TargetsT& ref);
+    // describe the @targets by the arguments of @F,
+    // returns false if it is not possible
+    bool describe(const llvm::Function *F, const Effects& E,
+                  const TargetsT& targets, FunctionSummary::Arguments& args) const;
+    bool summarize(const llvm::Function *F, FunctionSummary& S);
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _LLVM_DG_SHARD_SUMMARIES_H_
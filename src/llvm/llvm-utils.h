@@ -43,8 +43,25 @@ inline bool isPointerOrIntegerTy(const Type *Ty)
     return Ty->isPointerTy() || Ty->isIntegerTy();
 }
 
+// how much the prototype of a function called via a pointer
+// must match the call (see callIsCompatible())
+enum class CallCompatibility {
+    // the integers and pointers may be passed for each other,
+    // since they are often cast in the calls (the default)
+    LOOSE,
+    // the types must be the same, only the pointers may point
+    // to different types and the returned value may be ignored
+    STRICT
+};
+
+inline bool typesMatch(const Type *CTy, const Type *ATy)
+{
+    return CTy == ATy || (CTy->isPointerTy() && ATy->isPointerTy());
+}
+
 // can the given function be called by the given call inst?
-inline bool callIsCompatible(const Function *F, const CallInst *CI)
+inline bool callIsCompatible(const Function *F, const CallInst *CI,
+                             CallCompatibility level = CallCompatibility::LOOSE)
 {
     using namespace llvm;
 
@@ -56,7 +73,11 @@ inline bool callIsCompatible(const Function *F, const CallInst *CI)
             return false;
     }
 
-    if (!F->getReturnType()->canLosslesslyBitCastTo(CI->getType()))
+    if (level == CallCompatibility::STRICT) {
+        if (!CI->getType()->isVoidTy()
+            && !typesMatch(F->getReturnType(), CI->getType()))
+            return false;
+    } else if (!F->getReturnType()->canLosslesslyBitCastTo(CI->getType()))
         // it showed up that the loosless bitcast is too strict
         // alternative since we can use the constexpr castings
         if (!(isPointerOrIntegerTy(F->getReturnType()) && isPointerOrIntegerTy(CI->getType())))
@@ -67,6 +88,13 @@ inline bool callIsCompatible(const Function *F, const CallInst *CI)
         Type *CTy = CI->getArgOperand(idx)->getType();
         Type *ATy = A->getType();
 
+        if (level == CallCompatibility::STRICT) {
+            if (!typesMatch(CTy, ATy))
+                return false;
+
+            continue;
+        }
+
         if (!(isPointerOrIntegerTy(CTy) && isPointerOrIntegerTy(ATy)))
             if (!CTy->canLosslesslyBitCastTo(ATy))
                 return false;
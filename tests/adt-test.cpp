@@ -1,10 +1,20 @@
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
+#include <mutex>
+#include <vector>
 
 #include "test-runner.h"
 
 #include "ADT/Queue.h"
+#include "ADT/Arena.h"
+#include "ADT/IndexedMap.h"
+#include "ADT/Bitvector.h"
+#include "ADT/SmallPtrVector.h"
+#include "ADT/TaggedAllocator.h"
+#include "ADT/DGContainer.h"
+#include "analysis/Parallel.h"
+#include "analysis/Profiler.h"
 
 using namespace dg::ADT;
 
@@ -99,6 +109,514 @@ public:
     }
 };
 
+class TestPriorityWorklist : public Test
+{
+public:
+    TestPriorityWorklist() : Test("test priority worklist")
+    {}
+
+    struct Node {
+        unsigned rpo;
+    };
+
+    struct RPO {
+        size_t operator()(const Node *n) const { return n->rpo; }
+    };
+
+    void test()
+    {
+        PriorityWorklist<unsigned> queue(10);
+        check(queue.empty(), "empty queue not empty");
+
+        check(queue.push(13), "push failed");
+        check(queue.push(4), "push failed");
+        check(!queue.push(4), "pushed queued element");
+        check(queue.push(200), "push failed");
+        check(queue.push(2), "push failed");
+
+        check(queue.size() == 4, "BUG in size");
+        check(queue.contains(4), "BUG in contains");
+        check(!queue.contains(5), "BUG in contains");
+        check(!queue.contains(1000), "BUG in contains");
+
+        check(queue.pop() == 2, "Wrong pop order");
+        check(queue.pop() == 4, "Wrong pop order");
+        // push a lower priority than the popped ones
+        check(queue.push(1), "push failed");
+        check(queue.push(4), "push of popped element failed");
+        check(queue.pop() == 1, "Wrong pop order");
+        check(queue.pop() == 4, "Wrong pop order");
+        check(queue.pop() == 13, "Wrong pop order");
+        check(queue.pop() == 200, "Wrong pop order");
+        check(queue.empty(), "emptied queue not empty");
+
+        Node nodes[100];
+        PriorityWorklist<Node *, RPO> worklist;
+        for (unsigned i = 0; i < 100; ++i) {
+            nodes[i].rpo = 99 - i;
+            worklist.push(&nodes[i]);
+        }
+
+        for (unsigned i = 0; i < 100; ++i)
+            check(worklist.pop()->rpo == i, "Wrong pop order");
+        check(worklist.empty(), "emptied queue not empty");
+    }
+};
+
+class TestArena : public Test
+{
+    struct Counted {
+        int& alive;
+        int value;
+
+        Counted(int& a, int v) : alive(a), value(v) { ++alive; }
+        ~Counted() { --alive; }
+    };
+
+public:
+    TestArena() : Test("test arena")
+    {}
+
+    void test()
+    {
+        int alive = 0;
+        {
+            Arena<Counted> arena;
+            std::vector<Counted *> objs;
+            // more than fits into the first chunk
+            for (int i = 0; i < 1000; ++i)
+                objs.push_back(arena.create(alive, i));
+
+            check(arena.size() == 1000, "BUG in size");
+            check(alive == 1000, "Not all objects constructed");
+
+            bool ok = true;
+            for (int i = 0; i < 1000; ++i)
+                ok &= objs[i]->value == i;
+            check(ok, "Objects overwritten");
+
+            arena.clear();
+            check(alive == 0, "Objects not destroyed on clear");
+            check(arena.size() == 0, "BUG in size");
+
+            arena.create(alive, 1);
+            arena.create(alive, 2);
+        }
+
+        check(alive == 0, "Objects not destroyed with arena");
+    }
+};
+
+class TestPool : public Test
+{
+public:
+    TestPool() : Test("test pool")
+    {}
+
+    void test()
+    {
+        Pool<long> pool;
+        std::vector<long *> objs;
+        for (int i = 0; i < 1000; ++i) {
+            objs.push_back(static_cast<long *>(pool.allocate()));
+            *objs.back() = i;
+        }
+
+        check(pool.size() == 1000, "BUG in size");
+        check(pool.chunksNum() > 1, "Expected more chunks");
+
+        bool ok = true;
+        for (int i = 0; i < 1000; ++i)
+            ok &= *objs[i] == i;
+        check(ok, "Objects overwritten");
+
+        // freed memory is reused
+        void *freed = objs[10];
+        pool.deallocate(freed);
+        check(pool.allocate() == freed, "Freed memory not reused");
+
+        for (long *o : objs)
+            pool.deallocate(o);
+
+        check(pool.size() == 0, "BUG in size");
+        check(pool.chunksNum() == 0, "Memory not released");
+
+        ArrayArena<int *> arena;
+        int **arr = arena.allocate(3);
+        check(!arr[0] && !arr[1] && !arr[2], "Array not initialized");
+        int **big = arena.allocate(10000);
+        int **next = arena.allocate(2);
+        check(next == arr + 3, "Not allocated from the same chunk");
+        check(big[9999] == nullptr, "Array not initialized");
+        check(arena.chunksNum() == 2, "BUG in chunks");
+
+        arena.clear();
+        check(arena.chunksNum() == 0, "Memory not released");
+    }
+};
+
+class TestAllocationStats : public Test
+{
+    struct Param : public TaggedObject<AllocTag::PARAMETERS> {
+        long a, b;
+    };
+
+public:
+    TestAllocationStats() : Test("test allocation stats")
+    {}
+
+    void test()
+    {
+        AllocationStats::enable();
+        // compiled out with NO_ALLOCATION_STATS
+        if (!AllocationStats::isEnabled())
+            return;
+
+        AllocationStats::reset();
+        const AllocationStats::Counters& sets = AllocationStats::get(AllocTag::PTA_SETS);
+        {
+            std::vector<int, TaggedAllocator<int, AllocTag::PTA_SETS>> V;
+            V.reserve(100);
+            check(sets.allocations == 1, "Allocation not counted");
+            check(sets.bytes == 100 * sizeof(int), "Wrong bytes");
+            check(sets.live == 100 * sizeof(int), "Wrong live bytes");
+        }
+        check(sets.frees == 1 && sets.live == 0, "Free not counted");
+        check(sets.peak == 100 * sizeof(int), "Wrong peak");
+
+        const AllocationStats::Counters& params = AllocationStats::get(AllocTag::PARAMETERS);
+        Param *p = new Param();
+        check(params.allocations == 1 && params.live == sizeof(Param),
+              "Object not counted");
+        delete p;
+        check(params.frees == 1 && params.live == 0, "Object free not counted");
+
+        // the small containers do not allocate
+        const AllocationStats::Counters& edges = AllocationStats::get(AllocTag::DG_EDGES);
+        {
+            DGContainer<int, 4> C;
+            for (int i = 0; i < 4; ++i)
+                C.insert(i);
+            check(edges.allocations == 0, "Small container allocated");
+            C.insert(5);
+            check(edges.allocations == 1, "Allocation not counted");
+        }
+        check(edges.live == 0, "Free not counted");
+
+        const AllocationStats::Counters& objs = AllocationStats::get(AllocTag::MEMORY_OBJECTS);
+        {
+            Arena<long, AllocTag::MEMORY_OBJECTS> arena;
+            arena.create(1);
+            check(objs.allocations == 1 && objs.live >= sizeof(long),
+                  "Arena chunk not counted");
+        }
+        check(objs.frees == 1 && objs.live == 0, "Arena chunk free not counted");
+
+        // nothing leaked to the other tags
+        check(AllocationStats::get(AllocTag::RD_MAPS).allocations == 0,
+              "Counted to a wrong tag");
+
+        AllocationStats::enable(false);
+        {
+            std::vector<int, TaggedAllocator<int, AllocTag::PTA_SETS>> V(10);
+        }
+        check(sets.allocations == 1, "Counted while disabled");
+        AllocationStats::reset();
+    }
+};
+
+class TestIndexedMap : public Test
+{
+public:
+    TestIndexedMap() : Test("test indexed map")
+    {}
+
+    void test()
+    {
+        IndexedMap<int, int> M;
+        check(M.empty() && M.begin() == M.end(), "Map not empty");
+
+        check(M.insert(std::make_pair(3, 30)).second, "Not inserted");
+        check(M.emplace(1, 10).second, "Not inserted");
+        check(!M.emplace(3, 0).second, "Inserted twice");
+        M[2] = 20;
+        check(M.size() == 3, "BUG in size");
+        check(M.count(1) == 1 && M.count(4) == 0, "BUG in count");
+        check(M.find(2)->second == 20, "BUG in find");
+        check(M.find(4) == M.end(), "BUG in find");
+
+        // iterated in the order of insertion
+        std::vector<int> keys;
+        for (auto& it : M)
+            keys.push_back(it.first);
+        check(keys == std::vector<int>({3, 1, 2}), "Wrong order");
+
+        // erasing while iterating
+        for (auto& it : M) {
+            if (it.first != 2)
+                M.erase(it.first);
+        }
+
+        check(M.size() == 1 && M.begin()->first == 2, "BUG in erase");
+        check(M.find(3) == M.end(), "Found erased element");
+        check(M.emplace(3, 33).second && M.find(3)->second == 33,
+              "Erased element not inserted again");
+
+        M.clear();
+        check(M.empty() && M.begin() == M.end(), "Map not empty");
+    }
+};
+
+class TestBitvector : public Test
+{
+public:
+    TestBitvector() : Test("test bit vector")
+    {}
+
+    void test()
+    {
+        Bitvector A(100), B(100, true);
+        check(!A.any() && A.count() == 0, "Vector not empty");
+        // the bits past the size are not set
+        check(B.count() == 100, "Wrong count: %zu", B.count());
+
+        A.set(3);
+        A.set(64);
+        A.set(99);
+        check(A.get(3) && A.get(64) && A.get(99) && !A.get(4), "BUG in set");
+
+        std::vector<size_t> bits;
+        A.forEach([&bits](size_t i) { bits.push_back(i); });
+        check(bits == std::vector<size_t>({3, 64, 99}), "BUG in forEach");
+
+        Bitvector C(100);
+        C.set(64);
+        check(C.unionWith(A) && C == A, "BUG in union");
+        check(!C.unionWith(A), "Union changed the vector");
+
+        B.reset(3);
+        check(C.intersectWith(B) && C.count() == 2 && !C.get(3), "BUG in intersect");
+        check(!C.intersectWith(B), "Intersect changed the vector");
+
+        // out = gen | (in & ~kill)
+        Bitvector gen(100), kill(100), out(100);
+        gen.set(1);
+        kill.set(64);
+        check(out.assignTransfer(gen, A, kill), "Transfer did not change");
+        check(out.count() == 3 && out.get(1) && out.get(3) && out.get(99),
+              "BUG in transfer");
+        check(!out.assignTransfer(gen, A, kill), "Transfer changed again");
+
+        B.setAll();
+        check(B.count() == 100, "BUG in setAll");
+        B.resetAll();
+        check(!B.any(), "BUG in resetAll");
+
+        // more words than fit into one vector register and a tail
+        Bitvector X(300), Y(300);
+        for (size_t i = 0; i < 300; i += 3)
+            X.set(i);
+        for (size_t i = 0; i < 300; i += 5)
+            Y.set(i);
+
+        check(!X.isSubsetOf(Y) && !Y.isSubsetOf(X), "BUG in subset");
+
+        Bitvector U(X);
+        check(U.unionWith(Y) && X.isSubsetOf(U) && Y.isSubsetOf(U),
+              "BUG in union");
+        Bitvector I(X);
+        check(I.intersectWith(Y) && I.isSubsetOf(X) && I.isSubsetOf(Y),
+              "BUG in intersect");
+        Bitvector D(X);
+        check(D.differenceWith(Y), "Difference did not change");
+        check(!D.differenceWith(Y), "Difference changed again");
+
+        for (size_t i = 0; i < 300; ++i) {
+            bool x = i % 3 == 0, y = i % 5 == 0;
+            check(U.get(i) == (x || y), "BUG in union at %zu", i);
+            check(I.get(i) == (x && y), "BUG in intersect at %zu", i);
+            check(D.get(i) == (x && !y), "BUG in difference at %zu", i);
+        }
+
+        // the change only in the last word
+        Bitvector Z(I);
+        Z.set(299 - 299 % 15);
+        check(!Z.unionWith(I) && I.isSubsetOf(Z), "BUG in subset");
+        Z.set(299);
+        check(!Z.isSubsetOf(I) && I.unionWith(Z) && I == Z,
+              "BUG in union of the tail");
+
+        // growing keeps the bits, shrinking drops the tail
+        Z.resize(400);
+        check(Z.get(299) && !Z.get(300) && Z.count() == I.count(),
+              "BUG in resize");
+        Z.resize(299);
+        check(Z.size() == 299 && Z.count() == I.count() - 1, "BUG in resize");
+    }
+};
+
+class TestSmallPtrVector : public Test
+{
+public:
+    TestSmallPtrVector() : Test("test small pointer vector")
+    {}
+
+    void test()
+    {
+        int nums[10];
+        SmallPtrVector<int *, 2> V;
+        check(V.empty() && V.getAllocatedBytes() == 0, "Vector not empty");
+
+        V.push_back(&nums[0]);
+        V.push_back(&nums[1]);
+        check(V.size() == 2 && V.getAllocatedBytes() == 0,
+              "Short vector allocated memory");
+
+        for (int i = 2; i < 10; ++i)
+            V.push_back(&nums[i]);
+        check(V.size() == 10 && V.getAllocatedBytes() > 0, "BUG in growing");
+
+        int i = 0;
+        for (int *p : V)
+            check(p == &nums[i++], "Wrong element %d", i - 1);
+
+        // copy, erase and move
+        SmallPtrVector<int *, 2> C(V);
+        C.erase(C.begin() + 1, C.end() - 1);
+        check(C.size() == 2 && C[0] == &nums[0] && C[1] == &nums[9],
+              "BUG in erase");
+        check(V.size() == 10, "Copy changed the original");
+
+        SmallPtrVector<int *, 2> M(std::move(V));
+        check(M.size() == 10 && V.empty(), "BUG in move");
+
+        M.swap(C);
+        check(M.size() == 2 && C.size() == 10 && C.back() == &nums[9],
+              "BUG in swap");
+
+        ArrayView<int *> view = M;
+        check(view.size() == 2 && view[1] == &nums[9], "BUG in view");
+
+        M.clear();
+        check(M.empty(), "BUG in clear");
+    }
+};
+
+class TestProfiler : public Test
+{
+public:
+    TestProfiler() : Test("test profiler")
+    {}
+
+    void test()
+    {
+        using dg::analysis::Profiler;
+
+        // no active profiler, nothing happens
+        {
+            Profiler::Scope phase("nothing");
+            Profiler::count("nothing");
+        }
+
+        Profiler P;
+        check(Profiler::get() == &P, "Profiler not active");
+
+        for (int i = 0; i < 2; ++i) {
+            Profiler::Scope phase("A");
+            Profiler::count("a", 2);
+            {
+                Profiler::Scope nested("B");
+                Profiler::count("b");
+            }
+        }
+
+        {
+            Profiler::Scope phase("B");
+        }
+
+        P.finish();
+
+        // total -> A -> B, total -> B
+        const auto& phases = P.getPhases();
+        check(phases.size() == 4, "Wrong number of phases");
+        check(phases[0].children.size() == 2, "Wrong children of root");
+
+        const auto& A = phases[phases[0].children[0]];
+        check(A.name == "A" && A.runs == 2, "Runs of the same phase not summed");
+        check(A.counters.size() == 1 && A.counters[0].second == 4,
+              "Counters not summed");
+        check(A.children.size() == 1, "Wrong children of A");
+
+        const auto& AB = phases[A.children[0]];
+        check(AB.name == "B" && AB.runs == 2 && AB.counters[0].second == 2,
+              "Wrong nested phase");
+        check(AB.wall <= A.wall, "Nested phase took longer than parent");
+
+        const auto& B = phases[phases[0].children[1]];
+        check(B.name == "B" && B.runs == 1 && B.counters.empty(),
+              "Phases with different parents merged");
+    }
+};
+
+class TestParallel : public Test
+{
+public:
+    TestParallel() : Test("test parallel primitives")
+    {}
+
+    void parallel_for(unsigned threads)
+    {
+        std::vector<unsigned> done(1000, 0);
+        std::vector<unsigned> by(1000, ~0U);
+        dg::analysis::parallelFor(done.size(), threads,
+                                  [&](size_t i, unsigned t) {
+            ++done[i];
+            by[i] = t;
+        });
+
+        for (size_t i = 0; i < done.size(); ++i) {
+            check(done[i] == 1, "An index not processed exactly once");
+            check(by[i] < threads || (threads == 0 && by[i] == 0),
+                  "Invalid index of thread");
+        }
+    }
+
+    void task_graph(unsigned threads)
+    {
+        using dg::analysis::TaskGraph;
+
+        // 0 -> 1 -> 3, 0 -> 2 -> 3, 4 alone
+        TaskGraph tasks(5);
+        tasks.addDependence(0, 1);
+        tasks.addDependence(0, 2);
+        tasks.addDependence(1, 3);
+        tasks.addDependence(2, 3);
+
+        std::mutex mtx;
+        std::vector<size_t> order;
+        tasks.run(threads, [&](size_t i) {
+            std::lock_guard<std::mutex> guard(mtx);
+            order.push_back(i);
+        });
+
+        check(order.size() == 5, "Not all the tasks run");
+        std::vector<size_t> pos(5);
+        for (size_t i = 0; i < order.size(); ++i)
+            pos[order[i]] = i;
+
+        check(pos[0] < pos[1] && pos[0] < pos[2], "Task run before its dependence");
+        check(pos[1] < pos[3] && pos[2] < pos[3], "Task run before its dependence");
+    }
+
+    void test()
+    {
+        for (unsigned threads : {0U, 1U, 4U}) {
+            parallel_for(threads);
+            task_graph(threads);
+        }
+    }
+};
+
 }; // namespace tests
 }; // namespace dg
 
@@ -110,6 +628,15 @@ int main()
     Runner.add(new TestLIFO());
     Runner.add(new TestFIFO());
     Runner.add(new TestPrioritySet());
+    Runner.add(new TestPriorityWorklist());
+    Runner.add(new TestArena());
+    Runner.add(new TestPool());
+    Runner.add(new TestAllocationStats());
+    Runner.add(new TestIndexedMap());
+    Runner.add(new TestBitvector());
+    Runner.add(new TestSmallPtrVector());
+    Runner.add(new TestProfiler());
+    Runner.add(new TestParallel());
 
     return Runner();
 }
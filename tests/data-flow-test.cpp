@@ -1,10 +1,13 @@
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
+#include <map>
+#include <vector>
 
 #include "test-runner.h"
 #include "test-dg.h"
 #include "analysis/DataFlowAnalysis.h"
+#include "analysis/BitVectorDataFlow.h"
 
 namespace dg {
 namespace tests {
@@ -38,6 +41,8 @@ public:
     {
         run_nums_test();
         run_nums_test_interproc();
+        run_worklist_test(analysis::DATAFLOW_WORKLIST);
+        run_worklist_test(analysis::DATAFLOW_SCC);
     };
 
     TestDG *create_circular_graph(size_t nodes_num)
@@ -292,6 +297,152 @@ public:
 
         #undef NODES_NUM
     }
+
+    // with the worklist, only the blocks whose predecessors
+    // changed are processed again
+    void run_worklist_test(uint32_t flags)
+    {
+        #define NODES_NUM 10
+        TestDG *d = create_circular_graph(NODES_NUM);
+
+        DataFlowA dfa(d->getEntryBB(), no_change, flags);
+        dfa.run();
+
+        for (int i = 0; i < NODES_NUM; ++i) {
+            check(d->getNode(i)->counter == 1,
+                  "did not go through the node only one time but %d",
+                  d->getNode(i)->counter);
+
+            d->getNode(i)->counter = 0;
+        }
+
+        const analysis::DataFlowStatistics& stats = dfa.getStatistics();
+        check(stats.getBBlocksNum() == NODES_NUM, "wrong number of blocks: %d",
+              stats.getBBlocksNum());
+        check(stats.processedBlocks == NODES_NUM,
+              "processed more blocks than %d - %d", NODES_NUM, stats.processedBlocks);
+        check(stats.getIterationsNum() == 1, "did wrong number of iterations: %d",
+              stats.getIterationsNum());
+
+        // every block changes in the first run, but only the entry
+        // block (the successor of the last block) is processed again.
+        // The entry block is the block of the last node
+        DataFlowA dfa2(d->getEntryBB(), one_change, flags);
+        dfa2.run();
+
+        for (int i = 0; i < NODES_NUM; ++i) {
+            int expected = i == NODES_NUM - 1 ? 2 : 1;
+            check(d->getNode(i)->counter == expected,
+                  "went through the node %d %d times instead of %d",
+                  i, d->getNode(i)->counter, expected);
+
+            d->getNode(i)->counter = 0;
+        }
+
+        const analysis::DataFlowStatistics& stats2 = dfa2.getStatistics();
+        check(stats2.getBBlocksNum() == NODES_NUM, "wrong number of blocks: %d",
+              stats2.getBBlocksNum());
+        check(stats2.processedBlocks == NODES_NUM + 1,
+              "processed different num of blocks than %d - %d",
+              NODES_NUM + 1, stats2.processedBlocks);
+        check(stats2.getIterationsNum() == 2, "did wrong number of iterations: %d",
+              stats2.getIterationsNum());
+
+        #undef NODES_NUM
+    }
+};
+
+// the block i generates the fact i, the kills are given
+class GenKillA : public analysis::BitVectorDataFlowAnalysis<TestNode>
+{
+    std::map<TestBBlock *, std::vector<size_t>> kills;
+
+public:
+    GenKillA(TestBBlock *entry, size_t n, analysis::DataFlowDirection dir,
+             analysis::DataFlowMeet meet)
+        : analysis::BitVectorDataFlowAnalysis<TestNode>(entry, n, dir, meet) {}
+
+    void addKill(TestBBlock *B, size_t fact) { kills[B].push_back(fact); }
+
+    void getGenKill(TestBBlock *B, Bitvector& gen, Bitvector& kill) override
+    {
+        gen.set(B->getFirstNode()->getKey());
+        for (size_t fact : kills[B])
+            kill.set(fact);
+    }
+};
+
+class TestBitVectorDataFlow : public Test
+{
+public:
+    TestBitVectorDataFlow() : Test("bit-vector data flow analysis test")
+    {}
+
+    static std::vector<size_t> facts(const ADT::Bitvector& bv)
+    {
+        std::vector<size_t> ret;
+        bv.forEach([&ret](size_t i) { ret.push_back(i); });
+        return ret;
+    }
+
+    void test()
+    {
+        // 0 -> 1, 0 -> 2, 1 -> 3, 2 -> 3, 3 -> 1, 3 -> 4
+        TestBBlock *B[5];
+        for (int i = 0; i < 5; ++i)
+            B[i] = new TestBBlock(new TestNode(i));
+
+        B[0]->addSuccessor(B[1]);
+        B[0]->addSuccessor(B[2]);
+        B[1]->addSuccessor(B[3]);
+        B[2]->addSuccessor(B[3]);
+        B[3]->addSuccessor(B[1]);
+        B[3]->addSuccessor(B[4]);
+
+        using analysis::DataFlowDirection;
+        using analysis::DataFlowMeet;
+
+        // the facts that reach the blocks on some path
+        GenKillA may(B[0], 5, DataFlowDirection::FORWARD, DataFlowMeet::UNION);
+        may.addKill(B[3], 1);
+        may.run();
+
+        check(facts(may.getIn(B[1])) == std::vector<size_t>({0, 2, 3}),
+              "Wrong input of the block 1");
+        check(facts(may.getIn(B[3])) == std::vector<size_t>({0, 1, 2, 3}),
+              "Wrong input of the block 3");
+        check(facts(may.getOut(B[3])) == std::vector<size_t>({0, 2, 3}),
+              "Wrong output of the block 3");
+        check(may.getStatistics().getBBlocksNum() == 5, "Wrong number of blocks");
+
+        // the facts that reach the blocks on all paths
+        GenKillA must(B[0], 5, DataFlowDirection::FORWARD, DataFlowMeet::INTERSECTION);
+        must.addKill(B[3], 1);
+        must.run();
+
+        check(facts(must.getIn(B[1])) == std::vector<size_t>({0}),
+              "Wrong input of the block 1");
+        check(facts(must.getIn(B[3])) == std::vector<size_t>({0}),
+              "Wrong input of the block 3");
+        check(facts(must.getOut(B[4])) == std::vector<size_t>({0, 3, 4}),
+              "Wrong output of the block 4");
+
+        // the facts that are generated on some path from the block
+        // (like the liveness of variables)
+        GenKillA live(B[0], 5, DataFlowDirection::BACKWARD, DataFlowMeet::UNION);
+        live.addKill(B[1], 4);
+        live.run();
+
+        check(facts(live.getIn(B[1])) == std::vector<size_t>({1, 3}),
+              "Wrong input of the block 1");
+        check(facts(live.getOut(B[1])) == std::vector<size_t>({1, 3, 4}),
+              "Wrong output of the block 1");
+        check(facts(live.getIn(B[3])) == std::vector<size_t>({1, 3, 4}),
+              "Wrong input of the block 3");
+        check(facts(live.getIn(B[0])) == std::vector<size_t>({0, 1, 2, 3, 4}),
+              "Wrong input of the block 0");
+        check(facts(live.getOut(B[4])).empty(), "Wrong output of the block 4");
+    }
 };
 
 }; // namespace tests
@@ -303,6 +454,7 @@ int main(void)
     TestRunner Runner;
 
     Runner.add(new TestDataFlow());
+    Runner.add(new TestBitVectorDataFlow());
 
     return Runner();
 }
@@ -0,0 +1,344 @@
+// Microbenchmarks of the building blocks that dominate the profiles
+// of the analyses. Run with substrings of the names of the benchmarks
+// to run only those (e.g. dg-microbench RDMap Queue).
+//
+// The benchmarks of the containers and queues are templates over
+// the container, so an alternative implementation is compared
+// side by side by adding one more line to main().
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ADT/DGContainer.h"
+#include "ADT/Queue.h"
+#include "analysis/NodesWalk.h"
+#include "analysis/SCC.h"
+#include "analysis/PointsTo/PointerSubgraph.h"
+#include "analysis/ReachingDefinitions/RDMap.h"
+#include "analysis/ReachingDefinitions/ReachingDefinitions.h"
+
+#include "test-dg.h"
+
+using namespace dg;
+using dg::analysis::pta::PSNode;
+using dg::analysis::pta::PSNodeType;
+using dg::analysis::rd::DefSite;
+using dg::analysis::rd::RDMap;
+using dg::analysis::rd::RDNode;
+
+namespace {
+
+// keeps the results of the benchmarks, so that
+// the compiler cannot drop the computation
+volatile size_t sink;
+
+class Bench
+{
+    std::vector<std::string> filters;
+
+    bool selected(const std::string& name) const
+    {
+        if (filters.empty())
+            return true;
+
+        for (const std::string& f : filters) {
+            if (name.find(f) != std::string::npos)
+                return true;
+        }
+
+        return false;
+    }
+
+public:
+    Bench(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+            filters.push_back(argv[i]);
+    }
+
+    // run @body @iters times (once more untimed to warm up)
+    // and report the time of one iteration
+    template <typename FuncT>
+    void run(const std::string& name, unsigned iters, FuncT body)
+    {
+        if (!selected(name))
+            return;
+
+        body();
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < iters; ++i)
+            body();
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        printf("%-48s %14.1f ns/iter\n", name.c_str(), ns / iters);
+        fflush(stdout);
+    }
+};
+
+std::string sized(const char *name, const char *impl, size_t size)
+{
+    return std::string(name) + "/" + impl + "/" + std::to_string(size);
+}
+
+std::vector<unsigned> randomValues(size_t n, unsigned max, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<unsigned> dist(0, max);
+    std::vector<unsigned> vals(n);
+    for (unsigned& v : vals)
+        v = dist(gen);
+
+    return vals;
+}
+
+// the intersection for the containers without intersect()
+template <typename SetT>
+void intersectSets(SetT& A, const SetT& B)
+{
+    for (auto it = A.begin(); it != A.end();) {
+        if (B.count(*it) == 0)
+            it = A.erase(it);
+        else
+            ++it;
+    }
+}
+
+template <typename ValueT, unsigned int N, typename CompareT>
+void intersectSets(DGContainer<ValueT, N, CompareT>& A,
+                   const DGContainer<ValueT, N, CompareT>& B)
+{
+    A.intersect(B);
+}
+
+/// ------------------------------------------------------------------
+// the sets of the edges and the points-to information
+/// ------------------------------------------------------------------
+template <typename SetT>
+void benchSet(Bench& B, const char *impl, size_t size)
+{
+    // the values repeat, as the edges added more times do
+    std::vector<unsigned> vals = randomValues(size, size * 2, 1);
+    std::vector<unsigned> other = randomValues(size, size * 2, 2);
+
+    B.run(sized("Set.insert", impl, size), 100000 / size + 10, [&]() {
+        SetT S;
+        for (unsigned v : vals)
+            S.insert(v);
+        sink = S.size();
+    });
+
+    SetT S, O;
+    for (unsigned v : vals)
+        S.insert(v);
+    for (unsigned v : other)
+        O.insert(v);
+
+    B.run(sized("Set.iterate", impl, size), 1000000 / size + 10, [&]() {
+        size_t sum = 0;
+        for (unsigned v : S)
+            sum += v;
+        sink = sum;
+    });
+
+    B.run(sized("Set.intersect", impl, size), 100000 / size + 10, [&]() {
+        SetT I(S);
+        intersectSets(I, O);
+        sink = I.size();
+    });
+}
+
+/// ------------------------------------------------------------------
+// the worklists of the analyses
+/// ------------------------------------------------------------------
+template <typename QueueT>
+void benchQueue(Bench& B, const char *impl, size_t size)
+{
+    std::vector<unsigned> vals = randomValues(size, size * 4, 3);
+
+    B.run(sized("Queue.push-pop", impl, size), 100000 / size + 10, [&]() {
+        QueueT Q;
+        size_t sum = 0;
+        for (unsigned v : vals)
+            Q.push(v);
+        while (!Q.empty())
+            sum += Q.pop();
+        sink = sum;
+    });
+}
+
+/// ------------------------------------------------------------------
+// the maps of reaching definitions (supersedes rdmap-benchmark)
+/// ------------------------------------------------------------------
+void fillMap(RDMap& M, const std::vector<std::unique_ptr<RDNode>>& nodes,
+             std::mt19937& gen)
+{
+    size_t size = nodes.size();
+    std::uniform_int_distribution<size_t> node(0, size - 1);
+    std::uniform_int_distribution<uint64_t> off(0, 64);
+
+    for (size_t i = 0; i < size; ++i) {
+        DefSite ds(nodes[node(gen)].get(), off(gen) * 4, 4);
+        M.add(ds, nodes[node(gen)].get());
+        for (size_t j = 0; j < 3; ++j)
+            M.update(ds, nodes[node(gen)].get());
+    }
+}
+
+void benchRDMap(Bench& B, size_t size)
+{
+    std::vector<std::unique_ptr<RDNode>> nodes;
+    for (size_t i = 0; i < size; ++i)
+        nodes.emplace_back(new RDNode(dg::analysis::rd::STORE));
+
+    std::mt19937 gen(4);
+    RDMap A, O;
+    fillMap(A, nodes, gen);
+    fillMap(O, nodes, gen);
+
+    B.run(sized("RDMap.merge", "RDMap", size), 100000 / size + 10, [&]() {
+        RDMap M;
+        // merge into an unshared copy, as the analysis does
+        M.merge(&A);
+        M.add(DefSite(nodes[0].get(), 1000, 4), nodes[0].get());
+        M.merge(&O);
+        sink = M.size();
+    });
+
+    B.run(sized("RDMap.get", "RDMap", size), 100000 / size + 10, [&]() {
+        size_t num = 0;
+        for (size_t i = 0; i < size; ++i) {
+            std::set<RDNode *> ret;
+            num += A.get(nodes[i].get(), (i % 64) * 4, 8, ret);
+        }
+        sink = num;
+    });
+}
+
+/// ------------------------------------------------------------------
+// the points-to sets
+/// ------------------------------------------------------------------
+void benchPointsTo(Bench& B, size_t size)
+{
+    std::vector<std::unique_ptr<PSNode>> targets;
+    for (size_t i = 0; i < size; ++i)
+        targets.emplace_back(new PSNode(PSNodeType::ALLOC));
+
+    std::vector<unsigned> offs = randomValues(size, 16, 5);
+
+    B.run(sized("PSNode.addPointsTo", "PSNode", size), 100000 / size + 10, [&]() {
+        PSNode L(PSNodeType::LOAD, targets[0].get());
+        for (size_t i = 0; i < size; ++i)
+            L.addPointsTo(targets[i].get(), offs[i] * 4);
+        sink = L.pointsTo.size();
+    });
+
+    B.run(sized("PSNode.addPointsToUnknownOffset", "PSNode", size),
+          100000 / size + 10, [&]() {
+        PSNode L(PSNodeType::LOAD, targets[0].get());
+        for (size_t i = 0; i < size; ++i)
+            L.addPointsTo(targets[i].get(), offs[i] * 4);
+        for (size_t i = 0; i < size; i += 2)
+            L.addPointsToUnknownOffset(targets[i].get());
+        sink = L.pointsTo.size();
+    });
+}
+
+/// ------------------------------------------------------------------
+// the graph algorithms over synthetic graphs: a chain of nodes
+// with random forward edges and loops of random lengths
+/// ------------------------------------------------------------------
+std::vector<std::pair<size_t, size_t>> syntheticEdges(size_t size)
+{
+    std::mt19937 gen(6);
+    std::uniform_int_distribution<size_t> node(0, size - 1);
+    std::uniform_int_distribution<size_t> back(1, 32);
+
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (size_t i = 0; i + 1 < size; ++i) {
+        edges.emplace_back(i, i + 1);
+        size_t to = node(gen);
+        if (to > i)
+            edges.emplace_back(i, to);
+        if (i % 16 == 15)
+            edges.emplace_back(i, i - std::min(i, back(gen)));
+    }
+
+    return edges;
+}
+
+void benchSCC(Bench& B, size_t size)
+{
+    std::vector<std::unique_ptr<RDNode>> nodes;
+    for (size_t i = 0; i < size; ++i)
+        nodes.emplace_back(new RDNode());
+    for (const auto& e : syntheticEdges(size))
+        nodes[e.first]->addSuccessor(nodes[e.second].get());
+
+    B.run(sized("SCC.compute", "SCC", size), 10000000 / size + 10, [&]() {
+        analysis::SCC<RDNode> scc;
+        sink = scc.compute(nodes[0].get()).size();
+    });
+}
+
+void benchWalk(Bench& B, size_t size)
+{
+    using dg::tests::TestDG;
+    using dg::tests::TestNode;
+
+    TestDG d;
+    std::vector<TestNode *> nodes;
+    for (size_t i = 0; i < size; ++i) {
+        nodes.push_back(new TestNode(static_cast<int>(i)));
+        d.addNode(nodes.back());
+    }
+
+    // the walk goes backwards from the last node as the slicer does
+    for (const auto& e : syntheticEdges(size))
+        nodes[e.first]->addDataDependence(nodes[e.second]);
+
+    B.run(sized("NodesWalk.bfs", "REV_DD", size), 10000000 / size + 10, [&]() {
+        analysis::NodesWalk<TestNode, ADT::QueueFIFO<TestNode *>,
+                            analysis::NODES_WALK_REV_DD> walk;
+        size_t num = 0;
+        walk.walk(nodes.back(), [](TestNode *, size_t *n) { ++*n; }, &num);
+        sink = num;
+    });
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    Bench B(argc, argv);
+
+    for (size_t size : {4, 16, 128, 1024}) {
+        benchSet<DGContainer<unsigned>>(B, "DGContainer", size);
+        benchSet<std::set<unsigned>>(B, "std::set", size);
+    }
+
+    for (size_t size : {16, 1024, 65536}) {
+        benchQueue<ADT::QueueFIFO<unsigned>>(B, "QueueFIFO", size);
+        benchQueue<ADT::QueueLIFO<unsigned>>(B, "QueueLIFO", size);
+        benchQueue<ADT::PrioritySet<unsigned, std::less<unsigned>>>(B, "PrioritySet", size);
+    }
+
+    for (size_t size : {5, 20, 100, 500})
+        benchRDMap(B, size);
+
+    for (size_t size : {4, 64, 1024})
+        benchPointsTo(B, size);
+
+    for (size_t size : {1000, 100000}) {
+        benchSCC(B, size);
+        benchWalk(B, size);
+    }
+
+    return 0;
+}
@@ -1,12 +1,16 @@
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
+#include <set>
 
 #include "test-runner.h"
 
 #include "test-dg.h"
 
 #include "analysis/Slicing.h"
+#include "analysis/ReachabilityIndex.h"
+#include "analysis/ControlDependence.h"
+#include "analysis/ControlExpression/CFA.h"
 #include "DG2Dot.h"
 
 namespace dg {
@@ -133,6 +137,84 @@ public:
     }
 };
 
+class TestDeferredEdges : public Test
+{
+public:
+    TestDeferredEdges() : Test("deferred reverse edges test")
+    {}
+
+    void test()
+    {
+        TestNode n1(1), n2(2), n3(3);
+
+        TestNode::deferReverseEdges();
+        check(n1.addControlDependence(&n2), "adding C edge claims it is there");
+        check(!n1.addControlDependence(&n2), "adding C edge twice");
+        check(n1.addDataDependence(&n3), "adding D edge claims it is there");
+        n3.addIncomingDDs({&n2});
+
+        {
+            // this node is gone before the reverse edges are built
+            TestNode tmp(4);
+            tmp.addDataDependence(&n3);
+        }
+
+        check(n1.getControlDependenciesNum() == 1, "lost C edge");
+        check(n2.getDataDependenciesNum() == 1, "lost D edge");
+
+        // the reverse edges are built when asked for
+        check(n2.getRevControlDependenciesNum() == 1
+              && *n2.rev_control_begin() == &n1, "wrong reverse C edges");
+        check(n3.getRevDataDependenciesNum() == 2, "wrong reverse D edges");
+
+        // the edges added after that are deferred again
+        check(n2.addDataDependence(&n1), "adding D edge claims it is there");
+        check(n2.removeDataDependence(&n1), "removing deferred D edge");
+        check(n1.getRevDataDependenciesNum() == 0, "reverse D edge left");
+
+        n1.addDataDependence(&n2);
+        TestNode::deferReverseEdges(false);
+        check(!TestNode::reverseEdgesDeferred(), "still deferred");
+        check(n2.getRevDataDependenciesNum() == 1, "wrong reverse D edges");
+
+        n1.addControlDependence(&n3);
+        check(n3.getRevControlDependenciesNum() == 1, "wrong reverse C edges");
+
+        n1.isolate();
+        check(n2.getRevDataDependenciesNum() == 0
+              && n3.getRevDataDependenciesNum() == 1, "BUG in isolate");
+    }
+};
+
+class TestEdgesOrder : public Test
+{
+public:
+    TestEdgesOrder() : Test("edges order test")
+    {}
+
+    void test()
+    {
+        // the nodes get ids in the order of creation,
+        // whatever their addresses are
+        TestNode *nodes[4];
+        for (int i = 0; i < 4; ++i)
+            nodes[i] = new TestNode(i);
+
+        check(nodes[0]->getID() < nodes[1]->getID()
+              && nodes[1]->getID() < nodes[2]->getID(), "ids not ordered");
+
+        for (int i = 3; i > 0; --i)
+            nodes[0]->addDataDependence(nodes[i]);
+
+        int n = 1;
+        for (auto it = nodes[0]->data_begin(); it != nodes[0]->data_end(); ++it)
+            check(*it == nodes[n++], "edges not iterated in the order of ids");
+
+        for (int i = 0; i < 4; ++i)
+            delete nodes[i];
+    }
+};
+
 class TestContainer : public Test
 {
 public:
@@ -162,6 +244,58 @@ public:
 
         check(IT == IT2, "containers with same content does not equal");
 #endif
+
+        // grow over the inline elements
+        DGContainer<int, 2> C, C2;
+        for (int i : {5, 1, 4, 2, 3})
+            check(C.insert(i), "returned false with new element");
+        check(!C.insert(4), "double inserted element");
+        check(C.size() == 5, "size() bug");
+        check(std::is_sorted(C.begin(), C.end()), "elements are not sorted");
+        check(C.contains(3) && !C.contains(6), "contains() bug");
+
+        check(C.erase(1) == 1 && C.erase(1) == 0, "erase() bug");
+        check(C.size() == 4 && *C.begin() == 2, "erase() bug");
+
+        DGContainer<int, 2> copy(C);
+        check(copy == C, "copy does not equal");
+
+        C2.insert(3);
+        C2.insert(5);
+        C2.insert(7);
+        C.intersect(C2);
+        check(C.size() == 2 && C.contains(3) && C.contains(5),
+              "intersect() bug");
+
+        C.swap(copy);
+        check(C.size() == 4 && copy.size() == 2, "swap() bug");
+
+        // bulk insert merges the sorted elements
+        std::vector<int> elems{0, 2, 3, 6, 9};
+        check(copy.insert(elems.begin(), elems.end()) == 4,
+              "insert() of a range bug");
+        check(copy.size() == 6 && std::is_sorted(copy.begin(), copy.end()),
+              "insert() of a range bug");
+        check(copy.contains(0) && copy.contains(9) && copy.contains(5),
+              "insert() of a range bug");
+        check(copy.insert(elems.begin(), elems.end()) == 0,
+              "double inserted elements");
+
+        C.clear();
+        check(C.empty() && C.size() == 0, "clear() bug");
+
+        // grow over the threshold for the hash table
+        FlatParametersMap<int, int> P;
+        for (int i = 0; i < 40; ++i)
+            check(P.insert(i, 2*i), "returned false with new element");
+        check(!P.insert(3, 0) && !P.insert(30, 0), "double inserted element");
+        check(P.size() == 40 && P.begin()->first == 0, "size() bug");
+        check(*P.find(3) == 6 && *P.find(30) == 60 && !P.find(40),
+              "find() bug");
+
+        P.erase(3);
+        check(P.size() == 39 && !P.find(3), "erase() bug");
+        check(*P.find(39) == 78 && *P.find(38) == 76, "erase() bug");
     }
 };
 
@@ -241,6 +375,118 @@ public:
     }
 };
 
+class TestControlDependence : public Test
+{
+public:
+    TestControlDependence() : Test("control dependence test")
+    {}
+
+    void test()
+    {
+#if ENABLE_CFG
+        using analysis::ControlDependence;
+
+        // if-then-else
+        TestBBlock B1, B2, B3, B4, B5;
+        B1.addSuccessor(&B2);
+        B1.addSuccessor(&B3);
+        B2.addSuccessor(&B4);
+        B3.addSuccessor(&B4);
+        B4.addSuccessor(&B5);
+
+        ControlDependence<TestNode> CD;
+        CD.compute({&B1, &B2, &B3, &B4, &B5});
+        check(CD.getIPostDom(&B1) == &B4, "B4 should post-dominate B1");
+        check(CD.getIPostDom(&B2) == &B4, "B4 should post-dominate B2");
+        check(CD.getIPostDom(&B4) == &B5, "B5 should post-dominate B4");
+        check(CD.getIPostDom(&B5) == nullptr, "B5 is the exit");
+        check(CD.isControlDependent(&B2, &B1)
+              && CD.isControlDependent(&B3, &B1), "B2 and B3 depend on B1");
+        check(!CD.isControlDependent(&B4, &B1), "B4 does not depend on B1");
+        check(!CD.isControlDependent(&B1, &B1), "B1 does not depend on itself");
+
+        TestBBlock root;
+        CD.store(&root);
+        check(B1.getIPostDom() == &B4 && B5.getIPostDom() == &root,
+              "wrong post-dominator tree");
+        check(B1.controlDependence().size() == 2,
+              "B1 should have two control dependencies");
+        check(B2.getPostDomFrontiers().size() == 1
+              && *B2.getPostDomFrontiers().begin() == &B1,
+              "B1 should be the frontier of B2");
+
+        // a loop and an infinite loop after it
+        TestBBlock L, Body, I1, I2;
+        L.addSuccessor(&Body);
+        L.addSuccessor(&I1);
+        Body.addSuccessor(&L);
+        I1.addSuccessor(&I2);
+        I2.addSuccessor(&I1);
+
+        CD.compute({&L, &Body, &I1, &I2});
+        check(CD.getIPostDom(&Body) == &L, "L should post-dominate Body");
+        check(CD.getIPostDom(&L) == &I1, "I1 should post-dominate L");
+        check(CD.isControlDependent(&Body, &L)
+              && CD.isControlDependent(&L, &L), "the loop depends on L");
+        check(!CD.isControlDependent(&I1, &L), "I1 does not depend on L");
+        check(CD.getIPostDom(&I1) != nullptr || CD.getIPostDom(&I2) != nullptr,
+              "the infinite loop should have a post-dominator");
+#endif // ENABLE_CFG
+    }
+};
+
+class TestControlExpression : public Test
+{
+public:
+    TestControlExpression() : Test("control expression test")
+    {}
+
+    void test()
+    {
+        // a big switch: S jumps to one of the cases
+        // and all of them go to J
+        const int N = 2000;
+        CFA<int> cfa;
+        unsigned S = cfa.addNode(0);
+        unsigned J = cfa.addNode(N + 1);
+        for (int i = 1; i <= N; ++i) {
+            unsigned C = cfa.addNode(i);
+            cfa.addEdge(S, C);
+            cfa.addEdge(C, J);
+        }
+
+        ControlExpression CE = cfa.compute();
+        CE.computeSets();
+
+        auto scope = CE.getControlScope(0);
+        check(scope.size() == (size_t) N, "All cases should depend on S, "
+              "but %u do", (unsigned) scope.size());
+        for (CENode *nd : scope) {
+            int lab = static_cast<CELabel<int> *>(nd)->getLabel();
+            check(lab >= 1 && lab <= N, "Wrong label in the scope: %d", lab);
+        }
+
+        check(CE.getControlScope(N + 1).empty(), "Nothing depends on J");
+        check(CE.getControlScope(1).empty(), "Nothing depends on a case");
+
+        // a loop that goes back to the entry,
+        // the entry has a predecessor
+        CFA<int> loop;
+        unsigned E = loop.addNode(0);
+        unsigned L = loop.addNode(1);
+        unsigned X = loop.addNode(2);
+        loop.addEdge(E, L);
+        loop.addEdge(L, E);
+        loop.addEdge(L, X);
+        loop.setEntry(E);
+
+        ControlExpression LE = loop.compute();
+        LE.computeSets();
+        check(!LE.getLabels(0).empty(), "The entry is not in the expression");
+        check(LE.getControlScope(2).empty(), "Nothing depends on the exit");
+    }
+};
+
 class TestRemove : public Test
 {
 public:
@@ -667,13 +913,574 @@ public:
                                          "but has %u", B1->predecessorsNum());
         check (B1->successors().begin()->target == B1, "Succ of BB1 should be itself");
     }
+
+    // marking with the frozen graph gives the same slice
+    void test4()
+    {
+        TestDG d;
+        TestNode *n[6];
+        for (int i = 0; i < 6; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[3]);
+        n[4]->addControlDependence(n[3]);
+        n[5]->addDataDependence(n[4]);
+
+        analysis::FrozenGraph<TestNode> frozen;
+        frozen.freeze(&d);
+        check(frozen.size() == 6, "Should freeze all nodes");
+        // every edge is there twice (reversed)
+        check(frozen.getEdgesNum() == 8, "Should freeze all edges");
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.setFrozenGraph(&frozen);
+        slicer.mark(n[3], 1);
+        slicer.setFrozenGraph(nullptr);
+
+        for (int i = 0; i < 6; ++i)
+            check(n[i]->getSlice() == 1, "Node %d should be in the slice", i);
+
+        // n[1], n[2] and n[3] are not in the slice of n[4]
+        slicer.setFrozenGraph(&frozen);
+        slicer.mark(n[4], 2);
+        check(n[4]->getSlice() == 2 && n[5]->getSlice() == 2
+              && n[0]->getSlice() == 2, "Wrong slice of n[4]");
+        check(n[1]->getSlice() == 1 && n[2]->getSlice() == 1
+              && n[3]->getSlice() == 1, "Wrong slice of n[4]");
+    }
+
+    // marking more criteria at once gives the same slices
+    // as marking them one by one
+    void test5()
+    {
+        TestDG d;
+        TestNode *n[6];
+        for (int i = 0; i < 6; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[3]);
+        n[4]->addControlDependence(n[3]);
+        n[5]->addDataDependence(n[4]);
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.markMulti({{n[3]}, {n[4]}, {n[2], n[5]}});
+
+        slicer.markCriterion(1, 7);
+        check(n[4]->getSlice() == 7 && n[5]->getSlice() == 7
+              && n[0]->getSlice() == 7, "Wrong slice of n[4]");
+        check(n[1]->getSlice() != 7 && n[2]->getSlice() != 7
+              && n[3]->getSlice() != 7, "Wrong slice of n[4]");
+
+        slicer.markCriterion(0, 8);
+        for (int i = 0; i < 6; ++i)
+            check(n[i]->getSlice() == 8, "Node %d should be in the slice", i);
+
+        slicer.markCriterion(2, 9);
+        check(n[1]->getSlice() == 9 && n[2]->getSlice() == 9
+              && n[5]->getSlice() == 9 && n[0]->getSlice() == 9,
+              "Wrong slice of n[2] and n[5]");
+        check(n[3]->getSlice() == 8 && n[4]->getSlice() == 8,
+              "Wrong slice of n[2] and n[5]");
+    }
+
+    // a subgraph called from more call-sites (and recursively)
+    // is sliced once
+    void test6()
+    {
+        TestDG d, sub;
+        TestNode *n[4], *s[3];
+        for (int i = 0; i < 4; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+        for (int i = 0; i < 3; ++i) {
+            s[i] = new TestNode(i);
+            sub.addNode(s[i]);
+        }
+
+        d.setEntry(n[0]);
+        sub.setEntry(s[0]);
+        n[1]->addSubgraph(&sub);
+        n[2]->addSubgraph(&sub);
+        s[1]->addSubgraph(&sub);
+        s[1]->addDataDependence(n[2]);
+
+        analysis::Slicer<TestNode> slicer;
+        uint32_t sl_id = slicer.slice(n[2]);
+
+        check(d.size() == 2, "Should keep 2 nodes in the graph, "
+                             "but kept %u", d.size());
+        check(sub.size() == 2, "Should keep 2 nodes in the subgraph, "
+                               "but kept %u", sub.size());
+        for (auto& it : d)
+            check(it.second->getSlice() == sl_id, "Kept a node not in the slice");
+        for (auto& it : sub)
+            check(it.second->getSlice() == sl_id, "Kept a node not in the slice");
+    }
+
+    // marking with more threads gives the same slice
+    void test7()
+    {
+        // n[1] depends on 2000 nodes, every of them on one another
+        // node, the last 100 nodes are not in the slice
+        const int num = 4102;
+        TestDG d;
+        std::vector<TestNode *> n(num);
+        for (int i = 0; i < num; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        d.setEntry(n[0]);
+        for (int i = 2; i < 2002; ++i) {
+            n[i]->addDataDependence(n[1]);
+            n[i + 2000]->addControlDependence(n[i]);
+        }
+        for (int i = 4003; i < num; ++i)
+            n[i]->addDataDependence(n[i - 1]);
+
+        analysis::FrozenGraph<TestNode> frozen;
+        frozen.freeze(&d);
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.setFrozenGraph(&frozen);
+        slicer.setMarkThreads(4);
+        slicer.mark(n[1], 1);
+
+        for (int i = 0; i < 4002; ++i)
+            check(n[i]->getSlice() == 1, "Node %d should be in the slice", i);
+        for (int i = 4002; i < num; ++i)
+            check(n[i]->getSlice() != 1, "Node %d should not be in the slice", i);
+    }
+
+    // the context-sensitive slice does not go into the other call-site
+    void test8()
+    {
+        // main: x1 -> call1(a1i) -> a1o -> u
+        //       x2 -> call2(a2i) -> a2o
+        // f:    fi -> fo
+        TestDG d, f;
+        TestNode *entry = new TestNode(0);
+        TestNode *x1 = new TestNode(1), *c1 = new TestNode(2);
+        TestNode *x2 = new TestNode(3), *c2 = new TestNode(4);
+        TestNode *u = new TestNode(5);
+        for (TestNode *n : {entry, x1, c1, x2, c2, u})
+            d.addNode(n);
+        d.setEntry(entry);
+
+        TestNode *fentry = new TestNode(0);
+        f.addNode(fentry);
+        f.setEntry(fentry);
+        TestNode *fi = new TestNode(1), *fo = new TestNode(1);
+        fi->setDG(&f);
+        fo->setDG(&f);
+        f.setParameters(new DGParameters<TestNode>());
+        f.getParameters()->add(1, fi, fo);
+        fentry->addControlDependence(fi);
+        fentry->addControlDependence(fo);
+        fi->addDataDependence(fo);
+
+        TestNode *act[2][2];
+        TestNode *calls[2] = {c1, c2};
+        TestNode *defs[2] = {x1, x2};
+        for (int i = 0; i < 2; ++i) {
+            act[i][0] = new TestNode(1);
+            act[i][1] = new TestNode(1);
+            act[i][0]->setDG(&d);
+            act[i][1]->setDG(&d);
+            calls[i]->setParameters(new DGParameters<TestNode>(calls[i]));
+            calls[i]->getParameters()->add(1, act[i][0], act[i][1]);
+            calls[i]->addSubgraph(&f);
+            calls[i]->addControlDependence(fentry);
+            calls[i]->addControlDependence(act[i][0]);
+            calls[i]->addControlDependence(act[i][1]);
+            defs[i]->addDataDependence(act[i][0]);
+            act[i][0]->addDataDependence(fi);
+            fo->addDataDependence(act[i][1]);
+        }
+        act[0][1]->addDataDependence(u);
+
+        analysis::SummaryEdges<TestNode> summaries;
+        summaries.compute(&d);
+        check(summaries.size() == 2, "Should have 2 summary edges, "
+                                     "but have %u", summaries.size());
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.markContextSensitive({u}, summaries, 1);
+        for (TestNode *n : {entry, x1, c1, u, act[0][0], act[0][1],
+                            fentry, fi, fo})
+            check(n->getSlice() == 1, "Node %d should be in the slice",
+                  n->getKey());
+        for (TestNode *n : {x2, c2, act[1][0], act[1][1]})
+            check(n->getSlice() != 1, "Node %d should not be in the slice",
+                  n->getKey());
+
+        // the context-insensitive slice has all of them
+        slicer.mark(u, 2);
+        for (TestNode *n : {x2, c2, act[1][0]})
+            check(n->getSlice() == 2, "Node %d should be in the slice",
+                  n->getKey());
+    }
+
+    // forward slices and chops
+    void test9()
+    {
+        TestDG d;
+        TestNode *n[6];
+        for (int i = 0; i < 6; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        // n[1] -> n[2] -> n[3], n[4] -> n[2] -> n[5]
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[3]);
+        n[4]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[5]);
+
+        analysis::Slicer<TestNode> slicer;
+        uint32_t sl_id = slicer.markForward({n[1]});
+        for (int i : {0, 1, 2, 3, 5})
+            check(n[i]->getSlice() == sl_id, "Node %d should be in the slice", i);
+        check(n[4]->getSlice() != sl_id, "Node 4 should not be in the slice");
+
+        sl_id = slicer.chop({n[1]}, {n[3]});
+        for (int i : {0, 1, 2, 3})
+            check(n[i]->getSlice() == sl_id, "Node %d should be in the chop", i);
+        for (int i : {4, 5})
+            check(n[i]->getSlice() != sl_id, "Node %d should not be in the chop", i);
+    }
+
+    // a walk started from the callback of another walk
+    // does not break the marks of the first one
+    void test10()
+    {
+        TestDG d;
+        TestNode *n[5];
+        for (int i = 0; i < 5; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        for (int i = 0; i < 4; ++i)
+            n[i]->addDataDependence(n[i + 1]);
+        n[4]->addDataDependence(n[0]);
+
+        using WalkT = analysis::NodesWalk<TestNode, QueueFIFO<TestNode *>>;
+        struct Data {
+            int visits[5];
+            int inner;
+        } data = {{0, 0, 0, 0, 0}, 0};
+
+        WalkT outer(analysis::NODES_WALK_DD);
+        outer.walk(n[0], [](TestNode *nd, Data *dt) {
+            ++dt->visits[nd->getKey()];
+
+            WalkT inner(analysis::NODES_WALK_DD);
+            inner.walk(nd, [](TestNode *, Data *dt2) { ++dt2->inner; }, dt);
+        }, &data);
+
+        for (int i = 0; i < 5; ++i)
+            check(data.visits[i] == 1, "Node %d visited %d times",
+                  i, data.visits[i]);
+        check(data.inner == 25, "Inner walks visited %d nodes", data.inner);
+    }
+
+    // the control dependencies computed only when the walk gets
+    // into the graph (see DependenceGraph::ensureControlDependencies())
+    void test11()
+    {
+        struct LazyDG : public TestDG {
+            TestBBlock *branch = nullptr;
+            TestBBlock *dep = nullptr;
+            int computed = 0;
+
+            void ensureControlDependencies() override
+            {
+                if (computed++ == 0)
+                    branch->addControlDependence(dep);
+            }
+        };
+
+        LazyDG d[2];
+        TestNode *n[4];
+        TestBBlock *BB[4];
+        for (int i = 0; i < 4; ++i) {
+            LazyDG& g = d[i / 2];
+            n[i] = new TestNode(i);
+            g.addNode(n[i]);
+            BB[i] = new TestBBlock(n[i], &g);
+            if (i % 2 == 0) {
+                g.setEntry(n[i]);
+                g.branch = BB[i];
+            } else {
+                BB[i - 1]->addSuccessor(BB[i]);
+                g.dep = BB[i];
+            }
+        }
+
+        analysis::Slicer<TestNode> slicer;
+        uint32_t sl_id = slicer.mark(n[1]);
+        check(d[0].computed > 0, "Should compute the CD of the first graph");
+        check(d[1].computed == 0, "Should not compute the CD of the second graph");
+        check(n[0]->getSlice() == sl_id, "The branch should be in the slice");
+        check(n[2]->getSlice() != sl_id && n[3]->getSlice() != sl_id,
+              "The second graph should not be in the slice");
+
+        slicer.markMulti({{n[1]}});
+        sl_id = slicer.markCriterion(0);
+        check(n[0]->getSlice() == sl_id, "The branch should be in the slice");
+        check(d[1].computed == 0, "Should not compute the CD of the second graph");
+    }
 #endif // ENABLE_CFG
 
+    // thin slices do not follow the base pointers
+    void test12()
+    {
+        TestDG d;
+        TestNode *n[6];
+        for (int i = 0; i < 6; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        // n[1] is the address loaded by n[3], n[2] stores the loaded
+        // value, n[5] computes the address n[1] from n[4]
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[3]);
+        n[2]->addDataDependence(n[3]);
+        n[3]->addDataDependence(n[0]);
+        n[4]->addDataDependence(n[5]);
+        n[5]->addDataDependence(n[1]);
+
+        auto isBasePointer = [&n](TestNode *use, TestNode *def) {
+            return use == n[3] && def == n[1];
+        };
+
+        analysis::Slicer<TestNode> slicer;
+        std::vector<TestNode *> unexpanded;
+        uint32_t sl_id = slicer.markThin({n[0]}, isBasePointer, 0, 0, &unexpanded);
+        for (int i : {0, 2, 3})
+            check(n[i]->getSlice() == sl_id, "Node %d should be in the slice", i);
+        for (int i : {1, 4, 5})
+            check(n[i]->getSlice() != sl_id, "Node %d should not be in the slice", i);
+        check(unexpanded.size() == 1 && unexpanded[0] == n[1],
+              "The base pointer should be unexpanded");
+
+        sl_id = slicer.markThin({n[0]}, isBasePointer, 1, 0, &unexpanded);
+        for (int i = 0; i < 6; ++i)
+            check(n[i]->getSlice() == sl_id, "Node %d should be in the slice", i);
+        check(unexpanded.empty(), "Nothing should be unexpanded");
+    }
+
+    // the index answers the same as marking the slices
+    void test13()
+    {
+        TestDG d;
+        TestNode *n[8];
+        for (int i = 0; i < 8; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        // n[2], n[3] and n[6] are a cycle
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[3]);
+        n[3]->addDataDependence(n[6]);
+        n[6]->addControlDependence(n[2]);
+        n[4]->addControlDependence(n[3]);
+        n[5]->addDataDependence(n[4]);
+        n[7]->addDataDependence(n[1]);
+        n[7]->addControlDependence(n[5]);
+
+        analysis::FrozenGraph<TestNode> frozen;
+        frozen.freeze(&d);
+
+        analysis::ReachabilityIndex<TestNode> index;
+        index.build(&frozen);
+        // the cycle is one component
+        check(index.getComponentsNum() == 6, "Wrong number of components");
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.setFrozenGraph(&frozen);
+        for (int c = 0; c < 8; ++c) {
+            uint32_t sl_id = slicer.mark(n[c], 10 + c);
+            for (int i = 0; i < 8; ++i)
+                check(index.inSlice(n[i], n[c]) == (n[i]->getSlice() == sl_id),
+                      "Node %d should%s be in the slice of %d", i,
+                      n[i]->getSlice() == sl_id ? "" : " not", c);
+        }
+
+        slicer.setFrozenGraph(nullptr);
+    }
+
+    // the cached slices give the same slices as marking them again
+    void test14()
+    {
+        TestDG d;
+        TestNode *n[6];
+        for (int i = 0; i < 6; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[3]);
+        n[4]->addControlDependence(n[3]);
+        n[5]->addDataDependence(n[4]);
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.markCached({n[4]}, 7);
+        check(n[4]->getSlice() == 7 && n[5]->getSlice() == 7
+              && n[0]->getSlice() == 7, "Wrong slice of n[4]");
+        check(n[1]->getSlice() != 7 && n[2]->getSlice() != 7
+              && n[3]->getSlice() != 7, "Wrong slice of n[4]");
+
+        // the slice of n[4] is taken from the cache
+        slicer.markCached({n[4], n[2]}, 8);
+        check(n[0]->getSlice() == 8 && n[1]->getSlice() == 8
+              && n[2]->getSlice() == 8 && n[4]->getSlice() == 8
+              && n[5]->getSlice() == 8, "Wrong slice of n[4] and n[2]");
+        check(n[3]->getSlice() != 8, "Wrong slice of n[4] and n[2]");
+
+        // only from the cache
+        slicer.markCached({n[2]}, 9);
+        check(n[0]->getSlice() == 9 && n[1]->getSlice() == 9
+              && n[2]->getSlice() == 9, "Wrong slice of n[2]");
+        check(n[4]->getSlice() == 8 && n[5]->getSlice() == 8,
+              "Wrong slice of n[2]");
+
+        slicer.clearSliceCache();
+        slicer.markCached({n[3]}, 10);
+        for (int i = 0; i < 6; ++i)
+            check(n[i]->getSlice() == 10, "Node %d should be in the slice", i);
+    }
+
+    // the walk records how it reached the nodes of the slice
+    void test15()
+    {
+        using ParentsT = analysis::WalkParents<TestNode>;
+
+        TestDG d;
+        TestNode *n[6];
+        for (int i = 0; i < 6; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+        }
+
+        d.setEntry(n[0]);
+        n[1]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[3]);
+        n[4]->addControlDependence(n[3]);
+        n[5]->addDataDependence(n[4]);
+
+        analysis::Slicer<TestNode> slicer;
+        ParentsT parents;
+        slicer.markWithParents({n[4]}, parents, 7);
+        check(n[4]->getSlice() == 7 && n[5]->getSlice() == 7
+              && n[0]->getSlice() == 7, "Wrong slice of n[4]");
+
+        check(parents.size() == 3, "Should have 3 nodes, but have %lu",
+              parents.size());
+        check(parents.nodes[0] == n[4] && parents.parents[0] == ParentsT::NONE
+              && parents.kinds[0] == ParentsT::START, "Wrong start");
+        check(parents.nodes[1] == n[0] && parents.parents[1] == 0
+              && parents.kinds[1] == ParentsT::ENTRY, "Wrong entry");
+        check(parents.nodes[2] == n[5] && parents.parents[2] == 0
+              && parents.kinds[2] == ParentsT::DD, "Wrong data dependence");
+
+        // the parents of more walks follow each other
+        slicer.markWithParents({n[3]}, parents, 8);
+        check(parents.size() == 9, "Should have 9 nodes, but have %lu",
+              parents.size());
+        check(parents.nodes[3] == n[3] && parents.parents[3] == ParentsT::NONE,
+              "Wrong start of the second walk");
+        for (size_t i = 4; i < parents.size(); ++i)
+            check(parents.parents[i] >= 3 && parents.parents[i] < i,
+                  "Wrong parent of the node %lu", i);
+    }
+
+    // the blocks are removed at once, the edges over the chains
+    // of the removed blocks keep the labels and the remaining nodes
+    // lose the dependencies on the removed nodes
+    void test16()
+    {
+        TestDG d;
+        TestNode *n[5];
+        TestBBlock *B[5];
+        for (int i = 0; i < 5; ++i) {
+            n[i] = new TestNode(i);
+            d.addNode(n[i]);
+            B[i] = new TestBBlock(n[i], &d);
+            B[i]->setKey(i);
+            d.addBlock(i, B[i]);
+        }
+
+        B[0]->addSuccessor(B[1], 1);
+        B[0]->addSuccessor(B[3], 0);
+        B[1]->addSuccessor(B[2], 0);
+        B[1]->addSuccessor(B[4], 0);
+        B[2]->addSuccessor(B[3], 0);
+        B[2]->addSuccessor(B[1], 0);
+
+        n[0]->addControlDependence(n[1]);
+        n[1]->addDataDependence(n[3]);
+        n[3]->addDataDependence(n[2]);
+        n[2]->addDataDependence(n[1]);
+
+        B[0]->setSlice(1);
+        B[3]->setSlice(1);
+        B[4]->setSlice(1);
+
+        analysis::Slicer<TestNode> slicer;
+        slicer.sliceBBlocks(&d, 1);
+
+        check(d.getBlocks().size() == 3, "Did not remove the blocks");
+        check(d.size() == 3, "Did not remove the nodes, have %u", d.size());
+
+        using EdgesT = std::set<std::pair<TestBBlock *, unsigned>>;
+        EdgesT succs;
+        for (const auto& edge : B[0]->successors())
+            succs.emplace(edge.target, edge.label);
+        EdgesT expected = {{B[3], 0}, {B[3], 1}, {B[4], 1}};
+        check(succs == expected, "Wrong successors of B0");
+        check(B[3]->predecessorsNum() == 1 && B[4]->predecessorsNum() == 1,
+              "Wrong predecessors");
+
+        check(n[0]->getControlDependenciesNum() == 0, "Kept a control dependence");
+        check(n[3]->getDataDependenciesNum() == 0
+              && n[3]->getRevDataDependenciesNum() == 0, "Kept a data dependence");
+    }
+
     void test()
     {
         test1();
         test2();
         test3();
+        test4();
+        test5();
+        test6();
+        test7();
+        test8();
+        test9();
+        test10();
+        test11();
+        test12();
+        test13();
+        test14();
+        test15();
+        test16();
     }
 };
 
@@ -688,8 +1495,12 @@ int main(void)
     Runner.add(new TestCFG());
     Runner.add(new TestContainer());
     Runner.add(new TestAdd());
+    Runner.add(new TestDeferredEdges());
+    Runner.add(new TestEdgesOrder());
     Runner.add(new TestRemove());
     Runner.add(new TestSlicingCFG());
+    Runner.add(new TestControlDependence());
+    Runner.add(new TestControlExpression());
 
     return Runner();
 }
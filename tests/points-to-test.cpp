@@ -2,6 +2,10 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
 
 #include "test-runner.h"
 #include "test-dg.h"
@@ -9,6 +13,12 @@
 #include "analysis/PointsTo/PointerSubgraph.h"
 #include "analysis/PointsTo/PointsToFlowInsensitive.h"
 #include "analysis/PointsTo/PointsToFlowSensitive.h"
+#include "analysis/PointsTo/PointsToFlowSensitiveRegion.h"
+#include "analysis/PointsTo/PointsToAndersen.h"
+#include "analysis/PointsTo/PointsToSteensgaard.h"
+#include "analysis/PointsTo/PointsToSparseFlowSensitive.h"
+#include "analysis/PointsTo/PointsToDemandDriven.h"
+#include "analysis/PointsTo/ReturnSummary.h"
 
 namespace dg {
 namespace tests {
@@ -403,6 +413,67 @@ public:
         check(L.doesPointsTo(&A), "L do not points to A");
     }
 
+    void strided_gep()
+    {
+        using namespace analysis;
+
+        // GEP indexes an array of 8-byte elements
+        // at offset 4 of the elements
+        PSNode A(PSNodeType::ALLOC);
+        A.setSize(32);
+        PSNode GEP(PSNodeType::GEP, &A, 4);
+        GEP.setStride(8);
+        PSNode B(PSNodeType::ALLOC);
+        B.setSize(1024);
+        PSNode GEP2(PSNodeType::GEP, &B, 0);
+        GEP2.setStride(8);
+
+        A.addSuccessor(&GEP);
+        GEP.addSuccessor(&B);
+        B.addSuccessor(&GEP2);
+
+        PointerSubgraph PS(&A);
+        PTStoT PA(&PS);
+        PA.run();
+
+        check(GEP.doesPointsTo(&A, 4), "not GEP -> A + 4");
+        check(GEP.doesPointsTo(&A, 12), "not GEP -> A + 12");
+        check(GEP.doesPointsTo(&A, 20), "not GEP -> A + 20");
+        check(GEP.doesPointsTo(&A, 28), "not GEP -> A + 28");
+        check(GEP.pointsTo.size() == 4, "GEP points to something else");
+        // too many offsets
+        check(GEP2.doesPointsTo(&B, UNKNOWN_OFFSET), "not GEP2 -> B + ?");
+    }
+
+    void initial_pointers()
+    {
+        using namespace analysis;
+
+        // B is a constant memory that contains
+        // the pointer to A at offset 8 from the beginning
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        B.setSize(16);
+        pta::InitialPointersT init{{8, Pointer(&A, 0)}};
+        B.setInitialPointers(&init);
+        PSNode GEP(PSNodeType::GEP, &B, 8);
+        PSNode L1(PSNodeType::LOAD, &GEP);
+        PSNode L2(PSNodeType::LOAD, &B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&GEP);
+        GEP.addSuccessor(&L1);
+        L1.addSuccessor(&L2);
+
+        PointerSubgraph PS(&A);
+        PTStoT PA(&PS);
+        PA.run();
+
+        check(L1.doesPointsTo(&A), "L1 do not points to A");
+        check(L1.pointsTo.size() == 1, "L1 points to something else");
+        check(!L2.doesPointsTo(&A), "L2 points to A");
+    }
+
     void load_from_zeroed()
     {
         using namespace analysis;
@@ -420,6 +491,31 @@ public:
         check(L.doesPointsTo(NULLPTR), "L do not points to nullptr");
     }
 
+    void saturate_unknown()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        A.setSize(8);
+        PSNode P(PSNodeType::PHI, &A, pta::UNKNOWN_MEMORY, nullptr);
+        PSNode GEP(PSNodeType::GEP, &P, 4);
+
+        A.addSuccessor(&P);
+        P.addSuccessor(&GEP);
+
+        PointerSubgraph PS(&A);
+        PTStoT PA(&PS);
+        PA.setSaturateUnknown();
+        PA.run();
+
+        check(P.pointsTo.size() == 1, "P points to something else");
+        check(P.doesPointsTo(pta::UNKNOWN_MEMORY, UNKNOWN_OFFSET),
+              "P do not points to unknown");
+        check(GEP.pointsTo.size() == 1, "GEP points to something else");
+        check(GEP.doesPointsTo(pta::UNKNOWN_MEMORY, UNKNOWN_OFFSET),
+              "GEP do not points to unknown");
+    }
+
     void load_from_unknown_offset()
     {
         using namespace analysis;
@@ -716,6 +812,175 @@ public:
         check(L2.doesPointsTo(NULLPTR), "L2 does not point to NULL");
     }
 
+    void statistics()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode S(PSNodeType::STORE, &A, &B);
+        PSNode L(PSNodeType::LOAD, &B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&S);
+        S.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PTStoT PA(&PS);
+        PA.collectStatistics();
+        PA.run();
+
+        const PointerAnalysisStatistics& st = PA.getStatistics();
+        check(st.getRoundsNum() > 0, "no rounds in statistics");
+        check(st.getProcessedNodes() >= 4, "not all nodes were processed");
+        check(st.types.at(PSNodeType::STORE).processed > 0,
+              "no store in statistics");
+        check(st.memoryObjectsNum > 0, "no memory objects in statistics");
+        check(st.getMostProcessed(1).size() == 1, "no most processed node");
+        check(st.nodes.count(&L) == 1 && st.nodes.at(&L).growth > 0,
+              "no growth of the points-to set of the load");
+    }
+
+    void offsets_budget()
+    {
+        using namespace analysis;
+
+        // the third offset into ARRAY is over the budget,
+        // B gets the precise offsets
+        PSNode ARRAY(PSNodeType::ALLOC);
+        ARRAY.setSize(40);
+        PSNode B(PSNodeType::ALLOC);
+        B.setSize(40);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode GEP1(PSNodeType::GEP, &ARRAY, 0);
+        PSNode GEP2(PSNodeType::GEP, &ARRAY, 4);
+        PSNode GEP3(PSNodeType::GEP, &ARRAY, 8);
+        PSNode GEP4(PSNodeType::GEP, &B, 8);
+        PSNode S(PSNodeType::STORE, &C, &GEP3);
+        PSNode GEP5(PSNodeType::GEP, &ARRAY, 0);
+        PSNode L(PSNodeType::LOAD, &GEP5);
+
+        ARRAY.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&GEP1);
+        GEP1.addSuccessor(&GEP2);
+        GEP2.addSuccessor(&GEP3);
+        GEP3.addSuccessor(&GEP4);
+        GEP4.addSuccessor(&S);
+        S.addSuccessor(&GEP5);
+        GEP5.addSuccessor(&L);
+
+        PointerSubgraph PS(&ARRAY);
+        PTStoT PA(&PS);
+        PA.setOffsetsBudget(2);
+        PA.run();
+
+        check(GEP1.doesPointsTo(&ARRAY, 0), "not GEP1 -> ARRAY + 0");
+        check(GEP2.doesPointsTo(&ARRAY, 4), "not GEP2 -> ARRAY + 4");
+        check(GEP3.doesPointsTo(&ARRAY, UNKNOWN_OFFSET),
+              "not GEP3 -> ARRAY + UNKNOWN");
+        check(GEP4.doesPointsTo(&B, 8), "not GEP4 -> B + 8");
+        check(GEP5.doesPointsTo(&ARRAY, UNKNOWN_OFFSET),
+              "not GEP5 -> ARRAY + UNKNOWN");
+        check(PA.isCollapsed(&ARRAY), "ARRAY is not collapsed");
+        check(!PA.isCollapsed(&B), "B is collapsed");
+        check(L.doesPointsTo(&C), "L do not points to C");
+    }
+
+    void independent_branches()
+    {
+        using namespace analysis;
+
+        // the branches store to different memory (A and C), but
+        // the stores to E on both branches must be seen after them
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode D(PSNodeType::ALLOC);
+        PSNode E(PSNodeType::ALLOC);
+        PSNode N(PSNodeType::NOOP);
+        PSNode S1(PSNodeType::STORE, &B, &A);
+        PSNode L1(PSNodeType::LOAD, &A);
+        PSNode S2(PSNodeType::STORE, &L1, &E);
+        PSNode S3(PSNodeType::STORE, &D, &C);
+        PSNode L2(PSNodeType::LOAD, &C);
+        PSNode S4(PSNodeType::STORE, &L2, &E);
+        PSNode J(PSNodeType::NOOP);
+        PSNode L3(PSNodeType::LOAD, &E);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&D);
+        D.addSuccessor(&E);
+        E.addSuccessor(&N);
+        N.addSuccessor(&S1);
+        S1.addSuccessor(&L1);
+        L1.addSuccessor(&S2);
+        S2.addSuccessor(&J);
+        N.addSuccessor(&S3);
+        S3.addSuccessor(&L2);
+        L2.addSuccessor(&S4);
+        S4.addSuccessor(&J);
+        J.addSuccessor(&L3);
+
+        PointerSubgraph PS(&A);
+        PTStoT PA(&PS);
+        PA.run();
+
+        check(L1.doesPointsTo(&B), "L1 do not points to B");
+        check(L1.pointsTo.size() == 1, "L1 points to something else");
+        check(L2.doesPointsTo(&D), "L2 do not points to D");
+        check(L2.pointsTo.size() == 1, "L2 points to something else");
+        check(L3.doesPointsTo(&B), "L3 do not points to B");
+        check(L3.doesPointsTo(&D), "L3 do not points to D");
+    }
+
+    void big_loop()
+    {
+        using namespace analysis;
+
+        // a loop that is big enough to have its nodes processed
+        // at once by the parallel SCC schedule. The pointer to B
+        // gets through the objects O[0], ..., O[num] in the loop
+        const unsigned num = 40;
+        PSNode B(PSNodeType::ALLOC);
+        std::vector<std::unique_ptr<PSNode>> objs, loads, stores;
+        for (unsigned i = 0; i <= num; ++i)
+            objs.emplace_back(new PSNode(PSNodeType::ALLOC));
+        PSNode S(PSNodeType::STORE, &B, objs[0].get());
+        PSNode H(PSNodeType::NOOP);
+
+        PSNode *last = &B;
+        for (auto& o : objs) {
+            last->addSuccessor(o.get());
+            last = o.get();
+        }
+        last->addSuccessor(&S);
+        S.addSuccessor(&H);
+
+        // the copies are in the reverse order,
+        // so the pointer moves by one object in a round
+        last = &H;
+        for (unsigned i = num; i > 0; --i) {
+            loads.emplace_back(new PSNode(PSNodeType::LOAD, objs[i - 1].get()));
+            stores.emplace_back(new PSNode(PSNodeType::STORE, loads.back().get(),
+                                           objs[i].get()));
+            last->addSuccessor(loads.back().get());
+            loads.back()->addSuccessor(stores.back().get());
+            last = stores.back().get();
+        }
+        last->addSuccessor(&H);
+
+        PointerSubgraph PS(&B);
+        PTStoT PA(&PS);
+        PA.run();
+
+        bool ok = true;
+        for (auto& L : loads)
+            ok &= L->doesPointsTo(&B) && L->pointsTo.size() == 1;
+        check(ok, "A load in the loop does not point only to B");
+    }
+
     void test()
     {
         store_load();
@@ -730,6 +995,9 @@ public:
         gep5();
         nulltest();
         constant_store();
+        strided_gep();
+        saturate_unknown();
+        initial_pointers();
         load_from_zeroed();
         load_from_unknown_offset();
         load_from_unknown_offset2();
@@ -738,6 +1006,10 @@ public:
         memcpy_test2();
         memcpy_test3();
         memcpy_test4();
+        independent_branches();
+        big_loop();
+        offsets_budget();
+        statistics();
     }
 };
 
@@ -759,31 +1031,1335 @@ public:
           ("flow-sensitive points-to test") {}
 };
 
-class PSNodeTest : public Test
+// run the analysis with the given schedule
+template <typename PTStoT, analysis::pta::PTASchedule Schedule>
+class ScheduledPTA : public PTStoT
 {
+public:
+    ScheduledPTA(PointerSubgraph *ps) : PTStoT(ps)
+    {
+        this->setSchedule(Schedule);
+    }
+};
+
+template <typename PTStoT>
+using WorklistPTA = ScheduledPTA<PTStoT, analysis::pta::PTASchedule::WORKLIST>;
+template <typename PTStoT>
+using SCCPTA = ScheduledPTA<PTStoT, analysis::pta::PTASchedule::SCC>;
 
+class FlowInsensitiveWorklistPointsToTest
+    : public PointsToTest<WorklistPTA<analysis::pta::PointsToFlowInsensitive>>
+{
 public:
-    PSNodeTest()
-          : Test("PSNode test") {}
+    FlowInsensitiveWorklistPointsToTest()
+        : PointsToTest<WorklistPTA<analysis::pta::PointsToFlowInsensitive>>
+          ("flow-insensitive points-to test (worklist)") {}
+};
 
-    void unknown_offset1()
+class FlowSensitiveWorklistPointsToTest
+    : public PointsToTest<WorklistPTA<analysis::pta::PointsToFlowSensitive>>
+{
+public:
+    FlowSensitiveWorklistPointsToTest()
+        : PointsToTest<WorklistPTA<analysis::pta::PointsToFlowSensitive>>
+          ("flow-sensitive points-to test (worklist)") {}
+};
+
+class FlowInsensitiveSCCPointsToTest
+    : public PointsToTest<SCCPTA<analysis::pta::PointsToFlowInsensitive>>
+{
+public:
+    FlowInsensitiveSCCPointsToTest()
+        : PointsToTest<SCCPTA<analysis::pta::PointsToFlowInsensitive>>
+          ("flow-insensitive points-to test (scc)") {}
+};
+
+class FlowSensitiveSCCPointsToTest
+    : public PointsToTest<SCCPTA<analysis::pta::PointsToFlowSensitive>>
+{
+public:
+    FlowSensitiveSCCPointsToTest()
+        : PointsToTest<SCCPTA<analysis::pta::PointsToFlowSensitive>>
+          ("flow-sensitive points-to test (scc)") {}
+};
+
+// run the SCC schedule with more threads
+template <typename PTStoT>
+class ParallelPTA : public SCCPTA<PTStoT>
+{
+public:
+    ParallelPTA(PointerSubgraph *ps) : SCCPTA<PTStoT>(ps)
     {
-        using namespace dg::analysis::pta;
-        PSNode N1(PSNodeType::ALLOC);
-        PSNode N2(PSNodeType::LOAD, &N1);
+        this->setThreads(4);
+    }
+};
 
-        N2.addPointsTo(&N1, 1);
-        N2.addPointsTo(&N1, 2);
-        N2.addPointsTo(&N1, 3);
-        check(N2.pointsTo.size() == 3);
-        N2.addPointsTo(&N1, UNKNOWN_OFFSET);
-        check(N2.pointsTo.size() == 1);
-        check(N2.addPointsTo(&N1, 3) == false);
+class FlowInsensitiveParallelPointsToTest
+    : public PointsToTest<ParallelPTA<analysis::pta::PointsToFlowInsensitive>>
+{
+public:
+    FlowInsensitiveParallelPointsToTest()
+        : PointsToTest<ParallelPTA<analysis::pta::PointsToFlowInsensitive>>
+          ("flow-insensitive points-to test (parallel)") {}
+};
+
+class FlowSensitiveParallelPointsToTest
+    : public PointsToTest<ParallelPTA<analysis::pta::PointsToFlowSensitive>>
+{
+public:
+    FlowSensitiveParallelPointsToTest()
+        : PointsToTest<ParallelPTA<analysis::pta::PointsToFlowSensitive>>
+          ("flow-sensitive points-to test (parallel)") {}
+};
+
+class SparseFlowSensitivePointsToTest
+    : public PointsToTest<analysis::pta::PointsToSparseFlowSensitive>
+{
+public:
+    SparseFlowSensitivePointsToTest()
+        : PointsToTest<analysis::pta::PointsToSparseFlowSensitive>
+          ("sparse flow-sensitive points-to test") {}
+
+    void strong_update()
+    {
+        using namespace analysis;
+
+        // the load sees only the second store
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode S1(PSNodeType::STORE, &A, &C);
+        PSNode S2(PSNodeType::STORE, &B, &C);
+        PSNode L(PSNodeType::LOAD, &C);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&S1);
+        S1.addSuccessor(&S2);
+        S2.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToSparseFlowSensitive PA(&PS);
+        PA.run();
+
+        check(L.doesPointsTo(&B), "L do not points to B");
+        check(!L.doesPointsTo(&A), "L points to A");
+    }
+
+    void branches()
+    {
+        using namespace analysis;
+
+        // the stores to A and C are on different branches,
+        // the store to D does not write to the same memory
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode D(PSNodeType::ALLOC);
+        PSNode S1(PSNodeType::STORE, &A, &C);
+        PSNode S2(PSNodeType::STORE, &B, &C);
+        PSNode S3(PSNodeType::STORE, &A, &D);
+        PSNode L(PSNodeType::LOAD, &C);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&D);
+        D.addSuccessor(&S1);
+        D.addSuccessor(&S2);
+        S1.addSuccessor(&S3);
+        S2.addSuccessor(&S3);
+        S3.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToSparseFlowSensitive PA(&PS);
+        PA.run();
+
+        check(L.doesPointsTo(&A), "L do not points to A");
+        check(L.doesPointsTo(&B), "L do not points to B");
+        check(L.pointsTo.size() == 2, "L points to something else");
     }
 
     void test()
     {
-        unknown_offset1();
+        PointsToTest<analysis::pta::PointsToSparseFlowSensitive>::test();
+        strong_update();
+        branches();
+    }
+};
+
+class AndersenPointsToTest
+    : public PointsToTest<analysis::pta::PointsToAndersen>
+{
+public:
+    AndersenPointsToTest()
+        : PointsToTest<analysis::pta::PointsToAndersen>
+          ("Andersen points-to test") {}
+
+    void phi_cycle()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode P1(PSNodeType::PHI, &A, nullptr);
+        PSNode P2(PSNodeType::PHI, &P1, nullptr);
+        PSNode C(PSNodeType::CAST, &P2);
+        // close the cycle P1 -> P2 -> C -> P1
+        P1.addOperand(&C);
+        P2.addOperand(&B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&P1);
+        P1.addSuccessor(&P2);
+        P2.addSuccessor(&C);
+        C.addSuccessor(&P1);
+
+        PointerSubgraph PS(&A);
+        PointsToAndersen PA(&PS);
+        PA.run();
+
+        for (PSNode *n : {&P1, &P2, &C}) {
+            check(n->doesPointsTo(&A), "node do not points to A");
+            check(n->doesPointsTo(&B), "node do not points to B");
+            check(n->pointsTo.size() == 2, "node points to something else");
+        }
+
+        check(PA.getCollapsedNum() > 0, "did not collapse the cycle");
+    }
+
+    void load_before_store()
+    {
+        using namespace analysis;
+
+        // the order of the nodes does not matter
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode L(PSNodeType::LOAD, &B);
+        PSNode S(PSNodeType::STORE, &A, &B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&L);
+        L.addSuccessor(&S);
+
+        PointerSubgraph PS(&A);
+        PointsToAndersen PA(&PS);
+        PA.run();
+
+        check(L.doesPointsTo(&A), "L do not points to A");
+    }
+
+    void test()
+    {
+        PointsToTest<analysis::pta::PointsToAndersen>::test();
+        phi_cycle();
+        load_before_store();
+    }
+};
+
+class SteensgaardPointsToTest : public Test
+{
+public:
+    SteensgaardPointsToTest()
+        : Test("Steensgaard points-to test") {}
+
+    void store_load()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode S(PSNodeType::STORE, &A, &B);
+        PSNode L(PSNodeType::LOAD, &B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&S);
+        S.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToSteensgaard PA(&PS);
+        PA.run();
+
+        check(L.doesPointsTo(&A, UNKNOWN_OFFSET), "L do not points to A");
+        check(L.pointsTo.size() == 1, "L points to something else");
+    }
+
+    void unification()
+    {
+        using namespace analysis;
+
+        // P = phi(A, B), Q = phi(A, C) -> all A, B, C are
+        // in one class, so R = C points also to A and B
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode D(PSNodeType::ALLOC);
+        PSNode P(PSNodeType::PHI, &A, &B, nullptr);
+        PSNode Q(PSNodeType::PHI, &A, &C, nullptr);
+        PSNode R(PSNodeType::CAST, &C);
+        PSNode N(PSNodeType::CAST, NULLPTR);
+        PSNode S(PSNodeType::STORE, &D, &A);
+        PSNode L(PSNodeType::LOAD, &R);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&D);
+        D.addSuccessor(&P);
+        P.addSuccessor(&Q);
+        Q.addSuccessor(&R);
+        R.addSuccessor(&N);
+        N.addSuccessor(&S);
+        S.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToSteensgaard PA(&PS);
+        PA.run();
+
+        check(R.doesPointsTo(&A, UNKNOWN_OFFSET), "R do not points to A");
+        check(R.doesPointsTo(&B, UNKNOWN_OFFSET), "R do not points to B");
+        check(R.pointsTo.size() == 3, "R points to something else");
+        check(L.doesPointsTo(&D, UNKNOWN_OFFSET), "L do not points to D");
+        check(N.doesPointsTo(NULLPTR), "N do not points to null");
+        check(N.pointsTo.size() == 1, "null was unified with other pointers");
+        check(PA.mayAlias(&P, &R), "P and R must alias");
+        check(!PA.mayAlias(&P, &L), "P and L must not alias");
+    }
+
+    void initial_pointers()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        pta::InitialPointersT init{{0, Pointer(&A, 0)}};
+        B.setInitialPointers(&init);
+        PSNode L(PSNodeType::LOAD, &B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToSteensgaard PA(&PS);
+        PA.run();
+
+        check(L.doesPointsTo(&A, UNKNOWN_OFFSET), "L do not points to A");
+        check(L.pointsTo.size() == 1, "L points to something else");
+    }
+
+    void test()
+    {
+        store_load();
+        unification();
+        initial_pointers();
+    }
+};
+
+class DemandDrivenPointsToTest : public Test
+{
+public:
+    DemandDrivenPointsToTest()
+        : Test("demand-driven points-to test") {}
+
+    void query()
+    {
+        using namespace analysis;
+
+        // P and the store to D have nothing to do with L
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode D(PSNodeType::ALLOC);
+        PSNode S1(PSNodeType::STORE, &A, &B);
+        PSNode S2(PSNodeType::STORE, &C, &D);
+        PSNode P(PSNodeType::PHI, &A, &C, nullptr);
+        PSNode L(PSNodeType::LOAD, &B);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&D);
+        D.addSuccessor(&S1);
+        S1.addSuccessor(&S2);
+        S2.addSuccessor(&P);
+        P.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToDemandDriven PA(&PS);
+
+        check(PA.query(&L), "query exceeded the budget");
+        check(!PA.isExhaustive(), "run the whole analysis");
+        check(L.doesPointsTo(&A), "L do not points to A");
+        check(L.pointsTo.size() == 1, "L points to something else");
+        check(P.pointsTo.empty(), "computed also P");
+
+        // the second query reuses the results
+        check(PA.query(&L), "second query exceeded the budget");
+        check(PA.query(&P), "query exceeded the budget");
+        check(P.pointsTo.size() == 2, "P do not points to A and C");
+    }
+
+    void budget()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode S(PSNodeType::STORE, &A, &B);
+        PSNode L(PSNodeType::LOAD, &B);
+        PSNode P(PSNodeType::PHI, &A, &B, nullptr);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&S);
+        S.addSuccessor(&L);
+        L.addSuccessor(&P);
+
+        PointerSubgraph PS(&A);
+        PointsToDemandDriven PA(&PS);
+        PA.setBudget(1);
+
+        check(!PA.query(&L), "query did not exceed the budget");
+        check(PA.isExhaustive(), "did not run the whole analysis");
+        check(L.doesPointsTo(&A), "L do not points to A");
+        check(P.pointsTo.size() == 2, "P was not computed");
+        check(PA.query(&P), "query after the whole analysis failed");
+    }
+
+    void test()
+    {
+        query();
+        budget();
+    }
+};
+
+class FlowSensitiveRegionTest : public Test
+{
+public:
+    FlowSensitiveRegionTest()
+        : Test("flow-sensitive region points-to test") {}
+
+    void strong_update()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode S1(PSNodeType::STORE, &A, &C);
+        PSNode S2(PSNodeType::STORE, &B, &C);
+        PSNode L(PSNodeType::LOAD, &C);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&S1);
+        S1.addSuccessor(&S2);
+        S2.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToFlowInsensitive FI(&PS);
+        FI.run();
+
+        check(L.doesPointsTo(&A), "L do not points to A");
+        check(L.doesPointsTo(&B), "L do not points to B");
+
+        // the memory from S1 gets into the region and S2 overwrites it
+        PointsToFlowSensitiveRegion FS(&PS, &FI, {&S2, &L});
+        FS.run();
+
+        check(L.doesPointsTo(&B), "L do not points to B");
+        check(L.pointsTo.size() == 1, "L points to something else");
+    }
+
+    void boundary_memory()
+    {
+        using namespace analysis;
+
+        // only L is in the region, it reads the memory of the FI analysis
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode S1(PSNodeType::STORE, &A, &C);
+        PSNode S2(PSNodeType::STORE, &B, &C);
+        PSNode L(PSNodeType::LOAD, &C);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&S1);
+        S1.addSuccessor(&S2);
+        S2.addSuccessor(&L);
+
+        PointerSubgraph PS(&A);
+        PointsToFlowInsensitive FI(&PS);
+        FI.run();
+
+        PointsToFlowSensitiveRegion FS(&PS, &FI, {&L});
+        FS.run();
+
+        check(L.doesPointsTo(&A), "L do not points to A");
+        check(L.doesPointsTo(&B), "L do not points to B");
+        check(L.pointsTo.size() == 2, "L points to something else");
+
+        // the analyses keep their data of the nodes separately
+        check(FI.getMemoryObject(&C) != nullptr, "FI lost its memory of C");
+        check(FS.getMemoryMap(&L) != nullptr, "L has no memory map");
+        check(FS.getMemoryMap(&A) == nullptr, "A is not in the region");
+    }
+
+    void test()
+    {
+        strong_update();
+        boundary_memory();
+    }
+};
+
+class FlowSensitiveWritersTest : public Test
+{
+public:
+    FlowSensitiveWritersTest()
+        : Test("flow-sensitive points-to writers test") {}
+
+    static std::vector<PSNode *> writers(PointsToFlowSensitive& PA,
+                                         PSNode *where, PSNode *target)
+    {
+        std::vector<PSNode *> W;
+        PA.getWriters(where, Pointer(target, 0), W);
+        return W;
+    }
+
+    void run(PTASchedule schedule)
+    {
+        using namespace analysis;
+
+        // S1; if (...) S2; else S3 (through a pointer to C or D); L
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::ALLOC);
+        PSNode D(PSNodeType::ALLOC);
+        PSNode P(PSNodeType::PHI, &C, &D, nullptr);
+        PSNode S1(PSNodeType::STORE, &A, &C);
+        PSNode S2(PSNodeType::STORE, &B, &C);
+        PSNode S3(PSNodeType::STORE, &B, &P);
+        PSNode J(PSNodeType::NOOP);
+        PSNode L(PSNodeType::LOAD, &C);
+        PSNode S4(PSNodeType::STORE, &A, &C);
+        PSNode L2(PSNodeType::LOAD, &C);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&D);
+        D.addSuccessor(&P);
+        P.addSuccessor(&S1);
+        S1.addSuccessor(&S2);
+        S1.addSuccessor(&S3);
+        S2.addSuccessor(&J);
+        S3.addSuccessor(&J);
+        J.addSuccessor(&L);
+        L.addSuccessor(&S4);
+        S4.addSuccessor(&L2);
+
+        PointerSubgraph PS(&A);
+        PointsToFlowSensitive PA(&PS);
+        PA.setSchedule(schedule);
+        PA.setTrackWriters(true);
+        PA.run();
+
+        check(L.doesPointsTo(&B), "BUG in points-to");
+
+        // S2 kills S1, S3 may not write to C
+        check(writers(PA, &L, &C) == std::vector<PSNode *>({&S1, &S2, &S3}),
+              "Wrong writers of C at L");
+        check(writers(PA, &L, &D) == std::vector<PSNode *>({&S3}),
+              "Wrong writers of D at L");
+        check(writers(PA, &L2, &C) == std::vector<PSNode *>({&S4}),
+              "Wrong writers of C at L2");
+        check(writers(PA, &S2, &C) == std::vector<PSNode *>({&S2}),
+              "Wrong writers of C at S2");
+        check(writers(PA, &S1, &D).empty(), "D written before S3");
+    }
+
+    void test()
+    {
+        using namespace analysis::pta;
+
+        run(PTASchedule::ROUNDS);
+        run(PTASchedule::WORKLIST);
+        run(PTASchedule::SCC);
+    }
+};
+
+class RenumberNodesTest : public Test
+{
+public:
+    RenumberNodesTest()
+        : Test("pointer subgraph renumbering test") {}
+
+    void test()
+    {
+        using namespace analysis;
+
+        // created in the opposite order than they are reached
+        PSNode L(PSNodeType::LOAD, pta::NULLPTR);
+        PSNode S2(PSNodeType::STORE, pta::NULLPTR, pta::NULLPTR);
+        PSNode S1(PSNodeType::STORE, pta::NULLPTR, pta::NULLPTR);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode A(PSNodeType::ALLOC);
+
+        A.addSuccessor(&B);
+        B.addSuccessor(&S1);
+        B.addSuccessor(&S2);
+        S1.addSuccessor(&L);
+        S2.addSuccessor(&L);
+
+        L.replaceOperand(0, &B);
+        S1.replaceOperand(0, &A);
+        S1.replaceOperand(1, &B);
+        S2.replaceOperand(0, &B);
+        S2.replaceOperand(1, &B);
+
+        std::set<unsigned> before;
+        for (PSNode *n : {&A, &B, &S1, &S2, &L})
+            before.insert(n->getID());
+
+        PointerSubgraph PS(&A);
+        PS.renumberNodes();
+
+        std::set<unsigned> after;
+        for (PSNode *n : {&A, &B, &S1, &S2, &L})
+            after.insert(n->getID());
+
+        check(before == after, "The nodes got other ids");
+        check(A.getID() < B.getID() && B.getID() < S1.getID()
+              && B.getID() < S2.getID() && S1.getID() < L.getID()
+              && S2.getID() < L.getID(), "The ids are not in RPO");
+
+        PointsToFlowInsensitive PA(&PS);
+        PA.run();
+        check(L.doesPointsTo(&A) && L.doesPointsTo(&B), "BUG in points-to");
+    }
+};
+
+class ReachableNodesTest : public Test
+{
+public:
+    ReachableNodesTest()
+        : Test("pointer subgraph reachable nodes test") {}
+
+    void test()
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::NOOP);
+        A.addSuccessor(&B);
+
+        PointerSubgraph PS(&A);
+        const std::vector<PSNode *>& nodes = PS.getReachableNodes();
+        check(nodes.size() == 2 && nodes[0] == &A && nodes[1] == &B,
+              "Wrong reachable nodes");
+
+        // the same order as getNodes() and the same vector
+        // as long as the graph does not change
+        check(PS.getNodes(&A) == nodes, "Different order than getNodes()");
+        check(&PS.getReachableNodes() == &nodes, "The order is not cached");
+
+        // a new edge makes the order computed again
+        B.addSuccessor(&C);
+        check(PS.getReachableNodes().size() == 3, "The order is stale");
+        check(PS.getReachableNodes()[2] == &C, "Wrong reachable nodes");
+
+        C.isolate();
+        check(PS.getReachableNodes().size() == 2, "The order is stale");
+
+        PS.setRoot(&B);
+        check(PS.getReachableNodes().size() == 1
+              && PS.getReachableNodes()[0] == &B, "The order is stale");
+    }
+};
+
+class TopLevelTest : public Test
+{
+public:
+    TopLevelTest()
+        : Test("points-to top-level nodes test") {}
+
+    void test()
+    {
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::CAST, &A);
+        PSNode S(PSNodeType::STORE, &C, &B);
+        PSNode L(PSNodeType::LOAD, &B);
+        A.addSuccessor(&B);
+        B.addSuccessor(&C);
+        C.addSuccessor(&S);
+        S.addSuccessor(&L);
+        // the loop makes the analysis do more rounds
+        L.addSuccessor(&C);
+
+        check(C.isTopLevel() && !L.isTopLevel() && !S.isTopLevel());
+        check(C.hasNewOperandPointsTo(), "A has a pointer");
+
+        PointerSubgraph PS(&A);
+        PointsToFlowSensitive PA(&PS);
+        PA.collectStatistics();
+        PA.run();
+
+        check(!C.hasNewOperandPointsTo(), "C has seen all the pointers");
+        check(C.doesPointsTo(&A) && C.pointsTo.size() == 1);
+        check(L.doesPointsTo(&A), "L does not point to A");
+        check(PA.getStatistics().topLevelSkipped > 0,
+              "The cast was not skipped in the later rounds");
+    }
+};
+
+class BudgetTest : public Test
+{
+public:
+    BudgetTest()
+        : Test("points-to budget test") {}
+
+    void test()
+    {
+        using namespace analysis;
+
+        for (bool limited : {false, true}) {
+            const size_t N = 2 * Budget::CHECK_PERIOD;
+            PSNode A(PSNodeType::ALLOC);
+            std::vector<std::unique_ptr<PSNode>> casts;
+            PSNode *last = &A;
+            for (size_t i = 0; i < N; ++i) {
+                casts.emplace_back(new PSNode(PSNodeType::CAST, last));
+                last->addSuccessor(casts.back().get());
+                last = casts.back().get();
+            }
+
+            PointerSubgraph PS(&A);
+            PointsToFlowInsensitive PA(&PS);
+            // any process takes more than one byte
+            if (limited)
+                PA.setBudget(Budget(0, 1));
+            PA.run();
+
+            if (limited) {
+                check(PA.isBudgetExceeded(), "did not exceed the budget");
+                check(last->pointsTo.empty(), "did not stop");
+            } else {
+                check(!PA.isBudgetExceeded(), "exceeded the budget");
+                check(last->doesPointsTo(&A), "last cast do not points to A");
+            }
+        }
+    }
+};
+
+class ProgressTest : public Test
+{
+public:
+    ProgressTest()
+        : Test("points-to progress test") {}
+
+    void test()
+    {
+        using namespace analysis;
+
+        const char *file = "progress-test.txt";
+        Progress progress(1, file);
+        progress.start("test");
+        Progress::Report report;
+        report.round = 2;
+        report.worklist = 3;
+        report.processed = 4;
+        report.sets = 5;
+        progress.report(report);
+
+        char line[256] = {0};
+        FILE *f = fopen(file, "r");
+        check(f != nullptr, "did not write the status file");
+        if (f) {
+            check(fgets(line, sizeof line, f) != nullptr, "empty status file");
+            fclose(f);
+        }
+        remove(file);
+        check(strstr(line, "PROGRESS: test") == line, "wrong report: %s", line);
+        check(strstr(line, "round 2 worklist 3 processed 4 sets 5"),
+              "wrong report: %s", line);
+
+        // the reports do not change the results
+        const size_t N = 2 * Progress::CHECK_PERIOD;
+        PSNode A(PSNodeType::ALLOC);
+        std::vector<std::unique_ptr<PSNode>> casts;
+        PSNode *last = &A;
+        for (size_t i = 0; i < N; ++i) {
+            casts.emplace_back(new PSNode(PSNodeType::CAST, last));
+            last->addSuccessor(casts.back().get());
+            last = casts.back().get();
+        }
+
+        PointerSubgraph PS(&A);
+        PointsToFlowInsensitive PA(&PS);
+        PA.setProgress(Progress(1, file));
+        PA.run();
+        remove(file);
+        check(last->doesPointsTo(&A), "last cast do not points to A");
+    }
+};
+
+class LoopWideningTest : public Test
+{
+public:
+    LoopWideningTest()
+        : Test("points-to loop widening test") {}
+
+    // P = phi(A, G); G = P + 8 in a loop. Only the GEPs
+    // marked as in a loop are widened when the graph has the loops
+    void widening(bool inLoop, unsigned delay)
+    {
+        using namespace analysis;
+
+        PSNode A(PSNodeType::ALLOC);
+        A.setSize(64);
+        PSNode P(PSNodeType::PHI, &A, nullptr);
+        PSNode G(PSNodeType::GEP, &P, 8);
+        P.addOperand(&G);
+        G.setInLoop(inLoop);
+
+        A.addSuccessor(&P);
+        P.addSuccessor(&G);
+        G.addSuccessor(&P);
+
+        PointerSubgraph PS(&A);
+        PS.setHasLoopInfo();
+        PointsToFlowInsensitive PA(&PS);
+        PA.setWideningDelay(delay);
+        PA.run();
+
+        // the cycle may be collapsed
+        check(G.doesPointsTo(&A, 8) || G.doesPointsTo(&A, UNKNOWN_OFFSET),
+              "not G -> A + 8");
+        if (!inLoop || delay > 7) {
+            check(G.getStride() == 0, "widened the GEP");
+        } else if (delay == 0) {
+            check(G.getStride() == 8, "did not widen the GEP in the loop");
+        }
+    }
+
+    void test()
+    {
+        widening(false, 0);
+        widening(true, 0);
+        widening(true, 2);
+        // the pointer moves at most 7 times
+        widening(true, 100);
+    }
+};
+
+class PSNodeTest : public Test
+{
+
+public:
+    PSNodeTest()
+          : Test("PSNode test") {}
+
+    void unknown_offset1()
+    {
+        using namespace dg::analysis::pta;
+        PSNode N1(PSNodeType::ALLOC);
+        PSNode N2(PSNodeType::LOAD, &N1);
+
+        N2.addPointsTo(&N1, 1);
+        N2.addPointsTo(&N1, 2);
+        N2.addPointsTo(&N1, 3);
+        check(N2.pointsTo.size() == 3);
+        N2.addPointsTo(&N1, UNKNOWN_OFFSET);
+        check(N2.pointsTo.size() == 1);
+        check(N2.addPointsTo(&N1, 3) == false);
+    }
+
+    void replace_operand()
+    {
+        using namespace dg::analysis::pta;
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+        PSNode C(PSNodeType::CAST, &A);
+        PSNode S(PSNodeType::STORE, &C, &C);
+
+        check(C.getUsers().size() == 2, "Store is not a user of the cast");
+
+        S.replaceOperand(0, &A);
+        check(S.getOperand(0) == &A && S.getOperand(1) == &C);
+        check(C.getUsers().size() == 1, "Cast has a replaced user");
+        check(A.getUsers().size() == 2, "Store is not a user of A");
+
+        S.replaceOperand(1, &B);
+        check(C.getUsers().empty(), "Cast has a replaced user");
+        check(B.getUsers().size() == 1 && B.getUsers()[0] == &S);
+
+        C.removeOperands();
+        check(C.getOperandsNum() == 0);
+        check(A.getUsers().size() == 1 && A.getUsers()[0] == &S,
+              "Removed operand keeps the user");
+    }
+
+    void subgraph_nodes()
+    {
+        using namespace dg::analysis::pta;
+        PointerSubgraph PS;
+        PSNode *A = PS.create(PSNodeType::ALLOC);
+        PSNode *C = PS.create(PSNodeType::CAST, A);
+        PSNode *L = PS.create(PSNodeType::LOAD, C);
+        PS.setRoot(A);
+
+        // also the nodes that are not reachable from the root
+        check(PS.size() == 3, "Wrong number of nodes");
+        check(PS.getAllNodes()[0] == A && PS.getAllNodes()[1] == C
+              && PS.getAllNodes()[2] == L, "Nodes not in the order of creation");
+
+        PS.forgetNodes([C](PSNode *n) { return n == C; });
+        check(PS.size() == 2 && PS.getAllNodes()[1] == L, "Did not forget the node");
+    }
+
+    void test()
+    {
+        unknown_offset1();
+        replace_operand();
+        subgraph_nodes();
+    }
+};
+
+class PointsToSetTest : public Test
+{
+
+public:
+    PointsToSetTest()
+          : Test("points-to set test") {}
+
+    void small_and_big()
+    {
+        using namespace dg::analysis::pta;
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+
+        PointsToSetT S;
+        check(S.empty());
+        check(S.isSmall());
+
+        // fill the set so that it switches to the bitvector
+        const unsigned num = 3 * PointsToSetT::SMALL_LIMIT;
+        for (unsigned i = 0; i < num; ++i) {
+            check(S.insert(Pointer(&A, i)), "Did not insert new pointer");
+            check(!S.insert(Pointer(&A, i)), "Inserted pointer twice");
+        }
+
+        check(!S.isSmall(), "Big set is still small");
+        check(S.size() == num);
+        for (unsigned i = 0; i < num; ++i)
+            check(S.count(Pointer(&A, i)) == 1, "Lost pointer A + %u", i);
+        check(S.count(Pointer(&B, 0)) == 0, "Has pointer that was not inserted");
+
+        unsigned n = 0;
+        for (const Pointer& ptr : S) {
+            check(ptr.target == &A);
+            ++n;
+        }
+        check(n == num, "Iterated over %u pointers instead of %u", n, num);
+
+        check(S.erase(Pointer(&A, 0)) == 1, "Did not erase pointer");
+        check(S.erase(Pointer(&A, 0)) == 0, "Erased pointer twice");
+        check(S.erase(Pointer(&B, 0)) == 0, "Erased non-existing pointer");
+        check(S.size() == num - 1);
+        check(S.count(Pointer(&A, 0)) == 0);
+    }
+
+    void merge()
+    {
+        using namespace dg::analysis::pta;
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+
+        PointsToSetT S1, S2, S3;
+        const unsigned num = 2 * PointsToSetT::SMALL_LIMIT;
+        for (unsigned i = 0; i < num; ++i) {
+            S1.insert(Pointer(&A, i));
+            S2.insert(Pointer(&B, i));
+        }
+
+        S3.insert(Pointer(&A, 1));
+
+        check(S1.insert(S2), "Merging did not change the set");
+        check(!S1.insert(S2), "Merging the same set changed the set");
+        check(!S1.insert(S3), "Merging sub-set changed the set");
+        check(S1.size() == 2 * num);
+        check(S1.count(Pointer(&B, num - 1)) == 1);
+
+        check(S3.insert(S1), "Merging to small set did not change it");
+        check(S3.size() == 2 * num);
+    }
+
+    void sharing()
+    {
+        using namespace dg::analysis::pta;
+        PSNode A(PSNodeType::ALLOC);
+        PSNode B(PSNodeType::ALLOC);
+
+        // the same pointers, but S1 is a bitvector
+        PointsToSetT S1, S2;
+        const unsigned num = 2 * PointsToSetT::SMALL_LIMIT;
+        for (unsigned i = 0; i < num; ++i)
+            S1.insert(Pointer(&A, i));
+        for (unsigned i = 2; i < num; ++i)
+            S1.erase(Pointer(&A, i));
+
+        S2.insert(Pointer(&A, 1));
+        S2.insert(Pointer(&A, 0));
+
+        check(S1 == S2, "The sets are not equal");
+        S1.share();
+        S2.share();
+        check(S1.isShared() && S2.isShared());
+        check(S1 == S2, "Shared sets are not equal");
+        check(S1.isSmall(), "Shared set does not have unique representation");
+
+        // copy on write
+        PointsToSetT S3 = S1;
+        check(S3.insert(Pointer(&B, 0)), "Did not insert into shared set");
+#ifndef BDD_POINTS_TO_SETS
+        // the BDDs are always shared
+        check(!S3.isShared());
+#endif
+        check(S3 != S1);
+        check(S1.size() == 2 && S1.count(Pointer(&B, 0)) == 0,
+              "Changed the shared data");
+        check(S2.size() == 2 && S2.count(Pointer(&B, 0)) == 0,
+              "Changed the shared data");
+
+        // the union of shared sets is shared too
+        PointsToSetT S4;
+        for (unsigned i = 0; i < num; ++i)
+            S4.insert(Pointer(&B, i));
+        S4.share();
+
+        check(S1.insert(S4), "Merging did not change the set");
+        check(S1.isShared());
+        check(S1.size() == 2 + num);
+        check(S2.insert(S4), "Merging did not change the set");
+        check(S1 == S2, "The same unions are not the same");
+        check(!S2.insert(S4), "Merging the same set changed the set");
+
+        S3.share();
+        check(S3 != S2);
+        check(S3.erase(Pointer(&B, 0)) == 1);
+        check(S3.count(Pointer(&B, 0)) == 0);
+    }
+
+    void points_to_map()
+    {
+        using namespace dg::analysis::pta;
+        PSNode A(PSNodeType::ALLOC);
+
+        // fields at 0, 8 and 16
+        FieldLayout layout({16, 0, 8, 8});
+        check(layout.size() == 3, "Duplicate fields in the layout");
+        check(layout.getSlot(8) == 1);
+        check(layout.getSlot(4) == FieldLayout::NONE);
+        check(layout.getSlot(UNKNOWN_OFFSET) == FieldLayout::NONE);
+
+        MemoryObject mo(&A, &layout);
+        check(mo.pointsTo.empty());
+        check(mo.addPointsTo(16, Pointer(&A, 0)));
+        check(mo.addPointsTo(4, Pointer(&A, 1)));
+        check(mo.addPointsTo(UNKNOWN_OFFSET, Pointer(&A, 2)));
+        check(mo.addPointsTo(0, Pointer(&A, 3)));
+        check(!mo.addPointsTo(16, Pointer(&A, 0)), "Inserted pointer twice");
+
+        check(mo.pointsTo.size() == 4, "Map has %lu entries",
+              (unsigned long) mo.pointsTo.size());
+        check(mo.pointsTo.count(16) == 1);
+        check(mo.pointsTo.count(8) == 0, "Has an unused field");
+        check(mo.pointsTo.count(4) == 1);
+        check(mo.pointsTo.count(12) == 0);
+
+        // the fields go first, then the other offsets
+        const uint64_t expected[] = {0, 16, 4, UNKNOWN_OFFSET};
+        unsigned n = 0;
+        for (const auto& it : mo.pointsTo) {
+            check(n < 4 && *it.first == expected[n],
+                  "Wrong offset %lu at %u", (unsigned long) *it.first, n);
+            check(it.second.size() == 1);
+            ++n;
+        }
+        check(n == 4, "Iterated over %u entries", n);
+
+        n = 0;
+        mo.pointsTo.forEachInRange(2, 16, [&](const PointsToMapT::value_type& it) {
+            check(*it.first == 4 || *it.first == 16,
+                  "Wrong offset %lu in range", (unsigned long) *it.first);
+            ++n;
+        });
+        check(n == 2, "Visited %u entries in range", n);
+        check(mo.pointsTo.find(UNKNOWN_OFFSET) != mo.pointsTo.end());
+        check(mo.pointsTo.find(8) == mo.pointsTo.end());
+
+        unsigned version = mo.version;
+        check(!mo.addPointsTo(0, Pointer(&A, 3)));
+        check(mo.version == version, "Version changed without a change");
+
+        mo.collapse();
+        check(mo.pointsTo.size() == 1);
+        check(mo.getPointsTo(8).size() == 4, "Lost pointers when collapsing");
+    }
+
+    // the quick rejection of the pointers that are not in the set
+    // must not lose any pointer that is in the set
+    void filters()
+    {
+        using namespace dg::analysis::pta;
+        const unsigned num = 200;
+        std::vector<std::unique_ptr<PSNode>> targets;
+        for (unsigned i = 0; i < num; ++i)
+            targets.emplace_back(new PSNode(PSNodeType::ALLOC));
+
+        PointsToSetT S1, S2;
+        for (unsigned i = 0; i < num; i += 3)
+            S1.insert(Pointer(targets[i].get(), 0));
+        for (unsigned i = 1; i < num; i += 3)
+            S2.insert(Pointer(targets[i].get(), 0));
+
+        for (unsigned i = 0; i < num; ++i) {
+            check(S1.count(Pointer(targets[i].get(), 0)) == (i % 3 == 0),
+                  "Wrong membership of %u", i);
+            check(S1.count(Pointer(targets[i].get(), 1)) == 0,
+                  "Has pointer with wrong offset");
+        }
+
+        S2.share();
+        check(S1.insert(S2), "Merging did not change the set");
+        for (unsigned i = 0; i < num; ++i)
+            check(S1.count(Pointer(targets[i].get(), 0)) == (i % 3 != 2),
+                  "Wrong membership of %u after merge", i);
+
+        // erasing keeps the filter correct
+        for (unsigned i = 0; i < num; i += 2)
+            S1.erase(Pointer(targets[i].get(), 0));
+        S1.share();
+        for (unsigned i = 0; i < num; ++i)
+            check(S1.count(Pointer(targets[i].get(), 0)) == (i % 3 != 2 && i % 2 != 0),
+                  "Wrong membership of %u after erase", i);
+
+        S1.clear();
+        check(S1.count(Pointer(targets[1].get(), 0)) == 0,
+              "Has pointer after clear");
+    }
+
+    void test()
+    {
+        small_and_big();
+        merge();
+        sharing();
+        points_to_map();
+        filters();
+        bdd_sets();
+    }
+
+    void bdd_sets()
+    {
+        using namespace dg::analysis::pta;
+        using BDDSetT = BDDPointsToSet<Pointer, PointerHash>;
+
+        const unsigned num = 64;
+        std::vector<std::unique_ptr<PSNode>> targets;
+        for (unsigned i = 0; i < num; ++i)
+            targets.emplace_back(new PSNode(PSNodeType::ALLOC));
+
+        // random changes of the sets checked against std::set
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<unsigned> target(0, num - 1);
+        std::uniform_int_distribution<unsigned> off(0, 7);
+        std::uniform_int_distribution<unsigned> op(0, 9);
+
+        const unsigned sets = 8;
+        std::vector<BDDSetT> S(sets);
+        std::vector<std::set<Pointer>> R(sets);
+        bool ok = true;
+        for (unsigned i = 0; i < 5000; ++i) {
+            unsigned s = i % sets;
+            Pointer p(targets[target(gen)].get(), off(gen));
+            unsigned o = op(gen);
+            if (o < 6) {
+                ok &= S[s].insert(p) == R[s].insert(p).second;
+            } else if (o < 8) {
+                ok &= S[s].erase(p) == R[s].erase(p);
+            } else {
+                unsigned t = (s + 1 + o) % sets;
+                size_t before = R[s].size();
+                R[s].insert(R[t].begin(), R[t].end());
+                ok &= S[s].insert(S[t]) == (R[s].size() != before);
+            }
+
+            ok &= S[s].size() == R[s].size();
+            ok &= S[s].count(p) == R[s].count(p);
+        }
+        check(ok, "The BDD sets differ from std::set");
+
+        for (unsigned s = 0; s < sets; ++s) {
+            std::set<Pointer> elems;
+            unsigned n = 0;
+            for (const Pointer& ptr : S[s]) {
+                elems.insert(ptr);
+                ++n;
+            }
+            check(elems == R[s], "Iterated over wrong pointers");
+            check(n == R[s].size(), "Iterated over %u pointers", n);
+        }
+
+        // equal sets have the same representation
+        BDDSetT A, B;
+        for (unsigned i = 0; i < num; ++i)
+            A.insert(Pointer(targets[i].get(), 0));
+        for (unsigned i = num; i > 0; --i)
+            B.insert(Pointer(targets[i - 1].get(), 0));
+        check(A == B, "Equal sets are not equal");
+        check(B.erase(Pointer(targets[0].get(), 0)) == 1);
+        check(A != B && A.size() == num && B.size() == num - 1);
+
+        // copies do not change the original
+        BDDSetT C = A;
+        check(C.insert(Pointer(targets[0].get(), 1)));
+        check(A.size() == num && A.count(Pointer(targets[0].get(), 1)) == 0,
+              "Changed the copied set");
+        C.clear();
+        check(C.empty() && C.begin() == C.end());
+        check(A.count(Pointer(targets[5].get(), 0)) == 1, "Lost a pointer");
+    }
+};
+
+class ReturnSummaryTest : public Test
+{
+
+public:
+    ReturnSummaryTest()
+          : Test("return summary test") {}
+
+    void compute()
+    {
+        PSNode A(PSNodeType::ALLOC);
+        PSNode P(PSNodeType::PHI, nullptr);
+        PSNode C(PSNodeType::CAST, &P);
+        PSNode G(PSNodeType::GEP, &C, 4);
+        PSNode G2(PSNodeType::GEP, &G, 4);
+        PSNode R1(PSNodeType::RETURN, &G2, nullptr);
+        PSNode R2(PSNodeType::RETURN, &A, nullptr);
+
+        std::map<PSNode *, unsigned> args = {{&P, 0}};
+        ReturnSummary S;
+        check(S.compute({&R1, &R2}, args), "Did not compute the summary");
+        check(S.isValid() && S.hasArguments());
+        check(S.getTerms().size() == 2, "Wrong number of terms");
+        for (const ReturnSummary::Term& t : S.getTerms()) {
+            if (t.source) {
+                check(t.source == &A && *t.offset == 0, "Wrong term");
+            } else {
+                check(t.arg == 0 && *t.offset == 8, "Wrong term");
+            }
+        }
+
+        // the returned value comes from the memory
+        PSNode L(PSNodeType::LOAD, &P);
+        PSNode R3(PSNodeType::RETURN, &L, nullptr);
+        ReturnSummary S2;
+        check(!S2.compute({&R1, &R3}, args), "Summarized a load");
+        check(!S2.isValid());
+    }
+
+    void instantiate()
+    {
+        // id(p) { return p + 4; } called as id(X) and id(Y)
+        PSNode X(PSNodeType::ALLOC);
+        PSNode Y(PSNodeType::ALLOC);
+        PSNode P(PSNodeType::PHI, &X, &Y, nullptr);
+        PSNode G(PSNodeType::GEP, &P, 4);
+        PSNode R(PSNodeType::RETURN, &G, nullptr);
+        X.setSize(8);
+        Y.setSize(8);
+
+        ReturnSummary S;
+        check(S.compute({&R}, {{&P, 0}}), "Did not compute the summary");
+
+        ADT::Arena<PSNode> nodes;
+        PSNode *V1, *V2;
+        auto seq1 = S.instantiate({&X}, nodes, V1);
+        auto seq2 = S.instantiate({&Y}, nodes, V2);
+        check(seq1.first == V1 && seq1.second == V1, "Wrong new nodes");
+        check(seq2.first == V2 && seq2.second == V2, "Wrong new nodes");
+
+        PSNode CR1(PSNodeType::CALL_RETURN, V1, nullptr);
+        PSNode CR2(PSNodeType::CALL_RETURN, V2, nullptr);
+
+        X.addSuccessor(&Y);
+        Y.addSuccessor(V1);
+        V1->addSuccessor(V2);
+        V2->addSuccessor(&P);
+        P.addSuccessor(&G);
+        G.addSuccessor(&R);
+        R.addSuccessor(&CR1);
+        CR1.addSuccessor(&CR2);
+
+        PointerSubgraph PS(&X);
+        PointsToFlowInsensitive PA(&PS);
+        PA.run();
+
+        check(R.pointsTo.size() == 2, "R does not have both pointers");
+        check(CR1.doesPointsTo(&X, 4) && CR1.pointsTo.size() == 1,
+              "CR1 does not point only to X + 4");
+        check(CR2.doesPointsTo(&Y, 4) && CR2.pointsTo.size() == 1,
+              "CR2 does not point only to Y + 4");
+
+        // the call does not pass the argument
+        PSNode *V3;
+        auto seq3 = S.instantiate({nullptr}, nodes, V3);
+        check(!V3 && !seq3.first, "Instantiated missing argument");
+    }
+
+    void compose()
+    {
+        // alloc() { return malloc(8); }
+        // wrapper() { return alloc(); }
+        PSNode M(PSNodeType::DYN_ALLOC);
+        PSNode R(PSNodeType::RETURN, &M, nullptr);
+        M.setIsHeap();
+        M.setSize(8);
+
+        ReturnSummary S;
+        check(S.compute({&R}, {}), "Did not compute the summary");
+        check(S.hasHeapAllocations() && !S.hasArguments(), "Wrong summary");
+
+        // the call of alloc() in wrapper() gets its own allocation
+        ADT::Arena<PSNode> nodes;
+        PSNode *V;
+        auto seq = S.instantiate({}, nodes, V, [&nodes](PSNode *src) {
+            PSNode *clone = nodes.create(PSNodeType::DYN_ALLOC);
+            clone->setIsHeap();
+            clone->setSize(src->getSize());
+            return clone;
+        });
+        check(!seq.first, "Created nodes before the call");
+        check(V && V != &M && V->getType() == PSNodeType::DYN_ALLOC,
+              "Did not use the clone");
+
+        PSNode CR(PSNodeType::CALL_RETURN, V, nullptr);
+        PSNode R2(PSNodeType::RETURN, &CR, nullptr);
+
+        // the call is not known to be instantiated
+        ReturnSummary S2;
+        check(!S2.compute({&R2}, {}), "Summarized a call");
+
+        check(S2.compute({&R2}, {}, {&CR}), "Did not compose the summaries");
+        check(S2.getTerms().size() == 1 && S2.getTerms()[0].source == V,
+              "Wrong composed summary");
+        check(S2.hasHeapAllocations(), "Lost the heap allocation");
+    }
+
+    void test()
+    {
+        compute();
+        instantiate();
+        compose();
     }
 };
 
@@ -797,7 +2373,27 @@ int main(void)
 
     Runner.add(new FlowInsensitivePointsToTest());
     Runner.add(new FlowSensitivePointsToTest());
+    Runner.add(new FlowInsensitiveWorklistPointsToTest());
+    Runner.add(new FlowSensitiveWorklistPointsToTest());
+    Runner.add(new FlowInsensitiveSCCPointsToTest());
+    Runner.add(new FlowSensitiveSCCPointsToTest());
+    Runner.add(new FlowInsensitiveParallelPointsToTest());
+    Runner.add(new FlowSensitiveParallelPointsToTest());
+    Runner.add(new SparseFlowSensitivePointsToTest());
+    Runner.add(new AndersenPointsToTest());
+    Runner.add(new SteensgaardPointsToTest());
+    Runner.add(new DemandDrivenPointsToTest());
+    Runner.add(new FlowSensitiveRegionTest());
+    Runner.add(new FlowSensitiveWritersTest());
+    Runner.add(new RenumberNodesTest());
+    Runner.add(new ReachableNodesTest());
+    Runner.add(new TopLevelTest());
+    Runner.add(new BudgetTest());
+    Runner.add(new ProgressTest());
+    Runner.add(new LoopWideningTest());
     Runner.add(new PSNodeTest());
+    Runner.add(new PointsToSetTest());
+    Runner.add(new ReturnSummaryTest());
 
     return Runner();
 }
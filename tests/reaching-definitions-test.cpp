@@ -1,13 +1,19 @@
 #include <assert.h>
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <set>
 
 #include "test-runner.h"
 #include "test-dg.h"
 
 #include "analysis/ReachingDefinitions/ReachingDefinitions.h"
 #include "analysis/ReachingDefinitions/RDMap.h"
+#include "analysis/ReachingDefinitions/MemorySSA.h"
+#include "analysis/ReachingDefinitions/RDQueryCache.h"
+#include "analysis/SCC.h"
 
 namespace dg {
 namespace tests {
@@ -237,12 +243,729 @@ public:
         //dumpMap(&S2);
     }
 
+    void loop()
+    {
+        RDNode AL1;
+        RDNode S1;
+        RDNode L(NOOP);
+        RDNode S2;
+        RDNode E(NOOP);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 0, 4, true /* strong update */);
+
+        // the definition from S2 gets to L only via the back edge
+        AL1.addSuccessor(&S1);
+        S1.addSuccessor(&L);
+        L.addSuccessor(&S2);
+        S2.addSuccessor(&L);
+        L.addSuccessor(&E);
+
+        ReachingDefinitionsAnalysis RD(&AL1);
+        RD.run();
+
+        std::set<RDNode *> rd;
+        L.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 2, "Should have two r.d. in the loop");
+        rd.clear();
+        E.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 2, "Should have two r.d. after the loop");
+        rd.clear();
+        S2.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 1, "Should have had one r.d.");
+        check(*(rd.begin()) == &S2, "Should be S2");
+    }
+
+    void sparse()
+    {
+        RDNode AL1;
+        RDNode S1;
+        RDNode N1(NOOP);
+        RDNode L(NOOP);
+        RDNode N2(NOOP);
+        RDNode S2;
+        RDNode E(NOOP);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 0, 4, true /* strong update */);
+
+        AL1.addSuccessor(&S1);
+        S1.addSuccessor(&N1);
+        N1.addSuccessor(&L);
+        L.addSuccessor(&N2);
+        N2.addSuccessor(&S2);
+        S2.addSuccessor(&L);
+        L.addSuccessor(&E);
+
+        ReachingDefinitionsAnalysis RD(&AL1);
+        RD.setSparse(true);
+        RD.run();
+
+        // pass-through nodes share the map of the node above them
+        check(&N1.getReachingDefinitions() == &S1.getReachingDefinitions(),
+              "N1 should share the map of S1");
+        check(&E.getReachingDefinitions() == &L.getReachingDefinitions(),
+              "E should share the map of L");
+
+        std::set<RDNode *> rd;
+        N1.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &S1, "Should be S1");
+        rd.clear();
+        N2.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 2, "Should have two r.d. in the loop");
+        rd.clear();
+        E.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 2, "Should have two r.d. after the loop");
+    }
+
+    void summaries()
+    {
+        // main: SY; SA; h(); SB; h() and h: HS
+        RDNode AL1, AL2;
+        RDNode SY, SA, SB;
+        RDNode C1(CALL), R1(CALL_RETURN), C2(CALL), R2(CALL_RETURN);
+        RDNode HR(NOOP), HS, HRET(NOOP);
+
+        SY.addDef(&AL2, 0, 4, true /* strong update */);
+        SA.addDef(&AL1, 0, 4, true /* strong update */);
+        SB.addDef(&AL1, 0, 4, true /* strong update */);
+        HS.addDef(&AL2, 0, 4, true /* strong update */);
+
+        for (RDNode *n : {&SY, &SA, &SB, &C1, &R1, &C2, &R2})
+            n->setProcedure(1);
+        for (RDNode *n : {&HR, &HS, &HRET})
+            n->setProcedure(2);
+
+        RDSummary summary;
+        summary.ret = &HRET;
+        summary.procedures = {2};
+
+        AL1.addSuccessor(&AL2);
+        AL2.addSuccessor(&SY);
+        SY.addSuccessor(&SA);
+        SA.addSuccessor(&C1);
+        R1.addSuccessor(&SB);
+        SB.addSuccessor(&C2);
+        HR.addSuccessor(&HS);
+        HS.addSuccessor(&HRET);
+        for (auto call : {std::make_pair(&C1, &R1), std::make_pair(&C2, &R2)}) {
+            call.first->addSuccessor(&HR);
+            HRET.addSuccessor(call.second);
+            call.first->addSuccessor(call.second);
+            call.second->setSummary(&summary);
+        }
+
+        ReachingDefinitionsAnalysis RD(&AL1);
+        RD.run();
+
+        // the definitions of both calls are merged in h
+        std::set<RDNode *> rd;
+        HRET.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 2, "Should have SA and SB in h");
+
+        // but they do not get from one call to the other
+        rd.clear();
+        R1.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &SA, "Should be SA");
+        rd.clear();
+        R2.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &SB, "Should be SB");
+
+        // h must overwrite the definition from SY
+        rd.clear();
+        R1.getReachingDefinitions(&AL2, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &HS, "Should be HS");
+        rd.clear();
+        R2.getReachingDefinitions(&AL2, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &HS, "Should be HS");
+    }
+
+    void parallel()
+    {
+        RDNode AL1;
+        RDNode S1, S2, S3, S4;
+        RDNode B(NOOP);
+        RDNode J(NOOP);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 0, 4, true /* strong update */);
+        S3.addDef(&AL1, 4, 4, true /* strong update */);
+        S4.addDef(&AL1, 0, 4, true /* strong update */);
+
+        // two independent branches, the second one with a loop
+        AL1.addSuccessor(&B);
+        B.addSuccessor(&S1);
+        B.addSuccessor(&S2);
+        S1.addSuccessor(&J);
+        S2.addSuccessor(&S3);
+        S3.addSuccessor(&S2);
+        S3.addSuccessor(&J);
+        J.addSuccessor(&S4);
+
+        for (bool sparse : {false, true}) {
+            ReachingDefinitionsAnalysis RD(&AL1);
+            RD.setSparse(sparse);
+            RD.setThreads(4);
+            RD.run();
+
+            std::set<RDNode *> rd;
+            J.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 2, "Should have S1 and S2");
+            rd.clear();
+            J.getReachingDefinitions(&AL1, 4, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S3, "Should be S3");
+            rd.clear();
+            S4.getReachingDefinitions(&AL1, 0, 8, rd);
+            check(rd.size() == 2, "Should have S3 and S4");
+        }
+    }
+
+    void max_growths()
+    {
+        for (uint32_t growths : {0U, 1U}) {
+            RDNode AL1, AL2;
+            RDNode S;
+            RDNode W1, W2, W3;
+            RDNode L(NOOP);
+            RDNode E(NOOP);
+
+            S.addDef(&AL2, 0, 4, true /* strong update */);
+            W1.addDef(&AL1, 0, 4, false /* weak update */);
+            W2.addDef(&AL1, 0, 4, false /* weak update */);
+            W3.addDef(&AL1, 0, 4, false /* weak update */);
+
+            // the set of AL1 grows in every iteration of the loop
+            AL1.addSuccessor(&S);
+            S.addSuccessor(&L);
+            L.addSuccessor(&W1);
+            W1.addSuccessor(&W2);
+            W2.addSuccessor(&W3);
+            W3.addSuccessor(&L);
+            L.addSuccessor(&E);
+
+            ReachingDefinitionsAnalysis RD(&AL1);
+            RD.collectStatistics();
+            RD.setMaxGrowths(growths);
+            RD.run();
+
+            const ReachingDefinitionsStatistics& st = RD.getStatistics();
+            std::set<RDNode *> rd;
+            E.getReachingDefinitions(&AL1, 0, 4, rd);
+            if (growths == 0) {
+                check(rd.size() == 3, "Should have W1, W2 and W3");
+                check(st.truncatedNum == 0, "Should not truncate anything");
+
+                auto largest = st.getLargest(1);
+                check(largest.size() == 1 && largest[0].first.target == &AL1
+                      && largest[0].second.maxSize == 3,
+                      "AL1 should have the largest set");
+                check(st.nodes.count(&W1) == 1 && st.nodes.at(&W1).processed > 0
+                      && st.nodes.at(&W1).growth > 0,
+                      "No statistics of processing W1");
+            } else {
+                check(rd.count(UNKNOWN_MEMORY) == 1,
+                      "AL1 should be defined at unknown place");
+                check(st.truncatedNum == 1, "Should truncate only AL1");
+            }
+
+            rd.clear();
+            E.getReachingDefinitions(&AL2, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S, "AL2 should be precise");
+        }
+    }
+
+    void max_offsets()
+    {
+        for (uint32_t offsets : {0U, 2U}) {
+            RDNode AL1, AL2;
+            RDNode W1, W2, W3, S1, S2;
+            RDNode E(NOOP);
+
+            // AL1 is written at three offsets, AL2 at two
+            W1.addDef(&AL1, 0, 4, true /* strong update */);
+            W2.addDef(&AL1, 4, 4, true /* strong update */);
+            W3.addDef(&AL1, 8, 4, true /* strong update */);
+            S1.addDef(&AL2, 0, 4, true /* strong update */);
+            S2.addDef(&AL2, 4, 4, true /* strong update */);
+
+            AL1.addSuccessor(&AL2);
+            AL2.addSuccessor(&W1);
+            W1.addSuccessor(&W2);
+            W2.addSuccessor(&W3);
+            W3.addSuccessor(&S1);
+            S1.addSuccessor(&S2);
+            S2.addSuccessor(&E);
+
+            ReachingDefinitionsAnalysis RD(&AL1);
+            RD.setMaxOffsets(offsets);
+            RD.run();
+
+            std::set<RDNode *> rd;
+            E.getReachingDefinitions(&AL1, 4, 4, rd);
+            if (offsets == 0) {
+                check(rd.size() == 1 && *rd.begin() == &W2,
+                      "Should have only W2");
+                check(RD.getCollapsedNum() == 0, "Should collapse nothing");
+            } else {
+                check(rd.size() == 3, "Should have W1, W2 and W3");
+                check(RD.getCollapsedNum() == 1, "Should collapse only AL1");
+
+                const RDMap& map = E.getReachingDefinitions();
+                auto range = map.getObjectRange(&AL1);
+                check(range.second - range.first == 1
+                      && range.first->first.offset.isUnknown(),
+                      "AL1 should have one def-site");
+            }
+
+            rd.clear();
+            E.getReachingDefinitions(&AL2, 4, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S2, "AL2 should be precise");
+        }
+    }
+
+    void update()
+    {
+        for (bool sparse : {false, true}) {
+            RDNode AL1;
+            RDNode S1, S2;
+            RDNode N(NOOP);
+            RDNode E(NOOP);
+
+            S1.addDef(&AL1, 0, 4, true /* strong update */);
+            S2.addDef(&AL1, 0, 4, true /* strong update */);
+
+            AL1.addSuccessor(&S1);
+            S1.addSuccessor(&N);
+            N.addSuccessor(&E);
+
+            ReachingDefinitionsAnalysis RD(&AL1);
+            RD.setSparse(sparse);
+            RD.run();
+
+            // insert S2 after N
+            S2.insertAfter(&N);
+            std::vector<RDNode *> recomputed = RD.update({&S2});
+            check(recomputed.size() == 2, "Should recompute only S2 and E");
+
+            std::set<RDNode *> rd;
+            E.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S2, "Should be S2");
+            rd.clear();
+            N.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S1, "Should be S1");
+
+            // and remove it again, E must not keep the old definition
+            S2.isolate();
+            N.addSuccessor(&E);
+            RD.update({&E});
+
+            rd.clear();
+            E.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S1, "Should be S1");
+        }
+    }
+
+    void memory_ssa()
+    {
+        RDNode AL1, AL2;
+        RDNode S1, S2, S3, S4, S5;
+        RDNode B(NOOP);
+        RDNode J(NOOP);
+        RDNode L(NOOP);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 0, 4, true /* strong update */);
+        S3.addDef(&AL1, 4, 4, true /* strong update */);
+        S4.addDef(&AL1, 0, 4, true /* strong update */);
+        S5.addDef(&AL2, 0, 4, false /* weak update */);
+
+        // a branch with a loop and a loop with weak update
+        AL1.addSuccessor(&B);
+        B.addSuccessor(&S1);
+        B.addSuccessor(&S2);
+        S1.addSuccessor(&J);
+        S2.addSuccessor(&S3);
+        S3.addSuccessor(&S2);
+        S3.addSuccessor(&J);
+        J.addSuccessor(&L);
+        L.addSuccessor(&S5);
+        S5.addSuccessor(&L);
+        L.addSuccessor(&S4);
+
+        MemorySSATransformation SSA(&AL1);
+        SSA.run();
+
+        std::set<RDNode *> rd;
+        SSA.getReachingDefinitions(&J, &AL1, 0, 4, rd);
+        check(rd.size() == 2, "Should have S1 and S2");
+        rd.clear();
+        SSA.getReachingDefinitions(&S2, &AL1, 0, 8, rd);
+        check(rd.size() == 2, "Should have S2 and S3 in the loop");
+        rd.clear();
+        SSA.getReachingDefinitions(&S4, &AL1, 0, 8, rd);
+        check(rd.size() == 2, "Should have S3 and S4");
+        rd.clear();
+        SSA.getReachingDefinitions(&L, &AL2, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &S5, "Should be S5");
+        rd.clear();
+        SSA.getReachingDefinitions(&B, &AL1, 0, 4, rd);
+        check(rd.empty(), "Should have no r.d.");
+    }
+
+    void rdmap()
+    {
+        RDNode A, S1, S2, S3, S4;
+        RDMap M;
+
+        M.add(DefSite(&A, 0, 4), &S1);
+        M.add(DefSite(&A, 8, 4), &S2);
+        M.add(DefSite(&A, 100, 2), &S3);
+
+        std::set<RDNode *> rd;
+        M.get(&A, 2, 8, rd);
+        check(rd.size() == 2, "Should have two r.d. (S1 and S2)");
+        rd.clear();
+        M.get(&A, 50, 4, rd);
+        check(rd.size() == 0, "Should have no r.d.");
+        rd.clear();
+        M.get(&A, 101, 1, rd);
+        check(rd.size() == 1 && *rd.begin() == &S3, "Should be S3");
+
+        // merge new def-sites and extend the existing one
+        RDMap O;
+        O.add(DefSite(&A, 4, 4), &S4);
+        O.add(DefSite(&A, 8, 4), &S4);
+        check(M.merge(&O), "Merge should change the map");
+        check(!M.merge(&O), "Second merge should not change the map");
+        rd.clear();
+        M.get(&A, 4, 8, rd);
+        check(rd.size() == 2, "Should have two r.d. (S2 and S4)");
+
+        // weak update of unknown offset folds the concrete offsets
+        RDMap U;
+        U.add(DefSite(&A, UNKNOWN_OFFSET, UNKNOWN_OFFSET), &S1);
+        check(M.merge(&U, nullptr, true, ~((uint32_t) 0), true),
+              "Merge should change the map");
+        check(M.definesWithAnyOffset(DefSite(&A)), "Should define A");
+        size_t num = 0;
+        for (const auto& it : M) {
+            check(it.first.offset.isUnknown(), "Should have only unknown offset");
+            ++num;
+        }
+        check(num == 1, "Should have one def-site");
+        rd.clear();
+        M.get(&A, 8, 1, rd);
+        check(rd.size() == 4, "Should have all the r.d.");
+
+        // copies share the definitions until written
+        RDMap C = M;
+        check(C.shares(M), "Copy should share the definitions");
+        check(!C.merge(&M), "Merge of shared map should not change it");
+        C.add(DefSite(&A, 0, 4), &S2);
+        check(!C.shares(M), "Write should unshare the definitions");
+        rd.clear();
+        M.get(&A, 0, 4, rd);
+        check(rd.size() == 4, "Original should not change");
+        rd.clear();
+        C.get(&A, 0, 4, rd);
+        check(rd.size() == 4 && C.definesWithAnyOffset(DefSite(&A)),
+              "Copy should have the r.d.");
+
+        // plain merge to an empty map shares the definitions
+        RDMap E;
+        check(E.merge(&C), "Merge to empty map should change it");
+        check(E.shares(C), "Empty map should share the definitions");
+    }
+
+    // the queries for the objects that are not in the map are
+    // rejected by the filter of the targets, the others must not be
+    void target_filter()
+    {
+        const unsigned num = 200;
+        std::vector<std::unique_ptr<RDNode>> nodes;
+        for (unsigned i = 0; i < num; ++i)
+            nodes.emplace_back(new RDNode());
+
+        RDNode S1, S2;
+        RDMap M, O;
+        for (unsigned i = 0; i < num; i += 3)
+            M.add(DefSite(nodes[i].get(), 0, 4), &S1);
+        for (unsigned i = 1; i < num; i += 3)
+            O.add(DefSite(nodes[i].get(), UNKNOWN_OFFSET, UNKNOWN_OFFSET), &S2);
+
+        bool ok = true;
+        std::set<RDNode *> rd;
+        for (unsigned i = 0; i < num; ++i) {
+            RDNode *n = nodes[i].get();
+            rd.clear();
+            ok &= M.defines(DefSite(n, 0, 4)) == (i % 3 == 0);
+            ok &= M.definesWithAnyOffset(DefSite(n)) == (i % 3 == 0);
+            ok &= M.get(n, 2, 1, rd) == (i % 3 == 0 ? 1 : 0);
+        }
+        check(ok, "Wrong answers of the queries");
+
+        // the merged and copied maps have the filter of the merged targets
+        RDMap E;
+        check(E.merge(&O), "Merge to empty map should change it");
+        check(M.merge(&O), "Merge should change the map");
+        RDMap C = M;
+        for (unsigned i = 0; i < num; ++i) {
+            RDNode *n = nodes[i].get();
+            ok &= E.definesWithAnyOffset(DefSite(n)) == (i % 3 == 1);
+            ok &= C.definesWithAnyOffset(DefSite(n)) == (i % 3 != 2);
+            ok &= C.defines(DefSite(n, UNKNOWN_OFFSET, UNKNOWN_OFFSET)) == (i % 3 == 1);
+        }
+        check(ok, "Wrong answers of the queries after merge");
+    }
+
+    void query_cache()
+    {
+        RDNode A, B, S1, S2, S3;
+        RDMap M;
+        M.add(DefSite(&A, 0, 4), &S1);
+        M.add(DefSite(&A, 8, 4), &S2);
+        M.add(DefSite(&B, 0, 4), &S3);
+
+        // the batch gives the same as the single queries
+        std::vector<DefSite> sites{DefSite(&A, 2, 8), DefSite(&A, 50, 4),
+                                   DefSite(&B, 0, 4), DefSite(&A)};
+        std::vector<std::vector<RDNode *>> defs;
+        M.get(sites, defs);
+        check(defs.size() == sites.size(), "Should have all the results");
+        for (size_t i = 0; i < sites.size(); ++i) {
+            std::set<RDNode *> rd;
+            M.get(sites[i], rd);
+            check(std::vector<RDNode *>(rd.begin(), rd.end()) == defs[i],
+                  "Batch query differs at %zu", i);
+        }
+
+        // the copies of the map share the results
+        RDMap C = M;
+        RDQueryCache cache;
+        std::vector<RDQueryCache::ResultT> res1, res2;
+        cache.get(M, sites, res1);
+        check(cache.getMisses() == sites.size() && cache.getHits() == 0,
+              "Should query all the sites");
+        cache.get(C, sites, res2);
+        check(cache.getHits() == sites.size(), "Should hit all the sites");
+        for (size_t i = 0; i < sites.size(); ++i) {
+            check(res1[i] == res2[i], "Should share the results");
+            check(*res1[i] == defs[i], "Cached result differs at %zu", i);
+        }
+
+        // a changed copy has other results
+        C.add(DefSite(&B, 0, 4), &S1);
+        cache.get(C, sites, res2);
+        check(res2[2]->size() == 2 && res1[2]->size() == 1,
+              "Should query the changed map");
+    }
+
+    void overwrites()
+    {
+        RDNode A, B, S1, S2;
+        RDMap O;
+        O.add(DefSite(&A, 0, 4), &S1);
+        O.add(DefSite(&A, 4, 8), &S1);
+        O.add(DefSite(&A, 10, 4), &S1);
+        O.add(DefSite(&B, 0, 4), &S1);
+
+        // the adjacent strong updates overwrite A[0, 12),
+        // the update of B at unknown offset is weak
+        DefSiteSetT sites{DefSite(&A, 0, 4), DefSite(&A, 4, 8),
+                          DefSite(&B, UNKNOWN_OFFSET, UNKNOWN_OFFSET)};
+        RDOverwrites ow(sites);
+
+        RDMap M;
+        M.add(DefSite(&A, 0, 4), &S2);
+        M.add(DefSite(&A, 4, 8), &S2);
+        check(M.merge(&O, &ow), "Merge should change the map");
+
+        std::set<RDNode *> rd;
+        M.get(&A, 0, 12, rd);
+        check(rd.size() == 2, "Should have S2 and S1 from A[10]");
+        rd.clear();
+        M.get(&A, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &S2, "Should be only S2");
+        check(M.defines(DefSite(&A, 10, 4)), "Should define A[10]");
+        check(M.defines(DefSite(&B, 0, 4)), "Should define B[0]");
+    }
+
+    void nodes_set()
+    {
+        RDNode A, B, C, D;
+        RDNodesSet S;
+
+        check(S.insert(&C), "Should insert C");
+        check(!S.insert(&C), "Should not insert C again");
+        check(S.insert(&A), "Should insert A");
+        check(S.size() == 2, "Should have two nodes");
+
+        // switch to the big set
+        check(S.insert(&D), "Should insert D");
+        check(S.insert(&B), "Should insert B");
+        check(!S.insert(&A), "Should not insert A again");
+        check(S.size() == 4, "Should have four nodes");
+        check(S.count(&B) == 1, "Should contain B");
+        check(std::is_sorted(S.begin(), S.end()), "Should be sorted");
+
+        RDNodesSet O;
+        O.insert(&A);
+        check(O.insert(S), "Merge should change the set");
+        check(O.size() == 4, "Should have four nodes");
+        check(!O.insert(S), "Merge should not change the set");
+
+        O.insert(UNKNOWN_MEMORY);
+        check(O.isUnknown() && O.size() == 1, "Should be unknown");
+        check(!O.insert(&A), "Should not insert into unknown set");
+        check(S.insert(O) && S.isUnknown(), "Should be unknown");
+
+        S.clear();
+        check(S.size() == 0 && !S.isUnknown(), "Should be empty");
+        check(S.insert(&B) && S.size() == 1, "Should insert B");
+    }
+
+    void def_sites_set()
+    {
+        RDNode A, B;
+        DefSiteSetT S;
+
+        check(S.empty() && S.begin() == S.end(), "Should be empty");
+        check(S.insert(DefSite(&B, 0, 4)), "Should insert B[0]");
+        check(!S.insert(DefSite(&B, 0, 4)), "Should not insert B[0] again");
+        check(S.size() == 1 && S.getAllocatedBytes() == 0,
+              "One def-site should be inline");
+
+        check(S.insert(DefSite(&A, 4, 4)), "Should insert A[4]");
+        check(S.insert(DefSite(&A, 0, 4)), "Should insert A[0]");
+        check(S.size() == 3 && std::is_sorted(S.begin(), S.end()),
+              "Should be sorted");
+        check(S.begin()->target == &A && *S.begin()->offset == 0,
+              "A[0] should be first");
+        check(S.count(DefSite(&A, 4, 4)) == 1, "Should contain A[4]");
+        check(S.count(DefSite(&A, 8, 4)) == 0, "Should not contain A[8]");
+
+        S.clear();
+        check(S.empty() && S.insert(DefSite(&A, 0, 4)), "Should insert A[0]");
+    }
+
+    void ids()
+    {
+        RDNode A, B, C;
+
+        check(A.getID() < B.getID() && B.getID() < C.getID(),
+              "Should get growing ids");
+        check(C.getID() <= RDNode::getLastID(), "Should be the last id");
+
+        // the def-sites are ordered by the ids, not by the addresses
+        RDMap M;
+        M.add(DefSite(&C, 0, 4), &A);
+        M.add(DefSite(&A, 0, 4), &A);
+        M.add(DefSite(&B, 0, 4), &A);
+        std::vector<RDNode *> order;
+        for (auto& it : M)
+            order.push_back(it.first.target);
+
+        check(order.size() == 3 && order[0] == &A
+              && order[1] == &B && order[2] == &C,
+              "Should iterate def-sites by the ids");
+    }
+
+    void scc()
+    {
+        // a path that is too long for a recursive search
+        // and that is closed into one big cycle
+        const unsigned len = 200000;
+        std::vector<RDNode> chain(len);
+        RDNode E(NOOP);
+        for (unsigned i = 1; i < len; ++i)
+            chain[i - 1].addSuccessor(&chain[i]);
+        chain[len - 1].addSuccessor(&chain[0]);
+        chain[len - 1].addSuccessor(&E);
+
+        analysis::SCC<RDNode> S;
+        auto& comps = S.compute(&chain[0]);
+        check(comps.size() == 2, "Should have the cycle and E");
+        check(S.getSCCId(&E) == 0 && comps[0].size() == 1,
+              "E should be the first component");
+        check(S.getSCCId(&chain[0]) == 1
+              && S.getSCCId(&chain[len - 1]) == 1
+              && comps[1].size() == len,
+              "The cycle should be one component");
+
+        RDNode U;
+        check(S.getSCCId(&U) == analysis::SCC<RDNode>::NONE,
+              "U was not reached");
+
+        analysis::SCCCondensation<RDNode> C(S);
+        check(C.size() == 2, "Should have two nodes");
+        check(C[1].getSuccessors().size() == 1
+              && C[1].getSuccessors()[0] == 0
+              && C[1].getPredecessors().empty(),
+              "The cycle should go only to E");
+        check(C[0].getSuccessors().empty()
+              && C[0].getPredecessors().size() == 1
+              && C[0].getPredecessors()[0] == 1,
+              "E should be reached only from the cycle");
+    }
+
+    void budget()
+    {
+        for (bool limited : {false, true}) {
+            const size_t N = 2 * analysis::Budget::CHECK_PERIOD;
+            RDNode AL1;
+            std::vector<RDNode> W(N);
+            RDNode E(NOOP);
+
+            AL1.addSuccessor(&W[0]);
+            for (size_t i = 0; i < N; ++i) {
+                W[i].addDef(&AL1, 0, 4, false /* weak update */);
+                if (i + 1 < N)
+                    W[i].addSuccessor(&W[i + 1]);
+            }
+            W[N - 1].addSuccessor(&E);
+
+            ReachingDefinitionsAnalysis RD(&AL1);
+            // any process takes more than one byte
+            if (limited)
+                RD.setBudget(analysis::Budget(0, 1));
+            RD.run();
+
+            std::set<RDNode *> rd;
+            E.getReachingDefinitions(&AL1, 0, 4, rd);
+            if (limited) {
+                check(RD.isBudgetExceeded(), "Should exceed the budget");
+                check(rd.count(UNKNOWN_MEMORY) == 1,
+                      "AL1 should be defined at unknown place");
+            } else {
+                check(!RD.isBudgetExceeded(), "Should not exceed the budget");
+                check(rd.size() == N, "Should have all the definitions");
+            }
+        }
+    }
+
     void test()
     {
         basic1();
         basic2();
         basic3();
         basic4();
+        loop();
+        sparse();
+        summaries();
+        parallel();
+        max_growths();
+        max_offsets();
+        update();
+        memory_ssa();
+        rdmap();
+        target_filter();
+        query_cache();
+        overwrites();
+        nodes_set();
+        def_sites_set();
+        ids();
+        scc();
+        budget();
     }
 };
 
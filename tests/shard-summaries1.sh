@@ -0,0 +1,38 @@
+#!/bin/bash
+
+TESTS_DIR=`dirname $0`
+source "$TESTS_DIR/test-runner.sh"
+
+set_environment
+
+CODE="$TESTS_DIR/sources/shard1.c"
+BCFILE="$TESTS_DIR/sources/shard1.bc"
+OUTDIR="$TESTS_DIR/sources/shard1.summaries"
+
+rm -rf "$BCFILE" "$OUTDIR"
+mkdir "$OUTDIR" || errmsg "Failed creating $OUTDIR"
+compile "$CODE" "$BCFILE"
+
+# every component gets its own shard
+llvm-shard -max-weight 1 -out-dir "$OUTDIR" "$BCFILE" > "$OUTDIR/plan" \
+	|| errmsg "Summarizing the shards failed"
+
+# set_both is summarized only from the summary of set in other shard
+cat "$OUTDIR"/shard-*.summaries | grep -qx 'set mod 0' \
+	|| errmsg "Wrong summary of set"
+cat "$OUTDIR"/shard-*.summaries | grep -qx 'set_both mod 0 1' \
+	|| errmsg "Wrong summary of set_both"
+
+# summarize the shard of set_both again with a different summary of set,
+# its summary must follow the boundary summary, not the body of set
+SET=`awk '/^shard/ { s = $2 } $1 == "set" { sub(":", "", s); print s }' "$OUTDIR/plan"`
+SET_BOTH=`awk '/^shard/ { s = $2 } $1 == "set_both" { sub(":", "", s); print s }' "$OUTDIR/plan"`
+[ "$SET" != "$SET_BOTH" ] || errmsg "set and set_both are in the same shard"
+
+echo 'set ref 0' > "$OUTDIR/shard-$SET.summaries"
+llvm-shard -max-weight 1 -out-dir "$OUTDIR" -shard "$SET_BOTH" "$BCFILE" \
+	|| errmsg "Summarizing the shard $SET_BOTH failed"
+grep -qx 'set_both ref 0 1' "$OUTDIR/shard-$SET_BOTH.summaries" \
+	|| errmsg "The boundary summary of set was not used"
+
+rm -rf "$OUTDIR"
@@ -0,0 +1,21 @@
+/* the functions are summarized in separate shards (shard-summaries1.sh) */
+
+void set(int *p)
+{
+	*p = 1;
+}
+
+void set_both(int *p, int *q)
+{
+	set(p);
+	set(q);
+}
+
+int main(void)
+{
+	int a, b;
+	set_both(&a, &b);
+
+	test_assert(a == 1);
+	return 0;
+}
@@ -2,6 +2,20 @@
 
 TESTS_DIR=`dirname $0`
 
+# The perf mode: with DG_TESTS_PERF=record, the wall time and the growth
+# of the peak RSS of every phase of llvm-slicer are stored to the
+# baseline (one file per test in the directory DG_TESTS_PERF_BASELINE,
+# tests/perf-baseline by default). With DG_TESTS_PERF=check, the test
+# fails when a phase takes DG_TESTS_PERF_RATIO times (1.5 by default)
+# more time or memory than in the baseline. The phases that took less
+# than DG_TESTS_PERF_MIN_MS milliseconds (20 by default) or used less than
+# DG_TESTS_PERF_MIN_KB kilobytes (1024 by default) are not checked,
+# they are too noisy.
+DG_TESTS_PERF_BASELINE=${DG_TESTS_PERF_BASELINE:-"$TESTS_DIR/perf-baseline"}
+DG_TESTS_PERF_RATIO=${DG_TESTS_PERF_RATIO:-1.5}
+DG_TESTS_PERF_MIN_MS=${DG_TESTS_PERF_MIN_MS:-20}
+DG_TESTS_PERF_MIN_KB=${DG_TESTS_PERF_MIN_KB:-1024}
+
 errmsg()
 {
 
@@ -82,6 +96,53 @@ get_result()
 	echo "$OUTPUT"
 }
 
+# print the phases from the time trace @1 of llvm-slicer
+# as lines 'phase<TAB>wall ms<TAB>peak RSS growth kB',
+# the runs of a phase are summed
+get_phases()
+{
+	sed -n 's/^{"name":"\([^"]*\)".*"dur":\([0-9.]*\).*"peak_rss_delta":\([0-9]*\).*/\1\t\2\t\3/p' "$1" |
+	awk -F '\t' '
+		{ if (!($1 in wall)) order[n++] = $1;
+		  wall[$1] += $2 / 1000; rss[$1] += $3 / 1024 }
+		END { for (i = 0; i < n; ++i)
+			printf("%s\t%.3f\t%d\n", order[i], wall[order[i]], rss[order[i]]) }'
+}
+
+# record or check the phases of the test @1 from the time trace @2
+check_perf()
+{
+	TEST="$1"
+	BASELINE="$DG_TESTS_PERF_BASELINE/$TEST.perf"
+
+	if [ "$DG_TESTS_PERF" = "record" ]; then
+		mkdir -p "$DG_TESTS_PERF_BASELINE" \
+			|| errmsg "Failed creating the perf baseline directory"
+		get_phases "$2" > "$BASELINE" || errmsg "Failed recording the perf baseline"
+		return
+	fi
+
+	if [ ! -f "$BASELINE" ]; then
+		echo "No perf baseline for $TEST, not checking"
+		return
+	fi
+
+	get_phases "$2" | awk -F '\t' -v ratio="$DG_TESTS_PERF_RATIO" \
+		-v min_ms="$DG_TESTS_PERF_MIN_MS" -v min_kb="$DG_TESTS_PERF_MIN_KB" '
+		NR == FNR { wall[$1] = $2; rss[$1] = $3; next }
+		($1 in wall) {
+			if ($2 >= min_ms && $2 > wall[$1] * ratio) {
+				printf("PERF: %s: %.3f ms, baseline %.3f ms\n", $1, $2, wall[$1])
+				failed = 1
+			}
+			if ($3 >= min_kb && $3 > rss[$1] * ratio) {
+				printf("PERF: %s: peak RSS +%d kB, baseline +%d kB\n", $1, $3, rss[$1])
+				failed = 1
+			}
+		}
+		END { exit failed }' "$BASELINE" - || errmsg "Performance regression"
+}
+
 run_test()
 {
 	TESTS_DIR=`dirname $0`
@@ -105,7 +166,13 @@ run_test()
 		export DG_TESTS_PTA="-pta $DG_TESTS_PTA"
 	fi
 
-	llvm-slicer $DG_TESTS_PTA -c test_assert "$BCFILE"
+	if [ -z "$DG_TESTS_PERF" ]; then
+		llvm-slicer $DG_TESTS_PTA -c test_assert "$BCFILE"
+	else
+		llvm-slicer $DG_TESTS_PTA -time-trace "$NAME.trace" -c test_assert "$BCFILE" \
+			|| errmsg "Slicing failed"
+		check_perf "`basename $NAME`" "$NAME.trace"
+	fi
 
 	# link assert to the code
 	link_with_assert "$SLICEDFILE" "$LINKEDFILE"
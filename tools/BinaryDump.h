@@ -0,0 +1,209 @@
+#ifndef _DG_TOOLS_BINARY_DUMP_H_
+#define _DG_TOOLS_BINARY_DUMP_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "analysis/Offset.h"
+
+namespace dg {
+namespace debug {
+
+///
+// Compact binary dumps of the results of the analyses
+// (llvm-ps-dump -binary, llvm-rd-dump -binary).
+//
+// The file starts with the magic "DGBD", the version and the kind
+// of the dump, then follow the records of the nodes, each starting
+// with 1, and the dump ends with 0. The content of the records
+// is given by the tool that writes them.
+// All the numbers are LEB128 varints. The nodes and strings are
+// referenced by their ids, the ids are assigned in the order in which
+// the nodes and strings appear and the first reference of a node
+// or string is followed by its definition (the name of the node,
+// the bytes of the string), so the dump is written and read in one pass.
+// The offsets are stored increased by one, 0 is the unknown offset.
+enum class BinaryDumpKind : uint64_t {
+    POINTS_TO = 1,
+    REACHING_DEFINITIONS = 2,
+};
+
+static const char BINARY_DUMP_MAGIC[4] = {'D', 'G', 'B', 'D'};
+static const uint64_t BINARY_DUMP_VERSION = 1;
+
+class BinaryDumpWriter
+{
+    FILE *out;
+    std::unordered_map<const void *, uint64_t> nodes;
+    std::unordered_map<std::string, uint64_t> strings;
+
+    void writeString(const std::string& str)
+    {
+        auto it = strings.find(str);
+        if (it != strings.end()) {
+            writeNum(it->second);
+            return;
+        }
+
+        uint64_t id = strings.size();
+        strings.emplace(str, id);
+        writeNum(id);
+        writeNum(str.size());
+        fwrite(str.data(), 1, str.size(), out);
+    }
+
+public:
+    BinaryDumpWriter(FILE *out, BinaryDumpKind kind) : out(out)
+    {
+        fwrite(BINARY_DUMP_MAGIC, 1, sizeof BINARY_DUMP_MAGIC, out);
+        writeNum(BINARY_DUMP_VERSION);
+        writeNum(static_cast<uint64_t>(kind));
+    }
+
+    void writeNum(uint64_t n)
+    {
+        while (n >= 0x80) {
+            putc(static_cast<int>((n & 0x7f) | 0x80), out);
+            n >>= 7;
+        }
+
+        putc(static_cast<int>(n), out);
+    }
+
+    void writeOffset(const analysis::Offset& off)
+    {
+        writeNum(off.isUnknown() ? 0 : *off + 1);
+    }
+
+    // write the reference of the node, @getName is called
+    // to get the name of the node when it is referenced first
+    template <typename NodeT, typename NameF>
+    void writeNode(const NodeT *node, NameF getName)
+    {
+        auto it = nodes.find(node);
+        if (it != nodes.end()) {
+            writeNum(it->second);
+            return;
+        }
+
+        uint64_t id = nodes.size();
+        nodes.emplace(node, id);
+        writeNum(id);
+        writeString(getName(node));
+    }
+
+    // start the record of a node, the node is written by the caller
+    void startRecord() { writeNum(1); }
+
+    // finish the dump, returns false if writing failed
+    bool finish()
+    {
+        writeNum(0);
+        return fflush(out) == 0 && !ferror(out);
+    }
+};
+
+class BinaryDumpReader
+{
+    FILE *in;
+    std::vector<std::string> nodes;
+    std::vector<std::string> strings;
+    BinaryDumpKind kind{};
+    bool failed = false;
+
+    const std::string& readString()
+    {
+        uint64_t id = readNum();
+        if (id < strings.size())
+            return strings[id];
+
+        if (id != strings.size()) {
+            failed = true;
+            strings.emplace_back();
+            return strings.back();
+        }
+
+        std::string str(readNum(), '\0');
+        if (fread(&str[0], 1, str.size(), in) != str.size())
+            failed = true;
+        strings.push_back(std::move(str));
+        return strings.back();
+    }
+
+public:
+    BinaryDumpReader(FILE *in) : in(in)
+    {
+        char magic[sizeof BINARY_DUMP_MAGIC];
+        if (fread(magic, 1, sizeof magic, in) != sizeof magic
+            || memcmp(magic, BINARY_DUMP_MAGIC, sizeof magic) != 0
+            || readNum() != BINARY_DUMP_VERSION) {
+            failed = true;
+            return;
+        }
+
+        kind = static_cast<BinaryDumpKind>(readNum());
+    }
+
+    // is the input valid so far?
+    bool ok() const { return !failed; }
+
+    BinaryDumpKind getKind() const { return kind; }
+
+    uint64_t readNum()
+    {
+        uint64_t n = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            int c = getc(in);
+            if (c == EOF) {
+                failed = true;
+                return 0;
+            }
+
+            n |= static_cast<uint64_t>(c & 0x7f) << shift;
+            if ((c & 0x80) == 0)
+                return n;
+        }
+
+        failed = true;
+        return 0;
+    }
+
+    analysis::Offset readOffset()
+    {
+        uint64_t n = readNum();
+        return analysis::Offset(n == 0 ? UNKNOWN_OFFSET : n - 1);
+    }
+
+    // read the reference of a node, returns the id of the node
+    uint64_t readNode()
+    {
+        uint64_t id = readNum();
+        if (id == nodes.size()) {
+            nodes.push_back(readString());
+        } else if (id > nodes.size()) {
+            failed = true;
+            nodes.emplace_back();
+            return nodes.size() - 1;
+        }
+
+        return id;
+    }
+
+    const std::string& getName(uint64_t node) const { return nodes[node]; }
+
+    // is there a next record? Returns false at the end of the dump
+    // (or on error, check ok())
+    bool nextRecord()
+    {
+        return !failed && readNum() == 1 && !failed;
+    }
+};
+
+} // namespace debug
+} // namespace dg
+
+#endif // _DG_TOOLS_BINARY_DUMP_H_
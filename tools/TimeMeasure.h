@@ -3,6 +3,9 @@
 
 #include <cstdio>
 #include <ctime>
+#include <string>
+
+#include "analysis/Profiler.h"
 
 namespace dg {
 namespace debug {
@@ -27,11 +30,11 @@ public:
     const struct timespec& duration()
     {
         r.tv_sec = e.tv_sec - s.tv_sec;
-        if (e.tv_nsec > s.tv_nsec)
+        if (e.tv_nsec >= s.tv_nsec)
             r.tv_nsec = e.tv_nsec - s.tv_nsec;
         else {
             --r.tv_sec;
-            r.tv_nsec = 1000000000 - e.tv_nsec;
+            r.tv_nsec = 1000000000 + e.tv_nsec - s.tv_nsec;
         }
 
         return r;
@@ -49,6 +52,23 @@ public:
         fflush(out);
     }
 };
+
+// finish the profiler of the tool, print the tree of the phases
+// if @report is set and write the trace to @trace if it is not empty
+inline void reportProfile(analysis::Profiler *profiler, bool report,
+                          const std::string& trace)
+{
+    if (!profiler)
+        return;
+
+    profiler->finish();
+    if (report)
+        profiler->report();
+
+    if (!trace.empty() && !profiler->writeTrace(trace))
+        fprintf(stderr, "ERR: failed writing the trace to %s\n", trace.c_str());
+}
+
 } // namespace debug
 } // namespace dg
 
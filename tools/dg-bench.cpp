@@ -0,0 +1,272 @@
+#ifndef HAVE_LLVM
+#error "This code needs LLVM enabled"
+#endif
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/IRReader/IRReader.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/LLVMDependenceGraph.h"
+#include "llvm/LoadModule.h"
+#include "llvm/Slicer.h"
+#include "TimeMeasure.h"
+
+#include "llvm/analysis/DefUse.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "llvm/analysis/ReachingDefinitions/ReachingDefinitions.h"
+
+#include "analysis/PointsTo/PointsToFlowSensitive.h"
+#include "analysis/PointsTo/PointsToFlowInsensitive.h"
+
+///
+// Run the whole pipeline of llvm-slicer (points-to analysis, reaching
+// definitions, def-use, control dependence and slicing) on one module
+// and print the time, peak RSS and the number of iterations of every
+// phase as a JSON object to the standard output. The script dg-bench.sh
+// runs this on a corpus of programs.
+
+using namespace dg;
+using llvm::errs;
+
+struct Phase {
+    const char *name;
+    uint64_t time_ns;
+    // the peak resident set size of the process at the end of the phase
+    long peak_rss_kb;
+    // the number of processed nodes, -1 if the phase does not iterate
+    int64_t iterations;
+    int64_t rounds;
+
+    Phase(const char *n, uint64_t t, long rss,
+          int64_t it = -1, int64_t rnds = -1)
+    : name(n), time_ns(t), peak_rss_kb(rss), iterations(it), rounds(rnds) {}
+};
+
+static long getPeakRSS()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    // in kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+static uint64_t getNanoseconds(debug::TimeMeasure& tm)
+{
+    const struct timespec& d = tm.duration();
+    return d.tv_sec * 1000000000UL + d.tv_nsec;
+}
+
+static void printJSONString(const char *str)
+{
+    putchar('"');
+    for (const char *c = str; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+            printf("\\%c", *c);
+        else if ((unsigned char) *c < 0x20)
+            printf("\\u%04x", *c);
+        else
+            putchar(*c);
+    }
+    putchar('"');
+}
+
+int main(int argc, char *argv[])
+{
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic SMD;
+    const char *module = nullptr;
+    const char *slicing_criterion = "test_assert";
+    const char *pts = "fi";
+    bool rd_sparse = false;
+    bool rd_memory_ssa = false;
+    unsigned rd_threads = 1;
+    unsigned du_threads = 1;
+    CD_ALG cd_alg = CLASSIC;
+
+    // parse options
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-pta") == 0) {
+            pts = argv[++i];
+        } else if (strcmp(argv[i], "-slice") == 0) {
+            slicing_criterion = argv[++i];
+        } else if (strcmp(argv[i], "-rd-sparse") == 0) {
+            rd_sparse = true;
+        } else if (strcmp(argv[i], "-rd-memory-ssa") == 0) {
+            rd_memory_ssa = true;
+        } else if (strcmp(argv[i], "-rd-threads") == 0) {
+            rd_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-du-threads") == 0) {
+            du_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-cd-alg") == 0) {
+            const char *arg = argv[++i];
+            if (strcmp(arg, "classic") == 0)
+                cd_alg = CLASSIC;
+            else if (strcmp(arg, "ce") == 0)
+                cd_alg = CONTROL_EXPRESSION;
+            else {
+                errs() << "Invalid control dependencies algorithm, try: classic, ce\n";
+                return 1;
+            }
+        } else {
+            module = argv[i];
+        }
+    }
+
+    if (!module) {
+        errs() << "Usage: % [-pta fi|fs] [-rd-sparse] [-rd-memory-ssa] "
+                  "[-rd-threads N] [-du-threads N] [-cd-alg classic|ce] "
+                  "[-slice crit] IR_module\n";
+        return 1;
+    }
+
+    if (strcmp(pts, "fs") != 0 && strcmp(pts, "fi") != 0) {
+        errs() << "Unknown points to analysis, try: fs, fi\n";
+        return 1;
+    }
+
+    std::vector<Phase> phases;
+    debug::TimeMeasure tm;
+
+    tm.start();
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
+    llvm::Module *M = llvm::ParseIRFile(module, SMD, context);
+#else
+    auto _M = dg::loadModule(module, SMD, context);
+    // _M is unique pointer, we need to get Module *
+    llvm::Module *M = _M.get();
+#endif
+    tm.stop();
+
+    if (!M) {
+        errs() << "Failed parsing '" << module << "' file:\n";
+        SMD.print(argv[0], errs());
+        return 1;
+    }
+
+    phases.emplace_back("load", getNanoseconds(tm), getPeakRSS());
+
+    LLVMPointerAnalysis *PTA = new LLVMPointerAnalysis(M);
+    PTA->collectStatistics();
+
+    tm.start();
+    if (strcmp(pts, "fs") == 0)
+        PTA->run<analysis::pta::PointsToFlowSensitive>();
+    else
+        PTA->run<analysis::pta::PointsToFlowInsensitive>();
+    tm.stop();
+
+    const analysis::pta::PointerAnalysisStatistics& ptast = PTA->getStatistics();
+    phases.emplace_back("pta", getNanoseconds(tm), getPeakRSS(),
+                        ptast.getProcessedNodes(), ptast.getRoundsNum());
+
+    LLVMDependenceGraph d;
+    tm.start();
+    d.build(M, PTA);
+    tm.stop();
+    phases.emplace_back("dg-build", getNanoseconds(tm), getPeakRSS());
+
+    analysis::rd::LLVMReachingDefinitions RD(M, PTA);
+    RD.setSparse(rd_sparse);
+    RD.setMemorySSA(rd_memory_ssa);
+    RD.setThreads(rd_threads);
+    tm.start();
+    RD.run();
+    tm.stop();
+    phases.emplace_back("rd", getNanoseconds(tm), getPeakRSS(),
+                        RD.getProcessedNodes());
+
+    LLVMDefUseAnalysis DUA(&d, &RD, PTA);
+    DUA.setThreads(du_threads);
+    tm.start();
+    DUA.run();
+    tm.stop();
+    phases.emplace_back("def-use", getNanoseconds(tm), getPeakRSS());
+
+    delete PTA;
+
+    tm.start();
+    d.computeControlDependencies(cd_alg);
+    tm.stop();
+    phases.emplace_back("cd", getNanoseconds(tm), getPeakRSS());
+
+    LLVMSlicer slicer;
+    tm.start();
+    if (strcmp(slicing_criterion, "ret") == 0) {
+        slicer.slice(&d, d.getExit());
+    } else {
+        const char *sc[] = { slicing_criterion, nullptr };
+        std::set<LLVMNode *> callsites;
+        d.getCallSites(sc, &callsites);
+
+        uint32_t slid = 0;
+        for (LLVMNode *start : callsites)
+            slid = slicer.mark(start, slid);
+
+        // nothing to slice with no criterion found,
+        // but report the phase anyway
+        if (slid != 0)
+            slicer.slice(&d, nullptr, slid);
+    }
+    tm.stop();
+    phases.emplace_back("slice", getNanoseconds(tm), getPeakRSS());
+
+    const analysis::SlicerStatistics& slst = slicer.getStatistics();
+    uint64_t total_ns = 0;
+    for (const Phase& p : phases)
+        total_ns += p.time_ns;
+
+    printf("{\"module\": ");
+    printJSONString(module);
+    printf(", \"pta\": \"%s\", \"rd\": \"%s\", \"rd_threads\": %u,"
+           " \"du_threads\": %u,\n",
+           pts, rd_memory_ssa ? "memory-ssa" : (rd_sparse ? "sparse" : "dense"),
+           rd_threads, du_threads);
+    printf(" \"phases\": [\n");
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const Phase& p = phases[i];
+        printf("  {\"name\": \"%s\", \"time_ms\": %.3f, \"peak_rss_kb\": %ld",
+               p.name, p.time_ns / 1000000.0, p.peak_rss_kb);
+        if (p.iterations >= 0)
+            printf(", \"iterations\": %ld", (long) p.iterations);
+        if (p.rounds >= 0)
+            printf(", \"rounds\": %ld", (long) p.rounds);
+        printf("}%s\n", i + 1 < phases.size() ? "," : "");
+    }
+    printf(" ],\n");
+    printf(" \"total_time_ms\": %.3f, \"peak_rss_kb\": %ld,\n",
+           total_ns / 1000000.0, getPeakRSS());
+    printf(" \"slice\": {\"criterion\": ");
+    printJSONString(slicing_criterion);
+    printf(", \"nodes_total\": %lu, \"nodes_removed\": %lu}}\n",
+           (unsigned long) slst.nodesTotal, (unsigned long) slst.nodesRemoved);
+
+    return 0;
+}
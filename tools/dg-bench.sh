@@ -0,0 +1,114 @@
+#!/bin/bash
+#
+# Run dg-bench on the programs from tests/sources and on generated
+# programs of growing size and print the results as a JSON array.
+# The sizes are the numbers of the functions of the generated programs.
+# With -generate, the programs are generated by dg-generate with
+# the given options (the shape of the programs) instead of the C
+# programs generated by this script.
+#
+# usage: dg-bench.sh [-sizes "10 100 1000"] [-generate "dg-generate options"]
+#                    [dg-bench options]
+#
+# e.g. dg-bench.sh -pta fs -rd-sparse > results.json
+#      dg-bench.sh -generate "-depth 8 -fptr-fanout 4 -loops 2" > results.json
+#
+# clang and dg-bench (and dg-generate with -generate) must be in PATH
+
+TOOLSDIR=`dirname $0`
+SOURCES="`readlink -f $TOOLSDIR/../tests/sources`"
+ASSERT_H="`readlink -f $TOOLSDIR/../tests/test_assert.h`"
+
+SIZES="10 100 1000"
+if [ "$1" = "-sizes" ]; then
+	SIZES="$2"
+	shift 2
+fi
+
+GENERATE=0
+if [ "$1" = "-generate" ]; then
+	GENERATE=1
+	GENERATE_OPTS="$2"
+	shift 2
+fi
+
+errmsg()
+{
+	echo "$1" 1>&2
+	exit 1
+}
+
+# generate a program with @1 functions that store to global
+# arrays and to memory passed by pointers, in loops and branches
+generate()
+{
+	N=$1
+	echo "int g[16];"
+	echo "int *p[16];"
+	echo
+
+	for i in `seq 0 $(($N - 1))`; do
+		echo "void f$i(int *a, int n)"
+		echo "{"
+		echo "	for (int k = 0; k < n; ++k) {"
+		echo "		a[k % 16] = k + g[(k + $i) % 16];"
+		echo "		if (a[k % 16] > $i)"
+		echo "			p[$(($i % 16))] = &g[(k + $i) % 16];"
+		echo "		else"
+		echo "			p[$(($i % 16))] = &a[k % 16];"
+		echo "	}"
+		echo "	if (p[$((($i + 1) % 16))])"
+		echo "		*p[$((($i + 1) % 16))] = a[0];"
+		if [ $i -gt 0 ]; then
+			echo "	if (n > 1)"
+			echo "		f$(($i - 1))(a, n - 1);"
+		fi
+		echo "}"
+		echo
+	done
+
+	echo "int main(void)"
+	echo "{"
+	echo "	int loc[16] = {0};"
+	for i in `seq 0 $(($N - 1))`; do
+		echo "	f$i(loc, 8);"
+	done
+	echo "	test_assert(loc[0] == loc[1] || g[0] >= 0);"
+	echo "	return 0;"
+	echo "}"
+}
+
+TMPDIR=`mktemp -d` || errmsg "Failed creating temporary directory"
+trap "rm -rf $TMPDIR" EXIT
+
+for S in $SIZES; do
+	if [ $GENERATE -eq 1 ]; then
+		dg-generate -functions $S $GENERATE_OPTS -o "$TMPDIR/generated-$S.bc" \
+			|| errmsg "dg-generate failed"
+	else
+		generate $S > "$TMPDIR/generated-$S.c"
+	fi
+done
+
+FIRST=1
+echo "["
+for C in "$SOURCES"/*.c "$TMPDIR"/generated-*.c "$TMPDIR"/generated-*.bc; do
+	# no programs generated by dg-generate (or by this script)
+	[ -f "$C" ] || continue
+
+	BC="$TMPDIR/`basename ${C%.*}`.bc"
+	if [ "$C" != "$BC" ]; then
+		clang -emit-llvm -c -include "$ASSERT_H" "$C" -o "$BC" 2>/dev/null \
+			|| errmsg "Compilation of $C failed"
+	fi
+
+	OUT=`dg-bench "$@" "$BC"` || errmsg "dg-bench failed on $C"
+
+	if [ $FIRST -eq 0 ]; then
+		echo ","
+	fi
+	FIRST=0
+
+	echo "$OUT"
+done
+echo "]"
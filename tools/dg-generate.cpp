@@ -0,0 +1,426 @@
+#ifndef HAVE_LLVM
+#error "This code needs LLVM enabled"
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if LLVM_VERSION_MAJOR >= 4
+#include <llvm/Bitcode/BitcodeWriter.h>
+#else
+#include <llvm/Bitcode/ReaderWriter.h>
+#endif
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+///
+// Generate an LLVM module of the given size and shape for measuring
+// how the analyses scale. The functions are split into layers (the depth
+// of the call graph), every function calls one function of the next layer
+// directly and some functions of the next layer via a function pointer.
+// Every function allocates structures on the heap, builds a chain
+// of pointers to its argument and in nested loops stores through
+// the chain and via the pointers stored in the structures.
+// main calls the functions of the first layer and calls test_assert
+// (the default slicing criterion of dg-bench) on the result.
+//
+// The output is a bitcode if the name of the output file ends with .bc,
+// the textual IR otherwise (the standard output by default).
+
+using llvm::errs;
+
+struct Options {
+    unsigned functions = 10;
+    // the number of the layers of the call graph
+    unsigned depth = 3;
+    // the number of functions called via a function pointer
+    unsigned fptr_fanout = 2;
+    // the number of the pointers in the chain (the last points to int)
+    unsigned chain = 2;
+    unsigned loops = 1;
+    // the number of malloc calls in every function
+    unsigned allocs = 1;
+    // the number of the fields of the allocated structure
+    unsigned struct_size = 4;
+    unsigned seed = 0;
+    const char *output = nullptr;
+};
+
+class ProgramGenerator
+{
+    const Options& opts;
+    llvm::LLVMContext& ctx;
+    std::unique_ptr<llvm::Module> M;
+    std::mt19937 rng;
+
+    llvm::IntegerType *IntTy;
+    llvm::IntegerType *I64Ty;
+    llvm::PointerType *IntPtrTy;
+    llvm::StructType *STy;
+    llvm::FunctionType *FTy;
+    llvm::GlobalVariable *G;
+    llvm::GlobalVariable *GP;
+    llvm::Function *Malloc;
+    llvm::Function *Assert;
+    uint64_t struct_alloc_size;
+
+    std::vector<std::vector<llvm::Function *>> layers;
+
+    using Builder = llvm::IRBuilder<>;
+
+    static llvm::Value *load(Builder& B, llvm::Type *Ty, llvm::Value *ptr)
+    {
+#if LLVM_VERSION_MAJOR >= 8
+        return B.CreateLoad(Ty, ptr);
+#else
+        (void) Ty;
+        return B.CreateLoad(ptr);
+#endif
+    }
+
+    static void call(Builder& B, llvm::FunctionType *Ty, llvm::Value *callee,
+                     llvm::ArrayRef<llvm::Value *> args)
+    {
+#if LLVM_VERSION_MAJOR >= 8
+        B.CreateCall(Ty, callee, args);
+#else
+        (void) Ty;
+        B.CreateCall(callee, args);
+#endif
+    }
+
+    // the type of the pointer at the @level of the chain
+    // (level 0 is int *, level 1 is int ** and so on)
+    llvm::Type *chainType(unsigned level)
+    {
+        llvm::Type *Ty = IntPtrTy;
+        for (unsigned i = 0; i < level; ++i)
+            Ty = llvm::PointerType::getUnqual(Ty);
+        return Ty;
+    }
+
+    llvm::Function *pick(const std::vector<llvm::Function *>& funcs)
+    {
+        return funcs[rng() % funcs.size()];
+    }
+
+    // the loops nested from @level, the innermost runs @body
+    template <typename BodyF>
+    void generateLoops(Builder& B, llvm::Function *F,
+                       const std::vector<llvm::Value *>& counters,
+                       llvm::Value *n, unsigned level, BodyF body)
+    {
+        if (level == counters.size()) {
+            body();
+            return;
+        }
+
+        llvm::Value *cnt = counters[level];
+        llvm::BasicBlock *cond = llvm::BasicBlock::Create(ctx, "loop.cond", F);
+        llvm::BasicBlock *loop = llvm::BasicBlock::Create(ctx, "loop.body", F);
+        llvm::BasicBlock *exit = llvm::BasicBlock::Create(ctx, "loop.exit", F);
+
+        B.CreateStore(llvm::ConstantInt::get(IntTy, 0), cnt);
+        B.CreateBr(cond);
+
+        B.SetInsertPoint(cond);
+        llvm::Value *i = load(B, IntTy, cnt);
+        B.CreateCondBr(B.CreateICmpSLT(i, n), loop, exit);
+
+        B.SetInsertPoint(loop);
+        generateLoops(B, F, counters, n, level + 1, body);
+        i = load(B, IntTy, cnt);
+        B.CreateStore(B.CreateAdd(i, llvm::ConstantInt::get(IntTy, 1)), cnt);
+        B.CreateBr(cond);
+
+        B.SetInsertPoint(exit);
+    }
+
+    void generateFunction(llvm::Function *F, unsigned layer, unsigned idx)
+    {
+        auto args = F->arg_begin();
+        llvm::Value *a = &*args++;
+        llvm::Value *n = &*args;
+
+        Builder B(llvm::BasicBlock::Create(ctx, "entry", F));
+
+        // the allocas first, as clang does
+        std::vector<llvm::Value *> chain;
+        for (unsigned l = 0; l < opts.chain; ++l)
+            chain.push_back(B.CreateAlloca(chainType(l)));
+        std::vector<llvm::Value *> counters;
+        for (unsigned l = 0; l < opts.loops; ++l)
+            counters.push_back(B.CreateAlloca(IntTy));
+
+        // the table of the functions called via a pointer
+        bool calls = layer + 1 < layers.size();
+        llvm::Type *FPtrTy = llvm::PointerType::getUnqual(FTy);
+        llvm::ArrayType *TableTy = llvm::ArrayType::get(FPtrTy, opts.fptr_fanout);
+        llvm::Value *table = nullptr;
+        if (calls && opts.fptr_fanout > 0)
+            table = B.CreateAlloca(TableTy);
+
+        std::vector<llvm::Value *> objects;
+        for (unsigned k = 0; k < opts.allocs; ++k) {
+            llvm::Value *size = llvm::ConstantInt::get(I64Ty, struct_alloc_size);
+            llvm::Value *mem = B.CreateCall(Malloc, size);
+            llvm::Value *obj
+                = B.CreateBitCast(mem, llvm::PointerType::getUnqual(STy));
+            B.CreateStore(a, B.CreateStructGEP(STy, obj, 0));
+            objects.push_back(obj);
+        }
+
+        // build the chain: chain[0] = a, chain[l] = &chain[l - 1]
+        if (!chain.empty())
+            B.CreateStore(a, chain[0]);
+        for (unsigned l = 1; l < chain.size(); ++l)
+            B.CreateStore(chain[l - 1], chain[l]);
+
+        generateLoops(B, F, counters, n, 0, [&]() {
+            // walk the chain down to int *
+            llvm::Value *ptr = a;
+            if (!chain.empty()) {
+                ptr = chain.back();
+                for (unsigned l = chain.size(); l > 0; --l)
+                    ptr = load(B, chainType(l - 1), ptr);
+            }
+            B.CreateStore(n, ptr);
+
+            unsigned k = idx;
+            for (llvm::Value *obj : objects) {
+                // the pointer fields are the even ones
+                unsigned field = (k % ((opts.struct_size + 1) / 2)) * 2;
+                llvm::Value *fld = B.CreateStructGEP(STy, obj, field);
+                B.CreateStore(ptr, fld);
+
+                llvm::Value *gidx[] = { llvm::ConstantInt::get(I64Ty, 0),
+                                        llvm::ConstantInt::get(I64Ty, k % 16) };
+                llvm::Value *gptr = B.CreateGEP(G->getValueType(), G, gidx);
+                llvm::Value *val = load(B, IntTy, gptr);
+                B.CreateStore(val, load(B, IntPtrTy, fld));
+                ++k;
+            }
+
+            B.CreateStore(ptr, GP);
+        });
+
+        if (calls) {
+            const auto& next = layers[layer + 1];
+            llvm::Value *n1 = B.CreateSub(n, llvm::ConstantInt::get(IntTy, 1));
+            call(B, FTy, pick(next), {a, n1});
+
+            if (table) {
+                for (unsigned k = 0; k < opts.fptr_fanout; ++k)
+                    B.CreateStore(pick(next), B.CreateConstGEP2_64(TableTy, table, 0, k));
+
+                llvm::Value *i = B.CreateURem(n, llvm::ConstantInt::get(IntTy, opts.fptr_fanout));
+                llvm::Value *tidx[] = { llvm::ConstantInt::get(IntTy, 0), i };
+                llvm::Value *fp = load(B, FPtrTy, B.CreateGEP(TableTy, table, tidx));
+                call(B, FTy, fp, {a, n1});
+            }
+        }
+
+        B.CreateRetVoid();
+    }
+
+    void generateMain()
+    {
+        llvm::Function *F
+            = llvm::Function::Create(llvm::FunctionType::get(IntTy, false),
+                                     llvm::GlobalValue::ExternalLinkage,
+                                     "main", M.get());
+        Builder B(llvm::BasicBlock::Create(ctx, "entry", F));
+
+        llvm::ArrayType *LocTy = llvm::ArrayType::get(IntTy, 16);
+        llvm::Value *loc = B.CreateAlloca(LocTy);
+        llvm::Value *p = B.CreateConstGEP2_64(LocTy, loc, 0, 0);
+        for (llvm::Function *f : layers[0])
+            call(B, FTy, f, {p, llvm::ConstantInt::get(IntTy, 8)});
+
+        B.CreateCall(Assert, load(B, IntTy, p));
+        B.CreateRet(llvm::ConstantInt::get(IntTy, 0));
+    }
+
+public:
+    ProgramGenerator(const Options& o, llvm::LLVMContext& c)
+        : opts(o), ctx(c), M(new llvm::Module("generated", c)), rng(o.seed) {}
+
+    std::unique_ptr<llvm::Module> generate()
+    {
+        M->setTargetTriple("x86_64-unknown-linux-gnu");
+        M->setDataLayout("e-m:e-i64:64-f80:128-n8:16:32:64-S128");
+
+        IntTy = llvm::Type::getInt32Ty(ctx);
+        I64Ty = llvm::Type::getInt64Ty(ctx);
+        IntPtrTy = llvm::PointerType::getUnqual(IntTy);
+
+        std::vector<llvm::Type *> fields;
+        for (unsigned k = 0; k < opts.struct_size; ++k)
+            fields.push_back(k % 2 == 0 ? static_cast<llvm::Type *>(IntPtrTy)
+                                        : IntTy);
+        STy = llvm::StructType::create(ctx, fields, "struct.S");
+        struct_alloc_size = llvm::DataLayout(M.get()).getTypeAllocSize(STy);
+
+        FTy = llvm::FunctionType::get(llvm::Type::getVoidTy(ctx),
+                                      {IntPtrTy, IntTy}, false);
+
+        llvm::ArrayType *GTy = llvm::ArrayType::get(IntTy, 16);
+        G = new llvm::GlobalVariable(*M, GTy, false,
+                                     llvm::GlobalValue::ExternalLinkage,
+                                     llvm::ConstantAggregateZero::get(GTy), "g");
+        GP = new llvm::GlobalVariable(*M, IntPtrTy, false,
+                                      llvm::GlobalValue::ExternalLinkage,
+                                      llvm::ConstantPointerNull::get(IntPtrTy),
+                                      "gp");
+
+        llvm::Type *I8PtrTy = llvm::Type::getInt8PtrTy(ctx);
+        Malloc = llvm::Function::Create(llvm::FunctionType::get(I8PtrTy, {I64Ty}, false),
+                                        llvm::GlobalValue::ExternalLinkage,
+                                        "malloc", M.get());
+        Assert = llvm::Function::Create(llvm::FunctionType::get(llvm::Type::getVoidTy(ctx),
+                                                                {IntTy}, false),
+                                        llvm::GlobalValue::ExternalLinkage,
+                                        "test_assert", M.get());
+
+        // split the functions into the layers, every layer has a function
+        unsigned depth = std::max(1u, std::min(opts.depth, opts.functions));
+        layers.resize(depth);
+        for (unsigned i = 0; i < opts.functions; ++i) {
+            llvm::Function *F
+                = llvm::Function::Create(FTy, llvm::GlobalValue::ExternalLinkage,
+                                         "f" + std::to_string(i), M.get());
+            layers[static_cast<uint64_t>(i) * depth / opts.functions].push_back(F);
+        }
+
+        unsigned idx = 0;
+        for (unsigned l = 0; l < layers.size(); ++l) {
+            for (llvm::Function *F : layers[l])
+                generateFunction(F, l, idx++);
+        }
+
+        generateMain();
+
+        return std::move(M);
+    }
+};
+
+static bool parseNum(const char *arg, unsigned& num)
+{
+    char *end;
+    unsigned long n = strtoul(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0')
+        return false;
+
+    num = static_cast<unsigned>(n);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Options opts;
+    const char *usage =
+        "Usage: % [-functions N] [-depth N] [-fptr-fanout N] [-chain N]\n"
+        "         [-loops N] [-allocs N] [-struct-size N] [-seed N] [-o FILE]\n";
+
+    for (int i = 1; i < argc; ++i) {
+        unsigned *num = nullptr;
+        if (strcmp(argv[i], "-functions") == 0)
+            num = &opts.functions;
+        else if (strcmp(argv[i], "-depth") == 0)
+            num = &opts.depth;
+        else if (strcmp(argv[i], "-fptr-fanout") == 0)
+            num = &opts.fptr_fanout;
+        else if (strcmp(argv[i], "-chain") == 0)
+            num = &opts.chain;
+        else if (strcmp(argv[i], "-loops") == 0)
+            num = &opts.loops;
+        else if (strcmp(argv[i], "-allocs") == 0)
+            num = &opts.allocs;
+        else if (strcmp(argv[i], "-struct-size") == 0)
+            num = &opts.struct_size;
+        else if (strcmp(argv[i], "-seed") == 0)
+            num = &opts.seed;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            opts.output = argv[++i];
+            continue;
+        }
+
+        if (!num || i + 1 >= argc || !parseNum(argv[++i], *num)) {
+            errs() << usage;
+            return 1;
+        }
+    }
+
+    if (opts.functions == 0 || opts.struct_size == 0) {
+        errs() << "The number of functions and the size of the structure "
+                  "must be positive\n";
+        return 1;
+    }
+
+    llvm::LLVMContext context;
+    ProgramGenerator gen(opts, context);
+    std::unique_ptr<llvm::Module> M = gen.generate();
+
+    if (llvm::verifyModule(*M, &errs())) {
+        errs() << "ERROR: The generated module is broken\n";
+        return 1;
+    }
+
+    if (!opts.output) {
+        llvm::outs() << *M;
+        return 0;
+    }
+
+    std::error_code ec;
+#if LLVM_VERSION_MAJOR >= 9
+    llvm::raw_fd_ostream out(opts.output, ec, llvm::sys::fs::OF_None);
+#else
+    llvm::raw_fd_ostream out(opts.output, ec, llvm::sys::fs::F_None);
+#endif
+    if (ec) {
+        errs() << "Cannot open " << opts.output << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    size_t len = strlen(opts.output);
+    if (len > 3 && strcmp(opts.output + len - 3, ".bc") == 0) {
+#if LLVM_VERSION_MAJOR >= 7
+        llvm::WriteBitcodeToFile(*M, out);
+#else
+        llvm::WriteBitcodeToFile(M.get(), out);
+#endif
+    } else
+        out << *M;
+
+    return 0;
+}
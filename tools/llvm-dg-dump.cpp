@@ -3,6 +3,7 @@
 #endif
 
 #include <set>
+#include <memory>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -10,6 +11,7 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -41,6 +43,7 @@
 #endif
 
 #include "llvm/LLVMDependenceGraph.h"
+#include "llvm/LoadModule.h"
 #include "llvm/Slicer.h"
 #include "llvm/LLVMDG2Dot.h"
 #include "TimeMeasure.h"
@@ -65,8 +68,13 @@ int main(int argc, char *argv[])
     const char *module = nullptr;
     const char *slicing_criterion = nullptr;
     const char *dump_func_only = nullptr;
+    const char *around = nullptr;
+    unsigned hops = 2;
+    size_t max_nodes = 0;
     const char *pts = "fi";
     CD_ALG cd_alg = CLASSIC;
+    bool time_report = false;
+    std::string time_trace;
 
     using namespace debug;
     uint32_t opts = PRINT_CFG | PRINT_DD | PRINT_CD;
@@ -92,11 +100,21 @@ int main(int argc, char *argv[])
             opts |= PRINT_REV_CFG;
         } else if (strcmp(argv[i], "-func") == 0) {
             dump_func_only = argv[++i];
+        } else if (strcmp(argv[i], "-around") == 0) {
+            around = argv[++i];
+        } else if (strcmp(argv[i], "-hops") == 0) {
+            hops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-max-nodes") == 0) {
+            max_nodes = strtoull(argv[++i], nullptr, 10);
         } else if (strcmp(argv[i], "-slice") == 0) {
             slicing_criterion = argv[++i];
         } else if (strcmp(argv[i], "-mark") == 0) {
             mark_only = true;
             slicing_criterion = argv[++i];
+        } else if (strcmp(argv[i], "-time-report") == 0) {
+            time_report = true;
+        } else if (strcmp(argv[i], "-time-trace") == 0) {
+            time_trace = argv[++i];
         } else if (strcmp(argv[i], "-cd-alg") == 0) {
             const char *arg = argv[++i];
             if (strcmp(arg, "classic") == 0)
@@ -121,7 +139,7 @@ int main(int argc, char *argv[])
 #if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
     M = llvm::ParseIRFile(module, SMD, context);
 #else
-    auto _M = llvm::parseIRFile(module, SMD, context);
+    auto _M = dg::loadModule(module, SMD, context);
     // _M is unique pointer, we need to get Module *
     M = _M.get();
 #endif
@@ -132,28 +150,40 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    debug::TimeMeasure tm;
+    using analysis::Profiler;
+    std::unique_ptr<Profiler> profiler;
+    if (time_report || !time_trace.empty())
+        profiler.reset(new Profiler());
 
     // TODO refactor the code...
     LLVMDependenceGraph d;
     LLVMPointerAnalysis *PTA = new LLVMPointerAnalysis(M);
 
-    if (strcmp(pts, "fs") == 0) {
-        tm.start();
-        PTA->run<analysis::pta::PointsToFlowSensitive>();
-        tm.stop();
-    } else if (strcmp(pts, "fi") == 0) {
-        tm.start();
-        PTA->run<analysis::pta::PointsToFlowInsensitive>();
-        tm.stop();
-    } else {
-        llvm::errs() << "Unknown points to analysis, try: fs, fi\n";
-        abort();
+    {
+        Profiler::Scope phase("Points-to analysis");
+        if (strcmp(pts, "fs") == 0) {
+            PTA->run<analysis::pta::PointsToFlowSensitive>();
+        } else if (strcmp(pts, "fi") == 0) {
+            PTA->run<analysis::pta::PointsToFlowInsensitive>();
+        } else {
+            llvm::errs() << "Unknown points to analysis, try: fs, fi\n";
+            abort();
+        }
     }
 
-    tm.report("INFO: Points-to analysis took");
+    // the dependencies that are not dumped are not needed,
+    // unless we slice
+    LLVMDGBuildOptions buildOptions;
+    if (!slicing_criterion) {
+        buildOptions.controlDependencies = opts & PRINT_CD;
+        buildOptions.dataDependencies = opts & PRINT_DD;
+    }
+    d.setBuildOptions(buildOptions);
 
-    d.build(M, PTA);
+    {
+        Profiler::Scope phase("Building the dependence graph");
+        d.build(M, PTA);
+    }
 
     std::set<LLVMNode *> callsites;
     if (slicing_criterion) {
@@ -163,38 +193,38 @@ int main(int argc, char *argv[])
             NULL
         };
 
-        tm.start();
+        Profiler::Scope phase("Finding slicing criterions");
         d.getCallSites(sc, &callsites);
-        tm.stop();
-        tm.report("INFO: Finding slicing criterions took");
     }
 
     assert(PTA && "BUG: Need points-to analysis");
     //use new analyses
-    analysis::rd::LLVMReachingDefinitions RDA(M, PTA);
-    tm.start();
-    RDA.run();  // compute reaching definitions
-    tm.stop();
-    tm.report("INFO: Reaching defs analysis took");
-
-    LLVMDefUseAnalysis DUA(&d, &RDA, PTA);
-    tm.start();
-    DUA.run(); // add def-use edges according that
-    tm.stop();
-    tm.report("INFO: Adding Def-Use edges took");
+    if (buildOptions.dataDependencies) {
+        analysis::rd::LLVMReachingDefinitions RDA(M, PTA);
+        {
+            Profiler::Scope phase("Reaching definitions analysis");
+            RDA.run();  // compute reaching definitions
+        }
+
+        LLVMDefUseAnalysis DUA(&d, &RDA, PTA);
+        {
+            Profiler::Scope phase("Adding def-use edges");
+            DUA.run(); // add def-use edges according that
+        }
+    }
 
     // we won't need PTA anymore
     delete PTA;
 
-    tm.start();
-    // add post-dominator frontiers
-    d.computeControlDependencies(cd_alg);
-    tm.stop();
-    tm.report("INFO: computing control dependencies took");
+    {
+        Profiler::Scope phase("Computing control dependencies");
+        // add post-dominator frontiers
+        d.computeControlDependencies(cd_alg);
+    }
 
     if (slicing_criterion) {
         LLVMSlicer slicer;
-        tm.start();
+        Profiler::Scope phase("Slicing");
 
         if (strcmp(slicing_criterion, "ret") == 0) {
             if (mark_only)
@@ -216,9 +246,7 @@ int main(int argc, char *argv[])
                slicer.slice(&d, nullptr, slid);
         }
 
-        // there's overhead but nevermind
-        tm.stop();
-        tm.report("INFO: Slicing took");
+        Profiler::count("nodes removed", slicer.getStatistics().nodesRemoved);
 
         if (!mark_only) {
             std::string fl(module);
@@ -234,13 +262,38 @@ int main(int argc, char *argv[])
         }
     }
 
+    // dump only the neighborhood of the calls of the function
+    // (or of the exit node)
+    std::set<LLVMNode *> centers;
+    if (around) {
+        if (strcmp(around, "ret") == 0) {
+            centers.insert(d.getExit());
+        } else {
+            const char *names[] = { around, NULL };
+            d.getCallSites(names, &centers);
+        }
+
+        if (centers.empty()) {
+            errs() << "ERR: no calls of '" << around << "' found\n";
+            return 1;
+        }
+    }
+
     if (bb_only) {
         LLVMDGDumpBlocks dumper(&d, opts);
+        if (around)
+            dumper.setNeighborhood(centers, hops);
+        dumper.setNodesBudget(max_nodes);
         dumper.dump(nullptr, dump_func_only);
     } else {
         LLVMDG2Dot dumper(&d, opts);
+        if (around)
+            dumper.setNeighborhood(centers, hops);
+        dumper.setNodesBudget(max_nodes);
         dumper.dump(nullptr, dump_func_only);
     }
 
+    debug::reportProfile(profiler.get(), time_report, time_trace);
+
     return 0;
 }
@@ -0,0 +1,423 @@
+#ifndef HAVE_LLVM
+#error "This code needs LLVM enabled"
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/Analysis/MemoryLocation.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/ValueMap.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/PassPlugin.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/LLVMDependenceGraph.h"
+#include "llvm/Slicer.h"
+#include "llvm/analysis/DefUse.h"
+#include "llvm/analysis/ModRef.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "llvm/analysis/ReachingDefinitions/ReachingDefinitions.h"
+
+#include "analysis/PointsTo/PointsToFlowInsensitive.h"
+
+///
+// The analyses of dg as a plugin for the new pass manager, so that
+// the module can be sliced inside of a pipeline of opt (or a compiler)
+// without writing the bitcode out for llvm-slicer and reading it back:
+//
+//   opt -load-pass-plugin=libLLVMdgPasses.so \
+//       -passes='dg-slice<__assert_fail;foo>,globaldce' in.bc -o out.bc
+//
+// The plugin registers
+//   dg-pta               - the flow-insensitive points-to analysis of the
+//                          module (a module analysis, the other passes of
+//                          the pipeline can share its results)
+//   dg-aa                - the alias analysis answered from the points-to
+//                          sets. Add it to the alias analyses by
+//                          -aa-pipeline=dg-aa,basic-aa and compute it
+//                          by the pass 'dg-aa' before the function passes
+//                          that use it, e.g.
+//                            -passes='dg-slice<foo>,dg-aa,function(gvn,dse)'
+//   dg-slice<criteria>   - slice the module with respect to the calls of
+//                          the functions given in the brackets (separated
+//                          by ';'). Without the brackets, the criteria are
+//                          taken from -dg-slice-criteria (the plugin must
+//                          be given also to -load then, so that opt knows
+//                          the option)
+//
+// The slice is computed the same way as by llvm-slicer with the default
+// options. The pass only removes the sliced-away instructions, the
+// functions that became unused are removed by the following passes
+// of the pipeline (e.g. globaldce).
+
+using namespace dg;
+using llvm::errs;
+
+static llvm::cl::opt<std::string> slice_criteria("dg-slice-criteria",
+    llvm::cl::desc("Slice with respect to the calls of these functions "
+                   "(separated by comma) in the 'dg-slice' pass"),
+    llvm::cl::value_desc("func1,func2"), llvm::cl::init(""));
+
+static std::vector<std::string> splitCriteria(llvm::StringRef str, char sep)
+{
+    llvm::SmallVector<llvm::StringRef, 8> parts;
+    str.split(parts, sep, -1, false);
+
+    std::vector<std::string> ret;
+    for (llvm::StringRef part : parts)
+        ret.push_back(part.trim().str());
+
+    return ret;
+}
+
+namespace {
+
+class PointsToAnalysisPass
+    : public llvm::AnalysisInfoMixin<PointsToAnalysisPass>
+{
+    friend llvm::AnalysisInfoMixin<PointsToAnalysisPass>;
+    static llvm::AnalysisKey Key;
+
+public:
+    struct Result {
+        std::unique_ptr<LLVMPointerAnalysis> PTA;
+
+        bool invalidate(llvm::Module&, const llvm::PreservedAnalyses& PA,
+                        llvm::ModuleAnalysisManager::Invalidator&)
+        {
+            auto checker = PA.getChecker<PointsToAnalysisPass>();
+            return !checker.preserved() &&
+                   !checker.preservedSet<llvm::AllAnalysesOn<llvm::Module>>();
+        }
+    };
+
+    Result run(llvm::Module& M, llvm::ModuleAnalysisManager&)
+    {
+        Result R;
+        R.PTA.reset(new LLVMPointerAnalysis(&M));
+        R.PTA->run<analysis::pta::PointsToFlowInsensitive>();
+        return R;
+    }
+};
+
+llvm::AnalysisKey PointsToAnalysisPass::Key;
+
+class DGAliasAnalysis;
+
+///
+// Answers the alias queries from the points-to sets of dg. The sets
+// of all the pointers are copied into one array when the result is
+// created, so a query is two lookups and a walk over the sets.
+// The points-to analysis is flow-insensitive, so the sets stay valid
+// when the passes move the instructions. The values that the passes
+// delete are dropped from the index (their addresses may be reused
+// by the new values) and the new values are not known, the queries
+// about them are left to the other alias analyses.
+class DGAAResult : public llvm::AAResultBase<DGAAResult>
+{
+    friend llvm::AAResultBase<DGAAResult>;
+
+    struct Target {
+        // the memory object, used only to compare the targets
+        const analysis::pta::PSNode *object;
+        // the value that allocated the object (if any)
+        const llvm::Value *value;
+        uint64_t offset;
+    };
+
+    struct Range {
+        uint32_t first = 0, last = 0;
+        // the pointer may point to an unknown memory
+        bool unknown = false;
+    };
+
+    struct IndexConfig : llvm::ValueMapConfig<const llvm::Value *> {
+        enum { FollowRAUW = false };
+    };
+
+    using IndexT = llvm::ValueMap<const llvm::Value *, Range, IndexConfig>;
+
+    std::vector<Target> targets;
+    // ValueMap cannot be moved and the results are moved around
+    std::unique_ptr<IndexT> index;
+    std::unique_ptr<analysis::LLVMModRefAnalysis> modref;
+
+    bool getRange(const llvm::Value *ptr, Range& range) const
+    {
+        auto it = index->find(ptr);
+        if (it == index->end())
+            return false;
+
+        range = it->second;
+        return !range.unknown;
+    }
+
+    static bool overlaps(const Target& a, uint64_t asize,
+                         const Target& b, uint64_t bsize)
+    {
+        if (a.offset == UNKNOWN_OFFSET || b.offset == UNKNOWN_OFFSET
+            || asize == UNKNOWN_OFFSET || bsize == UNKNOWN_OFFSET)
+            return true;
+
+        return a.offset < b.offset + bsize && b.offset < a.offset + asize;
+    }
+
+    static uint64_t getSize(const llvm::MemoryLocation& Loc)
+    {
+        return Loc.Size.hasValue() ? Loc.Size.getValue() : UNKNOWN_OFFSET;
+    }
+
+public:
+    DGAAResult(const llvm::Module& M, LLVMPointerAnalysis *PTA)
+        : index(new IndexT())
+    {
+        std::unordered_map<analysis::pta::PSNode *, Range> copied;
+        for (const auto& it : PTA->getNodesMap()) {
+            if (!it.first->getType()->isPointerTy())
+                continue;
+
+            analysis::pta::PSNode *n = PTA->getPointsTo(it.first);
+            if (!n)
+                continue;
+
+            auto cit = copied.find(n);
+            if (cit == copied.end()) {
+                Range range;
+                range.first = targets.size();
+                for (const analysis::pta::Pointer& ptr : n->pointsTo) {
+                    if (ptr.isUnknown())
+                        range.unknown = true;
+                    // the null pointer is not dereferenced
+                    else if (ptr.isValid())
+                        targets.push_back({ptr.target,
+                                           ptr.target->getUserData<llvm::Value>(),
+                                           *ptr.offset});
+                }
+                range.last = targets.size();
+                cit = copied.emplace(n, range).first;
+            }
+
+            index->insert(std::make_pair(it.first, cit->second));
+        }
+
+        targets.shrink_to_fit();
+
+        modref.reset(new analysis::LLVMModRefAnalysis(&M, PTA));
+        modref->compute();
+    }
+
+    DGAAResult(DGAAResult&&) = default;
+
+    bool invalidate(llvm::Module&, const llvm::PreservedAnalyses& PA,
+                    llvm::ModuleAnalysisManager::Invalidator&);
+
+    llvm::AliasResult alias(const llvm::MemoryLocation& LocA,
+                            const llvm::MemoryLocation& LocB,
+                            llvm::AAQueryInfo& AAQI)
+    {
+        Range A, B;
+        if (!getRange(LocA.Ptr, A) || !getRange(LocB.Ptr, B)
+            // no targets - the pointer is null or comes from
+            // the code that the analysis did not see
+            || A.first == A.last || B.first == B.last)
+            return AAResultBase::alias(LocA, LocB, AAQI);
+
+        uint64_t asize = getSize(LocA), bsize = getSize(LocB);
+        for (uint32_t i = A.first; i < A.last; ++i) {
+            for (uint32_t j = B.first; j < B.last; ++j) {
+                if (targets[i].object == targets[j].object
+                    && overlaps(targets[i], asize, targets[j], bsize))
+                    return AAResultBase::alias(LocA, LocB, AAQI);
+            }
+        }
+
+        return llvm::AliasResult::NoAlias;
+    }
+
+    llvm::ModRefInfo getModRefInfo(const llvm::CallBase *Call,
+                                   const llvm::MemoryLocation& Loc,
+                                   llvm::AAQueryInfo& AAQI)
+    {
+        // the defined functions touch only the globals
+        // in their sets (and the memory that is not global)
+        const llvm::Function *F = Call->getCalledFunction();
+        const analysis::LLVMModRefAnalysis::GlobalsT *G
+            = F && !F->isDeclaration() ? modref->getGlobals(F) : nullptr;
+        Range range;
+        if (!G || !getRange(Loc.Ptr, range) || range.first == range.last)
+            return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+
+        for (uint32_t i = range.first; i < range.last; ++i) {
+            const llvm::GlobalVariable *GV
+                = llvm::dyn_cast_or_null<llvm::GlobalVariable>(targets[i].value);
+            if (!GV || std::find(G->begin(), G->end(), GV) != G->end())
+                return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+        }
+
+        return llvm::ModRefInfo::NoModRef;
+    }
+
+    using AAResultBase::getModRefInfo;
+};
+
+class DGAliasAnalysis : public llvm::AnalysisInfoMixin<DGAliasAnalysis>
+{
+    friend llvm::AnalysisInfoMixin<DGAliasAnalysis>;
+    static llvm::AnalysisKey Key;
+
+public:
+    using Result = DGAAResult;
+
+    Result run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM)
+    {
+        return DGAAResult(M, MAM.getResult<PointsToAnalysisPass>(M).PTA.get());
+    }
+};
+
+llvm::AnalysisKey DGAliasAnalysis::Key;
+
+bool DGAAResult::invalidate(llvm::Module&, const llvm::PreservedAnalyses& PA,
+                            llvm::ModuleAnalysisManager::Invalidator&)
+{
+    auto checker = PA.getChecker<DGAliasAnalysis>();
+    return !checker.preserved() &&
+           !checker.preservedSet<llvm::AllAnalysesOn<llvm::Module>>();
+}
+
+class SlicerPass : public llvm::PassInfoMixin<SlicerPass>
+{
+    std::vector<std::string> criteria;
+
+public:
+    SlicerPass(std::vector<std::string> crit) : criteria(std::move(crit)) {}
+
+    llvm::PreservedAnalyses run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM)
+    {
+        llvm::Function *entry = M.getFunction("main");
+        if (!entry || entry->isDeclaration()) {
+            errs() << "dg-slice: no 'main' function, not slicing\n";
+            return llvm::PreservedAnalyses::all();
+        }
+
+        if (criteria.empty()) {
+            errs() << "dg-slice: no slicing criteria given, not slicing\n";
+            return llvm::PreservedAnalyses::all();
+        }
+
+        LLVMPointerAnalysis *PTA
+            = MAM.getResult<PointsToAnalysisPass>(M).PTA.get();
+
+        LLVMDependenceGraph dg;
+        if (!dg.build(&M, PTA, entry)) {
+            errs() << "dg-slice: building the dependence graph failed\n";
+            return llvm::PreservedAnalyses::all();
+        }
+
+        std::set<LLVMNode *> callsites;
+        if (!dg.getCallSites(criteria, &callsites)) {
+            // unlike llvm-slicer, keep the module as it is - the pipeline
+            // may run the pass on modules that do not contain the criteria
+            errs() << "dg-slice: did not find the slicing criteria\n";
+            return llvm::PreservedAnalyses::all();
+        }
+
+        LLVMReachingDefinitions RD(&M, PTA);
+        RD.run();
+
+        LLVMDefUseAnalysis DUA(&dg, &RD, PTA);
+        DUA.run();
+
+        dg.computeControlDependencies(CLASSIC);
+
+        LLVMSlicer slicer;
+        slicer.keepFunctionUntouched("__VERIFIER_assume");
+        slicer.keepFunctionUntouched("__VERIFIER_exit");
+        slicer.markMulti({std::vector<LLVMNode *>(callsites.begin(),
+                                                  callsites.end())});
+        uint32_t slice_id = slicer.markCriterion(0, 0xdead);
+        slicer.slice(&dg, nullptr, slice_id);
+
+        return llvm::PreservedAnalyses::none();
+    }
+};
+
+} // anonymous namespace
+
+static bool parsePipelineElement(llvm::StringRef name,
+                                 llvm::ModulePassManager& MPM)
+{
+    if (name == "dg-pta") {
+        MPM.addPass(llvm::RequireAnalysisPass<PointsToAnalysisPass,
+                                              llvm::Module>());
+        return true;
+    }
+
+    if (name == "dg-aa") {
+        MPM.addPass(llvm::RequireAnalysisPass<DGAliasAnalysis, llvm::Module>());
+        return true;
+    }
+
+    if (name == "dg-slice") {
+        MPM.addPass(SlicerPass(splitCriteria(slice_criteria, ',')));
+        return true;
+    }
+
+    if (name.consume_front("dg-slice<") && name.consume_back(">")) {
+        MPM.addPass(SlicerPass(splitCriteria(name, ';')));
+        return true;
+    }
+
+    return false;
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo
+llvmGetPassPluginInfo()
+{
+    return {LLVM_PLUGIN_API_VERSION, "dg", LLVM_VERSION_STRING,
+            [](llvm::PassBuilder& PB) {
+                PB.registerAnalysisRegistrationCallback(
+                    [](llvm::ModuleAnalysisManager& MAM) {
+                        MAM.registerPass([] { return PointsToAnalysisPass(); });
+                        MAM.registerPass([] { return DGAliasAnalysis(); });
+                    });
+                PB.registerParseAACallback(
+                    [](llvm::StringRef name, llvm::AAManager& AA) {
+                        if (name != "dg-aa")
+                            return false;
+
+                        AA.registerModuleAnalysis<DGAliasAnalysis>();
+                        return true;
+                    });
+                PB.registerPipelineParsingCallback(
+                    [](llvm::StringRef name, llvm::ModulePassManager& MPM,
+                       llvm::ArrayRef<llvm::PassBuilder::PipelineElement>) {
+                        return parsePipelineElement(name, MPM);
+                    });
+            }};
+}
@@ -2,6 +2,7 @@
 #error "This code needs LLVM enabled"
 #endif
 
+#include <algorithm>
 #include <set>
 #include <string>
 #include <iostream>
@@ -40,11 +41,13 @@
 #endif
 
 #include "llvm/analysis/PointsTo/PointsTo.h"
+#include "llvm/LoadModule.h"
 #include "analysis/PointsTo/PointsToFlowInsensitive.h"
 #include "analysis/PointsTo/PointsToFlowSensitive.h"
 #include "analysis/PointsTo/Pointer.h"
 
 #include "TimeMeasure.h"
+#include "BinaryDump.h"
 
 using namespace dg;
 using namespace dg::analysis::pta;
@@ -57,6 +60,19 @@ enum PTType {
     FLOW_INSENSITIVE,
 };
 
+// the analysis that keeps the memory objects and maps of the nodes
+static PointerAnalysis *dumpedPTA;
+
+static MemoryObject *getMemoryObject(PSNode *n)
+{
+    return static_cast<PointsToFlowInsensitive *>(dumpedPTA)->getMemoryObject(n);
+}
+
+static PointsToFlowSensitive::MemoryMapT *getMemoryMap(PSNode *n)
+{
+    return static_cast<PointsToFlowSensitive *>(dumpedPTA)->getMemoryMap(n);
+}
+
 static std::string
 getInstName(const llvm::Value *val)
 {
@@ -75,6 +91,23 @@ getInstName(const llvm::Value *val)
     return ostr.str();
 }
 
+static std::string
+getNodeName(const PSNode *node)
+{
+    if (node->isNull())
+        return "null";
+    if (node->isUnknownMemory())
+        return "unknown";
+
+    const llvm::Value *val = node->getUserData<llvm::Value>();
+    if (!val)
+        return std::string("<") + std::to_string(node->getID()) + ">";
+
+    std::string name = getInstName(val);
+    // instructions are printed indented
+    return name.substr(std::min(name.find_first_not_of(' '), name.size()));
+}
+
 void printPSNodeType(enum PSNodeType type)
 {
 #define ELEM(t) case t: do {printf("%s", #t); }while(0); break;
@@ -175,27 +208,28 @@ dumpMemoryObject(MemoryObject *mo, int ind, bool dot)
 static void
 dumpMemoryMap(PointsToFlowSensitive::MemoryMapT *mm, int ind, bool dot)
 {
-    for (auto it : *mm) {
-        // print the key
-        const Pointer& key = it.first;
-        if (!dot)
-            printf("%*s", ind, "");
+    for (const auto& T : *mm) {
+        for (const auto& it : T.second) {
+            // print the key
+            if (!dot)
+                printf("%*s", ind, "");
 
-        putchar('[');
-        printName(key.target, dot);
+            putchar('[');
+            printName(T.first, dot);
 
-        if (key.offset.isUnknown())
-            puts(" + UNKNOWN]:");
-        else
-            printf(" + %lu]:", *key.offset);
+            if (it.first.isUnknown())
+                puts(" + UNKNOWN]:");
+            else
+                printf(" + %lu]:", *it.first);
 
-        if (dot)
-            printf("\\n");
-        else
-            putchar('\n');
+            if (dot)
+                printf("\\n");
+            else
+                putchar('\n');
 
-        for (MemoryObject *mo : it.second)
-            dumpMemoryObject(mo, ind + 4, dot);
+            for (MemoryObject *mo : *it.second)
+                dumpMemoryObject(mo, ind + 4, dot);
+        }
     }
 }
 
@@ -204,7 +238,7 @@ dumpPointerSubgraphData(PSNode *n, PTType type, bool dot = false)
 {
     assert(n && "No node given");
     if (type == FLOW_INSENSITIVE) {
-        MemoryObject *mo = n->getData<MemoryObject>();
+        MemoryObject *mo = getMemoryObject(n);
         if (!mo)
             return;
 
@@ -219,7 +253,7 @@ dumpPointerSubgraphData(PSNode *n, PTType type, bool dot = false)
             printf("    -----------\n");
     } else {
         PointsToFlowSensitive::MemoryMapT *mm
-            = n->getData<PointsToFlowSensitive::MemoryMapT>();
+            = getMemoryMap(n);
         if (!mm)
             return;
 
@@ -267,8 +301,7 @@ dumpPSNode(PSNode *n, PTType type)
 static void
 dumpPointerSubgraphdot(LLVMPointerAnalysis *pta, PTType type)
 {
-    std::set<PSNode *> nodes;
-    pta->getNodes(nodes);
+    const std::vector<PSNode *>& nodes = pta->getNodes();
 
     printf("digraph \"Pointer State Subgraph\" {\n");
 
@@ -334,15 +367,196 @@ dumpPointerSubgraph(LLVMPointerAnalysis *pta, PTType type, bool todot)
     if (todot)
         dumpPointerSubgraphdot(pta, type);
     else {
-        std::set<PSNode *> nodes;
-        pta->getNodes(nodes);
-
-        for (PSNode *node : nodes) {
+        for (PSNode *node : pta->getNodes()) {
             dumpPSNode(node, type);
         }
     }
 }
 
+static void
+writePointers(debug::BinaryDumpWriter& out, const PointsToSetT& pointers)
+{
+    out.writeNum(pointers.size());
+    for (const Pointer& ptr : pointers) {
+        out.writeNode(ptr.target, getNodeName);
+        out.writeOffset(ptr.offset);
+    }
+}
+
+static void
+writeMemoryObject(debug::BinaryDumpWriter& out, const MemoryObject *mo)
+{
+    out.writeNum(mo->pointsTo.size());
+    for (auto& it : mo->pointsTo) {
+        out.writeOffset(it.first);
+        writePointers(out, it.second);
+    }
+}
+
+///
+// Write the dump in the binary format (see BinaryDump.h), the record
+// of a node is: the node, its points-to set, the number of memory
+// objects and for every memory object its pointer (the node and offset)
+// and the points-to sets of its offsets. The memory objects of a node
+// are the memory map at the node (flow-sensitive analysis) or
+// the memory allocated by the node (flow-insensitive analysis).
+// A points-to set is its size followed by the pointers.
+static bool
+dumpPointerSubgraphBinary(LLVMPointerAnalysis *pta, PTType type, FILE *file)
+{
+    const std::vector<PSNode *>& nodes = pta->getNodes();
+
+    debug::BinaryDumpWriter out(file, debug::BinaryDumpKind::POINTS_TO);
+    for (PSNode *node : nodes) {
+        out.startRecord();
+        out.writeNode(node, getNodeName);
+        writePointers(out, node->pointsTo);
+
+        if (type == FLOW_INSENSITIVE) {
+            MemoryObject *mo = getMemoryObject(node);
+            out.writeNum(mo ? 1 : 0);
+            if (mo) {
+                out.writeNode(node, getNodeName);
+                out.writeOffset(0);
+                writeMemoryObject(out, mo);
+            }
+        } else {
+            PointsToFlowSensitive::MemoryMapT *mm
+                = getMemoryMap(node);
+            size_t num = 0;
+            if (mm) {
+                for (auto& T : *mm) {
+                    for (auto& it : T.second)
+                        num += it.second->size();
+                }
+            }
+
+            out.writeNum(num);
+            if (mm) {
+                for (auto& T : *mm) {
+                    for (auto& it : T.second) {
+                        for (MemoryObject *mo : *it.second) {
+                            out.writeNode(T.first, getNodeName);
+                            out.writeOffset(it.first);
+                            writeMemoryObject(out, mo);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return out.finish();
+}
+
+// does the name of the node match the name given by the user?
+// The user can give the whole name or the beginning of it
+// up to the first space (e.g. '%3' for '%3 = load ...')
+static bool
+matchesName(const std::string& name, const char *query)
+{
+    size_t len = strlen(query);
+    return name.compare(0, len, query) == 0
+            && (name.size() == len || name[len] == ' ');
+}
+
+static void
+printBinaryPointer(debug::BinaryDumpReader& in, const char *prefix)
+{
+    uint64_t target = in.readNode();
+    analysis::Offset off = in.readOffset();
+    if (!in.ok())
+        return;
+
+    printf("%s%s", prefix, in.getName(target).c_str());
+    if (off.isUnknown())
+        puts(" + UNKNOWN_OFFSET");
+    else
+        printf(" + %lu\n", *off);
+}
+
+static void
+skipPointers(debug::BinaryDumpReader& in)
+{
+    for (uint64_t n = in.readNum(); n > 0 && in.ok(); --n) {
+        in.readNode();
+        in.readOffset();
+    }
+}
+
+///
+// Answer a query about a binary dump: print the points-to sets of the
+// nodes named @points_to and the contents of the memory named @memory
+// (at the nodes named @at, or at all nodes if @at is null)
+static bool
+queryBinaryDump(const char *path, const char *points_to,
+                const char *memory, const char *at)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        errs() << "Cannot open " << path << "\n";
+        return false;
+    }
+
+    debug::BinaryDumpReader in(file);
+    if (in.ok() && in.getKind() != debug::BinaryDumpKind::POINTS_TO) {
+        errs() << path << " is not a dump of points-to analysis\n";
+        fclose(file);
+        return false;
+    }
+
+    while (in.nextRecord()) {
+        const std::string& name = in.getName(in.readNode());
+        bool node_matches = points_to && matchesName(name, points_to);
+        if (node_matches) {
+            printf("NODE: %s\n", name.c_str());
+            for (uint64_t n = in.readNum(); n > 0 && in.ok(); --n)
+                printBinaryPointer(in, "    -> ");
+        } else {
+            skipPointers(in);
+        }
+
+        bool at_matches = memory && (!at || matchesName(name, at));
+        for (uint64_t n = in.readNum(); n > 0 && in.ok(); --n) {
+            uint64_t target = in.readNode();
+            analysis::Offset off = in.readOffset();
+            bool print = at_matches && matchesName(in.getName(target), memory);
+            if (print) {
+                printf("AT: %s\n  [%s + ", name.c_str(),
+                       in.getName(target).c_str());
+                if (off.isUnknown())
+                    printf("UNKNOWN]:\n");
+                else
+                    printf("%lu]:\n", *off);
+            }
+
+            for (uint64_t m = in.readNum(); m > 0 && in.ok(); --m) {
+                analysis::Offset field = in.readOffset();
+                if (!print) {
+                    skipPointers(in);
+                    continue;
+                }
+
+                char prefix[32];
+                if (field.isUnknown())
+                    snprintf(prefix, sizeof prefix, "    [UNKNOWN] -> ");
+                else
+                    snprintf(prefix, sizeof prefix, "    [%lu] -> ", *field);
+                for (uint64_t k = in.readNum(); k > 0 && in.ok(); --k)
+                    printBinaryPointer(in, prefix);
+            }
+        }
+    }
+
+    fclose(file);
+    if (!in.ok()) {
+        errs() << "Invalid or truncated dump " << path << "\n";
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     llvm::Module *M;
@@ -352,6 +566,14 @@ int main(int argc, char *argv[])
     const char *module = nullptr;
     PTType type = FLOW_INSENSITIVE;
     uint64_t field_senitivity = UNKNOWN_OFFSET;
+    bool statistics = false;
+    bool time_report = false;
+    std::string time_trace;
+    const char *binary = nullptr;
+    const char *load = nullptr;
+    const char *points_to = nullptr;
+    const char *memory = nullptr;
+    const char *at = nullptr;
 
     // parse options
     for (int i = 1; i < argc; ++i) {
@@ -365,11 +587,37 @@ int main(int argc, char *argv[])
             todot = true;
         } else if (strcmp(argv[i], "-v") == 0) {
             verbose = true;
+        } else if (strcmp(argv[i], "-statistics") == 0) {
+            statistics = true;
+        } else if (strcmp(argv[i], "-time-report") == 0) {
+            time_report = true;
+        } else if (strcmp(argv[i], "-time-trace") == 0) {
+            time_trace = argv[++i];
+        } else if (strcmp(argv[i], "-binary") == 0) {
+            binary = argv[++i];
+        } else if (strcmp(argv[i], "-load") == 0) {
+            load = argv[++i];
+        } else if (strcmp(argv[i], "-points-to") == 0) {
+            points_to = argv[++i];
+        } else if (strcmp(argv[i], "-memory") == 0) {
+            memory = argv[++i];
+        } else if (strcmp(argv[i], "-at") == 0) {
+            at = argv[++i];
         } else {
             module = argv[i];
         }
     }
 
+    // query a binary dump, no analysis is run
+    if (load) {
+        if (!points_to && !memory) {
+            errs() << "Usage: % -load FILE [-points-to VALUE] [-memory VALUE [-at NODE]]\n";
+            return 1;
+        }
+
+        return queryBinaryDump(load, points_to, memory, at) ? 0 : 1;
+    }
+
     if (!module) {
         errs() << "Usage: % IR_module [output_file]\n";
         return 1;
@@ -378,7 +626,7 @@ int main(int argc, char *argv[])
 #if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
     M = llvm::ParseIRFile(module, SMD, context);
 #else
-    auto _M = llvm::parseIRFile(module, SMD, context);
+    auto _M = dg::loadModule(module, SMD, context);
     // _M is unique pointer, we need to get Module *
     M = _M.get();
 #endif
@@ -389,31 +637,53 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    debug::TimeMeasure tm;
+    using analysis::Profiler;
+    std::unique_ptr<Profiler> profiler;
+    if (time_report || !time_trace.empty())
+        profiler.reset(new Profiler());
 
     LLVMPointerAnalysis PTA(M, field_senitivity);
+    PTA.collectStatistics(statistics);
     std::unique_ptr<PointerAnalysis> PA;
 
-    tm.start();
+    {
+        Profiler::Scope phase("Points-to analysis");
 
-    // use createAnalysis instead of the run() method so that we won't delete
-    // the analysis data (like memory objects) which may be needed
-    if (type == FLOW_INSENSITIVE) {
-        PA = std::unique_ptr<PointerAnalysis>(
-            PTA.createPTA<analysis::pta::PointsToFlowInsensitive>()
-            );
-    } else {
-        PA = std::unique_ptr<PointerAnalysis>(
-            PTA.createPTA<analysis::pta::PointsToFlowSensitive>()
-            );
+        // use createAnalysis instead of the run() method so that we won't
+        // delete the analysis data (like memory objects) which may be needed
+        if (type == FLOW_INSENSITIVE) {
+            PA = std::unique_ptr<PointerAnalysis>(
+                PTA.createPTA<analysis::pta::PointsToFlowInsensitive>()
+                );
+        } else {
+            PA = std::unique_ptr<PointerAnalysis>(
+                PTA.createPTA<analysis::pta::PointsToFlowSensitive>()
+                );
+        }
+
+        // run the analysis
+        PA->run();
     }
 
-    // run the analysis
-    PA->run();
+    dumpedPTA = PA.get();
+
+    if (statistics)
+        PTA.printStatistics(errs(), PA->getStatistics());
+
+    if (binary) {
+        FILE *file = fopen(binary, "wb");
+        if (!file || !dumpPointerSubgraphBinary(&PTA, type, file)) {
+            errs() << "Failed writing the dump to " << binary << "\n";
+            if (file)
+                fclose(file);
+            return 1;
+        }
+
+        fclose(file);
+    } else
+        dumpPointerSubgraph(&PTA, type, todot);
 
-    tm.stop();
-    tm.report("INFO: Points-to analysis [new] took");
-    dumpPointerSubgraph(&PTA, type, todot);
+    debug::reportProfile(profiler.get(), time_report, time_trace);
 
     return 0;
 }
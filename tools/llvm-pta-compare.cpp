@@ -2,11 +2,16 @@
 #error "This code needs LLVM enabled"
 #endif
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <set>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -37,10 +42,12 @@
 #endif
 
 #include "llvm/analysis/PointsTo/PointsTo.h"
+#include "llvm/LoadModule.h"
 
 #include "analysis/PointsTo/PointsToFlowInsensitive.h"
 #include "analysis/PointsTo/PointsToFlowSensitive.h"
 #include "analysis/PointsTo/Pointer.h"
+#include "analysis/Parallel.h"
 
 #include "TimeMeasure.h"
 
@@ -53,147 +60,248 @@ enum PTType {
     FLOW_INSENSITIVE,
 };
 
-static std::string
-getInstName(const llvm::Value *val)
-{
-    std::ostringstream ostr;
-    llvm::raw_os_ostream ro(ostr);
+// the ids of the targets that are not LLVM values
+static const unsigned NULL_ID = ~0U;
+static const unsigned UNKNOWN_ID = ~0U - 1;
+static const unsigned OTHER_ID = ~0U - 2;
+
+// the values of the module numbered by their position in the module
+// (the globals, the functions and the instructions), so the ids are the
+// same in every run on the module and the results can be cached
+struct ValueIds {
+    std::vector<const llvm::Value *> values;
+    std::unordered_map<const llvm::Value *, unsigned> ids;
+
+    ValueIds(const llvm::Module *M)
+    {
+        for (const llvm::GlobalVariable& G : M->globals())
+            add(&G);
+        for (const llvm::Function& F : *M)
+            add(&F);
+        for (const llvm::Function& F : *M)
+            for (const llvm::BasicBlock& B : F)
+                for (const llvm::Instruction& I : B)
+                    add(&I);
+    }
 
-    assert(val);
-    ro << *val;
-    ro.flush();
+    void add(const llvm::Value *val)
+    {
+        ids.emplace(val, values.size());
+        values.push_back(val);
+    }
 
-    // break the string if it is too long
-    return ostr.str();
-}
+    unsigned getTargetId(PSNode *target) const
+    {
+        if (target == NULLPTR)
+            return NULL_ID;
+        if (target == UNKNOWN_MEMORY)
+            return UNKNOWN_ID;
 
-static void
-printName(PSNode *node)
-{
-    if (!node->getUserData<llvm::Value>()) {
-        printf("%p", node);
-        return;
+        auto it = ids.find(target->getUserData<llvm::Value>());
+        if (it == ids.end())
+            return OTHER_ID;
+
+        return it->second;
     }
+};
 
-    std::string nm = getInstName(node->getUserData<llvm::Value>());
-    const char *name = nm.c_str();
+// the points-to sets of the values computed by one analysis.
+// The sets are sorted, so that two sets are the same if they
+// have the same fingerprint (up to the collisions of the hash)
+struct PTResults {
+    using PtrT = std::pair<unsigned, uint64_t>;
+    struct Set {
+        std::vector<PtrT> pointers;
+        uint64_t fingerprint;
+    };
+
+    std::string name;
+    // value id -> the points-to set
+    std::map<unsigned, Set> sets;
+
+    PTResults(const std::string& n) : name(n) {}
+
+    void add(unsigned id, std::vector<PtrT>&& ptrs)
+    {
+        std::sort(ptrs.begin(), ptrs.end());
+        ptrs.erase(std::unique(ptrs.begin(), ptrs.end()), ptrs.end());
+
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        auto mix = [&hash](uint64_t val) {
+            for (unsigned i = 0; i < sizeof val; ++i) {
+                hash ^= (val >> (8 * i)) & 0xff;
+                hash *= 1099511628211ULL;
+            }
+        };
 
-    // escape the " character
-    for (int i = 0; name[i] != '\0'; ++i) {
-        // crop long names
-        if (i >= 70) {
-            printf(" ...");
-            break;
+        for (const PtrT& ptr : ptrs) {
+            mix(ptr.first);
+            mix(ptr.second);
         }
 
-        if (name[i] == '"')
-            putchar('\\');
+        Set& S = sets[id];
+        S.pointers = std::move(ptrs);
+        S.fingerprint = hash;
+    }
 
-        putchar(name[i]);
+    const Set *get(unsigned id) const
+    {
+        auto it = sets.find(id);
+        return it == sets.end() ? nullptr : &it->second;
     }
-}
 
-static void
-dumpPSNode(PSNode *n)
-{
-    printf("NODE: ");
-    printName(n);
+    void collect(LLVMPointerAnalysis *PTA, const ValueIds& ids)
+    {
+        for (unsigned id = 0; id < ids.values.size(); ++id) {
+            if (!llvm::isa<llvm::Instruction>(ids.values[id]))
+                continue;
 
-    if (n->getSize() || n->isHeap() || n->isZeroInitialized())
-        printf(" [size: %lu, heap: %u, zeroed: %u]",
-               n->getSize(), n->isHeap(), n->isZeroInitialized());
+            PSNode *node = PTA->getPointsTo(ids.values[id]);
+            if (!node)
+                continue;
 
-    if (n->pointsTo.empty()) {
-        puts("\n    -> no points-to");
-        return;
-    } else
-        putchar('\n');
-
-    for (const Pointer& ptr : n->pointsTo) {
-        printf("    -> ");
-        printName(ptr.target);
-        if (ptr.offset.isUnknown())
-            puts(" + UNKNOWN_OFFSET");
-        else
-            printf(" + %lu\n", *ptr.offset);
-    }
-}
+            std::vector<PtrT> ptrs;
+            ptrs.reserve(node->pointsTo.size());
+            for (const Pointer& ptr : node->pointsTo)
+                ptrs.emplace_back(ids.getTargetId(ptr.target), *ptr.offset);
 
-static bool verify_ptsets(const llvm::Value *val,
-                          LLVMPointerAnalysis *fi,
-                          LLVMPointerAnalysis *fs)
-{
-    PSNode *finode = fi->getPointsTo(val);
-    PSNode *fsnode = fs->getPointsTo(val);
-
-    if (!finode) {
-        if (fsnode) {
-            llvm::errs() << "FI don't have points-to for: " << *val << "\n"
-                         << "but FS has:\n";
-            dumpPSNode(fsnode);
-        } else
-            // if boths mapping are null we assume that
-            // the value is not reachable from main
-            // (if nothing more, its not different for FI and FS)
-            return true;
-
-        return false;
+            add(id, std::move(ptrs));
+        }
     }
 
-    if (!fsnode) {
-        if (finode) {
-            llvm::errs() << "FS don't have points-to for: " << *val << "\n"
-                         << "but FI has:\n";
-            dumpPSNode(finode);
-        } else
-            return true;
+    bool save(const std::string& path, size_t values_num) const
+    {
+        std::ofstream out(path);
+        out << "dg-pta-results " << values_num << " " << sets.size() << "\n";
+        for (const auto& it : sets) {
+            out << it.first << " " << it.second.pointers.size();
+            for (const PtrT& ptr : it.second.pointers)
+                out << " " << ptr.first << " " << ptr.second;
+            out << "\n";
+        }
 
-        return false;
+        return static_cast<bool>(out);
     }
 
-    for (const Pointer& ptr : fsnode->pointsTo) {
-        bool found = false;
-        for (const Pointer& ptr2 : finode->pointsTo) {
-            // either the pointer is there or
-            // FS has (target, offset) and FI has (target, UNKNOWN_OFFSET),
-            // than everything is fine. The other case (FS has UNKNOWN_OFFSET)
-            // we don't consider here, since that should not happen
-            if ((ptr2.target->getUserData<llvm::Value>()
-                == ptr.target->getUserData<llvm::Value>())
-                && (ptr2.offset == ptr.offset ||
-                    ptr2.offset.isUnknown()
-                    /* || ptr.offset.isUnknown()*/)) {
-                found = true;
-                break;
-            }
+    bool load(const std::string& path, size_t values_num)
+    {
+        std::ifstream in(path);
+        std::string magic;
+        size_t file_values_num, sets_num;
+        if (!(in >> magic >> file_values_num >> sets_num)
+            || magic != "dg-pta-results") {
+            errs() << "ERROR: " << path << " is not a file with results\n";
+            return false;
+        }
+
+        if (file_values_num != values_num) {
+            errs() << "ERROR: the results in " << path
+                   << " are for a different module\n";
+            return false;
         }
 
-        if (!found) {
-                llvm::errs() << "FS not subset of FI: " << *val << "\n";
-                llvm::errs() << "FI ";
-                dumpPSNode(finode);
-                llvm::errs() << "FS ";
-                dumpPSNode(fsnode);
-                llvm::errs() << " ---- \n";
+        for (size_t i = 0; i < sets_num; ++i) {
+            unsigned id;
+            size_t size;
+            if (!(in >> id >> size))
                 return false;
+
+            std::vector<PtrT> ptrs(size);
+            for (PtrT& ptr : ptrs) {
+                if (!(in >> ptr.first >> ptr.second))
+                    return false;
+            }
+
+            add(id, std::move(ptrs));
         }
+
+        return true;
+    }
+};
+
+static void printTarget(unsigned id, const ValueIds& ids)
+{
+    if (id == NULL_ID)
+        errs() << "null";
+    else if (id == UNKNOWN_ID)
+        errs() << "unknown";
+    else if (id == OTHER_ID)
+        errs() << "(no value)";
+    else
+        errs() << *ids.values[id];
+}
+
+static void printSet(const PTResults& R, const PTResults::Set *S,
+                     const ValueIds& ids)
+{
+    errs() << R.name << ":";
+    if (!S) {
+        errs() << " no points-to\n";
+        return;
+    }
+
+    errs() << "\n";
+    for (const PTResults::PtrT& ptr : S->pointers) {
+        errs() << "    -> ";
+        printTarget(ptr.first, ids);
+        if (ptr.second == UNKNOWN_OFFSET)
+            errs() << " + UNKNOWN_OFFSET\n";
+        else
+            errs() << " + " << ptr.second << "\n";
+    }
+}
+
+// is every pointer of @S in @base? The pointer (target, offset)
+// can be in @base also as (target, UNKNOWN_OFFSET). The other case
+// (@S has UNKNOWN_OFFSET) we don't consider here, since that should
+// not happen for a more precise analysis
+static bool isSubset(const PTResults::Set& S, const PTResults::Set& base)
+{
+    for (const PTResults::PtrT& ptr : S.pointers) {
+        if (!std::binary_search(base.pointers.begin(), base.pointers.end(), ptr)
+            && !std::binary_search(base.pointers.begin(), base.pointers.end(),
+                                   PTResults::PtrT(ptr.first, UNKNOWN_OFFSET)))
+            return false;
     }
 
     return true;
 }
 
-static bool verify_ptsets(llvm::Module *M,
-                          LLVMPointerAnalysis *fi,
-                          LLVMPointerAnalysis *fs)
+// check that the points-to sets of @R are subsets of the sets
+// of @base, report only the values where they are not
+static bool verify_ptsets(const PTResults& base, const PTResults& R,
+                          const ValueIds& ids)
 {
-    using namespace llvm;
     bool ret = true;
 
-    for (Function& F : *M)
-        for (BasicBlock& B : F)
-            for (Instruction& I : B)
-                if (!verify_ptsets(&I, fi, fs))
-                    ret = false;
+    for (const auto& it : R.sets) {
+        const PTResults::Set *B = base.get(it.first);
+        if (B && B->fingerprint == it.second.fingerprint)
+            continue;
+
+        if (B && isSubset(it.second, *B))
+            continue;
+
+        errs() << R.name << " not subset of " << base.name << ": "
+               << *ids.values[it.first] << "\n";
+        printSet(base, B, ids);
+        printSet(R, &it.second, ids);
+        errs() << " ---- \n";
+        ret = false;
+    }
+
+    // the values that have no points-to set in both analyses are
+    // not reachable from main, but having it only in one is a bug
+    for (const auto& it : base.sets) {
+        if (R.get(it.first))
+            continue;
+
+        errs() << R.name << " don't have points-to for: "
+               << *ids.values[it.first] << "\n";
+        printSet(base, &it.second, ids);
+        ret = false;
+    }
 
     return ret;
 }
@@ -204,20 +312,27 @@ int main(int argc, char *argv[])
     llvm::LLVMContext context;
     llvm::SMDiagnostic SMD;
     const char *module = nullptr;
-    unsigned type = FLOW_SENSITIVE | FLOW_INSENSITIVE;
+    std::vector<PTType> types;
+    std::string baseline_file;
+    std::string save_file;
 
     // parse options
     for (int i = 1; i < argc; ++i) {
-        // run only given points-to analysis
+        // run given points-to analyses, the first one is the baseline
         if (strcmp(argv[i], "-pta") == 0) {
             if (strcmp(argv[i+1], "fs") == 0)
-                type = FLOW_SENSITIVE;
+                types.push_back(FLOW_SENSITIVE);
             else if (strcmp(argv[i+1], "fi") == 0)
-                type = FLOW_INSENSITIVE;
+                types.push_back(FLOW_INSENSITIVE);
             else {
                 errs() << "Unknown PTA type" << argv[i + 1] << "\n";
                 abort();
             }
+            ++i;
+        } else if (strcmp(argv[i], "-baseline") == 0) {
+            baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "-save") == 0) {
+            save_file = argv[++i];
         /*} else if (strcmp(argv[i], "-v") == 0) {
             verbose = true;*/
         } else {
@@ -226,14 +341,18 @@ int main(int argc, char *argv[])
     }
 
     if (!module) {
-        errs() << "Usage: % llvm-pta-compare [-pta fs|fi] IR_module\n";
+        errs() << "Usage: % llvm-pta-compare [-pta fs|fi]... "
+                  "[-baseline FILE] [-save FILE] IR_module\n";
         return 1;
     }
 
+    if (types.empty())
+        types = {FLOW_INSENSITIVE, FLOW_SENSITIVE};
+
 #if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
     M = llvm::ParseIRFile(module, SMD, context);
 #else
-    auto _M = llvm::parseIRFile(module, SMD, context);
+    auto _M = dg::loadModule(module, SMD, context);
     // _M is unique pointer, we need to get Module *
     M = _M.get();
 #endif
@@ -244,38 +363,62 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    debug::TimeMeasure tm;
+    ValueIds ids(M);
 
-    LLVMPointerAnalysis *PTAfs = nullptr;
-    LLVMPointerAnalysis *PTAfi = nullptr;
-
-    if (type & FLOW_INSENSITIVE) {
-        PTAfi = new LLVMPointerAnalysis(M);
+    std::vector<PTResults> results;
+    if (!baseline_file.empty()) {
+        results.emplace_back("BASELINE");
+        if (!results.back().load(baseline_file, ids.values.size())) {
+            errs() << "ERROR: failed loading " << baseline_file << "\n";
+            return 1;
+        }
+    }
 
-        tm.start();
-        PTAfi->run<analysis::pta::PointsToFlowInsensitive>();
-        tm.stop();
-        tm.report("INFO: Points-to flow-insensitive analysis took");
+    // the analyses are created here, the builders classify the types
+    // of the module (and LLVM caches some of the properties of types),
+    // so the threads below only read the module
+    std::vector<std::unique_ptr<LLVMPointerAnalysis>> analyses;
+    for (PTType type : types) {
+        analyses.emplace_back(new LLVMPointerAnalysis(M));
+        results.emplace_back(type == FLOW_SENSITIVE ? "FS" : "FI");
     }
 
-    if (type & FLOW_SENSITIVE) {
-        PTAfs = new LLVMPointerAnalysis(M);
+    debug::TimeMeasure tm;
+    tm.start();
+
+    // run the analyses at once, each one in its thread.
+    // The tables of the points-to sets are shared by the analyses
+    PointsToSetT::setConcurrent(analyses.size() > 1);
+    analysis::parallelFor(analyses.size(), analyses.size(),
+                          [&](size_t i, unsigned) {
+        if (types[i] == FLOW_SENSITIVE)
+            analyses[i]->run<analysis::pta::PointsToFlowSensitive>();
+        else
+            analyses[i]->run<analysis::pta::PointsToFlowInsensitive>();
+    });
+    PointsToSetT::setConcurrent(false);
+
+    tm.stop();
+    tm.report("INFO: Points-to analyses took");
+
+    size_t first = results.size() - analyses.size();
+    for (size_t i = 0; i < analyses.size(); ++i)
+        results[first + i].collect(analyses[i].get(), ids);
+    analyses.clear();
 
-        tm.start();
-        PTAfs->run<analysis::pta::PointsToFlowSensitive>();
-        tm.stop();
-        tm.report("INFO: Points-to flow-sensitive analysis took");
+    if (!save_file.empty() && !results[0].save(save_file, ids.values.size())) {
+        errs() << "ERROR: failed saving the results to " << save_file << "\n";
+        return 1;
     }
 
     int ret = 0;
-    if (type == (FLOW_SENSITIVE | FLOW_INSENSITIVE)) {
-        ret = !verify_ptsets(M, PTAfi, PTAfs);
-        if (ret == 0)
-            llvm::errs() << "FS is a subset of FI, all OK\n";
+    for (size_t i = 1; i < results.size(); ++i) {
+        if (!verify_ptsets(results[0], results[i], ids))
+            ret = 1;
+        else
+            llvm::errs() << results[i].name << " is a subset of "
+                         << results[0].name << ", all OK\n";
     }
 
-    delete PTAfi;
-    delete PTAfs;
-
     return ret;
 }
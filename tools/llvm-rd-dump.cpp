@@ -2,13 +2,16 @@
 #error "This code needs LLVM enabled"
 #endif
 
+#include <algorithm>
 #include <set>
+#include <memory>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -45,8 +48,10 @@
 
 #include "llvm/analysis/PointsTo/PointsTo.h"
 #include "llvm/analysis/ReachingDefinitions/ReachingDefinitions.h"
+#include "llvm/LoadModule.h"
 
 #include "TimeMeasure.h"
+#include "BinaryDump.h"
 
 using namespace dg;
 using namespace dg::analysis;
@@ -69,6 +74,21 @@ getInstName(const llvm::Value *val)
     return ostr.str();
 }
 
+static std::string
+getNodeName(const RDNode *node)
+{
+    if (node == rd::UNKNOWN_MEMORY)
+        return "UNKNOWN MEMORY";
+
+    const llvm::Value *val = node->getUserData<llvm::Value>();
+    if (!val)
+        return std::string("<") + std::to_string(node->getID()) + ">";
+
+    std::string name = getInstName(val);
+    // instructions are printed indented
+    return name.substr(std::min(name.find_first_not_of(' '), name.size()));
+}
+
 static void
 printName(RDNode *node, bool dot)
 {
@@ -196,8 +216,7 @@ dumpRDNode(RDNode *n)
 static void
 dumpRDdot(LLVMReachingDefinitions *RD)
 {
-    std::set<RDNode *> nodes;
-    RD->getNodes(nodes);
+    const std::vector<RDNode *>& nodes = RD->getNodes();
 
     printf("digraph \"Pointer State Subgraph\" {\n");
 
@@ -236,14 +255,109 @@ dumpRD(LLVMReachingDefinitions *RD, bool todot)
     if (todot)
         dumpRDdot(RD);
     else {
-        std::set<RDNode *> nodes;
-        RD->getNodes(nodes);
-
-        for (RDNode *node : nodes)
+        for (RDNode *node : RD->getNodes())
             dumpRDNode(node);
     }
 }
 
+///
+// Write the dump in the binary format (see BinaryDump.h), the record
+// of a node is: the node and the number of the entries of its reaching
+// definitions map, every entry is the defined memory (the node, offset
+// and length), the number of the definitions and the definitions.
+static bool
+dumpRDBinary(LLVMReachingDefinitions *RD, FILE *file)
+{
+    const std::vector<RDNode *>& nodes = RD->getNodes();
+
+    debug::BinaryDumpWriter out(file, debug::BinaryDumpKind::REACHING_DEFINITIONS);
+    for (RDNode *node : nodes) {
+        out.startRecord();
+        out.writeNode(node, getNodeName);
+
+        const RDMap& map = node->getReachingDefinitions();
+        out.writeNum(map.size());
+        for (auto& it : map) {
+            out.writeNode(it.first.target, getNodeName);
+            out.writeOffset(it.first.offset);
+            out.writeOffset(it.first.len);
+            out.writeNum(it.second.size());
+            for (RDNode *site : it.second)
+                out.writeNode(site, getNodeName);
+        }
+    }
+
+    return out.finish();
+}
+
+// does the name of the node match the name given by the user?
+// The user can give the whole name or the beginning of it
+// up to the first space (e.g. '%3' for '%3 = load ...')
+static bool
+matchesName(const std::string& name, const char *query)
+{
+    size_t len = strlen(query);
+    return name.compare(0, len, query) == 0
+            && (name.size() == len || name[len] == ' ');
+}
+
+///
+// Answer a query about a binary dump: print the definitions that reach
+// the nodes named @reaching (only the definitions of the memory named
+// @of if it is not null)
+static bool
+queryBinaryDump(const char *path, const char *reaching, const char *of)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        errs() << "Cannot open " << path << "\n";
+        return false;
+    }
+
+    debug::BinaryDumpReader in(file);
+    if (in.ok() && in.getKind() != debug::BinaryDumpKind::REACHING_DEFINITIONS) {
+        errs() << path << " is not a dump of reaching definitions\n";
+        fclose(file);
+        return false;
+    }
+
+    while (in.nextRecord()) {
+        const std::string& name = in.getName(in.readNode());
+        bool node_matches = matchesName(name, reaching);
+        if (node_matches)
+            printf("NODE: %s\n", name.c_str());
+
+        for (uint64_t n = in.readNum(); n > 0 && in.ok(); --n) {
+            const std::string& target = in.getName(in.readNode());
+            Offset off = in.readOffset();
+            Offset len = in.readOffset();
+            bool print = node_matches && (!of || matchesName(target, of));
+            for (uint64_t m = in.readNum(); m > 0 && in.ok(); --m) {
+                const std::string& site = in.getName(in.readNode());
+                if (!print)
+                    continue;
+
+                printf("%s", target.c_str());
+                if (off.isUnknown())
+                    printf(" | UNKNOWN | => ");
+                else if (len.isUnknown())
+                    printf(" | %lu - UNKNOWN | => ", *off);
+                else
+                    printf(" | %lu - %lu | => ", *off, *off + *len - 1);
+                printf("%s\n", site.c_str());
+            }
+        }
+    }
+
+    fclose(file);
+    if (!in.ok()) {
+        errs() << "Invalid or truncated dump " << path << "\n";
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     llvm::Module *M;
@@ -254,6 +368,12 @@ int main(int argc, char *argv[])
     uint64_t field_senitivity = UNKNOWN_OFFSET;
     bool rd_strong_update_unknown = false;
     uint32_t max_set_size = ~((uint32_t) 0);
+    bool time_report = false;
+    std::string time_trace;
+    const char *binary = nullptr;
+    const char *load = nullptr;
+    const char *reaching = nullptr;
+    const char *of = nullptr;
 
     enum {
         FLOW_SENSITIVE = 1,
@@ -276,24 +396,46 @@ int main(int argc, char *argv[])
             }
         } else if (strcmp(argv[i], "-rd-strong-update-unknown") == 0) {
             rd_strong_update_unknown = true;
+        } else if (strcmp(argv[i], "-time-report") == 0) {
+            time_report = true;
+        } else if (strcmp(argv[i], "-time-trace") == 0) {
+            time_trace = argv[++i];
         } else if (strcmp(argv[i], "-dot") == 0) {
             todot = true;
         } else if (strcmp(argv[i], "-v") == 0) {
             verbose = true;
+        } else if (strcmp(argv[i], "-binary") == 0) {
+            binary = argv[++i];
+        } else if (strcmp(argv[i], "-load") == 0) {
+            load = argv[++i];
+        } else if (strcmp(argv[i], "-reaching") == 0) {
+            reaching = argv[++i];
+        } else if (strcmp(argv[i], "-of") == 0) {
+            of = argv[++i];
         } else {
             module = argv[i];
         }
     }
 
+    // query a binary dump, no analysis is run
+    if (load) {
+        if (!reaching) {
+            errs() << "Usage: % -load FILE -reaching NODE [-of VALUE]\n";
+            return 1;
+        }
+
+        return queryBinaryDump(load, reaching, of) ? 0 : 1;
+    }
+
     if (!module) {
-        errs() << "Usage: % IR_module [-pts fs|fi] [-dot] [-v] [output_file]\n";
+        errs() << "Usage: % IR_module [-pts fs|fi] [-dot] [-v] [-binary FILE] [-time-report] [-time-trace FILE] [output_file]\n";
         return 1;
     }
 
 #if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
     M = llvm::ParseIRFile(module, SMD, context);
 #else
-    auto _M = llvm::parseIRFile(module, SMD, context);
+    auto _M = dg::loadModule(module, SMD, context);
     // _M is unique pointer, we need to get Module *
     M = _M.get();
 #endif
@@ -304,28 +446,42 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    debug::TimeMeasure tm;
+    using analysis::Profiler;
+    std::unique_ptr<Profiler> profiler;
+    if (time_report || !time_trace.empty())
+        profiler.reset(new Profiler());
 
     LLVMPointerAnalysis PTA(M, field_senitivity);
 
-    tm.start();
+    {
+        Profiler::Scope phase("Points-to analysis");
+        if (type == FLOW_INSENSITIVE) {
+            PTA.run<pta::PointsToFlowInsensitive>();
+        } else {
+            PTA.run<pta::PointsToFlowSensitive>();
+        }
+    }
 
-    if (type == FLOW_INSENSITIVE) {
-        PTA.run<pta::PointsToFlowInsensitive>();
-    } else {
-        PTA.run<pta::PointsToFlowSensitive>();
+    LLVMReachingDefinitions RD(M, &PTA, rd_strong_update_unknown, max_set_size);
+    {
+        Profiler::Scope phase("Reaching definitions analysis");
+        RD.run();
     }
 
-    tm.stop();
-    tm.report("INFO: Points-to analysis took");
+    if (binary) {
+        FILE *file = fopen(binary, "wb");
+        if (!file || !dumpRDBinary(&RD, file)) {
+            errs() << "Failed writing the dump to " << binary << "\n";
+            if (file)
+                fclose(file);
+            return 1;
+        }
 
-    LLVMReachingDefinitions RD(M, &PTA, rd_strong_update_unknown, max_set_size);
-    tm.start();
-    RD.run();
-    tm.stop();
-    tm.report("INFO: Reaching definitions analysis took");
+        fclose(file);
+    } else
+        dumpRD(&RD, todot);
 
-    dumpRD(&RD, todot);
+    debug::reportProfile(profiler.get(), time_report, time_trace);
 
     return 0;
 }
@@ -0,0 +1,246 @@
+#ifndef HAVE_LLVM
+#error "This code needs LLVM enabled"
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/IRReader/IRReader.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "llvm/analysis/CallGraph.h"
+#include "llvm/analysis/FunctionSummaries.h"
+#include "llvm/analysis/ShardSummaries.h"
+#include "llvm/LoadModule.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "analysis/PointsTo/PointsToFlowInsensitive.h"
+
+///
+// Split the module into shards along the components of the call graph,
+// so that the shards can be analyzed separately (e.g. on more machines)
+// bottom-up: a shard is analyzed once the summaries of the shards
+// it calls are known. Without -pta the calls via pointers may call
+// any function whose address is taken.
+//
+// With -out-dir DIR, the shards are summarized (see LLVMShardSummaries)
+// one after another and the summaries of the shard N are written
+// into DIR/shard-N.summaries in the format of llvm-slicer -summaries.
+// A shard reads the summaries of the shards it calls from these files,
+// so with -shard N only the shard N is summarized (e.g. on other machine,
+// once the files of the shards below it were copied into DIR).
+// The summaries of undefined functions are loaded by -summaries FILE
+// and the points-to information of the module may be shared
+// by the runs with -pta-cache FILE.
+
+using namespace dg;
+using llvm::errs;
+using llvm::outs;
+
+static std::string shardFile(const std::string& dir, unsigned s)
+{
+    return dir + "/shard-" + std::to_string(s) + ".summaries";
+}
+
+// FNV-1a hash of the module file and of the summaries
+static uint64_t getCacheKey(const char *module, const FunctionSummaries *summaries)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t byte) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    };
+
+    auto buf = llvm::MemoryBuffer::getFile(module);
+    if (buf) {
+        for (char c : buf.get()->getBuffer())
+            mix(static_cast<unsigned char>(c));
+    }
+
+    uint64_t sum = summaries ? summaries->getHash() : 0;
+    for (unsigned i = 0; i < sizeof sum; ++i)
+        mix((sum >> (8 * i)) & 0xff);
+
+    return hash;
+}
+
+// summarize the shard @s, the summaries of the shards
+// that it calls are read from @dir
+static bool summarizeShard(LLVMPointerAnalysis *PTA,
+                           const std::vector<analysis::LLVMCallGraph::Shard>& shards,
+                           unsigned s, const std::string& dir)
+{
+    FunctionSummaries boundary;
+    for (unsigned c : shards[s].callees) {
+        std::string error;
+        if (!boundary.load(shardFile(dir, c), error))
+            errs() << "WARNING: " << error << ", the calls of the shard "
+                   << c << " are not summarized\n";
+    }
+
+    analysis::LLVMShardSummaries summaries(PTA, boundary);
+    summaries.compute(shards[s]);
+
+    std::ofstream out(shardFile(dir, s));
+    summaries.getSummaries().write(out);
+    if (!out.good()) {
+        errs() << "ERROR: Failed writing " << shardFile(dir, s) << "\n";
+        return false;
+    }
+
+    outs() << "shard " << s << ": summarized "
+           << summaries.getSummaries().size() << " of "
+           << shards[s].functions.size() << " functions\n";
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic SMD;
+    const char *module = nullptr;
+    uint64_t max_weight = 100000;
+    bool use_pta = false;
+    std::string out_dir, pta_cache;
+    std::vector<std::string> summaries_files;
+    long only_shard = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-max-weight") == 0 && i + 1 < argc) {
+            max_weight = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-pta") == 0) {
+            use_pta = true;
+        } else if (strcmp(argv[i], "-out-dir") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strcmp(argv[i], "-shard") == 0 && i + 1 < argc) {
+            only_shard = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-summaries") == 0 && i + 1 < argc) {
+            summaries_files.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "-pta-cache") == 0 && i + 1 < argc) {
+            pta_cache = argv[++i];
+        } else {
+            module = argv[i];
+        }
+    }
+
+    if (!module) {
+        errs() << "Usage: % [-max-weight INSTRUCTIONS] [-pta] [-out-dir DIR "
+                  "[-shard N]] [-summaries FILE] [-pta-cache FILE] IR_module\n";
+        return 1;
+    }
+
+    if (only_shard >= 0 && out_dir.empty()) {
+        errs() << "ERROR: -shard needs -out-dir\n";
+        return 1;
+    }
+
+    std::shared_ptr<FunctionSummaries> function_summaries;
+    if (!summaries_files.empty()) {
+        function_summaries = std::make_shared<FunctionSummaries>();
+        for (const std::string& file : summaries_files) {
+            std::string error;
+            if (!function_summaries->load(file, error)) {
+                errs() << "ERROR: " << error << "\n";
+                return 1;
+            }
+        }
+    }
+
+    // the summaries need the memory touched by the instructions
+    if (!out_dir.empty())
+        use_pta = true;
+
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
+    llvm::Module *M = llvm::ParseIRFile(module, SMD, context);
+#else
+    auto _M = dg::loadModule(module, SMD, context);
+    llvm::Module *M = _M.get();
+#endif
+
+    if (!M) {
+        errs() << "Failed parsing '" << module << "' file:\n";
+        SMD.print(argv[0], errs());
+        return 1;
+    }
+
+    std::unique_ptr<LLVMPointerAnalysis> PTA;
+    std::unique_ptr<analysis::LLVMCallGraph> ownCG;
+    analysis::LLVMCallGraph *CG;
+    if (use_pta) {
+        // resolve the calls via pointers with the flow-insensitive PTA
+        PTA.reset(new LLVMPointerAnalysis(M));
+        if (function_summaries)
+            PTA->getModuleInfo()->setFunctionSummaries(function_summaries);
+
+        uint64_t key = getCacheKey(module, function_summaries.get());
+        if (pta_cache.empty() || !PTA->loadResults(pta_cache, key)) {
+            PTA->run<analysis::pta::PointsToFlowInsensitive>();
+            if (!pta_cache.empty() && !PTA->saveResults(pta_cache, key))
+                errs() << "WARNING: Failed saving the points-to information to "
+                       << pta_cache << "\n";
+        }
+        CG = &PTA->getCallGraph();
+    } else {
+        ownCG.reset(new analysis::LLVMCallGraph(M));
+        ownCG->build();
+        CG = ownCG.get();
+    }
+
+    const auto& funcs = CG->getFunctions();
+    std::vector<analysis::LLVMCallGraph::Shard> shards = CG->partition(max_weight);
+    if (only_shard >= static_cast<long>(shards.size())) {
+        errs() << "ERROR: The module has only " << shards.size() << " shards\n";
+        return 1;
+    }
+
+    for (unsigned s = 0; s < shards.size(); ++s) {
+        const auto& shard = shards[s];
+        outs() << "shard " << s << ": " << shard.functions.size()
+               << " functions, " << shard.weight << " instructions, calls:";
+        if (shard.callees.empty())
+            outs() << " -";
+        for (unsigned c : shard.callees)
+            outs() << " " << c;
+        outs() << "\n";
+
+        for (unsigned i : shard.functions)
+            outs() << "  " << funcs[i]->getName() << "\n";
+    }
+
+    if (out_dir.empty())
+        return 0;
+
+    // the shards are in the bottom-up order,
+    // so the summaries of their callees are written before them
+    for (unsigned s = 0; s < shards.size(); ++s) {
+        if (only_shard >= 0 && static_cast<long>(s) != only_shard)
+            continue;
+
+        if (!summarizeShard(PTA.get(), shards, s, out_dir))
+            return 1;
+    }
+
+    return 0;
+}
@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <map>
 #include <set>
+#include <sstream>
 #include <string>
+#include <tuple>
 
 #include <cassert>
 #include <cstdlib>
@@ -36,6 +40,7 @@
 #if LLVM_VERSION_MAJOR >= 4
 #include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/Error.h>
 #else
 #include <llvm/Bitcode/ReaderWriter.h>
 #endif
@@ -44,12 +49,15 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Support/FormattedStream.h>
 #include <llvm/IRReader/IRReader.h>
 #include <llvm/Support/Signals.h>
 #include <llvm/Support/PrettyStackTrace.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Format.h>
 
 #if (__clang__)
 #pragma clang diagnostic pop // ignore -Wunused-parameter
@@ -58,20 +66,38 @@
 #endif
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "llvm/LLVMDependenceGraph.h"
 #include "llvm/Slicer.h"
 #include "llvm/LLVMDG2Dot.h"
+#include "llvm/LoadModule.h"
+#include "llvm/ControlDependenceCache.h"
+#include "llvm/SliceMask.h"
+#include "llvm/analysis/ModuleStatistics.h"
 #include "TimeMeasure.h"
 
 #include "llvm/analysis/DefUse.h"
 #include "llvm/analysis/PointsTo/PointsTo.h"
 #include "llvm/analysis/ReachingDefinitions/ReachingDefinitions.h"
+#include "llvm/analysis/ExecutedCode.h"
 
 #include "analysis/PointsTo/PointsToFlowInsensitive.h"
+#include "analysis/PointsTo/PointsToAndersen.h"
+#include "analysis/PointsTo/PointsToSteensgaard.h"
+#include "analysis/PointsTo/PointsToSparseFlowSensitive.h"
 #include "analysis/PointsTo/PointsToFlowSensitive.h"
 #include "analysis/PointsTo/Pointer.h"
+#include "analysis/FrozenGraph.h"
+#include "analysis/MemoryUsage.h"
+#include "ADT/TaggedAllocator.h"
 
 using namespace dg;
 using llvm::errs;
@@ -96,7 +122,15 @@ enum {
 };
 
 enum PtaType {
-    fs, fi
+    fs, fi, andersen, steens, sfs, tiered
+};
+
+enum class LinesFormat {
+    list, json
+};
+
+enum class DGDeps {
+    all, data, control
 };
 
 llvm::cl::OptionCategory SlicingOpts("Slicer options", "");
@@ -109,12 +143,25 @@ llvm::cl::opt<std::string> output("o",
 llvm::cl::opt<std::string> llvmfile(llvm::cl::Positional, llvm::cl::Required,
     llvm::cl::desc("<input file>"), llvm::cl::init(""), llvm::cl::cat(SlicingOpts));
 
-llvm::cl::opt<std::string> slicing_criterion("c", llvm::cl::Required,
+llvm::cl::list<std::string> link_inputs(llvm::cl::Positional, llvm::cl::ZeroOrMore,
+    llvm::cl::desc("[<input file>...]\n"
+                   "The other modules of the program. They are linked\n"
+                   "with the first one in memory (no llvm-link is needed)\n"
+                   "and the program is sliced as a whole. Every input\n"
+                   "gets its own sliced module, the modules of these\n"
+                   "inputs are saved with the .sliced suffix (-o names\n"
+                   "only the module of the first input)."),
+    llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> slicing_criterion("c",
     llvm::cl::desc("Slice with respect to the call-sites of a given function\n"
                    "i. e.: '-c foo' or '-c __assert_fail'. Special value is a 'ret'\n"
                    "in which case the slice is taken with respect to the return value\n"
-                   "of the main() function. You can use comma separated list of more\n"
-                   "function calls, e.g. -c foo,bar\n"), llvm::cl::value_desc("func"),
+                   "of the main() function. The criterion can be also a source\n"
+                   "location 'file:line[:col]' (needs debug information), then\n"
+                   "the slice is taken with respect to the instructions there.\n"
+                   "You can use comma separated list of more criteria,\n"
+                   "e.g. -c foo,bar,main.c:12\n"), llvm::cl::value_desc("func"),
                    llvm::cl::init(""), llvm::cl::cat(SlicingOpts));
 
 llvm::cl::opt<uint64_t> pta_field_sensitivie("pta-field-sensitive",
@@ -124,27 +171,319 @@ llvm::cl::opt<uint64_t> pta_field_sensitivie("pta-field-sensitive",
                    llvm::cl::value_desc("N"), llvm::cl::init(UNKNOWN_OFFSET),
                    llvm::cl::cat(SlicingOpts));
 
+llvm::cl::opt<unsigned> pta_offsets_budget("pta-offsets-budget",
+    llvm::cl::desc("Collapse a memory object to UNKNOWN_OFFSET when the pointers\n"
+                   "to it have more than N different offsets. Unlike\n"
+                   "-pta-field-sensitive, the other objects keep the precision.\n"
+                   "Default is 0 (no budget).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> pta_loop_widening("pta-loop-widening",
+    llvm::cl::desc("Widen the offsets only in the pointer arithmetic inside\n"
+                   "the loops of the functions (found by LLVM LoopInfo)\n"
+                   "instead of in all cycles of the pointer subgraph\n"
+                   "(default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> pta_widening_delay("pta-widening-delay",
+    llvm::cl::desc("Widen the offsets in the pointer arithmetic in loops\n"
+                   "only after it moved a pointer N times, so that the\n"
+                   "loops with a few iterations keep exact offsets.\n"
+                   "Default is 0 (widen from the start).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> pta_saturate_unknown("pta-saturate-unknown",
+    llvm::cl::desc("Keep only the unknown pointer in the points-to sets that\n"
+                   "contain it. Bounds the sets in the code with a lot\n"
+                   "of pointer arithmetic (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> pta_timeout("pta-timeout",
+    llvm::cl::desc("Stop the pointer analysis after N seconds and fall back\n"
+                   "to the flow-insensitive analysis (with the same budget),\n"
+                   "or let all pointers point to unknown memory if even that\n"
+                   "one does not finish. Default is 0 (no limit).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> pta_max_mem("pta-max-mem",
+    llvm::cl::desc("Like -pta-timeout, but the limit is N MB of memory\n"
+                   "used by the process. Default is 0 (no limit).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> progress_period("progress",
+    llvm::cl::desc("Report the progress of the pointer analysis and of the\n"
+                   "reaching definitions analysis every N seconds: the round,\n"
+                   "the size of the worklist, the sizes of the sets, the memory\n"
+                   "and the rates of change. Default is 0 (no reports).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> progress_file("progress-file",
+    llvm::cl::desc("Write the reports of -progress to FILE instead of stderr.\n"
+                   "The file contains only the last report.\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
 llvm::cl::opt<bool> rd_strong_update_unknown("rd-strong-update-unknown",
     llvm::cl::desc("Let reaching defintions analysis do strong updates on memory defined\n"
                    "with uknown offset in the case, that new definition overwrites\n"
                    "the whole memory. May be unsound for out-of-bound access\n"),
                    llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
 
+llvm::cl::opt<bool> rd_sparse("rd-sparse",
+    llvm::cl::desc("Keep the maps of reaching definitions only at definitions,\n"
+                   "joins and calls and share them with the other instructions.\n"
+                   "Saves memory on big modules.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> rd_coarse("rd-coarse",
+    llvm::cl::desc("Summarize runs of stores into one node of the reaching\n"
+                   "definitions graph. Makes the graph much smaller.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> rd_summaries("rd-summaries",
+    llvm::cl::desc("Apply the summaries of the definitions of the called\n"
+                   "functions at the calls, so that the definitions of one\n"
+                   "caller do not flow through the function to the others.\n"
+                   "Keeps the maps small behind commonly called functions.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> rd_promote_locals("rd-promote-locals",
+    llvm::cl::desc("Compute the definitions of the local variables whose\n"
+                   "address is not taken in their functions and leave\n"
+                   "them out of the reaching definitions graph (default=true).\n"),
+                   llvm::cl::init(true), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> all_threads("threads",
+    llvm::cl::desc("The number of threads of all the parallel phases\n"
+                   "(-dg-threads, -pta-threads, -rd-threads, -du-threads,\n"
+                   "-mark-threads and -slice-jobs) that are not given explicitly.\n"
+                   "The results are the same with any number of threads.\n"
+                   "Default is 1.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> rd_threads("rd-threads",
+    llvm::cl::desc("Solve the parts of the reaching definitions graph\n"
+                   "that do not depend on each other in parallel using\n"
+                   "N threads (default 1).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> du_threads("du-threads",
+    llvm::cl::desc("Add the def-use edges of the functions in parallel\n"
+                   "using N threads. The edges are added to the graph\n"
+                   "after all the functions are processed (default 1).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> du_release_rd("du-release-rd",
+    llvm::cl::desc("Add the def-use edges of the functions bottom-up by\n"
+                   "the components of the call graph and free the reaching\n"
+                   "definitions of every component once its edges are added.\n"
+                   "Lowers the peak memory on big modules. Not used with\n"
+                   "the annotations and the statistics that need them.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> dd_hubs("dd-hubs",
+    llvm::cl::desc("The loads with unknown reaching definitions depend on\n"
+                   "one artificial node for the memory written by at least\n"
+                   "N stores instead of on every store. The slices are the\n"
+                   "same, the graph has fewer edges. Such graph cannot be\n"
+                   "saved by -dg-cache (default 0 = off).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> rd_memory_ssa("rd-memory-ssa",
+    llvm::cl::desc("Compute reaching definitions on demand using memory SSA\n"
+                   "instead of keeping them for every instruction.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<uint32_t> rd_max_set_size("rd-max-set-size",
+    llvm::cl::desc("Make a memory location defined at unknown place once\n"
+                   "it has more than N reaching definitions (default unlimited).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(~((uint32_t) 0)),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<uint32_t> rd_max_growths("rd-max-growths",
+    llvm::cl::desc("Make a memory location defined at unknown place once\n"
+                   "its reaching definitions grew more than N times\n"
+                   "in the iterations of loops. Cuts only the sets that keep\n"
+                   "growing, unlike -rd-max-set-size. Default is 0 (never).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<uint32_t> rd_max_offsets("rd-max-offsets",
+    llvm::cl::desc("Once a memory object gets more than N definitions with\n"
+                   "different offsets in one place, keep its definitions\n"
+                   "as one definition with unknown offset. Keeps the fields\n"
+                   "of small structures precise and the big arrays cheap.\n"
+                   "Default is 0 (never).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> rd_timeout("rd-timeout",
+    llvm::cl::desc("After N seconds of the reaching definitions analysis,\n"
+                   "make the memory locations with more than one definition\n"
+                   "defined at unknown place. Default is 0 (no limit).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> rd_max_mem("rd-max-mem",
+    llvm::cl::desc("Like -rd-timeout, but the limit is N MB of memory\n"
+                   "used by the process. Default is 0 (no limit).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
 llvm::cl::opt<bool> undefined_are_pure("undefined-are-pure",
     llvm::cl::desc("Assume that undefined functions have no side-effects\n"),
                    llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
 
+llvm::cl::list<std::string> summaries_files("summaries",
+    llvm::cl::desc("Load the summaries of undefined functions (what memory\n"
+                   "passed to them they read and write and what pointer\n"
+                   "they return) from the file. The functions with a summary\n"
+                   "do not define and use all the memory passed to them.\n"
+                   "Can be given more times, the later files override\n"
+                   "the former. See FunctionSummaries.h for the format.\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::list<std::string> executed_files("executed",
+    llvm::cl::desc("Analyze only the code that was executed: the functions\n"
+                   "and blocks listed in the file (e.g. from the coverage\n"
+                   "data). The other code is made unreachable before the\n"
+                   "analyses, so the slice is valid only for the runs that\n"
+                   "execute the same code. Can be given more times.\n"
+                   "See ExecutedCode.h for the format.\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> auto_config("auto",
+    llvm::cl::desc("Choose the analyses by the statistics of the module\n"
+                   "(see auto_configure()): the precise ones for small\n"
+                   "modules, the scalable ones for large modules. The options\n"
+                   "that are given explicitly are kept (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
 llvm::cl::opt<PtaType> pta("pta",
     llvm::cl::desc("Choose pointer analysis to use:"),
     llvm::cl::values(
         clEnumVal(fi, "Flow-insensitive PTA (default)"),
-        clEnumVal(fs, "Flow-sensitive PTA")
+        clEnumVal(fs, "Flow-sensitive PTA"),
+        clEnumVal(andersen, "Inclusion-based (Andersen) flow-insensitive PTA"),
+        clEnumVal(steens, "Unification-based (Steensgaard) PTA, fast but imprecise"),
+        clEnumVal(sfs, "Sparse flow-sensitive PTA (the same results as fs)"),
+        clEnumVal(tiered, "Flow-insensitive PTA, flow-sensitive in the functions where it can help")
 #if LLVM_VERSION_MAJOR < 4
         , nullptr
 #endif
         ),
     llvm::cl::init(fi), llvm::cl::cat(SlicingOpts));
 
+llvm::cl::opt<analysis::pta::PTASchedule> pta_schedule("pta-schedule",
+    llvm::cl::desc("Choose how the pointer analysis schedules the nodes:"),
+    llvm::cl::values(
+        clEnumValN(analysis::pta::PTASchedule::ROUNDS, "rounds",
+                   "Re-process everything reachable from changed nodes (default)"),
+        clEnumValN(analysis::pta::PTASchedule::WORKLIST, "worklist",
+                   "Re-process only nodes whose inputs changed"),
+        clEnumValN(analysis::pta::PTASchedule::SCC, "scc",
+                   "Solve strongly connected components in topological order")
+#if LLVM_VERSION_MAJOR < 4
+        , nullptr
+#endif
+         ),
+    llvm::cl::init(analysis::pta::PTASchedule::ROUNDS), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> pta_demand("pta-demand",
+    llvm::cl::desc("Compute the points-to sets only for the values that are\n"
+                   "needed (only with -pta fi). When computing a set needs\n"
+                   "more than N nodes, the whole analysis is run instead.\n"
+                   "Default is 0 (compute everything up front).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> pta_threads("pta-threads",
+    llvm::cl::desc("Solve independent parts of the program in parallel using\n"
+                   "N threads (only with -pta fs/fi and -pta-schedule=scc).\n"
+                   "The results are the same as with one thread. Default is 1.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> pta_call_summaries("pta-call-summaries",
+    llvm::cl::desc("Give the calls of functions that return (pointers derived\n"
+                   "from) their arguments only the pointers from their own\n"
+                   "arguments instead of merging the values from all the calls.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> pta_heap_cloning("pta-heap-cloning",
+    llvm::cl::desc("Give every call of a function that returns memory allocated\n"
+                   "on heap (a malloc wrapper) its own copy of the allocation,\n"
+                   "for the wrappers nested up to K levels. Default is 0 (off).\n"),
+                   llvm::cl::value_desc("K"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<llvmutils::CallCompatibility> pta_callee_types("pta-callee-types",
+    llvm::cl::desc("Choose which functions may be called via a pointer:"),
+    llvm::cl::values(
+        clEnumValN(llvmutils::CallCompatibility::LOOSE, "loose",
+                   "The integers and pointers may be passed for each other (default)"),
+        clEnumValN(llvmutils::CallCompatibility::STRICT, "strict",
+                   "The types of the arguments and of the returned value must match,\n"
+                   "also for the calls via unknown pointers")
+#if LLVM_VERSION_MAJOR < 4
+        , nullptr
+#endif
+         ),
+    llvm::cl::init(llvmutils::CallCompatibility::LOOSE), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> pta_compact("pta-compact",
+    llvm::cl::desc("Simplify the pointer subgraph before the analysis: remove\n"
+                   "the casts and NOOP nodes, fold the GEPs of constant pointers\n"
+                   "and merge the equivalent GEPs.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> pta_share_sets("pta-share-sets",
+    llvm::cl::desc("After the pointer analysis, let the identical points-to sets\n"
+                   "share one copy of the data. Saves memory on big modules.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> pta_cache("pta-cache",
+    llvm::cl::desc("Load the results of the pointer analysis from the given file\n"
+                   "if it was created for the same module and PTA options,\n"
+                   "otherwise run the analysis and save the results there.\n"),
+                   llvm::cl::value_desc("filename"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> rd_cache("rd-cache",
+    llvm::cl::desc("Load the reaching definitions of the loads and calls from\n"
+                   "the given file if it was created for the same module and\n"
+                   "options, otherwise run the analysis and save them there.\n"
+                   "The loaded definitions are used without building the graph\n"
+                   "of reaching definitions.\n"),
+                   llvm::cl::value_desc("filename"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> pta_incremental("pta-incremental",
+    llvm::cl::desc("Start the pointer analysis from the solution saved in the given\n"
+                   "file for a previous revision of the module (the functions and\n"
+                   "globals that did not change keep their points-to sets) and save\n"
+                   "the new solution there. Does not work with -pta tiered.\n"),
+                   llvm::cl::value_desc("filename"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> dg_cache("dg-cache",
+    llvm::cl::desc("Load the edges of the dependence graph from the given file\n"
+                   "if it was created for the same module and options,\n"
+                   "otherwise compute them and save them there. The pointer\n"
+                   "and reaching definitions analyses do not run when the\n"
+                   "edges are loaded.\n"),
+                   llvm::cl::value_desc("filename"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
 llvm::cl::opt<CD_ALG> CdAlgorithm("cd-alg",
     llvm::cl::desc("Choose control dependencies algorithm to use:"),
     llvm::cl::values(
@@ -156,12 +495,264 @@ llvm::cl::opt<CD_ALG> CdAlgorithm("cd-alg",
          ),
     llvm::cl::init(CLASSIC), llvm::cl::cat(SlicingOpts));
 
+llvm::cl::opt<std::string> cd_cache("cd-cache",
+    llvm::cl::desc("Take the control dependencies of the functions from\n"
+                   "the given file and add the new ones there. The entries\n"
+                   "are keyed by the shape of the CFG of the function,\n"
+                   "so one file can be shared by the runs on different\n"
+                   "modules (e.g. that link the same libraries).\n"
+                   "Only with -cd-alg classic.\n"),
+                   llvm::cl::value_desc("filename"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> dg_threads("dg-threads",
+    llvm::cl::desc("Build the nodes and blocks of the functions in parallel\n"
+                   "using N threads. The call-sites are linked to the\n"
+                   "subgraphs sequentially afterwards. The built graph\n"
+                   "is verified using N threads, too. Default is 1.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<DGDeps> dg_deps("dg-deps",
+    llvm::cl::desc("The dependencies computed for the dependence graph,\n"
+                   "the slice follows only these:"),
+    llvm::cl::values(
+        clEnumValN(DGDeps::all, "all",
+                   "Data and control dependencies (default)"),
+        clEnumValN(DGDeps::data, "data",
+                   "Only data dependencies, no post-dominators"),
+        clEnumValN(DGDeps::control, "control",
+                   "Only control dependencies, no reaching definitions")
+#if LLVM_VERSION_MAJOR < 4
+        , nullptr
+#endif
+         ),
+    llvm::cl::init(DGDeps::all), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> dg_relevant_only("dg-relevant-only",
+    llvm::cl::desc("Build the dependence graph only for the functions from\n"
+                   "which the slicing criteria can be reached in the call\n"
+                   "graph. The other functions are kept in the slice as they\n"
+                   "are and their calls are summarized like undefined calls.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> separate_slices("separate-slices",
+    llvm::cl::desc("Create a separate slice for every slicing criterion from\n"
+                   "the list. The slices of all the criteria are marked in one\n"
+                   "walk of the graph and the slice of the N-th criterion\n"
+                   "(counted from 0) is saved into <output>.N\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> slice_jobs("slice-jobs",
+    llvm::cl::desc("Create up to N of the separate slices (-separate-slices,\n"
+                   "-criteria-file) at once. Every slice is created and saved\n"
+                   "in a process with its own copy of the module, so N bounds\n"
+                   "the number of the copies in memory. Default is 1.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> criteria_file("criteria-file",
+    llvm::cl::desc("Read sets of slicing criteria from the file, one set per line\n"
+                   "in the format of the -c option (e.g. 'foo,bar' or '-c foo,bar').\n"
+                   "The analyses run only once and the slice with respect to\n"
+                   "the N-th set (counted from 0) is saved into <output>.N\n"
+                   "like with -separate-slices. Empty lines and lines starting\n"
+                   "with '#' are skipped. Can be used instead of -c\n"),
+                   llvm::cl::value_desc("file"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> freeze_dg("freeze-dg",
+    llvm::cl::desc("Pack the edges of the dependence graph into flat arrays\n"
+                   "before marking the slice. Speeds up the slicing with\n"
+                   "respect to many criteria on big graphs.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> lazy_rev_edges("lazy-rev-edges",
+    llvm::cl::desc("Store only the forward dependence edges while building\n"
+                   "the graph and build the reverse edges at once when the\n"
+                   "slicing needs them (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> lazy_cd("lazy-cd",
+    llvm::cl::desc("Compute the control dependencies of a function only when\n"
+                   "the slice gets into the function (default=true).\n"
+                   "The whole graph is computed anyway when it is saved\n"
+                   "(-dg-cache), annotated or dumped.\n"),
+                   llvm::cl::init(true), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> lazy_dd("lazy-dd",
+    llvm::cl::desc("Add the def-use edges of a function only when the slice\n"
+                   "gets into the function (default=false). The pointer and\n"
+                   "reaching definitions analyses are kept until the slice\n"
+                   "is marked. Not used with the forward slices and chops\n"
+                   "and when the whole graph is needed (-dg-cache,\n"
+                   "-freeze-dg, annotations, dumps).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> cs_slicing("cs-slicing",
+    llvm::cl::desc("Slice context-sensitively using the summary edges of\n"
+                   "call-sites (Horwitz, Reps and Binkley). A function in the\n"
+                   "slice keeps only the call-sites from which the criteria\n"
+                   "are reachable, so the slices are smaller (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> forward_slice("forward",
+    llvm::cl::desc("Compute the forward slice of the criteria: keep the\n"
+                   "instructions that depend on the criteria (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> thin_slice("thin",
+    llvm::cl::desc("Compute the thin slice of the criteria: do not follow\n"
+                   "the dependencies that only compute the address of the\n"
+                   "memory that is loaded or stored (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> thin_expand("thin-expand",
+    llvm::cl::desc("With -thin, expand the skipped address dependencies\n"
+                   "this many times (default=0).\n"),
+                   llvm::cl::init(0), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> chop_source("chop-source",
+    llvm::cl::desc("Compute the chop between the call-sites of the given\n"
+                   "functions (the sources) and the slicing criteria (the\n"
+                   "sinks): keep the instructions that depend on some of\n"
+                   "the sources and some of the sinks depend on them.\n"
+                   "You can use comma separated list of more functions.\n"),
+                   llvm::cl::value_desc("func"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> mark_threads("mark-threads",
+    llvm::cl::desc("Mark the slice using N threads. Works only together\n"
+                   "with -freeze-dg. Default is 1.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(1),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> lazy_load("lazy-load",
+    llvm::cl::desc("Load the bodies of functions lazily and only for\n"
+                   "the functions reachable from main, the unreachable\n"
+                   "functions are removed without loading (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> lazy_prefetch("lazy-prefetch",
+    llvm::cl::desc("With -lazy-load, read at most N MB of the bitcode ahead\n"
+                   "on a helper thread while the functions are loaded,\n"
+                   "0 turns it off (default=64).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(64),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> source_lines("source-lines",
+    llvm::cl::desc("Save the sorted source locations (file, line, column)\n"
+                   "of the instructions in the slice to FILE. They are taken\n"
+                   "from the marked dependence graph, so the sliced module\n"
+                   "does not need to be read again.\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<LinesFormat> source_lines_format("source-lines-format",
+    llvm::cl::desc("The format of -source-lines:"),
+    llvm::cl::values(
+        clEnumValN(LinesFormat::list, "list",
+                   "One file:line:column per line (default)"),
+        clEnumValN(LinesFormat::json, "json",
+                   "JSON array of {file, line, column} objects")
+#if LLVM_VERSION_MAJOR < 4
+        , nullptr
+#endif
+         ),
+    llvm::cl::init(LinesFormat::list), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> slice_mask("slice-mask",
+    llvm::cl::desc("Save the instructions in the slice (per function)\n"
+                   "with the hash of the module to FILE and exit without\n"
+                   "slicing and saving the module. The sliced module can be\n"
+                   "created later by -apply-slice-mask.\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<SliceMask::Format> slice_mask_format("slice-mask-format",
+    llvm::cl::desc("The format of -slice-mask:"),
+    llvm::cl::values(
+        clEnumValN(SliceMask::Format::BITMAP, "bitmap",
+                   "The bitmap of the instructions (default)"),
+        clEnumValN(SliceMask::Format::RANGES, "ranges",
+                   "The intervals of the indices of the instructions")
+#if LLVM_VERSION_MAJOR < 4
+        , nullptr
+#endif
+         ),
+    llvm::cl::init(SliceMask::Format::BITMAP), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> apply_slice_mask("apply-slice-mask",
+    llvm::cl::desc("Slice the module according to the mask from FILE saved\n"
+                   "by -slice-mask (for the same module and options).\n"
+                   "The dependencies are not computed and no slicing\n"
+                   "criterion is needed.\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> server("server",
+    llvm::cl::desc("Build the dependence graph once and answer the slicing\n"
+                   "requests from the standard input, one per line:\n"
+                   "'slice CRITERIA FILE' saves the slice to FILE,\n"
+                   "'lines CRITERIA' prints the source locations in the slice\n"
+                   "and 'quit' exits. Every request is answered by a line\n"
+                   "starting with OK or ERROR (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> time_report("time-report",
+    llvm::cl::desc("Print the tree of the phases of slicing with their\n"
+                   "wall and CPU time, the growth of the peak RSS\n"
+                   "and the counters of the analyses (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> time_trace("time-trace",
+    llvm::cl::desc("Save the phases of slicing to FILE in the Chrome\n"
+                   "trace format (see chrome://tracing).\n"),
+                   llvm::cl::value_desc("FILE"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> slice_report("slice-report",
+    llvm::cl::desc("Report which dependencies brought the most nodes\n"
+                   "into the slice: the kinds of the edges, the functions\n"
+                   "and the nodes from which the most nodes were reached.\n"
+                   "Only for the backward slices that are not thin\n"
+                   "or context-sensitive (default=false).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> dump_dg_hops("dump-dg-hops",
+    llvm::cl::desc("Dump only the nodes of the dependence graph that are\n"
+                   "at most N edges from the slicing criteria, 0 dumps\n"
+                   "the whole graph (default=0).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> dump_dg_max_nodes("dump-dg-max-nodes",
+    llvm::cl::desc("Dump at most N nodes of the dependence graph,\n"
+                   "0 means no limit (default=0).\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> dump_dg_func("dump-dg-func",
+    llvm::cl::desc("Dump only the graphs of these functions.\n"),
+                   llvm::cl::value_desc("func1,func2,..."), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+// the summaries loaded from -summaries
+static std::shared_ptr<FunctionSummaries> function_summaries;
 
 class CommentDBG : public llvm::AssemblyAnnotationWriter
 {
+    LLVMDependenceGraph *dg;
     LLVMReachingDefinitions *RD;
     uint32_t opts;
 
+    // the graph of the function of @B (the graphs of the module
+    // are indexed by the functions), nullptr if it was not built
+    LLVMDependenceGraph *getGraph(const llvm::BasicBlock *B) const
+    {
+        return dg->getGraph(const_cast<llvm::Function *>(B->getParent()));
+    }
+
     void printValue(const llvm::Value *val,
                     llvm::formatted_raw_ostream& os,
                     bool nl = false)
@@ -344,9 +935,9 @@ class CommentDBG : public llvm::AssemblyAnnotationWriter
     }
 
 public:
-    CommentDBG(uint32_t o = ANNOTATE_DD,
+    CommentDBG(LLVMDependenceGraph *dg, uint32_t o = ANNOTATE_DD,
                LLVMReachingDefinitions *rd = nullptr)
-        :RD(rd), opts(o) {}
+        :dg(dg), RD(rd), opts(o) {}
 
     virtual void emitFunctionAnnot (const llvm::Function *,
                                     llvm::formatted_raw_ostream &os)
@@ -359,13 +950,35 @@ public:
             os << "; -- Generated by llvm-slicer --\n"
                << ";   * slicing criterion: '" << slicing_criterion << "'\n"
                << ";   * undefined are pure: '" << undefined_are_pure << "'\n"
+               << ";   * function summaries: '"
+               << (function_summaries ? function_summaries->size() : 0) << "'\n"
                << ";   * pointer analysis: ";
             if (pta == fi)
                 os << "flow-insensitive\n";
             else if (pta == fs)
                 os << "flow-sensitive\n";
+            else if (pta == andersen)
+                os << "Andersen\n";
+            else if (pta == steens)
+                os << "Steensgaard\n";
+            else if (pta == sfs)
+                os << "sparse flow-sensitive\n";
+            else if (pta == tiered)
+                os << "flow-insensitive, flow-sensitive in selected functions\n";
 
             os << ";   * PTA field sensitivity: " << pta_field_sensitivie << "\n";
+            if (pta_offsets_budget > 0)
+                os << ";   * PTA offsets budget: " << pta_offsets_budget << "\n";
+            if (pta_saturate_unknown)
+                os << ";   * PTA saturate unknown\n";
+            if (pta_loop_widening)
+                os << ";   * PTA loop widening\n";
+            if (pta_widening_delay > 0)
+                os << ";   * PTA widening delay: " << pta_widening_delay << "\n";
+            if (pta_call_summaries)
+                os << ";   * PTA call summaries\n";
+            if (pta_heap_cloning > 0)
+                os << ";   * PTA heap cloning: " << pta_heap_cloning << "\n";
 
             os << "\n";
         }
@@ -377,14 +990,11 @@ public:
         if (opts == 0)
             return;
 
-        LLVMNode *node = nullptr;
-        for (auto& it : getConstructedFunctions()) {
-            LLVMDependenceGraph *sub = it.second;
-            node = sub->getNode(const_cast<llvm::Instruction *>(I));
-            if (node)
-                break;
-        }
+        LLVMDependenceGraph *sub = getGraph(I->getParent());
+        if (!sub)
+            return;
 
+        LLVMNode *node = sub->getNode(const_cast<llvm::Instruction *>(I));
         if (!node)
             return;
 
@@ -397,49 +1007,128 @@ public:
         if (opts == 0)
             return;
 
-        for (auto& it : getConstructedFunctions()) {
-            LLVMDependenceGraph *sub = it.second;
-            auto& cb = sub->getBlocks();
-            auto I = cb.find(const_cast<llvm::BasicBlock *>(B));
-            if (I != cb.end()) {
-                LLVMBBlock *BB = I->second;
-                if (opts & (ANNOTATE_POSTDOM | ANNOTATE_CD))
-                    os << "  ; BB: " << BB << "\n";
-
-                if (opts & ANNOTATE_POSTDOM) {
-                    for (LLVMBBlock *p : BB->getPostDomFrontiers())
-                        os << "  ; PDF: " << p << "\n";
-
-                    LLVMBBlock *P = BB->getIPostDom();
-                    if (P && P->getKey())
-                        os << "  ; iPD: " << P << "\n";
-                }
+        LLVMDependenceGraph *sub = getGraph(B);
+        if (!sub)
+            return;
 
-                if (opts & ANNOTATE_CD) {
-                    for (LLVMBBlock *p : BB->controlDependence())
-                        os << "  ; CD: " << p << "\n";
-                }
-            }
+        auto& cb = sub->getBlocks();
+        auto I = cb.find(const_cast<llvm::BasicBlock *>(B));
+        if (I == cb.end())
+            return;
+
+        LLVMBBlock *BB = I->second;
+        if (opts & (ANNOTATE_POSTDOM | ANNOTATE_CD))
+            os << "  ; BB: " << BB << "\n";
+
+        if (opts & ANNOTATE_POSTDOM) {
+            for (LLVMBBlock *p : BB->getPostDomFrontiers())
+                os << "  ; PDF: " << p << "\n";
+
+            LLVMBBlock *P = BB->getIPostDom();
+            if (P && P->getKey())
+                os << "  ; iPD: " << P << "\n";
+        }
+
+        if (opts & ANNOTATE_CD) {
+            for (LLVMBBlock *p : BB->controlDependence())
+                os << "  ; CD: " << p << "\n";
         }
     }
 };
 
-static void annotate(llvm::Module *M, uint32_t opts,
+static void annotate(llvm::Module *M, LLVMDependenceGraph *dg, uint32_t opts,
                      LLVMReachingDefinitions *rd = nullptr)
 {
     // compose name
     std::string fl(llvmfile);
     fl.replace(fl.end() - 3, fl.end(), "-debug.ll");
 
-    // open stream to write to
-    std::ofstream ofs(fl);
-    llvm::raw_os_ostream outputstream(ofs);
+    // write to the file directly, without going through std::ofstream
+    std::error_code ec;
+#if LLVM_VERSION_MAJOR >= 9
+    llvm::raw_fd_ostream outputstream(fl, ec, llvm::sys::fs::OF_None);
+#else
+    llvm::raw_fd_ostream outputstream(fl, ec, llvm::sys::fs::F_None);
+#endif
+    if (ec) {
+        errs() << "WARNING: Cannot open " << fl << ": " << ec.message() << "\n";
+        return;
+    }
 
     errs() << "INFO: Saving IR with annotations to " << fl << "\n";
-    llvm::AssemblyAnnotationWriter *annot = new CommentDBG(opts, rd);
-    M->print(outputstream, annot);
+    CommentDBG annot(dg, opts, rd);
+    M->print(outputstream, &annot);
+}
+
+// the location of an instruction in the source code
+struct SourceLocation {
+    std::string file;
+    unsigned line;
+    unsigned column;
+
+    bool operator<(const SourceLocation& oth) const
+    {
+        return std::tie(file, line, column)
+                < std::tie(oth.file, oth.line, oth.column);
+    }
+};
+
+static bool getSourceLocation(const llvm::Instruction *I, SourceLocation& loc)
+{
+    const llvm::DebugLoc& Loc = I->getDebugLoc();
+#if ((LLVM_VERSION_MAJOR > 3)\
+      || ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR > 6)))
+    if (!Loc)
+        return false;
+
+    loc.file = Loc->getFilename().str();
+#else
+    if (Loc.getLine() == 0)
+        return false;
+
+    // the file is not easily available in these versions
+    loc.file.clear();
+#endif
+    loc.line = Loc.getLine();
+    loc.column = Loc.getCol();
+    return true;
+}
+
+static void writeJSONString(std::ostream& os, const std::string& str)
+{
+    os << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+               << static_cast<unsigned>(c) << std::dec;
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+static void writeSourceLocations(std::ostream& os,
+                                 const std::set<SourceLocation>& locs,
+                                 LinesFormat format)
+{
+    if (format == LinesFormat::list) {
+        for (const SourceLocation& loc : locs)
+            os << loc.file << ":" << loc.line << ":" << loc.column << "\n";
+        return;
+    }
 
-    delete annot;
+    os << "[";
+    bool first = true;
+    for (const SourceLocation& loc : locs) {
+        os << (first ? "\n" : ",\n") << "  {\"file\": ";
+        writeJSONString(os, loc.file);
+        os << ", \"line\": " << loc.line
+           << ", \"column\": " << loc.column << "}";
+        first = false;
+    }
+    os << "\n]\n";
 }
 
 static bool createEmptyMain(llvm::Module *M)
@@ -466,6 +1155,18 @@ static bool createEmptyMain(llvm::Module *M)
     return true;
 }
 
+// we do not want to remove any assumptions about the code,
+// these calls are always slicing criteria
+// FIXME: make it configurable and add control dependencies
+// for these functions, so that we slice away the
+// unneeded one
+static const char *assumption_calls[] = {
+    "__VERIFIER_assume",
+    "__VERIFIER_exit",
+    "klee_assume",
+    NULL // termination
+};
+
 static std::vector<std::string> splitList(const std::string& opt)
 {
     std::vector<std::string> ret;
@@ -489,6 +1190,215 @@ static std::vector<std::string> splitList(const std::string& opt)
     return ret;
 }
 
+// get the nodes of the criteria: the exit of main for 'ret',
+// the instructions at the source locations 'file:line[:col]'
+// and the call-sites of the other names
+static bool getCriteriaNodes(LLVMDependenceGraph& dg,
+                             const std::vector<std::string>& criteria,
+                             std::set<LLVMNode *> *nodes)
+{
+    std::vector<std::string> names, locations;
+    for (const auto& c : criteria) {
+        std::string file;
+        unsigned line, col;
+        if (c == "ret")
+            nodes->insert(dg.getExit());
+        else if (LLVMDependenceGraph::parseLocation(c, file, line, col))
+            locations.push_back(c);
+        else
+            names.push_back(c);
+    }
+
+    if (!names.empty())
+        dg.getCallSites(names, nodes);
+    if (!locations.empty())
+        dg.getLocationNodes(locations, nodes);
+
+    return !nodes->empty();
+}
+
+// get the sets of slicing criteria that are sliced separately,
+// the lines of -criteria-file or every criterion of -c alone
+static bool getCriteriaSets(std::vector<std::vector<std::string>>& sets)
+{
+    if (criteria_file.empty()) {
+        for (const auto& c : splitList(slicing_criterion))
+            sets.push_back({c});
+        return true;
+    }
+
+    std::ifstream ifs(criteria_file);
+    if (!ifs.is_open()) {
+        errs() << "ERROR: Cannot open the criteria file "
+               << criteria_file << "\n";
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t b = line.find_first_not_of(" \t\r");
+        if (b == std::string::npos || line[b] == '#')
+            continue;
+
+        line = line.substr(b, line.find_last_not_of(" \t\r") - b + 1);
+        // allow the lines to be written like the option
+        if (line.compare(0, 2, "-c") == 0) {
+            b = line.find_first_not_of(" \t=", 2);
+            line.erase(0, b == std::string::npos ? line.size() : b);
+        }
+
+        sets.push_back(splitList(line));
+    }
+
+    return true;
+}
+
+static void print_memory_usage(const char *name, const analysis::MemoryUsage& mu)
+{
+    if (mu.entries.empty())
+        return;
+
+    errs() << "  " << name << ": "
+           << llvm::format("%.2f", mu.getBytes() / (1024.0 * 1024.0)) << " MB\n";
+    for (const auto& e : mu.entries) {
+        errs() << "    " << llvm::format("%-16s", e.name.c_str())
+               << llvm::format("%12lu", e.count)
+               << llvm::format("%12.2f", e.bytes / (1024.0 * 1024.0)) << " MB\n";
+    }
+}
+
+// the allocations counted by the tagged allocators since -statistics
+// switched the counting on, by the subsystems that made them
+static void print_allocation_stats()
+{
+    using ADT::AllocTag;
+    using ADT::AllocationStats;
+
+    if (!AllocationStats::isEnabled())
+        return;
+
+    errs() << "  allocations:         allocs       frees    total MB     live MB     peak MB\n";
+    for (unsigned i = 0; i < static_cast<unsigned>(AllocTag::TAGS_NUM); ++i) {
+        AllocTag tag = static_cast<AllocTag>(i);
+        const AllocationStats::Counters& c = AllocationStats::get(tag);
+        errs() << "    " << llvm::format("%-16s", AllocationStats::getName(tag))
+               << llvm::format("%12lu", static_cast<uint64_t>(c.allocations))
+               << llvm::format("%12lu", static_cast<uint64_t>(c.frees))
+               << llvm::format("%12.2f", c.bytes / (1024.0 * 1024.0))
+               << llvm::format("%12.2f", c.live / (1024.0 * 1024.0))
+               << llvm::format("%12.2f", c.peak / (1024.0 * 1024.0)) << "\n";
+    }
+}
+
+
+static std::string getFunctionName(LLVMNode *n)
+{
+    LLVMDependenceGraph *graph = n->getDG();
+    if (!graph || !graph->getEntry())
+        return "<globals>";
+
+    return graph->getEntry()->getKey()->getName().str();
+}
+
+// print which edges, functions and nodes the slice grew from.
+// The parent of a node precedes it in @parents, so the numbers of the nodes
+// reached from a node (transitively) are summed in one pass backwards
+static void print_slice_report(const analysis::WalkParents<LLVMNode>& parents,
+                               unsigned top = 10)
+{
+    using ParentsT = analysis::WalkParents<LLVMNode>;
+    enum { START, CD, DD, ENTRY, CALL, CFG, KINDS_NUM };
+    static const char *kind_names[] = { "criteria", "control", "data",
+                                        "function entry", "call -> entry",
+                                        "cfg" };
+
+    size_t size = parents.size();
+    uint64_t kinds[KINDS_NUM] = {0};
+    std::map<std::string, uint64_t> functions;
+    std::vector<uint64_t> direct(size, 0);
+    std::vector<uint64_t> reached(size, 1);
+
+    for (size_t i = 0; i < size; ++i) {
+        LLVMNode *n = parents.nodes[i];
+        uint32_t p = parents.parents[i];
+        unsigned kind = START;
+        switch (parents.kinds[i]) {
+            case ParentsT::CD:
+                kind = CD;
+                // the call-sites are reached from the entries
+                // of the called functions
+                if (p != ParentsT::NONE
+                    && parents.nodes[p]->getDG() != n->getDG()
+                    && parents.nodes[p]->getDG()
+                    && parents.nodes[p] == parents.nodes[p]->getDG()->getEntry())
+                    kind = CALL;
+                break;
+            case ParentsT::DD: kind = DD; break;
+            case ParentsT::ENTRY: kind = ENTRY; break;
+            case ParentsT::CFG: kind = CFG; break;
+        }
+
+        ++kinds[kind];
+        ++functions[getFunctionName(n)];
+        if (p != ParentsT::NONE)
+            ++direct[p];
+    }
+
+    for (size_t i = size; i > 0; --i) {
+        uint32_t p = parents.parents[i - 1];
+        if (p != ParentsT::NONE)
+            reached[p] += reached[i - 1];
+    }
+
+    errs() << "INFO: The slice has " << size << " nodes, reached over:\n";
+    for (unsigned k = 0; k < KINDS_NUM; ++k) {
+        if (kinds[k] > 0)
+            errs() << "  " << llvm::format("%-16s", kind_names[k])
+                   << llvm::format("%12lu", kinds[k]) << "\n";
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> funs;
+    for (const auto& it : functions)
+        funs.emplace_back(it.second, it.first);
+    std::sort(funs.begin(), funs.end(),
+              [](const std::pair<uint64_t, std::string>& a,
+                 const std::pair<uint64_t, std::string>& b) {
+                  return a.first > b.first;
+              });
+    if (funs.size() > top)
+        funs.resize(top);
+
+    errs() << "INFO: The functions with the most nodes in the slice:\n";
+    for (const auto& f : funs)
+        errs() << "  " << llvm::format("%12lu", f.first) << "  " << f.second << "\n";
+
+    // the nodes that the walk spread from the most, e.g. the loads
+    // of unknown memory that depend on all the stores
+    std::vector<uint32_t> nodes;
+    for (size_t i = 0; i < size; ++i) {
+        if (direct[i] > 0)
+            nodes.push_back(i);
+    }
+    std::sort(nodes.begin(), nodes.end(), [&direct](uint32_t a, uint32_t b) {
+        return direct[a] > direct[b] || (direct[a] == direct[b] && a < b);
+    });
+    if (nodes.size() > top)
+        nodes.resize(top);
+
+    errs() << "INFO: The nodes that the most nodes were reached from"
+              " (directly, transitively):\n";
+    for (uint32_t i : nodes) {
+        errs() << "  " << llvm::format("%8lu", direct[i])
+               << llvm::format("%10lu", reached[i]) << "  "
+               << getFunctionName(parents.nodes[i]) << ":";
+        const llvm::Value *val = parents.nodes[i]->getKey();
+        if (llvm::isa<llvm::Function>(val))
+            errs() << " <entry>";
+        else
+            val->print(errs());
+        errs() << "\n";
+    }
+}
 
 /// --------------------------------------------------------------------
 //   - Slicer class -
@@ -506,6 +1416,20 @@ protected:
     std::unique_ptr<LLVMReachingDefinitions> RD;
     LLVMDependenceGraph dg;
     LLVMSlicer slicer;
+    analysis::FrozenGraph<LLVMNode> frozen;
+    // the edges of dg were loaded from -dg-cache
+    bool dg_loaded = false;
+    // the edges of dg were computed
+    bool edges_computed = false;
+    // do not free PTA and RD when the edges are computed
+    bool keep_analyses = false;
+    // the def-use edges are added on demand by the walks
+    // of the slicer, so PTA and RD must be kept
+    bool lazy_data_deps = false;
+    // the control dependencies shared with other runs (-cd-cache)
+    std::shared_ptr<ControlDependenceCache> cdCache;
+    // identifies the format of the entries in -cd-cache
+    static const uint64_t CD_CACHE_KEY = 1;
 
     virtual void computeEdges()
     {
@@ -513,35 +1437,183 @@ protected:
         assert(PTA && "BUG: No PTA");
         assert(RD && "BUG: No RD");
 
-        tm.start();
-        RD->run();
-        tm.stop();
-        tm.report("INFO: Reaching defs analysis took");
+        // the other functions than those in the slice
+        // do not need the control dependencies
+        bool lazy = lazy_cd && dg_cache.empty() && !(opts & ANNOTATE);
+
+        if (!cd_cache.empty() && dg.getBuildOptions().controlDependencies) {
+            if (CdAlgorithm != CLASSIC) {
+                errs() << "WARNING: -cd-cache works only with -cd-alg classic, "
+                          "ignoring\n";
+            } else {
+                cdCache = std::make_shared<ControlDependenceCache>();
+                cdCache->load(cd_cache, CD_CACHE_KEY);
+                dg.setControlDependenceCache(cdCache);
+            }
+        }
+
+        // the control dependencies (post-dominator frontiers) use only
+        // the blocks of the graph, so they are computed in another thread
+        // while the analyses of memory run
+        dg.computeControlDependenciesAsync(CdAlgorithm, lazy);
+
+        if (dg.getBuildOptions().dataDependencies)
+            computeDataDependencies();
 
-        LLVMDefUseAnalysis DUA(&dg, RD.get(),
-                               PTA.get(), undefined_are_pure);
         tm.start();
-        DUA.run(); // add def-use edges according that
+        {
+            analysis::Profiler::Scope phase("Waiting for control dependencies");
+            dg.waitControlDependencies();
+        }
         tm.stop();
-        tm.report("INFO: Adding Def-Use edges took");
+        tm.report("INFO: Waiting for control dependencies took");
+    }
+
+    // run the reaching definitions analysis and add the def-use edges
+    // (or let the graph add them on demand)
+    void computeDataDependencies()
+    {
+        // only the backward walks add the edges on demand
+        lazy_data_deps = lazy_dd && dg_cache.empty() && !(opts & ANNOTATE)
+                         && !freeze_dg && !forward_slice
+                         && chop_source.empty();
+
+        uint64_t cache_key = 0;
+        if (!rd_cache.empty()) {
+            cache_key = getRDCacheKey();
+            if (RD->loadResults(rd_cache, cache_key)) {
+                errs() << "INFO: loaded reaching definitions from "
+                       << rd_cache << "\n";
+                addDataDependencies();
+                return;
+            }
 
+            // the definitions are recorded only when all
+            // the def-use edges are added at once
+            RD->recordResults(!lazy_data_deps);
+        }
+
+        debug::TimeMeasure tm;
         tm.start();
-        // add post-dominator frontiers
-        dg.computeControlDependencies(CdAlgorithm);
+        {
+            analysis::Profiler::Scope phase("Reaching definitions analysis");
+            RD->setSparse(rd_sparse);
+            RD->setCoarse(rd_coarse);
+            RD->setSummaries(rd_summaries);
+            RD->setPromoteLocals(rd_promote_locals);
+            RD->setThreads(rd_threads);
+            RD->setMaxGrowths(rd_max_growths);
+            RD->setMaxOffsets(rd_max_offsets);
+            RD->setBudget(analysis::Budget(rd_timeout * 1000ULL,
+                                           rd_max_mem * 1024ULL * 1024ULL));
+            RD->setProgress(analysis::Progress(progress_period * 1000ULL,
+                                               progress_file));
+            RD->setMemorySSA(rd_memory_ssa);
+            RD->run();
+        }
         tm.stop();
-        tm.report("INFO: Computing control dependencies took");
+        tm.report("INFO: Reaching defs analysis took");
+
+        if (RD->isBudgetExceeded())
+            errs() << "WARNING: reaching definitions analysis exceeded "
+                      "its budget, the results are imprecise\n";
+
+        addDataDependencies();
+
+        // do not cache the imprecise results
+        using Degradation = LLVMPointerAnalysis::Degradation;
+        if (RD->isRecordingResults() && !RD->isBudgetExceeded()
+            && PTA->getDegradation() == Degradation::NONE
+            && !RD->saveResults(rd_cache, cache_key))
+            errs() << "WARNING: failed saving reaching definitions to "
+                   << rd_cache << "\n";
+    }
+
+    // add the def-use edges (or let the graph add them on demand)
+    void addDataDependencies()
+    {
+        if (lazy_data_deps) {
+            auto lazyDUA = std::make_shared<LLVMDefUseAnalysis>(
+                                &dg, RD.get(), PTA.get(), undefined_are_pure);
+            lazyDUA->setMemoryHubs(dd_hubs);
+            dg.setLazyDataDependencies(lazyDUA);
+        } else
+            addDefUseEdges();
+    }
+
+    void addDefUseEdges()
+    {
+        debug::TimeMeasure tm;
+        LLVMDefUseAnalysis DUA(&dg, RD.get(),
+                               PTA.get(), undefined_are_pure);
+        DUA.setThreads(du_threads);
+        DUA.setMemoryHubs(dd_hubs);
+        // the annotations and the statistics query RD afterwards
+        DUA.setReleaseDefinitions(du_release_rd && !keep_analyses
+                                  && !(opts & ANNOTATE));
+        tm.start();
+        {
+            analysis::Profiler::Scope phase("Adding def-use edges");
+            DUA.run(); // add def-use edges according that
+        }
+        tm.stop();
+        tm.report("INFO: Adding Def-Use edges took");
     }
 
 public:
     Slicer(llvm::Module *mod, uint32_t o)
     :M(mod), opts(o),
-     PTA(new LLVMPointerAnalysis(mod, pta_field_sensitivie)),
+     PTA(new LLVMPointerAnalysis(mod, pta_field_sensitivie, pta_schedule)),
       RD(new LLVMReachingDefinitions(mod, PTA.get(),
-                                     rd_strong_update_unknown, undefined_are_pure)) {
+                                     rd_strong_update_unknown, undefined_are_pure,
+                                     rd_max_set_size)) {
         assert(mod && "Need module");
+        // the builders of PTA and RD share the module info
+        if (function_summaries)
+            PTA->getModuleInfo()->setFunctionSummaries(function_summaries);
+    }
+
+    // the control dependencies may be computed lazily until
+    // the end, so the cache is saved when the slicer is done
+    ~Slicer()
+    {
+        if (!cdCache)
+            return;
+
+        errs() << "INFO: took control dependencies of " << cdCache->getHits()
+               << " functions from " << cd_cache << "\n";
+        if (!cdCache->save(cd_cache, CD_CACHE_KEY))
+            errs() << "WARNING: failed saving control dependencies to "
+                   << cd_cache << "\n";
     }
     const LLVMDependenceGraph& getDG() const { return dg; }
     LLVMDependenceGraph& getDG() { return dg; }
+    // PTA and RD are freed when the edges of the graph are computed,
+    // nullptr after that unless keepAnalyses() was called
+    LLVMPointerAnalysis *getPTA() { return PTA.get(); }
+    LLVMReachingDefinitions *getRD() { return RD.get(); }
+    void keepAnalyses() { keep_analyses = true; }
+
+    // print the approximate memory used by the graph and the analyses
+    // and the peak memory of the process after the @phase
+    void printMemoryUsage(const char *phase)
+    {
+        analysis::MemoryUsage dgmu, ptamu, rdmu;
+        dg.getMemoryUsage(dgmu);
+        if (PTA)
+            PTA->getMemoryUsage(ptamu);
+        if (RD)
+            RD->getMemoryUsage(rdmu);
+
+        errs() << "Memory usage after " << phase << ":\n";
+        print_memory_usage("dependence graph", dgmu);
+        print_memory_usage("pointer analysis", ptamu);
+        print_memory_usage("reaching definitions", rdmu);
+        print_allocation_stats();
+        errs() << "  peak RSS: "
+               << llvm::format("%.2f", analysis::getPeakRSS() / (1024.0 * 1024.0))
+               << " MB\n";
+    }
 
     // shared by old and new analyses
     bool mark()
@@ -552,15 +1624,10 @@ public:
         std::vector<std::string> criterions = splitList(slicing_criterion);
         assert(!criterions.empty() && "Do not have the slicing criterion");
 
-        // if user wants to slice with respect to the retrn of main
-        for (const auto& c : criterions)
-            if (c == "ret")
-                callsites.insert(dg.getExit());
-
         // check for slicing criterion here, because
         // we might have built new subgraphs that contain
         // it during points-to analysis
-        bool ret = dg.getCallSites(criterions, &callsites);
+        bool ret = getCriteriaNodes(dg, criterions, &callsites);
         got_slicing_criterion = true;
         if (!ret) {
             errs() << "Did not find slicing criterion: "
@@ -573,7 +1640,7 @@ public:
         // Also compute the edges when the user wants to annotate
         // the file - due to debugging.
         if (got_slicing_criterion || (opts & ANNOTATE))
-            computeEdges();
+            computeAndSaveEdges();
 
         // don't go through the graph when we know the result:
         // only empty main will stay there. Just delete the body
@@ -581,40 +1648,288 @@ public:
         if (!got_slicing_criterion)
             return createEmptyMain(M);
 
-        // we also do not want to remove any assumptions
-        // about the code
-        // FIXME: make it configurable and add control dependencies
-        // for these functions, so that we slice away the
-        // unneeded one
-        const char *sc[] = {
-            "__VERIFIER_assume",
-            "__VERIFIER_exit",
-            "klee_assume",
-            NULL // termination
-        };
+        std::set<LLVMNode *> sources;
+        if (!chop_source.empty()) {
+            dg.getCallSites(splitList(chop_source), &sources);
+            if (sources.empty()) {
+                errs() << "Did not find the chop source: "
+                       << chop_source << "\n";
+                got_slicing_criterion = false;
+                return createEmptyMain(M);
+            }
+        }
 
-        dg.getCallSites(sc, &callsites);
+        // we also do not want to remove any assumptions
+        // about the code. The assumptions do not depend on
+        // the criteria, so this makes sense only for backward slices
+        if (!forward_slice && chop_source.empty())
+            dg.getCallSites(assumption_calls, &callsites);
 
         // do not slice __VERIFIER_assume at all
         // FIXME: do this optional
         slicer.keepFunctionUntouched("__VERIFIER_assume");
         slicer.keepFunctionUntouched("__VERIFIER_exit");
-        slice_id = 0xdead;
 
-        tm.start();
-        for (LLVMNode *start : callsites)
-            slice_id = slicer.mark(start, slice_id);
+        freezeDG();
+
+        // how the nodes got into the slice, for -slice-report
+        analysis::WalkParents<LLVMNode> parents;
+
+        analysis::Profiler::Scope phase("Finding dependent nodes");
+        if (!chop_source.empty()) {
+            tm.start();
+            slice_id = slicer.chop(std::vector<LLVMNode *>(sources.begin(),
+                                                           sources.end()),
+                                   std::vector<LLVMNode *>(callsites.begin(),
+                                                           callsites.end()),
+                                   0xdead);
+        } else if (forward_slice) {
+            tm.start();
+            slice_id = slicer.markForward(std::vector<LLVMNode *>(callsites.begin(),
+                                                                  callsites.end()),
+                                          0xdead);
+        } else if (cs_slicing) {
+            tm.start();
+            analysis::SummaryEdges<LLVMNode> summaries;
+            summaries.compute(&dg);
+            tm.stop();
+            tm.report("INFO: Computing summary edges took");
+            errs() << "INFO: Summary edges: " << summaries.size() << "\n";
+            analysis::Profiler::count("summary edges", summaries.size());
+
+            tm.start();
+            slice_id = slicer.markContextSensitive(
+                            std::vector<LLVMNode *>(callsites.begin(),
+                                                    callsites.end()),
+                            summaries, 0xdead);
+        } else if (thin_slice) {
+            tm.start();
+            std::vector<LLVMNode *> unexpanded;
+            slice_id = slicer.markThin(std::vector<LLVMNode *>(callsites.begin(),
+                                                               callsites.end()),
+                                       thin_expand, 0xdead, &unexpanded);
+            errs() << "INFO: Thin slice left " << unexpanded.size()
+                   << " address dependencies unexpanded\n";
+        } else if (slice_report) {
+            tm.start();
+            slice_id = slicer.markWithParents(std::vector<LLVMNode *>(callsites.begin(),
+                                                                      callsites.end()),
+                                              parents, 0xdead);
+        } else {
+            // walk from all the call-sites at once
+            tm.start();
+            slicer.markMulti({std::vector<LLVMNode *>(callsites.begin(),
+                                                      callsites.end())});
+            slice_id = slicer.markCriterion(0, 0xdead);
+        }
 
         tm.stop();
         tm.report("INFO: Finding dependent nodes took");
 
+        if (slice_report)
+            print_slice_report(parents);
+
+        // slicing removes nodes, the frozen graph would be stale
+        slicer.setFrozenGraph(nullptr);
+
         // print debugging llvm IR if user asked for it
         if (opts & ANNOTATE)
-            annotate(M, opts, RD.get());
+            annotate(M, &dg, opts, dg_loaded ? nullptr : RD.get());
+
+        return true;
+    }
+
+    // set the sets of criteria for markSeparately(), must be called
+    // before buildDG() so that -dg-relevant-only knows all of them
+    void setCriteriaSets(std::vector<std::vector<std::string>>&& sets)
+    {
+        criteriaSets = std::move(sets);
+    }
+
+    // mark the slices of every set of criteria separately,
+    // all of them in one walk of the graph. The slice of the set
+    // i is then created by sliceCriterion(i)
+    bool markSeparately()
+    {
+        debug::TimeMeasure tm;
+
+        assert(!criteriaSets.empty() && "Do not have the slicing criteria");
+
+        // we do not want to remove any assumptions
+        // about the code in any of the slices
+        std::set<LLVMNode *> assumptions;
+        dg.getCallSites(assumption_calls, &assumptions);
+
+        criteria.assign(criteriaSets.size(), std::vector<LLVMNode *>());
+        bool found = false;
+        for (unsigned i = 0; i < criteriaSets.size(); ++i) {
+            std::set<LLVMNode *> callsites;
+            getCriteriaNodes(dg, criteriaSets[i], &callsites);
+
+            // the slice will be just an empty main
+            if (callsites.empty()) {
+                errs() << "Did not find slicing criteria " << i << ":";
+                for (const auto& c : criteriaSets[i])
+                    errs() << " " << c;
+                errs() << "\n";
+                continue;
+            }
+
+            criteria[i].assign(callsites.begin(), callsites.end());
+            criteria[i].insert(criteria[i].end(),
+                               assumptions.begin(), assumptions.end());
+            found = true;
+        }
+
+        if (!found)
+            return true;
+
+        computeAndSaveEdges();
+
+        slicer.keepFunctionUntouched("__VERIFIER_assume");
+        slicer.keepFunctionUntouched("__VERIFIER_exit");
+
+        freezeDG();
+
+        analysis::Profiler::Scope phase("Finding dependent nodes");
+        tm.start();
+        slicer.markMulti(criteria);
+        tm.stop();
+        tm.report("INFO: Finding dependent nodes of all criteria took");
+
+        slicer.setFrozenGraph(nullptr);
+        return true;
+    }
+
+    size_t getCriteriaNum() const { return criteria.size(); }
+
+    // compute the dependencies now, so that the slices computed
+    // later only walk the graph (see -server)
+    void computeDependencies() { computeAndSaveEdges(); }
+
+    // the source locations of the instructions marked by mark()
+    void getSliceLocations(std::set<SourceLocation>& locs) const
+    {
+        // no slicing criterion, the slice is an empty main
+        if (slice_id == 0)
+            return;
+
+        SourceLocation loc;
+        for (const auto& it : dg.getConstructedFunctions()) {
+            for (const auto& nd : *it.second) {
+                if (nd.second->getSlice() != slice_id)
+                    continue;
+
+                auto I = llvm::dyn_cast<llvm::Instruction>(nd.first);
+                if (I && getSourceLocation(I, loc))
+                    locs.insert(loc);
+            }
+        }
+    }
+
+    // the instructions marked by mark() as the functions of @mask
+    // (the hash of the module is set by the caller)
+    void getSliceMask(SliceMask& mask) const
+    {
+        if (!got_slicing_criterion) {
+            mask.setEmptyMain();
+            return;
+        }
+
+        if (slice_id == 0)
+            return;
+
+        const auto& functions = dg.getConstructedFunctions();
+        uint64_t idx = 0;
+        for (llvm::Function& F : *M) {
+            uint64_t fidx = idx++;
+            auto it = functions.find(&F);
+            if (it == functions.end() || it->second->getSlice() != slice_id)
+                continue;
+
+            uint64_t num = 0;
+            for (llvm::BasicBlock& B : F)
+                num += B.size();
+
+            LLVMDependenceGraph *subdg = it->second;
+            SliceMask::Bits& bits = mask.addFunction(fidx, num);
+            uint64_t i = 0;
+            for (llvm::BasicBlock& B : F) {
+                for (llvm::Instruction& I : B) {
+                    LLVMNode *n = subdg->getNode(&I);
+                    if (n && n->getSlice() == slice_id)
+                        bits.set(i);
+                    ++i;
+                }
+            }
+        }
+    }
+
+    // mark the instructions of @mask (saved by getSliceMask()
+    // for the same module) instead of mark(), so that the slice
+    // is not computed again. The dependencies are not computed
+    bool markMask(const SliceMask& mask)
+    {
+        if (mask.isEmptyMain()) {
+            got_slicing_criterion = false;
+            return createEmptyMain(M);
+        }
+
+        got_slicing_criterion = true;
+        slice_id = 0xdead;
+
+        const auto& functions = dg.getConstructedFunctions();
+        uint64_t idx = 0;
+        for (llvm::Function& F : *M) {
+            const SliceMask::Bits *bits = mask.getFunction(idx++);
+            if (!bits)
+                continue;
+
+            auto it = functions.find(&F);
+            if (it == functions.end()) {
+                errs() << "ERROR: the function " << F.getName()
+                       << " from the slice mask is not in the graph\n";
+                return false;
+            }
+
+            LLVMDependenceGraph *subdg = it->second;
+            subdg->setSlice(slice_id);
+            subdg->getEntry()->setSlice(slice_id);
+
+            uint64_t i = 0;
+            for (llvm::BasicBlock& B : F) {
+                for (llvm::Instruction& I : B) {
+                    if (!bits->test(i++))
+                        continue;
+
+                    LLVMNode *n = subdg->getNode(&I);
+                    if (!n)
+                        continue;
+
+                    n->setSlice(slice_id);
+                    if (LLVMBBlock *BB = n->getBBlock())
+                        BB->setSlice(slice_id);
+                }
+            }
+        }
 
         return true;
     }
 
+    // slice the graph (and the module) with respect to the criterion @i
+    // marked by markSeparately(). This can be done only once,
+    // slicing changes the graph and the module
+    bool sliceCriterion(unsigned i)
+    {
+        assert(i < criteria.size());
+        if (criteria[i].empty())
+            return createEmptyMain(M);
+
+        got_slicing_criterion = true;
+        slice_id = slicer.markCriterion(i, 0xdead);
+        return slice();
+    }
+
     bool slice()
     {
         // we created an empty main in this case
@@ -626,6 +1941,7 @@ public:
                 return false;
         }
 
+        analysis::Profiler::Scope phase("Slicing the dependence graph");
         debug::TimeMeasure tm;
 
         tm.start();
@@ -635,6 +1951,7 @@ public:
         tm.report("INFO: Slicing dependence graph took");
 
         analysis::SlicerStatistics& st = slicer.getStatistics();
+        analysis::Profiler::count("nodes removed", st.nodesRemoved);
         errs() << "INFO: Sliced away " << st.nodesRemoved
                << " from " << st.nodesTotal << " nodes in DG\n";
 
@@ -643,31 +1960,326 @@ public:
 
     virtual bool buildDG()
     {
+        analysis::Profiler::Scope phase("Building the dependence graph");
         debug::TimeMeasure tm;
 
         tm.start();
 
+        PTA->setOffsetsBudget(pta_offsets_budget);
+        PTA->setSaturateUnknown(pta_saturate_unknown);
+        PTA->setWideningDelay(pta_widening_delay);
+        PTA->setBudget(analysis::Budget(pta_timeout * 1000ULL,
+                                        pta_max_mem * 1024ULL * 1024ULL));
+        PTA->setProgress(analysis::Progress(progress_period * 1000ULL,
+                                            progress_file));
+        PTA->setCallSummaries(pta_call_summaries);
+        PTA->setHeapCloning(pta_heap_cloning);
+        PTA->setCompactGraph(pta_compact);
+        PTA->setLoopWidening(pta_loop_widening);
+        PTA->setCallCompatibility(pta_callee_types);
+        dg.setBuildThreads(dg_threads);
+        dg.setBuildOptions(getBuildOptions());
+        LLVMNode::deferReverseEdges(lazy_rev_edges);
+
+        if (dg_relevant_only) {
+            std::vector<std::string> names;
+            if (criteriaSets.empty())
+                names = splitList(slicing_criterion);
+            for (const auto& set : criteriaSets)
+                names.insert(names.end(), set.begin(), set.end());
+            for (const char **c = assumption_calls; *c; ++c)
+                names.push_back(*c);
+
+            dg.buildOnlyRelevant(names);
+        }
+
+        if (!dg_cache.empty()) {
+            if (dg_relevant_only) {
+                errs() << "WARNING: -dg-cache does not work with "
+                          "-dg-relevant-only, ignoring\n";
+            } else if (dg.loadGraph(&*M, dg_cache, getDGCacheKey())) {
+                dg_loaded = true;
+                tm.stop();
+                tm.report("INFO: Loading the dependence graph took");
+                return verifyDG();
+            }
+        }
+
+        uint64_t cache_key = 0;
+        if (!pta_cache.empty()) {
+            cache_key = getPTACacheKey();
+            if (PTA->loadResults(pta_cache, cache_key)) {
+                tm.stop();
+                tm.report("INFO: Loading points-to information took");
+                dg.build(&*M, PTA.get());
+                return verifyDG();
+            }
+        }
+
+        if (pta_demand > 0 && pta == PtaType::fi) {
+            PTA->runDemandDriven(pta_demand);
+            tm.stop();
+            tm.report("INFO: Building points-to subgraph took");
+            dg.build(&*M, PTA.get());
+            return verifyDG();
+        }
+
+        if (pta_demand > 0)
+            errs() << "WARNING: -pta-demand works only with -pta fi, ignoring\n";
+
+        if (pta_threads > 1
+            && (pta_schedule != analysis::pta::PTASchedule::SCC
+                || (pta != PtaType::fs && pta != PtaType::fi)))
+            errs() << "WARNING: -pta-threads works only with -pta fs/fi "
+                      "and -pta-schedule=scc, ignoring\n";
+
+        PTA->setThreads(pta_threads);
+        PTA->setSharePointsToSets(pta_share_sets);
+
+        bool incremental = !pta_incremental.empty();
+        if (incremental && pta == PtaType::tiered) {
+            errs() << "WARNING: -pta-incremental does not work with "
+                      "-pta tiered, ignoring\n";
+            incremental = false;
+        }
+
         if (pta == PtaType::fs)
-            PTA->run<analysis::pta::PointsToFlowSensitive>();
+            runPTA<analysis::pta::PointsToFlowSensitive>(incremental);
         else if (pta == PtaType::fi)
-            PTA->run<analysis::pta::PointsToFlowInsensitive>();
+            runPTA<analysis::pta::PointsToFlowInsensitive>(incremental);
+        else if (pta == PtaType::andersen)
+            runPTA<analysis::pta::PointsToAndersen>(incremental);
+        else if (pta == PtaType::steens)
+            runPTA<analysis::pta::PointsToSteensgaard>(incremental);
+        else if (pta == PtaType::sfs)
+            runPTA<analysis::pta::PointsToSparseFlowSensitive>(incremental);
+        else if (pta == PtaType::tiered)
+            PTA->runTiered();
         else
             assert(0 && "Wrong pointer analysis");
 
         tm.stop();
         tm.report("INFO: Points-to analysis took");
 
+        using Degradation = LLVMPointerAnalysis::Degradation;
+        if (PTA->getDegradation() == Degradation::FLOW_INSENSITIVE)
+            errs() << "WARNING: points-to analysis exceeded its budget, "
+                      "using the flow-insensitive results\n";
+        else if (PTA->getDegradation() == Degradation::UNKNOWN)
+            errs() << "WARNING: points-to analysis exceeded its budget, "
+                      "the pointers may point to unknown memory\n";
+
+        // do not cache the degraded results
+        if (!pta_cache.empty() && PTA->getDegradation() == Degradation::NONE
+            && !PTA->saveResults(pta_cache, cache_key))
+            errs() << "WARNING: failed saving points-to information to "
+                   << pta_cache << "\n";
+
+        if (incremental && PTA->getDegradation() == Degradation::NONE
+            && !PTA->saveSolution(pta_incremental, getPTAOptionsKey()))
+            errs() << "WARNING: failed saving points-to information to "
+                   << pta_incremental << "\n";
+
         dg.build(&*M, PTA.get());
+        return verifyDG();
+    }
+
+private:
+    // the sets of criteria that are sliced separately
+    std::vector<std::vector<std::string>> criteriaSets;
+    // the starting nodes of the slices of markSeparately()
+    std::vector<std::vector<LLVMNode *>> criteria;
 
+    template <typename PTType>
+    void runPTA(bool incremental)
+    {
+        if (!incremental) {
+            PTA->run<PTType>();
+            return;
+        }
+
+        if (!PTA->runIncremental<PTType>(pta_incremental, getPTAOptionsKey()))
+            errs() << "INFO: the previous points-to solution cannot be used, "
+                      "running the analysis from scratch\n";
+    }
+
+    // compute the edges of the graph (unless they were loaded)
+    // and save them if the user wants to
+    void computeAndSaveEdges()
+    {
+        if (dg_loaded || edges_computed)
+            return;
+
+        analysis::Profiler::Scope phase("Computing the dependencies");
+        computeEdges();
+        edges_computed = true;
+
+        if (!dg_cache.empty() && !dg_relevant_only
+            && !dg.saveGraph(dg_cache, getDGCacheKey()))
+            errs() << "WARNING: failed saving the dependence graph to "
+                   << dg_cache << "\n";
+
+        releaseAnalyses();
+    }
+
+    // the def-use edges are computed, so the pointer subgraph,
+    // the memory objects and the reaching definitions are needed
+    // only for the annotations. Free them, so that they do not take
+    // the memory together with the graph while we slice
+    void releaseAnalyses()
+    {
+        if (keep_analyses || lazy_data_deps || (opts & ANNOTATE))
+            return;
+
+        analysis::Profiler::Scope phase("Releasing the analyses");
+        dg.releasePTA();
+        // RD uses PTA
+        RD.reset();
+        PTA.reset();
+    }
+
+    void freezeDG()
+    {
+        if (!freeze_dg)
+            return;
+
+        analysis::Profiler::Scope phase("Freezing the dependence graph");
+        debug::TimeMeasure tm;
+        tm.start();
+        frozen.freeze(&dg);
+        slicer.setFrozenGraph(&frozen);
+        slicer.setMarkThreads(mark_threads);
+        tm.stop();
+        tm.report("INFO: Freezing the dependence graph took");
+    }
+
+    bool verifyDG()
+    {
         // verify if the graph is built correctly
         // FIXME - do it optionally (command line argument)
-        if (!dg.verify()) {
+        if (!dg.verify(dg_threads)) {
             errs() << "ERR: verifying failed\n";
             return false;
         }
 
         return true;
     }
+
+    // FNV-1a hash of the input file (unless @with_file is false)
+    // and the given options
+    static uint64_t getCacheKey(const std::vector<uint64_t>& opts,
+                                bool with_file = true)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        auto mix = [&hash](uint64_t byte) {
+            hash ^= byte;
+            hash *= 1099511628211ULL;
+        };
+
+        if (with_file) {
+            std::vector<std::string> files{llvmfile};
+            files.insert(files.end(), link_inputs.begin(), link_inputs.end());
+            for (const std::string& file : files) {
+                auto buf = llvm::MemoryBuffer::getFile(file);
+                if (buf) {
+                    for (char c : buf.get()->getBuffer())
+                        mix(static_cast<unsigned char>(c));
+                }
+            }
+        }
+
+        for (uint64_t o : opts) {
+            for (unsigned i = 0; i < sizeof o; ++i)
+                mix((o >> (8 * i)) & 0xff);
+        }
+
+        return hash;
+    }
+
+    static uint64_t getSummariesKey()
+    {
+        return function_summaries ? function_summaries->getHash() : 0;
+    }
+
+    static LLVMDGBuildOptions getBuildOptions()
+    {
+        LLVMDGBuildOptions bo;
+        bo.controlDependencies = dg_deps != DGDeps::data;
+        bo.dataDependencies = dg_deps != DGDeps::control;
+        return bo;
+    }
+
+    static std::vector<uint64_t> getPTAOptions()
+    {
+        return {static_cast<uint64_t>(pta.getValue()),
+                static_cast<uint64_t>(pta_schedule.getValue()),
+                pta_field_sensitivie,
+                pta_offsets_budget,
+                pta_loop_widening,
+                pta_widening_delay,
+                pta_call_summaries,
+                pta_heap_cloning,
+                static_cast<uint64_t>(pta_callee_types.getValue()),
+                getSummariesKey()};
+    }
+
+    // the key of the cached points-to information
+    static uint64_t getPTACacheKey() { return getCacheKey(getPTAOptions()); }
+
+    // the key of the cached reaching definitions, they depend on
+    // the points-to information and on the options of the analyses
+    // of the memory
+    static uint64_t getRDCacheKey()
+    {
+        std::vector<uint64_t> opts = getPTAOptions();
+        opts.insert(opts.end(), {pta_demand,
+                                 rd_strong_update_unknown,
+                                 rd_max_set_size,
+                                 rd_sparse,
+                                 rd_coarse,
+                                 rd_summaries,
+                                 rd_promote_locals,
+                                 rd_max_growths,
+                                 rd_max_offsets,
+                                 rd_memory_ssa,
+                                 undefined_are_pure});
+        return getCacheKey(opts);
+    }
+
+    // the key of the solution of -pta-incremental, the module changes
+    // between the runs (the solution keeps the fingerprints of its parts)
+    static uint64_t getPTAOptionsKey()
+    {
+        return getCacheKey(getPTAOptions(), false /* with file */);
+    }
+
+    // the key of the cached dependence graph, the edges depend
+    // on the points-to information and on the options of
+    // the def-use and control dependence computation
+    static uint64_t getDGCacheKey()
+    {
+        return getCacheKey({static_cast<uint64_t>(pta.getValue()),
+                            static_cast<uint64_t>(pta_schedule.getValue()),
+                            pta_field_sensitivie,
+                            pta_offsets_budget,
+                            pta_loop_widening,
+                            pta_widening_delay,
+                            pta_call_summaries,
+                            pta_heap_cloning,
+                            static_cast<uint64_t>(pta_callee_types.getValue()),
+                            pta_demand,
+                            static_cast<uint64_t>(dg_deps.getValue()),
+                            rd_strong_update_unknown,
+                            rd_max_set_size,
+                            rd_sparse,
+                            rd_coarse,
+                            rd_summaries,
+                            rd_promote_locals,
+                            rd_max_offsets,
+                            undefined_are_pure,
+                            getSummariesKey(),
+                            static_cast<uint64_t>(CdAlgorithm.getValue())});
+    }
 };
 
 static void print_statistics(llvm::Module *M, const char *prefix = nullptr)
@@ -699,6 +2311,73 @@ static void print_statistics(llvm::Module *M, const char *prefix = nullptr)
            << gnum << " " << fnum << " " << bnum << " " << inum << "\n";
 }
 
+// choose the options of the analyses that were not given explicitly
+// by the statistics of the module (-auto). The size of the pointer
+// subgraph decides the most, the cost model is:
+//
+//  - small modules (up to 20k pointer nodes and 100 indirect calls):
+//    the flow-sensitive points-to analysis
+//  - medium modules (up to 200k pointer nodes): the flow-insensitive
+//    analysis, flow-sensitive in the functions where it helps (tiered),
+//    the sparse reaching definitions
+//  - large modules: the flow-insensitive analysis with an offsets
+//    budget and compacted pointer subgraph, the sparse and coarse
+//    reaching definitions with summaries of the calls
+//
+// The pointer arithmetic in deeply nested loops (depth 3 and more)
+// is widened in the loops outside of the small modules. The options
+// that may make the results unsound are never switched on
+static void auto_configure(const llvm::Module *M)
+{
+    ModuleStatistics st = ModuleStatistics::compute(*M);
+
+    auto choose = [](llvm::cl::Option& opt) {
+        return opt.getNumOccurrences() == 0;
+    };
+
+    static const char *ptaNames[] = {
+        "fs", "fi", "andersen", "steens", "sfs", "tiered"
+    };
+
+    const char *size;
+    bool small = st.pointerNodes <= 20000 && st.indirectCalls <= 100;
+    if (small) {
+        size = "small";
+        if (choose(pta))
+            pta = PtaType::fs;
+    } else if (st.pointerNodes <= 200000) {
+        size = "medium";
+        if (choose(pta))
+            pta = PtaType::tiered;
+        if (choose(rd_sparse))
+            rd_sparse = true;
+    } else {
+        size = "large";
+        if (choose(pta))
+            pta = PtaType::fi;
+        if (choose(pta_offsets_budget))
+            pta_offsets_budget = 64;
+        if (choose(pta_compact))
+            pta_compact = true;
+        if (choose(rd_sparse))
+            rd_sparse = true;
+        if (choose(rd_coarse))
+            rd_coarse = true;
+        if (choose(rd_summaries))
+            rd_summaries = true;
+    }
+
+    if (st.loopDepth >= 3 && !small && choose(pta_loop_widening))
+        pta_loop_widening = true;
+
+    errs() << "INFO: -auto: ";
+    st.print(errs());
+    errs() << "INFO: -auto: " << size << " module, using -pta "
+           << ptaNames[pta.getValue()] << (rd_sparse ? " -rd-sparse" : "")
+           << (rd_coarse ? " -rd-coarse" : "")
+           << (pta_loop_widening ? " -pta-loop-widening" : "") << "\n";
+}
+
 static bool array_match(llvm::StringRef name, const char *names[])
 {
     unsigned idx = 0;
@@ -711,6 +2390,33 @@ static bool array_match(llvm::StringRef name, const char *names[])
     return false;
 }
 
+// queue the globals that are used by the value
+// (possibly through constant expressions)
+static void queue_used_globals(const llvm::Value *val,
+                               std::set<const llvm::Value *>& visited,
+                               std::vector<const llvm::GlobalValue *>& queue)
+{
+    using namespace llvm;
+
+    if (!isa<Constant>(val) || !visited.insert(val).second)
+        return;
+
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(val)) {
+        queue.push_back(GV);
+    } else {
+        // constant expressions, aggregates and block addresses
+        for (const Use& op : cast<Constant>(val)->operands())
+            queue_used_globals(op.get(), visited, queue);
+    }
+}
+
+// Remove the functions, global variables and aliases that are not
+// reachable from main (and the other functions that we keep) through
+// the code of the reachable functions, the initializers of the reachable
+// globals or the aliasees. The references are followed in one sweep
+// and the unreachable globals are erased at once (as LLVM's GlobalDCE
+// does), so the module is not scanned again after every removal
+// and also the unused functions that call each other are removed.
 static bool remove_unused_from_module(llvm::Module *M)
 {
     using namespace llvm;
@@ -719,54 +2425,220 @@ static bool remove_unused_from_module(llvm::Module *M)
     // to what is the setup (like for sv-comp or general..)
     const char *keep[] = {"main", "klee_assume", NULL};
 
-    // when erasing while iterating the slicer crashes
-    // so set the to be erased values into container
-    // and then erase them
-    std::set<Function *> funs;
-    std::set<GlobalVariable *> globals;
-    std::set<GlobalAlias *> aliases;
+    std::set<const Value *> visited;
+    std::vector<const GlobalValue *> queue;
+    for (Function& F : *M) {
+        if (array_match(F.getName(), keep))
+            queue_used_globals(&F, visited, queue);
+    }
+#if LLVM_VERSION_MAJOR >= 4
+    // we do not look into the resolvers of the ifuncs
+    for (GlobalIFunc& GI : M->ifuncs())
+        queue_used_globals(&GI, visited, queue);
+#endif
 
-    for (auto I = M->begin(), E = M->end(); I != E; ++I) {
-        Function *func = &*I;
-        if (array_match(func->getName(), keep))
-            continue;
+    while (!queue.empty()) {
+        const GlobalValue *GV = queue.back();
+        queue.pop_back();
 
-        // if the function is unused or we haven't constructed it
-        // at all in dependence graph, we can remove it
-        // (it may have some uses though - like when one
-        // unused func calls the other unused func
-        if (func->hasNUses(0))
-            funs.insert(func);
+        // the operands of functions are personality functions and similar,
+        // the operands of the globals are the initializers and aliasees
+        for (const Use& op : GV->operands())
+            queue_used_globals(op.get(), visited, queue);
+
+        if (const Function *F = dyn_cast<Function>(GV)) {
+            for (const BasicBlock& B : *F) {
+                for (const Instruction& I : B) {
+                    for (const Use& op : I.operands())
+                        queue_used_globals(op.get(), visited, queue);
+                }
+            }
+        }
     }
 
+    std::vector<Function *> funs;
+    std::vector<GlobalVariable *> globals;
+    std::vector<GlobalAlias *> aliases;
+
+    for (Function& F : *M) {
+        if (visited.count(&F) == 0)
+            funs.push_back(&F);
+    }
     for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
-        GlobalVariable *gv = &*I;
-        if (gv->hasNUses(0))
-            globals.insert(gv);
+        if (visited.count(&*I) == 0)
+            globals.push_back(&*I);
     }
-
-    for (GlobalAlias& ga : M->getAliasList()) {
-        if (ga.hasNUses(0))
-            aliases.insert(&ga);
+    for (GlobalAlias& GA : M->getAliasList()) {
+        if (visited.count(&GA) == 0)
+            aliases.push_back(&GA);
     }
 
-    for (Function *f : funs)
-        f->eraseFromParent();
-    for (GlobalVariable *gv : globals)
-        gv->eraseFromParent();
-    for (GlobalAlias *ga : aliases)
-        ga->eraseFromParent();
+    // drop the references among the removed globals first,
+    // then only the dead constants may use them
+    for (Function *F : funs)
+        F->dropAllReferences();
+    for (GlobalVariable *GV : globals)
+        GV->setInitializer(nullptr);
+    for (GlobalAlias *GA : aliases)
+        GA->setAliasee(nullptr);
+
+    for (Function *F : funs) {
+        F->removeDeadConstantUsers();
+        F->eraseFromParent();
+    }
+    for (GlobalVariable *GV : globals) {
+        GV->removeDeadConstantUsers();
+        GV->eraseFromParent();
+    }
+    for (GlobalAlias *GA : aliases) {
+        GA->removeDeadConstantUsers();
+        GA->eraseFromParent();
+    }
 
     return (!funs.empty() || !globals.empty() || !aliases.empty());
 }
 
-static void remove_unused_from_module_rec(llvm::Module *M)
+static bool materialize_function(llvm::Function *F)
 {
-    bool fixpoint;
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
+    std::string err;
+    if (F->Materialize(&err)) {
+        llvm::errs() << "ERROR: Failed loading " << F->getName()
+                     << ": " << err << "\n";
+        return false;
+    }
+#elif LLVM_VERSION_MAJOR < 4
+    if (std::error_code ec = F->materialize()) {
+        llvm::errs() << "ERROR: Failed loading " << F->getName()
+                     << ": " << ec.message() << "\n";
+        return false;
+    }
+#else
+    if (llvm::Error err = F->materialize()) {
+        llvm::logAllUnhandledErrors(std::move(err), llvm::errs(),
+                                    "ERROR: Failed loading function: ");
+        return false;
+    }
+#endif
+    return true;
+}
 
-    do {
-        fixpoint = remove_unused_from_module(M);
-    } while (fixpoint);
+static bool materialize_module(llvm::Module *M)
+{
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
+    std::string err;
+    if (M->MaterializeAll(&err)) {
+        llvm::errs() << "ERROR: Failed loading the module: " << err << "\n";
+        return false;
+    }
+#elif LLVM_VERSION_MAJOR < 4
+    if (std::error_code ec = M->materializeAll()) {
+        llvm::errs() << "ERROR: Failed loading the module: "
+                     << ec.message() << "\n";
+        return false;
+    }
+#else
+    if (llvm::Error err = M->materializeAll()) {
+        llvm::logAllUnhandledErrors(std::move(err), llvm::errs(),
+                                    "ERROR: Failed loading the module: ");
+        return false;
+    }
+#endif
+    return true;
+}
+
+// queue the functions that are used by the value
+// (possibly through constant expressions)
+static void queue_used_functions(const llvm::Value *val,
+                                 std::set<const llvm::Value *>& visited,
+                                 std::vector<llvm::Function *>& queue)
+{
+    using namespace llvm;
+
+    if (!visited.insert(val).second)
+        return;
+
+    if (const Function *F = dyn_cast<Function>(val)) {
+        queue.push_back(const_cast<Function *>(F));
+    } else if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(val)) {
+        queue_used_functions(GA->getAliasee(), visited, queue);
+    } else if (isa<Constant>(val) && !isa<GlobalValue>(val)) {
+        // constant expressions and aggregates, the initializers
+        // of global variables are queued by the caller
+        for (const Use& op : cast<Constant>(val)->operands())
+            queue_used_functions(op.get(), visited, queue);
+    }
+}
+
+// Load the bodies of the functions that are reachable from main
+// (through the calls or any other use in the loaded code)
+// or from the initializers of globals. The functions that are
+// not reachable are not loaded at all, they are erased
+// (no loaded code can use them) and the rest of the module
+// is loaded then. The analyses never build the unreachable
+// functions, so their bodies would be only parsed and removed
+// by remove_unused_from_module.
+//
+// The functions are loaded sequentially, LLVMContext
+// cannot be used from more threads. The bitcode is only read
+// ahead by @prefetcher, which is stopped before the rest
+// of the module is loaded (that releases the bitcode).
+static bool materialize_reachable(llvm::Module *M,
+                                  dg::BitcodePrefetcher& prefetcher)
+{
+    using namespace llvm;
+
+    Function *main_func = M->getFunction("main");
+    if (!main_func) {
+        prefetcher.stop();
+        return materialize_module(M);
+    }
+
+    std::set<const Value *> visited;
+    std::vector<Function *> queue;
+    queue_used_functions(main_func, visited, queue);
+    for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
+        if (I->hasInitializer())
+            queue_used_functions(I->getInitializer(), visited, queue);
+    }
+    for (GlobalAlias& GA : M->getAliasList())
+        queue_used_functions(&GA, visited, queue);
+
+    while (!queue.empty()) {
+        Function *F = queue.back();
+        queue.pop_back();
+
+        if (F->isMaterializable() && !materialize_function(F)) {
+            prefetcher.stop();
+            return false;
+        }
+
+        // personality function and similar
+        for (const Use& op : F->operands())
+            queue_used_functions(op.get(), visited, queue);
+
+        for (const BasicBlock& B : *F) {
+            for (const Instruction& I : B) {
+                for (const Use& op : I.operands())
+                    queue_used_functions(op.get(), visited, queue);
+            }
+        }
+    }
+
+    // the functions that are used somewhere where we do not
+    // look for the uses (e.g. metadata) are loaded with the rest
+    std::vector<Function *> unreachable;
+    for (Function& F : *M) {
+        if (F.isMaterializable() && visited.count(&F) == 0
+            && F.use_empty())
+            unreachable.push_back(&F);
+    }
+
+    for (Function *F : unreachable)
+        F->eraseFromParent();
+
+    prefetcher.stop();
+    return materialize_module(M);
 }
 
 // after we slice the LLVM, we somethimes have troubles
@@ -816,17 +2688,24 @@ static void replace_suffix(std::string& fl, const std::string& with)
         fl += with;
     }
 }
-static bool write_module(llvm::Module *M)
+// the name of the sliced module of the input @idx
+// (the input file and then link_inputs)
+static std::string get_output_name(unsigned idx)
 {
     // compose name if not given
     std::string fl;
-    if (!output.empty()) {
+    if (idx == 0 && !output.empty()) {
         fl = output;
     } else {
-        fl = llvmfile;
+        fl = idx == 0 ? llvmfile : link_inputs[idx - 1];
         replace_suffix(fl, ".sliced");
     }
 
+    return fl;
+}
+
+static bool write_module_file(llvm::Module *M, const std::string& fl)
+{
     // open stream to write to
     std::ofstream ofs(fl);
     llvm::raw_os_ostream ostream(ofs);
@@ -838,7 +2717,28 @@ static bool write_module(llvm::Module *M)
     return true;
 }
 
-static int verify_and_write_module(llvm::Module *M)
+static bool write_module(llvm::Module *M, const std::string& suffix = "")
+{
+    if (link_inputs.empty())
+        return write_module_file(M, get_output_name(0) + suffix);
+
+#if LLVM_VERSION_MAJOR >= 4
+    // split the module back into the modules of the inputs
+    for (unsigned idx = 0; idx <= link_inputs.size(); ++idx) {
+        auto part = dg::extractInput(*M, idx);
+        if (!write_module_file(part.get(), get_output_name(idx) + suffix))
+            return false;
+    }
+
+    return true;
+#else
+    assert(0 && "Multiple inputs are not supported");
+    return false;
+#endif
+}
+
+static int verify_and_write_module(llvm::Module *M,
+                                   const std::string& suffix = "")
 {
     if (!verify_module(M)) {
         errs() << "ERR: Verifying module failed, the IR is not valid\n";
@@ -846,7 +2746,7 @@ static int verify_and_write_module(llvm::Module *M)
         return 1;
     }
 
-    if (!write_module(M)) {
+    if (!write_module(M, suffix)) {
         errs() << "Saving sliced module failed\n";
         return 1;
     }
@@ -856,12 +2756,243 @@ static int verify_and_write_module(llvm::Module *M)
 }
 
 static int save_module(llvm::Module *M,
-                       bool should_verify_module = true)
+                       bool should_verify_module = true,
+                       const std::string& suffix = "")
 {
     if (should_verify_module)
-        return verify_and_write_module(M);
+        return verify_and_write_module(M, suffix);
     else
-        return write_module(M);
+        return write_module(M, suffix);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// waitpid() for the child @pid that is retried when interrupted
+// by a signal
+static pid_t wait_for_child(pid_t pid, int *status, int options = 0)
+{
+    pid_t ret;
+    do {
+        ret = waitpid(pid, status, options);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+#endif
+
+// create the slices of all the sets of criteria
+// (see -separate-slices and -criteria-file).
+// Slicing changes the module and the graph, so every slice is created
+// in a child process that gets its own copy of them (with the slices
+// already marked) instead of building the graph again. The children
+// do not share anything, so up to -slice-jobs of them slice and write
+// their modules at once (and only so many copies are in memory).
+// No other thread may run when forking (the child would get the memory
+// in the state where the thread left it), the caller joins them
+static int slice_separately(Slicer& slicer, llvm::Module *M,
+                            bool should_verify_module)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (!slicer.markSeparately()) {
+        errs() << "ERROR: Marking the slices failed\n";
+        return 1;
+    }
+
+    // the phases of the children are not profiled
+    analysis::Profiler::Scope phase("Slicing in child processes");
+    int ret = 0;
+    // the running children and their criteria in the order of forking
+    std::vector<std::pair<pid_t, unsigned>> running;
+
+    // the child @idx of running has finished (or cannot be waited for)
+    auto finished = [&](size_t idx, pid_t pid, int status) {
+        if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            errs() << "ERROR: Slicing for the criterion "
+                   << running[idx].second << " failed\n";
+            ret = 1;
+        }
+        running.erase(running.begin() + idx);
+    };
+
+    // wait for one of the running children, only the children forked
+    // here are waited for. Take a child that has finished already,
+    // otherwise wait for the oldest one
+    auto wait_child = [&]() {
+        int status = 0;
+        for (size_t idx = 0; idx < running.size(); ++idx) {
+            pid_t pid = wait_for_child(running[idx].first, &status, WNOHANG);
+            if (pid != 0) {
+                finished(idx, pid, status);
+                return;
+            }
+        }
+
+        pid_t pid = wait_for_child(running[0].first, &status);
+        finished(0, pid, status);
+    };
+
+    unsigned jobs = std::max(slice_jobs.getValue(), 1U);
+    for (unsigned i = 0; i < slicer.getCriteriaNum(); ++i) {
+        while (running.size() >= jobs)
+            wait_child();
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            errs() << "ERROR: fork() failed\n";
+            ret = 1;
+            break;
+        }
+
+        if (pid == 0) {
+            if (!slicer.sliceCriterion(i))
+                _exit(1);
+
+            remove_unused_from_module(M);
+            make_declarations_external(M);
+            _exit(save_module(M, should_verify_module,
+                              "." + std::to_string(i)));
+        }
+
+        running.emplace_back(pid, i);
+    }
+
+    while (!running.empty())
+        wait_child();
+
+    return ret;
+#else
+    (void) slicer;
+    (void) M;
+    (void) should_verify_module;
+    errs() << "ERROR: Slicing separately is not supported on this system\n";
+    return 1;
+#endif
+}
+
+// the profiler of the phases of slicing (-time-report, -time-trace),
+// the phases are reported when the profiler is destroyed
+class TimeReport
+{
+    std::unique_ptr<analysis::Profiler> profiler;
+
+public:
+    TimeReport()
+    {
+        if (time_report || !time_trace.empty())
+            profiler.reset(new analysis::Profiler("llvm-slicer"));
+    }
+
+    ~TimeReport()
+    {
+        debug::reportProfile(profiler.get(), time_report, time_trace);
+    }
+
+    // the phases that do not fit into one scope,
+    // the unfinished phases are stopped in the destructor
+    void start(const char *name)
+    {
+        if (profiler)
+            profiler->start(name);
+    }
+
+    void stop()
+    {
+        if (profiler)
+            profiler->stop();
+    }
+};
+
+// slice the module w.r.t. @criteria in the child process of serve()
+// and write the answer to the request
+static int serve_request(Slicer& slicer, llvm::Module *M,
+                         bool should_verify_module, const std::string& cmd,
+                         const std::string& criteria, const std::string& file)
+{
+    slicing_criterion = criteria;
+    if (!slicer.mark())
+        return 1;
+
+    if (cmd == "lines") {
+        std::set<SourceLocation> locs;
+        slicer.getSliceLocations(locs);
+
+        std::cout << "OK";
+        for (const SourceLocation& loc : locs)
+            std::cout << " " << loc.file << ":" << loc.line << ":" << loc.column;
+        std::cout << std::endl;
+        return 0;
+    }
+
+    if (!slicer.slice())
+        return 1;
+
+    remove_unused_from_module(M);
+    make_declarations_external(M);
+
+    if (should_verify_module && !verify_module(M)) {
+        errs() << "ERR: Verifying module failed, the IR is not valid\n";
+        return 1;
+    }
+
+    output = file;
+    if (!write_module(M))
+        return 1;
+
+    std::cout << "OK " << file << std::endl;
+    return 0;
+}
+
+// answer the slicing requests from the standard input (see -server).
+// The dependencies are computed once and every request is sliced
+// in a child process that gets its own copy of the graph and the
+// module (slicing changes them), so a request costs only the walk
+// of the graph and the slicing
+static int serve(Slicer& slicer, llvm::Module *M, bool should_verify_module)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    slicer.computeDependencies();
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream request(line);
+        std::string cmd, criteria, file, rest;
+        request >> cmd >> criteria >> file >> rest;
+
+        if (cmd.empty())
+            continue;
+        if (cmd == "quit")
+            break;
+
+        if (!((cmd == "slice" && !file.empty())
+              || (cmd == "lines" && file.empty()))
+            || criteria.empty() || !rest.empty()) {
+            std::cout << "ERROR invalid request: " << line << std::endl;
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            errs() << "ERROR: fork() failed\n";
+            return 1;
+        }
+
+        if (pid == 0)
+            _exit(serve_request(slicer, M, should_verify_module,
+                                cmd, criteria, file));
+
+        int status;
+        if (wait_for_child(pid, &status) < 0
+            || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            std::cout << "ERROR slicing failed: " << line << std::endl;
+    }
+
+    return 0;
+#else
+    (void) slicer;
+    (void) M;
+    (void) should_verify_module;
+    errs() << "ERROR: The server mode is not supported on this system\n";
+    return 1;
+#endif
 }
 
 static void dump_dg_to_dot(LLVMDependenceGraph& dg, bool bb_only = false,
@@ -877,12 +3008,25 @@ static void dump_dg_to_dot(LLVMDependenceGraph& dg, bool bb_only = false,
 
     errs() << "INFO: Dumping DG to to " << fl << "\n";
 
+    // the neighborhood of the slicing criteria
+    std::set<LLVMNode *> centers;
+    if (dump_dg_hops > 0) {
+        getCriteriaNodes(dg, splitList(slicing_criterion), &centers);
+    }
+
+    const char *funcs = dump_dg_func.empty() ? nullptr : dump_dg_func.c_str();
     if (bb_only) {
         debug::LLVMDGDumpBlocks dumper(&dg, dump_opts, fl.c_str());
-        dumper.dump();
+        if (!centers.empty())
+            dumper.setNeighborhood(centers, dump_dg_hops);
+        dumper.setNodesBudget(dump_dg_max_nodes);
+        dumper.dump(nullptr, funcs);
     } else {
         debug::LLVMDG2Dot dumper(&dg, dump_opts, fl.c_str());
-        dumper.dump();
+        if (!centers.empty())
+            dumper.setNeighborhood(centers, dump_dg_hops);
+        dumper.setNodesBudget(dump_dg_max_nodes);
+        dumper.dump(nullptr, funcs);
     }
 }
 
@@ -934,7 +3078,9 @@ int main(int argc, char *argv[])
         llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
 
     llvm::cl::opt<bool> statistics("statistics",
-        llvm::cl::desc("Print statistics about slicing (default=false)."),
+        llvm::cl::desc("Print statistics about slicing, pointer analysis\n"
+                       "and reaching definitions and their memory usage\n"
+                       "after every phase (default=false)."),
         llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
 
     llvm::cl::opt<bool> dump_dg("dump-dg",
@@ -969,16 +3115,94 @@ int main(int argc, char *argv[])
     llvm::cl::SetVersionPrinter([](){ printf("%s\n", GIT_VERSION); });
     llvm::cl::ParseCommandLineOptions(argc, argv);
 
+    if (slicing_criterion.empty() && criteria_file.empty() && !server
+        && apply_slice_mask.empty()) {
+        errs() << "ERROR: No slicing criterion given (use -c or -criteria-file)\n";
+        return 1;
+    }
+
+    if (!summaries_files.empty()) {
+        function_summaries = std::make_shared<FunctionSummaries>();
+        for (const std::string& file : summaries_files) {
+            std::string error;
+            if (!function_summaries->load(file, error)) {
+                errs() << "ERROR: " << error << "\n";
+                return 1;
+            }
+        }
+    }
+
+    TimeReport profile;
+
     uint32_t opts = parseAnnotationOpt(annot);
+    // -threads is the default of the threads of the phases
+    for (llvm::cl::opt<unsigned> *phase : {&dg_threads, &pta_threads,
+                                          &rd_threads, &du_threads,
+                                          &mark_threads, &slice_jobs}) {
+        if (phase->getNumOccurrences() == 0)
+            *phase = all_threads.getValue();
+    }
     uint32_t dump_opts = debug::PRINT_CFG | debug::PRINT_DD | debug::PRINT_CD;
     // dump_dg_only implies dumg_dg
     if (dump_dg_only)
         dump_dg = true;
+    // the dumped graph should have all the control dependencies
+    if (dump_dg) {
+        lazy_cd = false;
+        lazy_dd = false;
+    }
+    // the server slices w.r.t. any criteria, so it needs the whole graph
+    if (server) {
+        lazy_cd = false;
+        lazy_dd = false;
+        if (dg_relevant_only) {
+            errs() << "WARNING: -dg-relevant-only does not work with -server, ignoring\n";
+            dg_relevant_only = false;
+        }
+    }
+
+    // the annotations and the statistics query the reaching definitions
+    if (dg_deps == DGDeps::control && ((opts & ANNOTATE) || statistics)) {
+        errs() << "WARNING: -dg-deps=control does not work with -annotate "
+                  "and -statistics, computing all dependencies\n";
+        dg_deps = DGDeps::all;
+    }
+
+    // the loaded definitions have no nodes of reaching definitions
+    if (!rd_cache.empty() && (dd_hubs > 0 || (opts & ANNOTATE_RD))) {
+        errs() << "WARNING: -rd-cache does not work with -dd-hubs "
+                  "and -annotate rd, ignoring\n";
+        rd_cache = "";
+    }
+
+    // the relevant parts are given by the slicing criterion
+    if (!apply_slice_mask.empty() && dg_relevant_only) {
+        errs() << "WARNING: -dg-relevant-only does not work with -apply-slice-mask, ignoring\n";
+        dg_relevant_only = false;
+    }
 
+    profile.start("Loading the module");
+    // stopped before the bitcode is released (see materialize_reachable())
+    dg::BitcodePrefetcher prefetcher(lazy_load ? lazy_prefetch * (1 << 20) : 0);
 #if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
-    M = llvm::ParseIRFile(llvmfile, SMD, context);
+    if (lazy_load)
+        M = llvm::getLazyIRFileModule(llvmfile, SMD, context);
+    else
+        M = llvm::ParseIRFile(llvmfile, SMD, context);
+#else
+    std::unique_ptr<llvm::Module> _M;
+    if (link_inputs.empty()) {
+        _M = dg::loadModule(llvmfile, SMD, context, lazy_load, &prefetcher);
+    } else {
+#if LLVM_VERSION_MAJOR >= 4
+        std::vector<std::string> files{llvmfile};
+        files.insert(files.end(), link_inputs.begin(), link_inputs.end());
+        _M = dg::loadModules(files, SMD, context, lazy_load, &prefetcher);
 #else
-    auto _M = llvm::parseIRFile(llvmfile, SMD, context);
+        errs() << "ERROR: Multiple input files need LLVM 4.0 or newer\n";
+        return 1;
+#endif
+    }
     // _M is unique pointer, we need to get Module *
     M = _M.get();
 #endif
@@ -989,11 +3213,40 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    if (statistics)
+    if (lazy_load && !materialize_reachable(M, prefetcher))
+        return 1;
+    profile.stop();
+
+    if (!executed_files.empty()) {
+        ExecutedCode executed;
+        for (const std::string& file : executed_files) {
+            std::string error;
+            if (!executed.load(file, error)) {
+                errs() << "ERROR: " << error << "\n";
+                return 1;
+            }
+        }
+
+        ExecutedCode::Statistics stats = executed.restrictModule(*M);
+        errs() << "WARNING: " << stats.functions << " functions and "
+               << stats.blocks << " blocks were not executed (-executed), they"
+               << " are unreachable. The slice is not sound for other runs\n";
+    }
+
+    if (statistics) {
+        // count the allocations of the subsystems from now on
+        ADT::AllocationStats::enable();
         print_statistics(M, "Statistics before ");
+    }
 
     // remove unused from module, we don't need that
-    remove_unused_from_module_rec(M);
+    profile.start("Removing unused parts of the module");
+    remove_unused_from_module(M);
+    profile.stop();
+
+    // must be done before the analyses are created
+    if (auto_config)
+        auto_configure(M);
 
     if (remove_unused_only) {
         errs() << "INFO: removed unused parts of module, exiting...\n";
@@ -1007,6 +3260,25 @@ int main(int argc, char *argv[])
     // slice the code
     /// ---------------
     Slicer slicer(M, opts);
+    if (statistics) {
+        // the statistics are printed after the edges are computed
+        slicer.keepAnalyses();
+        slicer.getPTA()->collectStatistics();
+        slicer.getRD()->collectStatistics();
+    }
+
+    if (separate_slices || !criteria_file.empty()) {
+        std::vector<std::vector<std::string>> sets;
+        if (!getCriteriaSets(sets))
+            return 1;
+
+        if (sets.empty()) {
+            errs() << "ERROR: No slicing criteria in " << criteria_file << "\n";
+            return 1;
+        }
+
+        slicer.setCriteriaSets(std::move(sets));
+    }
 
     // build the dependence graph, so that we can dump it if desired
     if (!slicer.buildDG()) {
@@ -1014,8 +3286,76 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    // mark nodes that are going to be in the slice
-    slicer.mark();
+    if (statistics) {
+        slicer.getPTA()->printStatistics(errs());
+        slicer.printMemoryUsage("building the dependence graph");
+    }
+
+    // serving and slicing separately fork, no helper thread may run then
+    prefetcher.stop();
+    slicer.getDG().waitControlDependencies();
+
+    if (server)
+        return serve(slicer, M, should_verify_module);
+
+    if (separate_slices || !criteria_file.empty())
+        return slice_separately(slicer, M, should_verify_module);
+
+    // the indices of the mask are valid for the module as it is now
+    uint64_t module_hash = 0;
+    if (!slice_mask.empty() || !apply_slice_mask.empty())
+        module_hash = SliceMask::hashModule(*M);
+
+    if (!apply_slice_mask.empty()) {
+        SliceMask mask;
+        std::string error;
+        if (!mask.load(apply_slice_mask, error)) {
+            errs() << "ERROR: " << error << "\n";
+            return 1;
+        }
+
+        if (mask.getModuleHash() != module_hash) {
+            errs() << "ERROR: the slice mask " << apply_slice_mask
+                   << " was saved for a different module\n";
+            return 1;
+        }
+
+        if (!slicer.markMask(mask))
+            return 1;
+    } else {
+        // mark nodes that are going to be in the slice
+        slicer.mark();
+    }
+
+    if (!slice_mask.empty()) {
+        SliceMask mask;
+        mask.setModuleHash(module_hash);
+        slicer.getSliceMask(mask);
+        if (!mask.save(slice_mask, slice_mask_format)) {
+            errs() << "ERROR: failed saving the slice mask to "
+                   << slice_mask << "\n";
+            return 1;
+        }
+
+        // the module is sliced later by -apply-slice-mask
+        return 0;
+    }
+
+    if (!source_lines.empty()) {
+        std::set<SourceLocation> locs;
+        slicer.getSliceLocations(locs);
+
+        std::ofstream ofs(source_lines);
+        writeSourceLocations(ofs, locs, source_lines_format);
+        if (!ofs)
+            errs() << "WARNING: failed saving the source lines to "
+                   << source_lines << "\n";
+    }
+
+    if (statistics) {
+        slicer.getRD()->printStatistics(errs());
+        slicer.printMemoryUsage("computing the dependencies");
+    }
 
     if (dump_dg) {
         dump_dg_to_dot(slicer.getDG(), bb_only, dump_opts);
@@ -1030,6 +3370,9 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (statistics)
+        slicer.printMemoryUsage("slicing");
+
     if (dump_dg) {
         dump_dg_to_dot(slicer.getDG(), bb_only,
                        dump_opts, ".sliced.dot");
@@ -1037,7 +3380,9 @@ int main(int argc, char *argv[])
 
     // remove unused from module again, since slicing
     // could and probably did make some other parts unused
-    remove_unused_from_module_rec(M);
+    profile.start("Removing unused parts of the module");
+    remove_unused_from_module(M);
+    profile.stop();
 
     // fix linkage of declared functions (if needs to be fixed)
     make_declarations_external(M);
@@ -1045,5 +3390,6 @@ int main(int argc, char *argv[])
     if (statistics)
         print_statistics(M, "Statistics after ");
 
+    profile.start("Saving the module");
     return save_module(M, should_verify_module);
 }
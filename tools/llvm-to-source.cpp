@@ -39,6 +39,8 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include "llvm/LoadModule.h"
+
 using namespace llvm;
 
 // lines with matching braces
@@ -160,7 +162,7 @@ int main(int argc, char *argv[])
 #if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR <= 5))
     M = llvm::ParseIRFile(module, SMD, context);
 #else
-    auto _M = llvm::parseIRFile(module, SMD, context);
+    auto _M = dg::loadModule(module, SMD, context);
     // _M is unique pointer, we need to get Module *
     M = _M.get();
 #endif